@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+#include <linux/crc32.h>
+#include <linux/export.h>
+#include <linux/linkage.h>
+
+#include <asm/alternative.h>
+#include <asm/cpufeature.h>
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+#include <crypto/internal/simd.h>
+#include <kunit/visibility.h>
+
+#include "crc32.h"
+
+/* for the comparison in test_crc32.c */
+EXPORT_SYMBOL_IF_KUNIT(crc32_le_arm64);
+EXPORT_SYMBOL_IF_KUNIT(crc32c_le_arm64);
+EXPORT_SYMBOL_IF_KUNIT(crc32_le_arm64_3way);
+EXPORT_SYMBOL_IF_KUNIT(crc32c_le_arm64_3way);
+
+static bool crc32_use_3way(size_t len)
+{
+	return len >= CRC32_3WAY_THRESHOLD && cpu_have_named_feature(PMULL) &&
+	       crypto_simd_usable();
+}
+
+u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!alternative_has_cap_likely(ARM64_HAS_CRC32))
+		return crc32_le_base(crc, p, len);
+
+	if (crc32_use_3way(len)) {
+		kernel_neon_begin();
+		crc = crc32_le_arm64_3way(crc, p, len);
+		kernel_neon_end();
+		return crc;
+	}
+
+	return crc32_le_arm64(crc, p, len);
+}
+
+u32 __pure __crc32c_le(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!alternative_has_cap_likely(ARM64_HAS_CRC32))
+		return __crc32c_le_base(crc, p, len);
+
+	if (crc32_use_3way(len)) {
+		kernel_neon_begin();
+		crc = crc32c_le_arm64_3way(crc, p, len);
+		kernel_neon_end();
+		return crc;
+	}
+
+	return crc32c_le_arm64(crc, p, len);
+}
+
+u32 __pure crc32_be(u32 crc, unsigned char const *p, size_t len)
+{
+	if (!alternative_has_cap_likely(ARM64_HAS_CRC32))
+		return crc32_be_base(crc, p, len);
+
+	return crc32_be_arm64(crc, p, len);
+}
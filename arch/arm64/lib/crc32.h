@@ -0,0 +1,22 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __ARM64_LIB_CRC32_H
+#define __ARM64_LIB_CRC32_H
+
+#include <linux/linkage.h>
+#include <linux/types.h>
+
+/*
+ * Below this many bytes the 3-way code doesn't make up for the cost of
+ * preserving the FPSIMD state, and the CRC instructions alone are faster.
+ */
+#define CRC32_3WAY_THRESHOLD	1024
+
+asmlinkage u32 crc32_le_arm64(u32 crc, unsigned char const *p, size_t len);
+asmlinkage u32 crc32c_le_arm64(u32 crc, unsigned char const *p, size_t len);
+asmlinkage u32 crc32_be_arm64(u32 crc, unsigned char const *p, size_t len);
+
+/* Interleaved over 768 byte blocks with PMULL folding, must be in NEON */
+asmlinkage u32 crc32_le_arm64_3way(u32 crc, unsigned char const *p, size_t len);
+asmlinkage u32 crc32c_le_arm64_3way(u32 crc, unsigned char const *p, size_t len);
+
+#endif /* __ARM64_LIB_CRC32_H */
@@ -0,0 +1,42 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * NEON accumulation for the body of do_csum()
+ */
+
+#include <asm/neon-intrinsics.h>
+
+#include "csum.h"
+
+/*
+ * Sum @blocks 64-byte blocks starting at the dword aligned @ptr. The 32-bit
+ * words are pairwise accumulated into 64-bit lanes, which cannot overflow
+ * for any buffer we will realistically be handed, and since 2^32 == 1
+ * modulo 0xffff the result folds to the same checksum as the data itself.
+ * Must be called between kernel_neon_begin() and kernel_neon_end().
+ */
+u64 do_csum_neon(const u64 *ptr, unsigned int blocks)
+{
+	const u32 *p = (const u32 *)ptr;
+	uint64x2_t sum0 = vdupq_n_u64(0);
+	uint64x2_t sum1 = vdupq_n_u64(0);
+	uint64x2_t sum2 = vdupq_n_u64(0);
+	uint64x2_t sum3 = vdupq_n_u64(0);
+	__uint128_t tmp;
+	u64 sum;
+
+	do {
+		sum0 = vpadalq_u32(sum0, vld1q_u32(p + 0));
+		sum1 = vpadalq_u32(sum1, vld1q_u32(p + 4));
+		sum2 = vpadalq_u32(sum2, vld1q_u32(p + 8));
+		sum3 = vpadalq_u32(sum3, vld1q_u32(p + 12));
+		p += 16;
+	} while (--blocks);
+
+	sum0 = vaddq_u64(vaddq_u64(sum0, sum1), vaddq_u64(sum2, sum3));
+
+	/* Fold the two lanes with end-around carry */
+	tmp = (__uint128_t)vgetq_lane_u64(sum0, 0) + vgetq_lane_u64(sum0, 1);
+	sum = tmp + (tmp >> 64);
+
+	return sum;
+}
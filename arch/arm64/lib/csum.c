@@ -5,8 +5,13 @@
 #include <linux/kasan-checks.h>
 #include <linux/kernel.h>
 
+#include <asm/neon.h>
+#include <asm/simd.h>
+
 #include <net/checksum.h>
 
+#include "csum.h"
+
 /* Looks dumb, but generates nice-ish code */
 static u64 accumulate(u64 sum, u64 data)
 {
@@ -59,6 +64,17 @@ unsigned int __no_sanitize_address do_csum(const unsigned char *buff, int len)
 	 * main loop strictly excludes the tail, so the second loop will always
 	 * run at least once.
 	 */
+	if (IS_ENABLED(CONFIG_KERNEL_MODE_NEON) &&
+	    len > CSUM_NEON_THRESHOLD && may_use_simd()) {
+		unsigned int blocks = (len - 1) / 64;
+
+		kernel_neon_begin();
+		sum64 = accumulate(sum64, do_csum_neon(ptr, blocks));
+		kernel_neon_end();
+
+		len -= blocks * 64;
+		ptr += blocks * 8;
+	}
 	while (unlikely(len > 64)) {
 		__uint128_t tmp1, tmp2, tmp3, tmp4;
 
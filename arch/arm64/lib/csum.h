@@ -0,0 +1,15 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#ifndef __ARM64_LIB_CSUM_H
+#define __ARM64_LIB_CSUM_H
+
+#include <linux/types.h>
+
+/*
+ * Below this many bytes the cost of preserving the FPSIMD state outweighs
+ * the faster accumulation, so do_csum() stays on the scalar path.
+ */
+#define CSUM_NEON_THRESHOLD	1024
+
+u64 do_csum_neon(const u64 *ptr, unsigned int blocks);
+
+#endif /* __ARM64_LIB_CSUM_H */
@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * KUnit test and benchmark of the arm64 CRC32(C) implementations: the
+ * generic table driven code, the CRC instructions on their own, and the
+ * 3-way interleaved CRC instructions with PMULL folding.
+ */
+#include <kunit/test.h>
+#include <linux/crc32.h>
+#include <linux/ktime.h>
+#include <linux/prandom.h>
+#include <linux/sizes.h>
+#include <linux/vmalloc.h>
+
+#include <asm/cpufeature.h>
+#include <asm/neon.h>
+
+#include "crc32.h"
+
+#define TEST_BUF_LEN	(64 * 1024)
+
+enum crc32_impl_type {
+	CRC32_GENERIC,
+	CRC32_INSN,
+	CRC32_3WAY,
+};
+
+struct crc32_impl {
+	const char *name;
+	u32 (*fn)(u32 crc, unsigned char const *p, size_t len);
+	enum crc32_impl_type type;
+	bool castagnoli;
+};
+
+static const struct crc32_impl crc32_impls[] = {
+	{ "crc32-generic", crc32_le_base, CRC32_GENERIC },
+	{ "crc32-insn", crc32_le_arm64, CRC32_INSN },
+	{ "crc32-3way", crc32_le_arm64_3way, CRC32_3WAY },
+	{ "crc32c-generic", __crc32c_le_base, CRC32_GENERIC, true },
+	{ "crc32c-insn", crc32c_le_arm64, CRC32_INSN, true },
+	{ "crc32c-3way", crc32c_le_arm64_3way, CRC32_3WAY, true },
+};
+
+static bool crc32_impl_usable(const struct crc32_impl *impl)
+{
+	switch (impl->type) {
+	case CRC32_3WAY:
+		if (!cpu_have_named_feature(PMULL))
+			return false;
+		fallthrough;
+	case CRC32_INSN:
+		return cpus_have_cap(ARM64_HAS_CRC32);
+	default:
+		return true;
+	}
+}
+
+static u32 crc32_impl_run(const struct crc32_impl *impl, u32 crc,
+			  const u8 *p, size_t len)
+{
+	if (impl->type != CRC32_3WAY)
+		return impl->fn(crc, p, len);
+
+	kernel_neon_begin();
+	crc = impl->fn(crc, p, len);
+	kernel_neon_end();
+	return crc;
+}
+
+static u8 *crc32_test_buf(struct kunit *test)
+{
+	struct rnd_state rnd;
+	u8 *buf = vmalloc(TEST_BUF_LEN);
+
+	KUNIT_ASSERT_NOT_NULL(test, buf);
+	prandom_seed_state(&rnd, 42);
+	prandom_bytes_state(&rnd, buf, TEST_BUF_LEN);
+	return buf;
+}
+
+static void crc32_test_correctness(struct kunit *test)
+{
+	static const size_t lens[] = {
+		0, 1, 7, 15, 16, 31, 32, 63, 767, 768, 769, 1023, 1024, 1536,
+		2047, 2304, 4096, 4097, 16383, TEST_BUF_LEN - 64,
+	};
+	u8 *buf = crc32_test_buf(test);
+	unsigned int i, j, off;
+
+	for (i = 0; i < ARRAY_SIZE(crc32_impls); i++) {
+		const struct crc32_impl *impl = &crc32_impls[i];
+
+		if (!crc32_impl_usable(impl))
+			continue;
+
+		for (j = 0; j < ARRAY_SIZE(lens); j++) {
+			for (off = 0; off < 8; off += 3) {
+				u32 seed = 0xdeadbeef * (off + 1);
+				u32 want = impl->castagnoli ?
+					   __crc32c_le_base(seed, buf + off, lens[j]) :
+					   crc32_le_base(seed, buf + off, lens[j]);
+
+				KUNIT_EXPECT_EQ_MSG(test, want,
+					crc32_impl_run(impl, seed, buf + off, lens[j]),
+					"%s len=%zu off=%u", impl->name, lens[j], off);
+			}
+		}
+	}
+
+	/* and what the rest of the kernel gets */
+	KUNIT_EXPECT_EQ(test, crc32_le_base(~0, buf, TEST_BUF_LEN),
+			crc32_le(~0, buf, TEST_BUF_LEN));
+	KUNIT_EXPECT_EQ(test, __crc32c_le_base(~0, buf, TEST_BUF_LEN),
+			__crc32c_le(~0, buf, TEST_BUF_LEN));
+
+	vfree(buf);
+}
+
+static void crc32_test_benchmark(struct kunit *test)
+{
+	static const size_t lens[] = { 64, 256, 1024, 4096, 16384, TEST_BUF_LEN };
+	u8 *buf = crc32_test_buf(test);
+	unsigned int i, j, n, iters;
+	u64 t, bytes;
+	u32 crc = 0;
+
+	for (i = 0; i < ARRAY_SIZE(crc32_impls); i++) {
+		const struct crc32_impl *impl = &crc32_impls[i];
+
+		if (!crc32_impl_usable(impl))
+			continue;
+
+		for (j = 0; j < ARRAY_SIZE(lens); j++) {
+			iters = max_t(unsigned int, 16, SZ_4M / lens[j]);
+
+			/* warm up the caches and branch predictors */
+			crc = crc32_impl_run(impl, crc, buf, lens[j]);
+
+			t = ktime_get_ns();
+			for (n = 0; n < iters; n++)
+				crc = crc32_impl_run(impl, crc, buf, lens[j]);
+			t = ktime_get_ns() - t;
+
+			bytes = (u64)iters * lens[j];
+			kunit_info(test, "%s len=%zu: %llu MB/s\n", impl->name,
+				   lens[j], div64_u64(bytes * 1000, t ?: 1));
+			cond_resched();
+		}
+	}
+
+	/* keep the compiler from dropping the loops */
+	KUNIT_EXPECT_NE(test, crc, 0x12345678);
+	vfree(buf);
+}
+
+static struct kunit_case crc32_arm64_test_cases[] = {
+	KUNIT_CASE(crc32_test_correctness),
+	KUNIT_CASE_SLOW(crc32_test_benchmark),
+	{}
+};
+
+static struct kunit_suite crc32_arm64_test_suite = {
+	.name = "crc32-arm64",
+	.test_cases = crc32_arm64_test_cases,
+};
+kunit_test_suite(crc32_arm64_test_suite);
+
+MODULE_DESCRIPTION("KUnit test and benchmark for the arm64 CRC32 code");
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+MODULE_LICENSE("GPL");
@@ -12,6 +12,7 @@
 #include <linux/filter.h>
 #include <linux/memory.h>
 #include <linux/printk.h>
+#include <linux/sched.h>
 #include <linux/slab.h>
 
 #include <asm/asm-extable.h>
@@ -438,12 +439,22 @@ static int emit_bpf_tail_call(struct jit_ctx *ctx)
 #define jmp_offset (out_offset - (cur_offset))
 	size_t off;
 
+	/*
+	 * All offsets below are compile-time constants, so whichever encoding
+	 * is picked, every tail call emits the same number of instructions
+	 * and out_offset stays valid.
+	 */
+
 	/* if (index >= array->map.max_entries)
 	 *     goto out;
 	 */
 	off = offsetof(struct bpf_array, map.max_entries);
-	emit_a64_mov_i64(tmp, off, ctx);
-	emit(A64_LDR32(tmp, r2, tmp), ctx);
+	if (is_lsi_offset(off, 2)) {
+		emit(A64_LDR32I(tmp, r2, off), ctx);
+	} else {
+		emit_a64_mov_i64(tmp, off, ctx);
+		emit(A64_LDR32(tmp, r2, tmp), ctx);
+	}
 	emit(A64_MOV(0, r3, r3), ctx);
 	emit(A64_CMP(0, r3, tmp), ctx);
 	emit(A64_B_(A64_COND_CS, jmp_offset), ctx);
@@ -453,8 +464,12 @@ static int emit_bpf_tail_call(struct jit_ctx *ctx)
 	 *     goto out;
 	 * tail_call_cnt++;
 	 */
-	emit_a64_mov_i64(tmp, MAX_TAIL_CALL_CNT, ctx);
-	emit(A64_CMP(1, tcc, tmp), ctx);
+	if (is_addsub_imm(MAX_TAIL_CALL_CNT)) {
+		emit(A64_CMP_I(1, tcc, MAX_TAIL_CALL_CNT), ctx);
+	} else {
+		emit_a64_mov_i64(tmp, MAX_TAIL_CALL_CNT, ctx);
+		emit(A64_CMP(1, tcc, tmp), ctx);
+	}
 	emit(A64_B_(A64_COND_CS, jmp_offset), ctx);
 	emit(A64_ADD_I(1, tcc, tcc, 1), ctx);
 
@@ -463,16 +478,24 @@ static int emit_bpf_tail_call(struct jit_ctx *ctx)
 	 *     goto out;
 	 */
 	off = offsetof(struct bpf_array, ptrs);
-	emit_a64_mov_i64(tmp, off, ctx);
-	emit(A64_ADD(1, tmp, r2, tmp), ctx);
+	if (is_addsub_imm(off)) {
+		emit(A64_ADD_I(1, tmp, r2, off), ctx);
+	} else {
+		emit_a64_mov_i64(tmp, off, ctx);
+		emit(A64_ADD(1, tmp, r2, tmp), ctx);
+	}
 	emit(A64_LSL(1, prg, r3, 3), ctx);
 	emit(A64_LDR64(prg, tmp, prg), ctx);
 	emit(A64_CBZ(1, prg, jmp_offset), ctx);
 
 	/* goto *(prog->bpf_func + prologue_offset); */
 	off = offsetof(struct bpf_prog, bpf_func);
-	emit_a64_mov_i64(tmp, off, ctx);
-	emit(A64_LDR64(tmp, prg, tmp), ctx);
+	if (is_lsi_offset(off, 3)) {
+		emit(A64_LDR64I(tmp, prg, off), ctx);
+	} else {
+		emit_a64_mov_i64(tmp, off, ctx);
+		emit(A64_LDR64(tmp, prg, tmp), ctx);
+	}
 	emit(A64_ADD_I(1, tmp, tmp, sizeof(u32) * PROLOGUE_OFFSET), ctx);
 	emit(A64_ADD_I(1, A64_SP, A64_SP, ctx->stack_size), ctx);
 	emit(A64_BR(tmp), ctx);
@@ -1244,6 +1267,28 @@ static int build_insn(const struct bpf_insn *insn, struct jit_ctx *ctx,
 			break;
 		}
 
+		/* Implement helper call to bpf_get_current_pid_tgid() inline */
+		if (insn->src_reg == 0 && insn->imm == BPF_FUNC_get_current_pid_tgid) {
+			u32 tgid_offset = offsetof(struct task_struct, tgid);
+			u32 pid_offset = offsetof(struct task_struct, pid);
+
+			/* r0 = (u64)current->tgid << 32 | current->pid */
+			emit(A64_MRS_SP_EL0(tmp), ctx);
+			if (is_lsi_offset(tgid_offset, 2) &&
+			    is_lsi_offset(pid_offset, 2)) {
+				emit(A64_LDR32I(r0, tmp, tgid_offset), ctx);
+				emit(A64_LDR32I(tmp, tmp, pid_offset), ctx);
+			} else {
+				emit_a64_mov_i(1, tmp2, tgid_offset, ctx);
+				emit(A64_LDR32(r0, tmp, tmp2), ctx);
+				emit_a64_mov_i(1, tmp2, pid_offset, ctx);
+				emit(A64_LDR32(tmp, tmp, tmp2), ctx);
+			}
+			emit(A64_LSL(1, r0, r0, 32), ctx);
+			emit(A64_ORR(1, r0, r0, tmp), ctx);
+			break;
+		}
+
 		/* Implement helper call to bpf_get_current_task/_btf() inline */
 		if (insn->src_reg == 0 && (insn->imm == BPF_FUNC_get_current_task ||
 					   insn->imm == BPF_FUNC_get_current_task_btf)) {
@@ -2587,6 +2632,7 @@ bool bpf_jit_inlines_helper_call(s32 imm)
 {
 	switch (imm) {
 	case BPF_FUNC_get_smp_processor_id:
+	case BPF_FUNC_get_current_pid_tgid:
 	case BPF_FUNC_get_current_task:
 	case BPF_FUNC_get_current_task_btf:
 		return true;
@@ -1249,6 +1249,96 @@ int request_firmware_nowait(
 }
 EXPORT_SYMBOL(request_firmware_nowait);
 
+struct fw_prefetch {
+	const char *name;
+	const struct firmware *fw;
+	struct completion done;
+};
+
+static void fw_prefetch_done(const struct firmware *fw, void *context)
+{
+	struct fw_prefetch *fp = context;
+
+	fp->fw = fw;
+	complete(&fp->done);
+}
+
+static void fw_prefetch_release(struct device *dev, void *res)
+{
+	struct fw_prefetch *fp = res;
+
+	wait_for_completion(&fp->done);
+	release_firmware(fp->fw);
+	kfree_const(fp->name);
+}
+
+static int fw_prefetch_match(struct device *dev, void *res, void *match_data)
+{
+	struct fw_prefetch *fp = res;
+
+	return !strcmp(fp->name, match_data);
+}
+
+/**
+ * firmware_request_prefetch() - start loading a firmware image in background
+ * @device: device for which the firmware will be requested
+ * @name: name of firmware file
+ *
+ * Drivers that know early which images they will need can call this, e.g.
+ * from probe, so that several images are read in parallel instead of one
+ * after another. The loaded image is kept until firmware_prefetch_drop() is
+ * called or @device is unbound. A request_firmware() for the same name issued
+ * in the meantime shares the prefetched buffer, waiting for it if the load is
+ * still in progress. Requests that bypass the cache, such as
+ * request_firmware_into_buf(), still benefit from the warm page cache.
+ *
+ * Return: 0 if the load was scheduled, or a negative errno.
+ **/
+int firmware_request_prefetch(struct device *device, const char *name)
+{
+	struct fw_prefetch *fp;
+	int ret;
+
+	fp = devres_alloc(fw_prefetch_release, sizeof(*fp), GFP_KERNEL);
+	if (!fp)
+		return -ENOMEM;
+
+	fp->name = kstrdup_const(name, GFP_KERNEL);
+	if (!fp->name) {
+		devres_free(fp);
+		return -ENOMEM;
+	}
+	init_completion(&fp->done);
+
+	ret = _request_firmware_nowait(THIS_MODULE, true, name, device,
+				       GFP_KERNEL, fp, fw_prefetch_done, true);
+	if (ret) {
+		kfree_const(fp->name);
+		devres_free(fp);
+		return ret;
+	}
+
+	devres_add(device, fp);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(firmware_request_prefetch);
+
+/**
+ * firmware_prefetch_drop() - release an image loaded by firmware_request_prefetch()
+ * @device: device passed to firmware_request_prefetch()
+ * @name: name of firmware file
+ *
+ * Waits for the prefetch to finish if needed. Users that already obtained the
+ * image through request_firmware() keep their own reference.
+ **/
+void firmware_prefetch_drop(struct device *device, const char *name)
+{
+	devres_release(device, fw_prefetch_release, fw_prefetch_match,
+		       (void *)name);
+}
+EXPORT_SYMBOL_GPL(firmware_prefetch_drop);
+
 /**
  * firmware_request_nowait_nowarn() - async version of request_firmware_nowarn
  * @module: module requesting the firmware
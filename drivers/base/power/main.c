@@ -18,6 +18,7 @@
 #define pr_fmt(fmt) "PM: " fmt
 #define dev_fmt pr_fmt
 
+#include <linux/debugfs.h>
 #include <linux/device.h>
 #include <linux/export.h>
 #include <linux/mutex.h>
@@ -34,6 +35,7 @@
 #include <linux/cpufreq.h>
 #include <linux/devfreq.h>
 #include <linux/timer.h>
+#include <linux/vmalloc.h>
 
 #include "../base.h"
 #include "power.h"
@@ -469,6 +471,208 @@ static void dpm_show_time(ktime_t starttime, pm_message_t state, int error,
 		  usecs / USEC_PER_MSEC, usecs % USEC_PER_MSEC);
 }
 
+enum dpm_times_phase {
+	DPM_TIMES_SUSPEND,
+	DPM_TIMES_SUSPEND_LATE,
+	DPM_TIMES_SUSPEND_NOIRQ,
+	DPM_TIMES_RESUME_NOIRQ,
+	DPM_TIMES_RESUME_EARLY,
+	DPM_TIMES_RESUME,
+	DPM_TIMES_NR_PHASES,
+};
+
+#ifdef CONFIG_DEBUG_FS
+/*
+ * Per device callback times of the last system sleep transitions, kept in a
+ * ring so that a slow resume can be attributed after the fact, without
+ * initcall_debug and a console that's fast enough to keep up.
+ */
+#define DPM_TIMES_NR		1024
+#define DPM_TIMES_NAME_LEN	32
+
+struct dpm_time {
+	char name[DPM_TIMES_NAME_LEN];
+	enum dpm_times_phase phase;
+	unsigned int cycle;
+	ktime_t start;		/* entry of device_*() */
+	ktime_t ready;		/* parents, children or links have finished */
+	ktime_t end;		/* callback returned */
+	int error;
+	bool async;
+};
+
+static struct dpm_time *dpm_times;
+static unsigned int dpm_times_head;
+static unsigned int dpm_times_cycle;
+static DEFINE_SPINLOCK(dpm_times_lock);
+
+static void dpm_times_new_cycle(void)
+{
+	WRITE_ONCE(dpm_times_cycle, dpm_times_cycle + 1);
+}
+
+static void dpm_times_add(struct device *dev, enum dpm_times_phase phase,
+			  ktime_t start, ktime_t ready, int error, bool async)
+{
+	ktime_t end = ktime_get();
+	struct dpm_time *t;
+	unsigned long flags;
+
+	if (!dpm_times)
+		return;
+
+	spin_lock_irqsave(&dpm_times_lock, flags);
+	t = &dpm_times[dpm_times_head++ % DPM_TIMES_NR];
+	strscpy(t->name, dev_name(dev), sizeof(t->name));
+	t->phase = phase;
+	t->cycle = dpm_times_cycle;
+	t->start = start;
+	t->ready = ready;
+	t->end = end;
+	t->error = error;
+	t->async = async;
+	spin_unlock_irqrestore(&dpm_times_lock, flags);
+}
+
+static const char * const dpm_times_phases[DPM_TIMES_NR_PHASES] = {
+	[DPM_TIMES_SUSPEND] = "suspend",
+	[DPM_TIMES_SUSPEND_LATE] = "suspend late",
+	[DPM_TIMES_SUSPEND_NOIRQ] = "suspend noirq",
+	[DPM_TIMES_RESUME_NOIRQ] = "resume noirq",
+	[DPM_TIMES_RESUME_EARLY] = "resume early",
+	[DPM_TIMES_RESUME] = "resume",
+};
+
+static void dpm_times_show_entry(struct seq_file *s, const struct dpm_time *t,
+				 ktime_t base)
+{
+	seq_printf(s, "    %-32s %-5s start=%8lld wait=%8lld cb=%8lld us%s\n",
+		   t->name, t->async ? "async" : "sync",
+		   ktime_us_delta(t->start, base),
+		   ktime_us_delta(t->ready, t->start),
+		   ktime_us_delta(t->end, t->ready),
+		   t->error ? " (failed)" : "");
+}
+
+/*
+ * The critical path of a phase is rebuilt backwards from the device that
+ * finished last. A device that had to wait was released by whatever
+ * finished just before it stopped waiting, which for a sync device is the
+ * one before it in dpm_list and for an async one the last of its parents,
+ * children or links.
+ */
+static void dpm_times_show_phase(struct seq_file *s, struct dpm_time *times,
+				 unsigned int n, enum dpm_times_phase phase)
+{
+	struct dpm_time *t, *last = NULL, *pred = NULL, *slow[8] = { };
+	ktime_t base = KTIME_MAX;
+	unsigned int i, j, nr = 0, depth;
+
+	for (i = 0; i < n; i++) {
+		t = &times[i];
+		if (t->phase != phase)
+			continue;
+
+		nr++;
+		base = min(base, t->start);
+		if (!last || t->end > last->end)
+			last = t;
+
+		/* Keep the slowest callbacks, sorted */
+		for (j = 0; j < ARRAY_SIZE(slow); j++) {
+			if (!slow[j] || ktime_sub(t->end, t->ready) >
+					ktime_sub(slow[j]->end, slow[j]->ready)) {
+				memmove(&slow[j + 1], &slow[j],
+					(ARRAY_SIZE(slow) - j - 1) * sizeof(*slow));
+				slow[j] = t;
+				break;
+			}
+		}
+	}
+
+	if (!nr)
+		return;
+
+	seq_printf(s, "%s: %u devices, %lld us\n", dpm_times_phases[phase], nr,
+		   ktime_us_delta(last->end, base));
+
+	seq_puts(s, "  critical path:\n");
+	for (t = last, depth = 0; t && depth < 32; t = pred, depth++) {
+		dpm_times_show_entry(s, t, base);
+
+		/* Started right away, nothing held it up */
+		if (t->async && ktime_us_delta(t->ready, t->start) < 10)
+			break;
+
+		pred = NULL;
+		for (i = 0; i < n; i++) {
+			if (times[i].phase != phase || &times[i] == t ||
+			    times[i].end > t->ready)
+				continue;
+			if (!pred || times[i].end > pred->end)
+				pred = &times[i];
+		}
+
+		/* Held up by something other than a callback, give up */
+		if (pred && ktime_us_delta(t->ready, pred->end) > 1000)
+			break;
+	}
+
+	seq_puts(s, "  slowest callbacks:\n");
+	for (j = 0; j < ARRAY_SIZE(slow) && slow[j]; j++)
+		dpm_times_show_entry(s, slow[j], base);
+}
+
+static int dpm_times_show(struct seq_file *s, void *unused)
+{
+	unsigned int head, cycle, i, n = 0;
+	struct dpm_time *times;
+
+	times = kvcalloc(DPM_TIMES_NR, sizeof(*times), GFP_KERNEL);
+	if (!times)
+		return -ENOMEM;
+
+	/* Snapshot the entries of the last transition */
+	spin_lock_irq(&dpm_times_lock);
+	head = dpm_times_head;
+	cycle = dpm_times[(head - 1) % DPM_TIMES_NR].cycle;
+	for (i = 0; i < min(head, DPM_TIMES_NR); i++) {
+		struct dpm_time *t = &dpm_times[(head - 1 - i) % DPM_TIMES_NR];
+
+		if (t->cycle == cycle)
+			times[n++] = *t;
+	}
+	spin_unlock_irq(&dpm_times_lock);
+
+	if (n == DPM_TIMES_NR)
+		seq_puts(s, "(ring overflowed, oldest entries are missing)\n");
+
+	for (i = 0; i < DPM_TIMES_NR_PHASES; i++)
+		dpm_times_show_phase(s, times, n, i);
+
+	kvfree(times);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(dpm_times);
+
+static int __init dpm_times_init(void)
+{
+	dpm_times = vzalloc(array_size(DPM_TIMES_NR, sizeof(*dpm_times)));
+	if (!dpm_times)
+		return -ENOMEM;
+
+	debugfs_create_file("pm_device_times", 0400, NULL, NULL,
+			    &dpm_times_fops);
+	return 0;
+}
+late_initcall(dpm_times_init);
+#else
+static inline void dpm_times_new_cycle(void) {}
+static inline void dpm_times_add(struct device *dev, enum dpm_times_phase phase,
+				 ktime_t start, ktime_t ready, int error,
+				 bool async) {}
+#endif
+
 static int dpm_run_callback(pm_callback_t cb, struct device *dev,
 			    pm_message_t state, const char *info)
 {
@@ -617,6 +821,7 @@ static bool dpm_async_fn(struct device *dev, async_func_t func)
  */
 static void device_resume_noirq(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready = start;
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
 	bool skip_resume;
@@ -633,6 +838,7 @@ static void device_resume_noirq(struct device *dev, pm_message_t state, bool asy
 
 	if (!dpm_wait_for_superior(dev, async))
 		goto Out;
+	ready = ktime_get();
 
 	skip_resume = dev_pm_skip_resume(dev);
 	/*
@@ -676,6 +882,8 @@ static void device_resume_noirq(struct device *dev, pm_message_t state, bool asy
 
 Run:
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		dpm_times_add(dev, DPM_TIMES_RESUME_NOIRQ, start, ready, error, async);
 
 Skip:
 	dev->power.is_noirq_suspended = false;
@@ -768,6 +976,7 @@ void dpm_resume_noirq(pm_message_t state)
  */
 static void device_resume_early(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready = start;
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
 	int error = 0;
@@ -783,6 +992,7 @@ static void device_resume_early(struct device *dev, pm_message_t state, bool asy
 
 	if (!dpm_wait_for_superior(dev, async))
 		goto Out;
+	ready = ktime_get();
 
 	if (dev->pm_domain) {
 		info = "early power domain ";
@@ -810,6 +1020,8 @@ static void device_resume_early(struct device *dev, pm_message_t state, bool asy
 
 Run:
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		dpm_times_add(dev, DPM_TIMES_RESUME_EARLY, start, ready, error, async);
 
 Skip:
 	dev->power.is_late_suspended = false;
@@ -902,6 +1114,7 @@ EXPORT_SYMBOL_GPL(dpm_resume_start);
  */
 static void device_resume(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready = start;
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
 	int error = 0;
@@ -921,6 +1134,7 @@ static void device_resume(struct device *dev, pm_message_t state, bool async)
 
 	if (!dpm_wait_for_superior(dev, async))
 		goto Complete;
+	ready = ktime_get();
 
 	dpm_watchdog_set(&wd, dev);
 	device_lock(dev);
@@ -971,6 +1185,8 @@ static void device_resume(struct device *dev, pm_message_t state, bool async)
 
  End:
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		dpm_times_add(dev, DPM_TIMES_RESUME, start, ready, error, async);
 	dev->power.is_suspended = false;
 
  Unlock:
@@ -1202,6 +1418,7 @@ static void dpm_superior_set_must_resume(struct device *dev)
  */
 static int device_suspend_noirq(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready = start;
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
 	int error = 0;
@@ -1210,6 +1427,7 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state, bool asy
 	TRACE_SUSPEND(0);
 
 	dpm_wait_for_subordinate(dev, async);
+	ready = ktime_get();
 
 	if (async_error)
 		goto Complete;
@@ -1243,6 +1461,8 @@ static int device_suspend_noirq(struct device *dev, pm_message_t state, bool asy
 
 Run:
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		dpm_times_add(dev, DPM_TIMES_SUSPEND_NOIRQ, start, ready, error, async);
 	if (error) {
 		async_error = error;
 		dpm_save_failed_dev(dev_name(dev));
@@ -1375,6 +1595,7 @@ static void dpm_propagate_wakeup_to_parent(struct device *dev)
  */
 static int device_suspend_late(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready = start;
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
 	int error = 0;
@@ -1385,6 +1606,7 @@ static int device_suspend_late(struct device *dev, pm_message_t state, bool asyn
 	__pm_runtime_disable(dev, false);
 
 	dpm_wait_for_subordinate(dev, async);
+	ready = ktime_get();
 
 	if (async_error)
 		goto Complete;
@@ -1423,6 +1645,8 @@ static int device_suspend_late(struct device *dev, pm_message_t state, bool asyn
 
 Run:
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		dpm_times_add(dev, DPM_TIMES_SUSPEND_LATE, start, ready, error, async);
 	if (error) {
 		async_error = error;
 		dpm_save_failed_dev(dev_name(dev));
@@ -1582,6 +1806,7 @@ static void dpm_clear_superiors_direct_complete(struct device *dev)
  */
 static int device_suspend(struct device *dev, pm_message_t state, bool async)
 {
+	ktime_t start = ktime_get(), ready = start;
 	pm_callback_t callback = NULL;
 	const char *info = NULL;
 	int error = 0;
@@ -1591,6 +1816,7 @@ static int device_suspend(struct device *dev, pm_message_t state, bool async)
 	TRACE_SUSPEND(0);
 
 	dpm_wait_for_subordinate(dev, async);
+	ready = ktime_get();
 
 	if (async_error) {
 		dev->power.direct_complete = false;
@@ -1679,6 +1905,8 @@ static int device_suspend(struct device *dev, pm_message_t state, bool async)
 	}
 
 	error = dpm_run_callback(callback, dev, state, info);
+	if (callback)
+		dpm_times_add(dev, DPM_TIMES_SUSPEND, start, ready, error, async);
 
  End:
 	if (!error) {
@@ -1851,6 +2079,8 @@ int dpm_prepare(pm_message_t state)
 	trace_suspend_resume(TPS("dpm_prepare"), state.event, true);
 	might_sleep();
 
+	dpm_times_new_cycle();
+
 	/*
 	 * Give a chance for the known devices to complete their probes, before
 	 * disable probing of devices. This sync point is important at least
@@ -32,6 +32,7 @@
 #include <linux/sysfs.h>
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
+#include <linux/delay.h>
 #include <linux/part_stat.h>
 
 #include "zram_drv.h"
@@ -296,7 +297,7 @@ static void mark_idle(struct zram *zram, ktime_t cutoff)
 	for (index = 0; index < nr_pages; index++) {
 		/*
 		 * Do not mark ZRAM_UNDER_WB slot as ZRAM_IDLE to close race.
-		 * See the comment in writeback_store.
+		 * See the comment in zram_writeback_complete.
 		 */
 		zram_slot_lock(zram, index);
 		if (zram_allocated(zram, index) &&
@@ -542,6 +543,52 @@ static ssize_t backing_dev_store(struct device *dev,
 	return err;
 }
 
+/* writeback requests kept in flight by default, and at most */
+#define ZRAM_WB_DEFAULT_BATCH	32
+#define ZRAM_WB_MAX_BATCH	1024
+
+static ssize_t writeback_batch_size_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u32 val;
+
+	if (kstrtouint(buf, 10, &val) || !val || val > ZRAM_WB_MAX_BATCH)
+		return -EINVAL;
+
+	WRITE_ONCE(zram->wb_batch_size, val);
+	return len;
+}
+
+static ssize_t writeback_batch_size_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(zram->wb_batch_size));
+}
+
+static ssize_t writeback_rate_limit_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u32 val;
+
+	if (kstrtouint(buf, 10, &val))
+		return -EINVAL;
+
+	WRITE_ONCE(zram->wb_rate_limit, val);
+	return len;
+}
+
+static ssize_t writeback_rate_limit_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(zram->wb_rate_limit));
+}
+
 static unsigned long alloc_block_bdev(struct zram *zram)
 {
 	unsigned long blk_idx = 1;
@@ -586,18 +633,204 @@ static void read_from_bdev_async(struct zram *zram, struct page *page,
 #define IDLE_WRITEBACK			(1<<1)
 #define INCOMPRESSIBLE_WRITEBACK	(1<<2)
 
+/* A page being written back, with its bio */
+struct zram_wb_req {
+	unsigned long blk_idx;
+	struct page *page;
+	u32 index;
+	struct bio bio;
+	struct bio_vec bio_vec;
+	struct list_head entry;
+};
+
+struct zram_wb_ctl {
+	struct list_head idle_reqs;
+	/* completed by zram_writeback_endio(), under done_lock */
+	struct list_head done_reqs;
+	spinlock_t done_lock;
+	wait_queue_head_t done_wait;
+	unsigned int num_inflight;
+};
+
+static void zram_wb_ctl_free(struct zram *zram, struct zram_wb_ctl *ctl)
+{
+	struct zram_wb_req *req, *tmp;
+
+	list_for_each_entry_safe(req, tmp, &ctl->idle_reqs, entry) {
+		if (req->blk_idx)
+			free_block_bdev(zram, req->blk_idx);
+		__free_page(req->page);
+		kfree(req);
+	}
+	kfree(ctl);
+}
+
+static struct zram_wb_ctl *zram_wb_ctl_alloc(struct zram *zram,
+					     unsigned int nr_reqs)
+{
+	struct zram_wb_ctl *ctl;
+	struct zram_wb_req *req;
+	unsigned int i;
+
+	ctl = kzalloc(sizeof(*ctl), GFP_KERNEL);
+	if (!ctl)
+		return NULL;
+
+	INIT_LIST_HEAD(&ctl->idle_reqs);
+	INIT_LIST_HEAD(&ctl->done_reqs);
+	spin_lock_init(&ctl->done_lock);
+	init_waitqueue_head(&ctl->done_wait);
+
+	for (i = 0; i < nr_reqs; i++) {
+		req = kzalloc(sizeof(*req), GFP_KERNEL);
+		if (!req)
+			break;
+		req->page = alloc_page(GFP_KERNEL);
+		if (!req->page) {
+			kfree(req);
+			break;
+		}
+		list_add(&req->entry, &ctl->idle_reqs);
+	}
+
+	/* fewer requests in flight is fine, none is not */
+	if (list_empty(&ctl->idle_reqs)) {
+		kfree(ctl);
+		return NULL;
+	}
+	return ctl;
+}
+
+static void zram_writeback_endio(struct bio *bio)
+{
+	struct zram_wb_req *req = container_of(bio, struct zram_wb_req, bio);
+	struct zram_wb_ctl *ctl = bio->bi_private;
+	unsigned long flags;
+
+	/* the waiter frees @ctl once it has seen num_inflight drop to 0 */
+	spin_lock_irqsave(&ctl->done_lock, flags);
+	list_add_tail(&req->entry, &ctl->done_reqs);
+	ctl->num_inflight--;
+	wake_up(&ctl->done_wait);
+	spin_unlock_irqrestore(&ctl->done_lock, flags);
+}
+
+static void zram_wb_limit_add(struct zram *zram, long delta)
+{
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable) {
+		if (delta < 0 && zram->bd_wb_limit < -delta)
+			zram->bd_wb_limit = 0;
+		else
+			zram->bd_wb_limit += delta;
+	}
+	spin_unlock(&zram->wb_limit_lock);
+}
+
+/* Finish a written back slot, returns the bio error or 0 */
+static int zram_writeback_complete(struct zram *zram, struct zram_wb_req *req)
+{
+	u32 index = req->index;
+	int err;
+
+	err = blk_status_to_errno(req->bio.bi_status);
+	zram_slot_lock(zram, index);
+	if (err) {
+		/*
+		 * BIO errors are not fatal, we continue and simply attempt to
+		 * writeback the remaining objects (pages).  The block is kept
+		 * by the request to be tried again for the next slot.
+		 */
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+		goto out;
+	}
+
+	atomic64_inc(&zram->stats.bd_writes);
+	/*
+	 * We released zram_slot_lock so need to check if the slot was
+	 * changed. If there is freeing for the slot, we can catch it
+	 * easily by zram_allocated.
+	 * A subtle case is the slot is freed/reallocated/marked as
+	 * ZRAM_IDLE again. To close the race, idle_store doesn't
+	 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+	 * Thus, we could close the race by checking ZRAM_IDLE bit.
+	 */
+	if (!zram_allocated(zram, index) ||
+	    !zram_test_flag(zram, index, ZRAM_IDLE)) {
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+		goto out;
+	}
+
+	zram_free_page(zram, index);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_set_flag(zram, index, ZRAM_WB);
+	zram_set_element(zram, index, req->blk_idx);
+	req->blk_idx = 0;
+	atomic64_inc(&zram->stats.pages_stored);
+out:
+	zram_slot_unlock(zram, index);
+	/* refund the limit charged at submission for slots not written back */
+	if (req->blk_idx)
+		zram_wb_limit_add(zram, 1UL << (PAGE_SHIFT - 12));
+	return err;
+}
+
+/*
+ * Finish all completed requests in one go and return them to the idle list.
+ * Waits for a completion first if @wait and none is idle yet.
+ */
+static int zram_wb_reap(struct zram *zram, struct zram_wb_ctl *ctl, bool wait)
+{
+	LIST_HEAD(done);
+	struct zram_wb_req *req, *tmp;
+	int err, ret = 0;
+
+	if (wait)
+		wait_event(ctl->done_wait, !list_empty(&ctl->done_reqs));
+
+	spin_lock_irq(&ctl->done_lock);
+	list_splice_init(&ctl->done_reqs, &done);
+	spin_unlock_irq(&ctl->done_lock);
+
+	list_for_each_entry_safe(req, tmp, &done, entry) {
+		err = zram_writeback_complete(zram, req);
+		if (err)
+			ret = err;
+		list_move(&req->entry, &ctl->idle_reqs);
+	}
+	return ret;
+}
+
+/* Sleep until @units submitted since @start fit the rate limit */
+static void zram_wb_throttle(struct zram *zram, u64 start, u64 units)
+{
+	u32 rate = READ_ONCE(zram->wb_rate_limit);
+	u64 due, now;
+
+	if (!rate)
+		return;
+
+	due = start + div_u64(units * NSEC_PER_SEC, rate);
+	now = ktime_get_ns();
+	if (due > now)
+		fsleep(div_u64(due - now, NSEC_PER_USEC));
+}
+
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	const unsigned long units = 1UL << (PAGE_SHIFT - 12);
 	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_ctl *ctl;
+	struct zram_wb_req *req;
+	struct blk_plug plug;
+	u64 start, submitted = 0;
 	ssize_t ret = len;
 	int mode, err;
-	unsigned long blk_idx = 0;
 
 	if (sysfs_streq(buf, "idle"))
 		mode = IDLE_WRITEBACK;
@@ -630,13 +863,17 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	ctl = zram_wb_ctl_alloc(zram, min_t(unsigned long, nr_pages,
+					    READ_ONCE(zram->wb_batch_size)));
+	if (!ctl) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
 
+	start = ktime_get_ns();
+	blk_start_plug(&plug);
 	for (; nr_pages != 0; index++, nr_pages--) {
+		/* charge the limit now, completion refunds what wasn't written */
 		spin_lock(&zram->wb_limit_lock);
 		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
 			spin_unlock(&zram->wb_limit_lock);
@@ -645,9 +882,17 @@ static ssize_t writeback_store(struct device *dev,
 		}
 		spin_unlock(&zram->wb_limit_lock);
 
-		if (!blk_idx) {
-			blk_idx = alloc_block_bdev(zram);
-			if (!blk_idx) {
+		if (list_empty(&ctl->idle_reqs)) {
+			err = zram_wb_reap(zram, ctl, true);
+			if (err)
+				ret = err;
+		}
+		req = list_first_entry(&ctl->idle_reqs, struct zram_wb_req,
+				       entry);
+
+		if (!req->blk_idx) {
+			req->blk_idx = alloc_block_bdev(zram);
+			if (!req->blk_idx) {
 				ret = -ENOSPC;
 				break;
 			}
@@ -680,7 +925,7 @@ static ssize_t writeback_store(struct device *dev,
 		/* Need for hugepage writeback racing */
 		zram_set_flag(zram, index, ZRAM_IDLE);
 		zram_slot_unlock(zram, index);
-		if (zram_read_page(zram, page, index, NULL)) {
+		if (zram_read_page(zram, req->page, index, NULL)) {
 			zram_slot_lock(zram, index);
 			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 			zram_clear_flag(zram, index, ZRAM_IDLE);
@@ -688,68 +933,42 @@ static ssize_t writeback_store(struct device *dev,
 			continue;
 		}
 
-		bio_init(&bio, zram->bdev, &bio_vec, 1,
-			 REQ_OP_WRITE | REQ_SYNC);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		__bio_add_page(&bio, page, PAGE_SIZE, 0);
-
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			/*
-			 * BIO errors are not fatal, we continue and simply
-			 * attempt to writeback the remaining objects (pages).
-			 * At the same time we need to signal user-space that
-			 * some writes (at least one, but also could be all of
-			 * them) were not successful and we do so by returning
-			 * the most recent BIO error.
-			 */
-			ret = err;
-			continue;
-		}
+		zram_wb_throttle(zram, start, submitted);
+		zram_wb_limit_add(zram, -(long)units);
 
-		atomic64_inc(&zram->stats.bd_writes);
 		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
+		 * The requests are plugged and completed asynchronously, so
+		 * writes to adjacent blocks get merged by the block layer.
 		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
-		}
-
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
-		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+		req->index = index;
+		bio_init(&req->bio, zram->bdev, &req->bio_vec, 1,
+			 REQ_OP_WRITE | REQ_SYNC);
+		req->bio.bi_iter.bi_sector = req->blk_idx * (PAGE_SIZE >> 9);
+		req->bio.bi_end_io = zram_writeback_endio;
+		req->bio.bi_private = ctl;
+		__bio_add_page(&req->bio, req->page, PAGE_SIZE, 0);
+
+		list_del(&req->entry);
+		spin_lock_irq(&ctl->done_lock);
+		ctl->num_inflight++;
+		spin_unlock_irq(&ctl->done_lock);
+		submit_bio(&req->bio);
+		submitted += units;
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
+	blk_finish_plug(&plug);
 
-	if (blk_idx)
-		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+	spin_lock_irq(&ctl->done_lock);
+	wait_event_lock_irq(ctl->done_wait, !ctl->num_inflight,
+			    ctl->done_lock);
+	spin_unlock_irq(&ctl->done_lock);
+	err = zram_wb_reap(zram, ctl, false);
+	if (err)
+		ret = err;
+
+	zram_wb_ctl_free(zram, ctl);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -1697,17 +1916,69 @@ static int zram_recompress(struct zram *zram, u32 index, struct page *page,
 #define RECOMPRESS_IDLE		(1 << 0)
 #define RECOMPRESS_HUGE		(1 << 1)
 
+/*
+ * Walk all slots and recompress those matching @mode, until the table ends
+ * or @num_recomp_pages attempts have been made.
+ * Callers should hold the zram init lock in read mode.
+ */
+static int zram_recompress_slots(struct zram *zram, struct page *page,
+				 u32 mode, u32 threshold, u32 prio,
+				 u32 prio_max, u64 *num_recomp_pages)
+{
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+
+	for (index = 0; index < nr_pages; index++) {
+		int err = 0;
+
+		if (!*num_recomp_pages)
+			break;
+
+		zram_slot_lock(zram, index);
+
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		if (mode & RECOMPRESS_IDLE &&
+		    !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+
+		if (mode & RECOMPRESS_HUGE &&
+		    !zram_test_flag(zram, index, ZRAM_HUGE))
+			goto next;
+
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+		    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+		    zram_test_flag(zram, index, ZRAM_SAME) ||
+		    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+			goto next;
+
+		/* Nothing left to try, don't decompress it for nothing */
+		if (zram_get_priority(zram, index) + 1 >= prio_max)
+			goto next;
+
+		err = zram_recompress(zram, index, page, num_recomp_pages,
+				      threshold, prio, prio_max);
+next:
+		zram_slot_unlock(zram, index);
+		if (err)
+			return err;
+
+		cond_resched();
+	}
+
+	return 0;
+}
+
 static ssize_t recompress_store(struct device *dev,
 				struct device_attribute *attr,
 				const char *buf, size_t len)
 {
 	u32 prio = ZRAM_SECONDARY_COMP, prio_max = ZRAM_MAX_COMPS;
 	struct zram *zram = dev_to_zram(dev);
-	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	char *args, *param, *val, *algo = NULL;
 	u64 num_recomp_pages = ULLONG_MAX;
 	u32 mode = 0, threshold = 0;
-	unsigned long index;
 	struct page *page;
 	ssize_t ret;
 
@@ -1791,50 +2062,108 @@ static ssize_t recompress_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	ret = len;
-	for (index = 0; index < nr_pages; index++) {
-		int err = 0;
+	ret = zram_recompress_slots(zram, page, mode, threshold, prio,
+				    prio_max, &num_recomp_pages);
+	if (!ret)
+		ret = len;
 
-		if (!num_recomp_pages)
-			break;
+	__free_page(page);
 
-		zram_slot_lock(zram, index);
+release_init_lock:
+	up_read(&zram->init_lock);
+	return ret;
+}
 
-		if (!zram_allocated(zram, index))
-			goto next;
+#ifdef CONFIG_ZRAM_TRACK_ENTRY_ACTIME
+static struct workqueue_struct *zram_recomp_wq;
 
-		if (mode & RECOMPRESS_IDLE &&
-		    !zram_test_flag(zram, index, ZRAM_IDLE))
-			goto next;
+/* Upper bound on recompression attempts per background pass */
+#define ZRAM_RECOMP_BATCH_PAGES	4096
 
-		if (mode & RECOMPRESS_HUGE &&
-		    !zram_test_flag(zram, index, ZRAM_HUGE))
-			goto next;
+/*
+ * Periodically mark slots which were not accessed for recomp_idle_age
+ * seconds as idle and recompress them with the secondary algorithms. The
+ * CPUs this runs on can be restricted through the cpumask of the
+ * "zram_recomp" workqueue in sysfs.
+ */
+static void zram_recomp_work(struct work_struct *work)
+{
+	struct zram *zram = container_of(to_delayed_work(work), struct zram,
+					 recomp_work);
+	u32 age = READ_ONCE(zram->recomp_idle_age);
+	u64 num_recomp_pages = ZRAM_RECOMP_BATCH_PAGES;
+	u32 prio, prio_max = 0;
+	struct page *page;
 
-		if (zram_test_flag(zram, index, ZRAM_WB) ||
-		    zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
-		    zram_test_flag(zram, index, ZRAM_SAME) ||
-		    zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
-			goto next;
+	if (!age)
+		return;
 
-		err = zram_recompress(zram, index, page, &num_recomp_pages,
-				      threshold, prio, prio_max);
-next:
-		zram_slot_unlock(zram, index);
-		if (err) {
-			ret = err;
-			break;
-		}
+	down_read(&zram->init_lock);
+	if (!init_done(zram))
+		goto out;
 
-		cond_resched();
+	for (prio = ZRAM_SECONDARY_COMP; prio < ZRAM_MAX_COMPS; prio++) {
+		if (zram->comps[prio])
+			prio_max = prio + 1;
 	}
+	if (!prio_max)
+		goto out;
 
-	__free_page(page);
+	page = alloc_page(GFP_KERNEL);
+	if (!page)
+		goto out;
 
-release_init_lock:
+	mark_idle(zram, ktime_sub(ktime_get_boottime(),
+				  ns_to_ktime((u64)age * NSEC_PER_SEC)));
+	zram_recompress_slots(zram, page, RECOMPRESS_IDLE, 0,
+			      ZRAM_SECONDARY_COMP, prio_max, &num_recomp_pages);
+	__free_page(page);
+out:
 	up_read(&zram->init_lock);
-	return ret;
+	queue_delayed_work(zram_recomp_wq, &zram->recomp_work,
+			   msecs_to_jiffies(age * MSEC_PER_SEC));
+}
+
+static ssize_t recomp_idle_age_show(struct device *dev,
+				    struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(zram->recomp_idle_age));
+}
+
+static ssize_t recomp_idle_age_store(struct device *dev,
+				     struct device_attribute *attr,
+				     const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	u32 age;
+	int ret;
+
+	ret = kstrtouint(buf, 10, &age);
+	if (ret)
+		return ret;
+
+	WRITE_ONCE(zram->recomp_idle_age, age);
+	if (age)
+		mod_delayed_work(zram_recomp_wq, &zram->recomp_work,
+				 msecs_to_jiffies(age * MSEC_PER_SEC));
+	else
+		cancel_delayed_work_sync(&zram->recomp_work);
+
+	return len;
+}
+
+static void zram_recomp_stop(struct zram *zram)
+{
+	WRITE_ONCE(zram->recomp_idle_age, 0);
+	cancel_delayed_work_sync(&zram->recomp_work);
 }
+#else
+static inline void zram_recomp_stop(struct zram *zram) {}
+#endif
+#else
+static inline void zram_recomp_stop(struct zram *zram) {}
 #endif
 
 static void zram_bio_discard(struct zram *zram, struct bio *bio)
@@ -1993,6 +2322,8 @@ static void zram_destroy_comps(struct zram *zram)
 
 static void zram_reset_device(struct zram *zram)
 {
+	zram_recomp_stop(zram);
+
 	down_write(&zram->init_lock);
 
 	zram->limit_pages = 0;
@@ -2144,10 +2475,15 @@ static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
 static DEVICE_ATTR_RW(writeback_limit);
 static DEVICE_ATTR_RW(writeback_limit_enable);
+static DEVICE_ATTR_RW(writeback_batch_size);
+static DEVICE_ATTR_RW(writeback_rate_limit);
 #endif
 #ifdef CONFIG_ZRAM_MULTI_COMP
 static DEVICE_ATTR_RW(recomp_algorithm);
 static DEVICE_ATTR_WO(recompress);
+#ifdef CONFIG_ZRAM_TRACK_ENTRY_ACTIME
+static DEVICE_ATTR_RW(recomp_idle_age);
+#endif
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -2165,6 +2501,8 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_writeback.attr,
 	&dev_attr_writeback_limit.attr,
 	&dev_attr_writeback_limit_enable.attr,
+	&dev_attr_writeback_batch_size.attr,
+	&dev_attr_writeback_rate_limit.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
@@ -2175,6 +2513,9 @@ static struct attribute *zram_disk_attrs[] = {
 #ifdef CONFIG_ZRAM_MULTI_COMP
 	&dev_attr_recomp_algorithm.attr,
 	&dev_attr_recompress.attr,
+#ifdef CONFIG_ZRAM_TRACK_ENTRY_ACTIME
+	&dev_attr_recomp_idle_age.attr,
+#endif
 #endif
 	NULL,
 };
@@ -2226,6 +2567,10 @@ static int zram_add(void)
 	init_rwsem(&zram->init_lock);
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
+	zram->wb_batch_size = ZRAM_WB_DEFAULT_BATCH;
+#endif
+#if defined(CONFIG_ZRAM_MULTI_COMP) && defined(CONFIG_ZRAM_TRACK_ENTRY_ACTIME)
+	INIT_DELAYED_WORK(&zram->recomp_work, zram_recomp_work);
 #endif
 
 	/* gendisk structure */
@@ -2396,6 +2741,9 @@ static void destroy_devices(void)
 	zram_debugfs_destroy();
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
+#if defined(CONFIG_ZRAM_MULTI_COMP) && defined(CONFIG_ZRAM_TRACK_ENTRY_ACTIME)
+	destroy_workqueue(zram_recomp_wq);
+#endif
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 }
 
@@ -2417,10 +2765,24 @@ static int __init zram_init(void)
 		return ret;
 	}
 
+#if defined(CONFIG_ZRAM_MULTI_COMP) && defined(CONFIG_ZRAM_TRACK_ENTRY_ACTIME)
+	zram_recomp_wq = alloc_workqueue("zram_recomp",
+					 WQ_UNBOUND | WQ_FREEZABLE | WQ_SYSFS,
+					 0);
+	if (!zram_recomp_wq) {
+		class_unregister(&zram_control_class);
+		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		return -ENOMEM;
+	}
+#endif
+
 	zram_debugfs_create();
 	zram_major = register_blkdev(0, "zram");
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
+#if defined(CONFIG_ZRAM_MULTI_COMP) && defined(CONFIG_ZRAM_TRACK_ENTRY_ACTIME)
+		destroy_workqueue(zram_recomp_wq);
+#endif
 		class_unregister(&zram_control_class);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return -EBUSY;
@@ -135,9 +135,17 @@ struct zram {
 	struct block_device *bdev;
 	unsigned long *bitmap;
 	unsigned long nr_pages;
+	/* writeback requests in flight, and their rate in 4K units/sec */
+	u32 wb_batch_size;
+	u32 wb_rate_limit;
 #endif
 #ifdef CONFIG_ZRAM_MEMORY_TRACKING
 	struct dentry *debugfs_dir;
 #endif
+#if defined(CONFIG_ZRAM_MULTI_COMP) && defined(CONFIG_ZRAM_TRACK_ENTRY_ACTIME)
+	/* background recompression of slots idle for recomp_idle_age seconds */
+	struct delayed_work recomp_work;
+	u32 recomp_idle_age;
+#endif
 };
 #endif
@@ -71,8 +71,12 @@ static int mhi_debugfs_events_show(struct seq_file *m, void *d)
 		seq_printf(m, " rp: 0x%llx wp: 0x%llx", le64_to_cpu(er_ctxt->rp),
 			   le64_to_cpu(er_ctxt->wp));
 
-		seq_printf(m, " local rp: 0x%pK db: 0x%pad\n", ring->rp,
+		seq_printf(m, " local rp: 0x%pK db: 0x%pad", ring->rp,
 			   &mhi_event->db_cfg.db_val);
+
+		seq_printf(m, " runs: %llu events: %llu budget exhausted: %llu\n",
+			   mhi_event->stats.runs, mhi_event->stats.events,
+			   mhi_event->stats.budget_exhausted);
 	}
 
 	return 0;
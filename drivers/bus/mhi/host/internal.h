@@ -229,6 +229,13 @@ struct mhi_buf_info {
 	bool pre_mapped; /* Already pre-mapped by client */
 };
 
+/* Data event ring processing statistics, updated from the ring tasklet */
+struct mhi_event_stats {
+	u64 runs;
+	u64 events;
+	u64 budget_exhausted;
+};
+
 struct mhi_event {
 	struct mhi_controller *mhi_cntrl;
 	struct mhi_chan *mhi_chan; /* dedicated to channel */
@@ -241,6 +248,7 @@ struct mhi_event {
 	struct mhi_ring ring;
 	struct db_cfg db_cfg;
 	struct tasklet_struct task;
+	struct mhi_event_stats stats;
 	spinlock_t lock;
 	int (*process_event)(struct mhi_controller *mhi_cntrl,
 			     struct mhi_event *mhi_event,
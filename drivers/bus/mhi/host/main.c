@@ -17,6 +17,11 @@
 #include "internal.h"
 #include "trace.h"
 
+static unsigned int ev_budget;
+module_param(ev_budget, uint, 0644);
+MODULE_PARM_DESC(ev_budget,
+		 "Max events processed per data event ring run (0 = unlimited)");
+
 int __must_check mhi_read_reg(struct mhi_controller *mhi_cntrl,
 			      void __iomem *base, u32 offset, u32 *out)
 {
@@ -1054,10 +1059,27 @@ void mhi_ev_task(unsigned long data)
 	struct mhi_event *mhi_event = (struct mhi_event *)data;
 	struct mhi_controller *mhi_cntrl = mhi_event->mhi_cntrl;
 
-	/* process all pending events */
+	u32 budget = READ_ONCE(ev_budget) ?: U32_MAX;
+	int ret;
+
+	/*
+	 * Process up to budget events. If the budget is exhausted there may be
+	 * more pending, so reschedule rather than monopolize the softirq and
+	 * let ksoftirqd pick up the remainder under sustained load.
+	 */
 	spin_lock_bh(&mhi_event->lock);
-	mhi_event->process_event(mhi_cntrl, mhi_event, U32_MAX);
+	ret = mhi_event->process_event(mhi_cntrl, mhi_event, budget);
 	spin_unlock_bh(&mhi_event->lock);
+
+	mhi_event->stats.runs++;
+	if (ret <= 0)
+		return;
+
+	mhi_event->stats.events += ret;
+	if (ret >= budget) {
+		mhi_event->stats.budget_exhausted++;
+		tasklet_schedule(&mhi_event->task);
+	}
 }
 
 void mhi_ctrl_ev_task(unsigned long data)
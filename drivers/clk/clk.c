@@ -571,8 +571,9 @@ static unsigned long clk_core_get_rate_nolock(struct clk_core *core)
 	if (!core)
 		return 0;
 
-	if (!core->num_parents || core->parent)
-		return core->rate;
+	/* May be called without prepare_lock, see clk_get_rate() */
+	if (!core->num_parents || READ_ONCE(core->parent))
+		return READ_ONCE(core->rate);
 
 	/*
 	 * Clk must have a parent because num_parents > 0 but the parent isn't
@@ -1966,7 +1967,7 @@ static void __clk_recalc_rates(struct clk_core *core, bool update_req,
 	if (core->parent)
 		parent_rate = core->parent->rate;
 
-	core->rate = clk_recalc(core, parent_rate);
+	WRITE_ONCE(core->rate, clk_recalc(core, parent_rate));
 	if (update_req)
 		core->req_rate = core->rate;
 
@@ -1997,6 +1998,10 @@ static unsigned long clk_core_get_rate_recalc(struct clk_core *core)
  * is set, which means a recalc_rate will be issued. Can be called regardless of
  * the clock enabledness. If clk is NULL, or if an error occurred, then returns
  * 0.
+ *
+ * The cached rate is read without taking prepare_lock. A rate change that is
+ * in progress may therefore be observed either before or after it lands, the
+ * same as if the caller had raced with the lock holder.
  */
 unsigned long clk_get_rate(struct clk *clk)
 {
@@ -2005,6 +2010,9 @@ unsigned long clk_get_rate(struct clk *clk)
 	if (!clk)
 		return 0;
 
+	if (!(clk->core->flags & CLK_GET_RATE_NOCACHE))
+		return clk_core_get_rate_nolock(clk->core);
+
 	clk_prepare_lock();
 	rate = clk_core_get_rate_recalc(clk->core);
 	clk_prepare_unlock();
@@ -2110,7 +2118,7 @@ static void clk_reparent(struct clk_core *core, struct clk_core *new_parent)
 			clk_core_update_orphan_status(core, true);
 	}
 
-	core->parent = new_parent;
+	WRITE_ONCE(core->parent, new_parent);
 }
 
 static struct clk_core *__clk_set_parent_before(struct clk_core *core,
@@ -2459,7 +2467,7 @@ static void clk_change_rate(struct clk_core *core)
 
 	trace_clk_set_rate_complete(core, core->new_rate);
 
-	core->rate = clk_recalc(core, best_parent_rate);
+	WRITE_ONCE(core->rate, clk_recalc(core, best_parent_rate));
 
 	if (core->flags & CLK_SET_RATE_UNGATE) {
 		clk_core_disable_lock(core);
@@ -23,6 +23,7 @@
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/syscore_ops.h>
+#include <linux/workqueue.h>
 
 #include <asm/cpuidle.h>
 
@@ -316,6 +317,67 @@ static void psci_cpu_deinit_idle(int cpu)
 	psci_cpuidle_use_cpuhp = false;
 }
 
+static void psci_idle_calibrate(void)
+{
+	struct cpuidle_driver *drv;
+	int cpu, ret;
+
+	for_each_online_cpu(cpu) {
+		drv = cpuidle_get_cpu_driver(per_cpu(cpuidle_devices, cpu));
+		if (!drv)
+			continue;
+
+		ret = dt_calibrate_idle_driver(drv, cpu, 1);
+		if (ret)
+			pr_warn("CPU %d idle states calibration failed: %d\n",
+				cpu, ret);
+	}
+}
+
+static void psci_idle_calibrate_fn(struct work_struct *work)
+{
+	psci_idle_calibrate();
+}
+
+static DECLARE_WORK(psci_idle_calibrate_work, psci_idle_calibrate_fn);
+static bool psci_idle_calibrate_boot;
+
+static int psci_idle_calibrate_set(const char *val,
+				   const struct kernel_param *kp)
+{
+	bool calibrate;
+	int ret;
+
+	ret = kstrtobool(val, &calibrate);
+	if (ret)
+		return ret;
+
+	/* Before the driver probes, only remember to calibrate at probe time. */
+	if (system_state < SYSTEM_RUNNING) {
+		psci_idle_calibrate_boot = calibrate;
+		return 0;
+	}
+
+	if (calibrate)
+		psci_idle_calibrate();
+
+	return 0;
+}
+
+static const struct kernel_param_ops psci_idle_calibrate_ops = {
+	.set = psci_idle_calibrate_set,
+	.get = param_get_bool,
+};
+
+/*
+ * Measure the real exit latency of the PSCI idle states and update the values
+ * parsed from DT, either at boot with cpuidle_psci.calibrate=1 or on demand by
+ * writing 1 to the parameter.
+ */
+module_param_cb(calibrate, &psci_idle_calibrate_ops,
+		&psci_idle_calibrate_boot, 0644);
+MODULE_PARM_DESC(calibrate, "Calibrate idle state latencies (at boot, or on write)");
+
 static int psci_idle_init_cpu(struct device *dev, int cpu)
 {
 	struct cpuidle_driver *drv;
@@ -410,6 +472,10 @@ static int psci_cpuidle_probe(struct platform_device *pdev)
 	}
 
 	psci_idle_init_cpuhp();
+
+	if (psci_idle_calibrate_boot)
+		queue_work(system_unbound_wq, &psci_idle_calibrate_work);
+
 	return 0;
 
 out_fail:
@@ -8,12 +8,19 @@
 
 #define pr_fmt(fmt) "DT idle-states: " fmt
 
+#include <linux/completion.h>
+#include <linux/cpu.h>
 #include <linux/cpuidle.h>
 #include <linux/cpumask.h>
 #include <linux/errno.h>
 #include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/of.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
 
 #include "dt_idle_states.h"
 
@@ -222,3 +229,152 @@ int dt_init_idle_driver(struct cpuidle_driver *drv,
 	return state_idx - start_idx;
 }
 EXPORT_SYMBOL_GPL(dt_init_idle_driver);
+
+/* Number of forced idle periods per state, the fastest wakeup is used. */
+#define DT_IDLE_CALIB_ITERS		16
+#define DT_IDLE_CALIB_MIN_DURATION_NS	(1 * NSEC_PER_MSEC)
+
+struct dt_idle_calib {
+	struct cpuidle_driver *drv;
+	unsigned int start_idx;
+	s64 wakeup_ns[CPUIDLE_STATE_MAX];
+	struct completion done;
+};
+
+/*
+ * Force the CPU idle for @duration_ns in the deepest state whose exit latency
+ * does not exceed @latency_ns and return by how much the wakeup overshot the
+ * requested duration.
+ */
+static s64 dt_idle_calib_measure(u64 duration_ns, u64 latency_ns)
+{
+	s64 best = S64_MAX, elapsed;
+	ktime_t start;
+	int i;
+
+	for (i = 0; i < DT_IDLE_CALIB_ITERS; i++) {
+		start = ktime_get();
+		play_idle_precise(duration_ns, latency_ns);
+		elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+		best = min(best, elapsed - (s64)duration_ns);
+	}
+
+	return best;
+}
+
+static int dt_idle_calib_thread(void *arg)
+{
+	struct dt_idle_calib *calib = arg;
+	struct cpuidle_driver *drv = calib->drv;
+	struct cpuidle_device *dev = __this_cpu_read(cpuidle_devices);
+	s64 baseline;
+	u64 duration;
+	int i;
+
+	sched_set_fifo(current);
+
+	/*
+	 * The overshoot of the shallowest state covers the timer and scheduling
+	 * overhead, which every other state pays for as well.
+	 */
+	baseline = dt_idle_calib_measure(DT_IDLE_CALIB_MIN_DURATION_NS, 0);
+
+	for (i = calib->start_idx; i < drv->state_count; i++) {
+		struct cpuidle_state *state = &drv->states[i];
+
+		calib->wakeup_ns[i] = -1;
+		if (dev && dev->states_usage[i].disable)
+			continue;
+
+		duration = max_t(u64, 2 * state->target_residency_ns,
+				 DT_IDLE_CALIB_MIN_DURATION_NS);
+		calib->wakeup_ns[i] = max_t(s64, 0,
+			dt_idle_calib_measure(duration, state->exit_latency_ns) - baseline);
+	}
+
+	complete(&calib->done);
+	return 0;
+}
+
+/**
+ * dt_calibrate_idle_driver() - Measure the idle states latencies of a CPU and
+ *				update the idle driver states accordingly
+ * @drv:	  Pointer to a registered CPU idle driver
+ * @cpu:	  CPU to run the measurement on, must be covered by @drv
+ * @start_idx:    First idle state index to be calibrated
+ *
+ * Repeatedly force @cpu into each idle state starting from @start_idx and
+ * measure how long it takes to wake up, relative to the shallowest state. The
+ * measured latency replaces the exit latency parsed from DT and the target
+ * residency is shifted by the same amount, so the break-even margin described
+ * in DT is kept. The states are expected to be sorted by increasing latency,
+ * which is preserved.
+ *
+ * Return: 0 on success, <0 on failure
+ */
+int dt_calibrate_idle_driver(struct cpuidle_driver *drv, int cpu,
+			     unsigned int start_idx)
+{
+	struct task_struct *tsk;
+	struct dt_idle_calib *calib;
+	s64 prev_ns = 0;
+	int i, ret = 0;
+
+	if (start_idx >= drv->state_count)
+		return 0;
+
+	calib = kzalloc(sizeof(*calib), GFP_KERNEL);
+	if (!calib)
+		return -ENOMEM;
+
+	calib->drv = drv;
+	calib->start_idx = start_idx;
+	init_completion(&calib->done);
+
+	cpus_read_lock();
+	if (!cpu_online(cpu)) {
+		ret = -ENODEV;
+		goto unlock;
+	}
+
+	tsk = kthread_create_on_cpu(dt_idle_calib_thread, calib, cpu,
+				    "idle_calib/%u");
+	if (IS_ERR(tsk)) {
+		ret = PTR_ERR(tsk);
+		goto unlock;
+	}
+
+	wake_up_process(tsk);
+	wait_for_completion(&calib->done);
+
+	for (i = start_idx; i < drv->state_count; i++) {
+		struct cpuidle_state *state = &drv->states[i];
+		s64 exit_ns, residency_ns;
+
+		if (calib->wakeup_ns[i] < 0)
+			continue;
+
+		exit_ns = max(calib->wakeup_ns[i], prev_ns);
+		residency_ns = state->target_residency_ns +
+			       (exit_ns - state->exit_latency_ns);
+		residency_ns = max(residency_ns, exit_ns);
+		prev_ns = exit_ns;
+
+		pr_info("CPU%d %s: exit latency %u -> %llu us, target residency %u -> %llu us\n",
+			cpu, state->name, state->exit_latency,
+			div_u64(exit_ns, NSEC_PER_USEC), state->target_residency,
+			div_u64(residency_ns, NSEC_PER_USEC));
+
+		WRITE_ONCE(state->exit_latency_ns, exit_ns);
+		WRITE_ONCE(state->target_residency_ns, residency_ns);
+		WRITE_ONCE(state->exit_latency, div_u64(exit_ns, NSEC_PER_USEC));
+		WRITE_ONCE(state->target_residency,
+			   div_u64(residency_ns, NSEC_PER_USEC));
+	}
+
+unlock:
+	cpus_read_unlock();
+	kfree(calib);
+	return ret;
+}
+EXPORT_SYMBOL_GPL(dt_calibrate_idle_driver);
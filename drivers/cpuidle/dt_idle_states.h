@@ -5,4 +5,6 @@
 int dt_init_idle_driver(struct cpuidle_driver *drv,
 			const struct of_device_id *matches,
 			unsigned int start_idx);
+int dt_calibrate_idle_driver(struct cpuidle_driver *drv, int cpu,
+			     unsigned int start_idx);
 #endif
@@ -11,6 +11,7 @@
 #include <linux/mod_devicetable.h>
 #include <linux/platform_device.h>
 #include <linux/spinlock.h>
+#include <linux/sysfs.h>
 #include <linux/types.h>
 #include <crypto/algapi.h>
 #include <crypto/internal/hash.h>
@@ -21,10 +22,23 @@
 #include "aead.h"
 
 #define QCE_MAJOR_VERSION5	0x05
-#define QCE_QUEUE_LENGTH	1
+#define QCE_QUEUE_LENGTH	32
 
 #define QCE_DEFAULT_MEM_BANDWIDTH	393600
 
+static unsigned int sw_threshold;
+module_param(sw_threshold, uint, 0644);
+MODULE_PARM_DESC(sw_threshold,
+		 "Requests shorter than this many bytes are handled by the fallback "
+		 "implementation instead of the crypto engine (0 = disabled)");
+
+static unsigned int sw_queue_depth;
+module_param(sw_queue_depth, uint, 0644);
+MODULE_PARM_DESC(sw_queue_depth,
+		 "Hand requests to the fallback implementation once this many "
+		 "requests are queued or in flight on the crypto engine "
+		 "(0 = disabled)");
+
 static const struct qce_algo_ops *qce_ops[] = {
 #ifdef CONFIG_CRYPTO_DEV_QCE_SKCIPHER
 	&skcipher_ops,
@@ -146,12 +160,88 @@ static int qce_async_request_enqueue(struct qce_device *qce,
 	return qce_handle_queue(qce, req);
 }
 
+/*
+ * Called from the DMA completion callback once the result dump has been
+ * consumed. Program the engine with the next queued request before running
+ * the completion of the finished one, so that the engine is not left idle
+ * for a tasklet round trip plus whatever the caller does in its callback.
+ */
 static void qce_async_request_done(struct qce_device *qce, int ret)
 {
-	qce->result = ret;
-	tasklet_schedule(&qce->done_tasklet);
+	struct crypto_async_request *req;
+	unsigned long flags;
+
+	spin_lock_irqsave(&qce->lock, flags);
+	req = qce->req;
+	qce->req = NULL;
+	spin_unlock_irqrestore(&qce->lock, flags);
+
+	qce_handle_queue(qce, NULL);
+
+	if (req)
+		crypto_request_complete(req, ret);
 }
 
+/*
+ * Decide whether a request that the engine could handle is better served by
+ * the CPU fallback: short requests are dominated by the BAM setup and round
+ * trip, and once the engine is backed up the CPU finishes sooner than the
+ * queue drains. The queue state is sampled without the lock, it is only a
+ * hint.
+ */
+bool qce_want_fallback(struct qce_device *qce, unsigned int len)
+{
+	unsigned int threshold = READ_ONCE(sw_threshold);
+	unsigned int depth = READ_ONCE(sw_queue_depth);
+
+	if (threshold && len < threshold)
+		return true;
+
+	if (depth && READ_ONCE(qce->queue.qlen) + !!READ_ONCE(qce->req) >= depth)
+		return true;
+
+	return false;
+}
+
+void qce_account_request(struct qce_device *qce, bool fallback,
+			 unsigned int len)
+{
+	struct qce_dispatch_stats *stats = &qce->stats;
+
+	if (fallback) {
+		atomic64_inc(&stats->sw_reqs);
+		atomic64_add(len, &stats->sw_bytes);
+	} else {
+		atomic64_inc(&stats->hw_reqs);
+		atomic64_add(len, &stats->hw_bytes);
+	}
+}
+
+#define QCE_STATS_ATTR(_name)						\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct qce_device *qce = dev_get_drvdata(dev);			\
+									\
+	return sysfs_emit(buf, "%lld\n",					\
+			  (long long)atomic64_read(&qce->stats._name));	\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+QCE_STATS_ATTR(hw_reqs);
+QCE_STATS_ATTR(hw_bytes);
+QCE_STATS_ATTR(sw_reqs);
+QCE_STATS_ATTR(sw_bytes);
+
+static struct attribute *qce_attrs[] = {
+	&dev_attr_hw_reqs.attr,
+	&dev_attr_hw_bytes.attr,
+	&dev_attr_sw_reqs.attr,
+	&dev_attr_sw_bytes.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(qce);
+
 static int qce_check_version(struct qce_device *qce)
 {
 	u32 major, minor, step;
@@ -303,6 +393,7 @@ static struct platform_driver qce_crypto_driver = {
 	.driver = {
 		.name = KBUILD_MODNAME,
 		.of_match_table = qce_crypto_of_match,
+		.dev_groups = qce_groups,
 	},
 };
 module_platform_driver(qce_crypto_driver);
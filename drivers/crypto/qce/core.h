@@ -8,6 +8,20 @@
 
 #include "dma.h"
 
+/**
+ * struct qce_dispatch_stats - per-path request statistics
+ * @hw_reqs: requests handed to the crypto engine
+ * @hw_bytes: payload bytes handed to the crypto engine
+ * @sw_reqs: requests completed by the fallback implementation
+ * @sw_bytes: payload bytes completed by the fallback implementation
+ */
+struct qce_dispatch_stats {
+	atomic64_t hw_reqs;
+	atomic64_t hw_bytes;
+	atomic64_t sw_reqs;
+	atomic64_t sw_bytes;
+};
+
 /**
  * struct qce_device - crypto engine device structure
  * @queue: crypto request queue
@@ -23,6 +37,7 @@
  * @dma: pointer to dma data
  * @burst_size: the crypto burst size
  * @pipe_pair_id: which pipe pair id the device using
+ * @stats: hardware/fallback dispatch statistics
  * @async_req_enqueue: invoked by every algorithm to enqueue a request
  * @async_req_done: invoked by every algorithm to finish its request
  */
@@ -39,6 +54,7 @@ struct qce_device {
 	struct qce_dma_data dma;
 	int burst_size;
 	unsigned int pipe_pair_id;
+	struct qce_dispatch_stats stats;
 	int (*async_req_enqueue)(struct qce_device *qce,
 				 struct crypto_async_request *req);
 	void (*async_req_done)(struct qce_device *qce, int ret);
@@ -58,4 +74,8 @@ struct qce_algo_ops {
 	int (*async_req_handle)(struct crypto_async_request *async_req);
 };
 
+bool qce_want_fallback(struct qce_device *qce, unsigned int len);
+void qce_account_request(struct qce_device *qce, bool fallback,
+			 unsigned int len);
+
 #endif /* _CORE_H_ */
@@ -260,6 +260,7 @@ static int qce_skcipher_crypt(struct skcipher_request *req, int encrypt)
 	struct qce_cipher_reqctx *rctx = skcipher_request_ctx(req);
 	struct qce_alg_template *tmpl = to_cipher_tmpl(tfm);
 	unsigned int blocksize = crypto_skcipher_blocksize(tfm);
+	bool fallback;
 	int keylen;
 	int ret;
 
@@ -286,12 +287,19 @@ static int qce_skcipher_crypt(struct skcipher_request *req, int encrypt)
 	 * AES-XTS request with len > QCE_SECTOR_SIZE and
 	 * is not a multiple of it.(Revisit this condition to check if it is
 	 * needed in all versions of CE)
+	 * AES request the dispatcher prefers to keep on the CPU (short
+	 * request or deep engine queue)
 	 */
-	if (IS_AES(rctx->flags) &&
-	    ((keylen != AES_KEYSIZE_128 && keylen != AES_KEYSIZE_256) ||
-	    (IS_XTS(rctx->flags) && ((req->cryptlen <= aes_sw_max_len) ||
-	    (req->cryptlen > QCE_SECTOR_SIZE &&
-	    req->cryptlen % QCE_SECTOR_SIZE))))) {
+	fallback = IS_AES(rctx->flags) &&
+		   ((keylen != AES_KEYSIZE_128 && keylen != AES_KEYSIZE_256) ||
+		   (IS_XTS(rctx->flags) && ((req->cryptlen <= aes_sw_max_len) ||
+		   (req->cryptlen > QCE_SECTOR_SIZE &&
+		   req->cryptlen % QCE_SECTOR_SIZE))) ||
+		   qce_want_fallback(tmpl->qce, req->cryptlen));
+
+	qce_account_request(tmpl->qce, fallback, req->cryptlen);
+
+	if (fallback) {
 		skcipher_request_set_tfm(&rctx->fallback_req, ctx->fallback);
 		skcipher_request_set_callback(&rctx->fallback_req,
 					      req->base.flags,
@@ -18,10 +18,13 @@
 #include <linux/mm.h>
 #include <linux/module.h>
 #include <linux/scatterlist.h>
+#include <linux/shrinker.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
 #include <linux/vmalloc.h>
 
 static struct dma_heap *sys_heap;
+static struct dma_heap *sys_uncached_heap;
 
 struct system_heap_buffer {
 	struct dma_heap *heap;
@@ -31,6 +34,7 @@ struct system_heap_buffer {
 	struct sg_table sg_table;
 	int vmap_cnt;
 	void *vaddr;
+	bool uncached;
 };
 
 struct dma_heap_attachment {
@@ -54,6 +58,96 @@ static gfp_t order_flags[] = {HIGH_ORDER_GFP, HIGH_ORDER_GFP, LOW_ORDER_GFP};
 static const unsigned int orders[] = {8, 4, 0};
 #define NUM_ORDERS ARRAY_SIZE(orders)
 
+/*
+ * Freed pages are kept in per-order pools, up to pool_max_kb, so that
+ * pipelines which keep allocating and freeing frame buffers do not go back
+ * to the buddy allocator every time. Pages are zeroed before they enter a
+ * pool, and the pools are drained by a shrinker under memory pressure.
+ */
+static unsigned long pool_max_kb;
+module_param(pool_max_kb, ulong, 0644);
+MODULE_PARM_DESC(pool_max_kb, "Maximum size of the free page pools in KiB (0 = no pooling)");
+
+struct system_heap_pool {
+	spinlock_t lock;
+	struct list_head pages;
+};
+
+static struct system_heap_pool pools[NUM_ORDERS];
+static atomic_long_t pool_nr_pages;
+static struct shrinker *pool_shrinker;
+
+static struct page *system_heap_pool_get(unsigned int i)
+{
+	struct system_heap_pool *pool = &pools[i];
+	struct page *page;
+
+	spin_lock(&pool->lock);
+	page = list_first_entry_or_null(&pool->pages, struct page, lru);
+	if (page) {
+		list_del(&page->lru);
+		atomic_long_sub(1 << orders[i], &pool_nr_pages);
+	}
+	spin_unlock(&pool->lock);
+
+	return page;
+}
+
+static bool system_heap_pool_put(struct page *page)
+{
+	unsigned int order = compound_order(page);
+	unsigned long max_pages = READ_ONCE(pool_max_kb) >> (PAGE_SHIFT - 10);
+	struct system_heap_pool *pool;
+	int i, j;
+
+	if (atomic_long_read(&pool_nr_pages) + (1 << order) > max_pages)
+		return false;
+
+	for (i = 0; i < NUM_ORDERS; i++)
+		if (orders[i] == order)
+			break;
+	if (i == NUM_ORDERS)
+		return false;
+
+	for (j = 0; j < (1 << order); j++)
+		clear_highpage(page + j);
+
+	pool = &pools[i];
+	spin_lock(&pool->lock);
+	list_add(&page->lru, &pool->pages);
+	atomic_long_add(1 << order, &pool_nr_pages);
+	spin_unlock(&pool->lock);
+
+	return true;
+}
+
+static unsigned long system_heap_pool_count(struct shrinker *shrinker,
+					    struct shrink_control *sc)
+{
+	return atomic_long_read(&pool_nr_pages) ?: SHRINK_EMPTY;
+}
+
+static unsigned long system_heap_pool_scan(struct shrinker *shrinker,
+					   struct shrink_control *sc)
+{
+	unsigned long freed = 0;
+	struct page *page;
+	int i;
+
+	/* Give back the largest blocks first */
+	for (i = 0; i < NUM_ORDERS && freed < sc->nr_to_scan; i++) {
+		while (freed < sc->nr_to_scan) {
+			page = system_heap_pool_get(i);
+			if (!page)
+				break;
+			__free_pages(page, orders[i]);
+			freed += 1 << orders[i];
+		}
+	}
+
+	return freed ?: SHRINK_STOP;
+}
+
 static struct sg_table *dup_sg_table(struct sg_table *table)
 {
 	struct sg_table *new_table;
@@ -128,11 +222,13 @@ static void system_heap_detach(struct dma_buf *dmabuf,
 static struct sg_table *system_heap_map_dma_buf(struct dma_buf_attachment *attachment,
 						enum dma_data_direction direction)
 {
+	struct system_heap_buffer *buffer = attachment->dmabuf->priv;
 	struct dma_heap_attachment *a = attachment->priv;
 	struct sg_table *table = a->table;
+	unsigned long attrs = buffer->uncached ? DMA_ATTR_SKIP_CPU_SYNC : 0;
 	int ret;
 
-	ret = dma_map_sgtable(attachment->dev, table, direction, 0);
+	ret = dma_map_sgtable(attachment->dev, table, direction, attrs);
 	if (ret)
 		return ERR_PTR(ret);
 
@@ -144,10 +240,12 @@ static void system_heap_unmap_dma_buf(struct dma_buf_attachment *attachment,
 				      struct sg_table *table,
 				      enum dma_data_direction direction)
 {
+	struct system_heap_buffer *buffer = attachment->dmabuf->priv;
 	struct dma_heap_attachment *a = attachment->priv;
+	unsigned long attrs = buffer->uncached ? DMA_ATTR_SKIP_CPU_SYNC : 0;
 
 	a->mapped = false;
-	dma_unmap_sgtable(attachment->dev, table, direction, 0);
+	dma_unmap_sgtable(attachment->dev, table, direction, attrs);
 }
 
 static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
@@ -156,6 +254,10 @@ static int system_heap_dma_buf_begin_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	/* CPU mappings of uncached buffers bypass the cache */
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -177,6 +279,10 @@ static int system_heap_dma_buf_end_cpu_access(struct dma_buf *dmabuf,
 	struct system_heap_buffer *buffer = dmabuf->priv;
 	struct dma_heap_attachment *a;
 
+	/* CPU mappings of uncached buffers bypass the cache */
+	if (buffer->uncached)
+		return 0;
+
 	mutex_lock(&buffer->lock);
 
 	if (buffer->vmap_cnt)
@@ -200,6 +306,9 @@ static int system_heap_mmap(struct dma_buf *dmabuf, struct vm_area_struct *vma)
 	struct sg_page_iter piter;
 	int ret;
 
+	if (buffer->uncached)
+		vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+
 	for_each_sgtable_page(table, &piter, vma->vm_pgoff) {
 		struct page *page = sg_page_iter_page(&piter);
 
@@ -231,7 +340,9 @@ static void *system_heap_do_vmap(struct system_heap_buffer *buffer)
 		*tmp++ = sg_page_iter_page(&piter);
 	}
 
-	vaddr = vmap(pages, npages, VM_MAP, PAGE_KERNEL);
+	vaddr = vmap(pages, npages, VM_MAP,
+		     buffer->uncached ? pgprot_writecombine(PAGE_KERNEL) :
+					PAGE_KERNEL);
 	vfree(pages);
 
 	if (!vaddr)
@@ -292,7 +403,8 @@ static void system_heap_dma_buf_release(struct dma_buf *dmabuf)
 	for_each_sgtable_sg(table, sg, i) {
 		struct page *page = sg_page(sg);
 
-		__free_pages(page, compound_order(page));
+		if (!system_heap_pool_put(page))
+			__free_pages(page, compound_order(page));
 	}
 	sg_free_table(table);
 	kfree(buffer);
@@ -323,6 +435,9 @@ static struct page *alloc_largest_available(unsigned long size,
 		if (max_order < orders[i])
 			continue;
 
+		page = system_heap_pool_get(i);
+		if (page)
+			return page;
 		page = alloc_pages(order_flags[i], orders[i]);
 		if (!page)
 			continue;
@@ -331,10 +446,11 @@ static struct page *alloc_largest_available(unsigned long size,
 	return NULL;
 }
 
-static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
-					    unsigned long len,
-					    u32 fd_flags,
-					    u64 heap_flags)
+static struct dma_buf *system_heap_do_allocate(struct dma_heap *heap,
+					       unsigned long len,
+					       u32 fd_flags,
+					       u64 heap_flags,
+					       bool uncached)
 {
 	struct system_heap_buffer *buffer;
 	DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
@@ -355,6 +471,7 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	mutex_init(&buffer->lock);
 	buffer->heap = heap;
 	buffer->len = len;
+	buffer->uncached = uncached;
 
 	INIT_LIST_HEAD(&pages);
 	i = 0;
@@ -389,6 +506,19 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 		list_del(&page->lru);
 	}
 
+	/*
+	 * Uncached buffers are never synced on map, so write back and
+	 * invalidate the zeroed pages once here.
+	 */
+	if (uncached) {
+		ret = dma_map_sgtable(dma_heap_get_dev(heap), table,
+				      DMA_BIDIRECTIONAL, 0);
+		if (ret)
+			goto free_pages;
+		dma_unmap_sgtable(dma_heap_get_dev(heap), table,
+				  DMA_BIDIRECTIONAL, 0);
+	}
+
 	/* create the dmabuf */
 	exp_info.exp_name = dma_heap_get_name(heap);
 	exp_info.ops = &system_heap_buf_ops;
@@ -417,13 +547,47 @@ static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
 	return ERR_PTR(ret);
 }
 
+static struct dma_buf *system_heap_allocate(struct dma_heap *heap,
+					    unsigned long len,
+					    u32 fd_flags,
+					    u64 heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, false);
+}
+
+static struct dma_buf *system_uncached_heap_allocate(struct dma_heap *heap,
+						     unsigned long len,
+						     u32 fd_flags,
+						     u64 heap_flags)
+{
+	return system_heap_do_allocate(heap, len, fd_flags, heap_flags, true);
+}
+
 static const struct dma_heap_ops system_heap_ops = {
 	.allocate = system_heap_allocate,
 };
 
+static const struct dma_heap_ops system_uncached_heap_ops = {
+	.allocate = system_uncached_heap_allocate,
+};
+
 static int system_heap_create(void)
 {
 	struct dma_heap_export_info exp_info;
+	int i;
+
+	for (i = 0; i < NUM_ORDERS; i++) {
+		spin_lock_init(&pools[i].lock);
+		INIT_LIST_HEAD(&pools[i].pages);
+	}
+
+	pool_shrinker = shrinker_alloc(0, "dma-buf-system-heap");
+	if (!pool_shrinker)
+		return -ENOMEM;
+
+	pool_shrinker->count_objects = system_heap_pool_count;
+	pool_shrinker->scan_objects = system_heap_pool_scan;
+	shrinker_register(pool_shrinker);
 
 	exp_info.name = "system";
 	exp_info.ops = &system_heap_ops;
@@ -433,6 +597,17 @@ static int system_heap_create(void)
 	if (IS_ERR(sys_heap))
 		return PTR_ERR(sys_heap);
 
+	exp_info.name = "system-uncached";
+	exp_info.ops = &system_uncached_heap_ops;
+
+	sys_uncached_heap = dma_heap_add(&exp_info);
+	if (IS_ERR(sys_uncached_heap))
+		return PTR_ERR(sys_uncached_heap);
+
+	/* The heap device is only used for the cache maintenance at alloc */
+	dma_coerce_mask_and_coherent(dma_heap_get_dev(sys_uncached_heap),
+				     DMA_BIT_MASK(64));
+
 	return 0;
 }
 module_init(system_heap_create);
@@ -344,6 +344,11 @@ static const struct reg_offset_data bam_v1_7_reg_info[] = {
 #define IS_BUSY(chan)	(CIRC_SPACE(bchan->tail, bchan->head,\
 			 MAX_DESCRIPTORS + 1) == 0)
 
+static unsigned int irq_coalesce;
+module_param(irq_coalesce, uint, 0644);
+MODULE_PARM_DESC(irq_coalesce,
+		 "Max completion callbacks deferred to a later descriptor's interrupt (0 = interrupt per callback)");
+
 struct bam_chan {
 	struct virt_dma_chan vc;
 
@@ -1022,6 +1027,8 @@ static void bam_start_dma(struct bam_chan *bchan)
 					sizeof(struct bam_desc_hw));
 	int ret;
 	unsigned int avail;
+	unsigned int coalesced = 0;
+	bool need_irq;
 	struct dmaengine_desc_callback cb;
 
 	lockdep_assert_held(&bchan->vc.lock);
@@ -1071,12 +1078,24 @@ static void bam_start_dma(struct bam_chan *bchan)
 		 *  - If a callback completion was requested for this DESC,
 		 *     In this case, BAM will deliver the completion callback
 		 *     for this desc and continue processing the next desc.
+		 *     With irq_coalesce set, up to that many such descs rely
+		 *     on the interrupt of a later desc in this batch instead,
+		 *     process_channel_irqs() completes all of them at once.
 		 */
-		if (((avail <= async_desc->xfer_len) || !vd ||
-		     dmaengine_desc_callback_valid(&cb)) &&
-		    !(async_desc->flags & DESC_FLAG_EOT))
+		need_irq = dmaengine_desc_callback_valid(&cb);
+		if (need_irq && coalesced < irq_coalesce) {
+			coalesced++;
+			need_irq = false;
+		}
+
+		if (((avail <= async_desc->xfer_len) || !vd || need_irq) &&
+		    !(async_desc->flags & DESC_FLAG_EOT)) {
 			desc[async_desc->xfer_len - 1].flags |=
 				cpu_to_le16(DESC_FLAG_INT);
+			coalesced = 0;
+		} else if (async_desc->flags & DESC_FLAG_EOT) {
+			coalesced = 0;
+		}
 
 		if (bchan->tail + async_desc->xfer_len > MAX_DESCRIPTORS) {
 			u32 partial = MAX_DESCRIPTORS - bchan->tail;
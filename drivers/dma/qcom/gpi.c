@@ -13,6 +13,7 @@
 #include <linux/platform_device.h>
 #include <linux/dma/qcom-gpi-dma.h>
 #include <linux/scatterlist.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include "../dmaengine.h"
 #include "../virt-dma.h"
@@ -116,6 +117,9 @@
 #define GPI_INTTYPE_IRQ		(1)
 #define GPI_CHTYPE_GPI_EV	(0x2)
 
+/* Interrupt moderation timer, in 32 kHz clock ticks */
+#define GPII_n_EV_k_CNTXT_8_INTMODT	GENMASK(15, 0)
+
 enum CNTXT_OFFS {
 	CNTXT_0_CONFIG = 0x0,
 	CNTXT_1_R_LENGTH = 0x4,
@@ -490,6 +494,10 @@ struct gchan {
 	u32 dir;
 	struct gpi_ring ch_ring;
 	void *config;
+
+	/* statistics, updated from the event tasklet */
+	u64 events;
+	u64 errors;
 };
 
 struct gpii {
@@ -514,10 +522,23 @@ struct gpii {
 	enum gpi_cmd gpi_cmd;
 	u32 cntxt_type_irq_msk;
 	bool ieob_set;
+
+	/* statistics, updated from the event tasklet */
+	u64 ev_runs;
+	u64 ev_budget_exhausted;
 };
 
 #define MAX_TRE 3
 
+static unsigned int irq_modt_us;
+module_param(irq_modt_us, uint, 0644);
+MODULE_PARM_DESC(irq_modt_us,
+		 "Event ring interrupt moderation in us, applied when a GPII is allocated (0 = off)");
+
+static unsigned int ev_budget;
+module_param(ev_budget, uint, 0644);
+MODULE_PARM_DESC(ev_budget, "Max events processed per tasklet run (0 = unlimited)");
+
 struct gpi_desc {
 	struct virt_dma_desc vd;
 	size_t len;
@@ -534,7 +555,7 @@ static const u32 GPII_CHAN_DIR[MAX_CHANNELS_PER_GPII] = {
 static irqreturn_t gpi_handle_irq(int irq, void *data);
 static void gpi_ring_recycle_ev_element(struct gpi_ring *ring);
 static int gpi_ring_add_element(struct gpi_ring *ring, void **wp);
-static void gpi_process_events(struct gpii *gpii);
+static bool gpi_process_events(struct gpii *gpii, u32 budget);
 
 static inline struct gchan *to_gchan(struct dma_chan *dma_chan)
 {
@@ -984,9 +1005,10 @@ static void gpi_process_imed_data_event(struct gchan *gchan,
 			return;
 	}
 
-	if (imed_event->code == MSM_GPI_TCE_UNEXP_ERR)
+	if (imed_event->code == MSM_GPI_TCE_UNEXP_ERR) {
+		gchan->errors++;
 		result.result = DMA_TRANS_ABORTED;
-	else
+	} else
 		result.result = DMA_TRANS_NOERROR;
 	result.residue = gpi_desc->len - imed_event->length;
 
@@ -1061,6 +1083,7 @@ static void gpi_process_xfer_compl_event(struct gchan *gchan,
 
 	if (compl_event->code == MSM_GPI_TCE_UNEXP_ERR) {
 		dev_err(gpii->gpi_dev->dev, "Error in Transaction\n");
+		gchan->errors++;
 		result.result = DMA_TRANS_ABORTED;
 	} else {
 		dev_dbg(gpii->gpi_dev->dev, "Transaction Success\n");
@@ -1080,8 +1103,13 @@ static void gpi_process_xfer_compl_event(struct gchan *gchan,
 	gpi_desc = NULL;
 }
 
-/* process all events */
-static void gpi_process_events(struct gpii *gpii)
+/*
+ * process pending events, up to @budget of them
+ *
+ * Returns true if the event ring was drained, false if the budget ran out
+ * first.
+ */
+static bool gpi_process_events(struct gpii *gpii, u32 budget)
 {
 	struct gpi_ring *ev_ring = &gpii->ev_ring;
 	phys_addr_t cntxt_rp;
@@ -1095,6 +1123,12 @@ static void gpi_process_events(struct gpii *gpii)
 
 	do {
 		while (rp != ev_ring->rp) {
+			if (!budget) {
+				gpi_write_ev_db(gpii, ev_ring, ev_ring->wp);
+				return false;
+			}
+			budget--;
+
 			gpi_event = ev_ring->rp;
 			chid = gpi_event->xfer_compl_event.chid;
 			type = gpi_event->xfer_compl_event.type;
@@ -1105,6 +1139,10 @@ static void gpi_process_events(struct gpii *gpii)
 				gpi_event->gpi_ere.dword[1], gpi_event->gpi_ere.dword[2],
 				gpi_event->gpi_ere.dword[3]);
 
+			if (type == XFER_COMPLETE_EV_TYPE ||
+			    type == IMMEDIATE_DATA_EV_TYPE)
+				gpii->gchan[chid].events++;
+
 			switch (type) {
 			case XFER_COMPLETE_EV_TYPE:
 				gchan = &gpii->gchan[chid];
@@ -1137,6 +1175,8 @@ static void gpi_process_events(struct gpii *gpii)
 		rp = to_virtual(ev_ring, cntxt_rp);
 
 	} while (rp != ev_ring->rp);
+
+	return true;
 }
 
 /* processing events using tasklet */
@@ -1153,7 +1193,14 @@ static void gpi_ev_tasklet(unsigned long data)
 	}
 
 	/* process the events */
-	gpi_process_events(gpii);
+	gpii->ev_runs++;
+	if (!gpi_process_events(gpii, READ_ONCE(ev_budget) ?: U32_MAX)) {
+		/* more pending, keep IEOB masked and yield the CPU */
+		gpii->ev_budget_exhausted++;
+		read_unlock(&gpii->pm_lock);
+		tasklet_hi_schedule(&gpii->ev_task);
+		return;
+	}
 
 	/* enable IEOB, switching back to interrupts */
 	gpi_config_interrupts(gpii, MASK_IEOB_SETTINGS, 1);
@@ -1318,10 +1365,12 @@ static int gpi_alloc_ev_chan(struct gpii *gpii)
 	gpi_write_reg(gpii, base + CNTXT_3_RING_BASE_MSB, upper_32_bits(ring->phys_addr));
 	gpi_write_reg(gpii, gpii->ev_cntxt_db_reg + CNTXT_5_RING_RP_MSB - CNTXT_4_RING_RP_LSB,
 		      upper_32_bits(ring->phys_addr));
-	gpi_write_reg(gpii, base + CNTXT_8_RING_INT_MOD, 0);
 	gpi_write_reg(gpii, base + CNTXT_10_RING_MSI_LSB, 0);
 	gpi_write_reg(gpii, base + CNTXT_11_RING_MSI_MSB, 0);
-	gpi_write_reg(gpii, base + CNTXT_8_RING_INT_MOD, 0);
+	gpi_write_reg(gpii, base + CNTXT_8_RING_INT_MOD,
+		      FIELD_PREP(GPII_n_EV_k_CNTXT_8_INTMODT,
+				 min_t(u64, DIV_ROUND_UP_ULL((u64)irq_modt_us * 32, 1000),
+				       FIELD_MAX(GPII_n_EV_k_CNTXT_8_INTMODT))));
 	gpi_write_reg(gpii, base + CNTXT_12_RING_RP_UPDATE_LSB, 0);
 	gpi_write_reg(gpii, base + CNTXT_13_RING_RP_UPDATE_MSB, 0);
 
@@ -2141,6 +2190,29 @@ static struct dma_chan *gpi_of_dma_xlate(struct of_phandle_args *args,
 	return dma_get_slave_channel(&gchan->vc.chan);
 }
 
+#ifdef CONFIG_DEBUG_FS
+static void gpi_dbg_summary_show(struct seq_file *s, struct dma_device *dma_dev)
+{
+	struct gpi_dev *gpi_dev = container_of(dma_dev, struct gpi_dev, dma_device);
+	unsigned int i, j;
+
+	for (i = 0; i < gpi_dev->max_gpii; i++) {
+		struct gpii *gpii = &gpi_dev->gpiis[i];
+
+		if (!((1 << i) & gpi_dev->gpii_mask))
+			continue;
+
+		seq_printf(s, " gpii%u: runs %llu budget exhausted %llu\n",
+			   gpii->gpii_id, gpii->ev_runs, gpii->ev_budget_exhausted);
+
+		for (j = 0; j < MAX_CHANNELS_PER_GPII; j++)
+			seq_printf(s, "  ch%u: events %llu errors %llu\n",
+				   gpii->gchan[j].chid, gpii->gchan[j].events,
+				   gpii->gchan[j].errors);
+	}
+}
+#endif /* CONFIG_DEBUG_FS */
+
 static int gpi_probe(struct platform_device *pdev)
 {
 	struct gpi_dev *gpi_dev;
@@ -2259,6 +2331,9 @@ static int gpi_probe(struct platform_device *pdev)
 	gpi_dev->dma_device.dev = gpi_dev->dev;
 	gpi_dev->dma_device.device_pause = gpi_pause;
 	gpi_dev->dma_device.device_resume = gpi_resume;
+#ifdef CONFIG_DEBUG_FS
+	gpi_dev->dma_device.dbg_summary_show = gpi_dbg_summary_show;
+#endif
 
 	/* register with dmaengine framework */
 	ret = dma_async_device_register(&gpi_dev->dma_device);
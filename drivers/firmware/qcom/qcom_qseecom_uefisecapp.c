@@ -276,6 +276,8 @@ struct qcuefi_client {
 	struct qseecom_client *client;
 	struct efivars efivars;
 	struct qcom_tzmem_pool *mempool;
+	struct list_head var_cache;
+	unsigned int var_cache_len;
 };
 
 static struct device *qcuefi_dev(struct qcuefi_client *qcuefi)
@@ -692,6 +694,130 @@ static efi_status_t qsee_uefi_query_variable_info(struct qcuefi_client *qcuefi,
 	return EFI_SUCCESS;
 }
 
+/* -- Variable cache. ------------------------------------------------------ */
+
+/*
+ * Every get_variable() is a round trip to the secure application, and efivarfs
+ * reads each variable twice (size, then data) when it is populated. Keep the
+ * most recently read non-volatile variables around; writes to a variable
+ * drop its entry. Protected by __qcuefi_lock.
+ */
+#define QCUEFI_CACHE_MAX_ENTRIES	64
+#define QCUEFI_CACHE_MAX_DATA		SZ_4K
+
+struct qcuefi_cache_entry {
+	struct list_head node;
+	efi_guid_t guid;
+	u32 attributes;
+	unsigned long name_length;
+	unsigned long data_size;
+	efi_char16_t *name;
+	u8 data[];
+};
+
+static struct qcuefi_cache_entry *qcuefi_cache_find(struct qcuefi_client *qcuefi,
+						    const efi_char16_t *name,
+						    const efi_guid_t *guid)
+{
+	struct qcuefi_cache_entry *entry;
+	unsigned long name_length;
+
+	name_length = ucs2_strnlen(name, QSEE_MAX_NAME_LEN) + 1;
+
+	list_for_each_entry(entry, &qcuefi->var_cache, node) {
+		if (entry->name_length == name_length && efi_guidcmp(entry->guid, *guid) == 0 &&
+		    !memcmp(entry->name, name, name_length * sizeof(*name)))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static void qcuefi_cache_drop(struct qcuefi_client *qcuefi, struct qcuefi_cache_entry *entry)
+{
+	list_del(&entry->node);
+	qcuefi->var_cache_len--;
+	kfree(entry);
+}
+
+static void qcuefi_cache_insert(struct qcuefi_client *qcuefi, const efi_char16_t *name,
+				const efi_guid_t *guid, u32 attributes,
+				unsigned long data_size, const void *data)
+{
+	struct qcuefi_cache_entry *entry;
+	unsigned long name_length;
+
+	if (!(attributes & EFI_VARIABLE_NON_VOLATILE) || data_size > QCUEFI_CACHE_MAX_DATA)
+		return;
+
+	name_length = ucs2_strnlen(name, QSEE_MAX_NAME_LEN) + 1;
+	if (name_length > QSEE_MAX_NAME_LEN)
+		return;
+
+	entry = kmalloc(struct_size(entry, data, data_size) + name_length * sizeof(*name),
+			GFP_KERNEL);
+	if (!entry)
+		return;
+
+	entry->guid = *guid;
+	entry->attributes = attributes;
+	entry->name_length = name_length;
+	entry->data_size = data_size;
+	entry->name = (efi_char16_t *)(entry->data + data_size);
+	memcpy(entry->name, name, name_length * sizeof(*name));
+	memcpy(entry->data, data, data_size);
+
+	if (qcuefi->var_cache_len == QCUEFI_CACHE_MAX_ENTRIES)
+		qcuefi_cache_drop(qcuefi, list_last_entry(&qcuefi->var_cache,
+							  struct qcuefi_cache_entry, node));
+
+	list_add(&entry->node, &qcuefi->var_cache);
+	qcuefi->var_cache_len++;
+}
+
+static void qcuefi_cache_flush(struct qcuefi_client *qcuefi)
+{
+	struct qcuefi_cache_entry *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &qcuefi->var_cache, node)
+		qcuefi_cache_drop(qcuefi, entry);
+}
+
+/* Mirrors the size/attribute semantics of qsee_uefi_get_variable(). */
+static efi_status_t qcuefi_cache_get_variable(struct qcuefi_client *qcuefi,
+					      const efi_char16_t *name, const efi_guid_t *guid,
+					      u32 *attributes, unsigned long *data_size,
+					      void *data, bool *hit)
+{
+	struct qcuefi_cache_entry *entry;
+	unsigned long buffer_size = *data_size;
+
+	*hit = false;
+	if (!name || !guid || (buffer_size && !data))
+		return EFI_INVALID_PARAMETER;
+
+	entry = qcuefi_cache_find(qcuefi, name, guid);
+	if (!entry)
+		return EFI_NOT_FOUND;
+
+	*hit = true;
+	list_move(&entry->node, &qcuefi->var_cache);
+
+	*data_size = entry->data_size;
+	if (attributes)
+		*attributes = entry->attributes;
+
+	if (buffer_size == 0 && !data)
+		return EFI_SUCCESS;
+
+	if (buffer_size < entry->data_size)
+		return EFI_BUFFER_TOO_SMALL;
+
+	memcpy(data, entry->data, entry->data_size);
+
+	return EFI_SUCCESS;
+}
+
 /* -- Global efivar interface. ---------------------------------------------- */
 
 static struct qcuefi_client *__qcuefi;
@@ -730,15 +856,28 @@ static void qcuefi_release(void)
 static efi_status_t qcuefi_get_variable(efi_char16_t *name, efi_guid_t *vendor, u32 *attr,
 					unsigned long *data_size, void *data)
 {
+	unsigned long buffer_size = *data_size;
 	struct qcuefi_client *qcuefi;
 	efi_status_t status;
+	u32 attributes;
+	bool hit;
 
 	qcuefi = qcuefi_acquire();
 	if (!qcuefi)
 		return EFI_NOT_READY;
 
-	status = qsee_uefi_get_variable(qcuefi, name, vendor, attr, data_size, data);
+	status = qcuefi_cache_get_variable(qcuefi, name, vendor, attr, data_size, data, &hit);
+	if (hit || status == EFI_INVALID_PARAMETER)
+		goto out;
+
+	status = qsee_uefi_get_variable(qcuefi, name, vendor, &attributes, data_size, data);
+	if (status == EFI_SUCCESS && buffer_size >= *data_size && data)
+		qcuefi_cache_insert(qcuefi, name, vendor, attributes, *data_size, data);
 
+	if (attr && (status == EFI_SUCCESS || status == EFI_BUFFER_TOO_SMALL))
+		*attr = attributes;
+
+out:
 	qcuefi_release();
 	return status;
 }
@@ -746,6 +885,7 @@ static efi_status_t qcuefi_get_variable(efi_char16_t *name, efi_guid_t *vendor,
 static efi_status_t qcuefi_set_variable(efi_char16_t *name, efi_guid_t *vendor,
 					u32 attr, unsigned long data_size, void *data)
 {
+	struct qcuefi_cache_entry *entry;
 	struct qcuefi_client *qcuefi;
 	efi_status_t status;
 
@@ -753,6 +893,13 @@ static efi_status_t qcuefi_set_variable(efi_char16_t *name, efi_guid_t *vendor,
 	if (!qcuefi)
 		return EFI_NOT_READY;
 
+	/* Drop the cached copy whatever the outcome, TZ may have partially applied it */
+	if (name && vendor) {
+		entry = qcuefi_cache_find(qcuefi, name, vendor);
+		if (entry)
+			qcuefi_cache_drop(qcuefi, entry);
+	}
+
 	status = qsee_uefi_set_variable(qcuefi, name, vendor, attr, data_size, data);
 
 	qcuefi_release();
@@ -813,6 +960,7 @@ static int qcom_uefisecapp_probe(struct auxiliary_device *aux_dev,
 		return -ENOMEM;
 
 	qcuefi->client = container_of(aux_dev, struct qseecom_client, aux_dev);
+	INIT_LIST_HEAD(&qcuefi->var_cache);
 
 	auxiliary_set_drvdata(aux_dev, qcuefi);
 	status = qcuefi_set_reference(qcuefi);
@@ -842,6 +990,7 @@ static void qcom_uefisecapp_remove(struct auxiliary_device *aux_dev)
 
 	efivars_unregister(&qcuefi->efivars);
 	qcuefi_set_reference(NULL);
+	qcuefi_cache_flush(qcuefi);
 }
 
 static const struct auxiliary_device_id qcom_uefisecapp_id_table[] = {
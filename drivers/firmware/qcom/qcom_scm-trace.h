@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_scm
+
+#if !defined(__QCOM_SCM_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __QCOM_SCM_TRACE_H__
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(qcom_scm_call,
+	TP_PROTO(u32 svc, u32 cmd, bool atomic, int ret, u64 duration_ns),
+
+	TP_ARGS(svc, cmd, atomic, ret, duration_ns),
+
+	TP_STRUCT__entry(
+		__field(u32, svc)
+		__field(u32, cmd)
+		__field(bool, atomic)
+		__field(int, ret)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__entry->svc = svc;
+		__entry->cmd = cmd;
+		__entry->atomic = atomic;
+		__entry->ret = ret;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("svc = %#x, cmd = %#x, atomic = %d, ret = %d, duration = %llu ns",
+		  __entry->svc, __entry->cmd, __entry->atomic, __entry->ret,
+		  __entry->duration_ns)
+);
+
+#endif /* __QCOM_SCM_TRACE_H__ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE qcom_scm-trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
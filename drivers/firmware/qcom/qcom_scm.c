@@ -18,6 +18,7 @@
 #include <linux/init.h>
 #include <linux/interconnect.h>
 #include <linux/interrupt.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/of_address.h>
@@ -32,6 +33,9 @@
 #include "qcom_scm.h"
 #include "qcom_tzmem.h"
 
+#define CREATE_TRACE_POINTS
+#include "qcom_scm-trace.h"
+
 static bool download_mode = IS_ENABLED(CONFIG_QCOM_SCM_DOWNLOAD_MODE_DEFAULT);
 module_param(download_mode, bool, 0);
 
@@ -286,10 +290,9 @@ static enum qcom_scm_convention __get_convention(void)
  * Sends a command to the SCM and waits for the command to finish processing.
  * This should *only* be called in pre-emptible context.
  */
-static int qcom_scm_call(struct device *dev, const struct qcom_scm_desc *desc,
-			 struct qcom_scm_res *res)
+static int __qcom_scm_call(struct device *dev, const struct qcom_scm_desc *desc,
+			   struct qcom_scm_res *res)
 {
-	might_sleep();
 	switch (__get_convention()) {
 	case SMC_CONVENTION_ARM_32:
 	case SMC_CONVENTION_ARM_64:
@@ -302,6 +305,25 @@ static int qcom_scm_call(struct device *dev, const struct qcom_scm_desc *desc,
 	}
 }
 
+static int qcom_scm_call(struct device *dev, const struct qcom_scm_desc *desc,
+			 struct qcom_scm_res *res)
+{
+	ktime_t start;
+	int ret;
+
+	might_sleep();
+
+	if (!trace_qcom_scm_call_enabled())
+		return __qcom_scm_call(dev, desc, res);
+
+	start = ktime_get();
+	ret = __qcom_scm_call(dev, desc, res);
+	trace_qcom_scm_call(desc->svc, desc->cmd, false, ret,
+			    ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	return ret;
+}
+
 /**
  * qcom_scm_call_atomic() - atomic variation of qcom_scm_call()
  * @dev:	device
@@ -311,9 +333,9 @@ static int qcom_scm_call(struct device *dev, const struct qcom_scm_desc *desc,
  * Sends a command to the SCM and waits for the command to finish processing.
  * This can be called in atomic context.
  */
-static int qcom_scm_call_atomic(struct device *dev,
-				const struct qcom_scm_desc *desc,
-				struct qcom_scm_res *res)
+static int __qcom_scm_call_atomic(struct device *dev,
+				  const struct qcom_scm_desc *desc,
+				  struct qcom_scm_res *res)
 {
 	switch (__get_convention()) {
 	case SMC_CONVENTION_ARM_32:
@@ -327,6 +349,24 @@ static int qcom_scm_call_atomic(struct device *dev,
 	}
 }
 
+static int qcom_scm_call_atomic(struct device *dev,
+				const struct qcom_scm_desc *desc,
+				struct qcom_scm_res *res)
+{
+	ktime_t start;
+	int ret;
+
+	if (!trace_qcom_scm_call_enabled())
+		return __qcom_scm_call_atomic(dev, desc, res);
+
+	start = ktime_get();
+	ret = __qcom_scm_call_atomic(dev, desc, res);
+	trace_qcom_scm_call(desc->svc, desc->cmd, true, ret,
+			    ktime_to_ns(ktime_sub(ktime_get(), start)));
+
+	return ret;
+}
+
 static bool __qcom_scm_is_call_available(struct device *dev, u32 svc_id,
 					 u32 cmd_id)
 {
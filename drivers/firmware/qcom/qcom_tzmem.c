@@ -41,6 +41,7 @@ struct qcom_tzmem_pool {
 
 struct qcom_tzmem_chunk {
 	size_t size;
+	phys_addr_t paddr;
 	struct qcom_tzmem_pool *owner;
 };
 
@@ -386,6 +387,7 @@ void *qcom_tzmem_alloc(struct qcom_tzmem_pool *pool, size_t size, gfp_t gfp)
 	}
 
 	chunk->size = size;
+	chunk->paddr = gen_pool_virt_to_phys(pool->genpool, vaddr);
 	chunk->owner = pool;
 
 	scoped_guard(spinlock_irqsave, &qcom_tzmem_chunks_lock) {
@@ -448,6 +450,15 @@ phys_addr_t qcom_tzmem_to_phys(void *vaddr)
 
 	guard(spinlock_irqsave)(&qcom_tzmem_chunks_lock);
 
+	/*
+	 * Callers almost always pass the address returned by
+	 * qcom_tzmem_alloc(), look that up directly before falling back to
+	 * searching every pool for an address inside a chunk.
+	 */
+	chunk = radix_tree_lookup(&qcom_tzmem_chunks, (unsigned long)vaddr);
+	if (chunk)
+		return chunk->paddr;
+
 	radix_tree_for_each_slot(slot, &qcom_tzmem_chunks, &iter, 0) {
 		chunk = radix_tree_deref_slot_protected(slot,
 						&qcom_tzmem_chunks_lock);
@@ -70,7 +70,7 @@ static void a5xx_submit_in_rb(struct msm_gpu *gpu, struct msm_gem_submit *submit
 	uint32_t *ptr, dwords;
 	unsigned int i;
 
-	for (i = 0; i < submit->nr_cmds; i++) {
+	for (i = 0; !submit->skip && i < submit->nr_cmds; i++) {
 		switch (submit->cmd[i].type) {
 		case MSM_SUBMIT_CMD_IB_TARGET_BUF:
 			break;
@@ -159,7 +159,7 @@ static void a5xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 	OUT_RING(ring, 0x02);
 
 	/* Submit the commands */
-	for (i = 0; i < submit->nr_cmds; i++) {
+	for (i = 0; !submit->skip && i < submit->nr_cmds; i++) {
 		switch (submit->cmd[i].type) {
 		case MSM_SUBMIT_CMD_IB_TARGET_BUF:
 			break;
@@ -138,6 +138,10 @@ void a6xx_gmu_set_freq(struct msm_gpu *gpu, struct dev_pm_opp *opp,
 	if (suspended)
 		return;
 
+	/* With bw_vote, the bus vote no longer follows the GPU frequency */
+	if (a6xx_gpu->bw_opp)
+		opp = a6xx_gpu->bw_opp;
+
 	if (!gmu->legacy) {
 		a6xx_hfi_set_freq(gmu, perf_index);
 		dev_pm_opp_set_opp(&gpu->pdev->dev, opp);
@@ -166,6 +170,45 @@ void a6xx_gmu_set_freq(struct msm_gpu *gpu, struct dev_pm_opp *opp,
 	dev_pm_opp_set_opp(&gpu->pdev->dev, opp);
 }
 
+void a6xx_gmu_set_freq_limits(struct msm_gpu *gpu, unsigned long min_freq,
+			      unsigned long max_freq, bool suspended)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	struct a6xx_gmu *gmu = &a6xx_gpu->gmu;
+	int min_index, max_index;
+
+	/* Skip the "off" level, the GMU DCVS only picks from the OPPs */
+	for (min_index = 1; min_index < gmu->nr_gpu_freqs - 1; min_index++)
+		if (gmu->gpu_freqs[min_index] >= min_freq)
+			break;
+
+	for (max_index = gmu->nr_gpu_freqs - 1; max_index > min_index; max_index--)
+		if (gmu->gpu_freqs[max_index] <= max_freq)
+			break;
+
+	if (min_index == gmu->dcvs_min_index && max_index == gmu->dcvs_max_index)
+		return;
+
+	gmu->dcvs_min_index = min_index;
+	gmu->dcvs_max_index = max_index;
+
+	/*
+	 * The GMU picks the actual level, report the ceiling as the current
+	 * frequency as that is what devfreq and the cooling device control.
+	 */
+	gmu->current_perf_index = max_index;
+	gmu->freq = gmu->gpu_freqs[max_index];
+
+	trace_msm_gmu_freq_change(gmu->freq, max_index);
+
+	/* While the GMU is off the limits are sent as part of the boot sequence */
+	if (suspended)
+		return;
+
+	a6xx_hfi_set_freq_limits(gmu, min_index, max_index);
+}
+
 unsigned long a6xx_gmu_get_freq(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
@@ -1455,6 +1498,9 @@ static int a6xx_gmu_pwrlevels_probe(struct a6xx_gmu *gmu)
 
 	gmu->current_perf_index = gmu->nr_gpu_freqs - 1;
 
+	gmu->dcvs_min_index = 1;
+	gmu->dcvs_max_index = gmu->nr_gpu_freqs - 1;
+
 	/* Build the list of RPMh votes that we'll send to the GMU */
 	return a6xx_gmu_rpmh_votes_init(gmu);
 }
@@ -1655,8 +1701,14 @@ int a6xx_gmu_init(struct a6xx_gpu *a6xx_gpu, struct device_node *node)
 
 	of_dma_configure(gmu->dev, node, true);
 
-	/* Fow now, don't do anything fancy until we get our feet under us */
-	gmu->idle_level = GMU_IDLE_STATE_ACTIVE;
+	/*
+	 * Let the GMU collapse GX between frames where that has been validated,
+	 * everywhere else keep it on until runtime suspend.
+	 */
+	if (adreno_gpu->info->quirks & ADRENO_QUIRK_IFPC)
+		gmu->idle_level = GMU_IDLE_STATE_IFPC;
+	else
+		gmu->idle_level = GMU_IDLE_STATE_ACTIVE;
 
 	pm_runtime_enable(gmu->dev);
 
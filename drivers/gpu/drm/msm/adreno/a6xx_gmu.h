@@ -88,6 +88,10 @@ struct a6xx_gmu {
 
 	unsigned long freq;
 
+	/* With msm_gpu::hw_dcvs, the GMU picks from these perf table indexes */
+	int dcvs_min_index;
+	int dcvs_max_index;
+
 	struct a6xx_hfi_queue queues[2];
 
 	bool initialized;
@@ -141,6 +145,10 @@ static inline u64 gmu_read64(struct a6xx_gmu *gmu, u32 lo, u32 hi)
 	readl_poll_timeout((gmu)->mmio + ((addr) << 2), val, cond, \
 		interval, timeout)
 
+#define gmu_poll_timeout_atomic(gmu, addr, val, cond, interval, timeout) \
+	readl_poll_timeout_atomic((gmu)->mmio + ((addr) << 2), val, cond, \
+		interval, timeout)
+
 static inline u32 gmu_read_rscc(struct a6xx_gmu *gmu, u32 offset)
 {
 	return readl(gmu->rscc + (offset << 2));
@@ -193,6 +201,7 @@ int a6xx_hfi_start(struct a6xx_gmu *gmu, int boot_state);
 void a6xx_hfi_stop(struct a6xx_gmu *gmu);
 int a6xx_hfi_send_prep_slumber(struct a6xx_gmu *gmu);
 int a6xx_hfi_set_freq(struct a6xx_gmu *gmu, int index);
+int a6xx_hfi_set_freq_limits(struct a6xx_gmu *gmu, int min_index, int max_index);
 
 bool a6xx_gmu_gx_is_on(struct a6xx_gmu *gmu);
 bool a6xx_gmu_sptprac_is_on(struct a6xx_gmu *gmu);
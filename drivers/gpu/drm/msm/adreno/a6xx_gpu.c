@@ -3,12 +3,14 @@
 
 
 #include "msm_gem.h"
+#include "msm_mdss.h"
 #include "msm_mmu.h"
 #include "msm_gpu_trace.h"
 #include "a6xx_gpu.h"
 #include "a6xx_gmu.xml.h"
 
 #include <linux/bitfield.h>
+#include <linux/debugfs.h>
 #include <linux/devfreq.h>
 #include <linux/firmware/qcom/qcom_scm.h>
 #include <linux/pm_domain.h>
@@ -66,8 +68,80 @@ static void update_shadow_rptr(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
 	}
 }
 
+static int fenced_write(struct a6xx_gpu *a6xx_gpu, u32 offset, u32 value,
+		u32 mask)
+{
+	struct adreno_gpu *adreno_gpu = &a6xx_gpu->base;
+	struct msm_gpu *gpu = &adreno_gpu->base;
+	struct a6xx_gmu *gmu = &a6xx_gpu->gmu;
+	u32 status;
+
+	gpu_write(gpu, offset, value);
+
+	/* Without IFPC the fence is always in allow mode */
+	if (adreno_has_gmu_wrapper(adreno_gpu) ||
+	    gmu->idle_level != GMU_IDLE_STATE_IFPC)
+		return 0;
+
+	/*
+	 * If GX is collapsed, the write is dropped by the AHB fence which in
+	 * turn wakes up the GMU. Wait for the fence to open and retry.
+	 */
+	if (!gmu_poll_timeout_atomic(gmu, REG_A6XX_GMU_AHB_FENCE_STATUS, status,
+			(status & mask) == 0, 0, 1000))
+		return 0;
+
+	gpu_write(gpu, offset, value);
+
+	/* Make sure the write is posted before checking the fence again */
+	mb();
+
+	if (!gmu_poll_timeout_atomic(gmu, REG_A6XX_GMU_AHB_FENCE_STATUS, status,
+			(status & mask) == 0, 0, 1000)) {
+		dev_err_ratelimited(gmu->dev,
+			"delay in fenced register write (0x%x)\n", offset);
+		return 0;
+	}
+
+	dev_err_ratelimited(gmu->dev, "fenced register write (0x%x) failed\n",
+		offset);
+
+	return -ETIMEDOUT;
+}
+
+/*
+ * Write a register in the GMU AHB fence range, making sure that it isn't lost
+ * if GX happens to be in (or on its way to) IFPC
+ */
+int a6xx_fenced_write(struct a6xx_gpu *a6xx_gpu, u32 offset, u64 value,
+		u32 mask, bool is_64b)
+{
+	int ret;
+
+	ret = fenced_write(a6xx_gpu, offset, lower_32_bits(value), mask);
+	if (ret || !is_64b)
+		return ret;
+
+	return fenced_write(a6xx_gpu, offset + 1, upper_32_bits(value), mask);
+}
+
+/* Keep GX from collapsing while the CPU is looking at GX registers */
+static void a6xx_gpu_keepalive_vote(struct msm_gpu *gpu, bool on)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+
+	if (adreno_has_gmu_wrapper(adreno_gpu) ||
+	    a6xx_gpu->gmu.idle_level != GMU_IDLE_STATE_IFPC)
+		return;
+
+	gmu_write(&a6xx_gpu->gmu, REG_A6XX_GMU_GMU_PWR_COL_KEEPALIVE, on);
+}
+
 static void a6xx_flush(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
 {
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
 	uint32_t wptr;
 	unsigned long flags;
 
@@ -86,7 +160,22 @@ static void a6xx_flush(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
 	/* Make sure everything is posted before making a decision */
 	mb();
 
-	gpu_write(gpu, REG_A6XX_CP_RB_WPTR, wptr);
+	/*
+	 * Update HW if this is the current ring and we are not in preempt. The
+	 * write also brings GX back up if the GMU collapsed it since the last
+	 * submit.
+	 */
+	if (a6xx_gpu->cur_ring == ring && !a6xx_in_preempt(a6xx_gpu))
+		a6xx_fenced_write(a6xx_gpu, REG_A6XX_CP_RB_WPTR, wptr, BIT(0), false);
+}
+
+/* Deferred wptr update for a batch of scheduler jobs, see msm_job_flush() */
+static void a6xx_flush_batch(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
+{
+	a6xx_flush(gpu, ring);
+
+	/* Check to see if we need to start preemption */
+	a6xx_preempt_trigger(gpu);
 }
 
 static void get_stats_counter(struct msm_ringbuffer *ring, u32 counter,
@@ -100,6 +189,92 @@ static void get_stats_counter(struct msm_ringbuffer *ring, u32 counter,
 	OUT_RING(ring, upper_32_bits(iova));
 }
 
+/* UCHE counters, and their countables, used for LLC slice sizing: */
+#define A6XX_LLC_CNTR_BEATS		10
+#define A6XX_LLC_CNTR_REQS		11
+#define A6XX_UCHE_VBIF_READ_BEATS_TP	4
+#define A6XX_UCHE_READ_REQUESTS_TP	9
+
+/* UCHE counters, and their countables, used for DDR bandwidth voting: */
+#define A6XX_BW_CNTR_CH0		8
+#define A6XX_BW_CNTR_CH1		9
+#define A6XX_UCHE_VBIF_READ_BEATS_CH0	27
+#define A6XX_UCHE_VBIF_READ_BEATS_CH1	28
+
+/*
+ * Counters that userspace can reserve for per-submit sampling.  CP counter 0
+ * is used by the kernel for the submit stats, so it is left out.
+ */
+static const struct msm_perfcntr_group a6xx_perfcntr_groups[] = {
+	[MSM_PERFCNTR_GROUP_CP] = {
+		"CP", REG_A6XX_CP_PERFCTR_CP_SEL(1), REG_A6XX_RBBM_PERFCTR_CP(1), 13, 64
+	},
+	[MSM_PERFCNTR_GROUP_SP] = {
+		"SP", REG_A6XX_SP_PERFCTR_SP_SEL(0), REG_A6XX_RBBM_PERFCTR_SP(0), 24, 128
+	},
+	[MSM_PERFCNTR_GROUP_TP] = {
+		"TP", REG_A6XX_TPL1_PERFCTR_TP_SEL(0), REG_A6XX_RBBM_PERFCTR_TP(0), 12, 128
+	},
+	/* Less the counters used for LLC sizing and bw voting, if enabled: */
+	[MSM_PERFCNTR_GROUP_UCHE] = {
+		"UCHE", REG_A6XX_UCHE_PERFCTR_UCHE_SEL(0), REG_A6XX_RBBM_PERFCTR_UCHE(0), 12, 40
+	},
+	[MSM_PERFCNTR_GROUP_RB] = {
+		"RB", REG_A6XX_RB_PERFCTR_RB_SEL(0), REG_A6XX_RBBM_PERFCTR_RB(0), 8, 64
+	},
+	/*
+	 * UBWC compressor/decompressor of the CCU: flag fetches and the CCU
+	 * vs VBIF data countables give the hit and compression ratios.
+	 */
+	[MSM_PERFCNTR_GROUP_CMP] = {
+		"CMP", REG_A6XX_RB_PERFCTR_CMP_SEL(0), REG_A6XX_RBBM_PERFCTR_CMP(0), 4, 48
+	},
+};
+
+static void a6xx_perfcntr_start(struct msm_ringbuffer *ring,
+		struct msm_gem_submit *submit)
+{
+	unsigned int i;
+
+	if (!submit->nr_perfcntrs)
+		return;
+
+	/* The select registers are protected: */
+	OUT_PKT7(ring, CP_SET_PROTECTED_MODE, 1);
+	OUT_RING(ring, 0);
+
+	for (i = 0; i < submit->nr_perfcntrs; i++) {
+		OUT_PKT4(ring, submit->perfcntrs[i].select_reg, 1);
+		OUT_RING(ring, submit->perfcntrs[i].countable);
+	}
+
+	OUT_PKT7(ring, CP_SET_PROTECTED_MODE, 1);
+	OUT_RING(ring, 1);
+
+	/* Let the new selections take effect before the first sample: */
+	OUT_PKT7(ring, CP_WAIT_FOR_IDLE, 0);
+
+	for (i = 0; i < submit->nr_perfcntrs; i++)
+		get_stats_counter(ring, submit->perfcntrs[i].counter_reg,
+			submit->perfcntr_iova + (submit->perfcntrs[i].slot * 16));
+}
+
+static void a6xx_perfcntr_end(struct msm_ringbuffer *ring,
+		struct msm_gem_submit *submit)
+{
+	unsigned int i;
+
+	if (!submit->nr_perfcntrs)
+		return;
+
+	/* Wait for the IBs to drain, so the samples cover all their work: */
+	OUT_PKT7(ring, CP_WAIT_FOR_IDLE, 0);
+
+	for (i = 0; i < submit->nr_perfcntrs; i++)
+		get_stats_counter(ring, submit->perfcntrs[i].counter_reg,
+			submit->perfcntr_iova + (submit->perfcntrs[i].slot * 16) + 8);
+}
+
 static void a6xx_set_pagetable(struct a6xx_gpu *a6xx_gpu,
 		struct msm_ringbuffer *ring, struct msm_file_private *ctx)
 {
@@ -109,7 +284,7 @@ static void a6xx_set_pagetable(struct a6xx_gpu *a6xx_gpu,
 	u32 asid;
 	u64 memptr = rbmemptr(ring, ttbr0);
 
-	if (ctx->seqno == a6xx_gpu->base.base.cur_ctx_seqno)
+	if (ctx->seqno == ring->cur_ctx_seqno)
 		return;
 
 	if (msm_iommu_pagetable_params(ctx->aspace->mmu, &ttbr, &asid))
@@ -145,6 +320,23 @@ static void a6xx_set_pagetable(struct a6xx_gpu *a6xx_gpu,
 	OUT_RING(ring, lower_32_bits(ttbr));
 	OUT_RING(ring, (asid << 16) | upper_32_bits(ttbr));
 
+	/*
+	 * With preemption, also record the pagetable in the SMMU info of the
+	 * ring so the CP can switch back to it when restoring the ring.
+	 */
+	if (a6xx_gpu->base.base.nr_rings > 1) {
+		u64 smmu = a6xx_gpu->preempt_smmu_iova[ring->id];
+
+		OUT_PKT7(ring, CP_MEM_WRITE, 7);
+		OUT_RING(ring, CP_MEM_WRITE_0_ADDR_LO(lower_32_bits(smmu)));
+		OUT_RING(ring, CP_MEM_WRITE_1_ADDR_HI(upper_32_bits(smmu)));
+		OUT_RING(ring, lower_32_bits(ttbr));
+		OUT_RING(ring, upper_32_bits(ttbr));
+		OUT_RING(ring, asid);
+		OUT_RING(ring, 0);
+		OUT_RING(ring, A6XX_PREEMPT_SMMU_MAGIC);
+	}
+
 	/*
 	 * Sync both threads after switching pagetables and enable BR only
 	 * to make sure BV doesn't race ahead while BR is still switching
@@ -185,6 +377,50 @@ static void a6xx_set_pagetable(struct a6xx_gpu *a6xx_gpu,
 	}
 }
 
+/* Tell the CP where to save the state of the ring when it gets preempted */
+static void a6xx_emit_preempt_records(struct a6xx_gpu *a6xx_gpu,
+		struct msm_ringbuffer *ring, struct msm_gpu_submitqueue *queue)
+{
+	u64 record = a6xx_gpu->preempt_iova[ring->id];
+
+	OUT_PKT7(ring, CP_SET_PSEUDO_REG, queue->bo ? 12 : 9);
+
+	OUT_RING(ring, SMMU_INFO);
+	OUT_RING(ring, lower_32_bits(a6xx_gpu->preempt_smmu_iova[ring->id]));
+	OUT_RING(ring, upper_32_bits(a6xx_gpu->preempt_smmu_iova[ring->id]));
+
+	OUT_RING(ring, NON_SECURE_SAVE_ADDR);
+	OUT_RING(ring, lower_32_bits(record));
+	OUT_RING(ring, upper_32_bits(record));
+
+	OUT_RING(ring, COUNTER);
+	OUT_RING(ring, lower_32_bits(record + A6XX_PREEMPT_RECORD_SIZE));
+	OUT_RING(ring, upper_32_bits(record + A6XX_PREEMPT_RECORD_SIZE));
+
+	if (queue->bo) {
+		OUT_RING(ring, NON_PRIV_SAVE_ADDR);
+		OUT_RING(ring, lower_32_bits(queue->bo_iova));
+		OUT_RING(ring, upper_32_bits(queue->bo_iova));
+	}
+}
+
+/*
+ * CP_ALWAYS_ON_COUNTER is a GX register, and GX may be collapsed between
+ * submits. Go through ->get_timestamp(), which keeps it powered with an OOB
+ * vote when there is a GMU, and only pay for it when the trace is enabled.
+ */
+static void a6xx_trace_submit_flush(struct msm_gpu *gpu,
+				    struct msm_gem_submit *submit)
+{
+	uint64_t ticks = 0;
+
+	if (!trace_msm_gpu_submit_flush_enabled())
+		return;
+
+	gpu->funcs->get_timestamp(gpu, &ticks);
+	trace_msm_gpu_submit_flush(submit, ticks);
+}
+
 static void a6xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 {
 	unsigned int index = submit->seqno % MSM_GPU_SUBMIT_STATS_COUNT;
@@ -195,6 +431,9 @@ static void a6xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 
 	a6xx_set_pagetable(a6xx_gpu, ring, submit->queue->ctx);
 
+	if (gpu->nr_rings > 1)
+		a6xx_emit_preempt_records(a6xx_gpu, ring, submit->queue);
+
 	get_stats_counter(ring, REG_A6XX_RBBM_PERFCTR_CP(0),
 		rbmemptr_stats(ring, index, cpcycles_start));
 
@@ -213,13 +452,27 @@ static void a6xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 	OUT_PKT7(ring, CP_EVENT_WRITE, 1);
 	OUT_RING(ring, CP_EVENT_WRITE_0_EVENT(PC_CCU_INVALIDATE_COLOR));
 
+	if (gpu->nr_rings > 1) {
+		/* Enable local preemption for finegrain preemption */
+		OUT_PKT7(ring, CP_PREEMPT_ENABLE_LOCAL, 1);
+		OUT_RING(ring, 0x1);
+
+		/* Allow CP_CONTEXT_SWITCH_YIELD packets in the IB2 */
+		OUT_PKT7(ring, CP_YIELD_ENABLE, 1);
+		OUT_RING(ring, 0x02);
+	}
+
+	if (!submit->skip)
+		a6xx_perfcntr_start(ring, submit);
+
 	/* Submit the commands */
-	for (i = 0; i < submit->nr_cmds; i++) {
+	for (i = 0; !submit->skip && i < submit->nr_cmds; i++) {
 		switch (submit->cmd[i].type) {
 		case MSM_SUBMIT_CMD_IB_TARGET_BUF:
+		case MSM_SUBMIT_CMD_PERFCNTR_BUF:
 			break;
 		case MSM_SUBMIT_CMD_CTX_RESTORE_BUF:
-			if (gpu->cur_ctx_seqno == submit->queue->ctx->seqno)
+			if (ring->cur_ctx_seqno == submit->queue->ctx->seqno)
 				break;
 			fallthrough;
 		case MSM_SUBMIT_CMD_BUF:
@@ -242,11 +495,20 @@ static void a6xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 			update_shadow_rptr(gpu, ring);
 	}
 
+	if (!submit->skip)
+		a6xx_perfcntr_end(ring, submit);
+
 	get_stats_counter(ring, REG_A6XX_RBBM_PERFCTR_CP(0),
 		rbmemptr_stats(ring, index, cpcycles_end));
 	get_stats_counter(ring, REG_A6XX_CP_ALWAYS_ON_COUNTER,
 		rbmemptr_stats(ring, index, alwayson_end));
 
+	if (gpu->nr_rings > 1) {
+		/* Turn off IB level preemptions */
+		OUT_PKT7(ring, CP_YIELD_ENABLE, 1);
+		OUT_RING(ring, 0x01);
+	}
+
 	/* Write the fence to the scratch register */
 	OUT_PKT4(ring, REG_A6XX_CP_SCRATCH_REG(2), 1);
 	OUT_RING(ring, submit->seqno);
@@ -262,10 +524,33 @@ static void a6xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 	OUT_RING(ring, upper_32_bits(rbmemptr(ring, fence)));
 	OUT_RING(ring, submit->seqno);
 
-	trace_msm_gpu_submit_flush(submit,
-		gpu_read64(gpu, REG_A6XX_CP_ALWAYS_ON_COUNTER));
+	if (gpu->nr_rings > 1) {
+		/* Yield the floor on command completion */
+		OUT_PKT7(ring, CP_CONTEXT_SWITCH_YIELD, 4);
+		/*
+		 * If dword[2:1] are non zero, they specify an address for the
+		 * CP to write the value of dword[3] to on preemption complete.
+		 * Write 0 to skip the write
+		 */
+		OUT_RING(ring, 0x00);
+		OUT_RING(ring, 0x00);
+		/* Data value - not used if the address above is 0 */
+		OUT_RING(ring, 0x01);
+		/* Set bit 0 to trigger an interrupt on preempt complete */
+		OUT_RING(ring, 0x01);
+	}
+
+	a6xx_trace_submit_flush(gpu, submit);
+
+	a6xx_gpu->last_seqno[ring->id] = submit->seqno;
+
+	if (ring->defer_flush)
+		return;
 
 	a6xx_flush(gpu, ring);
+
+	/* Check to see if we need to start preemption */
+	a6xx_preempt_trigger(gpu);
 }
 
 static void a7xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
@@ -300,7 +585,7 @@ static void a7xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 	OUT_RING(ring, 0x00d); /* IB1LIST start */
 
 	/* Submit the commands */
-	for (i = 0; i < submit->nr_cmds; i++) {
+	for (i = 0; !submit->skip && i < submit->nr_cmds; i++) {
 		switch (submit->cmd[i].type) {
 		case MSM_SUBMIT_CMD_IB_TARGET_BUF:
 			break;
@@ -389,10 +674,10 @@ static void a7xx_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 	OUT_PKT7(ring, CP_SET_MARKER, 1);
 	OUT_RING(ring, 0x100); /* IFPC enable */
 
-	trace_msm_gpu_submit_flush(submit,
-		gpu_read64(gpu, REG_A6XX_CP_ALWAYS_ON_COUNTER));
+	a6xx_trace_submit_flush(gpu, submit);
 
-	a6xx_flush(gpu, ring);
+	if (!ring->defer_flush)
+		a6xx_flush(gpu, ring);
 }
 
 static void a6xx_set_hwcg(struct msm_gpu *gpu, bool state)
@@ -466,6 +751,44 @@ static void a6xx_set_hwcg(struct msm_gpu *gpu, bool state)
 	gpu_write(gpu, REG_A6XX_RBBM_CLOCK_CNTL, state ? clock_cntl_on : 0);
 }
 
+/*
+ * Most of what hw_init() programs only depends on the target, but is lost
+ * when GX collapses.  The first hw_init() records those writes, and later
+ * ones (ie. every runtime resume) replay the list rather than walking all
+ * of the per-target conditions again.
+ */
+static void static_write(struct msm_gpu *gpu, u32 reg, u32 val)
+{
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(to_adreno_gpu(gpu));
+	unsigned int n = a6xx_gpu->nr_recorded_regs;
+
+	gpu_write(gpu, reg, val);
+
+	if (!a6xx_gpu->recording_regs)
+		return;
+
+	/* Too many to cache, just do the full setup every time: */
+	if (WARN_ON_ONCE(n >= ARRAY_SIZE(a6xx_gpu->static_regs))) {
+		a6xx_gpu->recording_regs = false;
+		return;
+	}
+
+	a6xx_gpu->static_regs[n].offset = reg;
+	a6xx_gpu->static_regs[n].value = val;
+	a6xx_gpu->nr_recorded_regs = n + 1;
+}
+
+static void static_write64(struct msm_gpu *gpu, u32 reg, u64 val)
+{
+	static_write(gpu, reg, lower_32_bits(val));
+	static_write(gpu, reg + 1, upper_32_bits(val));
+}
+
+static void static_rmw(struct msm_gpu *gpu, u32 reg, u32 mask, u32 or)
+{
+	static_write(gpu, reg, (gpu_read(gpu, reg) & ~mask) | or);
+}
+
 static void a6xx_set_cp_protect(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
@@ -477,7 +800,7 @@ static void a6xx_set_cp_protect(struct msm_gpu *gpu)
 	 * protect violation and select the last span to protect from the start
 	 * address all the way to the end of the register address space
 	 */
-	gpu_write(gpu, REG_A6XX_CP_PROTECT_CNTL,
+	static_write(gpu, REG_A6XX_CP_PROTECT_CNTL,
 		  A6XX_CP_PROTECT_CNTL_ACCESS_PROT_EN |
 		  A6XX_CP_PROTECT_CNTL_ACCESS_FAULT_ON_VIOL_EN |
 		  A6XX_CP_PROTECT_CNTL_LAST_SPAN_INF_RANGE);
@@ -485,10 +808,10 @@ static void a6xx_set_cp_protect(struct msm_gpu *gpu)
 	for (i = 0; i < protect->count - 1; i++) {
 		/* Intentionally skip writing to some registers */
 		if (protect->regs[i])
-			gpu_write(gpu, REG_A6XX_CP_PROTECT(i), protect->regs[i]);
+			static_write(gpu, REG_A6XX_CP_PROTECT(i), protect->regs[i]);
 	}
 	/* last CP_PROTECT to have "infinite" length on the last entry */
-	gpu_write(gpu, REG_A6XX_CP_PROTECT(protect->count_max - 1), protect->regs[i]);
+	static_write(gpu, REG_A6XX_CP_PROTECT(protect->count_max - 1), protect->regs[i]);
 }
 
 static void a6xx_calc_ubwc_config(struct adreno_gpu *gpu)
@@ -513,6 +836,7 @@ static void a6xx_calc_ubwc_config(struct adreno_gpu *gpu)
 		gpu->ubwc_config.ubwc_mode = 1;
 	}
 
+	/* Matches the MDSS sm7150_data, see a6xx_check_ubwc_config() */
 	if (adreno_is_a618(gpu))
 		gpu->ubwc_config.highest_bank_bit = 14;
 
@@ -552,6 +876,33 @@ static void a6xx_calc_ubwc_config(struct adreno_gpu *gpu)
 	}
 }
 
+/*
+ * UBWC buffers can only be shared with the display without a resolve if
+ * both sides agree on the DDR bank layout. The MDSS keeps its own copy of
+ * the highest bank bit, check it against ours.
+ */
+static void a6xx_check_ubwc_config(struct adreno_gpu *gpu,
+				   struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	const struct msm_mdss_data *mdss;
+	u32 hbb;
+
+	if (!priv->kms)
+		return;
+
+	mdss = msm_mdss_peek_data(dev->dev->parent);
+	if (IS_ERR_OR_NULL(mdss) || !mdss->ubwc_dec_version)
+		return;
+
+	/* The MDSS gets the highest bank bit minus 13, as the hardware */
+	hbb = mdss->highest_bank_bit + 13;
+	if (hbb != gpu->ubwc_config.highest_bank_bit)
+		DRM_DEV_ERROR(&gpu->base.pdev->dev,
+			      "UBWC highest bank bit %u of the GPU doesn't match %u of the display\n",
+			      gpu->ubwc_config.highest_bank_bit, hbb);
+}
+
 static void a6xx_set_ubwc_config(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
@@ -565,36 +916,137 @@ static void a6xx_set_ubwc_config(struct msm_gpu *gpu)
 	u32 hbb_hi = hbb >> 2;
 	u32 hbb_lo = hbb & 3;
 
-	gpu_write(gpu, REG_A6XX_RB_NC_MODE_CNTL,
+	static_write(gpu, REG_A6XX_RB_NC_MODE_CNTL,
 		  adreno_gpu->ubwc_config.rgb565_predicator << 11 |
 		  hbb_hi << 10 | adreno_gpu->ubwc_config.amsbc << 4 |
 		  adreno_gpu->ubwc_config.min_acc_len << 3 |
 		  hbb_lo << 1 | adreno_gpu->ubwc_config.ubwc_mode);
 
-	gpu_write(gpu, REG_A6XX_TPL1_NC_MODE_CNTL, hbb_hi << 4 |
+	static_write(gpu, REG_A6XX_TPL1_NC_MODE_CNTL, hbb_hi << 4 |
 		  adreno_gpu->ubwc_config.min_acc_len << 3 |
 		  hbb_lo << 1 | adreno_gpu->ubwc_config.ubwc_mode);
 
-	gpu_write(gpu, REG_A6XX_SP_NC_MODE_CNTL, hbb_hi << 10 |
+	static_write(gpu, REG_A6XX_SP_NC_MODE_CNTL, hbb_hi << 10 |
 		  adreno_gpu->ubwc_config.uavflagprd_inv << 4 |
 		  adreno_gpu->ubwc_config.min_acc_len << 3 |
 		  hbb_lo << 1 | adreno_gpu->ubwc_config.ubwc_mode);
 
 	if (adreno_is_a7xx(adreno_gpu))
-		gpu_write(gpu, REG_A7XX_GRAS_NC_MODE_CNTL,
+		static_write(gpu, REG_A7XX_GRAS_NC_MODE_CNTL,
 			  FIELD_PREP(GENMASK(8, 5), hbb_lo));
 
-	gpu_write(gpu, REG_A6XX_UCHE_MODE_CNTL,
+	static_write(gpu, REG_A6XX_UCHE_MODE_CNTL,
 		  adreno_gpu->ubwc_config.min_acc_len << 23 | hbb_lo << 21);
 }
 
+/* GX registers programmed at init that the CP must restore after IFPC */
+static const u32 a6xx_ifpc_pwrup_reglist[] = {
+	REG_A6XX_CP_CHICKEN_DBG,
+	REG_A6XX_CP_AHB_CNTL,
+	REG_A6XX_RBBM_PERFCTR_CNTL,
+	REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL,
+	REG_A6XX_UCHE_CLIENT_PF,
+};
+
+/* GX registers that also need to be restored when switching rings */
+static const u32 a6xx_pwrup_reglist[] = {
+	REG_A6XX_VSC_ADDR_MODE_CNTL,
+	REG_A6XX_GRAS_ADDR_MODE_CNTL,
+	REG_A6XX_RB_ADDR_MODE_CNTL,
+	REG_A6XX_PC_ADDR_MODE_CNTL,
+	REG_A6XX_HLSQ_ADDR_MODE_CNTL,
+	REG_A6XX_VFD_ADDR_MODE_CNTL,
+	REG_A6XX_VPC_ADDR_MODE_CNTL,
+	REG_A6XX_UCHE_ADDR_MODE_CNTL,
+	REG_A6XX_SP_ADDR_MODE_CNTL,
+	REG_A6XX_TPL1_ADDR_MODE_CNTL,
+	REG_A6XX_UCHE_WRITE_RANGE_MAX,
+	REG_A6XX_UCHE_WRITE_RANGE_MAX + 1,
+	REG_A6XX_UCHE_TRAP_BASE,
+	REG_A6XX_UCHE_TRAP_BASE + 1,
+	REG_A6XX_UCHE_WRITE_THRU_BASE,
+	REG_A6XX_UCHE_WRITE_THRU_BASE + 1,
+	REG_A6XX_UCHE_GMEM_RANGE_MIN,
+	REG_A6XX_UCHE_GMEM_RANGE_MIN + 1,
+	REG_A6XX_UCHE_GMEM_RANGE_MAX,
+	REG_A6XX_UCHE_GMEM_RANGE_MAX + 1,
+	REG_A6XX_UCHE_FILTER_CNTL,
+	REG_A6XX_UCHE_CACHE_WAYS,
+	REG_A6XX_UCHE_MODE_CNTL,
+	REG_A6XX_RB_NC_MODE_CNTL,
+	REG_A6XX_TPL1_NC_MODE_CNTL,
+	REG_A6XX_SP_NC_MODE_CNTL,
+	REG_A6XX_PC_DBG_ECO_CNTL,
+};
+
+/*
+ * Fill out the power up register list with the values hw_init() just
+ * programmed. This is done before the CP is started so there is no need to
+ * take the lock shared with the CP.
+ */
+static void a6xx_patch_pwrup_reglist(struct msm_gpu *gpu)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	const struct adreno_protect *protect = adreno_gpu->info->a6xx->protect;
+	struct a6xx_pwrup_lock *lock = a6xx_gpu->pwrup_reglist;
+	u32 *dest = (u32 *)(lock + 1);
+	u32 reg;
+	int i;
+
+	if (!a6xx_gpu->pwrup_reglist_bo)
+		return;
+
+	memset(lock, 0, sizeof(*lock));
+
+	/* IFPC only registers first, including the CP protect setup */
+	for (i = 0; i < ARRAY_SIZE(a6xx_ifpc_pwrup_reglist); i++) {
+		reg = a6xx_ifpc_pwrup_reglist[i];
+		*dest++ = reg;
+		*dest++ = gpu_read(gpu, reg);
+	}
+
+	/* CP0 counts the cycles reported in the submit stats */
+	*dest++ = REG_A6XX_CP_PERFCTR_CP_SEL(0);
+	*dest++ = gpu_read(gpu, REG_A6XX_CP_PERFCTR_CP_SEL(0));
+
+	*dest++ = REG_A6XX_CP_PROTECT_CNTL;
+	*dest++ = gpu_read(gpu, REG_A6XX_CP_PROTECT_CNTL);
+
+	for (i = 0; i < protect->count_max; i++) {
+		reg = REG_A6XX_CP_PROTECT(i);
+		*dest++ = reg;
+		*dest++ = gpu_read(gpu, reg);
+	}
+
+	lock->list_offset = dest - (u32 *)(lock + 1);
+
+	for (i = 0; i < ARRAY_SIZE(a6xx_pwrup_reglist); i++) {
+		reg = a6xx_pwrup_reglist[i];
+		*dest++ = reg;
+		*dest++ = gpu_read(gpu, reg);
+	}
+
+	lock->list_length = dest - (u32 *)(lock + 1);
+
+	/* Make sure the list is visible before the CP gets a chance to use it */
+	wmb();
+}
+
 static int a6xx_cp_init(struct msm_gpu *gpu)
 {
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
 	struct msm_ringbuffer *ring = gpu->rb[0];
+	u32 mask = 0x0000002f;
+
+	/* Enable the register init list with the spinlock */
+	if (a6xx_gpu->pwrup_reglist_bo)
+		mask |= BIT(8);
 
-	OUT_PKT7(ring, CP_ME_INIT, 8);
+	OUT_PKT7(ring, CP_ME_INIT, a6xx_gpu->pwrup_reglist_bo ? 9 : 8);
 
-	OUT_RING(ring, 0x0000002f);
+	OUT_RING(ring, mask);
 
 	/* Enable multiple hardware contexts */
 	OUT_RING(ring, 0x00000003);
@@ -609,14 +1061,61 @@ static int a6xx_cp_init(struct msm_gpu *gpu)
 	/* No workarounds enabled */
 	OUT_RING(ring, 0x00000000);
 
-	/* Pad rest of the cmds with 0's */
-	OUT_RING(ring, 0x00000000);
-	OUT_RING(ring, 0x00000000);
+	if (a6xx_gpu->pwrup_reglist_bo) {
+		/* The power up register list */
+		OUT_RING(ring, lower_32_bits(a6xx_gpu->pwrup_reglist_iova));
+		OUT_RING(ring, upper_32_bits(a6xx_gpu->pwrup_reglist_iova));
+		OUT_RING(ring, 0x00000000);
+	} else {
+		/* Pad rest of the cmds with 0's */
+		OUT_RING(ring, 0x00000000);
+		OUT_RING(ring, 0x00000000);
+	}
 
 	a6xx_flush(gpu, ring);
 	return a6xx_idle(gpu, ring) ? 0 : -EINVAL;
 }
 
+static int a6xx_preempt_start(struct msm_gpu *gpu)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	struct msm_ringbuffer *ring = gpu->rb[0];
+	u64 record = a6xx_gpu->preempt_iova[ring->id];
+
+	if (gpu->nr_rings <= 1)
+		return 0;
+
+	/* Set the save preemption record for the ring */
+	OUT_PKT7(ring, CP_SET_PSEUDO_REG, 6);
+	OUT_RING(ring, SMMU_INFO);
+	OUT_RING(ring, lower_32_bits(a6xx_gpu->preempt_smmu_iova[ring->id]));
+	OUT_RING(ring, upper_32_bits(a6xx_gpu->preempt_smmu_iova[ring->id]));
+	OUT_RING(ring, NON_SECURE_SAVE_ADDR);
+	OUT_RING(ring, lower_32_bits(record));
+	OUT_RING(ring, upper_32_bits(record));
+
+	OUT_PKT7(ring, CP_PREEMPT_ENABLE_GLOBAL, 1);
+	OUT_RING(ring, 0x00);
+
+	OUT_PKT7(ring, CP_PREEMPT_ENABLE_LOCAL, 1);
+	OUT_RING(ring, 0x01);
+
+	OUT_PKT7(ring, CP_YIELD_ENABLE, 1);
+	OUT_RING(ring, 0x01);
+
+	/* Yield the floor on command completion */
+	OUT_PKT7(ring, CP_CONTEXT_SWITCH_YIELD, 4);
+	OUT_RING(ring, 0x00);
+	OUT_RING(ring, 0x00);
+	OUT_RING(ring, 0x01);
+	OUT_RING(ring, 0x01);
+
+	a6xx_flush(gpu, ring);
+
+	return a6xx_idle(gpu, ring) ? 0 : -EINVAL;
+}
+
 static int a7xx_cp_init(struct msm_gpu *gpu)
 {
 	struct msm_ringbuffer *ring = gpu->rb[0];
@@ -766,6 +1265,13 @@ static int a6xx_ucode_load(struct msm_gpu *gpu)
 		}
 	}
 
+	if (!adreno_gpu->base.hw_apriv && !a6xx_gpu->has_whereami &&
+	    gpu->nr_rings > 1) {
+		/* Disable preemption if WHERE_AM_I isn't available */
+		a6xx_preempt_fini(gpu);
+		gpu->nr_rings = 1;
+	}
+
 	/*
 	 * Expanded APRIV and targets that support WHERE_AM_I both need a
 	 * privileged buffer to store the RPTR shadow
@@ -784,6 +1290,35 @@ static int a6xx_ucode_load(struct msm_gpu *gpu)
 		msm_gem_object_set_name(a6xx_gpu->shadow_bo, "shadow");
 	}
 
+	/*
+	 * IFPC needs the RPTR shadow as the CP registers can't be read while
+	 * GX is collapsed, and a list of registers for the CP to restore when
+	 * it powers back up.
+	 */
+	if (a6xx_gpu->gmu.idle_level == GMU_IDLE_STATE_IFPC && !a6xx_gpu->shadow_bo) {
+		DRM_DEV_INFO(&gpu->pdev->dev,
+			"Disabling IFPC, no RPTR shadow available\n");
+		a6xx_gpu->gmu.idle_level = GMU_IDLE_STATE_ACTIVE;
+	}
+
+	if (a6xx_gpu->gmu.idle_level == GMU_IDLE_STATE_IFPC &&
+	    !a6xx_gpu->pwrup_reglist_bo) {
+		a6xx_gpu->pwrup_reglist = msm_gem_kernel_new(gpu->dev, PAGE_SIZE,
+							     MSM_BO_WC | MSM_BO_MAP_PRIV,
+							     gpu->aspace,
+							     &a6xx_gpu->pwrup_reglist_bo,
+							     &a6xx_gpu->pwrup_reglist_iova);
+
+		if (IS_ERR(a6xx_gpu->pwrup_reglist)) {
+			int ret = PTR_ERR(a6xx_gpu->pwrup_reglist);
+
+			a6xx_gpu->pwrup_reglist_bo = NULL;
+			return ret;
+		}
+
+		msm_gem_object_set_name(a6xx_gpu->pwrup_reglist_bo, "pwrup_reglist");
+	}
+
 	return 0;
 }
 
@@ -803,6 +1338,7 @@ static int a6xx_zap_shader_init(struct msm_gpu *gpu)
 
 #define A6XX_INT_MASK (A6XX_RBBM_INT_0_MASK_CP_AHB_ERROR | \
 		       A6XX_RBBM_INT_0_MASK_RBBM_ATB_ASYNCFIFO_OVERFLOW | \
+		       A6XX_RBBM_INT_0_MASK_CP_SW | \
 		       A6XX_RBBM_INT_0_MASK_CP_HW_ERROR | \
 		       A6XX_RBBM_INT_0_MASK_CP_IB2 | \
 		       A6XX_RBBM_INT_0_MASK_CP_IB1 | \
@@ -837,66 +1373,33 @@ static int a6xx_zap_shader_init(struct msm_gpu *gpu)
 			   A6XX_CP_APRIV_CNTL_CDREAD | \
 			   A6XX_CP_APRIV_CNTL_CDWRITE)
 
-static int hw_init(struct msm_gpu *gpu)
+static void record_static_regs(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
 	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
-	struct a6xx_gmu *gmu = &a6xx_gpu->gmu;
 	u64 gmem_range_min;
-	int ret;
-
-	if (!adreno_has_gmu_wrapper(adreno_gpu)) {
-		/* Make sure the GMU keeps the GPU on while we set it up */
-		ret = a6xx_gmu_set_oob(&a6xx_gpu->gmu, GMU_OOB_GPU_SET);
-		if (ret)
-			return ret;
-	}
-
-	/* Clear GBIF halt in case GX domain was not collapsed */
-	if (adreno_is_a619_holi(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_GBIF_HALT, 0);
-		gpu_read(gpu, REG_A6XX_GBIF_HALT);
-
-		gpu_write(gpu, REG_A6XX_RBBM_GPR0_CNTL, 0);
-		gpu_read(gpu, REG_A6XX_RBBM_GPR0_CNTL);
-	} else if (a6xx_has_gbif(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_GBIF_HALT, 0);
-		gpu_read(gpu, REG_A6XX_GBIF_HALT);
-
-		gpu_write(gpu, REG_A6XX_RBBM_GBIF_HALT, 0);
-		gpu_read(gpu, REG_A6XX_RBBM_GBIF_HALT);
-	}
 
-	gpu_write(gpu, REG_A6XX_RBBM_SECVID_TSB_CNTL, 0);
-
-	if (adreno_is_a619_holi(adreno_gpu))
-		a6xx_sptprac_enable(gmu);
-
-	/*
-	 * Disable the trusted memory range - we don't actually supported secure
-	 * memory rendering at this point in time and we don't want to block off
-	 * part of the virtual memory space.
-	 */
-	gpu_write64(gpu, REG_A6XX_RBBM_SECVID_TSB_TRUSTED_BASE, 0x00000000);
-	gpu_write(gpu, REG_A6XX_RBBM_SECVID_TSB_TRUSTED_SIZE, 0x00000000);
+	a6xx_gpu->nr_recorded_regs = 0;
+	a6xx_gpu->recording_regs = true;
 
 	if (!adreno_is_a7xx(adreno_gpu)) {
 		/* Turn on 64 bit addressing for all blocks */
-		gpu_write(gpu, REG_A6XX_CP_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_VSC_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_GRAS_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_RB_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_PC_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_HLSQ_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_VFD_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_VPC_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_UCHE_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_SP_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_TPL1_ADDR_MODE_CNTL, 0x1);
-		gpu_write(gpu, REG_A6XX_RBBM_SECVID_TSB_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_CP_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_VSC_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_GRAS_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_RB_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_PC_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_HLSQ_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_VFD_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_VPC_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_UCHE_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_SP_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_TPL1_ADDR_MODE_CNTL, 0x1);
+		static_write(gpu, REG_A6XX_RBBM_SECVID_TSB_ADDR_MODE_CNTL, 0x1);
 	}
 
 	/* enable hardware clockgating */
+	a6xx_gpu->nr_pre_hwcg_regs = a6xx_gpu->nr_recorded_regs;
 	a6xx_set_hwcg(gpu, true);
 
 	/* VBIF/GBIF start*/
@@ -904,33 +1407,33 @@ static int hw_init(struct msm_gpu *gpu)
 	    adreno_is_a640_family(adreno_gpu) ||
 	    adreno_is_a650_family(adreno_gpu) ||
 	    adreno_is_a7xx(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_GBIF_QSB_SIDE0, 0x00071620);
-		gpu_write(gpu, REG_A6XX_GBIF_QSB_SIDE1, 0x00071620);
-		gpu_write(gpu, REG_A6XX_GBIF_QSB_SIDE2, 0x00071620);
-		gpu_write(gpu, REG_A6XX_GBIF_QSB_SIDE3, 0x00071620);
-		gpu_write(gpu, REG_A6XX_RBBM_GBIF_CLIENT_QOS_CNTL,
+		static_write(gpu, REG_A6XX_GBIF_QSB_SIDE0, 0x00071620);
+		static_write(gpu, REG_A6XX_GBIF_QSB_SIDE1, 0x00071620);
+		static_write(gpu, REG_A6XX_GBIF_QSB_SIDE2, 0x00071620);
+		static_write(gpu, REG_A6XX_GBIF_QSB_SIDE3, 0x00071620);
+		static_write(gpu, REG_A6XX_RBBM_GBIF_CLIENT_QOS_CNTL,
 			  adreno_is_a7xx(adreno_gpu) ? 0x2120212 : 0x3);
 	} else {
-		gpu_write(gpu, REG_A6XX_RBBM_VBIF_CLIENT_QOS_CNTL, 0x3);
+		static_write(gpu, REG_A6XX_RBBM_VBIF_CLIENT_QOS_CNTL, 0x3);
 	}
 
 	if (adreno_is_a630(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_VBIF_GATE_OFF_WRREQ_EN, 0x00000009);
+		static_write(gpu, REG_A6XX_VBIF_GATE_OFF_WRREQ_EN, 0x00000009);
 
 	if (adreno_is_a7xx(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_UCHE_GBIF_GX_CONFIG, 0x10240e0);
+		static_write(gpu, REG_A6XX_UCHE_GBIF_GX_CONFIG, 0x10240e0);
 
 	/* Make all blocks contribute to the GPU BUSY perf counter */
-	gpu_write(gpu, REG_A6XX_RBBM_PERFCTR_GPU_BUSY_MASKED, 0xffffffff);
+	static_write(gpu, REG_A6XX_RBBM_PERFCTR_GPU_BUSY_MASKED, 0xffffffff);
 
 	/* Disable L2 bypass in the UCHE */
 	if (adreno_is_a7xx(adreno_gpu)) {
-		gpu_write64(gpu, REG_A6XX_UCHE_TRAP_BASE, 0x0001fffffffff000llu);
-		gpu_write64(gpu, REG_A6XX_UCHE_WRITE_THRU_BASE, 0x0001fffffffff000llu);
+		static_write64(gpu, REG_A6XX_UCHE_TRAP_BASE, 0x0001fffffffff000llu);
+		static_write64(gpu, REG_A6XX_UCHE_WRITE_THRU_BASE, 0x0001fffffffff000llu);
 	} else {
-		gpu_write64(gpu, REG_A6XX_UCHE_WRITE_RANGE_MAX, 0x0001ffffffffffc0llu);
-		gpu_write64(gpu, REG_A6XX_UCHE_TRAP_BASE, 0x0001fffffffff000llu);
-		gpu_write64(gpu, REG_A6XX_UCHE_WRITE_THRU_BASE, 0x0001fffffffff000llu);
+		static_write64(gpu, REG_A6XX_UCHE_WRITE_RANGE_MAX, 0x0001ffffffffffc0llu);
+		static_write64(gpu, REG_A6XX_UCHE_TRAP_BASE, 0x0001fffffffff000llu);
+		static_write64(gpu, REG_A6XX_UCHE_WRITE_THRU_BASE, 0x0001fffffffff000llu);
 	}
 
 	if (!(adreno_is_a650_family(adreno_gpu) ||
@@ -939,136 +1442,123 @@ static int hw_init(struct msm_gpu *gpu)
 		gmem_range_min = adreno_is_a740_family(adreno_gpu) ? SZ_16M : SZ_1M;
 
 		/* Set the GMEM VA range [0x100000:0x100000 + gpu->gmem - 1] */
-		gpu_write64(gpu, REG_A6XX_UCHE_GMEM_RANGE_MIN, gmem_range_min);
+		static_write64(gpu, REG_A6XX_UCHE_GMEM_RANGE_MIN, gmem_range_min);
 
-		gpu_write64(gpu, REG_A6XX_UCHE_GMEM_RANGE_MAX,
+		static_write64(gpu, REG_A6XX_UCHE_GMEM_RANGE_MAX,
 			gmem_range_min + adreno_gpu->info->gmem - 1);
 	}
 
 	if (adreno_is_a7xx(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_UCHE_CACHE_WAYS, BIT(23));
+		static_write(gpu, REG_A6XX_UCHE_CACHE_WAYS, BIT(23));
 	else {
-		gpu_write(gpu, REG_A6XX_UCHE_FILTER_CNTL, 0x804);
-		gpu_write(gpu, REG_A6XX_UCHE_CACHE_WAYS, 0x4);
+		static_write(gpu, REG_A6XX_UCHE_FILTER_CNTL, 0x804);
+		static_write(gpu, REG_A6XX_UCHE_CACHE_WAYS, 0x4);
 	}
 
 	if (adreno_is_a640_family(adreno_gpu) || adreno_is_a650_family(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_2, 0x02000140);
-		gpu_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_1, 0x8040362c);
+		static_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_2, 0x02000140);
+		static_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_1, 0x8040362c);
 	} else if (adreno_is_a610_family(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_2, 0x00800060);
-		gpu_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_1, 0x40201b16);
+		static_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_2, 0x00800060);
+		static_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_1, 0x40201b16);
 	} else if (!adreno_is_a7xx(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_2, 0x010000c0);
-		gpu_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_1, 0x8040362c);
+		static_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_2, 0x010000c0);
+		static_write(gpu, REG_A6XX_CP_ROQ_THRESHOLDS_1, 0x8040362c);
 	}
 
 	if (adreno_is_a660_family(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_CP_LPAC_PROG_FIFO_SIZE, 0x00000020);
+		static_write(gpu, REG_A6XX_CP_LPAC_PROG_FIFO_SIZE, 0x00000020);
 
 	/* Setting the mem pool size */
 	if (adreno_is_a610(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_CP_MEM_POOL_SIZE, 48);
-		gpu_write(gpu, REG_A6XX_CP_MEM_POOL_DBG_ADDR, 47);
+		static_write(gpu, REG_A6XX_CP_MEM_POOL_SIZE, 48);
+		static_write(gpu, REG_A6XX_CP_MEM_POOL_DBG_ADDR, 47);
 	} else if (adreno_is_a702(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_CP_MEM_POOL_SIZE, 64);
-		gpu_write(gpu, REG_A6XX_CP_MEM_POOL_DBG_ADDR, 63);
+		static_write(gpu, REG_A6XX_CP_MEM_POOL_SIZE, 64);
+		static_write(gpu, REG_A6XX_CP_MEM_POOL_DBG_ADDR, 63);
 	} else if (!adreno_is_a7xx(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_CP_MEM_POOL_SIZE, 128);
+		static_write(gpu, REG_A6XX_CP_MEM_POOL_SIZE, 128);
 
 	/* Setting the primFifo thresholds default values,
 	 * and vccCacheSkipDis=1 bit (0x200) for A640 and newer
 	*/
 	if (adreno_is_a702(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x0000c000);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x0000c000);
 	else if (adreno_is_a690(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00800200);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00800200);
 	else if (adreno_is_a650(adreno_gpu) || adreno_is_a660(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00300200);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00300200);
 	else if (adreno_is_a640_family(adreno_gpu) || adreno_is_7c3(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00200200);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00200200);
 	else if (adreno_is_a650(adreno_gpu) || adreno_is_a660(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00300200);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00300200);
 	else if (adreno_is_a619(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00018000);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00018000);
 	else if (adreno_is_a610(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00080000);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00080000);
 	else if (!adreno_is_a7xx(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00180000);
+		static_write(gpu, REG_A6XX_PC_DBG_ECO_CNTL, 0x00180000);
 
 	/* Set the AHB default slave response to "ERROR" */
-	gpu_write(gpu, REG_A6XX_CP_AHB_CNTL, 0x1);
+	static_write(gpu, REG_A6XX_CP_AHB_CNTL, 0x1);
 
 	/* Turn on performance counters */
-	gpu_write(gpu, REG_A6XX_RBBM_PERFCTR_CNTL, 0x1);
-
-	if (adreno_is_a7xx(adreno_gpu)) {
-		/* Turn on the IFPC counter (countable 4 on XOCLK4) */
-		gmu_write(&a6xx_gpu->gmu, REG_A6XX_GMU_CX_GMU_POWER_COUNTER_SELECT_1,
-			  FIELD_PREP(GENMASK(7, 0), 0x4));
-	}
+	static_write(gpu, REG_A6XX_RBBM_PERFCTR_CNTL, 0x1);
 
 	/* Select CP0 to always count cycles */
-	gpu_write(gpu, REG_A6XX_CP_PERFCTR_CP_SEL(0), PERF_CP_ALWAYS_COUNT);
+	static_write(gpu, REG_A6XX_CP_PERFCTR_CP_SEL(0), PERF_CP_ALWAYS_COUNT);
 
 	a6xx_set_ubwc_config(gpu);
 
 	/* Enable fault detection */
 	if (adreno_is_a730(adreno_gpu) ||
 	    adreno_is_a740_family(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0xcfffff);
+		static_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0xcfffff);
 	else if (adreno_is_a690(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x4fffff);
+		static_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x4fffff);
 	else if (adreno_is_a619(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x3fffff);
+		static_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x3fffff);
 	else if (adreno_is_a610(adreno_gpu) || adreno_is_a702(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x3ffff);
+		static_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x3ffff);
 	else
-		gpu_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x1fffff);
+		static_write(gpu, REG_A6XX_RBBM_INTERFACE_HANG_INT_CNTL, (1 << 30) | 0x1fffff);
 
-	gpu_write(gpu, REG_A6XX_UCHE_CLIENT_PF, BIT(7) | 0x1);
+	static_write(gpu, REG_A6XX_UCHE_CLIENT_PF, BIT(7) | 0x1);
 
 	/* Set weights for bicubic filtering */
 	if (adreno_is_a650_family(adreno_gpu) || adreno_is_x185(adreno_gpu)) {
-		gpu_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_0, 0);
-		gpu_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_1,
+		static_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_0, 0);
+		static_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_1,
 			0x3fe05ff4);
-		gpu_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_2,
-			0x3fa0ebee);
-		gpu_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_3,
-			0x3f5193ed);
-		gpu_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_4,
-			0x3f0243f0);
-	}
-
-	/* Set up the CX GMU counter 0 to count busy ticks */
-	gmu_write(gmu, REG_A6XX_GPU_GMU_AO_GPU_CX_BUSY_MASK, 0xff000000);
-
-	/* Enable the power counter */
-	gmu_rmw(gmu, REG_A6XX_GMU_CX_GMU_POWER_COUNTER_SELECT_0, 0xff, BIT(5));
-	gmu_write(gmu, REG_A6XX_GMU_CX_GMU_POWER_COUNTER_ENABLE, 1);
+		static_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_2,
+			0x3fa0ebee);
+		static_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_3,
+			0x3f5193ed);
+		static_write(gpu, REG_A6XX_TPL1_BICUBIC_WEIGHTS_TABLE_4,
+			0x3f0243f0);
+	}
 
 	/* Protect registers from the CP */
 	a6xx_set_cp_protect(gpu);
 
 	if (adreno_is_a660_family(adreno_gpu)) {
 		if (adreno_is_a690(adreno_gpu))
-			gpu_write(gpu, REG_A6XX_CP_CHICKEN_DBG, 0x00028801);
+			static_write(gpu, REG_A6XX_CP_CHICKEN_DBG, 0x00028801);
 		else
-			gpu_write(gpu, REG_A6XX_CP_CHICKEN_DBG, 0x1);
-		gpu_write(gpu, REG_A6XX_RBBM_GBIF_CLIENT_QOS_CNTL, 0x0);
+			static_write(gpu, REG_A6XX_CP_CHICKEN_DBG, 0x1);
+		static_write(gpu, REG_A6XX_RBBM_GBIF_CLIENT_QOS_CNTL, 0x0);
 	} else if (adreno_is_a702(adreno_gpu)) {
 		/* Something to do with the HLSQ cluster */
-		gpu_write(gpu, REG_A6XX_CP_CHICKEN_DBG, BIT(24));
+		static_write(gpu, REG_A6XX_CP_CHICKEN_DBG, BIT(24));
 	}
 
 	if (adreno_is_a690(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_UCHE_CMDQ_CONFIG, 0x90);
+		static_write(gpu, REG_A6XX_UCHE_CMDQ_CONFIG, 0x90);
 	/* Set dualQ + disable afull for A660 GPU */
 	else if (adreno_is_a660(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_UCHE_CMDQ_CONFIG, 0x66906);
+		static_write(gpu, REG_A6XX_UCHE_CMDQ_CONFIG, 0x66906);
 	else if (adreno_is_a7xx(adreno_gpu))
-		gpu_write(gpu, REG_A6XX_UCHE_CMDQ_CONFIG,
+		static_write(gpu, REG_A6XX_UCHE_CMDQ_CONFIG,
 			  FIELD_PREP(GENMASK(19, 16), 6) |
 			  FIELD_PREP(GENMASK(15, 12), 6) |
 			  FIELD_PREP(GENMASK(11, 8), 9) |
@@ -1078,28 +1568,118 @@ static int hw_init(struct msm_gpu *gpu)
 	/* Enable expanded apriv for targets that support it */
 	if (gpu->hw_apriv) {
 		if (adreno_is_a7xx(adreno_gpu)) {
-			gpu_write(gpu, REG_A6XX_CP_APRIV_CNTL,
+			static_write(gpu, REG_A6XX_CP_APRIV_CNTL,
 				  A7XX_BR_APRIVMASK);
-			gpu_write(gpu, REG_A7XX_CP_BV_APRIV_CNTL,
+			static_write(gpu, REG_A7XX_CP_BV_APRIV_CNTL,
 				  A7XX_APRIV_MASK);
-			gpu_write(gpu, REG_A7XX_CP_LPAC_APRIV_CNTL,
+			static_write(gpu, REG_A7XX_CP_LPAC_APRIV_CNTL,
 				  A7XX_APRIV_MASK);
 		} else
-			gpu_write(gpu, REG_A6XX_CP_APRIV_CNTL,
+			static_write(gpu, REG_A6XX_CP_APRIV_CNTL,
 				  BIT(6) | BIT(5) | BIT(3) | BIT(2) | BIT(1));
 	}
 
 	if (adreno_is_a750(adreno_gpu)) {
 		/* Disable ubwc merged UFC request feature */
-		gpu_rmw(gpu, REG_A6XX_RB_CMP_DBG_ECO_CNTL, BIT(19), BIT(19));
+		static_rmw(gpu, REG_A6XX_RB_CMP_DBG_ECO_CNTL, BIT(19), BIT(19));
 
 		/* Enable TP flaghint and other performance settings */
-		gpu_write(gpu, REG_A6XX_TPL1_DBG_ECO_CNTL1, 0xc0700);
+		static_write(gpu, REG_A6XX_TPL1_DBG_ECO_CNTL1, 0xc0700);
 	} else if (adreno_is_a7xx(adreno_gpu)) {
 		/* Disable non-ubwc read reqs from passing write reqs */
-		gpu_rmw(gpu, REG_A6XX_RB_CMP_DBG_ECO_CNTL, BIT(11), BIT(11));
+		static_rmw(gpu, REG_A6XX_RB_CMP_DBG_ECO_CNTL, BIT(11), BIT(11));
+	}
+
+	if (a6xx_gpu->recording_regs)
+		a6xx_gpu->nr_static_regs = a6xx_gpu->nr_recorded_regs;
+	a6xx_gpu->recording_regs = false;
+}
+
+static int hw_init(struct msm_gpu *gpu)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	struct a6xx_gmu *gmu = &a6xx_gpu->gmu;
+	int ret, i;
+
+	if (!adreno_has_gmu_wrapper(adreno_gpu)) {
+		/* Make sure the GMU keeps the GPU on while we set it up */
+		ret = a6xx_gmu_set_oob(&a6xx_gpu->gmu, GMU_OOB_GPU_SET);
+		if (ret)
+			return ret;
+	}
+
+	/* Clear GBIF halt in case GX domain was not collapsed */
+	if (adreno_is_a619_holi(adreno_gpu)) {
+		gpu_write(gpu, REG_A6XX_GBIF_HALT, 0);
+		gpu_read(gpu, REG_A6XX_GBIF_HALT);
+
+		gpu_write(gpu, REG_A6XX_RBBM_GPR0_CNTL, 0);
+		gpu_read(gpu, REG_A6XX_RBBM_GPR0_CNTL);
+	} else if (a6xx_has_gbif(adreno_gpu)) {
+		gpu_write(gpu, REG_A6XX_GBIF_HALT, 0);
+		gpu_read(gpu, REG_A6XX_GBIF_HALT);
+
+		gpu_write(gpu, REG_A6XX_RBBM_GBIF_HALT, 0);
+		gpu_read(gpu, REG_A6XX_RBBM_GBIF_HALT);
+	}
+
+	gpu_write(gpu, REG_A6XX_RBBM_SECVID_TSB_CNTL, 0);
+
+	if (adreno_is_a619_holi(adreno_gpu))
+		a6xx_sptprac_enable(gmu);
+
+	/*
+	 * Disable the trusted memory range - we don't actually supported secure
+	 * memory rendering at this point in time and we don't want to block off
+	 * part of the virtual memory space.
+	 */
+	gpu_write64(gpu, REG_A6XX_RBBM_SECVID_TSB_TRUSTED_BASE, 0x00000000);
+	gpu_write(gpu, REG_A6XX_RBBM_SECVID_TSB_TRUSTED_SIZE, 0x00000000);
+
+	/* Replay the target specific setup if it was recorded already: */
+	if (a6xx_gpu->nr_static_regs) {
+		for (i = 0; i < a6xx_gpu->nr_pre_hwcg_regs; i++)
+			gpu_write(gpu, a6xx_gpu->static_regs[i].offset,
+				  a6xx_gpu->static_regs[i].value);
+
+		/* enable hardware clockgating */
+		a6xx_set_hwcg(gpu, true);
+
+		for (; i < a6xx_gpu->nr_static_regs; i++)
+			gpu_write(gpu, a6xx_gpu->static_regs[i].offset,
+				  a6xx_gpu->static_regs[i].value);
+	} else {
+		record_static_regs(gpu);
+	}
+
+	if (a6xx_gpu->llc_sample_misses) {
+		gpu_write(gpu, REG_A6XX_UCHE_PERFCTR_UCHE_SEL(0) + A6XX_LLC_CNTR_BEATS,
+			  A6XX_UCHE_VBIF_READ_BEATS_TP);
+		gpu_write(gpu, REG_A6XX_UCHE_PERFCTR_UCHE_SEL(0) + A6XX_LLC_CNTR_REQS,
+			  A6XX_UCHE_READ_REQUESTS_TP);
+	}
+
+	if (a6xx_gpu->bw_vote) {
+		gpu_write(gpu, REG_A6XX_UCHE_PERFCTR_UCHE_SEL(0) + A6XX_BW_CNTR_CH0,
+			  A6XX_UCHE_VBIF_READ_BEATS_CH0);
+		gpu_write(gpu, REG_A6XX_UCHE_PERFCTR_UCHE_SEL(0) + A6XX_BW_CNTR_CH1,
+			  A6XX_UCHE_VBIF_READ_BEATS_CH1);
 	}
 
+	if (adreno_is_a7xx(adreno_gpu)) {
+		/* Turn on the IFPC counter (countable 4 on XOCLK4) */
+		gmu_write(&a6xx_gpu->gmu, REG_A6XX_GMU_CX_GMU_POWER_COUNTER_SELECT_1,
+			  FIELD_PREP(GENMASK(7, 0), 0x4));
+	}
+
+	/* Set up the CX GMU counter 0 to count busy ticks */
+	gmu_write(gmu, REG_A6XX_GPU_GMU_AO_GPU_CX_BUSY_MASK, 0xff000000);
+
+	/* Enable the power counter */
+	gmu_rmw(gmu, REG_A6XX_GMU_CX_GMU_POWER_COUNTER_SELECT_0, 0xff, BIT(5));
+	gmu_write(gmu, REG_A6XX_GMU_CX_GMU_POWER_COUNTER_ENABLE, 1);
+
 	/* Enable interrupts */
 	gpu_write(gpu, REG_A6XX_RBBM_INT_0_MASK,
 		  adreno_is_a7xx(adreno_gpu) ? A7XX_INT_MASK : A6XX_INT_MASK);
@@ -1135,10 +1715,15 @@ static int hw_init(struct msm_gpu *gpu)
 			    rbmemptr(gpu->rb[0], bv_fence));
 	}
 
-	/* Always come up on rb 0 */
-	a6xx_gpu->cur_ring = gpu->rb[0];
+	/* Always come up on rb 0, and set up preemption if enabled */
+	a6xx_preempt_hw_init(gpu);
 
 	gpu->cur_ctx_seqno = 0;
+	for (i = 0; i < gpu->nr_rings; i++)
+		gpu->rb[i]->cur_ctx_seqno = 0;
+
+	/* Record what the CP has to restore when coming back from IFPC */
+	a6xx_patch_pwrup_reglist(gpu);
 
 	/* Enable the SQE_to start the CP engine */
 	gpu_write(gpu, REG_A6XX_CP_SQE_CNTL, 1);
@@ -1147,6 +1732,10 @@ static int hw_init(struct msm_gpu *gpu)
 	if (ret)
 		goto out;
 
+	ret = a6xx_preempt_start(gpu);
+	if (ret)
+		goto out;
+
 	/*
 	 * Try to load a zap shader into the secure world. If successful
 	 * we can use the CP to switch out of secure mode. If not then we
@@ -1198,12 +1787,26 @@ static int a6xx_hw_init(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
 	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	bool replay = a6xx_gpu->nr_static_regs;
 	int ret;
 
 	mutex_lock(&a6xx_gpu->gmu.lock);
 	ret = hw_init(gpu);
 	mutex_unlock(&a6xx_gpu->gmu.lock);
 
+	/* Only account the hw_init() that completes a runtime resume: */
+	if (!ret && a6xx_gpu->resume_start) {
+		u64 us = ktime_us_delta(ktime_get(), a6xx_gpu->resume_start);
+		struct a6xx_resume_stats *stats = &a6xx_gpu->resume_stats[replay];
+
+		stats->count++;
+		stats->total_us += us;
+		stats->last_us = us;
+		stats->max_us = max(stats->max_us, us);
+	}
+
+	a6xx_gpu->resume_start = 0;
+
 	return ret;
 }
 
@@ -1214,6 +1817,58 @@ static void a6xx_dump(struct msm_gpu *gpu)
 	adreno_dump(gpu);
 }
 
+/*
+ * Try to recover by only resetting the GPU core and re-initializing the CP,
+ * while the GMU keeps the GX domain powered.  This avoids the much slower
+ * GMU power cycle of a full recovery, but is only possible if the GMU
+ * itself is still responsive.
+ */
+static bool a6xx_soft_recover(struct msm_gpu *gpu)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	struct a6xx_gmu *gmu = &a6xx_gpu->gmu;
+	int ret;
+
+	if (!adreno_is_a618(adreno_gpu) || gmu->hung)
+		return false;
+
+	mutex_lock(&gmu->lock);
+
+	/* Keep GX on (and out of IFPC) across the reset: */
+	ret = a6xx_gmu_set_oob(gmu, GMU_OOB_GPU_SET);
+	if (ret) {
+		mutex_unlock(&gmu->lock);
+		return false;
+	}
+
+	disable_irq(gpu->irq);
+
+	/* Drain the outstanding traffic on memory buses */
+	a6xx_bus_clear_pending_transactions(adreno_gpu, false);
+
+	a6xx_gpu_sw_reset(gpu, true);
+	a6xx_gpu_sw_reset(gpu, false);
+
+	enable_irq(gpu->irq);
+
+	a6xx_gmu_clear_oob(gmu, GMU_OOB_GPU_SET);
+
+	mutex_unlock(&gmu->lock);
+
+	gpu->needs_hw_init = true;
+	ret = msm_gpu_hw_init(gpu);
+	if (ret) {
+		DRM_DEV_ERROR(&gpu->pdev->dev,
+			      "soft reset failed: %d, power cycling\n", ret);
+		return false;
+	}
+
+	gpu->recovery.soft++;
+
+	return true;
+}
+
 static void a6xx_recover(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
@@ -1239,6 +1894,11 @@ static void a6xx_recover(struct msm_gpu *gpu)
 	/* Halt SQE first */
 	gpu_write(gpu, REG_A6XX_CP_SQE_CNTL, 3);
 
+	if (a6xx_soft_recover(gpu)) {
+		a6xx_gpu->hung = false;
+		return;
+	}
+
 	pm_runtime_dont_use_autosuspend(&gpu->pdev->dev);
 
 	/* active_submit won't change until we make a submission */
@@ -1529,7 +2189,12 @@ static void a7xx_sw_fuse_violation_irq(struct msm_gpu *gpu)
 static irqreturn_t a6xx_irq(struct msm_gpu *gpu)
 {
 	struct msm_drm_private *priv = gpu->dev->dev_private;
-	u32 status = gpu_read(gpu, REG_A6XX_RBBM_INT_0_STATUS);
+	u32 status;
+
+	/* Don't let GX collapse while the interrupt is being handled */
+	a6xx_gpu_keepalive_vote(gpu, true);
+
+	status = gpu_read(gpu, REG_A6XX_RBBM_INT_0_STATUS);
 
 	gpu_write(gpu, REG_A6XX_RBBM_INT_CLEAR_CMD, status);
 
@@ -1557,14 +2222,26 @@ static irqreturn_t a6xx_irq(struct msm_gpu *gpu)
 	if (status & A6XX_RBBM_INT_0_MASK_SWFUSEVIOLATION)
 		a7xx_sw_fuse_violation_irq(gpu);
 
-	if (status & A6XX_RBBM_INT_0_MASK_CP_CACHE_FLUSH_TS)
+	if (status & A6XX_RBBM_INT_0_MASK_CP_CACHE_FLUSH_TS) {
+		a6xx_preempt_trigger(gpu);
 		msm_gpu_retire(gpu);
+	}
+
+	if (status & A6XX_RBBM_INT_0_MASK_CP_SW)
+		a6xx_preempt_irq(gpu);
+
+	/* On a hang the vote is kept until recovery collapses the GMU */
+	if (!(status & A6XX_RBBM_INT_0_MASK_RBBM_HANG_DETECT))
+		a6xx_gpu_keepalive_vote(gpu, false);
 
 	return IRQ_HANDLED;
 }
 
 static void a6xx_llc_deactivate(struct a6xx_gpu *a6xx_gpu)
 {
+	if (a6xx_gpu->llc_max_kb)
+		cancel_delayed_work_sync(&a6xx_gpu->llc_work);
+
 	llcc_slice_deactivate(a6xx_gpu->llc_slice);
 	llcc_slice_deactivate(a6xx_gpu->htw_llc_slice);
 }
@@ -1814,6 +2491,7 @@ static int a6xx_gmu_pm_resume(struct msm_gpu *gpu)
 	int ret;
 
 	gpu->needs_hw_init = true;
+	a6xx_gpu->resume_start = ktime_get();
 
 	trace_msm_gpu_resume(0);
 
@@ -1827,6 +2505,11 @@ static int a6xx_gmu_pm_resume(struct msm_gpu *gpu)
 
 	adreno_is_a7xx(adreno_gpu) ? a7xx_llc_activate(a6xx_gpu) : a6xx_llc_activate(a6xx_gpu);
 
+	if (a6xx_gpu->llc_max_kb) {
+		a6xx_gpu->llc_time = 0;
+		queue_delayed_work(system_wq, &a6xx_gpu->llc_work, 0);
+	}
+
 	return ret;
 }
 
@@ -1840,6 +2523,7 @@ static int a6xx_pm_resume(struct msm_gpu *gpu)
 	int ret;
 
 	gpu->needs_hw_init = true;
+	a6xx_gpu->resume_start = ktime_get();
 
 	trace_msm_gpu_resume(0);
 
@@ -1881,6 +2565,15 @@ static int a6xx_pm_resume(struct msm_gpu *gpu)
 	return ret;
 }
 
+/* Back to the OPP bandwidth until the first sample after resume */
+static void a6xx_bw_reset(struct a6xx_gpu *a6xx_gpu)
+{
+	if (a6xx_gpu->bw_opp)
+		dev_pm_opp_put(a6xx_gpu->bw_opp);
+	a6xx_gpu->bw_opp = NULL;
+	a6xx_gpu->bw_sampled = false;
+}
+
 static int a6xx_gmu_pm_suspend(struct msm_gpu *gpu)
 {
 	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
@@ -1895,6 +2588,7 @@ static int a6xx_gmu_pm_suspend(struct msm_gpu *gpu)
 
 	mutex_lock(&a6xx_gpu->gmu.lock);
 	ret = a6xx_gmu_stop(a6xx_gpu);
+	a6xx_bw_reset(a6xx_gpu);
 	mutex_unlock(&a6xx_gpu->gmu.lock);
 	if (ret)
 		return ret;
@@ -1992,8 +2686,17 @@ static void a6xx_destroy(struct msm_gpu *gpu)
 		drm_gem_object_put(a6xx_gpu->shadow_bo);
 	}
 
+	if (a6xx_gpu->pwrup_reglist_bo) {
+		msm_gem_unpin_iova(a6xx_gpu->pwrup_reglist_bo, gpu->aspace);
+		drm_gem_object_put(a6xx_gpu->pwrup_reglist_bo);
+	}
+
+	a6xx_preempt_fini(gpu);
+
 	a6xx_llc_slices_destroy(a6xx_gpu);
 
+	a6xx_bw_reset(a6xx_gpu);
+
 	a6xx_gmu_remove(a6xx_gpu);
 
 	adreno_gpu_cleanup(adreno_gpu);
@@ -2017,6 +2720,240 @@ static u64 a6xx_gpu_busy(struct msm_gpu *gpu, unsigned long *out_sample_rate)
 	return busy_cycles;
 }
 
+/*
+ * GPU LLC slice sizing:
+ *
+ * Rather than holding on to the full GPU slice for as long as the GPU is
+ * resumed, periodically sample how busy the GPU has been, and (on a6xx)
+ * how many of the texture fetches miss in UCHE and go out to memory, to
+ * resize the slice in steps of a quarter of its full size.  The slice
+ * grows while the GPU is busy and the texture miss rate is high, and
+ * shrinks back when the misses drop off, or down to the smallest step
+ * when the GPU is near idle, giving the capacity back to the CPUs.
+ */
+#define A6XX_LLC_RESIZE_MS	100
+#define A6XX_LLC_IDLE_PCT	10
+#define A6XX_LLC_BUSY_PCT	50
+
+/* Memory read beats for texture fetches per 100 UCHE TP requests: */
+#define A6XX_LLC_MISS_HIGH	50
+#define A6XX_LLC_MISS_LOW	25
+
+static void a6xx_llc_resize_work(struct work_struct *work)
+{
+	struct a6xx_gpu *a6xx_gpu =
+		container_of(to_delayed_work(work), struct a6xx_gpu, llc_work);
+	struct msm_gpu *gpu = &a6xx_gpu->base.base;
+	u32 step = a6xx_gpu->llc_max_kb / 4;
+	u64 busy_cycles, busy_us, beats = 0, reqs = 0;
+	unsigned long sample_rate;
+	u32 busy, miss, kb;
+	ktime_t time;
+	s64 elapsed;
+
+	if (pm_runtime_get_if_in_use(&gpu->pdev->dev) <= 0)
+		return;
+
+	time = ktime_get();
+	busy_cycles = a6xx_gpu_busy(gpu, &sample_rate);
+	if (a6xx_gpu->llc_sample_misses) {
+		beats = gpu_read64(gpu, REG_A6XX_RBBM_PERFCTR_UCHE(0) +
+				   (A6XX_LLC_CNTR_BEATS * 2));
+		reqs = gpu_read64(gpu, REG_A6XX_RBBM_PERFCTR_UCHE(0) +
+				  (A6XX_LLC_CNTR_REQS * 2));
+	}
+
+	pm_runtime_put_autosuspend(&gpu->pdev->dev);
+
+	/* The first sample after resume only sets the baseline: */
+	if (!a6xx_gpu->llc_time)
+		goto out;
+
+	elapsed = ktime_us_delta(time, a6xx_gpu->llc_time);
+	if (elapsed <= 0)
+		goto out;
+
+	busy_us = div64_ul((busy_cycles - a6xx_gpu->llc_busy_cycles) * USEC_PER_SEC,
+			   sample_rate);
+	busy = min_t(u64, div64_u64(busy_us * 100, elapsed), 100);
+
+	/* Without the UCHE counters, size the slice by busyness alone: */
+	miss = A6XX_LLC_MISS_HIGH;
+	if (a6xx_gpu->llc_sample_misses) {
+		u64 nr_beats = beats - a6xx_gpu->llc_tp_beats;
+		u64 nr_reqs = reqs - a6xx_gpu->llc_tp_reqs;
+
+		miss = nr_reqs ?
+			min_t(u64, div64_u64(nr_beats * 100, nr_reqs), U32_MAX) : 0;
+	}
+
+	kb = a6xx_gpu->llc_kb;
+	if (busy < A6XX_LLC_IDLE_PCT)
+		kb = step;
+	else if (busy >= A6XX_LLC_BUSY_PCT && miss >= A6XX_LLC_MISS_HIGH)
+		kb = min(kb + step, a6xx_gpu->llc_max_kb);
+	else if (miss < A6XX_LLC_MISS_LOW && kb > step)
+		kb -= step;
+
+	if (kb != a6xx_gpu->llc_kb &&
+	    !llcc_slice_reconfigure(a6xx_gpu->llc_slice, kb,
+				    a6xx_gpu->llc_bonus_ways,
+				    a6xx_gpu->llc_res_ways))
+		a6xx_gpu->llc_kb = kb;
+
+out:
+	a6xx_gpu->llc_time = time;
+	a6xx_gpu->llc_busy_cycles = busy_cycles;
+	a6xx_gpu->llc_tp_beats = beats;
+	a6xx_gpu->llc_tp_reqs = reqs;
+
+	queue_delayed_work(system_wq, &a6xx_gpu->llc_work,
+			   msecs_to_jiffies(A6XX_LLC_RESIZE_MS));
+}
+
+static void a6xx_llc_resize_init(struct a6xx_gpu *a6xx_gpu)
+{
+	struct adreno_gpu *adreno_gpu = &a6xx_gpu->base;
+
+	if (!llc_resize || IS_ERR_OR_NULL(a6xx_gpu->llc_slice))
+		return;
+
+	if (llcc_get_slice_ways(a6xx_gpu->llc_slice, &a6xx_gpu->llc_bonus_ways,
+				&a6xx_gpu->llc_res_ways))
+		return;
+
+	a6xx_gpu->llc_max_kb = llcc_get_slice_size(a6xx_gpu->llc_slice);
+	a6xx_gpu->llc_kb = a6xx_gpu->llc_max_kb;
+	if (a6xx_gpu->llc_max_kb < 4) {
+		a6xx_gpu->llc_max_kb = 0;
+		return;
+	}
+
+	/*
+	 * The counters restart from zero whenever GX comes back from IFPC,
+	 * which the kernel can't tell, see a6xx_bw_vote_init():
+	 */
+	a6xx_gpu->llc_sample_misses = !adreno_is_a7xx(adreno_gpu) &&
+		!(adreno_gpu->info->quirks & ADRENO_QUIRK_IFPC);
+
+	INIT_DELAYED_WORK(&a6xx_gpu->llc_work, a6xx_llc_resize_work);
+}
+
+/*
+ * DDR bandwidth voting:
+ *
+ * Every GPU OPP carries the DDR bandwidth vote for the worst case at that
+ * frequency, which keeps the bus up even for shader bound work that hardly
+ * touches memory.  Instead, measure the UCHE read traffic to memory over
+ * every devfreq sampling period and vote for the lowest OPP bandwidth that
+ * covers it, whatever the GPU frequency.  Writes aren't counted by UCHE,
+ * they are covered by the headroom on top of the reads.
+ */
+#define A6XX_UCHE_BEAT_BYTES	32
+#define A6XX_BW_HEADROOM_PCT	50
+
+static void a6xx_gpu_update_bw(struct msm_gpu *gpu, u64 elapsed_us)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+	struct device *dev = &gpu->pdev->dev;
+	struct dev_pm_opp *opp;
+	unsigned int kbps;
+	u64 beats, bytes;
+
+	if (!a6xx_gpu->bw_vote)
+		return;
+
+	beats = gpu_read64(gpu, REG_A6XX_RBBM_PERFCTR_UCHE(0) +
+			   (A6XX_BW_CNTR_CH0 * 2)) +
+		gpu_read64(gpu, REG_A6XX_RBBM_PERFCTR_UCHE(0) +
+			   (A6XX_BW_CNTR_CH1 * 2));
+
+	bytes = (beats - a6xx_gpu->bw_beats) * A6XX_UCHE_BEAT_BYTES;
+	a6xx_gpu->bw_beats = beats;
+
+	/* The first sample after resume only sets the baseline: */
+	if (!a6xx_gpu->bw_sampled || !elapsed_us) {
+		a6xx_gpu->bw_sampled = true;
+		return;
+	}
+
+	/* bytes per usec is MB/s, and the OPP bandwidth is in kB/s: */
+	kbps = min_t(u64, div64_u64(bytes * 10 * (100 + A6XX_BW_HEADROOM_PCT),
+				    elapsed_us), U32_MAX);
+
+	opp = dev_pm_opp_find_bw_ceil(dev, &kbps, 0);
+	if (IS_ERR(opp)) {
+		/* More than the highest level, vote for that one: */
+		kbps = U32_MAX;
+		opp = dev_pm_opp_find_bw_floor(dev, &kbps, 0);
+		if (IS_ERR(opp))
+			return;
+	}
+
+	mutex_lock(&a6xx_gpu->gmu.lock);
+	if (opp != a6xx_gpu->bw_opp) {
+		dev_pm_opp_set_opp(dev, opp);
+		swap(opp, a6xx_gpu->bw_opp);
+	}
+	mutex_unlock(&a6xx_gpu->gmu.lock);
+
+	if (opp)
+		dev_pm_opp_put(opp);
+}
+
+static void a6xx_bw_vote_init(struct a6xx_gpu *a6xx_gpu)
+{
+	struct adreno_gpu *adreno_gpu = &a6xx_gpu->base;
+	struct device *dev = &adreno_gpu->base.pdev->dev;
+	unsigned int kbps = U32_MAX;
+	struct dev_pm_opp *opp;
+
+	/*
+	 * With IFPC, GX collapses between frames and the counters restart
+	 * from zero when it comes back, without the kernel being told.  The
+	 * traffic counted up to the collapse is lost, so the vote can't be
+	 * derived from them there.  Keeping GX on to read them would also
+	 * defeat IFPC on every devfreq sample.
+	 */
+	if (!bw_vote || adreno_is_a7xx(adreno_gpu) ||
+	    (adreno_gpu->info->quirks & ADRENO_QUIRK_IFPC))
+		return;
+
+	/* Nothing to do if the OPPs don't vote for any bandwidth: */
+	opp = dev_pm_opp_find_bw_floor(dev, &kbps, 0);
+	if (IS_ERR(opp))
+		return;
+	dev_pm_opp_put(opp);
+
+	a6xx_gpu->bw_vote = true;
+}
+
+/*
+ * Hand the perfcntr ioctl the counter groups, minus the counters the kernel
+ * ended up sampling itself:
+ */
+static void a6xx_perfcntr_init(struct a6xx_gpu *a6xx_gpu)
+{
+	struct msm_gpu *gpu = &a6xx_gpu->base.base;
+	struct msm_perfcntr_group *uche;
+
+	BUILD_BUG_ON(ARRAY_SIZE(a6xx_perfcntr_groups) >
+		     ARRAY_SIZE(a6xx_gpu->perfcntr_groups));
+
+	memcpy(a6xx_gpu->perfcntr_groups, a6xx_perfcntr_groups,
+	       sizeof(a6xx_perfcntr_groups));
+
+	uche = &a6xx_gpu->perfcntr_groups[MSM_PERFCNTR_GROUP_UCHE];
+	if (a6xx_gpu->llc_sample_misses)
+		uche->nr_counters = min_t(u32, uche->nr_counters, A6XX_LLC_CNTR_BEATS);
+	if (a6xx_gpu->bw_vote)
+		uche->nr_counters = min_t(u32, uche->nr_counters, A6XX_BW_CNTR_CH0);
+
+	gpu->perfcntr_groups = a6xx_gpu->perfcntr_groups;
+	gpu->nr_perfcntr_groups = ARRAY_SIZE(a6xx_perfcntr_groups);
+}
+
 static void a6xx_gpu_set_freq(struct msm_gpu *gpu, struct dev_pm_opp *opp,
 			      bool suspended)
 {
@@ -2028,6 +2965,17 @@ static void a6xx_gpu_set_freq(struct msm_gpu *gpu, struct dev_pm_opp *opp,
 	mutex_unlock(&a6xx_gpu->gmu.lock);
 }
 
+static void a6xx_gpu_set_freq_limits(struct msm_gpu *gpu, unsigned long min_freq,
+				     unsigned long max_freq, bool suspended)
+{
+	struct adreno_gpu *adreno_gpu = to_adreno_gpu(gpu);
+	struct a6xx_gpu *a6xx_gpu = to_a6xx_gpu(adreno_gpu);
+
+	mutex_lock(&a6xx_gpu->gmu.lock);
+	a6xx_gmu_set_freq_limits(gpu, min_freq, max_freq, suspended);
+	mutex_unlock(&a6xx_gpu->gmu.lock);
+}
+
 static struct msm_gem_address_space *
 a6xx_create_address_space(struct msm_gpu *gpu, struct platform_device *pdev)
 {
@@ -2074,14 +3022,17 @@ static uint32_t a6xx_get_rptr(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
 
 static bool a6xx_progress(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
 {
-	struct msm_cp_state cp_state = {
-		.ib1_base = gpu_read64(gpu, REG_A6XX_CP_IB1_BASE),
-		.ib2_base = gpu_read64(gpu, REG_A6XX_CP_IB2_BASE),
-		.ib1_rem  = gpu_read(gpu, REG_A6XX_CP_IB1_REM_SIZE),
-		.ib2_rem  = gpu_read(gpu, REG_A6XX_CP_IB2_REM_SIZE),
-	};
+	struct msm_cp_state cp_state;
 	bool progress;
 
+	/* The ring may have just drained, don't let GX collapse under us */
+	a6xx_gpu_keepalive_vote(gpu, true);
+
+	cp_state.ib1_base = gpu_read64(gpu, REG_A6XX_CP_IB1_BASE);
+	cp_state.ib2_base = gpu_read64(gpu, REG_A6XX_CP_IB2_BASE);
+	cp_state.ib1_rem  = gpu_read(gpu, REG_A6XX_CP_IB1_REM_SIZE);
+	cp_state.ib2_rem  = gpu_read(gpu, REG_A6XX_CP_IB2_REM_SIZE);
+
 	/*
 	 * Adjust the remaining data to account for what has already been
 	 * fetched from memory, but not yet consumed by the SQE.
@@ -2098,6 +3049,8 @@ static bool a6xx_progress(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
 	cp_state.ib1_rem += gpu_read(gpu, REG_A6XX_CP_ROQ_AVAIL_IB1) >> 16;
 	cp_state.ib2_rem += gpu_read(gpu, REG_A6XX_CP_ROQ_AVAIL_IB2) >> 16;
 
+	a6xx_gpu_keepalive_vote(gpu, false);
+
 	progress = !!memcmp(&cp_state, &ring->last_cp_state, sizeof(cp_state));
 
 	ring->last_cp_state = cp_state;
@@ -2152,6 +3105,37 @@ static int a6xx_set_supported_hw(struct device *dev, const struct adreno_info *i
 	return 0;
 }
 
+#if defined(CONFIG_DEBUG_FS)
+static int a6xx_resume_latency_show(struct seq_file *m, void *arg)
+{
+	static const char * const names[] = { "full", "replayed" };
+	struct a6xx_gpu *a6xx_gpu = m->private;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(a6xx_gpu->resume_stats); i++) {
+		struct a6xx_resume_stats *stats = &a6xx_gpu->resume_stats[i];
+
+		seq_printf(m, "%-8s: count=%llu avg=%llu last=%llu max=%llu us\n",
+			   names[i], stats->count,
+			   stats->count ? div64_u64(stats->total_us, stats->count) : 0,
+			   stats->last_us, stats->max_us);
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(a6xx_resume_latency);
+
+static void a6xx_debugfs_init(struct msm_gpu *gpu, struct drm_minor *minor)
+{
+	if (!minor)
+		return;
+
+	debugfs_create_file("resume_latency", 0400, minor->debugfs_root,
+			    to_a6xx_gpu(to_adreno_gpu(gpu)),
+			    &a6xx_resume_latency_fops);
+}
+#endif
+
 static const struct adreno_gpu_funcs funcs = {
 	.base = {
 		.get_param = adreno_get_param,
@@ -2162,15 +3146,21 @@ static const struct adreno_gpu_funcs funcs = {
 		.pm_resume = a6xx_gmu_pm_resume,
 		.recover = a6xx_recover,
 		.submit = a6xx_submit,
+		.flush = a6xx_flush_batch,
 		.active_ring = a6xx_active_ring,
 		.irq = a6xx_irq,
 		.destroy = a6xx_destroy,
 #if defined(CONFIG_DRM_MSM_GPU_STATE)
 		.show = a6xx_show,
+#endif
+#if defined(CONFIG_DEBUG_FS)
+		.debugfs_init = a6xx_debugfs_init,
 #endif
 		.gpu_busy = a6xx_gpu_busy,
 		.gpu_get_freq = a6xx_gmu_get_freq,
 		.gpu_set_freq = a6xx_gpu_set_freq,
+		.gpu_set_freq_limits = a6xx_gpu_set_freq_limits,
+		.gpu_update_bw = a6xx_gpu_update_bw,
 #if defined(CONFIG_DRM_MSM_GPU_STATE)
 		.gpu_state_get = a6xx_gpu_state_get,
 		.gpu_state_put = a6xx_gpu_state_put,
@@ -2179,6 +3169,7 @@ static const struct adreno_gpu_funcs funcs = {
 		.create_private_address_space = a6xx_create_private_address_space,
 		.get_rptr = a6xx_get_rptr,
 		.progress = a6xx_progress,
+		.submitqueue_setup = a6xx_preempt_submitqueue_setup,
 	},
 	.get_timestamp = a6xx_gmu_get_timestamp,
 };
@@ -2193,11 +3184,15 @@ static const struct adreno_gpu_funcs funcs_gmuwrapper = {
 		.pm_resume = a6xx_pm_resume,
 		.recover = a6xx_recover,
 		.submit = a6xx_submit,
+		.flush = a6xx_flush_batch,
 		.active_ring = a6xx_active_ring,
 		.irq = a6xx_irq,
 		.destroy = a6xx_destroy,
 #if defined(CONFIG_DRM_MSM_GPU_STATE)
 		.show = a6xx_show,
+#endif
+#if defined(CONFIG_DEBUG_FS)
+		.debugfs_init = a6xx_debugfs_init,
 #endif
 		.gpu_busy = a6xx_gpu_busy,
 #if defined(CONFIG_DRM_MSM_GPU_STATE)
@@ -2222,11 +3217,15 @@ static const struct adreno_gpu_funcs funcs_a7xx = {
 		.pm_resume = a6xx_gmu_pm_resume,
 		.recover = a6xx_recover,
 		.submit = a7xx_submit,
+		.flush = a6xx_flush,
 		.active_ring = a6xx_active_ring,
 		.irq = a6xx_irq,
 		.destroy = a6xx_destroy,
 #if defined(CONFIG_DRM_MSM_GPU_STATE)
 		.show = a6xx_show,
+#endif
+#if defined(CONFIG_DEBUG_FS)
+		.debugfs_init = a6xx_debugfs_init,
 #endif
 		.gpu_busy = a6xx_gpu_busy,
 		.gpu_get_freq = a6xx_gmu_get_freq,
@@ -2252,6 +3251,7 @@ struct msm_gpu *a6xx_gpu_init(struct drm_device *dev)
 	struct a6xx_gpu *a6xx_gpu;
 	struct adreno_gpu *adreno_gpu;
 	struct msm_gpu *gpu;
+	unsigned int nr_rings;
 	bool is_a7xx;
 	int ret;
 
@@ -2290,17 +3290,42 @@ struct msm_gpu *a6xx_gpu_init(struct drm_device *dev)
 		return ERR_PTR(ret);
 	}
 
+	/*
+	 * Ring preemption is only wired up for A6xx with a GMU, and only
+	 * enabled by default where it has been validated.
+	 */
+	nr_rings = 1;
+	if (!is_a7xx && !adreno_has_gmu_wrapper(adreno_gpu)) {
+		if (enable_preemption == 1 ||
+		    (enable_preemption == -1 &&
+		     config->info->revn == 618))
+			nr_rings = 4;
+
+		/*
+		 * Let the GMU do GPU DCVS itself, devfreq then only provides
+		 * the min and max clamps instead of sampling busyness.  The
+		 * legacy HFI of the A630 family only takes the clamps while
+		 * the GMU boots, so thermal limits would be ignored until the
+		 * next power collapse.  Keep devfreq in charge there.
+		 */
+		if (gmu_dcvs == 1 && config->info->family != ADRENO_6XX_GEN1)
+			gpu->hw_dcvs = true;
+	}
+
 	if (is_a7xx)
 		ret = adreno_gpu_init(dev, pdev, adreno_gpu, &funcs_a7xx, 1);
 	else if (adreno_has_gmu_wrapper(adreno_gpu))
 		ret = adreno_gpu_init(dev, pdev, adreno_gpu, &funcs_gmuwrapper, 1);
 	else
-		ret = adreno_gpu_init(dev, pdev, adreno_gpu, &funcs, 1);
+		ret = adreno_gpu_init(dev, pdev, adreno_gpu, &funcs, nr_rings);
 	if (ret) {
 		a6xx_destroy(&(a6xx_gpu->base.base));
 		return ERR_PTR(ret);
 	}
 
+	/* Set up the preemption specific bits and pieces for each ringbuffer */
+	a6xx_preempt_init(gpu);
+
 	/*
 	 * For now only clamp to idle freq for devices where this is known not
 	 * to cause power supply issues:
@@ -2331,6 +3356,15 @@ struct msm_gpu *a6xx_gpu_init(struct drm_device *dev)
 				a6xx_fault_handler);
 
 	a6xx_calc_ubwc_config(adreno_gpu);
+	a6xx_check_ubwc_config(adreno_gpu, dev);
+
+	if (!adreno_has_gmu_wrapper(adreno_gpu)) {
+		a6xx_llc_resize_init(a6xx_gpu);
+		a6xx_bw_vote_init(a6xx_gpu);
+	}
+
+	if (!adreno_is_a7xx(adreno_gpu))
+		a6xx_perfcntr_init(a6xx_gpu);
 
 	return gpu;
 }
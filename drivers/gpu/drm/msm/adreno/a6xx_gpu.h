@@ -24,6 +24,13 @@ struct a6xx_info {
 	u32 gmu_chipid;
 };
 
+struct a6xx_resume_stats {
+	u64 count;
+	u64 total_us;
+	u64 last_us;
+	u64 max_us;
+};
+
 struct a6xx_gpu {
 	struct adreno_gpu base;
 
@@ -31,6 +38,23 @@ struct a6xx_gpu {
 	uint64_t sqe_iova;
 
 	struct msm_ringbuffer *cur_ring;
+	struct msm_ringbuffer *next_ring;
+
+	struct drm_gem_object *preempt_bo[MSM_GPU_MAX_RINGS];
+	void *preempt[MSM_GPU_MAX_RINGS];
+	uint64_t preempt_iova[MSM_GPU_MAX_RINGS];
+	struct drm_gem_object *preempt_smmu_bo[MSM_GPU_MAX_RINGS];
+	void *preempt_smmu[MSM_GPU_MAX_RINGS];
+	uint64_t preempt_smmu_iova[MSM_GPU_MAX_RINGS];
+	uint32_t last_seqno[MSM_GPU_MAX_RINGS];
+
+	atomic_t preempt_state;
+	spinlock_t eval_lock;
+	struct timer_list preempt_timer;
+
+	unsigned int preempt_level;
+	bool uses_gmem;
+	bool skip_save_restore;
 
 	struct a6xx_gmu gmu;
 
@@ -40,15 +64,175 @@ struct a6xx_gpu {
 
 	bool has_whereami;
 
+	struct drm_gem_object *pwrup_reglist_bo;
+	void *pwrup_reglist;
+	uint64_t pwrup_reglist_iova;
+
 	void __iomem *llc_mmio;
 	void *llc_slice;
 	void *htw_llc_slice;
 	bool have_mmu500;
+
+	/* GPU slice resizing, see a6xx_llc_resize_work(): */
+	struct delayed_work llc_work;
+	u32 llc_max_kb, llc_kb;
+	u32 llc_bonus_ways, llc_res_ways;
+	bool llc_sample_misses;
+	ktime_t llc_time;
+	u64 llc_busy_cycles;
+	u64 llc_tp_beats, llc_tp_reqs;
+
+	/* DDR bandwidth voting, see a6xx_gpu_update_bw(): */
+	bool bw_vote;
+	bool bw_sampled;
+	u64 bw_beats;
+	struct dev_pm_opp *bw_opp;
+
+	/* Counter groups for the perfcntr ioctl, see a6xx_perfcntr_init(): */
+	struct msm_perfcntr_group perfcntr_groups[MSM_PERFCNTR_MAX_GROUPS];
+
+	/* Target specific hw_init() register writes, see static_write(): */
+	struct adreno_reglist static_regs[192];
+	unsigned int nr_static_regs, nr_recorded_regs;
+	/* Number of them that go before HWCG is enabled: */
+	unsigned int nr_pre_hwcg_regs;
+	bool recording_regs;
+
+	/* Runtime resume latency, up to the end of hw_init(): */
+	ktime_t resume_start;
+	struct a6xx_resume_stats resume_stats[2];	/* [0] full, [1] replayed */
+
 	bool hung;
 };
 
 #define to_a6xx_gpu(x) container_of(x, struct a6xx_gpu, base)
 
+/*
+ * In order to do lockless preemption we use a simple state machine to progress
+ * through the process.
+ *
+ * PREEMPT_NONE - no preemption in progress.  Next state START.
+ * PREEMPT_START - The trigger is evaluating if preemption is possible. Next
+ * states: TRIGGERED, NONE
+ * PREEMPT_FINISH - An intermediate state before moving back to NONE. Next
+ * state: NONE.
+ * PREEMPT_TRIGGERED: A preemption has been executed on the hardware. Next
+ * states: FAULTED, PENDING
+ * PREEMPT_FAULTED: A preemption timed out (never completed). This will trigger
+ * recovery.  Next state: N/A
+ * PREEMPT_PENDING: Preemption complete interrupt fired - the callback is
+ * checking the success of the operation. Next state: FAULTED, NONE.
+ */
+
+enum a6xx_preempt_state {
+	PREEMPT_NONE = 0,
+	PREEMPT_START,
+	PREEMPT_FINISH,
+	PREEMPT_TRIGGERED,
+	PREEMPT_FAULTED,
+	PREEMPT_PENDING,
+};
+
+/*
+ * struct a6xx_preempt_record is a shared buffer between the microcode and the
+ * CPU to store the state for preemption. The record itself is much larger
+ * (2112k) but most of that is used by the CP for storage.
+ *
+ * There is a preemption record assigned per ringbuffer. When the CPU triggers a
+ * preemption, it fills out the record with the useful information (wptr, ring
+ * base, etc) and the microcode uses that information to set up the CP following
+ * the preemption.  When a ring is switched out, the CP will save the ringbuffer
+ * state back to the record. In this way, once the records are properly set up
+ * the CPU can quickly switch back and forth between ringbuffers by only
+ * updating a few registers (often only the wptr).
+ *
+ * These are the CPU aware registers in the record:
+ * @magic: Must always be 0xAE399D6E
+ * @info: Type of the record - written 0 by the CPU, updated by the CP
+ * @errno: preemption error record
+ * @data: Data field in YIELD and SET_MARKER packets, Written and used by CP
+ * @cntl: Value of RB_CNTL written by CPU, save/restored by CP
+ * @rptr: Value of RB_RPTR written by CPU, save/restored by CP
+ * @wptr: Value of RB_WPTR written by CPU, save/restored by CP
+ * @_pad: Reserved/padding
+ * @rptr_addr: Value of RB_RPTR_ADDR_LO|HI written by CPU, save/restored by CP
+ * @rbase: Value of RB_BASE written by CPU, save/restored by CP
+ * @counter: GPU address of the storage area for the preemption counters
+ */
+struct a6xx_preempt_record {
+	u32 magic;
+	u32 info;
+	u32 errno;
+	u32 data;
+	u32 cntl;
+	u32 rptr;
+	u32 wptr;
+	u32 _pad;
+	u64 rptr_addr;
+	u64 rbase;
+	u64 counter;
+};
+
+#define A6XX_PREEMPT_RECORD_MAGIC 0xAE399D6EUL
+
+/*
+ * Even though the structure above is only a few bytes, we need a full 2112k to
+ * store the entire preemption record from the CP
+ */
+#define A6XX_PREEMPT_RECORD_SIZE (2112 * 1024)
+
+/*
+ * The preemption counter block is a storage area for the value of the
+ * preemption counters that are saved immediately before context switch. We
+ * append it on to the end of the allocation for the preemption record.
+ */
+#define A6XX_PREEMPT_COUNTER_SIZE (16 * 4)
+
+/*
+ * The non-privileged part of the context is saved to a per submitqueue buffer
+ * in the address space of the process owning it.
+ */
+#define A6XX_PREEMPT_USER_RECORD_SIZE (192 * 1024)
+
+/*
+ * struct a6xx_preempt_smmu is the pagetable the CP switches to when restoring
+ * a ring. It is updated by the ring itself every time it switches pagetables.
+ */
+struct a6xx_preempt_smmu {
+	u64 ttbr0;
+	u32 asid;
+	u32 context_idr;
+	u32 magic;
+};
+
+#define A6XX_PREEMPT_SMMU_MAGIC 0x3618CDA3UL
+
+/* Fields of CP_CONTEXT_SWITCH_CNTL */
+#define A6XX_CP_CTXSW_CNTL_TRIGGER		BIT(0)
+#define A6XX_CP_CTXSW_CNTL_LEVEL(x)		(((x) & 0x3) << 6)
+#define A6XX_CP_CTXSW_CNTL_USES_GMEM		BIT(8)
+#define A6XX_CP_CTXSW_CNTL_SKIP_SAVE_RESTORE	BIT(9)
+
+/*
+ * struct a6xx_pwrup_lock is the header of the power up register list that the
+ * CP uses to restore the GX registers programmed by the CPU when coming back
+ * from IFPC (or when restoring a ring after preemption). The list itself is an
+ * array of (register, value) dword pairs directly following the header.
+ *
+ * @gpu_req, @cpu_req, @turn: Spinlock shared with the CP, only needed if the
+ * list is updated while the CP is running
+ * @list_length: Total number of dwords in the list
+ * @list_offset: Number of dwords at the start of the list that are only
+ * restored for IFPC, the rest is restored for preemption too
+ */
+struct a6xx_pwrup_lock {
+	u32 gpu_req;
+	u32 cpu_req;
+	u32 turn;
+	u16 list_length;
+	u16 list_offset;
+};
+
 /*
  * Given a register and a count, return a value to program into
  * REG_CP_PROTECT_REG(n) - this will block both reads and writes for
@@ -109,6 +293,8 @@ void a6xx_gmu_remove(struct a6xx_gpu *a6xx_gpu);
 void a6xx_gmu_set_freq(struct msm_gpu *gpu, struct dev_pm_opp *opp,
 		       bool suspended);
 unsigned long a6xx_gmu_get_freq(struct msm_gpu *gpu);
+void a6xx_gmu_set_freq_limits(struct msm_gpu *gpu, unsigned long min_freq,
+			      unsigned long max_freq, bool suspended);
 
 void a6xx_show(struct msm_gpu *gpu, struct msm_gpu_state *state,
 		struct drm_printer *p);
@@ -119,4 +305,35 @@ int a6xx_gpu_state_put(struct msm_gpu_state *state);
 void a6xx_bus_clear_pending_transactions(struct adreno_gpu *adreno_gpu, bool gx_off);
 void a6xx_gpu_sw_reset(struct msm_gpu *gpu, bool assert);
 
+int a6xx_fenced_write(struct a6xx_gpu *a6xx_gpu, u32 offset, u64 value,
+		u32 mask, bool is_64b);
+
+void a6xx_preempt_init(struct msm_gpu *gpu);
+void a6xx_preempt_hw_init(struct msm_gpu *gpu);
+void a6xx_preempt_trigger(struct msm_gpu *gpu);
+void a6xx_preempt_irq(struct msm_gpu *gpu);
+void a6xx_preempt_fini(struct msm_gpu *gpu);
+int a6xx_preempt_submitqueue_setup(struct msm_gpu *gpu,
+		struct msm_gpu_submitqueue *queue);
+
+/* Return true if we are in a preempt state */
+static inline bool a6xx_in_preempt(struct a6xx_gpu *a6xx_gpu)
+{
+	int preempt_state;
+
+	/*
+	 * Make sure the read to preempt_state is ordered with respect to reads
+	 * of other variables before ...
+	 */
+	smp_rmb();
+
+	preempt_state = atomic_read(&a6xx_gpu->preempt_state);
+
+	/* ... and after. */
+	smp_rmb();
+
+	return !(preempt_state == PREEMPT_NONE ||
+			preempt_state == PREEMPT_FINISH);
+}
+
 #endif /* __A6XX_GPU_H__ */
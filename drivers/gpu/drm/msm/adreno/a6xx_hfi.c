@@ -19,7 +19,9 @@ static const char * const a6xx_hfi_msg_id[] = {
 	HFI_MSG_ID(HFI_H2F_MSG_BW_TABLE),
 	HFI_MSG_ID(HFI_H2F_MSG_PERF_TABLE),
 	HFI_MSG_ID(HFI_H2F_MSG_TEST),
+	HFI_MSG_ID(HFI_H2F_MSG_FEATURE_CTRL),
 	HFI_MSG_ID(HFI_H2F_MSG_START),
+	HFI_MSG_ID(HFI_H2F_MSG_SET_VALUE),
 	HFI_MSG_ID(HFI_H2F_MSG_CORE_FW_START),
 	HFI_MSG_ID(HFI_H2F_MSG_GX_BW_PERF_VOTE),
 	HFI_MSG_ID(HFI_H2F_MSG_PREPARE_SLUMBER),
@@ -695,6 +697,65 @@ int a6xx_hfi_set_freq(struct a6xx_gmu *gmu, int index)
 		sizeof(msg), NULL, 0);
 }
 
+static int a6xx_hfi_send_feature_ctrl(struct a6xx_gmu *gmu, u32 feature,
+		u32 enable, u32 data)
+{
+	struct a6xx_hfi_msg_feature_ctrl msg = { 0 };
+
+	msg.feature = feature;
+	msg.enable = enable;
+	msg.data = data;
+
+	return a6xx_hfi_send_msg(gmu, HFI_H2F_MSG_FEATURE_CTRL, &msg,
+		sizeof(msg), NULL, 0);
+}
+
+static int a6xx_hfi_send_set_value(struct a6xx_gmu *gmu, u32 type, u32 data)
+{
+	struct a6xx_hfi_msg_set_value msg = { 0 };
+
+	msg.type = type;
+	msg.data = data;
+
+	return a6xx_hfi_send_msg(gmu, HFI_H2F_MSG_SET_VALUE, &msg,
+		sizeof(msg), NULL, 0);
+}
+
+/*
+ * Clamp the perf levels the GMU DCVS can pick from. The indexes refer to the
+ * perf table, in which level 0 is the "off" level.
+ */
+int a6xx_hfi_set_freq_limits(struct a6xx_gmu *gmu, int min_index, int max_index)
+{
+	int ret;
+
+	ret = a6xx_hfi_send_set_value(gmu, HFI_VALUE_MAX_GPU_PERF_INDEX,
+		max_index);
+	if (ret)
+		return ret;
+
+	return a6xx_hfi_send_set_value(gmu, HFI_VALUE_MIN_GPU_PERF_INDEX,
+		min_index);
+}
+
+/* Hand GPU frequency decisions over to the GMU, within the current limits */
+static int a6xx_hfi_send_dcvs(struct a6xx_gmu *gmu)
+{
+	struct a6xx_gpu *a6xx_gpu = container_of(gmu, struct a6xx_gpu, gmu);
+	int ret;
+
+	/* Cleared again if devfreq couldn't set up the performance governor */
+	if (!a6xx_gpu->base.base.hw_dcvs)
+		return 0;
+
+	ret = a6xx_hfi_send_feature_ctrl(gmu, HFI_FEATURE_DCVS, 1, 0);
+	if (ret)
+		return ret;
+
+	return a6xx_hfi_set_freq_limits(gmu, gmu->dcvs_min_index,
+		gmu->dcvs_max_index);
+}
+
 int a6xx_hfi_send_prep_slumber(struct a6xx_gmu *gmu)
 {
 	struct a6xx_hfi_prep_slumber_cmd msg = { 0 };
@@ -731,6 +792,14 @@ static int a6xx_hfi_start_v1(struct a6xx_gmu *gmu, int boot_state)
 	if (ret)
 		return ret;
 
+	/*
+	 * The limits can only be changed while booting the GMU here, so new
+	 * ones take effect on the next power collapse
+	 */
+	ret = a6xx_hfi_send_dcvs(gmu);
+	if (ret)
+		return ret;
+
 	/*
 	 * Let the GMU know that there won't be any more HFI messages until next
 	 * boot
@@ -756,6 +825,18 @@ int a6xx_hfi_start(struct a6xx_gmu *gmu, int boot_state)
 	if (ret)
 		return ret;
 
+	ret = a6xx_hfi_send_dcvs(gmu);
+	if (ret)
+		return ret;
+
+	/* Same 300 us hysteresis as programmed for the legacy GMU */
+	if (gmu->idle_level == GMU_IDLE_STATE_IFPC) {
+		ret = a6xx_hfi_send_feature_ctrl(gmu, HFI_FEATURE_IFPC, 1,
+			0x1680);
+		if (ret)
+			return ret;
+	}
+
 	ret = a6xx_hfi_send_core_fw_start(gmu);
 	if (ret)
 		return ret;
@@ -151,12 +151,36 @@ struct a6xx_hfi_msg_test {
 	u32 header;
 };
 
+#define HFI_H2F_MSG_FEATURE_CTRL 11
+
+struct a6xx_hfi_msg_feature_ctrl {
+	u32 header;
+	u32 feature;
+	u32 enable;
+	u32 data;
+};
+
+#define HFI_FEATURE_DCVS 0
+#define HFI_FEATURE_IFPC 9
+
 #define HFI_H2F_MSG_START 10
 
 struct a6xx_hfi_msg_start {
 	u32 header;
 };
 
+#define HFI_H2F_MSG_SET_VALUE 13
+
+struct a6xx_hfi_msg_set_value {
+	u32 header;
+	u32 type;
+	u32 subtype;
+	u32 data;
+};
+
+#define HFI_VALUE_MAX_GPU_PERF_INDEX 104
+#define HFI_VALUE_MIN_GPU_PERF_INDEX 105
+
 #define HFI_H2F_MSG_CORE_FW_START 14
 
 struct a6xx_hfi_msg_core_fw_start {
@@ -20,6 +20,22 @@ bool allow_vram_carveout = false;
 MODULE_PARM_DESC(allow_vram_carveout, "Allow using VRAM Carveout, in place of IOMMU");
 module_param_named(allow_vram_carveout, allow_vram_carveout, bool, 0600);
 
+int enable_preemption = -1;
+MODULE_PARM_DESC(enable_preemption, "Enable preemption (A6xx only) (1=on, 0=disable, -1=auto (default))");
+module_param(enable_preemption, int, 0600);
+
+int gmu_dcvs;
+MODULE_PARM_DESC(gmu_dcvs, "Let the GMU do GPU DCVS (A6xx with HFI v2 only) (1=on, 0=disable (default))");
+module_param(gmu_dcvs, int, 0400);
+
+bool llc_resize = true;
+MODULE_PARM_DESC(llc_resize, "Resize the GPU LLCC slice with GPU load (A6xx only)");
+module_param(llc_resize, bool, 0400);
+
+bool bw_vote = true;
+MODULE_PARM_DESC(bw_vote, "Vote DDR bandwidth from measured GPU memory traffic rather than the GPU frequency (A6xx only)");
+module_param(bw_vote, bool, 0400);
+
 extern const struct adreno_gpulist a2xx_gpulist;
 extern const struct adreno_gpulist a3xx_gpulist;
 extern const struct adreno_gpulist a4xx_gpulist;
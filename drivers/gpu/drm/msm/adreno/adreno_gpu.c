@@ -27,6 +27,28 @@ module_param(address_space_size, ullong, 0600);
 
 static bool zap_available = true;
 
+/*
+ * The prefetches are only for the qcom/ location, which is where
+ * adreno_request_fw() looks first and where upstream linux-firmware has them.
+ */
+static void adreno_fw_prefetch(struct device *dev, const char *fwname)
+{
+	char *newname = kasprintf(GFP_KERNEL, "qcom/%s", fwname);
+
+	if (newname)
+		firmware_request_prefetch(dev, newname);
+	kfree(newname);
+}
+
+static void adreno_fw_prefetch_drop(struct device *dev, const char *fwname)
+{
+	char *newname = kasprintf(GFP_KERNEL, "qcom/%s", fwname);
+
+	if (newname)
+		firmware_prefetch_drop(dev, newname);
+	kfree(newname);
+}
+
 static int zap_shader_load_mdt(struct msm_gpu *gpu, const char *fwname,
 		u32 pasid)
 {
@@ -170,6 +192,12 @@ static int zap_shader_load_mdt(struct msm_gpu *gpu, const char *fwname,
 
 	release_firmware(fw);
 
+	/* The zap shader is only loaded once, don't keep it around */
+	if (signed_fwname)
+		firmware_prefetch_drop(gpu->dev->dev, signed_fwname);
+	else
+		adreno_fw_prefetch_drop(gpu->dev->dev, fwname);
+
 	return ret;
 }
 
@@ -379,6 +407,9 @@ int adreno_get_param(struct msm_gpu *gpu, struct msm_file_private *ctx,
 	case MSM_PARAM_RAYTRACING:
 		*value = adreno_gpu->has_ray_tracing;
 		return 0;
+	case MSM_PARAM_EN_VM_BIND:
+		*value = READ_ONCE(ctx->vm_bind);
+		return 0;
 	default:
 		DBG("%s: invalid param: %u", gpu->name, param);
 		return -EINVAL;
@@ -430,6 +461,22 @@ int adreno_set_param(struct msm_gpu *gpu, struct msm_file_private *ctx,
 		if (!capable(CAP_SYS_ADMIN))
 			return -EPERM;
 		return msm_file_private_set_sysprof(ctx, gpu, value);
+	case MSM_PARAM_EN_VM_BIND: {
+		int ret;
+
+		/* Userspace managed VA requires a per-process address space */
+		if (ctx->aspace == gpu->aspace)
+			return -EOPNOTSUPP;
+		if (value != 1)
+			return -EINVAL;
+
+		ret = msm_gem_vm_bind_init(ctx->aspace, gpu);
+		if (ret)
+			return ret;
+
+		WRITE_ONCE(ctx->vm_bind, true);
+		return 0;
+	}
 	default:
 		DBG("%s: invalid param: %u", gpu->name, param);
 		return -EINVAL;
@@ -517,6 +564,45 @@ adreno_request_fw(struct adreno_gpu *adreno_gpu, const char *fwname)
 	return fw;
 }
 
+/*
+ * adreno_load_fw() and the zap shader load only run on first open, and one
+ * image after another. Start reading them all from bind instead. The SQE and
+ * GMU images share their buffer with adreno_gpu->fw[] once loaded, so those
+ * prefetches are simply left to devres.
+ */
+static void adreno_prefetch_fw(struct drm_device *drm, struct device *dev,
+			       struct adreno_gpu *adreno_gpu)
+{
+	const struct adreno_info *info = adreno_gpu->info;
+	const char *signed_fwname = NULL;
+	struct device_node *np;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(info->fw); i++) {
+		if (!info->fw[i])
+			continue;
+
+		if (adreno_has_gmu_wrapper(adreno_gpu) && i == ADRENO_FW_GMU)
+			continue;
+
+		adreno_fw_prefetch(drm->dev, info->fw[i]);
+	}
+
+	if (!IS_ENABLED(CONFIG_ARCH_QCOM))
+		return;
+
+	np = of_get_child_by_name(dev->of_node, "zap-shader");
+	if (of_device_is_available(np)) {
+		of_property_read_string_index(np, "firmware-name", 0,
+					      &signed_fwname);
+		if (signed_fwname)
+			firmware_request_prefetch(drm->dev, signed_fwname);
+		else if (info->zapfw)
+			adreno_fw_prefetch(drm->dev, info->zapfw);
+	}
+	of_node_put(np);
+}
+
 int adreno_load_fw(struct adreno_gpu *adreno_gpu)
 {
 	int i;
@@ -1123,6 +1209,8 @@ int adreno_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 		adreno_gpu->info->inactive_period);
 	pm_runtime_use_autosuspend(dev);
 
+	adreno_prefetch_fw(drm, dev, adreno_gpu);
+
 	return msm_gpu_init(drm, pdev, &adreno_gpu->base, &funcs->base,
 			gpu_name, &adreno_gpu_config);
 }
@@ -19,6 +19,10 @@
 
 extern bool snapshot_debugbus;
 extern bool allow_vram_carveout;
+extern int enable_preemption;
+extern int gmu_dcvs;
+extern bool llc_resize;
+extern bool bw_vote;
 
 enum {
 	ADRENO_FW_PM4 = 0,
@@ -56,6 +60,7 @@ enum adreno_family {
 #define ADRENO_QUIRK_LMLOADKILL_DISABLE		BIT(2)
 #define ADRENO_QUIRK_HAS_HW_APRIV		BIT(3)
 #define ADRENO_QUIRK_HAS_CACHED_COHERENT	BIT(4)
+#define ADRENO_QUIRK_IFPC			BIT(5)
 
 /* Helper for formating the chip_id in the way that userspace tools like
  * crashdec expect.
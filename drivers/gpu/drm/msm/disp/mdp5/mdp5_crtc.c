@@ -689,6 +689,59 @@ static enum mdp_mixer_stage_id get_start_stage(struct drm_crtc *crtc,
 	return STAGE_BASE;
 }
 
+/*
+ * Bandwidth needed to fetch a plane, in bytes per second.  A plane that is
+ * scaled down vertically has to fetch more source lines in the time it
+ * takes to scan out each line, so it needs proportionally more.
+ */
+static u64 plane_bw(const struct drm_plane_state *pstate, int vrefresh)
+{
+	const struct drm_format_info *info = pstate->fb->format;
+	u32 src_w = pstate->src_w >> 16;
+	u32 src_h = pstate->src_h >> 16;
+	u64 bw = 0;
+	int i;
+
+	for (i = 0; i < info->num_planes; i++)
+		bw += (u64)drm_format_info_plane_width(info, src_w, i) *
+			drm_format_info_plane_height(info, src_h, i) *
+			info->cpp[i];
+
+	bw *= vrefresh;
+
+	if (pstate->crtc_h && src_h > pstate->crtc_h)
+		bw = div_u64(bw * src_h, pstate->crtc_h);
+
+	return bw;
+}
+
+static int mdp5_crtc_update_bw(struct drm_crtc *crtc,
+		struct drm_crtc_state *crtc_state)
+{
+	struct mdp5_global_state *global_state;
+	const struct drm_plane_state *pstate;
+	struct drm_plane *plane;
+	int vrefresh;
+	u64 bw = 0;
+
+	global_state = mdp5_get_global_state(crtc_state->state);
+	if (IS_ERR(global_state))
+		return PTR_ERR(global_state);
+
+	vrefresh = drm_mode_vrefresh(&crtc_state->adjusted_mode);
+
+	if (crtc_state->active) {
+		drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state) {
+			if (pstate->visible)
+				bw += plane_bw(pstate, vrefresh);
+		}
+	}
+
+	global_state->crtc_bw[drm_crtc_index(crtc)] = bw;
+
+	return 0;
+}
+
 static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 		struct drm_atomic_state *state)
 {
@@ -711,6 +764,10 @@ static int mdp5_crtc_atomic_check(struct drm_crtc *crtc,
 
 	DBG("%s: check", crtc->name);
 
+	ret = mdp5_crtc_update_bw(crtc, crtc_state);
+	if (ret)
+		return ret;
+
 	drm_atomic_crtc_state_for_each_plane_state(plane, pstate, crtc_state) {
 		struct mdp5_plane_state *mdp5_pstate =
 				to_mdp5_plane_state(pstate);
@@ -19,6 +19,10 @@
 #include "msm_mmu.h"
 #include "mdp5_kms.h"
 
+/* Interconnect votes, per path, in bytes per second: */
+#define MDP5_BOOT_BW	6400000000ULL
+#define MDP5_MIN_IB_BW	400000000ULL
+
 static int mdp5_hw_init(struct msm_kms *kms)
 {
 	struct mdp5_kms *mdp5_kms = to_mdp5_kms(to_mdp_kms(kms));
@@ -157,6 +161,42 @@ static void mdp5_disable_commit(struct msm_kms *kms)
 	pm_runtime_put_sync(&mdp5_kms->pdev->dev);
 }
 
+/*
+ * Vote for the scanout bandwidth of the planes in use.  Before a flip the
+ * vote is only ever raised, as the planes of the outgoing state are still
+ * being scanned out until the flip completes.  After the flip it is set to
+ * what the new state needs, so it drops again once the load goes away.
+ */
+static void mdp5_update_bw(struct mdp5_kms *mdp5_kms,
+		struct mdp5_global_state *global_state, bool raise_only)
+{
+	u64 bw = 0;
+	int i;
+
+	if (!mdp5_kms->num_paths)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(global_state->crtc_bw); i++)
+		bw += global_state->crtc_bw[i];
+
+	mutex_lock(&mdp5_kms->bw_lock);
+
+	if (raise_only)
+		bw = max(bw, mdp5_kms->bw);
+
+	if (bw != mdp5_kms->bw) {
+		u32 avg = Bps_to_icc(div_u64(bw, mdp5_kms->num_paths));
+		u32 peak = max_t(u32, avg, Bps_to_icc(MDP5_MIN_IB_BW));
+
+		for (i = 0; i < mdp5_kms->num_paths; i++)
+			icc_set_bw(mdp5_kms->path[i], avg, peak);
+
+		mdp5_kms->bw = bw;
+	}
+
+	mutex_unlock(&mdp5_kms->bw_lock);
+}
+
 static void mdp5_prepare_commit(struct msm_kms *kms, struct drm_atomic_state *state)
 {
 	struct mdp5_kms *mdp5_kms = to_mdp5_kms(to_mdp_kms(kms));
@@ -164,6 +204,8 @@ static void mdp5_prepare_commit(struct msm_kms *kms, struct drm_atomic_state *st
 
 	global_state = mdp5_get_existing_global_state(mdp5_kms);
 
+	mdp5_update_bw(mdp5_kms, global_state, true);
+
 	if (mdp5_kms->smp)
 		mdp5_smp_prepare_commit(mdp5_kms->smp, &global_state->smp);
 }
@@ -191,6 +233,8 @@ static void mdp5_complete_commit(struct msm_kms *kms, unsigned crtc_mask)
 
 	if (mdp5_kms->smp)
 		mdp5_smp_complete_commit(mdp5_kms->smp, &global_state->smp);
+
+	mdp5_update_bw(mdp5_kms, global_state, false);
 }
 
 static void mdp5_destroy(struct mdp5_kms *mdp5_kms);
@@ -780,7 +824,8 @@ static int mdp5_init(struct platform_device *pdev, struct drm_device *dev)
 	return ret;
 }
 
-static int mdp5_setup_interconnect(struct platform_device *pdev)
+static int mdp5_setup_interconnect(struct platform_device *pdev,
+		struct mdp5_kms *mdp5_kms)
 {
 	struct icc_path *path0 = msm_icc_get(&pdev->dev, "mdp0-mem");
 	struct icc_path *path1 = msm_icc_get(&pdev->dev, "mdp1-mem");
@@ -800,12 +845,26 @@ static int mdp5_setup_interconnect(struct platform_device *pdev)
 		return 0;
 	}
 
-	icc_set_bw(path0, 0, MBps_to_icc(6400));
+	/*
+	 * Until the first commit we don't know what the bootloader left
+	 * scanning out, so start with a vote that covers anything.  After
+	 * that the vote follows the planes in use, see mdp5_update_bw().
+	 */
+	mutex_init(&mdp5_kms->bw_lock);
+
+	mdp5_kms->path[mdp5_kms->num_paths++] = path0;
+	icc_set_bw(path0, 0, Bps_to_icc(MDP5_BOOT_BW));
+
+	if (!IS_ERR_OR_NULL(path1)) {
+		mdp5_kms->path[mdp5_kms->num_paths++] = path1;
+		icc_set_bw(path1, 0, Bps_to_icc(MDP5_BOOT_BW));
+	}
+
+	mdp5_kms->bw = mdp5_kms->num_paths * MDP5_BOOT_BW;
 
-	if (!IS_ERR_OR_NULL(path1))
-		icc_set_bw(path1, 0, MBps_to_icc(6400));
+	/* We don't use the rotator, so don't hold DDR up for it: */
 	if (!IS_ERR_OR_NULL(path_rot))
-		icc_set_bw(path_rot, 0, MBps_to_icc(6400));
+		icc_set_bw(path_rot, 0, 0);
 
 	return 0;
 }
@@ -824,7 +883,7 @@ static int mdp5_dev_probe(struct platform_device *pdev)
 	if (!mdp5_kms)
 		return -ENOMEM;
 
-	ret = mdp5_setup_interconnect(pdev);
+	ret = mdp5_setup_interconnect(pdev, mdp5_kms);
 	if (ret)
 		return ret;
 
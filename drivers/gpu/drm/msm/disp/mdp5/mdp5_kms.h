@@ -64,6 +64,15 @@ struct mdp5_kms {
 
 	bool rpm_enabled;
 
+	/*
+	 * MDP->DDR interconnect paths, and the current vote, which is
+	 * updated around each commit.  See mdp5_update_bw().
+	 */
+	struct icc_path *path[2];
+	unsigned num_paths;
+	struct mutex bw_lock;
+	u64 bw;
+
 	struct mdp_irq error_handler;
 
 	int enable_count;
@@ -83,6 +92,9 @@ struct mdp5_global_state {
 	struct mdp5_hw_pipe_state hwpipe;
 	struct mdp5_hw_mixer_state hwmixer;
 	struct mdp5_smp_state smp;
+
+	/* Scanout bandwidth of each crtc, in bytes per second: */
+	u64 crtc_bw[MAX_CRTCS];
 };
 
 struct mdp5_global_state * mdp5_get_existing_global_state(struct mdp5_kms *mdp5_kms);
@@ -7,6 +7,18 @@
 
 #include "msm_disp_snapshot.h"
 
+static int snapshot_level = MSM_DISP_SNAPSHOT_FULL;
+MODULE_PARM_DESC(snapshot_level, "What display fault snapshots capture (0=off, 1=atomic state only, 2=atomic state and registers (default))");
+module_param(snapshot_level, int, 0600);
+
+static uint snapshot_interval_ms = 10000;
+MODULE_PARM_DESC(snapshot_interval_ms, "Minimum interval between display fault snapshots (default 10000)");
+module_param(snapshot_interval_ms, uint, 0400);
+
+static uint snapshot_buf_kb = 1024;
+MODULE_PARM_DESC(snapshot_buf_kb, "Size of the buffer display fault snapshots are captured into (default 1024)");
+module_param(snapshot_buf_kb, uint, 0400);
+
 static ssize_t __maybe_unused disp_devcoredump_read(char *buffer, loff_t offset,
 		size_t count, void *data, size_t datalen)
 {
@@ -28,8 +40,9 @@ static ssize_t __maybe_unused disp_devcoredump_read(char *buffer, loff_t offset,
 	return count - iter.remain;
 }
 
-struct msm_disp_state *
-msm_disp_snapshot_state_sync(struct msm_kms *kms)
+static struct msm_disp_state *
+__msm_disp_snapshot_state(struct msm_kms *kms, enum msm_disp_snapshot_level level,
+		bool prealloc)
 {
 	struct drm_device *drm_dev = kms->dev;
 	struct msm_disp_state *disp_state;
@@ -42,6 +55,9 @@ msm_disp_snapshot_state_sync(struct msm_kms *kms)
 
 	disp_state->dev = drm_dev->dev;
 	disp_state->drm_dev = drm_dev;
+	disp_state->level = level;
+	if (prealloc)
+		disp_state->kms = kms;
 
 	INIT_LIST_HEAD(&disp_state->blocks);
 
@@ -50,19 +66,32 @@ msm_disp_snapshot_state_sync(struct msm_kms *kms)
 	return disp_state;
 }
 
+struct msm_disp_state *
+msm_disp_snapshot_state_sync(struct msm_kms *kms)
+{
+	return __msm_disp_snapshot_state(kms, MSM_DISP_SNAPSHOT_FULL, false);
+}
+
 static void _msm_disp_snapshot_work(struct kthread_work *work)
 {
 	struct msm_kms *kms = container_of(work, struct msm_kms, dump_work);
 	struct msm_disp_state *disp_state;
 	struct drm_printer p;
 
+	/* The previous snapshot is still waiting to be read out: */
+	if (kms->dump_buf && atomic_cmpxchg_acquire(&kms->dump_buf_busy, 0, 1))
+		return;
+
 	/* Serialize dumping here */
 	mutex_lock(&kms->dump_mutex);
-	disp_state = msm_disp_snapshot_state_sync(kms);
+	disp_state = __msm_disp_snapshot_state(kms, READ_ONCE(snapshot_level),
+					       !!kms->dump_buf);
 	mutex_unlock(&kms->dump_mutex);
 
-	if (IS_ERR(disp_state))
+	if (IS_ERR(disp_state)) {
+		atomic_set_release(&kms->dump_buf_busy, 0);
 		return;
+	}
 
 	if (MSM_DISP_SNAPSHOT_DUMP_IN_CONSOLE) {
 		p = drm_info_printer(disp_state->drm_dev->dev);
@@ -91,6 +120,15 @@ void msm_disp_snapshot_state(struct drm_device *drm_dev)
 	priv = drm_dev->dev_private;
 	kms = priv->kms;
 
+	if (READ_ONCE(snapshot_level) == MSM_DISP_SNAPSHOT_OFF)
+		return;
+
+	if (IS_ERR(kms->dump_worker) || atomic_read(&kms->dump_buf_busy))
+		return;
+
+	if (!__ratelimit(&kms->dump_rs))
+		return;
+
 	kthread_queue_work(kms->dump_worker, &kms->dump_work);
 }
 
@@ -109,6 +147,18 @@ int msm_disp_snapshot_init(struct drm_device *drm_dev)
 
 	mutex_init(&kms->dump_mutex);
 
+	ratelimit_state_init(&kms->dump_rs,
+			     msecs_to_jiffies(snapshot_interval_ms), 1);
+	ratelimit_set_flags(&kms->dump_rs, RATELIMIT_MSG_ON_RELEASE);
+
+	/*
+	 * If this fails, fault snapshots fall back to allocating as they
+	 * capture:
+	 */
+	kms->dump_buf_size = snapshot_buf_kb * SZ_1K;
+	kms->dump_buf = kvmalloc(kms->dump_buf_size, GFP_KERNEL);
+	atomic_set(&kms->dump_buf_busy, 0);
+
 	kms->dump_worker = kthread_create_worker(0, "%s", "disp_snapshot");
 	if (IS_ERR(kms->dump_worker))
 		DRM_ERROR("failed to create disp state task\n");
@@ -131,8 +181,12 @@ void msm_disp_snapshot_destroy(struct drm_device *drm_dev)
 	priv = drm_dev->dev_private;
 	kms = priv->kms;
 
-	if (kms->dump_worker)
+	if (!IS_ERR_OR_NULL(kms->dump_worker))
 		kthread_destroy_worker(kms->dump_worker);
 
+	/* Drop a snapshot still pending in devcoredump, and the buffer with it: */
+	dev_coredump_put(drm_dev->dev);
+	kvfree(kms->dump_buf);
+
 	mutex_destroy(&kms->dump_mutex);
 }
@@ -34,12 +34,28 @@
 /* print debug ranges in groups of 4 u32s */
 #define REG_DUMP_ALIGN		16
 
+/**
+ * enum msm_disp_snapshot_level - how much state a snapshot captures
+ * @MSM_DISP_SNAPSHOT_OFF: nothing, fault snapshots are disabled
+ * @MSM_DISP_SNAPSHOT_SUMMARY: just the atomic state at the time of the fault
+ * @MSM_DISP_SNAPSHOT_FULL: the atomic state and the hw block register dumps
+ */
+enum msm_disp_snapshot_level {
+	MSM_DISP_SNAPSHOT_OFF,
+	MSM_DISP_SNAPSHOT_SUMMARY,
+	MSM_DISP_SNAPSHOT_FULL,
+};
+
 /**
  * struct msm_disp_state - structure to store current dpu state
  * @dev: device pointer
  * @drm_dev: drm device pointer
  * @atomic_state: atomic state duplicated at the time of the error
  * @time: timestamp at which the coredump was captured
+ * @level: what the snapshot captures
+ * @kms: if set, the blocks are carved out of the kms' preallocated dump_buf
+ * @buf_used: bytes of the dump_buf used so far
+ * @truncated: blocks that didn't fit in the dump_buf and were skipped
  */
 struct msm_disp_state {
 	struct device *dev;
@@ -50,6 +66,11 @@ struct msm_disp_state {
 	struct drm_atomic_state *atomic_state;
 
 	struct timespec64 time;
+
+	enum msm_disp_snapshot_level level;
+	struct msm_kms *kms;
+	size_t buf_used;
+	unsigned int truncated;
 };
 
 /**
@@ -96,6 +117,9 @@ struct msm_disp_state *msm_disp_snapshot_state_sync(struct msm_kms *kms);
 
 /**
  * msm_disp_snapshot_state - trigger to dump the display snapshot
+ *
+ * Snapshots are rate limited, and skipped while the previous one hasn't
+ * been read out (or timed out) of devcoredump yet.
  * @drm_dev:	handle to drm device
 
  * Returns:	none
@@ -114,6 +138,9 @@ void msm_disp_state_print(struct msm_disp_state *disp_state, struct drm_printer
 /**
  * msm_disp_snapshot_capture_state - utility to capture atomic state and hw registers
  * @disp_state:	    handle to msm_disp_state struct
+ *
+ * The hw registers are only captured with @disp_state->level of
+ * MSM_DISP_SNAPSHOT_FULL.
 
  * Returns:	none
  */
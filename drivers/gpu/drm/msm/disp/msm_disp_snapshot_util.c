@@ -86,6 +86,8 @@ void msm_disp_state_print(struct msm_disp_state *state, struct drm_printer *p)
 	drm_printf(p, "dpu devcoredump\n");
 	drm_printf(p, "time: %lld.%09ld\n",
 		state->time.tv_sec, state->time.tv_nsec);
+	if (state->truncated)
+		drm_printf(p, "truncated: %u blocks\n", state->truncated);
 
 	list_for_each_entry_safe(block, tmp, &state->blocks, node) {
 		drm_printf(p, "====================%s================\n", block->name);
@@ -129,6 +131,9 @@ void msm_disp_snapshot_capture_state(struct msm_disp_state *disp_state)
 	priv = drm_dev->dev_private;
 	kms = priv->kms;
 
+	if (disp_state->level < MSM_DISP_SNAPSHOT_FULL)
+		goto out;
+
 	for (i = 0; i < ARRAY_SIZE(priv->dp); i++) {
 		if (!priv->dp[i])
 			continue;
@@ -146,6 +151,7 @@ void msm_disp_snapshot_capture_state(struct msm_disp_state *disp_state)
 	if (kms->funcs->snapshot)
 		kms->funcs->snapshot(disp_state, kms);
 
+out:
 	msm_disp_capture_atomic_state(disp_state);
 }
 
@@ -159,6 +165,13 @@ void msm_disp_state_free(void *data)
 		disp_state->atomic_state = NULL;
 	}
 
+	/* Blocks carved out of the dump_buf are released with it: */
+	if (disp_state->kms) {
+		atomic_set_release(&disp_state->kms->dump_buf_busy, 0);
+		kfree(disp_state);
+		return;
+	}
+
 	list_for_each_entry_safe(block, tmp, &disp_state->blocks, node) {
 		list_del(&block->node);
 		kfree(block->state);
@@ -168,6 +181,29 @@ void msm_disp_state_free(void *data)
 	kfree(disp_state);
 }
 
+/*
+ * Snapshots for faults are captured into the preallocated dump_buf, so
+ * that capturing doesn't have to allocate, and a capture that doesn't fit
+ * just skips blocks rather than growing without limit.
+ */
+static void *msm_disp_state_alloc(struct msm_disp_state *disp_state, size_t size)
+{
+	void *ptr;
+
+	if (!disp_state->kms)
+		return kzalloc(size, GFP_KERNEL);
+
+	size = ALIGN(size, sizeof(u64));
+	if (size > disp_state->kms->dump_buf_size - disp_state->buf_used)
+		return NULL;
+
+	ptr = disp_state->kms->dump_buf + disp_state->buf_used;
+	disp_state->buf_used += size;
+	memset(ptr, 0, size);
+
+	return ptr;
+}
+
 void msm_disp_snapshot_add_block(struct msm_disp_state *disp_state, u32 len,
 		void __iomem *base_addr, const char *fmt, ...)
 {
@@ -175,9 +211,11 @@ void msm_disp_snapshot_add_block(struct msm_disp_state *disp_state, u32 len,
 	struct va_format vaf;
 	va_list va;
 
-	new_blk = kzalloc(sizeof(struct msm_disp_state_block), GFP_KERNEL);
-	if (!new_blk)
+	new_blk = msm_disp_state_alloc(disp_state, sizeof(*new_blk));
+	if (!new_blk) {
+		disp_state->truncated++;
 		return;
+	}
 
 	va_start(va, fmt);
 
@@ -191,6 +229,14 @@ void msm_disp_snapshot_add_block(struct msm_disp_state *disp_state, u32 len,
 	new_blk->size = ALIGN(len, REG_DUMP_ALIGN);
 	new_blk->base_addr = base_addr;
 
+	if (disp_state->kms) {
+		new_blk->state = msm_disp_state_alloc(disp_state, new_blk->size);
+		if (!new_blk->state) {
+			disp_state->truncated++;
+			return;
+		}
+	}
+
 	msm_disp_state_dump_regs(&new_blk->state, new_blk->size, base_addr);
 	list_add_tail(&new_blk->node, &disp_state->blocks);
 }
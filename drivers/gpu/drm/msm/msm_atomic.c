@@ -4,6 +4,8 @@
  * Author: Rob Clark <robdclark@gmail.com>
  */
 
+#include <linux/seq_file.h>
+
 #include <drm/drm_atomic_uapi.h>
 #include <drm/drm_vblank.h>
 
@@ -12,6 +14,44 @@
 #include "msm_gem.h"
 #include "msm_kms.h"
 
+static uint commit_depth = 1;
+MODULE_PARM_DESC(commit_depth, "Max nonblocking commits in flight per crtc (1 (default) or 2)");
+module_param(commit_depth, uint, 0600);
+
+static void commit_latency(struct msm_kms *kms, enum msm_commit_stage stage,
+		ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+	unsigned bucket = (us > 0) ? fls64(us) : 0;
+
+	bucket = min(bucket, MSM_COMMIT_HIST_BUCKETS - 1);
+	atomic_inc(&kms->commit_hist[stage][bucket]);
+}
+
+void msm_atomic_latency_show(struct msm_kms *kms, struct seq_file *m)
+{
+	static const char *names[MSM_COMMIT_NR_STAGES] = {
+		[MSM_COMMIT_IOCTL]      = "ioctl",
+		[MSM_COMMIT_PREPARE_FB] = "prepare_fb",
+		[MSM_COMMIT_FENCE_WAIT] = "fence_wait",
+		[MSM_COMMIT_FLUSH]      = "flush",
+		[MSM_COMMIT_VBLANK]     = "vblank",
+	};
+	int i, j;
+
+	seq_printf(m, "%-10s", "us<");
+	for (j = 0; j < MSM_COMMIT_HIST_BUCKETS - 1; j++)
+		seq_printf(m, " %7u", 1u << j);
+	seq_printf(m, " %7s\n", "inf");
+
+	for (i = 0; i < MSM_COMMIT_NR_STAGES; i++) {
+		seq_printf(m, "%-10s", names[i]);
+		for (j = 0; j < MSM_COMMIT_HIST_BUCKETS; j++)
+			seq_printf(m, " %7d", atomic_read(&kms->commit_hist[i][j]));
+		seq_puts(m, "\n");
+	}
+}
+
 /*
  * Helpers to control vblanks while we flush.. basically just to ensure
  * that vblank accounting is switched on, so we get valid seqn/timestamp
@@ -207,6 +247,7 @@ void msm_atomic_commit_tail(struct drm_atomic_state *state)
 	struct drm_crtc *async_crtc = NULL;
 	unsigned crtc_mask = get_crtc_mask(state);
 	bool async = can_do_async(state, &async_crtc);
+	ktime_t start = ktime_get();
 
 	trace_msm_atomic_commit_tail_start(async, crtc_mask);
 
@@ -290,12 +331,15 @@ void msm_atomic_commit_tail(struct drm_atomic_state *state)
 	trace_msm_atomic_flush_commit(crtc_mask);
 	kms->funcs->flush_commit(kms, crtc_mask);
 	unlock_crtcs(kms, crtc_mask);
+	commit_latency(kms, MSM_COMMIT_FLUSH, start);
 	/*
 	 * Wait for flush to complete:
 	 */
+	start = ktime_get();
 	trace_msm_atomic_wait_flush_start(crtc_mask);
 	kms->funcs->wait_flush(kms, crtc_mask);
 	trace_msm_atomic_wait_flush_finish(crtc_mask);
+	commit_latency(kms, MSM_COMMIT_VBLANK, start);
 
 	vblank_put(kms, crtc_mask);
 
@@ -309,3 +353,152 @@ void msm_atomic_commit_tail(struct drm_atomic_state *state)
 
 	trace_msm_atomic_commit_tail_finish(async, crtc_mask);
 }
+
+static void commit_tail(struct drm_atomic_state *state)
+{
+	drm_atomic_helper_wait_for_dependencies(state);
+
+	msm_atomic_commit_tail(state);
+
+	drm_atomic_helper_commit_cleanup_done(state);
+
+	drm_atomic_state_put(state);
+}
+
+static void commit_work(struct work_struct *work)
+{
+	struct drm_atomic_state *state =
+		container_of(work, struct drm_atomic_state, commit_work);
+	struct msm_drm_private *priv = state->dev->dev_private;
+	ktime_t start = ktime_get();
+
+	drm_atomic_helper_wait_for_fences(state->dev, state, false);
+	commit_latency(priv->kms, MSM_COMMIT_FENCE_WAIT, start);
+
+	commit_tail(state);
+}
+
+/*
+ * With commit_depth=2, let a nonblocking commit be queued while the
+ * previous commit on the same crtcs is still waiting for its flip, rather
+ * than failing with -EBUSY.  The new commit's fence wait then overlaps
+ * the previous flip, and only the hw programming waits for it, in
+ * drm_atomic_helper_wait_for_dependencies().  But don't let it get more
+ * than that ahead, nor have planes or connectors jump ahead of a pending
+ * commit on another crtc.
+ */
+static int stall_checks(struct drm_atomic_state *state)
+{
+	struct drm_connector_state *old_conn_state, *new_conn_state;
+	struct drm_plane_state *old_plane_state, *new_plane_state;
+	struct drm_crtc_state *crtc_state;
+	struct drm_connector *conn;
+	struct drm_plane *plane;
+	struct drm_crtc *crtc;
+	unsigned crtc_mask = get_crtc_mask(state);
+	int i;
+
+	for_each_new_crtc_in_state(state, crtc, crtc_state, i) {
+		struct drm_crtc_commit *commit;
+		bool busy;
+
+		spin_lock(&crtc->commit_lock);
+		commit = list_first_entry_or_null(&crtc->commit_list,
+				struct drm_crtc_commit, commit_entry);
+		busy = commit && !list_is_last(&commit->commit_entry,
+					       &crtc->commit_list);
+		spin_unlock(&crtc->commit_lock);
+
+		if (busy)
+			return -EBUSY;
+	}
+
+	for_each_oldnew_connector_in_state(state, conn, old_conn_state, new_conn_state, i) {
+		struct drm_crtc_commit *commit = old_conn_state->commit;
+
+		if (commit && !completion_done(&commit->flip_done) &&
+		    !(crtc_mask & drm_crtc_mask(commit->crtc)))
+			return -EBUSY;
+	}
+
+	for_each_oldnew_plane_in_state(state, plane, old_plane_state, new_plane_state, i) {
+		struct drm_crtc_commit *commit = old_plane_state->commit;
+
+		if (commit && !completion_done(&commit->flip_done) &&
+		    !(crtc_mask & drm_crtc_mask(commit->crtc)))
+			return -EBUSY;
+	}
+
+	return 0;
+}
+
+/*
+ * Like drm_atomic_helper_commit(), but timing the stages of the commit,
+ * and with support for queueing nonblocking commits two deep.
+ */
+int msm_atomic_commit(struct drm_device *dev, struct drm_atomic_state *state,
+		bool nonblock)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_kms *kms = priv->kms;
+	ktime_t start = ktime_get(), t;
+	int ret;
+
+	if (state->async_update) {
+		ret = drm_atomic_helper_prepare_planes(dev, state);
+		if (ret)
+			return ret;
+
+		drm_atomic_helper_async_commit(dev, state);
+		drm_atomic_helper_unprepare_planes(dev, state);
+
+		return 0;
+	}
+
+	if (nonblock && (commit_depth > 1)) {
+		ret = stall_checks(state);
+		if (ret)
+			return ret;
+
+		/* Nothing left to stall on, but skip the helper's -EBUSY: */
+		ret = drm_atomic_helper_setup_commit(state, false);
+	} else {
+		ret = drm_atomic_helper_setup_commit(state, nonblock);
+	}
+	if (ret)
+		return ret;
+
+	INIT_WORK(&state->commit_work, commit_work);
+
+	t = ktime_get();
+	ret = drm_atomic_helper_prepare_planes(dev, state);
+	if (ret)
+		return ret;
+	commit_latency(kms, MSM_COMMIT_PREPARE_FB, t);
+
+	if (!nonblock) {
+		t = ktime_get();
+		ret = drm_atomic_helper_wait_for_fences(dev, state, true);
+		if (ret)
+			goto err;
+		commit_latency(kms, MSM_COMMIT_FENCE_WAIT, t);
+	}
+
+	ret = drm_atomic_helper_swap_state(state, true);
+	if (ret)
+		goto err;
+
+	drm_atomic_state_get(state);
+	if (nonblock)
+		queue_work(system_unbound_wq, &state->commit_work);
+	else
+		commit_tail(state);
+
+	commit_latency(kms, MSM_COMMIT_IOCTL, start);
+
+	return 0;
+
+err:
+	drm_atomic_helper_unprepare_planes(dev, state);
+	return ret;
+}
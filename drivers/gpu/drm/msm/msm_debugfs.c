@@ -117,6 +117,31 @@ static const struct file_operations msm_gpu_fops = {
 	.release = msm_gpu_release,
 };
 
+static int msm_recovery_show(struct seq_file *m, void *arg)
+{
+	struct drm_device *dev = m->private;
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gpu *gpu = priv->gpu;
+	u64 avg_us = 0;
+	int ret;
+
+	ret = mutex_lock_interruptible(&gpu->lock);
+	if (ret)
+		return ret;
+
+	if (gpu->recovery.count)
+		avg_us = div_u64(gpu->recovery.total_us, gpu->recovery.count);
+
+	seq_printf(m, "count:   %u\n", gpu->recovery.count);
+	seq_printf(m, "soft:    %u\n", gpu->recovery.soft);
+	seq_printf(m, "avg_us:  %llu\n", avg_us);
+
+	mutex_unlock(&gpu->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(msm_recovery);
+
 /*
  * Display Snapshot:
  */
@@ -224,6 +249,9 @@ static int msm_gem_show(struct seq_file *m, void *arg)
 
 	mutex_unlock(&priv->obj_lock);
 
+	seq_printf(m, "Zpool:     %9lu bytes\n",
+		   msm_gem_zpool_size(dev) << PAGE_SHIFT);
+
 	return 0;
 }
 
@@ -263,6 +291,17 @@ static int msm_fb_show(struct seq_file *m, void *arg)
 	return 0;
 }
 
+static int msm_commit_latency_show(struct seq_file *m, void *arg)
+{
+	struct drm_device *dev = m->private;
+	struct msm_drm_private *priv = dev->dev_private;
+
+	msm_atomic_latency_show(priv->kms, m);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(msm_commit_latency);
+
 static struct drm_info_list msm_debugfs_list[] = {
 		{"gem", msm_gem_show},
 		{ "mm", msm_mm_show },
@@ -313,6 +352,9 @@ static void msm_debugfs_gpu_init(struct drm_minor *minor)
 	debugfs_create_file("gpu", S_IRUSR, minor->debugfs_root,
 		dev, &msm_gpu_fops);
 
+	debugfs_create_file("recovery", S_IRUSR, minor->debugfs_root,
+		dev, &msm_recovery_fops);
+
 	debugfs_create_u32("hangcheck_period_ms", 0600, minor->debugfs_root,
 		&priv->hangcheck_period);
 
@@ -349,6 +391,8 @@ void msm_debugfs_init(struct drm_minor *minor)
 					 minor->debugfs_root, minor);
 		debugfs_create_file("kms", S_IRUSR, minor->debugfs_root,
 				    dev, &msm_kms_fops);
+		debugfs_create_file("commit_latency", S_IRUSR, minor->debugfs_root,
+				    dev, &msm_commit_latency_fops);
 	}
 
 	debugfs_create_file("shrink", S_IRWXU, minor->debugfs_root,
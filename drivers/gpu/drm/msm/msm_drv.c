@@ -39,9 +39,13 @@
  * - 1.10.0 - Add MSM_SUBMIT_BO_NO_IMPLICIT
  * - 1.11.0 - Add wait boost (MSM_WAIT_FENCE_BOOST, MSM_PREP_BOOST)
  * - 1.12.0 - Add MSM_INFO_SET_METADATA and MSM_INFO_GET_METADATA
+ * - 1.13.0 - Add VM_BIND ioctl and MSM_PARAM_EN_VM_BIND
+ * - 1.14.0 - Async VM_BIND, sparse (MAP_NULL) and partial BO mappings
+ * - 1.15.0 - Add MSM_SUBMITQUEUE_FREQ_FLOOR
+ * - 1.16.0 - Add PERFCNTR ioctl and MSM_SUBMIT_CMD_PERFCNTR_BUF
  */
 #define MSM_VERSION_MAJOR	1
-#define MSM_VERSION_MINOR	12
+#define MSM_VERSION_MINOR	16
 #define MSM_VERSION_PATCHLEVEL	0
 
 static void msm_deinit_vram(struct drm_device *ddev);
@@ -89,6 +93,7 @@ static int msm_drm_uninit(struct device *dev)
 
 	flush_workqueue(priv->wq);
 
+	msm_gem_prime_import_cache_fini(ddev);
 	msm_gem_shrinker_cleanup(ddev);
 
 	msm_perf_debugfs_cleanup(priv);
@@ -98,6 +103,7 @@ static int msm_drm_uninit(struct device *dev)
 		msm_drm_kms_uninit(dev);
 
 	msm_deinit_vram(ddev);
+	msm_gem_shmem_fini(ddev);
 
 	component_unbind_all(dev, ddev);
 
@@ -244,12 +250,17 @@ static int msm_drm_init(struct device *dev, const struct drm_driver *drv)
 	drm_gem_lru_init(&priv->lru.pinned,   &priv->lru.lock);
 	drm_gem_lru_init(&priv->lru.willneed, &priv->lru.lock);
 	drm_gem_lru_init(&priv->lru.dontneed, &priv->lru.lock);
+	drm_gem_lru_init(&priv->lru.compressed, &priv->lru.lock);
+
+	msm_gem_prime_import_cache_init(ddev);
 
 	/* Teach lockdep about lock ordering wrt. shrinker: */
 	fs_reclaim_acquire(GFP_KERNEL);
 	might_lock(&priv->lru.lock);
 	fs_reclaim_release(GFP_KERNEL);
 
+	msm_gem_shmem_init(ddev);
+
 	if (priv->kms_init) {
 		ret = drmm_mode_config_init(ddev);
 		if (ret)
@@ -305,6 +316,7 @@ static int msm_drm_init(struct device *dev, const struct drm_driver *drv)
 err_deinit_vram:
 	msm_deinit_vram(ddev);
 err_destroy_wq:
+	msm_gem_shmem_fini(ddev);
 	destroy_workqueue(priv->wq);
 err_put_dev:
 	drm_dev_put(ddev);
@@ -366,6 +378,8 @@ static int msm_open(struct drm_device *dev, struct drm_file *file)
 static void context_close(struct msm_file_private *ctx)
 {
 	msm_submitqueue_close(ctx);
+	if (ctx->vm_bind)
+		msm_gem_vm_bind_fini(ctx->aspace);
 	msm_file_private_put(ctx);
 }
 
@@ -378,8 +392,10 @@ static void msm_postclose(struct drm_device *dev, struct drm_file *file)
 	 * It is not possible to set sysprof param to non-zero if gpu
 	 * is not initialized:
 	 */
-	if (priv->gpu)
+	if (priv->gpu) {
 		msm_file_private_set_sysprof(ctx, priv->gpu, 0);
+		msm_perfcntr_release_all(priv->gpu, ctx);
+	}
 
 	context_close(ctx);
 }
@@ -868,6 +884,8 @@ static const struct drm_ioctl_desc msm_ioctls[] = {
 	DRM_IOCTL_DEF_DRV(MSM_SUBMITQUEUE_NEW,   msm_ioctl_submitqueue_new,   DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(MSM_SUBMITQUEUE_CLOSE, msm_ioctl_submitqueue_close, DRM_RENDER_ALLOW),
 	DRM_IOCTL_DEF_DRV(MSM_SUBMITQUEUE_QUERY, msm_ioctl_submitqueue_query, DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(MSM_VM_BIND,      msm_ioctl_vm_bind,      DRM_RENDER_ALLOW),
+	DRM_IOCTL_DEF_DRV(MSM_PERFCNTR,     msm_ioctl_perfcntr,     DRM_RENDER_ALLOW),
 };
 
 static void msm_show_fdinfo(struct drm_printer *p, struct drm_file *file)
@@ -899,6 +917,7 @@ static const struct drm_driver msm_driver = {
 	.postclose          = msm_postclose,
 	.dumb_create        = msm_gem_dumb_create,
 	.dumb_map_offset    = msm_gem_dumb_map_offset,
+	.gem_prime_import   = msm_gem_prime_import,
 	.gem_prime_import_sg_table = msm_gem_prime_import_sg_table,
 #ifdef CONFIG_DEBUG_FS
 	.debugfs_init       = msm_debugfs_init,
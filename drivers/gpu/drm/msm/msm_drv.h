@@ -50,6 +50,8 @@ struct msm_gem_submit;
 struct msm_fence_context;
 struct msm_gem_address_space;
 struct msm_gem_vma;
+struct msm_gem_gather;
+struct msm_gem_zpool;
 struct msm_disp_state;
 
 #define MAX_CRTCS      8
@@ -125,6 +127,7 @@ struct msm_drm_private {
 
 	struct msm_rd_state *rd;       /* debugfs to dump all submits */
 	struct msm_rd_state *hangrd;   /* debugfs to dump hanging submits */
+	struct msm_rd_state *rd_relay; /* debugfs lossy capture of all submits */
 	struct msm_perf_state *perf;
 
 	/**
@@ -148,11 +151,13 @@ struct msm_drm_private {
 	 * ringbuffer, memptr, fw, etc) it moves to the pinned LRU.  When
 	 * unpinned, it moves into willneed or dontneed LRU depending on
 	 * madvise state.  When backing pages are evicted (willneed) or
-	 * purged (dontneed) it moves back into the unbacked LRU.
+	 * purged (dontneed) it moves back into the unbacked LRU.  When
+	 * the contents are compressed instead, it moves into the
+	 * compressed LRU until the pages are needed again.
 	 *
 	 * The dontneed LRU is considered by the shrinker for objects
 	 * that are candidate for purging, and the willneed LRU is
-	 * considered for objects that could be evicted.
+	 * considered for objects that could be compressed or evicted.
 	 */
 	struct {
 		/**
@@ -187,6 +192,22 @@ struct msm_drm_private {
 		 */
 		struct drm_gem_lru dontneed;
 
+		/**
+		 * compressed:
+		 *
+		 * The LRU for GEM objects whose contents are held
+		 * compressed in the zpool, without backing pages
+		 */
+		struct drm_gem_lru compressed;
+
+		/**
+		 * gen:
+		 *
+		 * The current LRU generation, advanced by each shrinker
+		 * scan.  Used to age objects in the willneed LRU.
+		 */
+		atomic_t gen;
+
 		/**
 		 * lock:
 		 *
@@ -195,6 +216,16 @@ struct msm_drm_private {
 		struct mutex lock;
 	} lru;
 
+	/**
+	 * gemfs:
+	 *
+	 * Private tmpfs mount with transparent huge pages enabled, used as
+	 * the backing store of shmem GEM objects so that large buffers get
+	 * large folios and can be mapped with 2M IOMMU pages.  NULL if THP
+	 * is not available, in which case the default shm mount is used.
+	 */
+	struct vfsmount *gemfs;
+
 	struct workqueue_struct *wq;
 
 	unsigned int num_crtcs;
@@ -215,6 +246,38 @@ struct msm_drm_private {
 	struct notifier_block vmap_notifier;
 	struct shrinker *shrinker;
 
+	/**
+	 * shrink_gather:
+	 *
+	 * Batches the TLB invalidates of a shrinker scan.  Owned by at most
+	 * one scan at a time (shrink_owner), concurrent scans fall back to
+	 * invalidating per object.
+	 */
+	struct mutex shrink_lock;
+	struct task_struct *shrink_owner;
+	struct msm_gem_gather *shrink_gather;
+
+	/* Pool for the compressed eviction tier, see msm_gem_compress.c */
+	struct msm_gem_zpool *zpool;
+
+	/**
+	 * import_cache:
+	 *
+	 * Recently imported dma-bufs, most recently used last, which are
+	 * kept around after their last handle is closed so that importing
+	 * them again reuses the existing sg_table and iova mappings.  See
+	 * msm_gem_prime_import().  Under memory pressure the shrinker hands
+	 * entries that nothing else references to @evicted, and @put_work
+	 * drops them.
+	 */
+	struct {
+		struct mutex lock;
+		struct list_head list;
+		unsigned count;
+		struct list_head evicted;
+		struct work_struct put_work;
+	} import_cache;
+
 	struct drm_atomic_state *pm_state;
 
 	/**
@@ -252,6 +315,9 @@ int msm_atomic_init_pending_timer(struct msm_pending_timer *timer,
 		struct msm_kms *kms, int crtc_idx);
 void msm_atomic_destroy_pending_timer(struct msm_pending_timer *timer);
 void msm_atomic_commit_tail(struct drm_atomic_state *state);
+int msm_atomic_commit(struct drm_device *dev, struct drm_atomic_state *state,
+		bool nonblock);
+void msm_atomic_latency_show(struct msm_kms *kms, struct seq_file *m);
 int msm_atomic_check(struct drm_device *dev, struct drm_atomic_state *state);
 struct drm_atomic_state *msm_atomic_state_alloc(struct drm_device *dev);
 void msm_atomic_state_clear(struct drm_atomic_state *state);
@@ -268,6 +334,10 @@ bool msm_use_mmu(struct drm_device *dev);
 
 int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		struct drm_file *file);
+int msm_ioctl_vm_bind(struct drm_device *dev, void *data,
+		struct drm_file *file);
+int msm_ioctl_perfcntr(struct drm_device *dev, void *data,
+		struct drm_file *file);
 
 #ifdef CONFIG_DEBUG_FS
 unsigned long msm_gem_shrinker_shrink(struct drm_device *dev, unsigned long nr_to_scan);
@@ -276,11 +346,21 @@ unsigned long msm_gem_shrinker_shrink(struct drm_device *dev, unsigned long nr_t
 int msm_gem_shrinker_init(struct drm_device *dev);
 void msm_gem_shrinker_cleanup(struct drm_device *dev);
 
+void msm_gem_shmem_init(struct drm_device *dev);
+void msm_gem_shmem_fini(struct drm_device *dev);
+
 struct sg_table *msm_gem_prime_get_sg_table(struct drm_gem_object *obj);
 int msm_gem_prime_vmap(struct drm_gem_object *obj, struct iosys_map *map);
 void msm_gem_prime_vunmap(struct drm_gem_object *obj, struct iosys_map *map);
 struct drm_gem_object *msm_gem_prime_import_sg_table(struct drm_device *dev,
 		struct dma_buf_attachment *attach, struct sg_table *sg);
+struct drm_gem_object *msm_gem_prime_import(struct drm_device *dev,
+		struct dma_buf *dma_buf);
+void msm_gem_prime_import_cache_init(struct drm_device *dev);
+void msm_gem_prime_import_cache_fini(struct drm_device *dev);
+unsigned long msm_gem_prime_import_cache_count(struct msm_drm_private *priv);
+unsigned long msm_gem_prime_import_cache_scan(struct msm_drm_private *priv,
+		unsigned long nr_to_scan);
 int msm_gem_prime_pin(struct drm_gem_object *obj);
 void msm_gem_prime_unpin(struct drm_gem_object *obj);
 
@@ -26,16 +26,59 @@ static enum hrtimer_restart deadline_timer(struct hrtimer *t)
 	return HRTIMER_NORESTART;
 }
 
+static struct msm_ringbuffer *fctx2ring(struct msm_fence_context *fctx)
+{
+	struct msm_gpu *gpu = fctx2gpu(fctx);
+	int i;
+
+	for (i = 0; i < gpu->nr_rings; i++)
+		if (gpu->rb[i]->fctx == fctx)
+			return gpu->rb[i];
+
+	return NULL;
+}
+
+/*
+ * Pick the GPU freq needed to get the work queued ahead of the deadline
+ * fence done in time.  While the deadline is still far enough out, check
+ * again half way there, so the estimate follows the queue as it drains.
+ */
 static void deadline_work(struct kthread_work *work)
 {
 	struct msm_fence_context *fctx = container_of(work,
 			struct msm_fence_context, deadline_work);
+	struct msm_gpu *gpu = fctx2gpu(fctx);
+	struct msm_ringbuffer *ring = fctx2ring(fctx);
+	unsigned long flags;
+	ktime_t deadline, now;
+	uint32_t fence;
+	u64 cycles;
+
+	spin_lock_irqsave(&fctx->spinlock, flags);
+	deadline = fctx->next_deadline;
+	fence = fctx->next_deadline_fence;
+	spin_unlock_irqrestore(&fctx->spinlock, flags);
 
 	/* If deadline fence has already passed, nothing to do: */
-	if (msm_fence_completed(fctx, fctx->next_deadline_fence))
+	if (msm_fence_completed(fctx, fence))
+		return;
+
+	cycles = ring ? msm_gpu_queued_cycles(gpu, ring, fence) : 0;
+
+	msm_devfreq_deadline(gpu, fence, cycles, deadline);
+
+	now = ktime_get();
+	if (ktime_ms_delta(deadline, now) < 2)
 		return;
 
-	msm_devfreq_boost(fctx2gpu(fctx), 2);
+	spin_lock_irqsave(&fctx->spinlock, flags);
+	if (fctx->next_deadline_fence == fence &&
+	    !msm_fence_completed(fctx, fence)) {
+		hrtimer_start(&fctx->deadline_timer,
+			      ktime_add(now, ktime_sub(deadline, now) / 2),
+			      HRTIMER_MODE_ABS);
+	}
+	spin_unlock_irqrestore(&fctx->spinlock, flags);
 }
 
 
@@ -147,19 +190,12 @@ static void msm_fence_set_deadline(struct dma_fence *fence, ktime_t deadline)
 			max(fctx->next_deadline_fence, (uint32_t)fence->seqno);
 
 		/*
-		 * Set timer to trigger boost 3ms before deadline, or
-		 * if we are already less than 3ms before the deadline
-		 * schedule boost work immediately.
+		 * Work out the freq needed to meet the new deadline right
+		 * away, the deadline work re-arms the timer to refine it.
 		 */
-		deadline = ktime_sub(deadline, ms_to_ktime(3));
-
-		if (ktime_after(now, deadline)) {
-			kthread_queue_work(fctx2gpu(fctx)->worker,
-					&fctx->deadline_work);
-		} else {
-			hrtimer_start(&fctx->deadline_timer, deadline,
-					HRTIMER_MODE_ABS);
-		}
+		hrtimer_try_to_cancel(&fctx->deadline_timer);
+		kthread_queue_work(fctx2gpu(fctx)->worker,
+				&fctx->deadline_work);
 	}
 
 	spin_unlock_irqrestore(&fctx->spinlock, flags);
@@ -9,6 +9,8 @@
 #include <linux/spinlock.h>
 #include <linux/shmem_fs.h>
 #include <linux/dma-buf.h>
+#include <linux/fs.h>
+#include <linux/mount.h>
 #include <linux/pfn_t.h>
 
 #include <drm/drm_prime.h>
@@ -22,6 +24,72 @@
 #include "msm_gpu.h"
 #include "msm_mmu.h"
 
+static bool huge_pages = true;
+MODULE_PARM_DESC(huge_pages, "Back large GEM buffers with transparent huge pages");
+module_param(huge_pages, bool, 0400);
+
+/*
+ * Mount a private tmpfs instance with huge=within_size, so that shmem
+ * backed buffers (of at least 2M) are allocated from large folios.  The
+ * sg_table of such a buffer ends up with physically contiguous and aligned
+ * segments, which lets the IOMMU map it with 2M pages instead of 4K ones,
+ * reducing GPU TLB misses and pagetable walks.
+ */
+void msm_gem_shmem_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	char huge_opt[] = "huge=within_size";
+	struct file_system_type *type;
+	struct vfsmount *gemfs;
+
+	if (!huge_pages || !IS_ENABLED(CONFIG_TRANSPARENT_HUGEPAGE))
+		return;
+
+	type = get_fs_type("tmpfs");
+	if (!type)
+		return;
+
+	gemfs = vfs_kern_mount(type, SB_KERNMOUNT, type->name, huge_opt);
+	if (IS_ERR(gemfs)) {
+		DRM_DEV_INFO(dev->dev, "could not mount huge tmpfs: %ld\n",
+			     PTR_ERR(gemfs));
+		return;
+	}
+
+	priv->gemfs = gemfs;
+}
+
+void msm_gem_shmem_fini(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	if (priv->gemfs) {
+		kern_unmount(priv->gemfs);
+		priv->gemfs = NULL;
+	}
+}
+
+static int msm_gem_shmem_object_init(struct drm_device *dev,
+		struct drm_gem_object *obj, size_t size)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct file *filp;
+
+	if (!priv->gemfs)
+		return drm_gem_object_init(dev, obj, size);
+
+	drm_gem_private_object_init(dev, obj, size);
+
+	filp = shmem_file_setup_with_mnt(priv->gemfs, "drm mm object", size,
+					 VM_NORESERVE);
+	if (IS_ERR(filp))
+		return PTR_ERR(filp);
+
+	obj->filp = filp;
+
+	return 0;
+}
+
 static dma_addr_t physaddr(struct drm_gem_object *obj)
 {
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
@@ -102,6 +170,7 @@ static void update_lru_active(struct drm_gem_object *obj)
 	if (msm_obj->pin_count) {
 		drm_gem_lru_move_tail_locked(&priv->lru.pinned, obj);
 	} else if (msm_obj->madv == MSM_MADV_WILLNEED) {
+		msm_obj->lru_gen = atomic_read(&priv->lru.gen);
 		drm_gem_lru_move_tail_locked(&priv->lru.willneed, obj);
 	} else {
 		GEM_WARN_ON(msm_obj->madv != MSM_MADV_DONTNEED);
@@ -120,7 +189,10 @@ static void update_lru_locked(struct drm_gem_object *obj)
 	if (!msm_obj->pages) {
 		GEM_WARN_ON(msm_obj->pin_count);
 
-		drm_gem_lru_move_tail_locked(&priv->lru.unbacked, obj);
+		if (msm_obj->zpages)
+			drm_gem_lru_move_tail_locked(&priv->lru.compressed, obj);
+		else
+			drm_gem_lru_move_tail_locked(&priv->lru.unbacked, obj);
 	} else {
 		update_lru_active(obj);
 	}
@@ -187,6 +259,16 @@ static struct page **get_pages(struct drm_gem_object *obj)
 			return p;
 		}
 
+		/* Restore the contents from the compressed tier: */
+		if (msm_obj->zpages) {
+			int ret = msm_gem_zpool_load(obj, p);
+
+			if (ret) {
+				drm_gem_put_pages(obj, p, false, false);
+				return ERR_PTR(ret);
+			}
+		}
+
 		update_device_mem(dev->dev_private, obj->size);
 
 		msm_obj->pages = p;
@@ -444,22 +526,119 @@ static void del_vma(struct msm_gem_vma *vma)
  * iova range) in addition to removing the iommu mapping.  In the eviction
  * case (!close), we keep the iova allocated, but only remove the iommu
  * mapping.
+ *
+ * The TLB invalidate is issued once for all of the object's mappings.  If
+ * @gather is non-NULL it is deferred further, and the closed VMAs are
+ * handed over to the gather so that their iova ranges are not reused
+ * before msm_gem_gather_flush().
  */
 static void
-put_iova_spaces(struct drm_gem_object *obj, bool close)
+put_iova_spaces(struct drm_gem_object *obj, bool close,
+		struct msm_gem_gather *gather)
 {
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
-	struct msm_gem_vma *vma;
+	struct msm_mmu_gather tlb = {};
+	struct msm_gem_vma *vma, *tmp;
 
 	msm_gem_assert_locked(obj);
 
 	list_for_each_entry(vma, &msm_obj->vmas, list) {
-		if (vma->aspace) {
-			msm_gem_vma_purge(vma);
-			if (close)
-				msm_gem_vma_close(vma);
+		if (vma->aspace)
+			msm_gem_vma_purge(vma, gather ? &gather->tlb : &tlb);
+	}
+
+	if (gather) {
+		if (!close)
+			return;
+
+		list_for_each_entry_safe(vma, tmp, &msm_obj->vmas, list) {
+			if (vma->aspace)
+				list_move_tail(&vma->list, &gather->vmas);
 		}
+
+		return;
 	}
+
+	msm_mmu_gather_flush(&tlb);
+
+	if (!close)
+		return;
+
+	list_for_each_entry(vma, &msm_obj->vmas, list) {
+		if (vma->aspace)
+			msm_gem_vma_close(vma);
+	}
+}
+
+/*
+ * Hold a reference to the backing pages until the gather is flushed, as
+ * the GPU can still reach them through stale TLB entries until then.
+ */
+static void
+gather_pages(struct drm_gem_object *obj, struct msm_gem_gather *gather)
+{
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	unsigned i, npages = obj->size >> PAGE_SHIFT;
+
+	if (!msm_obj->pages)
+		return;
+
+	/* VRAM carveout is handed straight back to the allocator: */
+	if (!use_pages(obj)) {
+		msm_gem_gather_flush(gather);
+		return;
+	}
+
+	for (i = 0; i < npages; i++) {
+		struct folio *folio = page_folio(msm_obj->pages[i]);
+
+		if (gather->nr_folios == gather->max_folios)
+			msm_gem_gather_flush(gather);
+
+		folio_get(folio);
+		gather->folios[gather->nr_folios++] = folio;
+		i += folio_nr_pages(folio) - 1;
+	}
+}
+
+int msm_gem_gather_init(struct msm_gem_gather *gather, unsigned max_folios)
+{
+	gather->folios = kvmalloc_array(max_folios, sizeof(*gather->folios),
+					GFP_KERNEL);
+	if (!gather->folios)
+		return -ENOMEM;
+
+	gather->tlb.mmu = NULL;
+	INIT_LIST_HEAD(&gather->vmas);
+	gather->nr_folios = 0;
+	gather->max_folios = max_folios;
+
+	return 0;
+}
+
+void msm_gem_gather_fini(struct msm_gem_gather *gather)
+{
+	msm_gem_gather_flush(gather);
+	kvfree(gather->folios);
+}
+
+/*
+ * Issue the deferred TLB invalidate, and only then release the iova ranges
+ * and backing pages of the objects torn down under the gather.
+ */
+void msm_gem_gather_flush(struct msm_gem_gather *gather)
+{
+	struct msm_gem_vma *vma, *tmp;
+
+	msm_mmu_gather_flush(&gather->tlb);
+
+	list_for_each_entry_safe(vma, tmp, &gather->vmas, list) {
+		msm_gem_vma_close(vma);
+		del_vma(vma);
+	}
+
+	release_pages(gather->folios, gather->nr_folios);
+	gather->nr_folios = 0;
 }
 
 /* Called with msm_obj locked */
@@ -507,10 +686,10 @@ static struct msm_gem_vma *get_vma_locked(struct drm_gem_object *obj,
 	return vma;
 }
 
-int msm_gem_pin_vma_locked(struct drm_gem_object *obj, struct msm_gem_vma *vma)
+/* The iommu prot flags to map the object with */
+int msm_gem_prot(struct drm_gem_object *obj)
 {
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
-	struct page **pages;
 	int prot = IOMMU_READ;
 
 	if (!(msm_obj->flags & MSM_BO_GPU_READONLY))
@@ -522,6 +701,15 @@ int msm_gem_pin_vma_locked(struct drm_gem_object *obj, struct msm_gem_vma *vma)
 	if (msm_obj->flags & MSM_BO_CACHED_COHERENT)
 		prot |= IOMMU_CACHE;
 
+	return prot;
+}
+
+int msm_gem_pin_vma_locked(struct drm_gem_object *obj, struct msm_gem_vma *vma)
+{
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	struct page **pages;
+	int prot = msm_gem_prot(obj);
+
 	msm_gem_assert_locked(obj);
 
 	pages = msm_gem_get_pages_locked(obj, MSM_MADV_WILLNEED);
@@ -642,7 +830,7 @@ static int clear_iova(struct drm_gem_object *obj,
 	if (!vma)
 		return 0;
 
-	msm_gem_vma_purge(vma);
+	msm_gem_vma_purge(vma, NULL);
 	msm_gem_vma_close(vma);
 	del_vma(vma);
 
@@ -843,7 +1031,11 @@ int msm_gem_madvise(struct drm_gem_object *obj, unsigned madv)
 	return (madv != __MSM_MADV_PURGED);
 }
 
-void msm_gem_purge(struct drm_gem_object *obj)
+/*
+ * If @gather is non-NULL, the TLB invalidate and the release of the iova
+ * ranges and pages are deferred to msm_gem_gather_flush().
+ */
+void msm_gem_purge(struct drm_gem_object *obj, struct msm_gem_gather *gather)
 {
 	struct drm_device *dev = obj->dev;
 	struct msm_drm_private *priv = obj->dev->dev_private;
@@ -853,12 +1045,15 @@ void msm_gem_purge(struct drm_gem_object *obj)
 	GEM_WARN_ON(!is_purgeable(msm_obj));
 
 	/* Get rid of any iommu mapping(s): */
-	put_iova_spaces(obj, true);
+	put_iova_spaces(obj, true, gather);
 
 	msm_gem_vunmap(obj);
 
 	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
 
+	if (gather)
+		gather_pages(obj, gather);
+
 	put_pages(obj);
 
 	put_iova_vmas(obj);
@@ -866,6 +1061,10 @@ void msm_gem_purge(struct drm_gem_object *obj)
 	mutex_lock(&priv->lru.lock);
 	/* A one-way transition: */
 	msm_obj->madv = __MSM_MADV_PURGED;
+	if (msm_obj->zpages) {
+		msm_gem_zpool_free(obj);
+		update_lru_locked(obj);
+	}
 	mutex_unlock(&priv->lru.lock);
 
 	drm_gem_free_mmap_offset(obj);
@@ -884,20 +1083,70 @@ void msm_gem_purge(struct drm_gem_object *obj)
 /*
  * Unpin the backing pages and make them available to be swapped out.
  */
-void msm_gem_evict(struct drm_gem_object *obj)
+void msm_gem_evict(struct drm_gem_object *obj, struct msm_gem_gather *gather)
+{
+	struct drm_device *dev = obj->dev;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+
+	msm_gem_assert_locked(obj);
+	GEM_WARN_ON(is_unevictable(msm_obj));
+
+	/* Get rid of any iommu mapping(s): */
+	put_iova_spaces(obj, false, gather);
+
+	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
+
+	if (gather)
+		gather_pages(obj, gather);
+
+	put_pages(obj);
+}
+
+/*
+ * Compress the contents into the zpool and release the backing pages.  If
+ * the contents don't compress well, the object is left alone but treated
+ * as recently used, so it isn't immediately reconsidered.
+ */
+int msm_gem_compress(struct drm_gem_object *obj, struct msm_gem_gather *gather)
 {
 	struct drm_device *dev = obj->dev;
+	struct msm_drm_private *priv = obj->dev->dev_private;
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	int ret;
 
 	msm_gem_assert_locked(obj);
 	GEM_WARN_ON(is_unevictable(msm_obj));
 
+	if (!use_pages(obj) || !msm_obj->pages)
+		return -EINVAL;
+
+	ret = msm_gem_zpool_store(obj);
+	if (ret) {
+		if (ret == -E2BIG) {
+			mutex_lock(&priv->lru.lock);
+			msm_obj->lru_gen = atomic_read(&priv->lru.gen);
+			mutex_unlock(&priv->lru.lock);
+		}
+		return ret;
+	}
+
 	/* Get rid of any iommu mapping(s): */
-	put_iova_spaces(obj, false);
+	put_iova_spaces(obj, false, gather);
 
 	drm_vma_node_unmap(&obj->vma_node, dev->anon_inode->i_mapping);
 
+	if (gather)
+		gather_pages(obj, gather);
+
 	put_pages(obj);
+
+	/*
+	 * Unlike eviction, the contents now live in the zpool, so drop the
+	 * shmem backing store rather than leaving it to swap:
+	 */
+	shmem_truncate_range(file_inode(obj->filp), 0, (loff_t)-1);
+
+	return 0;
 }
 
 void msm_gem_vunmap(struct drm_gem_object *obj)
@@ -954,6 +1203,22 @@ int msm_gem_cpu_fini(struct drm_gem_object *obj)
 }
 
 #ifdef CONFIG_DEBUG_FS
+/*
+ * The largest page size (up to 2M) that a mapping of the object at iova
+ * can use, given the alignment of the backing memory.
+ */
+static unsigned long map_granule(struct msm_gem_object *msm_obj, u64 iova)
+{
+	struct scatterlist *sg;
+	u64 mask = iova | SZ_2M;
+	unsigned int i;
+
+	for_each_sgtable_sg(msm_obj->sgt, sg, i)
+		mask |= sg_phys(sg) | sg->length;
+
+	return 1UL << __ffs64(mask);
+}
+
 void msm_gem_describe(struct drm_gem_object *obj, struct seq_file *m,
 		struct msm_gem_stats *stats)
 {
@@ -978,6 +1243,11 @@ void msm_gem_describe(struct drm_gem_object *obj, struct seq_file *m,
 		stats->resident.size += obj->size;
 	}
 
+	if (msm_obj->zpages) {
+		stats->compressed.count++;
+		stats->compressed.size += obj->size;
+	}
+
 	switch (msm_obj->madv) {
 	case __MSM_MADV_PURGED:
 		stats->purged.count++;
@@ -1022,10 +1292,14 @@ void msm_gem_describe(struct drm_gem_object *obj, struct seq_file *m,
 			} else {
 				name = comm = NULL;
 			}
-			seq_printf(m, " [%s%s%s: aspace=%p, %08llx,%s]",
+			seq_printf(m, " [%s%s%s: aspace=%p, %08llx,%s",
 				name, comm ? ":" : "", comm ? comm : "",
 				vma->aspace, vma->iova,
 				vma->mapped ? "mapped" : "unmapped");
+			if (vma->mapped && msm_obj->sgt)
+				seq_printf(m, ",%luK",
+					   map_granule(msm_obj, vma->iova) / SZ_1K);
+			seq_puts(m, "]");
 			kfree(comm);
 		}
 
@@ -1058,6 +1332,8 @@ void msm_gem_describe_objects(struct list_head *list, struct seq_file *m)
 			stats.purgeable.count, stats.purgeable.size);
 	seq_printf(m, "Purged:    %4d objects, %9zu bytes\n",
 			stats.purged.count, stats.purged.size);
+	seq_printf(m, "Compressed:%4d objects, %9zu bytes\n",
+			stats.compressed.count, stats.compressed.size);
 }
 #endif
 
@@ -1072,7 +1348,15 @@ static void msm_gem_free_object(struct drm_gem_object *obj)
 	list_del(&msm_obj->node);
 	mutex_unlock(&priv->obj_lock);
 
-	put_iova_spaces(obj, true);
+	/*
+	 * If the last reference is dropped by a shrinker scan, the object may
+	 * have been evicted under the scan's gather, and its iova ranges must
+	 * not be reused before the deferred TLB invalidate:
+	 */
+	if (priv->shrink_owner == current)
+		msm_gem_gather_flush(priv->shrink_gather);
+
+	put_iova_spaces(obj, true, NULL);
 
 	if (obj->import_attach) {
 		GEM_WARN_ON(msm_obj->vaddr);
@@ -1088,6 +1372,7 @@ static void msm_gem_free_object(struct drm_gem_object *obj)
 	} else {
 		msm_gem_vunmap(obj);
 		put_pages(obj);
+		msm_gem_zpool_free(obj);
 		put_iova_vmas(obj);
 	}
 
@@ -1199,6 +1484,8 @@ static int msm_gem_new_impl(struct drm_device *dev,
 	*obj = &msm_obj->base;
 	(*obj)->funcs = &msm_gem_object_funcs;
 
+	msm_gem_prefetch_init(*obj);
+
 	return 0;
 }
 
@@ -1259,7 +1546,7 @@ struct drm_gem_object *msm_gem_new(struct drm_device *dev, uint32_t size, uint32
 
 		vma->iova = physaddr(obj);
 	} else {
-		ret = drm_gem_object_init(dev, obj, size);
+		ret = msm_gem_shmem_object_init(dev, obj, size);
 		if (ret)
 			goto fail;
 		/*
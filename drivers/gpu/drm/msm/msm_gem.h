@@ -9,9 +9,12 @@
 
 #include <linux/kref.h>
 #include <linux/dma-resv.h>
+#include <linux/rbtree.h>
+#include <linux/xarray.h>
 #include "drm/drm_exec.h"
 #include "drm/gpu_scheduler.h"
 #include "msm_drv.h"
+#include "msm_mmu.h"
 
 /* Make all GEM related WARN_ON()s ratelimited.. when things go wrong they
  * tend to go wrong 1000s of times in a short timespan.
@@ -45,8 +48,69 @@ struct msm_gem_address_space {
 
 	/** @va_size: the size of the address space (in bytes) */
 	uint64_t va_size;
+
+	/**
+	 * @binds: The VM_BIND mappings of the address space, sorted by
+	 * iova.  Protected by @bind_lock.
+	 */
+	struct rb_root binds;
+
+	/**
+	 * @bind_queue: The scheduler entity that VM_BIND jobs for this
+	 * address space are queued on, created by msm_gem_vm_bind_init().
+	 */
+	struct drm_sched_entity *bind_queue;
+
+	/**
+	 * @last_bind: The finished fence of the most recently queued VM_BIND
+	 * job.  Protected by @bind_queue_lock.
+	 */
+	struct dma_fence *last_bind;
+
+	/** @bind_queue_lock: Serializes queueing VM_BIND jobs */
+	struct mutex bind_queue_lock;
+
+	/**
+	 * @null_page: Backs MSM_VM_BIND_OP_MAP_NULL mappings.  Writes to
+	 * unbacked sparse ranges land here, so it is per address space to
+	 * avoid leaking data between processes.
+	 */
+	struct page *null_page;
+
+	/**
+	 * @implicit_binds: The subset of @binds that take part in implicit
+	 * sync, ie. the BOs a submit still has to lock.  Protected by
+	 * @bind_lock.
+	 */
+	struct list_head implicit_binds;
+
+	/** @nr_implicit_binds: The number of entries in @implicit_binds */
+	unsigned int nr_implicit_binds;
+
+	/**
+	 * @bind_lock: Serializes VM_BIND updates.  Taken by the bind job, so
+	 * nothing that allocates memory or takes the obj lock may be done
+	 * while holding it.
+	 */
+	struct mutex bind_lock;
+};
+
+/*
+ * A VM_BIND mapping, see msm_gem_vm_bind().  Either (part of) a BO, or for
+ * sparse resources a NULL mapping backed by msm_gem_address_space::null_page.
+ */
+struct msm_gem_vm_bind {
+	struct drm_mm_node vma;	/* the reserved range in msm_gem_address_space::mm */
+	struct rb_node rb;	/* node in msm_gem_address_space::binds */
+	struct drm_gem_object *obj;	/* NULL for a NULL mapping */
+	uint64_t obj_offset;
+	struct list_head node;	/* node in msm_gem_address_space::implicit_binds,
+				 * or the unmapping job's list */
+	uint32_t submit_flags;	/* MSM_SUBMIT_BO_x used for implicit sync */
 };
 
+extern const struct drm_sched_backend_ops msm_vm_bind_sched_ops;
+
 struct msm_gem_address_space *
 msm_gem_address_space_get(struct msm_gem_address_space *aspace);
 
@@ -57,6 +121,7 @@ msm_gem_address_space_create(struct msm_mmu *mmu, const char *name,
 		u64 va_start, u64 size);
 
 struct msm_fence_context;
+struct msm_gem_zpage;
 
 struct msm_gem_vma {
 	struct drm_mm_node node;
@@ -69,10 +134,14 @@ struct msm_gem_vma {
 struct msm_gem_vma *msm_gem_vma_new(struct msm_gem_address_space *aspace);
 int msm_gem_vma_init(struct msm_gem_vma *vma, int size,
 		u64 range_start, u64 range_end);
-void msm_gem_vma_purge(struct msm_gem_vma *vma);
+void msm_gem_vma_purge(struct msm_gem_vma *vma, struct msm_mmu_gather *gather);
 int msm_gem_vma_map(struct msm_gem_vma *vma, int prot, struct sg_table *sgt, int size);
 void msm_gem_vma_close(struct msm_gem_vma *vma);
 
+int msm_gem_vm_bind_init(struct msm_gem_address_space *aspace,
+		struct msm_gpu *gpu);
+void msm_gem_vm_bind_fini(struct msm_gem_address_space *aspace);
+
 struct msm_gem_object {
 	struct drm_gem_object base;
 
@@ -119,10 +188,40 @@ struct msm_gem_object {
 	 * Protected by LRU lock.
 	 */
 	int pin_count;
+
+	/**
+	 * lru_gen: The LRU generation when the object was last used
+	 *
+	 * The shrinker only compresses objects that have aged a few
+	 * generations.  Protected by LRU lock.
+	 */
+	unsigned lru_gen;
+
+	/**
+	 * zpages: Compressed contents, while the object is in the
+	 * compressed LRU
+	 *
+	 * Protected by obj lock.
+	 */
+	struct msm_gem_zpage *zpages;
+
+	/* Decompresses the object ahead of use, see msm_gem_prefetch() */
+	struct work_struct restore_work;
+
+	/* Node in priv->import_cache, protected by its lock */
+	struct list_head import_node;
+
+	/*
+	 * Hash of the contents last logged by the rd_relay capture, and
+	 * the capture generation they were logged in.  Protected by obj lock.
+	 */
+	u64 rd_hash;
+	u32 rd_gen;
 };
 #define to_msm_bo(x) container_of(x, struct msm_gem_object, base)
 
 uint64_t msm_gem_mmap_offset(struct drm_gem_object *obj);
+int msm_gem_prot(struct drm_gem_object *obj);
 int msm_gem_pin_vma_locked(struct drm_gem_object *obj, struct msm_gem_vma *vma);
 void msm_gem_unpin_locked(struct drm_gem_object *obj);
 void msm_gem_unpin_active(struct drm_gem_object *obj);
@@ -174,7 +273,7 @@ struct msm_gem_stats {
 	struct {
 		unsigned count;
 		size_t size;
-	} all, active, resident, purgeable, purged;
+	} all, active, resident, purgeable, purged, compressed;
 };
 
 void msm_gem_describe(struct drm_gem_object *obj, struct seq_file *m,
@@ -229,7 +328,8 @@ static inline bool is_unpurgeable(struct msm_gem_object *msm_obj)
 
 static inline bool is_purgeable(struct msm_gem_object *msm_obj)
 {
-	return (msm_obj->madv == MSM_MADV_DONTNEED) && msm_obj->sgt &&
+	return (msm_obj->madv == MSM_MADV_DONTNEED) &&
+			(msm_obj->sgt || msm_obj->zpages) &&
 			!is_unpurgeable(msm_obj);
 }
 
@@ -244,10 +344,74 @@ static inline bool is_unevictable(struct msm_gem_object *msm_obj)
 	return is_unpurgeable(msm_obj) || msm_obj->vaddr;
 }
 
-void msm_gem_purge(struct drm_gem_object *obj);
-void msm_gem_evict(struct drm_gem_object *obj);
+/*
+ * Batched teardown of GPU mappings, for the shrinker: the TLB invalidate
+ * for all of the unmaps is deferred to msm_gem_gather_flush(), which only
+ * then releases the iova ranges and backing pages that the GPU could still
+ * reach through stale TLB entries.
+ */
+struct msm_gem_gather {
+	struct msm_mmu_gather tlb;
+	struct list_head vmas;	/* closed vmas, with the iova still reserved */
+	struct folio **folios;	/* backing pages held until the flush */
+	unsigned nr_folios, max_folios;
+};
+
+int msm_gem_gather_init(struct msm_gem_gather *gather, unsigned max_folios);
+void msm_gem_gather_fini(struct msm_gem_gather *gather);
+void msm_gem_gather_flush(struct msm_gem_gather *gather);
+
+void msm_gem_purge(struct drm_gem_object *obj, struct msm_gem_gather *gather);
+void msm_gem_evict(struct drm_gem_object *obj, struct msm_gem_gather *gather);
+int msm_gem_compress(struct drm_gem_object *obj, struct msm_gem_gather *gather);
+
+#ifdef CONFIG_DRM_MSM_GEM_COMPRESS
+int msm_gem_zpool_init(struct drm_device *dev);
+void msm_gem_zpool_fini(struct drm_device *dev);
+int msm_gem_zpool_store(struct drm_gem_object *obj);
+int msm_gem_zpool_load(struct drm_gem_object *obj, struct page **pages);
+void msm_gem_zpool_free(struct drm_gem_object *obj);
+unsigned long msm_gem_zpool_size(struct drm_device *dev);
+void msm_gem_prefetch(struct drm_gem_object *obj);
+void msm_gem_prefetch_init(struct drm_gem_object *obj);
+#else
+static inline int msm_gem_zpool_init(struct drm_device *dev) { return 0; }
+static inline void msm_gem_zpool_fini(struct drm_device *dev) {}
+static inline int msm_gem_zpool_store(struct drm_gem_object *obj)
+{
+	return -ENODEV;
+}
+static inline int msm_gem_zpool_load(struct drm_gem_object *obj,
+		struct page **pages)
+{
+	return -ENODEV;
+}
+static inline void msm_gem_zpool_free(struct drm_gem_object *obj) {}
+static inline unsigned long msm_gem_zpool_size(struct drm_device *dev)
+{
+	return 0;
+}
+static inline void msm_gem_prefetch(struct drm_gem_object *obj) {}
+static inline void msm_gem_prefetch_init(struct drm_gem_object *obj) {}
+#endif
 void msm_gem_vunmap(struct drm_gem_object *obj);
 
+/*
+ * The stages of the submit ioctl, traced (msm_gpu_submit_stage) as each one
+ * completes.  The msm_gpu_submit trace marks the start of the first stage.
+ */
+enum msm_submit_stage {
+	MSM_SUBMIT_STAGE_QUEUE_LOCK,	/* waiting on the submitqueue lock */
+	MSM_SUBMIT_STAGE_DEPS,		/* in-fence and syncobj parsing */
+	MSM_SUBMIT_STAGE_LOOKUP,	/* BO table and cmd copy_from_user */
+	MSM_SUBMIT_STAGE_OBJ_LOCK,	/* ww locking the BOs */
+	MSM_SUBMIT_STAGE_FENCE_SYNC,	/* implicit sync dependencies */
+	MSM_SUBMIT_STAGE_PIN,		/* pinning pages and iovas */
+	MSM_SUBMIT_STAGE_RELOC,		/* cmd validation and relocs */
+	MSM_SUBMIT_STAGE_ARM,		/* arming the job and fences */
+	MSM_SUBMIT_STAGE_PUSH,		/* handing the job to the scheduler */
+};
+
 /* Created per submit-ioctl, to track bo's and cmdstream bufs, etc,
  * associated with the cmdstream submission for synchronization (and
  * make it easier to unwind when things go wrong, etc).
@@ -278,6 +442,8 @@ struct msm_gem_submit {
 	bool bos_pinned : 1;
 	bool fault_dumped:1;/* Limit devcoredump dumping to one per submit */
 	bool in_rb : 1;     /* "sudo" mode, copy cmds into RB */
+	bool vm_bind : 1;   /* no BO table, cmds are iovas in the VM_BIND VM */
+	bool skip : 1;      /* cancelled by recovery, only replay the fence */
 	struct msm_ringbuffer *ring;
 	unsigned int nr_cmds;
 	unsigned int nr_bos;
@@ -291,6 +457,10 @@ struct msm_gem_submit {
 		uint32_t nr_relocs;
 		struct drm_msm_gem_submit_reloc *relocs;
 	} *cmd;  /* array of size nr_cmds */
+	/* perfcntrs sampled around the cmds, see msm_perfcntr.c: */
+	struct msm_perfcntr *perfcntrs;
+	unsigned int nr_perfcntrs;
+	uint64_t perfcntr_iova;
 	struct {
 		uint32_t flags;
 		union {
@@ -320,6 +490,28 @@ static inline void msm_gem_submit_put(struct msm_gem_submit *submit)
 
 void msm_submit_retire(struct msm_gem_submit *submit);
 
+struct dma_fence_chain;
+struct drm_syncobj;
+
+struct msm_submit_post_dep {
+	struct drm_syncobj *syncobj;
+	uint64_t point;
+	struct dma_fence_chain *chain;
+};
+
+struct drm_syncobj **msm_parse_deps(struct drm_sched_job *job,
+		struct drm_file *file, uint64_t in_syncobjs_addr,
+		uint32_t nr_in_syncobjs, size_t syncobj_stride);
+void msm_reset_syncobjs(struct drm_syncobj **syncobjs, uint32_t nr_syncobjs);
+void msm_free_syncobjs(struct drm_syncobj **syncobjs, uint32_t nr_syncobjs);
+struct msm_submit_post_dep *msm_parse_post_deps(struct drm_device *dev,
+		struct drm_file *file, uint64_t syncobjs_addr,
+		uint32_t nr_syncobjs, size_t syncobj_stride);
+void msm_process_post_deps(struct msm_submit_post_dep *post_deps,
+		uint32_t count, struct dma_fence *fence);
+void msm_free_post_deps(struct msm_submit_post_dep *post_deps,
+		uint32_t nr_syncobjs);
+
 /* helper to determine of a buffer in submit should be dumped, used for both
  * devcoredump and debugfs cmdstream dumping:
  */
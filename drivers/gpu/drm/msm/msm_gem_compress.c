@@ -0,0 +1,347 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Compressed eviction tier for GEM objects.
+ *
+ * Rather than evicting cold, idle buffers to swap, the shrinker can
+ * compress their contents into a zsmalloc pool private to the GPU, and
+ * release the backing pages.  The contents are restored when the pages
+ * are next needed, or ahead of that by msm_gem_prefetch() when the object
+ * is referenced by a submit, so that the decompression overlaps the rest
+ * of the submit path and multiple buffers are restored in parallel.
+ */
+
+#include <linux/highmem.h>
+#include <linux/lz4.h>
+#include <linux/zsmalloc.h>
+
+#include "msm_drv.h"
+#include "msm_gem.h"
+
+/*
+ * Compressed contents of a single page.  A zero length marks a page that
+ * was all zeros, which doesn't need any storage in the pool, and a length
+ * of PAGE_SIZE marks a page that is stored uncompressed.
+ */
+struct msm_gem_zpage {
+	unsigned long handle;
+	unsigned int len;
+};
+
+struct msm_gem_zpool {
+	struct zs_pool *pool;
+
+	/* Protects the compression scratch buffers: */
+	struct mutex lock;
+	void *wrkmem;
+	void *buf;
+
+	/* Compressed size of all stored objects, in bytes: */
+	atomic_long_t stored;
+};
+
+/* Only keep the compressed copy if it is at most 3/4 of the original: */
+static bool worth_it(size_t zsize, size_t size)
+{
+	return zsize <= size - (size / 4);
+}
+
+static void free_zpages(struct msm_gem_zpool *zpool,
+		struct msm_gem_zpage *zpages, unsigned npages)
+{
+	unsigned i;
+
+	for (i = 0; i < npages; i++) {
+		if (zpages[i].len) {
+			zs_free(zpool->pool, zpages[i].handle);
+			atomic_long_sub(zpages[i].len, &zpool->stored);
+		}
+	}
+
+	kvfree(zpages);
+}
+
+static int store_page(struct msm_gem_zpool *zpool, struct page *page,
+		struct msm_gem_zpage *zpage)
+{
+	const gfp_t gfp = __GFP_KSWAPD_RECLAIM | __GFP_NOWARN |
+			  __GFP_HIGHMEM | __GFP_MOVABLE;
+	unsigned long handle;
+	void *src, *dst;
+	int len;
+
+	src = kmap_local_page(page);
+
+	if (!memchr_inv(src, 0, PAGE_SIZE)) {
+		kunmap_local(src);
+		zpage->handle = 0;
+		zpage->len = 0;
+		return 0;
+	}
+
+	len = LZ4_compress_default(src, zpool->buf, PAGE_SIZE,
+				   LZ4_COMPRESSBOUND(PAGE_SIZE), zpool->wrkmem);
+	if (len <= 0 || len >= zs_huge_class_size(zpool->pool))
+		len = PAGE_SIZE;
+
+	handle = zs_malloc(zpool->pool, len, gfp);
+	if (IS_ERR_VALUE(handle)) {
+		kunmap_local(src);
+		return PTR_ERR((void *)handle);
+	}
+
+	dst = zs_map_object(zpool->pool, handle, ZS_MM_WO);
+	memcpy(dst, (len == PAGE_SIZE) ? src : zpool->buf, len);
+	zs_unmap_object(zpool->pool, handle);
+
+	kunmap_local(src);
+
+	zpage->handle = handle;
+	zpage->len = len;
+	atomic_long_add(len, &zpool->stored);
+
+	return 0;
+}
+
+static int load_page(struct msm_gem_zpool *zpool, struct page *page,
+		const struct msm_gem_zpage *zpage)
+{
+	void *src, *dst;
+	int ret = 0;
+
+	dst = kmap_local_page(page);
+
+	if (!zpage->len) {
+		memset(dst, 0, PAGE_SIZE);
+		kunmap_local(dst);
+		return 0;
+	}
+
+	src = zs_map_object(zpool->pool, zpage->handle, ZS_MM_RO);
+	if (zpage->len == PAGE_SIZE) {
+		memcpy(dst, src, PAGE_SIZE);
+	} else if (LZ4_decompress_safe(src, dst, zpage->len, PAGE_SIZE) != PAGE_SIZE) {
+		ret = -EIO;
+	}
+	zs_unmap_object(zpool->pool, zpage->handle);
+
+	kunmap_local(dst);
+
+	return ret;
+}
+
+/**
+ * msm_gem_zpool_store - Compress the contents of an object into the pool
+ * @obj: the object, locked and idle, with backing pages
+ *
+ * On success the compressed copy is attached to the object, and the caller
+ * is expected to release the backing pages.  Returns -E2BIG if the object
+ * doesn't compress well enough to be worth it.
+ */
+int msm_gem_zpool_store(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	struct msm_gem_zpool *zpool = priv->zpool;
+	unsigned i, npages = obj->size >> PAGE_SHIFT;
+	struct msm_gem_zpage *zpages;
+	size_t zsize = 0;
+	int ret = 0;
+
+	msm_gem_assert_locked(obj);
+
+	if (GEM_WARN_ON(!msm_obj->pages || msm_obj->zpages))
+		return -EINVAL;
+
+	/* We are called from reclaim, so don't recurse into it: */
+	zpages = kvcalloc(npages, sizeof(*zpages), GFP_NOWAIT | __GFP_NOWARN);
+	if (!zpages)
+		return -ENOMEM;
+
+	mutex_lock(&zpool->lock);
+
+	for (i = 0; i < npages; i++) {
+		ret = store_page(zpool, msm_obj->pages[i], &zpages[i]);
+		if (ret)
+			break;
+
+		zsize += zpages[i].len;
+
+		/* Bail early on incompressible content: */
+		if (!worth_it(zsize, obj->size)) {
+			ret = -E2BIG;
+			break;
+		}
+	}
+
+	mutex_unlock(&zpool->lock);
+
+	if (ret) {
+		free_zpages(zpool, zpages, npages);
+		return ret;
+	}
+
+	msm_obj->zpages = zpages;
+
+	return 0;
+}
+
+/**
+ * msm_gem_zpool_load - Restore the contents of a compressed object
+ * @obj: the object, locked
+ * @pages: the newly allocated backing pages to decompress into
+ *
+ * On success the compressed copy is released.
+ */
+int msm_gem_zpool_load(struct drm_gem_object *obj, struct page **pages)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	struct msm_gem_zpool *zpool = priv->zpool;
+	unsigned i, npages = obj->size >> PAGE_SHIFT;
+	int ret;
+
+	msm_gem_assert_locked(obj);
+
+	for (i = 0; i < npages; i++) {
+		ret = load_page(zpool, pages[i], &msm_obj->zpages[i]);
+		if (ret) {
+			DRM_DEV_ERROR(obj->dev->dev,
+				      "failed to decompress page %u: %d\n",
+				      i, ret);
+			return ret;
+		}
+	}
+
+	msm_gem_zpool_free(obj);
+
+	return 0;
+}
+
+/**
+ * msm_gem_zpool_free - Drop the compressed copy of an object
+ * @obj: the object, locked
+ */
+void msm_gem_zpool_free(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+
+	if (!msm_obj->zpages)
+		return;
+
+	free_zpages(priv->zpool, msm_obj->zpages, obj->size >> PAGE_SHIFT);
+	msm_obj->zpages = NULL;
+}
+
+/**
+ * msm_gem_zpool_size - Memory used by the pool
+ * @dev: drm device
+ *
+ * Returns the number of pages backing the pool.
+ */
+unsigned long msm_gem_zpool_size(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	if (!priv->zpool)
+		return 0;
+
+	return zs_get_total_pages(priv->zpool->pool);
+}
+
+static void restore_worker(struct work_struct *work)
+{
+	struct msm_gem_object *msm_obj =
+		container_of(work, struct msm_gem_object, restore_work);
+	struct drm_gem_object *obj = &msm_obj->base;
+	struct page **pages;
+
+	msm_gem_lock(obj);
+
+	/* The submit may have beaten us to it: */
+	if (msm_obj->zpages) {
+		pages = msm_gem_pin_pages_locked(obj);
+		if (!IS_ERR(pages))
+			msm_gem_unpin_locked(obj);
+	}
+
+	msm_gem_unlock(obj);
+
+	drm_gem_object_put(obj);
+}
+
+/**
+ * msm_gem_prefetch - Start restoring a compressed object ahead of use
+ * @obj: the object, not locked
+ *
+ * Called when a submit references the object, so by the time the submit
+ * pins its buffers the contents are (hopefully) already decompressed.
+ */
+void msm_gem_prefetch(struct drm_gem_object *obj)
+{
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+
+	/* Racy, but the worker re-checks under the obj lock: */
+	if (!READ_ONCE(msm_obj->zpages))
+		return;
+
+	drm_gem_object_get(obj);
+	if (!queue_work(system_unbound_wq, &msm_obj->restore_work))
+		drm_gem_object_put(obj);
+}
+
+void msm_gem_prefetch_init(struct drm_gem_object *obj)
+{
+	INIT_WORK(&to_msm_bo(obj)->restore_work, restore_worker);
+}
+
+int msm_gem_zpool_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_zpool *zpool;
+
+	zpool = kzalloc(sizeof(*zpool), GFP_KERNEL);
+	if (!zpool)
+		return -ENOMEM;
+
+	zpool->pool = zs_create_pool("msm_gem");
+	if (!zpool->pool)
+		goto fail;
+
+	zpool->wrkmem = kvmalloc(LZ4_MEM_COMPRESS, GFP_KERNEL);
+	zpool->buf = kvmalloc(LZ4_COMPRESSBOUND(PAGE_SIZE), GFP_KERNEL);
+	if (!zpool->wrkmem || !zpool->buf)
+		goto fail;
+
+	mutex_init(&zpool->lock);
+	atomic_long_set(&zpool->stored, 0);
+
+	priv->zpool = zpool;
+
+	return 0;
+
+fail:
+	kvfree(zpool->buf);
+	kvfree(zpool->wrkmem);
+	if (zpool->pool)
+		zs_destroy_pool(zpool->pool);
+	kfree(zpool);
+
+	return -ENOMEM;
+}
+
+void msm_gem_zpool_fini(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_gem_zpool *zpool = priv->zpool;
+
+	if (!zpool)
+		return;
+
+	kvfree(zpool->buf);
+	kvfree(zpool->wrkmem);
+	zs_destroy_pool(zpool->pool);
+	kfree(zpool);
+
+	priv->zpool = NULL;
+}
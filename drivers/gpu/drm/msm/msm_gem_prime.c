@@ -11,6 +11,10 @@
 #include "msm_drv.h"
 #include "msm_gem.h"
 
+static uint import_cache_size = 16;
+MODULE_PARM_DESC(import_cache_size, "Number of imported dma-bufs kept mapped after their last handle is closed (default 16, 0 to disable)");
+module_param(import_cache_size, uint, 0600);
+
 struct sg_table *msm_gem_prime_get_sg_table(struct drm_gem_object *obj)
 {
 	struct msm_gem_object *msm_obj = to_msm_bo(obj);
@@ -45,6 +49,218 @@ struct drm_gem_object *msm_gem_prime_import_sg_table(struct drm_device *dev,
 	return msm_gem_import(dev, attach->dmabuf, sg);
 }
 
+static struct drm_gem_object *
+import_cache_lookup(struct msm_drm_private *priv, struct dma_buf *dma_buf)
+{
+	struct msm_gem_object *msm_obj;
+
+	list_for_each_entry(msm_obj, &priv->import_cache.list, import_node) {
+		struct drm_gem_object *obj = &msm_obj->base;
+
+		if (obj->import_attach->dmabuf == dma_buf) {
+			list_move_tail(&msm_obj->import_node,
+				       &priv->import_cache.list);
+			drm_gem_object_get(obj);
+			return obj;
+		}
+	}
+
+	return NULL;
+}
+
+/* Trim the cache to @size entries, returning the evicted objects on @list: */
+static void import_cache_trim(struct msm_drm_private *priv, unsigned size,
+		struct list_head *list)
+{
+	struct msm_gem_object *msm_obj, *tmp;
+
+	list_for_each_entry_safe(msm_obj, tmp, &priv->import_cache.list,
+				 import_node) {
+		if (priv->import_cache.count <= size)
+			break;
+
+		list_move_tail(&msm_obj->import_node, list);
+		priv->import_cache.count--;
+	}
+}
+
+static void import_cache_put(struct list_head *list)
+{
+	struct msm_gem_object *msm_obj, *tmp;
+
+	list_for_each_entry_safe(msm_obj, tmp, list, import_node) {
+		list_del(&msm_obj->import_node);
+		drm_gem_object_put(&msm_obj->base);
+	}
+}
+
+/*
+ * Our camera -> GPU -> encoder style pipelines recycle the same handful of
+ * buffers every frame, and userspace tends to close the handle of an
+ * imported buffer once it is done with it for the frame.  Rather than
+ * attaching, mapping, and setting up new iovas each time the buffer is
+ * imported again, the cache holds a reference to the most recently
+ * imported objects (and through them, to their dma-bufs) so that the
+ * same object is handed out again.  Entries that only the cache still
+ * references are given back to the shrinker under memory pressure.
+ */
+struct drm_gem_object *msm_gem_prime_import(struct drm_device *dev,
+		struct dma_buf *dma_buf)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct drm_gem_object *obj, *cached;
+	struct msm_gem_object *msm_obj;
+	LIST_HEAD(evicted);
+
+	mutex_lock(&priv->import_cache.lock);
+	obj = import_cache_lookup(priv, dma_buf);
+	mutex_unlock(&priv->import_cache.lock);
+
+	if (obj)
+		return obj;
+
+	obj = drm_gem_prime_import(dev, dma_buf);
+	if (IS_ERR(obj) || !obj->import_attach || !import_cache_size)
+		return obj;
+
+	msm_obj = to_msm_bo(obj);
+
+	mutex_lock(&priv->import_cache.lock);
+
+	/* Lost a race with a concurrent import of the same dma-buf: */
+	cached = import_cache_lookup(priv, dma_buf);
+	if (cached) {
+		mutex_unlock(&priv->import_cache.lock);
+		drm_gem_object_put(obj);
+		return cached;
+	}
+
+	drm_gem_object_get(obj);
+	list_add_tail(&msm_obj->import_node, &priv->import_cache.list);
+	priv->import_cache.count++;
+	import_cache_trim(priv, READ_ONCE(import_cache_size), &evicted);
+	mutex_unlock(&priv->import_cache.lock);
+
+	/* Dropping the last reference frees the object, so not under the lock: */
+	import_cache_put(&evicted);
+
+	return obj;
+}
+
+/* Drop the entries the shrinker evicted, outside of reclaim: */
+static void import_cache_put_work(struct work_struct *work)
+{
+	struct msm_drm_private *priv =
+		container_of(work, struct msm_drm_private, import_cache.put_work);
+	LIST_HEAD(evicted);
+
+	mutex_lock(&priv->import_cache.lock);
+	list_splice_init(&priv->import_cache.evicted, &evicted);
+	mutex_unlock(&priv->import_cache.lock);
+
+	import_cache_put(&evicted);
+}
+
+void msm_gem_prime_import_cache_init(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+
+	mutex_init(&priv->import_cache.lock);
+	INIT_LIST_HEAD(&priv->import_cache.list);
+	INIT_LIST_HEAD(&priv->import_cache.evicted);
+	INIT_WORK(&priv->import_cache.put_work, import_cache_put_work);
+}
+
+void msm_gem_prime_import_cache_fini(struct drm_device *dev)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	LIST_HEAD(evicted);
+
+	mutex_lock(&priv->import_cache.lock);
+	import_cache_trim(priv, 0, &evicted);
+	list_splice_init(&priv->import_cache.evicted, &evicted);
+	mutex_unlock(&priv->import_cache.lock);
+
+	/* With the cache empty, the shrinker won't queue the work again: */
+	cancel_work_sync(&priv->import_cache.put_work);
+
+	import_cache_put(&evicted);
+}
+
+/* Only the cache holds a reference, so dropping it frees the object: */
+static bool import_cache_idle(struct msm_gem_object *msm_obj)
+{
+	return kref_read(&msm_obj->base.refcount) == 1;
+}
+
+/**
+ * msm_gem_prime_import_cache_count - pages the shrinker could reclaim
+ * @priv: the device
+ *
+ * Return: the size in pages of the cached objects that nothing but the
+ * cache references.
+ */
+unsigned long msm_gem_prime_import_cache_count(struct msm_drm_private *priv)
+{
+	struct msm_gem_object *msm_obj;
+	unsigned long count = 0;
+
+	if (!mutex_trylock(&priv->import_cache.lock))
+		return 0;
+
+	list_for_each_entry(msm_obj, &priv->import_cache.list, import_node) {
+		if (import_cache_idle(msm_obj))
+			count += msm_obj->base.size >> PAGE_SHIFT;
+	}
+
+	mutex_unlock(&priv->import_cache.lock);
+
+	return count;
+}
+
+/**
+ * msm_gem_prime_import_cache_scan - evict idle entries under memory pressure
+ * @priv: the device
+ * @nr_to_scan: number of pages to reclaim
+ *
+ * Evicts the least recently used entries that nothing but the cache
+ * references, until @nr_to_scan pages are evicted.  The references are
+ * dropped from a worker rather than from reclaim, as freeing an imported
+ * object detaches it from its exporter.
+ *
+ * Return: the number of pages evicted.
+ */
+unsigned long msm_gem_prime_import_cache_scan(struct msm_drm_private *priv,
+		unsigned long nr_to_scan)
+{
+	struct msm_gem_object *msm_obj, *tmp;
+	unsigned long freed = 0;
+
+	if (!mutex_trylock(&priv->import_cache.lock))
+		return 0;
+
+	list_for_each_entry_safe(msm_obj, tmp, &priv->import_cache.list,
+				 import_node) {
+		if (freed >= nr_to_scan)
+			break;
+
+		if (!import_cache_idle(msm_obj))
+			continue;
+
+		list_move_tail(&msm_obj->import_node,
+			       &priv->import_cache.evicted);
+		priv->import_cache.count--;
+		freed += msm_obj->base.size >> PAGE_SHIFT;
+	}
+
+	mutex_unlock(&priv->import_cache.lock);
+
+	if (freed)
+		queue_work(system_wq, &priv->import_cache.put_work);
+
+	return freed;
+}
+
 int msm_gem_prime_pin(struct drm_gem_object *obj)
 {
 	struct page **pages;
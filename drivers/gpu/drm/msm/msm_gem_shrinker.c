@@ -19,11 +19,25 @@ static bool enable_eviction = true;
 MODULE_PARM_DESC(enable_eviction, "Enable swappable GEM buffers");
 module_param(enable_eviction, bool, 0600);
 
+static bool enable_compression = true;
+MODULE_PARM_DESC(enable_compression, "Compress idle GEM buffers before evicting them");
+module_param(enable_compression, bool, 0600);
+
+/* # of shrinker scans an object must sit idle for before compressing it: */
+static uint compress_min_age = 2;
+MODULE_PARM_DESC(compress_min_age, "Minimum LRU generations before compressing a buffer");
+module_param(compress_min_age, uint, 0600);
+
 static bool can_swap(void)
 {
 	return enable_eviction && get_nr_swap_pages() > 0;
 }
 
+static bool can_compress(struct msm_drm_private *priv)
+{
+	return enable_compression && priv->zpool;
+}
+
 static bool can_block(struct shrink_control *sc)
 {
 	if (!(sc->gfp_mask & __GFP_DIRECT_RECLAIM))
@@ -35,14 +49,34 @@ static unsigned long
 msm_gem_shrinker_count(struct shrinker *shrinker, struct shrink_control *sc)
 {
 	struct msm_drm_private *priv = shrinker->private_data;
-	unsigned count = priv->lru.dontneed.count;
+	unsigned long count = priv->lru.dontneed.count;
 
-	if (can_swap())
+	if (can_swap() || can_compress(priv))
 		count += priv->lru.willneed.count;
 
+	count += msm_gem_prime_import_cache_count(priv);
+
 	return count;
 }
 
+/* Max # of folios held back by a scan until its TLB invalidate: */
+static const unsigned shrink_gather_folios = SZ_4K;
+
+/*
+ * The lru scan callbacks run in the context of the scanning task, so only
+ * the scan that owns the gather batches its invalidates:
+ */
+static struct msm_gem_gather *
+shrink_gather(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+
+	if (priv->shrink_owner != current)
+		return NULL;
+
+	return priv->shrink_gather;
+}
+
 static bool
 purge(struct drm_gem_object *obj)
 {
@@ -52,7 +86,7 @@ purge(struct drm_gem_object *obj)
 	if (msm_gem_active(obj))
 		return false;
 
-	msm_gem_purge(obj);
+	msm_gem_purge(obj, shrink_gather(obj));
 
 	return true;
 }
@@ -66,11 +100,31 @@ evict(struct drm_gem_object *obj)
 	if (msm_gem_active(obj))
 		return false;
 
-	msm_gem_evict(obj);
+	msm_gem_evict(obj, shrink_gather(obj));
 
 	return true;
 }
 
+static bool
+compress(struct drm_gem_object *obj)
+{
+	struct msm_drm_private *priv = obj->dev->dev_private;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	unsigned gen = atomic_read(&priv->lru.gen);
+
+	/* Leave recently used objects for the later stages: */
+	if ((gen - msm_obj->lru_gen) < compress_min_age)
+		return false;
+
+	if (is_unevictable(msm_obj))
+		return false;
+
+	if (msm_gem_active(obj))
+		return false;
+
+	return !msm_gem_compress(obj, shrink_gather(obj));
+}
+
 static bool
 wait_for_idle(struct drm_gem_object *obj)
 {
@@ -108,14 +162,32 @@ msm_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 		unsigned long remaining;
 	} stages[] = {
 		/* Stages of progressively more aggressive/expensive reclaim: */
-		{ &priv->lru.dontneed, purge,        true },
-		{ &priv->lru.willneed, evict,        can_swap() },
-		{ &priv->lru.dontneed, active_purge, can_block(sc) },
-		{ &priv->lru.willneed, active_evict, can_swap() && can_block(sc) },
+		{ &priv->lru.dontneed,   purge,        true },
+		{ &priv->lru.compressed, purge,        true },
+		{ &priv->lru.willneed,   compress,     can_compress(priv) },
+		{ &priv->lru.willneed,   evict,        can_swap() },
+		{ &priv->lru.dontneed,   active_purge, can_block(sc) },
+		{ &priv->lru.willneed,   active_evict, can_swap() && can_block(sc) },
 	};
 	long nr = sc->nr_to_scan;
 	unsigned long freed = 0;
 	unsigned long remaining = 0;
+	bool batched;
+
+	/*
+	 * Defer the TLB invalidates of the whole scan to a single one at the
+	 * end, rather than one per purged/evicted object:
+	 */
+	batched = mutex_trylock(&priv->shrink_lock);
+	if (batched)
+		priv->shrink_owner = current;
+
+	/* Age the objects that weren't used since the last scan: */
+	atomic_inc(&priv->lru.gen);
+
+	/* Imports that only the cache still holds go first: */
+	freed = msm_gem_prime_import_cache_scan(priv, nr);
+	nr -= freed;
 
 	for (unsigned i = 0; (nr > 0) && (i < ARRAY_SIZE(stages)); i++) {
 		if (!stages[i].cond)
@@ -129,10 +201,17 @@ msm_gem_shrinker_scan(struct shrinker *shrinker, struct shrink_control *sc)
 		remaining += stages[i].remaining;
 	}
 
+	if (batched) {
+		msm_gem_gather_flush(priv->shrink_gather);
+		priv->shrink_owner = NULL;
+		mutex_unlock(&priv->shrink_lock);
+	}
+
 	if (freed) {
-		trace_msm_gem_shrink(sc->nr_to_scan, stages[0].freed,
-				     stages[1].freed, stages[2].freed,
-				     stages[3].freed);
+		trace_msm_gem_shrink(sc->nr_to_scan,
+				     stages[0].freed + stages[1].freed,
+				     stages[2].freed, stages[3].freed,
+				     stages[4].freed, stages[5].freed);
 	}
 
 	return (freed > 0 && remaining > 0) ? freed : SHRINK_STOP;
@@ -212,10 +291,33 @@ msm_gem_shrinker_vmap(struct notifier_block *nb, unsigned long event, void *ptr)
 int msm_gem_shrinker_init(struct drm_device *dev)
 {
 	struct msm_drm_private *priv = dev->dev_private;
+	int ret;
+
+	mutex_init(&priv->shrink_lock);
+
+	priv->shrink_gather = kzalloc(sizeof(*priv->shrink_gather), GFP_KERNEL);
+	if (!priv->shrink_gather)
+		return -ENOMEM;
+
+	ret = msm_gem_gather_init(priv->shrink_gather, shrink_gather_folios);
+	if (ret) {
+		kfree(priv->shrink_gather);
+		priv->shrink_gather = NULL;
+		return ret;
+	}
+
+	/* The compressed tier is optional, carry on without it: */
+	if (msm_gem_zpool_init(dev))
+		DRM_DEV_INFO(dev->dev, "could not create zpool\n");
 
 	priv->shrinker = shrinker_alloc(0, "drm-msm_gem");
-	if (!priv->shrinker)
+	if (!priv->shrinker) {
+		msm_gem_zpool_fini(dev);
+		msm_gem_gather_fini(priv->shrink_gather);
+		kfree(priv->shrink_gather);
+		priv->shrink_gather = NULL;
 		return -ENOMEM;
+	}
 
 	priv->shrinker->count_objects = msm_gem_shrinker_count;
 	priv->shrinker->scan_objects = msm_gem_shrinker_scan;
@@ -243,4 +345,11 @@ void msm_gem_shrinker_cleanup(struct drm_device *dev)
 		WARN_ON(unregister_vmap_purge_notifier(&priv->vmap_notifier));
 		shrinker_free(priv->shrinker);
 	}
+
+	if (priv->shrink_gather) {
+		msm_gem_gather_fini(priv->shrink_gather);
+		kfree(priv->shrink_gather);
+	}
+
+	msm_gem_zpool_fini(dev);
 }
@@ -112,6 +112,7 @@ void __msm_gem_submit_destroy(struct kref *kref)
 	for (i = 0; i < submit->nr_cmds; i++)
 		kfree(submit->cmd[i].relocs);
 
+	kfree(submit->perfcntrs);
 	kfree(submit);
 }
 
@@ -175,12 +176,54 @@ static int submit_lookup_objects(struct msm_gem_submit *submit,
 out_unlock:
 	spin_unlock(&file->table_lock);
 
+	/* Start restoring compressed bos while we set up the rest: */
+	if (!ret) {
+		for (i = 0; i < args->nr_bos; i++)
+			msm_gem_prefetch(submit->bos[i].obj);
+	}
+
 out:
 	submit->nr_bos = i;
 
 	return ret;
 }
 
+/*
+ * With VM_BIND there is no BO table, the BOs are already mapped and pinned
+ * in the VM.  Only the ones that userspace asked to take part in implicit
+ * sync need to be tracked by the submit.
+ */
+static void submit_lookup_binds(struct msm_gem_submit *submit, unsigned nr_binds)
+{
+	struct msm_gem_address_space *aspace = submit->aspace;
+	struct msm_gem_vm_bind *bind;
+	unsigned i = 0;
+
+	mutex_lock(&aspace->bind_lock);
+
+	list_for_each_entry(bind, &aspace->implicit_binds, node) {
+		/*
+		 * The submit was sized before taking the lock, as the bind
+		 * job takes it too.  Binds that raced in after that are not
+		 * ordered against this submit anyway:
+		 */
+		if (i == nr_binds)
+			break;
+
+		drm_gem_object_get(bind->obj);
+
+		submit->bos[i].obj = bind->obj;
+		submit->bos[i].flags = bind->submit_flags;
+		submit->bos[i].iova = bind->vma.start;
+		i++;
+	}
+
+	mutex_unlock(&aspace->bind_lock);
+
+	submit->nr_bos = i;
+	submit->vm_bind = true;
+}
+
 static int submit_lookup_cmds(struct msm_gem_submit *submit,
 		struct drm_msm_gem_submit *args, struct drm_file *file)
 {
@@ -205,6 +248,10 @@ static int submit_lookup_cmds(struct msm_gem_submit *submit,
 		case MSM_SUBMIT_CMD_IB_TARGET_BUF:
 		case MSM_SUBMIT_CMD_CTX_RESTORE_BUF:
 			break;
+		case MSM_SUBMIT_CMD_PERFCNTR_BUF:
+			if (submit->gpu->nr_perfcntr_groups)
+				break;
+			fallthrough;
 		default:
 			SUBMIT_ERROR(submit, "invalid type: %08x\n", submit_cmd.type);
 			return -EINVAL;
@@ -219,6 +266,20 @@ static int submit_lookup_cmds(struct msm_gem_submit *submit,
 
 		submit->cmd[i].type = submit_cmd.type;
 		submit->cmd[i].size = submit_cmd.size / 4;
+
+		/* with VM_BIND, cmds are given directly as iovas: */
+		if (submit->vm_bind) {
+			if (!submit_cmd.size || submit_cmd.nr_relocs) {
+				SUBMIT_ERROR(submit, "invalid cmd: size %u, nr_relocs %u\n",
+					     submit_cmd.size, submit_cmd.nr_relocs);
+				ret = -EINVAL;
+				goto out;
+			}
+
+			submit->cmd[i].iova = submit_cmd.iova;
+			continue;
+		}
+
 		submit->cmd[i].offset = submit_cmd.submit_offset / 4;
 		submit->cmd[i].idx  = submit_cmd.submit_idx;
 		submit->cmd[i].nr_relocs = submit_cmd.nr_relocs;
@@ -251,9 +312,14 @@ static int submit_lookup_cmds(struct msm_gem_submit *submit,
 /* This is where we make sure all the bo's are reserved and pin'd: */
 static int submit_lock_objects(struct msm_gem_submit *submit)
 {
+	uint32_t flags = DRM_EXEC_INTERRUPTIBLE_WAIT;
 	int ret;
 
-	drm_exec_init(&submit->exec, DRM_EXEC_INTERRUPTIBLE_WAIT, submit->nr_bos);
+	/* A BO can be bound at several places in a VM_BIND VM: */
+	if (submit->vm_bind)
+		flags |= DRM_EXEC_IGNORE_DUPLICATES;
+
+	drm_exec_init(&submit->exec, flags, submit->nr_bos);
 
 	drm_exec_until_all_locked (&submit->exec) {
 		for (unsigned i = 0; i < submit->nr_bos; i++) {
@@ -479,14 +545,12 @@ void msm_submit_retire(struct msm_gem_submit *submit)
 	}
 }
 
-struct msm_submit_post_dep {
-	struct drm_syncobj *syncobj;
-	uint64_t point;
-	struct dma_fence_chain *chain;
-};
+/*
+ * Syncobj helpers, shared by the GEM_SUBMIT and VM_BIND ioctls:
+ */
 
-static struct drm_syncobj **msm_parse_deps(struct msm_gem_submit *submit,
-                                           struct drm_file *file,
+struct drm_syncobj **msm_parse_deps(struct drm_sched_job *job,
+                                    struct drm_file *file,
                                            uint64_t in_syncobjs_addr,
                                            uint32_t nr_in_syncobjs,
                                            size_t syncobj_stride)
@@ -512,7 +576,7 @@ static struct drm_syncobj **msm_parse_deps(struct msm_gem_submit *submit,
 		}
 
 		if (syncobj_desc.point &&
-		    !drm_core_check_feature(submit->dev, DRIVER_SYNCOBJ_TIMELINE)) {
+		    !drm_core_check_feature(file->minor->dev, DRIVER_SYNCOBJ_TIMELINE)) {
 			ret = -EOPNOTSUPP;
 			break;
 		}
@@ -522,7 +586,7 @@ static struct drm_syncobj **msm_parse_deps(struct msm_gem_submit *submit,
 			break;
 		}
 
-		ret = drm_sched_job_add_syncobj_dependency(&submit->base, file,
+		ret = drm_sched_job_add_syncobj_dependency(job, file,
 							   syncobj_desc.handle, syncobj_desc.point);
 		if (ret)
 			break;
@@ -548,8 +612,8 @@ static struct drm_syncobj **msm_parse_deps(struct msm_gem_submit *submit,
 	return syncobjs;
 }
 
-static void msm_reset_syncobjs(struct drm_syncobj **syncobjs,
-                               uint32_t nr_syncobjs)
+void msm_reset_syncobjs(struct drm_syncobj **syncobjs,
+                        uint32_t nr_syncobjs)
 {
 	uint32_t i;
 
@@ -559,11 +623,11 @@ static void msm_reset_syncobjs(struct drm_syncobj **syncobjs,
 	}
 }
 
-static struct msm_submit_post_dep *msm_parse_post_deps(struct drm_device *dev,
-                                                       struct drm_file *file,
-                                                       uint64_t syncobjs_addr,
-                                                       uint32_t nr_syncobjs,
-                                                       size_t syncobj_stride)
+struct msm_submit_post_dep *msm_parse_post_deps(struct drm_device *dev,
+                                                struct drm_file *file,
+                                                uint64_t syncobjs_addr,
+                                                uint32_t nr_syncobjs,
+                                                size_t syncobj_stride)
 {
 	struct msm_submit_post_dep *post_deps;
 	struct drm_msm_gem_submit_syncobj syncobj_desc = {0};
@@ -628,8 +692,8 @@ static struct msm_submit_post_dep *msm_parse_post_deps(struct drm_device *dev,
 	return post_deps;
 }
 
-static void msm_process_post_deps(struct msm_submit_post_dep *post_deps,
-                                  uint32_t count, struct dma_fence *fence)
+void msm_process_post_deps(struct msm_submit_post_dep *post_deps,
+                           uint32_t count, struct dma_fence *fence)
 {
 	uint32_t i;
 
@@ -646,6 +710,35 @@ static void msm_process_post_deps(struct msm_submit_post_dep *post_deps,
 	}
 }
 
+void msm_free_syncobjs(struct drm_syncobj **syncobjs, uint32_t nr_syncobjs)
+{
+	uint32_t i;
+
+	if (IS_ERR_OR_NULL(syncobjs))
+		return;
+
+	for (i = 0; i < nr_syncobjs; ++i) {
+		if (syncobjs[i])
+			drm_syncobj_put(syncobjs[i]);
+	}
+	kfree(syncobjs);
+}
+
+void msm_free_post_deps(struct msm_submit_post_dep *post_deps,
+                        uint32_t nr_syncobjs)
+{
+	uint32_t i;
+
+	if (IS_ERR_OR_NULL(post_deps))
+		return;
+
+	for (i = 0; i < nr_syncobjs; ++i) {
+		kfree(post_deps[i].chain);
+		drm_syncobj_put(post_deps[i].syncobj);
+	}
+	kfree(post_deps);
+}
+
 int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		struct drm_file *file)
 {
@@ -658,6 +751,7 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	struct msm_ringbuffer *ring;
 	struct msm_submit_post_dep *post_deps = NULL;
 	struct drm_syncobj **syncobjs_to_reset = NULL;
+	bool vm_bind = READ_ONCE(ctx->vm_bind);
 	int out_fence_fd = -1;
 	unsigned i;
 	int ret;
@@ -688,6 +782,10 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 			return -EINVAL;
 	}
 
+	/* With VM_BIND, the BOs come from the VM rather than a BO table: */
+	if (vm_bind && (args->nr_bos || (args->flags & MSM_SUBMIT_SUDO)))
+		return -EINVAL;
+
 	queue = msm_submitqueue_get(ctx, args->queueid);
 	if (!queue)
 		return -ENOENT;
@@ -702,19 +800,29 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		}
 	}
 
-	submit = submit_create(dev, gpu, queue, args->nr_bos, args->nr_cmds);
+	if (vm_bind) {
+		unsigned nr_binds = READ_ONCE(ctx->aspace->nr_implicit_binds);
+
+		submit = submit_create(dev, gpu, queue, nr_binds, args->nr_cmds);
+		if (!IS_ERR(submit))
+			submit_lookup_binds(submit, nr_binds);
+	} else {
+		submit = submit_create(dev, gpu, queue, args->nr_bos, args->nr_cmds);
+	}
 	if (IS_ERR(submit)) {
 		ret = PTR_ERR(submit);
 		goto out_post_unlock;
 	}
 
 	trace_msm_gpu_submit(pid_nr(submit->pid), ring->id, submit->ident,
-		args->nr_bos, args->nr_cmds);
+		submit->nr_bos, args->nr_cmds);
 
 	ret = mutex_lock_interruptible(&queue->lock);
 	if (ret)
 		goto out_post_unlock;
 
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_QUEUE_LOCK);
+
 	if (args->flags & MSM_SUBMIT_SUDO)
 		submit->in_rb = true;
 
@@ -734,7 +842,7 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	}
 
 	if (args->flags & MSM_SUBMIT_SYNCOBJ_IN) {
-		syncobjs_to_reset = msm_parse_deps(submit, file,
+		syncobjs_to_reset = msm_parse_deps(&submit->base, file,
 		                                   args->in_syncobjs,
 		                                   args->nr_in_syncobjs,
 		                                   args->syncobj_stride);
@@ -755,33 +863,51 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		}
 	}
 
-	ret = submit_lookup_objects(submit, args, file);
-	if (ret)
-		goto out;
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_DEPS);
+
+	if (!vm_bind) {
+		ret = submit_lookup_objects(submit, args, file);
+		if (ret)
+			goto out;
+	}
 
 	ret = submit_lookup_cmds(submit, args, file);
 	if (ret)
 		goto out;
 
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_LOOKUP);
+
 	/* copy_*_user while holding a ww ticket upsets lockdep */
 	ret = submit_lock_objects(submit);
 	if (ret)
 		goto out;
 
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_OBJ_LOCK);
+
 	if (!(args->flags & MSM_SUBMIT_NO_IMPLICIT)) {
 		ret = submit_fence_sync(submit);
 		if (ret)
 			goto out;
 	}
 
-	ret = submit_pin_objects(submit);
-	if (ret)
-		goto out;
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_FENCE_SYNC);
+
+	/* VM_BIND mappings are already pinned for as long as they are bound: */
+	if (!vm_bind) {
+		ret = submit_pin_objects(submit);
+		if (ret)
+			goto out;
+	}
+
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_PIN);
 
 	for (i = 0; i < args->nr_cmds; i++) {
 		struct drm_gem_object *obj;
 		uint64_t iova;
 
+		if (vm_bind)
+			continue;
+
 		ret = submit_bo(submit, submit->cmd[i].idx, &obj, &iova);
 		if (ret)
 			goto out;
@@ -794,6 +920,14 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 			goto out;
 		}
 
+		/* The GPU writes the samples, so implicit sync needs to know: */
+		if ((submit->cmd[i].type == MSM_SUBMIT_CMD_PERFCNTR_BUF) &&
+		    !(submit->bos[submit->cmd[i].idx].flags & MSM_SUBMIT_BO_WRITE)) {
+			SUBMIT_ERROR(submit, "perfcntr buffer not writable\n");
+			ret = -EINVAL;
+			goto out;
+		}
+
 		submit->cmd[i].iova = iova + (submit->cmd[i].offset * 4);
 
 		if (likely(!submit->cmd[i].nr_relocs))
@@ -813,6 +947,18 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 
 	submit->nr_cmds = i;
 
+	for (i = 0; i < submit->nr_cmds; i++) {
+		if (submit->cmd[i].type != MSM_SUBMIT_CMD_PERFCNTR_BUF)
+			continue;
+
+		ret = msm_perfcntr_submit_init(submit, submit->cmd[i].iova,
+					       submit->cmd[i].size * 4);
+		if (ret)
+			goto out;
+	}
+
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_RELOC);
+
 	idr_preload(GFP_KERNEL);
 
 	spin_lock(&queue->idr_lock);
@@ -881,12 +1027,15 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	if (ret)
 		goto out;
 
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_ARM);
+
 	submit_attach_object_fences(submit);
 
 	/* The scheduler owns a ref now: */
 	msm_gem_submit_get(submit);
 
 	msm_rd_dump_submit(priv->rd, submit, NULL);
+	msm_rd_dump_submit(priv->rd_relay, submit, NULL);
 
 	drm_sched_entity_push_job(&submit->base);
 
@@ -897,6 +1046,7 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 	msm_process_post_deps(post_deps, args->nr_out_syncobjs,
 	                      submit->user_fence);
 
+	trace_msm_gpu_submit_stage(submit, MSM_SUBMIT_STAGE_PUSH);
 
 out:
 	submit_cleanup(submit, !!ret);
@@ -915,21 +1065,8 @@ int msm_ioctl_gem_submit(struct drm_device *dev, void *data,
 		 */
 		msm_submitqueue_put(queue);
 	}
-	if (!IS_ERR_OR_NULL(post_deps)) {
-		for (i = 0; i < args->nr_out_syncobjs; ++i) {
-			kfree(post_deps[i].chain);
-			drm_syncobj_put(post_deps[i].syncobj);
-		}
-		kfree(post_deps);
-	}
-
-	if (!IS_ERR_OR_NULL(syncobjs_to_reset)) {
-		for (i = 0; i < args->nr_in_syncobjs; ++i) {
-			if (syncobjs_to_reset[i])
-				drm_syncobj_put(syncobjs_to_reset[i]);
-		}
-		kfree(syncobjs_to_reset);
-	}
+	msm_free_post_deps(post_deps, args->nr_out_syncobjs);
+	msm_free_syncobjs(syncobjs_to_reset, args->nr_in_syncobjs);
 
 	return ret;
 }
@@ -4,9 +4,17 @@
  * Author: Rob Clark <robdclark@gmail.com>
  */
 
+#include <linux/file.h>
+#include <linux/sync_file.h>
+#include <linux/uaccess.h>
+
+#include <drm/drm_file.h>
+#include <drm/drm_syncobj.h>
+
 #include "msm_drv.h"
 #include "msm_fence.h"
 #include "msm_gem.h"
+#include "msm_gpu.h"
 #include "msm_mmu.h"
 
 static void
@@ -15,6 +23,12 @@ msm_gem_address_space_destroy(struct kref *kref)
 	struct msm_gem_address_space *aspace = container_of(kref,
 			struct msm_gem_address_space, kref);
 
+	/* msm_gem_vm_bind_fini() drops the VM_BIND mappings: */
+	WARN_ON(!RB_EMPTY_ROOT(&aspace->binds));
+	WARN_ON(aspace->bind_queue);
+	mutex_destroy(&aspace->bind_queue_lock);
+	mutex_destroy(&aspace->bind_lock);
+
 	drm_mm_takedown(&aspace->mm);
 	if (aspace->mmu)
 		aspace->mmu->funcs->destroy(aspace->mmu);
@@ -38,8 +52,12 @@ msm_gem_address_space_get(struct msm_gem_address_space *aspace)
 	return aspace;
 }
 
-/* Actually unmap memory for the vma */
-void msm_gem_vma_purge(struct msm_gem_vma *vma)
+/*
+ * Actually unmap memory for the vma.  If @gather is non-NULL the TLB
+ * invalidate is deferred until msm_mmu_gather_flush(), and the caller must
+ * not release the backing pages or the iova range before then.
+ */
+void msm_gem_vma_purge(struct msm_gem_vma *vma, struct msm_mmu_gather *gather)
 {
 	struct msm_gem_address_space *aspace = vma->aspace;
 	unsigned size = vma->node.size;
@@ -48,7 +66,7 @@ void msm_gem_vma_purge(struct msm_gem_vma *vma)
 	if (!vma->mapped)
 		return;
 
-	aspace->mmu->funcs->unmap(aspace->mmu, vma->iova, size);
+	aspace->mmu->funcs->unmap(aspace->mmu, vma->iova, size, gather);
 
 	vma->mapped = false;
 }
@@ -81,7 +99,7 @@ msm_gem_vma_map(struct msm_gem_vma *vma, int prot,
 	 * Revisit this if we can come up with a scheme to pre-alloc pages
 	 * for the pgtable in map/unmap ops.
 	 */
-	ret = aspace->mmu->funcs->map(aspace->mmu, vma->iova, sgt, size, prot);
+	ret = aspace->mmu->funcs->map(aspace->mmu, vma->iova, sgt, 0, size, prot);
 
 	if (ret) {
 		vma->mapped = false;
@@ -125,6 +143,7 @@ int msm_gem_vma_init(struct msm_gem_vma *vma, int size,
 		u64 range_start, u64 range_end)
 {
 	struct msm_gem_address_space *aspace = vma->aspace;
+	u64 align = PAGE_SIZE;
 	int ret;
 
 	if (GEM_WARN_ON(!aspace))
@@ -133,10 +152,22 @@ int msm_gem_vma_init(struct msm_gem_vma *vma, int size,
 	if (GEM_WARN_ON(vma->iova))
 		return -EBUSY;
 
+	/*
+	 * Align large buffers so that huge page backed ones can be mapped
+	 * with 2M pages.  The gpummu has no use for that.
+	 */
+	if ((size >= SZ_2M) && (aspace->mmu->type != MSM_MMU_GPUMMU))
+		align = SZ_2M;
+
 	spin_lock(&aspace->lock);
 	ret = drm_mm_insert_node_in_range(&aspace->mm, &vma->node,
-					  size, PAGE_SIZE, 0,
+					  size, align, 0,
 					  range_start, range_end, 0);
+	/* fall back to 4K alignment for tight ranges: */
+	if ((ret == -ENOSPC) && (align != PAGE_SIZE))
+		ret = drm_mm_insert_node_in_range(&aspace->mm, &vma->node,
+						  size, PAGE_SIZE, 0,
+						  range_start, range_end, 0);
 	spin_unlock(&aspace->lock);
 
 	if (ret)
@@ -164,6 +195,10 @@ msm_gem_address_space_create(struct msm_mmu *mmu, const char *name,
 		return ERR_PTR(-ENOMEM);
 
 	spin_lock_init(&aspace->lock);
+	mutex_init(&aspace->bind_lock);
+	mutex_init(&aspace->bind_queue_lock);
+	aspace->binds = RB_ROOT;
+	INIT_LIST_HEAD(&aspace->implicit_binds);
 	aspace->name = name;
 	aspace->mmu = mmu;
 	aspace->va_start = va_start;
@@ -175,3 +210,626 @@ msm_gem_address_space_create(struct msm_mmu *mmu, const char *name,
 
 	return aspace;
 }
+
+/*
+ * VM_BIND:
+ *
+ * Once a context has opted in to VM_BIND, userspace manages the GPU virtual
+ * address space itself.  A mapping is either a (page aligned) range of a
+ * BO, or for sparse resources a NULL mapping that is backed by a single
+ * zeroed page, so that a sparse texture can be reserved up front and its
+ * tiles bound to real memory as they are streamed in.  Mappings stay
+ * mapped and pinned until they are unmapped (or the context is closed),
+ * so the submit path no longer has to look up, lock and pin every BO on
+ * each submit.  Only BOs bound with MSM_VM_BIND_IMPLICIT_READ/WRITE take
+ * part in implicit sync.
+ *
+ * Ops are validated at ioctl time, and then applied in order by a job on
+ * the address space's bind queue, once its in-fences have signaled.  Ops
+ * that fail at that point (e.g. mapping over an existing mapping) set an
+ * error on the job's fence, the ops preceding it stay applied.  An unmap
+ * has to exactly match a previous map, so to replace a sparse tile
+ * userspace unmaps its NULL mapping and maps the BO range in the same job.
+ *
+ * The job runs in the fence signalling path, so it must not allocate
+ * memory or take the obj lock.  The binds are allocated and their pages
+ * pinned at ioctl time, and binds that get unmapped are only released
+ * once the job is freed.
+ *
+ * Neither unmapping nor the bind queue waits for the GPU, it is up to
+ * userspace to order binds against submits with fences.  The mapping is
+ * torn down before the pages are released, so getting this wrong results
+ * in an iova fault rather than the GPU accessing freed memory.
+ */
+
+struct msm_vm_bind_op {
+	u32 op;
+	u64 iova;
+	u64 range;
+	/* Preallocated for the map ops, NULL once it is mapped */
+	struct msm_gem_vm_bind *bind;
+};
+
+struct msm_vm_bind_job {
+	struct drm_sched_job base;
+	struct msm_gem_address_space *aspace;
+	/* Binds unmapped by the job, released by msm_vm_bind_job_free() */
+	struct list_head unbound;
+	unsigned nr_ops;
+	struct msm_vm_bind_op ops[];
+};
+
+static inline struct msm_vm_bind_job *to_msm_vm_bind_job(struct drm_sched_job *job)
+{
+	return container_of(job, struct msm_vm_bind_job, base);
+}
+
+static u32 bind_submit_flags(u32 flags)
+{
+	u32 submit_flags = 0;
+
+	if (flags & MSM_VM_BIND_IMPLICIT_READ)
+		submit_flags |= MSM_SUBMIT_BO_READ;
+	if (flags & MSM_VM_BIND_IMPLICIT_WRITE)
+		submit_flags |= MSM_SUBMIT_BO_WRITE;
+
+	return submit_flags;
+}
+
+static inline struct msm_gem_vm_bind *to_vm_bind(const struct rb_node *node)
+{
+	return rb_entry(node, struct msm_gem_vm_bind, rb);
+}
+
+static bool vm_bind_less(struct rb_node *a, const struct rb_node *b)
+{
+	return to_vm_bind(a)->vma.start < to_vm_bind(b)->vma.start;
+}
+
+static int vm_bind_cmp(const void *key, const struct rb_node *node)
+{
+	u64 iova = *(const u64 *)key;
+	u64 start = to_vm_bind(node)->vma.start;
+
+	if (iova < start)
+		return -1;
+	if (iova > start)
+		return 1;
+	return 0;
+}
+
+/* Map every page of the range to the address space's null page */
+static int vm_map_null(struct msm_gem_address_space *aspace, u64 iova, u64 range)
+{
+	struct msm_mmu *mmu = aspace->mmu;
+	struct scatterlist sg;
+	struct sg_table sgt = {
+		.sgl = &sg,
+		.nents = 1,
+		.orig_nents = 1,
+	};
+	u64 off;
+	int ret;
+
+	sg_init_table(&sg, 1);
+	sg_set_page(&sg, aspace->null_page, PAGE_SIZE, 0);
+
+	for (off = 0; off < range; off += PAGE_SIZE) {
+		ret = mmu->funcs->map(mmu, iova + off, &sgt, 0, PAGE_SIZE,
+				      IOMMU_READ | IOMMU_WRITE);
+		if (ret) {
+			if (off)
+				mmu->funcs->unmap(mmu, iova, off, NULL);
+			return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int vm_map(struct msm_gem_address_space *aspace,
+		struct msm_vm_bind_op *op)
+{
+	struct msm_gem_vm_bind *bind = op->bind;
+	struct msm_mmu *mmu = aspace->mmu;
+	int ret;
+
+	lockdep_assert_held(&aspace->bind_lock);
+
+	/* Fails if the range overlaps another mapping: */
+	spin_lock(&aspace->lock);
+	ret = drm_mm_reserve_node(&aspace->mm, &bind->vma);
+	spin_unlock(&aspace->lock);
+	if (ret)
+		return ret;
+
+	/*
+	 * The pages were pinned at ioctl time, so the sgt is stable.
+	 * NOTE: as with msm_gem_vma_map(), io-pgtable can allocate pages
+	 * here.
+	 */
+	if (bind->obj)
+		ret = mmu->funcs->map(mmu, op->iova, to_msm_bo(bind->obj)->sgt,
+				      bind->obj_offset, op->range,
+				      msm_gem_prot(bind->obj));
+	else
+		ret = vm_map_null(aspace, op->iova, op->range);
+	if (ret) {
+		spin_lock(&aspace->lock);
+		drm_mm_remove_node(&bind->vma);
+		spin_unlock(&aspace->lock);
+		return ret;
+	}
+
+	rb_add(&bind->rb, &aspace->binds, vm_bind_less);
+
+	if (bind->submit_flags) {
+		list_add_tail(&bind->node, &aspace->implicit_binds);
+		aspace->nr_implicit_binds++;
+	}
+
+	/* The address space owns it now: */
+	op->bind = NULL;
+
+	return 0;
+}
+
+/* Drop the pin and the references of a bind that is no longer mapped */
+static void vm_bind_free(struct msm_gem_vm_bind *bind)
+{
+	if (bind->obj) {
+		msm_gem_lock(bind->obj);
+		msm_gem_unpin_pages_locked(bind->obj);
+		msm_gem_unlock(bind->obj);
+
+		drm_gem_object_put(bind->obj);
+	}
+
+	kfree(bind);
+}
+
+/* Remove a bind whose range has already been unmapped from the VM */
+static void vm_unlink_locked(struct msm_gem_address_space *aspace,
+		struct msm_gem_vm_bind *bind)
+{
+	lockdep_assert_held(&aspace->bind_lock);
+
+	rb_erase(&bind->rb, &aspace->binds);
+
+	if (!list_empty(&bind->node)) {
+		list_del_init(&bind->node);
+		aspace->nr_implicit_binds--;
+	}
+
+	spin_lock(&aspace->lock);
+	drm_mm_remove_node(&bind->vma);
+	spin_unlock(&aspace->lock);
+}
+
+static int vm_unmap(struct msm_vm_bind_job *job,
+		const struct msm_vm_bind_op *op)
+{
+	struct msm_gem_address_space *aspace = job->aspace;
+	struct msm_gem_vm_bind *bind;
+	struct rb_node *node;
+
+	lockdep_assert_held(&aspace->bind_lock);
+
+	node = rb_find(&op->iova, &aspace->binds, vm_bind_cmp);
+	if (!node)
+		return -ENOENT;
+
+	bind = to_vm_bind(node);
+	if (bind->vma.size != op->range)
+		return -ENOENT;
+
+	/*
+	 * A later op in the same job may map something else at this range,
+	 * so the invalidate can't be deferred here:
+	 */
+	aspace->mmu->funcs->unmap(aspace->mmu, bind->vma.start,
+				  bind->vma.size, NULL);
+
+	vm_unlink_locked(aspace, bind);
+	list_add_tail(&bind->node, &job->unbound);
+
+	return 0;
+}
+
+static struct dma_fence *msm_vm_bind_job_run(struct drm_sched_job *_job)
+{
+	struct msm_vm_bind_job *job = to_msm_vm_bind_job(_job);
+	struct msm_gem_address_space *aspace = job->aspace;
+	unsigned i;
+	int ret = 0;
+
+	mutex_lock(&aspace->bind_lock);
+
+	for (i = 0; i < job->nr_ops; i++) {
+		struct msm_vm_bind_op *op = &job->ops[i];
+
+		if (op->op == MSM_VM_BIND_OP_UNMAP)
+			ret = vm_unmap(job, op);
+		else
+			ret = vm_map(aspace, op);
+		if (ret)
+			break;
+	}
+
+	mutex_unlock(&aspace->bind_lock);
+
+	/* The ops are done on the CPU, so there is no hw fence to wait on: */
+	return ret ? ERR_PTR(ret) : NULL;
+}
+
+static void msm_vm_bind_job_free(struct drm_sched_job *_job)
+{
+	struct msm_vm_bind_job *job = to_msm_vm_bind_job(_job);
+	struct msm_gem_vm_bind *bind, *tmp;
+	unsigned i;
+
+	drm_sched_job_cleanup(_job);
+
+	list_for_each_entry_safe (bind, tmp, &job->unbound, node)
+		vm_bind_free(bind);
+
+	/* Binds of ops that didn't run, or failed: */
+	for (i = 0; i < job->nr_ops; i++) {
+		if (job->ops[i].bind)
+			vm_bind_free(job->ops[i].bind);
+	}
+
+	msm_gem_address_space_put(job->aspace);
+	kfree(job);
+}
+
+const struct drm_sched_backend_ops msm_vm_bind_sched_ops = {
+	.run_job = msm_vm_bind_job_run,
+	.free_job = msm_vm_bind_job_free,
+};
+
+/* Set up the bind queue when a context enables VM_BIND */
+int msm_gem_vm_bind_init(struct msm_gem_address_space *aspace,
+		struct msm_gpu *gpu)
+{
+	struct drm_gpu_scheduler *sched = &gpu->vm_bind_sched;
+	struct drm_sched_entity *entity;
+	int ret = 0;
+
+	mutex_lock(&aspace->bind_queue_lock);
+
+	if (aspace->bind_queue)
+		goto out_unlock;
+
+	aspace->null_page = alloc_page(GFP_KERNEL | __GFP_ZERO);
+	if (!aspace->null_page) {
+		ret = -ENOMEM;
+		goto out_unlock;
+	}
+
+	entity = kzalloc(sizeof(*entity), GFP_KERNEL);
+	if (!entity) {
+		ret = -ENOMEM;
+		goto out_free_page;
+	}
+
+	ret = drm_sched_entity_init(entity, DRM_SCHED_PRIORITY_NORMAL,
+				    &sched, 1, NULL);
+	if (ret) {
+		kfree(entity);
+		goto out_free_page;
+	}
+
+	aspace->bind_queue = entity;
+
+	goto out_unlock;
+
+out_free_page:
+	__free_page(aspace->null_page);
+	aspace->null_page = NULL;
+out_unlock:
+	mutex_unlock(&aspace->bind_queue_lock);
+
+	return ret;
+}
+
+/*
+ * Drain the bind queue and drop all VM_BIND mappings, once the context is
+ * idle and going away.
+ */
+void msm_gem_vm_bind_fini(struct msm_gem_address_space *aspace)
+{
+	struct msm_mmu_gather gather = {};
+	struct msm_gem_vm_bind *bind, *tmp;
+	struct rb_node *node;
+	LIST_HEAD(unbound);
+
+	mutex_lock(&aspace->bind_queue_lock);
+
+	if (!aspace->bind_queue) {
+		mutex_unlock(&aspace->bind_queue_lock);
+		return;
+	}
+
+	if (aspace->last_bind) {
+		dma_fence_wait(aspace->last_bind, false);
+		dma_fence_put(aspace->last_bind);
+		aspace->last_bind = NULL;
+	}
+
+	drm_sched_entity_destroy(aspace->bind_queue);
+	kfree(aspace->bind_queue);
+	aspace->bind_queue = NULL;
+
+	mutex_unlock(&aspace->bind_queue_lock);
+
+	/*
+	 * Tear down all of the mappings with a single TLB invalidate, and
+	 * only then release the pages and iova ranges behind them:
+	 */
+	mutex_lock(&aspace->bind_lock);
+	for (node = rb_first(&aspace->binds); node; node = rb_next(node)) {
+		bind = to_vm_bind(node);
+		aspace->mmu->funcs->unmap(aspace->mmu, bind->vma.start,
+					  bind->vma.size, &gather);
+	}
+	msm_mmu_gather_flush(&gather);
+	while ((node = rb_first(&aspace->binds))) {
+		bind = to_vm_bind(node);
+		vm_unlink_locked(aspace, bind);
+		list_add_tail(&bind->node, &unbound);
+	}
+	mutex_unlock(&aspace->bind_lock);
+
+	list_for_each_entry_safe (bind, tmp, &unbound, node)
+		vm_bind_free(bind);
+
+	__free_page(aspace->null_page);
+	aspace->null_page = NULL;
+}
+
+static int vm_bind_op_lookup(struct msm_gem_address_space *aspace,
+		struct drm_file *file, const struct drm_msm_vm_bind_op *uop,
+		struct msm_vm_bind_op *op)
+{
+	struct msm_gem_vm_bind *bind;
+	struct drm_gem_object *obj;
+	struct page **pages;
+
+	if (uop->pad || !uop->range ||
+	    !PAGE_ALIGNED(uop->iova) || !PAGE_ALIGNED(uop->range))
+		return -EINVAL;
+
+	if ((uop->iova < aspace->va_start) ||
+	    (uop->range > aspace->va_size) ||
+	    (uop->iova - aspace->va_start > aspace->va_size - uop->range))
+		return -EINVAL;
+
+	if ((uop->iova >> PAGE_SHIFT) > ULONG_MAX)
+		return -EINVAL;
+
+	op->op = uop->op;
+	op->iova = uop->iova;
+	op->range = uop->range;
+
+	switch (uop->op) {
+	case MSM_VM_BIND_OP_MAP:
+		if ((uop->flags & ~MSM_VM_BIND_OP_FLAGS) ||
+		    !PAGE_ALIGNED(uop->obj_offset))
+			return -EINVAL;
+		break;
+	case MSM_VM_BIND_OP_MAP_NULL:
+	case MSM_VM_BIND_OP_UNMAP:
+		if (uop->flags || uop->handle || uop->obj_offset)
+			return -EINVAL;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (uop->op == MSM_VM_BIND_OP_UNMAP)
+		return 0;
+
+	bind = kzalloc(sizeof(*bind), GFP_KERNEL);
+	if (!bind)
+		return -ENOMEM;
+
+	bind->vma.start = uop->iova;
+	bind->vma.size = uop->range;
+	INIT_LIST_HEAD(&bind->node);
+
+	if (uop->op == MSM_VM_BIND_OP_MAP) {
+		obj = drm_gem_object_lookup(file, uop->handle);
+		if (!obj) {
+			kfree(bind);
+			return -ENOENT;
+		}
+
+		if ((uop->obj_offset > obj->size) ||
+		    (uop->range > obj->size - uop->obj_offset)) {
+			drm_gem_object_put(obj);
+			kfree(bind);
+			return -EINVAL;
+		}
+
+		/* The bind job can't do this from the fence signalling path: */
+		msm_gem_lock(obj);
+		pages = msm_gem_pin_pages_locked(obj);
+		msm_gem_unlock(obj);
+		if (IS_ERR(pages)) {
+			drm_gem_object_put(obj);
+			kfree(bind);
+			return PTR_ERR(pages);
+		}
+
+		bind->obj = obj;
+		bind->obj_offset = uop->obj_offset;
+		bind->submit_flags = bind_submit_flags(uop->flags);
+	}
+
+	op->bind = bind;
+
+	return 0;
+}
+
+int msm_ioctl_vm_bind(struct drm_device *dev, void *data,
+		struct drm_file *file)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct drm_msm_vm_bind *args = data;
+	struct msm_file_private *ctx = file->driver_priv;
+	struct msm_gem_address_space *aspace = ctx->aspace;
+	struct msm_submit_post_dep *post_deps = NULL;
+	struct drm_syncobj **syncobjs_to_reset = NULL;
+	struct sync_file *sync_file = NULL;
+	struct dma_fence *fence = NULL;
+	struct msm_vm_bind_job *job;
+	int out_fence_fd = -1;
+	bool async;
+	unsigned i;
+	int ret;
+
+	if (!priv->gpu)
+		return -ENXIO;
+
+	if (!READ_ONCE(ctx->vm_bind))
+		return -EINVAL;
+
+	if ((args->flags & ~MSM_VM_BIND_FLAGS) || args->pad)
+		return -EINVAL;
+
+	/* Without an out-fence, the ioctl waits for the ops to complete: */
+	async = (args->flags & MSM_VM_BIND_FENCE_FD_OUT) || args->nr_out_syncobjs;
+
+	job = kzalloc(struct_size(job, ops, args->nr_ops),
+		      GFP_KERNEL | __GFP_NOWARN);
+	if (!job)
+		return -ENOMEM;
+
+	INIT_LIST_HEAD(&job->unbound);
+
+	ret = drm_sched_job_init(&job->base, aspace->bind_queue, 1, aspace);
+	if (ret) {
+		kfree(job);
+		return ret;
+	}
+
+	job->aspace = msm_gem_address_space_get(aspace);
+
+	for (i = 0; i < args->nr_ops; i++) {
+		struct drm_msm_vm_bind_op op;
+		void __user *userptr =
+			u64_to_user_ptr(args->ops + (i * sizeof(op)));
+
+		if (copy_from_user(&op, userptr, sizeof(op))) {
+			ret = -EFAULT;
+			goto out;
+		}
+
+		ret = vm_bind_op_lookup(aspace, file, &op, &job->ops[i]);
+		if (ret)
+			goto out;
+
+		job->nr_ops++;
+	}
+
+	if (args->flags & MSM_VM_BIND_FENCE_FD_IN) {
+		struct dma_fence *in_fence;
+
+		in_fence = sync_file_get_fence(args->fence_fd);
+		if (!in_fence) {
+			ret = -EINVAL;
+			goto out;
+		}
+
+		ret = drm_sched_job_add_dependency(&job->base, in_fence);
+		if (ret)
+			goto out;
+	}
+
+	if (args->nr_in_syncobjs) {
+		syncobjs_to_reset = msm_parse_deps(&job->base, file,
+						   args->in_syncobjs,
+						   args->nr_in_syncobjs,
+						   args->syncobj_stride);
+		if (IS_ERR(syncobjs_to_reset)) {
+			ret = PTR_ERR(syncobjs_to_reset);
+			goto out;
+		}
+	}
+
+	if (args->nr_out_syncobjs) {
+		post_deps = msm_parse_post_deps(dev, file,
+						args->out_syncobjs,
+						args->nr_out_syncobjs,
+						args->syncobj_stride);
+		if (IS_ERR(post_deps)) {
+			ret = PTR_ERR(post_deps);
+			goto out;
+		}
+	}
+
+	if (args->flags & MSM_VM_BIND_FENCE_FD_OUT) {
+		out_fence_fd = get_unused_fd_flags(O_CLOEXEC);
+		if (out_fence_fd < 0) {
+			ret = out_fence_fd;
+			goto out;
+		}
+	}
+
+	mutex_lock(&aspace->bind_queue_lock);
+
+	drm_sched_job_arm(&job->base);
+
+	fence = dma_fence_get(&job->base.s_fence->finished);
+
+	if (out_fence_fd >= 0) {
+		sync_file = sync_file_create(fence);
+		if (!sync_file) {
+			mutex_unlock(&aspace->bind_queue_lock);
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	dma_fence_put(aspace->last_bind);
+	aspace->last_bind = dma_fence_get(fence);
+
+	/* The scheduler owns the job now: */
+	drm_sched_entity_push_job(&job->base);
+	job = NULL;
+
+	mutex_unlock(&aspace->bind_queue_lock);
+
+	if (sync_file) {
+		fd_install(out_fence_fd, sync_file->file);
+		args->fence_fd = out_fence_fd;
+	}
+
+	msm_reset_syncobjs(syncobjs_to_reset, args->nr_in_syncobjs);
+	msm_process_post_deps(post_deps, args->nr_out_syncobjs, fence);
+
+	if (!async) {
+		/*
+		 * The ops are queued either way, so don't let the ioctl be
+		 * restarted if the wait is interrupted:
+		 */
+		ret = dma_fence_wait(fence, true);
+		if (ret == -ERESTARTSYS)
+			ret = -EINTR;
+		else if (!ret)
+			ret = fence->error;
+	}
+
+out:
+	if (job)
+		msm_vm_bind_job_free(&job->base);
+	if (ret && !sync_file && (out_fence_fd >= 0))
+		put_unused_fd(out_fence_fd);
+
+	dma_fence_put(fence);
+	msm_free_post_deps(post_deps, args->nr_out_syncobjs);
+	msm_free_syncobjs(syncobjs_to_reset, args->nr_in_syncobjs);
+
+	return ret;
+}
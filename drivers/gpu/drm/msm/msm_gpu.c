@@ -218,6 +218,19 @@ static void msm_gpu_devcoredump_free(void *data)
 	msm_gpu_crashstate_put(gpu);
 }
 
+/*
+ * Buffer contents are copied into the crash state after the GPU has been
+ * recovered, rather than in the recovery path itself, within these budgets.
+ * Buffers beyond the budget are recorded without their contents.
+ */
+static uint crashdump_max_size = SZ_256M;
+MODULE_PARM_DESC(crashdump_max_size, "Max bytes of buffer contents captured per GPU crash (0 = unlimited)");
+module_param(crashdump_max_size, uint, 0600);
+
+static uint crashdump_timeout_ms = 1000;
+MODULE_PARM_DESC(crashdump_timeout_ms, "Max time spent capturing buffer contents per GPU crash, in ms (0 = unlimited)");
+module_param(crashdump_timeout_ms, uint, 0600);
+
 static void msm_gpu_crashstate_get_bo(struct msm_gpu_state *state,
 		struct drm_gem_object *obj, u64 iova, bool full)
 {
@@ -233,29 +246,82 @@ static void msm_gpu_crashstate_get_bo(struct msm_gpu_state *state,
 
 	memcpy(state_bo->name, msm_obj->name, sizeof(state_bo->name));
 
+	/* The contents are copied later, by msm_gpu_crashstate_worker(): */
 	if (full) {
-		void *ptr;
-
-		state_bo->data = kvmalloc(obj->size, GFP_KERNEL);
-		if (!state_bo->data)
-			goto out;
-
-		msm_gem_lock(obj);
-		ptr = msm_gem_get_vaddr_active(obj);
-		msm_gem_unlock(obj);
-		if (IS_ERR(ptr)) {
-			kvfree(state_bo->data);
-			state_bo->data = NULL;
-			goto out;
-		}
-
-		memcpy(state_bo->data, ptr, obj->size);
-		msm_gem_put_vaddr(obj);
+		drm_gem_object_get(obj);
+		state_bo->obj = obj;
 	}
-out:
+
 	state->nr_bos++;
 }
 
+static bool msm_gpu_crashstate_copy_bo(struct msm_gpu_state_bo *state_bo)
+{
+	struct drm_gem_object *obj = state_bo->obj;
+	void *ptr;
+
+	state_bo->data = kvmalloc(obj->size, GFP_KERNEL);
+	if (!state_bo->data)
+		return false;
+
+	msm_gem_lock(obj);
+	ptr = msm_gem_get_vaddr_active(obj);
+	msm_gem_unlock(obj);
+	if (IS_ERR(ptr)) {
+		kvfree(state_bo->data);
+		state_bo->data = NULL;
+		return false;
+	}
+
+	memcpy(state_bo->data, ptr, obj->size);
+	msm_gem_put_vaddr(obj);
+
+	return true;
+}
+
+/*
+ * Second half of the crash state capture, run once the GPU is back up.
+ * The device coredump is only registered once this completes, so until
+ * then nothing else can be holding a reference to the crash state.
+ */
+static void msm_gpu_crashstate_worker(struct work_struct *work)
+{
+	struct msm_gpu *gpu = container_of(work, struct msm_gpu, crashstate_work);
+	unsigned long deadline = jiffies + msecs_to_jiffies(crashdump_timeout_ms);
+	size_t budget = crashdump_max_size ? crashdump_max_size : SIZE_MAX;
+	struct msm_gpu_state *state;
+	int i;
+
+	mutex_lock(&gpu->lock);
+	state = gpu->crashstate;
+	mutex_unlock(&gpu->lock);
+
+	if (WARN_ON(!state))
+		return;
+
+	for (i = 0; state->bos && i < state->nr_bos; i++) {
+		struct msm_gpu_state_bo *state_bo = &state->bos[i];
+
+		if (!state_bo->obj)
+			continue;
+
+		if (crashdump_timeout_ms && time_after(jiffies, deadline))
+			budget = 0;
+
+		if (state_bo->size <= budget &&
+		    msm_gpu_crashstate_copy_bo(state_bo))
+			budget -= state_bo->size;
+
+		drm_gem_object_put(state_bo->obj);
+		state_bo->obj = NULL;
+
+		cond_resched();
+	}
+
+	dev_coredumpm(&gpu->pdev->dev, THIS_MODULE, gpu, 0, GFP_KERNEL,
+		msm_gpu_devcoredump_read, msm_gpu_devcoredump_free);
+}
+
 static void msm_gpu_crashstate_capture(struct msm_gpu *gpu,
 		struct msm_gem_submit *submit, char *comm, char *cmd)
 {
@@ -294,10 +360,14 @@ static void msm_gpu_crashstate_capture(struct msm_gpu *gpu,
 	/* Set the active crash state to be dumped on failure */
 	gpu->crashstate = state;
 
-	dev_coredumpm(&gpu->pdev->dev, THIS_MODULE, gpu, 0, GFP_KERNEL,
-		msm_gpu_devcoredump_read, msm_gpu_devcoredump_free);
+	/* Copy buffer contents and register the coredump off the recovery path: */
+	queue_work(system_unbound_wq, &gpu->crashstate_work);
 }
 #else
+static void msm_gpu_crashstate_worker(struct work_struct *work)
+{
+}
+
 static void msm_gpu_crashstate_capture(struct msm_gpu *gpu,
 		struct msm_gem_submit *submit, char *comm, char *cmd)
 {
@@ -328,6 +398,45 @@ find_submit(struct msm_ringbuffer *ring, uint32_t fence)
 
 static void retire_submits(struct msm_gpu *gpu);
 
+static u64 submit_ttbr0(struct msm_gem_submit *submit)
+{
+	phys_addr_t ttbr;
+	int asid;
+
+	if (!submit->aspace ||
+	    msm_iommu_pagetable_params(submit->aspace->mmu, &ttbr, &asid))
+		return 0;
+
+	return ttbr;
+}
+
+/*
+ * Find the submit to blame for a hang.  If there was an iova fault since
+ * the last recovery, it is the submit from the faulting context, which is
+ * not necessarily the one current on the hung ring.
+ */
+static struct msm_gem_submit *
+find_guilty_submit(struct msm_gpu *gpu, struct msm_ringbuffer **ring)
+{
+	u64 ttbr0 = gpu->fault_ttbr0 & GENMASK_ULL(47, 0);
+	int i;
+
+	gpu->fault_ttbr0 = 0;
+
+	for (i = 0; ttbr0 && i < gpu->nr_rings; i++) {
+		struct msm_ringbuffer *r = gpu->rb[i];
+		struct msm_gem_submit *submit =
+			find_submit(r, r->memptrs->fence + 1);
+
+		if (submit && submit_ttbr0(submit) == ttbr0) {
+			*ring = r;
+			return submit;
+		}
+	}
+
+	return find_submit(*ring, (*ring)->memptrs->fence + 1);
+}
+
 static void get_comm_cmdline(struct msm_gem_submit *submit, char **comm, char **cmd)
 {
 	struct msm_file_private *ctx = submit->queue->ctx;
@@ -359,14 +468,16 @@ static void recover_worker(struct kthread_work *work)
 	struct msm_drm_private *priv = dev->dev_private;
 	struct msm_gem_submit *submit;
 	struct msm_ringbuffer *cur_ring = gpu->funcs->active_ring(gpu);
+	struct msm_gpu_submitqueue *guilty;
 	char *comm = NULL, *cmd = NULL;
+	ktime_t start = ktime_get();
 	int i;
 
 	mutex_lock(&gpu->lock);
 
 	DRM_DEV_ERROR(dev->dev, "%s: hangcheck recover!\n", gpu->name);
 
-	submit = find_submit(cur_ring, cur_ring->memptrs->fence + 1);
+	submit = find_guilty_submit(gpu, &cur_ring);
 
 	/*
 	 * If the submit retired while we were waiting for the worker to run,
@@ -380,6 +491,9 @@ static void recover_worker(struct kthread_work *work)
 	if (submit->aspace)
 		submit->aspace->faults++;
 
+	guilty = submit->queue;
+	dma_fence_set_error(submit->hw_fence, -EIO);
+
 	get_comm_cmdline(submit, &comm, &cmd);
 
 	if (comm && cmd) {
@@ -429,21 +543,33 @@ static void recover_worker(struct kthread_work *work)
 
 		/*
 		 * Replay all remaining submits starting with highest priority
-		 * ring
+		 * ring.  The rest of the guilty queue's submits likely depend
+		 * on the state it left behind, so they are cancelled, but
+		 * still replayed as fence writes only to keep the fences
+		 * signalling in order.
 		 */
 		for (i = 0; i < gpu->nr_rings; i++) {
 			struct msm_ringbuffer *ring = gpu->rb[i];
 			unsigned long flags;
 
 			spin_lock_irqsave(&ring->submit_lock, flags);
-			list_for_each_entry(submit, &ring->submits, node)
+			list_for_each_entry(submit, &ring->submits, node) {
+				if (submit->queue == guilty && !submit->skip) {
+					submit->skip = true;
+					dma_fence_set_error(submit->hw_fence,
+							    -ECANCELED);
+				}
 				gpu->funcs->submit(gpu, submit);
+			}
 			spin_unlock_irqrestore(&ring->submit_lock, flags);
 		}
 	}
 
 	pm_runtime_put(&gpu->pdev->dev);
 
+	gpu->recovery.count++;
+	gpu->recovery.total_us += ktime_us_delta(ktime_get(), start);
+
 out_unlock:
 	mutex_unlock(&gpu->lock);
 
@@ -482,6 +608,7 @@ static void fault_worker(struct kthread_work *work)
 	kfree(comm);
 
 resume_smmu:
+	gpu->fault_ttbr0 = gpu->fault_info.ttbr0;
 	memset(&gpu->fault_info, 0, sizeof(gpu->fault_info));
 	gpu->aspace->mmu->funcs->resume_translation(gpu->aspace->mmu);
 
@@ -652,7 +779,6 @@ static void retire_submit(struct msm_gpu *gpu, struct msm_ringbuffer *ring,
 	int index = submit->seqno % MSM_GPU_SUBMIT_STATS_COUNT;
 	volatile struct msm_gpu_submit_stats *stats;
 	u64 elapsed, clock = 0, cycles;
-	unsigned long flags;
 
 	stats = &ring->memptrs->stats[index];
 	/* Convert 19.2Mhz alwayson ticks to nanoseconds for elapsed time */
@@ -670,29 +796,80 @@ static void retire_submit(struct msm_gpu *gpu, struct msm_ringbuffer *ring,
 	submit->queue->ctx->elapsed_ns += elapsed;
 	submit->queue->ctx->cycles     += cycles;
 
+	drm_sched_entity_account_busy(submit->queue->entity, elapsed);
+
+	if (submit->queue->ctx->avg_cycles)
+		cycles = (submit->queue->ctx->avg_cycles * 3 + cycles) >> 2;
+	submit->queue->ctx->avg_cycles = cycles;
+
 	trace_msm_gpu_submit_retired(submit, elapsed, clock,
 		stats->alwayson_start, stats->alwayson_end);
 
 	msm_submit_retire(submit);
+}
 
-	pm_runtime_mark_last_busy(&gpu->pdev->dev);
+/*
+ * Retire all the completed submits on a ring as a batch, so that when
+ * many of them complete together the ring's locks are taken once for the
+ * batch rather than once per submit.
+ */
+static void retire_ring(struct msm_gpu *gpu, struct msm_ringbuffer *ring)
+{
+	struct msm_gem_submit *submit, *tmp, *last = NULL;
+	struct msm_fence_context *fctx = ring->fctx;
+	int nr_submits = 0, nr_floor = 0;
+	LIST_HEAD(retired);
+	unsigned long flags;
 
+	/*
+	 * Submits complete in order, so the completed ones are the ones
+	 * at the head of the list up to the first that isn't:
+	 */
 	spin_lock_irqsave(&ring->submit_lock, flags);
-	list_del(&submit->node);
+	list_for_each_entry(submit, &ring->submits, node) {
+		if (!msm_fence_completed(fctx, submit->seqno))
+			break;
+		last = submit;
+	}
+	if (last)
+		list_cut_position(&retired, &ring->submits, &last->node);
 	spin_unlock_irqrestore(&ring->submit_lock, flags);
 
+	if (!last)
+		return;
+
+	/* The hw fences are protected by the fctx lock: */
+	spin_lock_irqsave(&fctx->spinlock, flags);
+	list_for_each_entry(submit, &retired, node)
+		dma_fence_signal_locked(submit->hw_fence);
+	spin_unlock_irqrestore(&fctx->spinlock, flags);
+
+	list_for_each_entry(submit, &retired, node) {
+		retire_submit(gpu, ring, submit);
+
+		if (submit->queue->flags & MSM_SUBMITQUEUE_FREQ_FLOOR)
+			nr_floor++;
+		nr_submits++;
+	}
+
+	pm_runtime_mark_last_busy(&gpu->pdev->dev);
+
 	/* Update devfreq on transition from active->idle: */
 	mutex_lock(&gpu->active_lock);
-	gpu->active_submits--;
+	while (nr_floor--)
+		msm_devfreq_floor_put(gpu);
+	gpu->active_submits -= nr_submits;
 	WARN_ON(gpu->active_submits < 0);
 	if (!gpu->active_submits) {
 		msm_devfreq_idle(gpu);
 		pm_runtime_put_autosuspend(&gpu->pdev->dev);
 	}
-
 	mutex_unlock(&gpu->active_lock);
 
-	msm_gem_submit_put(submit);
+	list_for_each_entry_safe(submit, tmp, &retired, node) {
+		list_del(&submit->node);
+		msm_gem_submit_put(submit);
+	}
 }
 
 static void retire_submits(struct msm_gpu *gpu)
@@ -700,30 +877,8 @@ static void retire_submits(struct msm_gpu *gpu)
 	int i;
 
 	/* Retire the commits starting with highest priority */
-	for (i = 0; i < gpu->nr_rings; i++) {
-		struct msm_ringbuffer *ring = gpu->rb[i];
-
-		while (true) {
-			struct msm_gem_submit *submit = NULL;
-			unsigned long flags;
-
-			spin_lock_irqsave(&ring->submit_lock, flags);
-			submit = list_first_entry_or_null(&ring->submits,
-					struct msm_gem_submit, node);
-			spin_unlock_irqrestore(&ring->submit_lock, flags);
-
-			/*
-			 * If no submit, we are done.  If submit->fence hasn't
-			 * been signalled, then later submits are not signalled
-			 * either, so we are also done.
-			 */
-			if (submit && dma_fence_is_signaled(submit->hw_fence)) {
-				retire_submit(gpu, ring, submit);
-			} else {
-				break;
-			}
-		}
-	}
+	for (i = 0; i < gpu->nr_rings; i++)
+		retire_ring(gpu, gpu->rb[i]);
 
 	wake_up_all(&gpu->retire_event);
 }
@@ -735,6 +890,41 @@ static void retire_worker(struct kthread_work *work)
 	retire_submits(gpu);
 }
 
+/*
+ * Estimate the GPU cycles needed to finish the submits on the ring up to and
+ * including @fence, from the recent per-submit cost of the contexts they
+ * belong to.  Returns zero if any of them has no history to go on.
+ */
+u64 msm_gpu_queued_cycles(struct msm_gpu *gpu, struct msm_ringbuffer *ring,
+		uint32_t fence)
+{
+	struct msm_gem_submit *submit;
+	unsigned long flags;
+	u64 cycles = 0;
+
+	spin_lock_irqsave(&ring->submit_lock, flags);
+	list_for_each_entry(submit, &ring->submits, node) {
+		u64 avg;
+
+		if (fence_after(submit->seqno, fence))
+			break;
+
+		if (msm_fence_completed(ring->fctx, submit->seqno))
+			continue;
+
+		avg = READ_ONCE(submit->queue->ctx->avg_cycles);
+		if (!avg) {
+			cycles = 0;
+			break;
+		}
+
+		cycles += avg;
+	}
+	spin_unlock_irqrestore(&ring->submit_lock, flags);
+
+	return cycles;
+}
+
 /* call from irq handler to schedule work to retire bo's */
 void msm_gpu_retire(struct msm_gpu *gpu)
 {
@@ -780,10 +970,13 @@ void msm_gpu_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit)
 		msm_devfreq_active(gpu);
 	}
 	gpu->active_submits++;
+	if (submit->queue->flags & MSM_SUBMITQUEUE_FREQ_FLOOR)
+		msm_devfreq_floor_get(gpu);
 	mutex_unlock(&gpu->active_lock);
 
 	gpu->funcs->submit(gpu, submit);
 	gpu->cur_ctx_seqno = submit->queue->ctx->seqno;
+	submit->ring->cur_ctx_seqno = submit->queue->ctx->seqno;
 
 	pm_runtime_put(&gpu->pdev->dev);
 	hangcheck_timer_reset(gpu);
@@ -870,10 +1063,12 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 
 	mutex_init(&gpu->active_lock);
 	mutex_init(&gpu->lock);
+	mutex_init(&gpu->perfcntr_lock);
 	init_waitqueue_head(&gpu->retire_event);
 	kthread_init_work(&gpu->retire_work, retire_worker);
 	kthread_init_work(&gpu->recover_work, recover_worker);
 	kthread_init_work(&gpu->fault_work, fault_worker);
+	INIT_WORK(&gpu->crashstate_work, msm_gpu_crashstate_worker);
 
 	priv->hangcheck_period = DRM_MSM_HANGCHECK_DEFAULT_PERIOD;
 
@@ -982,6 +1177,19 @@ int msm_gpu_init(struct drm_device *drm, struct platform_device *pdev,
 
 	gpu->nr_rings = nr_rings;
 
+	/*
+	 * VM_BIND jobs are executed on the CPU, so there is no timeout and
+	 * a single job in flight is enough:
+	 */
+	ret = drm_sched_init(&gpu->vm_bind_sched, &msm_vm_bind_sched_ops, NULL,
+			     DRM_SCHED_PRIORITY_COUNT, 1, 0,
+			     MAX_SCHEDULE_TIMEOUT, NULL, NULL, "vm_bind",
+			     drm->dev);
+	if (ret) {
+		DRM_DEV_ERROR(drm->dev, "could not create vm_bind scheduler: %d\n", ret);
+		goto fail;
+	}
+
 	refcount_set(&gpu->sysprof_active, 1);
 
 	return 0;
@@ -1004,6 +1212,11 @@ void msm_gpu_cleanup(struct msm_gpu *gpu)
 
 	DBG("%s", gpu->name);
 
+	if (gpu->vm_bind_sched.ready)
+		drm_sched_fini(&gpu->vm_bind_sched);
+
+	flush_work(&gpu->crashstate_work);
+
 	for (i = 0; i < ARRAY_SIZE(gpu->rb); i++) {
 		msm_ringbuffer_destroy(gpu->rb[i]);
 		gpu->rb[i] = NULL;
@@ -78,12 +78,31 @@ struct msm_gpu_funcs {
 	/* note: gpu_set_freq() can assume that we have been pm_resumed */
 	void (*gpu_set_freq)(struct msm_gpu *gpu, struct dev_pm_opp *opp,
 			     bool suspended);
+	/*
+	 * gpu_set_freq_limits: clamp the frequency range used by hw DCVS,
+	 * used instead of gpu_set_freq() when gpu->hw_dcvs is set
+	 */
+	void (*gpu_set_freq_limits)(struct msm_gpu *gpu, unsigned long min_freq,
+				    unsigned long max_freq, bool suspended);
+	/*
+	 * gpu_update_bw: optional, update the memory bandwidth vote from the
+	 * traffic measured over the last @elapsed_us devfreq sampling period,
+	 * can assume that we have been pm_resumed
+	 */
+	void (*gpu_update_bw)(struct msm_gpu *gpu, u64 elapsed_us);
 	struct msm_gem_address_space *(*create_address_space)
 		(struct msm_gpu *gpu, struct platform_device *pdev);
 	struct msm_gem_address_space *(*create_private_address_space)
 		(struct msm_gpu *gpu);
 	uint32_t (*get_rptr)(struct msm_gpu *gpu, struct msm_ringbuffer *ring);
 
+	/**
+	 * submitqueue_setup: Optional hook to allocate per submitqueue
+	 * resources, such as the preemption context record.
+	 */
+	int (*submitqueue_setup)(struct msm_gpu *gpu,
+				 struct msm_gpu_submitqueue *queue);
+
 	/**
 	 * progress: Has the GPU made progress?
 	 *
@@ -159,6 +178,22 @@ struct msm_gpu_devfreq {
 	 */
 	struct msm_hrtimer_work boost_work;
 
+	/**
+	 * floor_freq:
+	 *
+	 * A PM QoS constraint holding the min freq up while there are
+	 * submits in flight from a MSM_SUBMITQUEUE_FREQ_FLOOR queue.
+	 */
+	struct dev_pm_qos_request floor_freq;
+
+	/**
+	 * floor_submits:
+	 *
+	 * Number of submits in flight that hold the floor_freq constraint,
+	 * protected by gpu->active_lock.
+	 */
+	unsigned floor_submits;
+
 	/** suspended: tracks if we're suspended */
 	bool suspended;
 };
@@ -183,9 +218,26 @@ struct msm_gpu {
 	const struct msm_gpu_perfcntr *perfcntrs;
 	uint32_t num_perfcntrs;
 
+	/* counters that userspace can reserve, see msm_perfcntr.c: */
+	const struct msm_perfcntr_group *perfcntr_groups;
+	unsigned nr_perfcntr_groups;
+
+	/* protects perfcntr_reserved and the contexts' reservations: */
+	struct mutex perfcntr_lock;
+	u32 perfcntr_reserved[MSM_PERFCNTR_MAX_GROUPS];
+
 	struct msm_ringbuffer *rb[MSM_GPU_MAX_RINGS];
 	int nr_rings;
 
+	/**
+	 * vm_bind_sched:
+	 *
+	 * The scheduler that runs VM_BIND jobs.  Each context that enabled
+	 * VM_BIND queues its jobs on its own entity, so that binds of one
+	 * context don't wait on the fences of another.
+	 */
+	struct drm_gpu_scheduler vm_bind_sched;
+
 	/**
 	 * sysprof_active:
 	 *
@@ -259,6 +311,24 @@ struct msm_gpu {
 	/* Fault info for most recent iova fault: */
 	struct msm_gpu_fault_info fault_info;
 
+	/**
+	 * fault_ttbr0: pagetable of the last iova fault, used by recovery
+	 * to blame the context that faulted rather than whichever one is
+	 * current on the hung ring.  Protected by gpu->lock.
+	 */
+	u64 fault_ttbr0;
+
+	/**
+	 * recovery: GPU recovery stats, exported in debugfs
+	 *
+	 * Protected by gpu->lock.
+	 */
+	struct {
+		unsigned count;		/* # of recoveries */
+		unsigned soft;		/* # of those that avoided a power cycle */
+		u64 total_us;		/* total time spent in recovery */
+	} recovery;
+
 	/* work for handling GPU ioval faults: */
 	struct kthread_work fault_work;
 
@@ -282,9 +352,18 @@ struct msm_gpu {
 
 	struct msm_gpu_state *crashstate;
 
+	/* work for the deferred part of crash state capture: */
+	struct work_struct crashstate_work;
+
 	/* True if the hardware supports expanded apriv (a650 and newer) */
 	bool hw_apriv;
 
+	/*
+	 * True if frequency scaling decisions are made by the hardware (ie.
+	 * the GMU), in which case devfreq only provides the min/max clamps
+	 */
+	bool hw_dcvs;
+
 	/**
 	 * @allow_relocs: allow relocs in SUBMIT ioctl
 	 *
@@ -335,6 +414,33 @@ static inline bool msm_gpu_active(struct msm_gpu *gpu)
  * will handle sampling/displaying the counters.
  */
 
+#define MSM_PERFCNTR_MAX_GROUPS 16
+#define MSM_PERFCNTR_MAX 16
+
+/*
+ * A block of counters which userspace can reserve and have sampled around
+ * its submits.  Select registers are consecutive, and counters are 64b
+ * register pairs, starting from the registers given here.  Each counter
+ * can be set to any countable of the block below nr_countables.
+ */
+struct msm_perfcntr_group {
+	const char *name;
+	u32 select_reg;
+	u32 counter_reg;
+	u32 nr_counters;
+	u32 nr_countables;
+};
+
+/* A counter reserved by a context: */
+struct msm_perfcntr {
+	u32 select_reg;
+	u32 counter_reg;
+	u32 countable;
+	u8 group;
+	u8 idx;
+	u8 slot;
+};
+
 struct msm_gpu_perfcntr {
 	uint32_t select_reg;
 	uint32_t sample_reg;
@@ -386,6 +492,16 @@ struct msm_file_private {
 	 */
 	int sysprof;
 
+	/**
+	 * vm_bind:
+	 *
+	 * Set by userspace with MSM_PARAM_EN_VM_BIND, after which the
+	 * context's address space is managed with the VM_BIND ioctl and
+	 * submits no longer carry a BO table.  Once enabled, it cannot be
+	 * disabled again.
+	 */
+	bool vm_bind;
+
 	/**
 	 * comm: Overridden task comm, see MSM_PARAM_COMM
 	 *
@@ -416,6 +532,23 @@ struct msm_file_private {
 	 */
 	uint64_t cycles;
 
+	/**
+	 * avg_cycles:
+	 *
+	 * Moving average of the GPU cycles per submit from this context,
+	 * used to estimate how much work is queued ahead of a deadline.
+	 */
+	uint64_t avg_cycles;
+
+	/**
+	 * perfcntrs:
+	 *
+	 * Counters reserved with DRM_IOCTL_MSM_PERFCNTR, indexed by the
+	 * slot bits set in perfcntr_slots.  Protected by gpu->perfcntr_lock.
+	 */
+	struct msm_perfcntr perfcntrs[MSM_PERFCNTR_MAX];
+	unsigned long perfcntr_slots;
+
 	/**
 	 * entities:
 	 *
@@ -522,6 +655,8 @@ struct msm_gpu_submitqueue {
 	struct mutex lock;
 	struct kref ref;
 	struct drm_sched_entity *entity;
+	struct drm_gem_object *bo;
+	uint64_t bo_iova;
 };
 
 struct msm_gpu_state_bo {
@@ -531,6 +666,9 @@ struct msm_gpu_state_bo {
 	void *data;
 	bool encoded;
 	char name[32];
+
+	/* Object whose contents are still to be copied into data: */
+	struct drm_gem_object *obj;
 };
 
 struct msm_gpu_state {
@@ -627,6 +765,9 @@ void msm_submitqueue_close(struct msm_file_private *ctx);
 
 void msm_submitqueue_destroy(struct kref *kref);
 
+int msm_perfcntr_submit_init(struct msm_gem_submit *submit, u64 iova, u32 size);
+void msm_perfcntr_release_all(struct msm_gpu *gpu, struct msm_file_private *ctx);
+
 int msm_file_private_set_sysprof(struct msm_file_private *ctx,
 				 struct msm_gpu *gpu, int sysprof);
 void __msm_file_private_destroy(struct kref *kref);
@@ -650,6 +791,10 @@ void msm_devfreq_suspend(struct msm_gpu *gpu);
 void msm_devfreq_boost(struct msm_gpu *gpu, unsigned factor);
 void msm_devfreq_active(struct msm_gpu *gpu);
 void msm_devfreq_idle(struct msm_gpu *gpu);
+void msm_devfreq_deadline(struct msm_gpu *gpu, uint32_t fence, u64 cycles,
+		ktime_t deadline);
+void msm_devfreq_floor_get(struct msm_gpu *gpu);
+void msm_devfreq_floor_put(struct msm_gpu *gpu);
 
 int msm_gpu_hw_init(struct msm_gpu *gpu);
 
@@ -658,6 +803,8 @@ void msm_gpu_perfcntr_stop(struct msm_gpu *gpu);
 int msm_gpu_perfcntr_sample(struct msm_gpu *gpu, uint32_t *activetime,
 		uint32_t *totaltime, uint32_t ncntrs, uint32_t *cntrs);
 
+u64 msm_gpu_queued_cycles(struct msm_gpu *gpu, struct msm_ringbuffer *ring,
+		uint32_t fence);
 void msm_gpu_retire(struct msm_gpu *gpu);
 void msm_gpu_submit(struct msm_gpu *gpu, struct msm_gem_submit *submit);
 
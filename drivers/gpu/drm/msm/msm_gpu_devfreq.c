@@ -16,6 +16,10 @@
  * Power Management:
  */
 
+static uint floor_pct = 50;
+MODULE_PARM_DESC(floor_pct, "Min GPU freq, as a percentage of max, while latency sensitive submits are in flight");
+module_param(floor_pct, uint, 0600);
+
 static int msm_devfreq_target(struct device *dev, unsigned long *freq,
 		u32 flags)
 {
@@ -33,6 +37,26 @@ static int msm_devfreq_target(struct device *dev, unsigned long *freq,
 
 	trace_msm_gpu_freq_change(dev_pm_opp_get_freq(opp));
 
+	/*
+	 * With hw DCVS the performance governor always asks for the max
+	 * clamp, pass it on along with the min clamp and let the hardware
+	 * pick the frequency in between.
+	 */
+	if (gpu->hw_dcvs) {
+		s32 qos_min = dev_pm_qos_read_value(dev, DEV_PM_QOS_MIN_FREQUENCY);
+		unsigned long min_freq;
+
+		min_freq = min((unsigned long)qos_min * HZ_PER_KHZ, *freq);
+
+		mutex_lock(&df->lock);
+		gpu->funcs->gpu_set_freq_limits(gpu, min_freq, *freq,
+						df->suspended);
+		mutex_unlock(&df->lock);
+
+		dev_pm_opp_put(opp);
+		return 0;
+	}
+
 	/*
 	 * If the GPU is idle, devfreq is not aware, so just stash
 	 * the new target freq (to use when we return to active)
@@ -100,6 +124,9 @@ static int msm_devfreq_get_dev_status(struct device *dev,
 	busy_time = busy_cycles - df->busy_cycles;
 	df->busy_cycles = busy_cycles;
 
+	if (gpu->funcs->gpu_update_bw)
+		gpu->funcs->gpu_update_bw(gpu, status->total_time);
+
 	mutex_unlock(&df->lock);
 
 	busy_time *= USEC_PER_SEC;
@@ -158,6 +185,8 @@ void msm_devfreq_init(struct msm_gpu *gpu)
 
 	dev_pm_qos_add_request(&gpu->pdev->dev, &df->boost_freq,
 			       DEV_PM_QOS_MIN_FREQUENCY, 0);
+	dev_pm_qos_add_request(&gpu->pdev->dev, &df->floor_freq,
+			       DEV_PM_QOS_MIN_FREQUENCY, 0);
 
 	msm_devfreq_profile.initial_freq = gpu->fast_rate;
 
@@ -170,13 +199,32 @@ void msm_devfreq_init(struct msm_gpu *gpu)
 	msm_devfreq_profile.freq_table = NULL;
 	msm_devfreq_profile.max_state = 0;
 
-	df->devfreq = devm_devfreq_add_device(&gpu->pdev->dev,
-			&msm_devfreq_profile, DEVFREQ_GOV_SIMPLE_ONDEMAND,
-			&priv->gpu_devfreq_config);
+	/*
+	 * If the hardware does its own DCVS there is nothing to sample, the
+	 * performance governor only forwards the clamps on QoS changes.
+	 */
+	if (gpu->hw_dcvs && gpu->funcs->gpu_set_freq_limits) {
+		df->devfreq = devm_devfreq_add_device(&gpu->pdev->dev,
+				&msm_devfreq_profile, DEVFREQ_GOV_PERFORMANCE,
+				NULL);
+		if (IS_ERR(df->devfreq)) {
+			DRM_DEV_INFO(&gpu->pdev->dev,
+				     "No performance governor, using host DCVS\n");
+			gpu->hw_dcvs = false;
+		}
+	} else {
+		gpu->hw_dcvs = false;
+	}
+
+	if (!gpu->hw_dcvs)
+		df->devfreq = devm_devfreq_add_device(&gpu->pdev->dev,
+				&msm_devfreq_profile, DEVFREQ_GOV_SIMPLE_ONDEMAND,
+				&priv->gpu_devfreq_config);
 
 	if (IS_ERR(df->devfreq)) {
 		DRM_DEV_ERROR(&gpu->pdev->dev, "Couldn't initialize GPU devfreq\n");
 		dev_pm_qos_remove_request(&df->boost_freq);
+		dev_pm_qos_remove_request(&df->floor_freq);
 		df->devfreq = NULL;
 		return;
 	}
@@ -217,6 +265,7 @@ void msm_devfreq_cleanup(struct msm_gpu *gpu)
 
 	devfreq_cooling_unregister(gpu->cooling);
 	dev_pm_qos_remove_request(&df->boost_freq);
+	dev_pm_qos_remove_request(&df->floor_freq);
 }
 
 void msm_devfreq_resume(struct msm_gpu *gpu)
@@ -285,6 +334,66 @@ void msm_devfreq_boost(struct msm_gpu *gpu, unsigned factor)
 			       HRTIMER_MODE_REL);
 }
 
+/*
+ * Boost to the lowest OPP that gets @cycles of queued work done by the
+ * deadline, until the deadline has passed.  With no estimate to go on
+ * this falls back to a fixed boost.
+ */
+void msm_devfreq_deadline(struct msm_gpu *gpu, uint32_t fence, u64 cycles,
+		ktime_t deadline)
+{
+	struct msm_gpu_devfreq *df = &gpu->devfreq;
+	struct device *dev = &gpu->pdev->dev;
+	unsigned long freq, cur_freq;
+	struct dev_pm_opp *opp;
+	s64 remaining_ns;
+	u64 needed = 0;
+
+	if (!has_devfreq(gpu))
+		return;
+
+	if (!cycles) {
+		msm_devfreq_boost(gpu, 2);
+		return;
+	}
+
+	remaining_ns = ktime_to_ns(ktime_sub(deadline, ktime_get()));
+
+	if (remaining_ns > 0) {
+		/* With 1/8th headroom for the error in the estimate: */
+		needed = mul_u64_u64_div_u64(cycles, NSEC_PER_SEC, remaining_ns);
+		needed += needed / 8;
+	}
+
+	freq = (remaining_ns > 0) ? min_t(u64, needed, ULONG_MAX) : ULONG_MAX;
+	opp = dev_pm_opp_find_freq_ceil(dev, &freq);
+	if (IS_ERR(opp)) {
+		freq = ULONG_MAX;
+		opp = dev_pm_opp_find_freq_floor(dev, &freq);
+		if (IS_ERR(opp))
+			return;
+	}
+	dev_pm_opp_put(opp);
+
+	cur_freq = get_freq(gpu);
+
+	trace_msm_gpu_deadline_boost(fence, cycles, remaining_ns, needed,
+				     max(freq, cur_freq));
+
+	/* The governor is already running fast enough: */
+	if (freq <= cur_freq)
+		return;
+
+	/* If the deadline has already been missed, hold max freq a while: */
+	if (remaining_ns <= 0)
+		remaining_ns = ms_to_ktime(msm_devfreq_profile.polling_ms);
+
+	dev_pm_qos_update_request(&df->boost_freq, freq / HZ_PER_KHZ);
+
+	msm_hrtimer_queue_work(&df->boost_work, ns_to_ktime(remaining_ns),
+			       HRTIMER_MODE_REL);
+}
+
 void msm_devfreq_active(struct msm_gpu *gpu)
 {
 	struct msm_gpu_devfreq *df = &gpu->devfreq;
@@ -348,7 +457,7 @@ static void msm_devfreq_idle_work(struct kthread_work *work)
 
 	idle_freq = get_freq(gpu);
 
-	if (priv->gpu_clamp_to_idle)
+	if (priv->gpu_clamp_to_idle && !gpu->hw_dcvs)
 		msm_devfreq_target(&gpu->pdev->dev, &target_freq, 0);
 
 	df->idle_time = ktime_get();
@@ -367,3 +476,42 @@ void msm_devfreq_idle(struct msm_gpu *gpu)
 	msm_hrtimer_queue_work(&df->idle_work, ms_to_ktime(1),
 			       HRTIMER_MODE_REL);
 }
+
+/*
+ * Unlike boost, which is a transient bump, the floor is held for as long as
+ * latency sensitive submits are in flight, so that they don't have to wait
+ * for the governor to notice the load.  Called with gpu->active_lock held.
+ */
+void msm_devfreq_floor_get(struct msm_gpu *gpu)
+{
+	struct msm_gpu_devfreq *df = &gpu->devfreq;
+	uint64_t freq;
+
+	WARN_ON(!mutex_is_locked(&gpu->active_lock));
+
+	if (!has_devfreq(gpu))
+		return;
+
+	if (df->floor_submits++)
+		return;
+
+	freq = (uint64_t)gpu->fast_rate * min(floor_pct, 100u);
+	do_div(freq, 100 * HZ_PER_KHZ);
+
+	dev_pm_qos_update_request(&df->floor_freq, freq);
+}
+
+void msm_devfreq_floor_put(struct msm_gpu *gpu)
+{
+	struct msm_gpu_devfreq *df = &gpu->devfreq;
+
+	WARN_ON(!mutex_is_locked(&gpu->active_lock));
+
+	if (!has_devfreq(gpu))
+		return;
+
+	if (WARN_ON(!df->floor_submits) || --df->floor_submits)
+		return;
+
+	dev_pm_qos_update_request(&df->floor_freq, 0);
+}
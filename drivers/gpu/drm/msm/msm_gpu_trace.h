@@ -30,6 +30,40 @@ TRACE_EVENT(msm_gpu_submit,
 		    __entry->nr_bos, __entry->nr_cmds)
 );
 
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_QUEUE_LOCK);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_DEPS);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_LOOKUP);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_OBJ_LOCK);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_FENCE_SYNC);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_PIN);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_RELOC);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_ARM);
+TRACE_DEFINE_ENUM(MSM_SUBMIT_STAGE_PUSH);
+
+TRACE_EVENT(msm_gpu_submit_stage,
+	    TP_PROTO(struct msm_gem_submit *submit, enum msm_submit_stage stage),
+	    TP_ARGS(submit, stage),
+	    TP_STRUCT__entry(
+		    __field(u32, id)
+		    __field(u32, stage)
+		    ),
+	    TP_fast_assign(
+		    __entry->id = submit->ident;
+		    __entry->stage = stage;
+		    ),
+	    TP_printk("id=%d stage=%s", __entry->id,
+		    __print_symbolic(__entry->stage,
+			    { MSM_SUBMIT_STAGE_QUEUE_LOCK,	"queue_lock" },
+			    { MSM_SUBMIT_STAGE_DEPS,		"deps" },
+			    { MSM_SUBMIT_STAGE_LOOKUP,		"lookup" },
+			    { MSM_SUBMIT_STAGE_OBJ_LOCK,	"obj_lock" },
+			    { MSM_SUBMIT_STAGE_FENCE_SYNC,	"fence_sync" },
+			    { MSM_SUBMIT_STAGE_PIN,		"pin" },
+			    { MSM_SUBMIT_STAGE_RELOC,		"reloc" },
+			    { MSM_SUBMIT_STAGE_ARM,		"arm" },
+			    { MSM_SUBMIT_STAGE_PUSH,		"push" }))
+);
+
 TRACE_EVENT(msm_gpu_submit_flush,
 	    TP_PROTO(struct msm_gem_submit *submit, u64 ticks),
 	    TP_ARGS(submit, ticks),
@@ -100,6 +134,30 @@ TRACE_EVENT(msm_gpu_freq_change,
 );
 
 
+TRACE_EVENT(msm_gpu_deadline_boost,
+		TP_PROTO(u32 fence, u64 cycles, s64 remaining_ns, u64 needed,
+			 unsigned long freq),
+		TP_ARGS(fence, cycles, remaining_ns, needed, freq),
+		TP_STRUCT__entry(
+			__field(u32, fence)
+			__field(u64, cycles)
+			__field(s64, remaining_us)
+			__field(u32, needed)
+			__field(u32, freq)
+			),
+		TP_fast_assign(
+			__entry->fence = fence;
+			__entry->cycles = cycles;
+			__entry->remaining_us = div_s64(remaining_ns, NSEC_PER_USEC);
+			__entry->needed = DIV_ROUND_UP_ULL(needed, 1000000);
+			__entry->freq = DIV_ROUND_UP(freq, 1000000);
+			),
+		TP_printk("fence=%u cycles=%llu remaining=%lld us needed_mhz=%u mhz=%u",
+			  __entry->fence, __entry->cycles, __entry->remaining_us,
+			  __entry->needed, __entry->freq)
+);
+
+
 TRACE_EVENT(msm_gmu_freq_change,
 		TP_PROTO(u32 freq, u32 perf_index),
 		TP_ARGS(freq, perf_index),
@@ -116,12 +174,14 @@ TRACE_EVENT(msm_gmu_freq_change,
 
 
 TRACE_EVENT(msm_gem_shrink,
-		TP_PROTO(u32 nr_to_scan, u32 purged, u32 evicted,
+		TP_PROTO(u32 nr_to_scan, u32 purged, u32 compressed, u32 evicted,
 			 u32 active_purged, u32 active_evicted),
-		TP_ARGS(nr_to_scan, purged, evicted, active_purged, active_evicted),
+		TP_ARGS(nr_to_scan, purged, compressed, evicted, active_purged,
+			active_evicted),
 		TP_STRUCT__entry(
 			__field(u32, nr_to_scan)
 			__field(u32, purged)
+			__field(u32, compressed)
 			__field(u32, evicted)
 			__field(u32, active_purged)
 			__field(u32, active_evicted)
@@ -129,12 +189,14 @@ TRACE_EVENT(msm_gem_shrink,
 		TP_fast_assign(
 			__entry->nr_to_scan = nr_to_scan;
 			__entry->purged = purged;
+			__entry->compressed = compressed;
 			__entry->evicted = evicted;
 			__entry->active_purged = active_purged;
 			__entry->active_evicted = active_evicted;
 			),
-		TP_printk("nr_to_scan=%u pg, purged=%u pg, evicted=%u pg, active_purged=%u pg, active_evicted=%u pg",
-			  __entry->nr_to_scan, __entry->purged, __entry->evicted,
+		TP_printk("nr_to_scan=%u pg, purged=%u pg, compressed=%u pg, evicted=%u pg, active_purged=%u pg, active_evicted=%u pg",
+			  __entry->nr_to_scan, __entry->purged,
+			  __entry->compressed, __entry->evicted,
 			  __entry->active_purged, __entry->active_evicted)
 );
 
@@ -89,7 +89,7 @@ static size_t calc_pgsize(struct msm_iommu_pagetable *pagetable,
 }
 
 static int msm_iommu_pagetable_unmap(struct msm_mmu *mmu, u64 iova,
-		size_t size)
+		size_t size, struct msm_mmu_gather *gather)
 {
 	struct msm_iommu_pagetable *pagetable = to_pagetable(mmu);
 	struct io_pgtable_ops *ops = pagetable->pgtbl_ops;
@@ -107,13 +107,24 @@ static int msm_iommu_pagetable_unmap(struct msm_mmu *mmu, u64 iova,
 		size -= unmapped;
 	}
 
-	iommu_flush_iotlb_all(to_msm_iommu(pagetable->parent)->domain);
+	/*
+	 * All pagetables share the ASID of the parent domain, so one
+	 * invalidate of the parent covers every unmap in the batch:
+	 */
+	if (gather) {
+		if (gather->mmu != pagetable->parent) {
+			msm_mmu_gather_flush(gather);
+			gather->mmu = pagetable->parent;
+		}
+	} else {
+		iommu_flush_iotlb_all(to_msm_iommu(pagetable->parent)->domain);
+	}
 
 	return (size == 0) ? 0 : -EINVAL;
 }
 
 static int msm_iommu_pagetable_map(struct msm_mmu *mmu, u64 iova,
-		struct sg_table *sgt, size_t len, int prot)
+		struct sg_table *sgt, size_t off, size_t len, int prot)
 {
 	struct msm_iommu_pagetable *pagetable = to_pagetable(mmu);
 	struct io_pgtable_ops *ops = pagetable->pgtbl_ops;
@@ -125,6 +136,20 @@ static int msm_iommu_pagetable_map(struct msm_mmu *mmu, u64 iova,
 		size_t size = sg->length;
 		phys_addr_t phys = sg_phys(sg);
 
+		if (!len)
+			break;
+
+		/* skip to the start of the requested range: */
+		if (off >= size) {
+			off -= size;
+			continue;
+		}
+
+		phys += off;
+		size = min_t(size_t, size - off, len);
+		off = 0;
+		len -= size;
+
 		while (size) {
 			size_t pgsize, count, mapped = 0;
 			int ret;
@@ -142,7 +167,7 @@ static int msm_iommu_pagetable_map(struct msm_mmu *mmu, u64 iova,
 			size -= mapped;
 
 			if (ret) {
-				msm_iommu_pagetable_unmap(mmu, iova, addr - iova);
+				msm_iommu_pagetable_unmap(mmu, iova, addr - iova, NULL);
 				return -EINVAL;
 			}
 		}
@@ -319,6 +344,16 @@ struct msm_mmu *msm_iommu_pagetable_create(struct msm_mmu *parent)
 	return &pagetable->base;
 }
 
+/* Issue the TLB invalidate for a batch of deferred unmaps */
+void msm_mmu_gather_flush(struct msm_mmu_gather *gather)
+{
+	if (!gather->mmu)
+		return;
+
+	iommu_flush_iotlb_all(to_msm_iommu(gather->mmu)->domain);
+	gather->mmu = NULL;
+}
+
 static int msm_fault_handler(struct iommu_domain *domain, struct device *dev,
 		unsigned long iova, int flags, void *arg)
 {
@@ -359,11 +394,15 @@ static void msm_iommu_detach(struct msm_mmu *mmu)
 }
 
 static int msm_iommu_map(struct msm_mmu *mmu, uint64_t iova,
-		struct sg_table *sgt, size_t len, int prot)
+		struct sg_table *sgt, size_t off, size_t len, int prot)
 {
 	struct msm_iommu *iommu = to_msm_iommu(mmu);
 	size_t ret;
 
+	/* Partial mappings are only used with per-process pagetables */
+	if (WARN_ON(off))
+		return -EINVAL;
+
 	/* The arm-smmu driver expects the addresses to be sign extended */
 	if (iova & BIT_ULL(48))
 		iova |= GENMASK_ULL(63, 49);
@@ -374,7 +413,8 @@ static int msm_iommu_map(struct msm_mmu *mmu, uint64_t iova,
 	return (ret == len) ? 0 : -EINVAL;
 }
 
-static int msm_iommu_unmap(struct msm_mmu *mmu, uint64_t iova, size_t len)
+static int msm_iommu_unmap(struct msm_mmu *mmu, uint64_t iova, size_t len,
+		struct msm_mmu_gather *gather)
 {
 	struct msm_iommu *iommu = to_msm_iommu(mmu);
 
@@ -23,7 +23,7 @@
 static const struct drm_mode_config_funcs mode_config_funcs = {
 	.fb_create = msm_framebuffer_create,
 	.atomic_check = msm_atomic_check,
-	.atomic_commit = drm_atomic_helper_commit,
+	.atomic_commit = msm_atomic_commit,
 };
 
 static const struct drm_mode_config_helper_funcs mode_config_helper_funcs = {
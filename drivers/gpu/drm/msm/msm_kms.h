@@ -9,6 +9,7 @@
 #define __MSM_KMS_H__
 
 #include <linux/clk.h>
+#include <linux/ratelimit.h>
 #include <linux/regulator/consumer.h>
 
 #include "msm_drv.h"
@@ -115,6 +116,19 @@ struct msm_kms_funcs {
 
 struct msm_kms;
 
+/* Stages of an atomic commit that are timed, see msm_atomic_latency_show() */
+enum msm_commit_stage {
+	MSM_COMMIT_IOCTL,	/* the atomic commit ioctl itself */
+	MSM_COMMIT_PREPARE_FB,	/* pinning the new framebuffers */
+	MSM_COMMIT_FENCE_WAIT,	/* waiting for rendering to the new fbs */
+	MSM_COMMIT_FLUSH,	/* start of the commit tail to hw flush */
+	MSM_COMMIT_VBLANK,	/* hw flush to the flush completing at vblank */
+	MSM_COMMIT_NR_STAGES,
+};
+
+/* Bucket N counts latencies in [2^(N-1), 2^N) us, the last one the rest */
+#define MSM_COMMIT_HIST_BUCKETS	16
+
 /*
  * A per-crtc timer for pending async atomic flushes.  Scheduled to expire
  * shortly before vblank to flush pending async updates.
@@ -141,6 +155,12 @@ struct msm_kms {
 	struct kthread_worker *dump_worker;
 	struct kthread_work dump_work;
 	struct mutex dump_mutex;
+	struct ratelimit_state dump_rs;
+
+	/* Fault snapshots are captured into this, owned while dump_buf_busy: */
+	void *dump_buf;
+	size_t dump_buf_size;
+	atomic_t dump_buf_busy;
 
 	/*
 	 * For async commit, where ->flush_commit() and later happens
@@ -149,6 +169,9 @@ struct msm_kms {
 	struct mutex commit_lock[MAX_CRTCS];
 	unsigned pending_crtc_mask;
 	struct msm_pending_timer pending_timers[MAX_CRTCS];
+
+	/* Commit latency histograms: */
+	atomic_t commit_hist[MSM_COMMIT_NR_STAGES][MSM_COMMIT_HIST_BUCKETS];
 };
 
 static inline int msm_kms_init(struct msm_kms *kms,
@@ -742,6 +742,24 @@ static struct platform_driver mdss_platform_driver = {
 	},
 };
 
+/*
+ * UBWC settings of @dev if it is an MDSS, for other blocks that have to
+ * agree with the display on the UBWC layout. Unlike msm_mdss_get_mdss_data()
+ * this can be called on any device and never touches the hardware, so it
+ * returns NULL for MDP5 until the display has read the hw revision.
+ */
+const struct msm_mdss_data *msm_mdss_peek_data(struct device *dev)
+{
+	struct msm_mdss *mdss;
+
+	if (!dev || dev->driver != &mdss_platform_driver.driver)
+		return NULL;
+
+	mdss = dev_get_drvdata(dev);
+
+	return mdss ? mdss->mdss_data : NULL;
+}
+
 void __init msm_mdss_register(void)
 {
 	platform_driver_register(&mdss_platform_driver);
@@ -25,4 +25,13 @@ struct msm_mdss_data {
 
 const struct msm_mdss_data *msm_mdss_get_mdss_data(struct device *dev);
 
+#if IS_ENABLED(CONFIG_DRM_MSM_MDSS)
+const struct msm_mdss_data *msm_mdss_peek_data(struct device *dev);
+#else
+static inline const struct msm_mdss_data *msm_mdss_peek_data(struct device *dev)
+{
+	return NULL;
+}
+#endif
+
 #endif /* __MSM_MDSS_H__ */
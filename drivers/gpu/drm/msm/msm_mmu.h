@@ -9,11 +9,21 @@
 
 #include <linux/iommu.h>
 
+/*
+ * A batch of unmaps with a deferred TLB invalidate, see msm_mmu_gather_flush().
+ * Until the batch is flushed the GPU can still hit stale TLB entries, so
+ * the unmapped pages and iova ranges must not be reused before that.
+ */
+struct msm_mmu_gather {
+	struct msm_mmu *mmu;	/* the mmu that has a TLB invalidate pending */
+};
+
 struct msm_mmu_funcs {
 	void (*detach)(struct msm_mmu *mmu);
 	int (*map)(struct msm_mmu *mmu, uint64_t iova, struct sg_table *sgt,
-			size_t len, int prot);
-	int (*unmap)(struct msm_mmu *mmu, uint64_t iova, size_t len);
+			size_t off, size_t len, int prot);
+	int (*unmap)(struct msm_mmu *mmu, uint64_t iova, size_t len,
+			struct msm_mmu_gather *gather);
 	void (*destroy)(struct msm_mmu *mmu);
 	void (*resume_translation)(struct msm_mmu *mmu);
 };
@@ -51,6 +61,7 @@ static inline void msm_mmu_set_fault_handler(struct msm_mmu *mmu, void *arg,
 }
 
 struct msm_mmu *msm_iommu_pagetable_create(struct msm_mmu *parent);
+void msm_mmu_gather_flush(struct msm_mmu_gather *gather);
 
 int msm_iommu_pagetable_params(struct msm_mmu *mmu, phys_addr_t *ttbr,
 		int *asid);
@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-submit performance counter sampling.
+ *
+ * A context reserves hw counters with DRM_IOCTL_MSM_PERFCNTR, each of which
+ * is assigned a slot.  A submit with a MSM_SUBMIT_CMD_PERFCNTR_BUF cmd then
+ * has the kernel program the reserved counters, and write a pair of 64b
+ * start/end samples per slot into that buffer around the submit's IBs:
+ *
+ *   buffer + (slot * 16) + 0: counter value before the first IB
+ *   buffer + (slot * 16) + 8: counter value after the last IB
+ *
+ * Counters are a global resource, so a counter reserved by one context is
+ * not available to others until released, or the context is closed.
+ */
+
+#include <linux/capability.h>
+
+#include "msm_drv.h"
+#include "msm_gem.h"
+#include "msm_gpu.h"
+
+static int perfcntr_reserve(struct msm_gpu *gpu, struct msm_file_private *ctx,
+		struct drm_msm_perfcntr *args)
+{
+	const struct msm_perfcntr_group *group;
+	struct msm_perfcntr *cntr;
+	unsigned slot, idx;
+
+	if (args->group >= gpu->nr_perfcntr_groups)
+		return -EINVAL;
+
+	group = &gpu->perfcntr_groups[args->group];
+
+	if (args->countable >= group->nr_countables)
+		return -EINVAL;
+
+	slot = find_first_zero_bit(&ctx->perfcntr_slots, MSM_PERFCNTR_MAX);
+	if (slot >= MSM_PERFCNTR_MAX)
+		return -ENOSPC;
+
+	idx = ffz(gpu->perfcntr_reserved[args->group]);
+	if (idx >= group->nr_counters)
+		return -EBUSY;
+
+	gpu->perfcntr_reserved[args->group] |= BIT(idx);
+	__set_bit(slot, &ctx->perfcntr_slots);
+
+	cntr = &ctx->perfcntrs[slot];
+	cntr->select_reg = group->select_reg + idx;
+	cntr->counter_reg = group->counter_reg + (idx * 2);
+	cntr->countable = args->countable;
+	cntr->group = args->group;
+	cntr->idx = idx;
+	cntr->slot = slot;
+
+	args->slot = slot;
+
+	return 0;
+}
+
+static int perfcntr_release(struct msm_gpu *gpu, struct msm_file_private *ctx,
+		u32 slot)
+{
+	struct msm_perfcntr *cntr;
+
+	if (slot >= MSM_PERFCNTR_MAX || !test_bit(slot, &ctx->perfcntr_slots))
+		return -EINVAL;
+
+	cntr = &ctx->perfcntrs[slot];
+	gpu->perfcntr_reserved[cntr->group] &= ~BIT(cntr->idx);
+	__clear_bit(slot, &ctx->perfcntr_slots);
+
+	return 0;
+}
+
+int msm_ioctl_perfcntr(struct drm_device *dev, void *data,
+		struct drm_file *file)
+{
+	struct msm_drm_private *priv = dev->dev_private;
+	struct msm_file_private *ctx = file->driver_priv;
+	struct drm_msm_perfcntr *args = data;
+	struct msm_gpu *gpu = priv->gpu;
+	int ret;
+
+	if (!gpu || !gpu->nr_perfcntr_groups)
+		return -ENODEV;
+
+	if (args->pad)
+		return -EINVAL;
+
+	/* Counters see all work on the GPU, not just this context's: */
+	if (!perfmon_capable())
+		return -EPERM;
+
+	mutex_lock(&gpu->perfcntr_lock);
+
+	switch (args->op) {
+	case MSM_PERFCNTR_RESERVE:
+		ret = perfcntr_reserve(gpu, ctx, args);
+		break;
+	case MSM_PERFCNTR_RELEASE:
+		ret = perfcntr_release(gpu, ctx, args->slot);
+		break;
+	default:
+		ret = -EINVAL;
+		break;
+	}
+
+	mutex_unlock(&gpu->perfcntr_lock);
+
+	return ret;
+}
+
+/**
+ * msm_perfcntr_release_all - Release all the counters reserved by a context
+ * @gpu: the gpu
+ * @ctx: the context, which is being closed
+ */
+void msm_perfcntr_release_all(struct msm_gpu *gpu, struct msm_file_private *ctx)
+{
+	unsigned slot;
+
+	if (!ctx->perfcntr_slots)
+		return;
+
+	mutex_lock(&gpu->perfcntr_lock);
+	for_each_set_bit(slot, &ctx->perfcntr_slots, MSM_PERFCNTR_MAX)
+		perfcntr_release(gpu, ctx, slot);
+	mutex_unlock(&gpu->perfcntr_lock);
+}
+
+/**
+ * msm_perfcntr_submit_init - Snapshot the counters to sample for a submit
+ * @submit: the submit, with a MSM_SUBMIT_CMD_PERFCNTR_BUF cmd
+ * @iova: the address the samples are written to
+ * @size: the size of the sample buffer, in bytes
+ *
+ * The counters reserved at the time of the submit ioctl are the ones that
+ * are sampled, regardless of later changes to the context's reservations.
+ */
+int msm_perfcntr_submit_init(struct msm_gem_submit *submit, u64 iova, u32 size)
+{
+	struct msm_file_private *ctx = submit->queue->ctx;
+	struct msm_gpu *gpu = submit->gpu;
+	unsigned slot, n = 0;
+	int ret = 0;
+
+	if (submit->perfcntrs) {
+		SUBMIT_ERROR(submit, "multiple perfcntr buffers\n");
+		return -EINVAL;
+	}
+
+	mutex_lock(&gpu->perfcntr_lock);
+
+	if (!ctx->perfcntr_slots) {
+		SUBMIT_ERROR(submit, "no perfcntrs reserved\n");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (size < (fls_long(ctx->perfcntr_slots) * 16)) {
+		SUBMIT_ERROR(submit, "perfcntr buffer too small: %u\n", size);
+		ret = -EINVAL;
+		goto out;
+	}
+
+	submit->perfcntrs = kcalloc(hweight_long(ctx->perfcntr_slots),
+				    sizeof(*submit->perfcntrs), GFP_KERNEL);
+	if (!submit->perfcntrs) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for_each_set_bit(slot, &ctx->perfcntr_slots, MSM_PERFCNTR_MAX)
+		submit->perfcntrs[n++] = ctx->perfcntrs[slot];
+
+	submit->nr_perfcntrs = n;
+	submit->perfcntr_iova = iova;
+
+out:
+	mutex_unlock(&gpu->perfcntr_lock);
+
+	return ret;
+}
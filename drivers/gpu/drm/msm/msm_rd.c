@@ -27,13 +27,29 @@
  * all (non-written) buffers in the submit, rather than just cmdstream bo's.
  * This is useful to capture the contents of (for example) vbo's or textures,
  * or shader programs (if not emitted inline in cmdstream).
+ *
+ * The rd and hangrd files throttle the submitting process to the rate the
+ * reader consumes the log.  For capturing with less overhead there is also:
+ *
+ *   echo 1 > /sys/kernel/debug/dri/<minor>/rd_relay/enable
+ *
+ * which logs submits into mmap'able per-CPU relay buffers, rd_relay/cpuN,
+ * overwriting the oldest data rather than ever blocking the submitter.
+ * Each record in the relay buffers is a struct rd_relay_chunk followed by
+ * rd sections, and sorting the records from all buffers by (seq, idx) and
+ * concatenating their sections, after the contents of rd_relay/header,
+ * gives a regular rd log.  Writing "<pid> <queue id>" to rd_relay/filter
+ * limits the capture to one process and/or submitqueue (-1 matches any).
+ * Buffer contents are only logged again once they have changed.
  */
 
 #include <linux/circ_buf.h>
 #include <linux/debugfs.h>
 #include <linux/kfifo.h>
+#include <linux/relay.h>
 #include <linux/uaccess.h>
 #include <linux/wait.h>
+#include <linux/xxhash.h>
 
 #include <drm/drm_file.h>
 
@@ -45,6 +61,14 @@ bool rd_full = false;
 MODULE_PARM_DESC(rd_full, "If true, $debugfs/.../rd will snapshot all buffer contents");
 module_param_named(rd_full, rd_full, bool, 0600);
 
+static uint rd_relay_subbuf_size = SZ_256K;
+MODULE_PARM_DESC(rd_relay_subbuf_size, "Size of each rd_relay sub-buffer");
+module_param(rd_relay_subbuf_size, uint, 0600);
+
+static uint rd_relay_nr_subbufs = 8;
+MODULE_PARM_DESC(rd_relay_nr_subbufs, "Number of rd_relay sub-buffers per CPU");
+module_param(rd_relay_nr_subbufs, uint, 0600);
+
 #ifdef CONFIG_DEBUG_FS
 
 enum rd_sect_type {
@@ -78,6 +102,23 @@ enum rd_sect_type {
 #define circ_space_to_end(circ) \
 	(CIRC_SPACE_TO_END((circ)->head, (circ)->tail, BUF_SZ))
 
+#define RD_RELAY_MAGIC 0x72647263  /* "rdrc" */
+
+/* Header of each record in the relay buffers: */
+struct rd_relay_chunk {
+	u32 magic;
+	u32 len;   /* bytes of rd sections following the header */
+	u64 seq;   /* which submit the sections belong to */
+	u32 idx;   /* order of the record within the submit */
+	u32 pad;
+};
+
+struct rd_relay_sect {
+	u32 type;
+	u32 size;
+	const void *buf;
+};
+
 struct msm_rd_state {
 	struct drm_device *dev;
 
@@ -92,6 +133,19 @@ struct msm_rd_state {
 	struct circ_buf fifo;
 
 	char buf[BUF_SZ];
+
+	/*
+	 * For the relay capture, the channel is created and destroyed under
+	 * relay_lock held for write, and submits are logged concurrently
+	 * with it held for read:
+	 */
+	bool relay;
+	struct rw_semaphore relay_lock;
+	struct rchan *chan;
+	struct dentry *dir;
+	atomic64_t seq;
+	u32 gen;           /* incremented each time the capture is enabled */
+	int filter_pid, filter_queue;
 };
 
 static void rd_write(struct msm_rd_state *rd, const void *buf, int sz)
@@ -232,11 +286,216 @@ static const struct file_operations rd_debugfs_fops = {
 };
 
 
+static struct dentry *rd_relay_create_buf_file(const char *filename,
+		struct dentry *parent, umode_t mode, struct rchan_buf *buf,
+		int *is_global)
+{
+	return debugfs_create_file(filename, mode, parent, buf,
+				   &relay_file_operations);
+}
+
+static int rd_relay_remove_buf_file(struct dentry *dentry)
+{
+	debugfs_remove(dentry);
+	return 0;
+}
+
+/* Always move on to the next sub-buffer, overwriting the oldest data: */
+static int rd_relay_subbuf_start(struct rchan_buf *buf, void *subbuf,
+		void *prev_subbuf, size_t prev_padding)
+{
+	return 1;
+}
+
+static const struct rchan_callbacks rd_relay_callbacks = {
+	.subbuf_start = rd_relay_subbuf_start,
+	.create_buf_file = rd_relay_create_buf_file,
+	.remove_buf_file = rd_relay_remove_buf_file,
+};
+
+static int rd_relay_enable(struct msm_rd_state *rd, bool enable)
+{
+	int ret = 0;
+
+	down_write(&rd->relay_lock);
+
+	if (enable && !rd->chan) {
+		rd->chan = relay_open("cpu", rd->dir, rd_relay_subbuf_size,
+				      rd_relay_nr_subbufs, &rd_relay_callbacks,
+				      NULL);
+		if (!rd->chan)
+			ret = -ENOMEM;
+		else
+			rd->gen++;
+	} else if (!enable && rd->chan) {
+		relay_close(rd->chan);
+		rd->chan = NULL;
+	}
+
+	WRITE_ONCE(rd->open, !!rd->chan);
+
+	up_write(&rd->relay_lock);
+
+	return ret;
+}
+
+static ssize_t rd_relay_enable_write(struct file *file,
+		const char __user *ubuf, size_t len, loff_t *offp)
+{
+	struct msm_rd_state *rd = file->private_data;
+	bool enable;
+	int ret;
+
+	ret = kstrtobool_from_user(ubuf, len, &enable);
+	if (ret)
+		return ret;
+
+	ret = rd_relay_enable(rd, enable);
+	if (ret)
+		return ret;
+
+	return len;
+}
+
+static ssize_t rd_relay_enable_read(struct file *file, char __user *ubuf,
+		size_t len, loff_t *offp)
+{
+	struct msm_rd_state *rd = file->private_data;
+	char buf[3];
+
+	buf[0] = READ_ONCE(rd->open) ? 'Y' : 'N';
+	buf[1] = '\n';
+	buf[2] = 0;
+
+	return simple_read_from_buffer(ubuf, len, offp, buf, 2);
+}
+
+static const struct file_operations rd_relay_enable_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.read = rd_relay_enable_read,
+	.write = rd_relay_enable_write,
+	.llseek = default_llseek,
+};
+
+static int rd_relay_filter_show(struct seq_file *m, void *arg)
+{
+	struct msm_rd_state *rd = m->private;
+
+	seq_printf(m, "%d %d\n", READ_ONCE(rd->filter_pid),
+		   READ_ONCE(rd->filter_queue));
+
+	return 0;
+}
+
+static int rd_relay_filter_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, rd_relay_filter_show, inode->i_private);
+}
+
+static ssize_t rd_relay_filter_write(struct file *file,
+		const char __user *ubuf, size_t len, loff_t *offp)
+{
+	struct msm_rd_state *rd = file_inode(file)->i_private;
+	int pid, queue;
+	char buf[32];
+
+	if (len >= sizeof(buf))
+		return -EINVAL;
+
+	if (copy_from_user(buf, ubuf, len))
+		return -EFAULT;
+
+	buf[len] = 0;
+
+	if (sscanf(buf, "%d %d", &pid, &queue) != 2)
+		return -EINVAL;
+
+	WRITE_ONCE(rd->filter_pid, pid);
+	WRITE_ONCE(rd->filter_queue, queue);
+
+	return len;
+}
+
+static const struct file_operations rd_relay_filter_fops = {
+	.owner = THIS_MODULE,
+	.open = rd_relay_filter_open,
+	.read = seq_read,
+	.write = rd_relay_filter_write,
+	.llseek = seq_lseek,
+	.release = single_release,
+};
+
+/* The GPU_ID and CHIP_ID sections which start a rd log: */
+static int rd_relay_header_show(struct seq_file *m, void *arg)
+{
+	struct msm_rd_state *rd = m->private;
+	struct msm_drm_private *priv = rd->dev->dev_private;
+	struct msm_gpu *gpu = priv->gpu;
+	uint32_t type, size, gpu_id;
+	uint32_t zero = 0;
+	uint64_t val;
+
+	if (!gpu)
+		return -ENODEV;
+
+	gpu->funcs->get_param(gpu, NULL, MSM_PARAM_GPU_ID, &val, &zero);
+	gpu_id = val;
+
+	type = RD_GPU_ID;
+	size = sizeof(gpu_id);
+	seq_write(m, &type, 4);
+	seq_write(m, &size, 4);
+	seq_write(m, &gpu_id, size);
+
+	gpu->funcs->get_param(gpu, NULL, MSM_PARAM_CHIP_ID, &val, &zero);
+
+	type = RD_CHIP_ID;
+	size = sizeof(val);
+	seq_write(m, &type, 4);
+	seq_write(m, &size, 4);
+	seq_write(m, &val, size);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rd_relay_header);
+
+static struct msm_rd_state *rd_relay_init(struct drm_minor *minor)
+{
+	struct msm_rd_state *rd;
+
+	rd = kzalloc(sizeof(*rd), GFP_KERNEL);
+	if (!rd)
+		return ERR_PTR(-ENOMEM);
+
+	rd->dev = minor->dev;
+	rd->relay = true;
+	rd->filter_pid = -1;
+	rd->filter_queue = -1;
+
+	mutex_init(&rd->read_lock);
+	mutex_init(&rd->write_lock);
+	init_rwsem(&rd->relay_lock);
+
+	rd->dir = debugfs_create_dir("rd_relay", minor->debugfs_root);
+
+	debugfs_create_file("enable", 0600, rd->dir, rd, &rd_relay_enable_fops);
+	debugfs_create_file("filter", 0600, rd->dir, rd, &rd_relay_filter_fops);
+	debugfs_create_file("header", 0400, rd->dir, rd, &rd_relay_header_fops);
+
+	return rd;
+}
+
 static void rd_cleanup(struct msm_rd_state *rd)
 {
 	if (!rd)
 		return;
 
+	if (rd->relay) {
+		rd_relay_enable(rd, false);
+		debugfs_remove_recursive(rd->dir);
+	}
+
 	mutex_destroy(&rd->read_lock);
 	mutex_destroy(&rd->write_lock);
 	kfree(rd);
@@ -293,6 +552,14 @@ int msm_rd_debugfs_init(struct drm_minor *minor)
 
 	priv->hangrd = rd;
 
+	rd = rd_relay_init(minor);
+	if (IS_ERR(rd)) {
+		ret = PTR_ERR(rd);
+		goto fail;
+	}
+
+	priv->rd_relay = rd;
+
 	return 0;
 
 fail:
@@ -307,6 +574,9 @@ void msm_rd_debugfs_cleanup(struct msm_drm_private *priv)
 
 	rd_cleanup(priv->hangrd);
 	priv->hangrd = NULL;
+
+	rd_cleanup(priv->rd_relay);
+	priv->rd_relay = NULL;
 }
 
 static void snapshot_buf(struct msm_rd_state *rd,
@@ -349,17 +619,213 @@ static void snapshot_buf(struct msm_rd_state *rd,
 	msm_gem_put_vaddr_locked(obj);
 }
 
+/*
+ * Write sections to the relay buffer of the current CPU as one record, so
+ * that they are never split up, or interleaved with those of another
+ * submit.  A record which doesn't fit in a sub-buffer is dropped.
+ */
+static void rd_relay_write(struct msm_rd_state *rd, u64 seq, u32 *idx,
+		const struct rd_relay_sect *sects, int n)
+{
+	struct rd_relay_chunk chunk = {
+		.magic = RD_RELAY_MAGIC,
+		.seq = seq,
+		.idx = (*idx)++,
+	};
+	void *ptr;
+	int i;
+
+	for (i = 0; i < n; i++)
+		chunk.len += 8 + sects[i].size;
+
+	/* relay_reserve() leaves it to us to stay on one CPU's buffer: */
+	preempt_disable();
+
+	ptr = relay_reserve(rd->chan, sizeof(chunk) + chunk.len);
+	if (ptr) {
+		memcpy(ptr, &chunk, sizeof(chunk));
+		ptr += sizeof(chunk);
+
+		for (i = 0; i < n; i++) {
+			memcpy(ptr, &sects[i].type, 4);
+			memcpy(ptr + 4, &sects[i].size, 4);
+			memcpy(ptr + 8, sects[i].buf, sects[i].size);
+			ptr += 8 + sects[i].size;
+		}
+	}
+
+	preempt_enable();
+}
+
+static void rd_relay_write_gpuaddr(struct msm_rd_state *rd, u64 seq, u32 *idx,
+		uint64_t iova, uint32_t size)
+{
+	struct rd_relay_sect sect = {
+		RD_GPUADDR, 12, (uint32_t[3]){ iova, size, iova >> 32 }
+	};
+
+	rd_relay_write(rd, seq, idx, &sect, 1);
+}
+
+static void rd_relay_snapshot_buf(struct msm_rd_state *rd, u64 seq, u32 *idx,
+		struct msm_gem_submit *submit, int bo,
+		uint64_t iova, uint32_t size, bool full)
+{
+	struct drm_gem_object *obj = submit->bos[bo].obj;
+	struct msm_gem_object *msm_obj = to_msm_bo(obj);
+	size_t max = rd->chan->subbuf_size / 4;
+	bool whole = !iova;
+	unsigned offset = 0;
+	const char *buf;
+	u64 hash;
+
+	if (iova) {
+		offset = iova - submit->bos[bo].iova;
+	} else {
+		iova = submit->bos[bo].iova;
+		size = obj->size;
+	}
+
+	if (!full || !(submit->bos[bo].flags & MSM_SUBMIT_BO_READ)) {
+		rd_relay_write_gpuaddr(rd, seq, idx, iova, size);
+		return;
+	}
+
+	buf = msm_gem_get_vaddr_active(obj);
+	if (IS_ERR(buf)) {
+		rd_relay_write_gpuaddr(rd, seq, idx, iova, size);
+		return;
+	}
+
+	buf += offset;
+
+	/*
+	 * Whole buffers are only logged again once their contents change,
+	 * the GPUADDR section alone tells the parser to use the last copy:
+	 */
+	if (whole) {
+		hash = xxh64(buf, size, 0);
+		if (msm_obj->rd_gen == rd->gen && msm_obj->rd_hash == hash) {
+			rd_relay_write_gpuaddr(rd, seq, idx, iova, size);
+			goto out;
+		}
+		msm_obj->rd_gen = rd->gen;
+		msm_obj->rd_hash = hash;
+	}
+
+	/* Split up large buffers so that each piece fits in a sub-buffer: */
+	do {
+		uint32_t n = min_t(size_t, size, max);
+		struct rd_relay_sect sects[] = {
+			{ RD_GPUADDR, 12, (uint32_t[3]){ iova, n, iova >> 32 } },
+			{ RD_BUFFER_CONTENTS, n, buf },
+		};
+
+		rd_relay_write(rd, seq, idx, sects, ARRAY_SIZE(sects));
+
+		iova += n;
+		buf += n;
+		size -= n;
+	} while (size);
+
+out:
+	msm_gem_put_vaddr_locked(obj);
+}
+
+static int rd_describe_submit(struct msm_gem_submit *submit, char *msg,
+		size_t len)
+{
+	struct task_struct *task;
+	int n;
+
+	rcu_read_lock();
+	task = pid_task(submit->pid, PIDTYPE_PID);
+	if (task) {
+		n = scnprintf(msg, len, "%.*s/%d: fence=%u",
+				TASK_COMM_LEN, task->comm,
+				pid_nr(submit->pid), submit->seqno);
+	} else {
+		n = scnprintf(msg, len, "???/%d: fence=%u",
+				pid_nr(submit->pid), submit->seqno);
+	}
+	rcu_read_unlock();
+
+	return n;
+}
+
+static void rd_relay_dump_submit(struct msm_rd_state *rd,
+		struct msm_gem_submit *submit)
+{
+	int filter_pid = READ_ONCE(rd->filter_pid);
+	int filter_queue = READ_ONCE(rd->filter_queue);
+	char msg[256];
+	u32 idx = 0;
+	u64 seq;
+	int i, n;
+
+	if (filter_pid >= 0 && filter_pid != pid_nr(submit->pid))
+		return;
+
+	if (filter_queue >= 0 && filter_queue != submit->queue->id)
+		return;
+
+	down_read(&rd->relay_lock);
+
+	if (!rd->chan)
+		goto out;
+
+	seq = atomic64_inc_return(&rd->seq);
+
+	n = rd_describe_submit(submit, msg, sizeof(msg));
+	rd_relay_write(rd, seq, &idx, &(struct rd_relay_sect){
+			RD_CMD, ALIGN(n, 4), msg }, 1);
+
+	for (i = 0; i < submit->nr_bos; i++)
+		rd_relay_snapshot_buf(rd, seq, &idx, submit, i, 0, 0,
+				      should_dump(submit, i));
+
+	for (i = 0; !submit->vm_bind && i < submit->nr_cmds; i++) {
+		if (!should_dump(submit, i)) {
+			rd_relay_snapshot_buf(rd, seq, &idx, submit,
+					      submit->cmd[i].idx,
+					      submit->cmd[i].iova,
+					      submit->cmd[i].size * 4, true);
+		}
+	}
+
+	for (i = 0; i < submit->nr_cmds; i++) {
+		uint64_t iova = submit->cmd[i].iova;
+		uint32_t szd  = submit->cmd[i].size; /* in dwords */
+
+		switch (submit->cmd[i].type) {
+		case MSM_SUBMIT_CMD_CTX_RESTORE_BUF:
+		case MSM_SUBMIT_CMD_BUF:
+			rd_relay_write(rd, seq, &idx, &(struct rd_relay_sect){
+					RD_CMDSTREAM_ADDR, 12,
+					(uint32_t[3]){ iova, szd, iova >> 32 } }, 1);
+			break;
+		}
+	}
+
+out:
+	up_read(&rd->relay_lock);
+}
+
 /* called under gpu->lock */
 void msm_rd_dump_submit(struct msm_rd_state *rd, struct msm_gem_submit *submit,
 		const char *fmt, ...)
 {
-	struct task_struct *task;
 	char msg[256];
 	int i, n;
 
-	if (!rd->open)
+	if (!READ_ONCE(rd->open))
 		return;
 
+	if (rd->relay) {
+		rd_relay_dump_submit(rd, submit);
+		return;
+	}
+
 	mutex_lock(&rd->write_lock);
 
 	if (fmt) {
@@ -372,24 +838,13 @@ void msm_rd_dump_submit(struct msm_rd_state *rd, struct msm_gem_submit *submit,
 		rd_write_section(rd, RD_CMD, msg, ALIGN(n, 4));
 	}
 
-	rcu_read_lock();
-	task = pid_task(submit->pid, PIDTYPE_PID);
-	if (task) {
-		n = scnprintf(msg, sizeof(msg), "%.*s/%d: fence=%u",
-				TASK_COMM_LEN, task->comm,
-				pid_nr(submit->pid), submit->seqno);
-	} else {
-		n = scnprintf(msg, sizeof(msg), "???/%d: fence=%u",
-				pid_nr(submit->pid), submit->seqno);
-	}
-	rcu_read_unlock();
-
+	n = rd_describe_submit(submit, msg, sizeof(msg));
 	rd_write_section(rd, RD_CMD, msg, ALIGN(n, 4));
 
 	for (i = 0; i < submit->nr_bos; i++)
 		snapshot_buf(rd, submit, i, 0, 0, should_dump(submit, i));
 
-	for (i = 0; i < submit->nr_cmds; i++) {
+	for (i = 0; !submit->vm_bind && i < submit->nr_cmds; i++) {
 		uint32_t szd  = submit->cmd[i].size; /* in dwords */
 
 		/* snapshot cmdstream bo's (if we haven't already): */
@@ -23,7 +23,7 @@ static struct dma_fence *msm_job_run(struct drm_sched_job *job)
 
 	mutex_lock(&priv->lru.lock);
 
-	for (i = 0; i < submit->nr_bos; i++) {
+	for (i = 0; submit->bos_pinned && i < submit->nr_bos; i++) {
 		struct drm_gem_object *obj = submit->bos[i].obj;
 
 		msm_gem_unpin_active(obj);
@@ -36,13 +36,32 @@ static struct dma_fence *msm_job_run(struct drm_sched_job *job)
 	/* TODO move submit path over to using a per-ring lock.. */
 	mutex_lock(&gpu->lock);
 
+	submit->ring->defer_flush = !!gpu->funcs->flush;
 	msm_gpu_submit(gpu, submit);
+	submit->ring->defer_flush = false;
 
 	mutex_unlock(&gpu->lock);
 
 	return dma_fence_get(submit->hw_fence);
 }
 
+static void msm_job_flush(struct drm_gpu_scheduler *sched)
+{
+	struct msm_ringbuffer *ring = container_of(sched, struct msm_ringbuffer, sched);
+	struct msm_gpu *gpu = ring->gpu;
+
+	if (!gpu->funcs->flush)
+		return;
+
+	mutex_lock(&gpu->lock);
+	pm_runtime_get_sync(&gpu->pdev->dev);
+
+	gpu->funcs->flush(gpu, ring);
+
+	pm_runtime_put(&gpu->pdev->dev);
+	mutex_unlock(&gpu->lock);
+}
+
 static void msm_job_free(struct drm_sched_job *job)
 {
 	struct msm_gem_submit *submit = to_msm_submit(job);
@@ -53,6 +72,7 @@ static void msm_job_free(struct drm_sched_job *job)
 
 static const struct drm_sched_backend_ops msm_sched_ops = {
 	.run_job = msm_job_run,
+	.flush_jobs = msm_job_flush,
 	.free_job = msm_job_free
 };
 
@@ -71,6 +71,15 @@ struct msm_ringbuffer {
 	uint64_t memptrs_iova;
 	struct msm_fence_context *fctx;
 
+	/**
+	 * cur_ctx_seqno:
+	 *
+	 * The ctx->seqno value of the last context to submit to this ring.
+	 * With preemption each ring keeps running with its own pagetable, so
+	 * this is what decides whether a pagetable switch is needed.
+	 */
+	int cur_ctx_seqno;
+
 	/**
 	 * hangcheck_progress_retries:
 	 *
@@ -99,6 +108,15 @@ struct msm_ringbuffer {
 	 * preemption.  Can be aquired from irq context.
 	 */
 	spinlock_t preempt_lock;
+
+	/**
+	 * defer_flush:
+	 *
+	 * Set by msm_job_run() while the scheduler is batching jobs, so the
+	 * backend only writes the commands and the wptr update is done once
+	 * for the batch by msm_job_flush().  Protected by gpu->lock.
+	 */
+	bool defer_flush;
 };
 
 struct msm_ringbuffer *msm_ringbuffer_new(struct msm_gpu *gpu, int id,
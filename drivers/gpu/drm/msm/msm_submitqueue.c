@@ -5,6 +5,7 @@
 #include <linux/kref.h>
 #include <linux/uaccess.h>
 
+#include "msm_gem.h"
 #include "msm_gpu.h"
 
 int msm_file_private_set_sysprof(struct msm_file_private *ctx,
@@ -73,6 +74,9 @@ void msm_submitqueue_destroy(struct kref *kref)
 
 	idr_destroy(&queue->fence_idr);
 
+	if (queue->bo)
+		msm_gem_kernel_put(queue->bo, queue->ctx->aspace);
+
 	msm_file_private_put(queue->ctx);
 
 	kfree(queue);
@@ -101,6 +105,30 @@ struct msm_gpu_submitqueue *msm_submitqueue_get(struct msm_file_private *ctx,
 	return NULL;
 }
 
+/* Wait for all of the queue's submits to complete */
+static void msm_submitqueue_wait_idle(struct msm_gpu_submitqueue *queue)
+{
+	struct dma_fence *entry, *fence;
+	int id = 0;
+
+	do {
+		fence = NULL;
+
+		spin_lock(&queue->idr_lock);
+		entry = idr_get_next(&queue->fence_idr, &id);
+		if (entry)
+			fence = dma_fence_get_rcu(entry);
+		spin_unlock(&queue->idr_lock);
+
+		if (fence) {
+			dma_fence_wait(fence, false);
+			dma_fence_put(fence);
+		}
+
+		id++;
+	} while (entry);
+}
+
 void msm_submitqueue_close(struct msm_file_private *ctx)
 {
 	struct msm_gpu_submitqueue *entry, *tmp;
@@ -114,6 +142,14 @@ void msm_submitqueue_close(struct msm_file_private *ctx)
 	 */
 	list_for_each_entry_safe(entry, tmp, &ctx->submitqueues, node) {
 		list_del(&entry->node);
+
+		/*
+		 * With VM_BIND, the context's mappings are torn down after
+		 * this, so the GPU must be done with them first:
+		 */
+		if (ctx->vm_bind)
+			msm_submitqueue_wait_idle(entry);
+
 		msm_submitqueue_put(entry);
 	}
 }
@@ -182,6 +218,7 @@ int msm_submitqueue_create(struct drm_device *drm, struct msm_file_private *ctx,
 	kref_init(&queue->ref);
 	queue->flags = flags;
 	queue->ring_nr = ring_nr;
+	queue->ctx = ctx;
 
 	queue->entity = get_sched_entity(ctx, priv->gpu->rb[ring_nr],
 					 ring_nr, sched_prio);
@@ -191,6 +228,14 @@ int msm_submitqueue_create(struct drm_device *drm, struct msm_file_private *ctx,
 		return ret;
 	}
 
+	if (priv->gpu->funcs->submitqueue_setup) {
+		ret = priv->gpu->funcs->submitqueue_setup(priv->gpu, queue);
+		if (ret) {
+			kfree(queue);
+			return ret;
+		}
+	}
+
 	write_lock(&ctx->queuelock);
 
 	queue->ctx = msm_file_private_get(ctx);
@@ -471,6 +471,54 @@ drm_sched_job_dependency(struct drm_sched_job *job,
 	return NULL;
 }
 
+/**
+ * drm_sched_entity_account_busy - report the GPU time used by a job
+ *
+ * @entity: scheduler entity the job was queued on
+ * @busy_ns: time the hardware spent executing the job, in nanoseconds
+ *
+ * Drivers which can timestamp jobs on the GPU itself call this as jobs
+ * retire.  Once an entity has had time reported, the fair policy charges it
+ * with the reported time instead of estimating it from when jobs were picked
+ * and when their fences signalled, which over-charges entities whose jobs
+ * queue behind others in the ring.
+ */
+void drm_sched_entity_account_busy(struct drm_sched_entity *entity, u64 busy_ns)
+{
+	atomic64_add(busy_ns, &entity->busy_ns);
+	WRITE_ONCE(entity->busy_reported, true);
+}
+EXPORT_SYMBOL(drm_sched_entity_account_busy);
+
+/*
+ * Charge the entity for the time since its previous job was picked, up to the
+ * completion of that job if it is already done.  This is the time the entity
+ * has been occupying the GPU, which the fair policy orders entities by.
+ */
+static void drm_sched_entity_charge(struct drm_sched_entity *entity)
+{
+	struct dma_fence *prev;
+	ktime_t now = ktime_get();
+	ktime_t end = now;
+
+	if (READ_ONCE(entity->busy_reported)) {
+		entity->vruntime = ktime_add_ns(entity->vruntime,
+						atomic64_xchg(&entity->busy_ns, 0));
+		entity->last_run = now;
+		return;
+	}
+
+	prev = rcu_dereference_check(entity->last_scheduled, true);
+	if (prev && dma_fence_is_signaled(prev))
+		end = dma_fence_timestamp(prev);
+
+	if (prev && ktime_after(end, entity->last_run))
+		entity->vruntime = ktime_add(entity->vruntime,
+					     ktime_sub(end, entity->last_run));
+
+	entity->last_run = now;
+}
+
 struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 {
 	struct drm_sched_job *sched_job;
@@ -491,6 +539,9 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 	if (entity->guilty && atomic_read(entity->guilty))
 		dma_fence_set_error(&sched_job->s_fence->finished, -ECANCELED);
 
+	if (drm_sched_policy == DRM_SCHED_POLICY_FAIR)
+		drm_sched_entity_charge(entity);
+
 	dma_fence_put(rcu_dereference_check(entity->last_scheduled, true));
 	rcu_assign_pointer(entity->last_scheduled,
 			   dma_fence_get(&sched_job->s_fence->finished));
@@ -508,11 +559,13 @@ struct drm_sched_job *drm_sched_entity_pop_job(struct drm_sched_entity *entity)
 	 * Update the entity's location in the min heap according to
 	 * the timestamp of the next job, if any.
 	 */
-	if (drm_sched_policy == DRM_SCHED_POLICY_FIFO) {
+	if (drm_sched_policy != DRM_SCHED_POLICY_RR) {
 		struct drm_sched_job *next;
 
 		next = to_drm_sched_job(spsc_queue_peek(&entity->job_queue));
-		if (next)
+		if (next && drm_sched_policy == DRM_SCHED_POLICY_FAIR)
+			drm_sched_rq_update_fair(entity, false);
+		else if (next)
 			drm_sched_rq_update_fifo(entity, next->submit_ts);
 	}
 
@@ -611,6 +664,8 @@ void drm_sched_entity_push_job(struct drm_sched_job *sched_job)
 
 		if (drm_sched_policy == DRM_SCHED_POLICY_FIFO)
 			drm_sched_rq_update_fifo(entity, submit_ts);
+		else if (drm_sched_policy == DRM_SCHED_POLICY_FAIR)
+			drm_sched_rq_update_fair(entity, true);
 
 		drm_sched_wakeup(entity->rq->sched, entity);
 	}
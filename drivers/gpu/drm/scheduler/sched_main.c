@@ -96,9 +96,19 @@ int drm_sched_policy = DRM_SCHED_POLICY_FIFO;
  * DOC: sched_policy (int)
  * Used to override default entities scheduling policy in a run queue.
  */
-MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default).");
+MODULE_PARM_DESC(sched_policy, "Specify the scheduling policy for entities on a run-queue, " __stringify(DRM_SCHED_POLICY_RR) " = Round Robin, " __stringify(DRM_SCHED_POLICY_FIFO) " = FIFO (default), " __stringify(DRM_SCHED_POLICY_FAIR) " = Fair share of GPU time.");
 module_param_named(sched_policy, drm_sched_policy, int, 0444);
 
+static unsigned int drm_sched_batch_max = 8;
+
+/**
+ * DOC: batch_max (uint)
+ * Upper bound on the number of jobs from one entity handed to a backend
+ * with a &drm_sched_backend_ops.flush_jobs callback per run work item.
+ */
+MODULE_PARM_DESC(batch_max, "Maximum number of jobs from one entity run before flushing to the hardware (default 8).");
+module_param_named(batch_max, drm_sched_batch_max, uint, 0644);
+
 static u32 drm_sched_available_credits(struct drm_gpu_scheduler *sched)
 {
 	u32 credits;
@@ -184,6 +194,51 @@ void drm_sched_rq_update_fifo(struct drm_sched_entity *entity, ktime_t ts)
 	spin_unlock(&entity->rq_lock);
 }
 
+/**
+ * drm_sched_rq_update_fair - reposition an entity under the fair policy
+ *
+ * @entity: scheduler entity
+ * @wakeup: the entity has just gone from idle to having jobs queued
+ *
+ * Under the fair policy the run queue is ordered by the GPU time each entity
+ * has been charged, rather than by the age of its oldest job, so that an
+ * entity which keeps the GPU busy yields to one that submits occasionally.
+ * An entity waking up is placed no earlier than the most-served ready
+ * entity would be, so time spent idle can't be saved up and spent later
+ * as a burst which starves everyone else.
+ */
+void drm_sched_rq_update_fair(struct drm_sched_entity *entity, bool wakeup)
+{
+	struct drm_sched_rq *rq;
+	struct rb_node *rb;
+
+	spin_lock(&entity->rq_lock);
+	rq = entity->rq;
+	spin_lock(&rq->lock);
+
+	drm_sched_rq_remove_fifo_locked(entity);
+
+	for (rb = rb_first_cached(&rq->rb_tree_root); wakeup && rb; rb = rb_next(rb)) {
+		struct drm_sched_entity *other;
+
+		other = rb_entry(rb, struct drm_sched_entity, rb_tree_node);
+		if (!drm_sched_entity_is_ready(other))
+			continue;
+
+		if (ktime_before(entity->vruntime, other->oldest_job_waiting))
+			entity->vruntime = other->oldest_job_waiting;
+		break;
+	}
+
+	entity->oldest_job_waiting = entity->vruntime;
+
+	rb_add_cached(&entity->rb_tree_node, &rq->rb_tree_root,
+		      drm_sched_entity_compare_before);
+
+	spin_unlock(&rq->lock);
+	spin_unlock(&entity->rq_lock);
+}
+
 /**
  * drm_sched_rq_init - initialize a given run queue struct
  *
@@ -246,7 +301,7 @@ void drm_sched_rq_remove_entity(struct drm_sched_rq *rq,
 	if (rq->current_entity == entity)
 		rq->current_entity = NULL;
 
-	if (drm_sched_policy == DRM_SCHED_POLICY_FIFO)
+	if (drm_sched_policy != DRM_SCHED_POLICY_RR)
 		drm_sched_rq_remove_fifo_locked(entity);
 
 	spin_unlock(&rq->lock);
@@ -1053,7 +1108,7 @@ drm_sched_select_entity(struct drm_gpu_scheduler *sched)
 	/* Start with the highest priority.
 	 */
 	for (i = DRM_SCHED_PRIORITY_KERNEL; i < sched->num_rqs; i++) {
-		entity = drm_sched_policy == DRM_SCHED_POLICY_FIFO ?
+		entity = drm_sched_policy != DRM_SCHED_POLICY_RR ?
 			drm_sched_rq_select_entity_fifo(sched, sched->sched_rq[i]) :
 			drm_sched_rq_select_entity_rr(sched, sched->sched_rq[i]);
 		if (entity)
@@ -1166,6 +1221,47 @@ static void drm_sched_free_job_work(struct work_struct *w)
 	drm_sched_run_job_queue(sched);
 }
 
+/**
+ * drm_sched_run_one_job - hand a popped job to the backend
+ *
+ * @sched: scheduler instance
+ * @entity: entity the job was popped from
+ * @sched_job: job to run
+ *
+ * Accounts the job's credits, calls run_job and arms the completion of
+ * the job on the returned hardware fence.
+ */
+static void drm_sched_run_one_job(struct drm_gpu_scheduler *sched,
+				  struct drm_sched_entity *entity,
+				  struct drm_sched_job *sched_job)
+{
+	struct drm_sched_fence *s_fence = sched_job->s_fence;
+	struct dma_fence *fence;
+	int r;
+
+	atomic_add(sched_job->credits, &sched->credit_count);
+	drm_sched_job_begin(sched_job);
+
+	trace_drm_run_job(sched_job, entity);
+	fence = sched->ops->run_job(sched_job);
+	drm_sched_fence_scheduled(s_fence, fence);
+
+	if (!IS_ERR_OR_NULL(fence)) {
+		/* Drop for original kref_init of the fence */
+		dma_fence_put(fence);
+
+		r = dma_fence_add_callback(fence, &sched_job->cb,
+					   drm_sched_job_done_cb);
+		if (r == -ENOENT)
+			drm_sched_job_done(sched_job, fence->error);
+		else if (r)
+			DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n", r);
+	} else {
+		drm_sched_job_done(sched_job, IS_ERR(fence) ?
+				   PTR_ERR(fence) : 0);
+	}
+}
+
 /**
  * drm_sched_run_job_work - worker to call run_job
  *
@@ -1176,10 +1272,8 @@ static void drm_sched_run_job_work(struct work_struct *w)
 	struct drm_gpu_scheduler *sched =
 		container_of(w, struct drm_gpu_scheduler, work_run_job);
 	struct drm_sched_entity *entity;
-	struct dma_fence *fence;
-	struct drm_sched_fence *s_fence;
 	struct drm_sched_job *sched_job;
-	int r;
+	unsigned int batch = 1;
 
 	if (READ_ONCE(sched->pause_submit))
 		return;
@@ -1196,31 +1290,32 @@ static void drm_sched_run_job_work(struct work_struct *w)
 		return;
 	}
 
-	s_fence = sched_job->s_fence;
+	drm_sched_run_one_job(sched, entity, sched_job);
 
-	atomic_add(sched_job->credits, &sched->credit_count);
-	drm_sched_job_begin(sched_job);
-
-	trace_drm_run_job(sched_job, entity);
-	fence = sched->ops->run_job(sched_job);
-	complete_all(&entity->entity_idle);
-	drm_sched_fence_scheduled(s_fence, fence);
+	/*
+	 * Backends with a flush_jobs callback only kick the hardware from
+	 * there, so keep feeding them ready jobs from the same entity while
+	 * credits allow and kick once for the whole batch. entity_idle stays
+	 * pending until then, which keeps drm_sched_entity_kill() away.
+	 */
+	if (sched->ops->flush_jobs) {
+		while (batch < READ_ONCE(drm_sched_batch_max) &&
+		       !READ_ONCE(sched->pause_submit) &&
+		       !READ_ONCE(entity->stopped) &&
+		       drm_sched_can_queue(sched, entity)) {
+			sched_job = drm_sched_entity_pop_job(entity);
+			if (!sched_job)
+				break;
 
-	if (!IS_ERR_OR_NULL(fence)) {
-		/* Drop for original kref_init of the fence */
-		dma_fence_put(fence);
+			drm_sched_run_one_job(sched, entity, sched_job);
+			batch++;
+		}
 
-		r = dma_fence_add_callback(fence, &sched_job->cb,
-					   drm_sched_job_done_cb);
-		if (r == -ENOENT)
-			drm_sched_job_done(sched_job, fence->error);
-		else if (r)
-			DRM_DEV_ERROR(sched->dev, "fence add callback failed (%d)\n", r);
-	} else {
-		drm_sched_job_done(sched_job, IS_ERR(fence) ?
-				   PTR_ERR(fence) : 0);
+		sched->ops->flush_jobs(sched);
 	}
 
+	complete_all(&entity->entity_idle);
+
 	wake_up(&sched->job_scheduled);
 	drm_sched_run_job_queue(sched);
 }
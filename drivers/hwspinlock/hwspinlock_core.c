@@ -9,6 +9,7 @@
 
 #define pr_fmt(fmt)    "%s: " fmt, __func__
 
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
@@ -16,6 +17,8 @@
 #include <linux/types.h>
 #include <linux/err.h>
 #include <linux/jiffies.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
 #include <linux/radix-tree.h>
 #include <linux/hwspinlock.h>
 #include <linux/pm_runtime.h>
@@ -27,6 +30,14 @@
 /* retry delay used in atomic context */
 #define HWSPINLOCK_RETRY_DELAY_US	100
 
+/*
+ * Upper bound of the exponential backoff between attempts outside of atomic
+ * context, when the platform has no relax handler. Keeps the interconnect
+ * quiet while a remote processor holds the lock without adding much latency
+ * once it lets go.
+ */
+#define HWSPINLOCK_BACKOFF_MAX_US	10
+
 /* radix tree tags */
 #define HWSPINLOCK_UNUSED	(0) /* tags an hwspinlock as unused */
 
@@ -179,7 +190,9 @@ EXPORT_SYMBOL_GPL(__hwspin_trylock);
  *
  * This function locks the given @hwlock. If the @hwlock
  * is already taken, the function will busy loop waiting for it to
- * be released, but give up after @timeout msecs have elapsed.
+ * be released, but give up after @timeout msecs have elapsed. The delay
+ * between attempts backs off exponentially, unless the platform provides
+ * its own relax handler.
  *
  * Caution: If the mode is HWLOCK_RAW, that means user must protect the routine
  * of getting hardware lock with mutex or spinlock. Since in some scenarios,
@@ -211,6 +224,8 @@ int __hwspin_lock_timeout(struct hwspinlock *hwlock, unsigned int to,
 {
 	int ret;
 	unsigned long expire, atomic_delay = 0;
+	unsigned int delay = 1;
+	ktime_t start = 0;
 
 	expire = msecs_to_jiffies(to) + jiffies;
 
@@ -220,18 +235,21 @@ int __hwspin_lock_timeout(struct hwspinlock *hwlock, unsigned int to,
 		if (ret != -EBUSY)
 			break;
 
+		if (!start)
+			start = ktime_get();
+
 		/*
 		 * The lock is already taken, let's check if the user wants
 		 * us to try again
 		 */
 		if (mode == HWLOCK_IN_ATOMIC) {
-			udelay(HWSPINLOCK_RETRY_DELAY_US);
-			atomic_delay += HWSPINLOCK_RETRY_DELAY_US;
+			udelay(delay);
+			atomic_delay += delay;
 			if (atomic_delay > to * 1000)
-				return -ETIMEDOUT;
+				goto timeout;
 		} else {
 			if (time_is_before_eq_jiffies(expire))
-				return -ETIMEDOUT;
+				goto timeout;
 		}
 
 		/*
@@ -240,9 +258,32 @@ int __hwspin_lock_timeout(struct hwspinlock *hwlock, unsigned int to,
 		 */
 		if (hwlock->bank->ops->relax)
 			hwlock->bank->ops->relax(hwlock);
+		else if (mode != HWLOCK_IN_ATOMIC)
+			udelay(min_t(unsigned int, delay,
+				     HWSPINLOCK_BACKOFF_MAX_US));
+
+		delay = min_t(unsigned int, delay * 2, HWSPINLOCK_RETRY_DELAY_US);
+	}
+
+	/* We own the lock, so nobody else is updating the stats */
+	if (!ret) {
+		struct hwspinlock_stats *stats = &hwlock->stats;
+
+		stats->acquired++;
+		if (start) {
+			u64 us = ktime_us_delta(ktime_get(), start);
+
+			stats->contended++;
+			stats->spin_hist[min_t(unsigned int, us ? ilog2(us) + 1 : 0,
+					       HWSPINLOCK_HIST_BUCKETS - 1)]++;
+		}
 	}
 
 	return ret;
+
+timeout:
+	atomic_inc(&hwlock->stats.timeouts);
+	return -ETIMEDOUT;
 }
 EXPORT_SYMBOL_GPL(__hwspin_lock_timeout);
 
@@ -982,5 +1023,48 @@ struct hwspinlock *devm_hwspin_lock_request_specific(struct device *dev,
 }
 EXPORT_SYMBOL_GPL(devm_hwspin_lock_request_specific);
 
+#ifdef CONFIG_DEBUG_FS
+static int hwspinlock_stats_show(struct seq_file *s, void *unused)
+{
+	struct radix_tree_iter iter;
+	struct hwspinlock *hwlock;
+	void __rcu **slot;
+	int i;
+
+	seq_puts(s, "id acquired contended timeouts spin_us_log2_hist\n");
+
+	mutex_lock(&hwspinlock_tree_lock);
+	radix_tree_for_each_slot(slot, &hwspinlock_tree, &iter, 0) {
+		hwlock = radix_tree_deref_slot_protected(slot,
+							 &hwspinlock_tree_lock);
+		if (!hwlock)
+			continue;
+
+		seq_printf(s, "%d %llu %llu %d", hwlock_to_id(hwlock),
+			   READ_ONCE(hwlock->stats.acquired),
+			   READ_ONCE(hwlock->stats.contended),
+			   atomic_read(&hwlock->stats.timeouts));
+		for (i = 0; i < HWSPINLOCK_HIST_BUCKETS; i++)
+			seq_printf(s, " %llu",
+				   READ_ONCE(hwlock->stats.spin_hist[i]));
+		seq_putc(s, '\n');
+	}
+	mutex_unlock(&hwspinlock_tree_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hwspinlock_stats);
+
+static int __init hwspinlock_debugfs_init(void)
+{
+	struct dentry *dir = debugfs_create_dir("hwspinlock", NULL);
+
+	debugfs_create_file("stats", 0400, dir, NULL, &hwspinlock_stats_fops);
+
+	return 0;
+}
+late_initcall(hwspinlock_debugfs_init);
+#endif
+
 MODULE_DESCRIPTION("Hardware spinlock interface");
 MODULE_AUTHOR("Ohad Ben-Cohen <ohad@wizery.com>");
@@ -34,15 +34,36 @@ struct hwspinlock_ops {
 	void (*relax)(struct hwspinlock *lock);
 };
 
+#define HWSPINLOCK_HIST_BUCKETS	16
+
+/**
+ * struct hwspinlock_stats - contention statistics kept by the hwspinlock core
+ * @acquired: number of locks taken through __hwspin_lock_timeout()
+ * @contended: how many of those did not succeed on the first attempt
+ * @timeouts: number of __hwspin_lock_timeout() calls which gave up
+ * @spin_hist: log2 histogram of the time spent spinning by contended
+ *	       acquisitions, bucket n counts spins shorter than 2^n usecs
+ *
+ * Everything but @timeouts is only written while holding the lock.
+ */
+struct hwspinlock_stats {
+	u64 acquired;
+	u64 contended;
+	atomic_t timeouts;
+	u64 spin_hist[HWSPINLOCK_HIST_BUCKETS];
+};
+
 /**
  * struct hwspinlock - this struct represents a single hwspinlock instance
  * @bank: the hwspinlock_device structure which owns this lock
  * @lock: initialized and used by hwspinlock core
+ * @stats: contention statistics, maintained by hwspinlock core
  * @priv: private data, owned by the underlying platform-specific hwspinlock drv
  */
 struct hwspinlock {
 	struct hwspinlock_device *bank;
 	spinlock_t lock;
+	struct hwspinlock_stats stats;
 	void *priv;
 };
 
@@ -8,7 +8,10 @@
 #include <linux/delay.h>
 #include <linux/err.h>
 #include <linux/iio/adc/qcom-vadc-common.h>
+#include <linux/iio/buffer.h>
 #include <linux/iio/iio.h>
+#include <linux/iio/trigger_consumer.h>
+#include <linux/iio/triggered_buffer.h>
 #include <linux/interrupt.h>
 #include <linux/kernel.h>
 #include <linux/log2.h>
@@ -141,6 +144,9 @@ struct adc5_channel_prop {
  * @complete: ADC result notification after interrupt is received.
  * @lock: ADC lock for access to the peripheral.
  * @data: software configuration data.
+ * @do_conv: conversion routine for this ADC generation.
+ * @scan_buf: processed results of one buffered scan, followed by the
+ *	timestamp.
  */
 struct adc5_chip {
 	struct regmap		*regmap;
@@ -153,6 +159,11 @@ struct adc5_chip {
 	struct completion	complete;
 	struct mutex		lock;
 	const struct adc5_data	*data;
+	int			(*do_conv)(struct adc5_chip *adc,
+					   struct adc5_channel_prop *prop,
+					   struct iio_chan_spec const *chan,
+					   u16 *data_volt, u16 *data_cur);
+	s32			*scan_buf;
 };
 
 static int adc5_read(struct adc5_chip *adc, u16 offset, u8 *data, int len)
@@ -489,6 +500,47 @@ static const struct iio_info adc7_info = {
 	.fwnode_xlate = adc7_fwnode_xlate,
 };
 
+/*
+ * The PMIC ADC has no channel sequencer, so a scan still converts the
+ * enabled channels one after another. Doing it here under a single
+ * trigger saves userspace a sysfs round trip per channel and keeps the
+ * samples of one scan close together in time.
+ */
+static irqreturn_t adc5_trigger_handler(int irq, void *p)
+{
+	struct iio_poll_func *pf = p;
+	struct iio_dev *indio_dev = pf->indio_dev;
+	struct adc5_chip *adc = iio_priv(indio_dev);
+	struct adc5_channel_prop *prop;
+	u16 adc_code_volt, adc_code_cur;
+	unsigned int i = 0;
+	int bit, ret, val;
+
+	for_each_set_bit(bit, indio_dev->active_scan_mask,
+			 indio_dev->masklength) {
+		prop = &adc->chan_props[bit];
+
+		ret = adc->do_conv(adc, prop, &adc->iio_chans[bit],
+				   &adc_code_volt, &adc_code_cur);
+		if (ret)
+			goto done;
+
+		ret = qcom_adc5_hw_scale(prop->scale_fn_type, prop->prescale,
+					 adc->data, adc_code_volt, &val);
+		if (ret)
+			goto done;
+
+		adc->scan_buf[i++] = val;
+	}
+
+	iio_push_to_buffers_with_timestamp(indio_dev, adc->scan_buf,
+					   iio_get_time_ns(indio_dev));
+done:
+	iio_trigger_notify_done(indio_dev->trig);
+
+	return IRQ_HANDLED;
+}
+
 struct adc5_channels {
 	const char *datasheet_name;
 	unsigned int prescale_index;
@@ -834,11 +886,19 @@ static int adc5_get_fw_data(struct adc5_chip *adc)
 	if (!adc->nchannels)
 		return -EINVAL;
 
-	adc->iio_chans = devm_kcalloc(adc->dev, adc->nchannels,
+	/* One extra slot for the soft timestamp channel */
+	adc->iio_chans = devm_kcalloc(adc->dev, adc->nchannels + 1,
 				       sizeof(*adc->iio_chans), GFP_KERNEL);
 	if (!adc->iio_chans)
 		return -ENOMEM;
 
+	adc->scan_buf = devm_kzalloc(adc->dev,
+				     ALIGN(adc->nchannels * sizeof(s32),
+					   sizeof(s64)) + sizeof(s64),
+				     GFP_KERNEL);
+	if (!adc->scan_buf)
+		return -ENOMEM;
+
 	adc->chan_props = devm_kcalloc(adc->dev, adc->nchannels,
 					sizeof(*adc->chan_props), GFP_KERNEL);
 	if (!adc->chan_props)
@@ -866,11 +926,18 @@ static int adc5_get_fw_data(struct adc5_chip *adc)
 		iio_chan->info_mask_separate = adc_chan->info_mask;
 		iio_chan->type = adc_chan->type;
 		iio_chan->address = index;
+		iio_chan->scan_index = index;
+		iio_chan->scan_type.sign = 's';
+		iio_chan->scan_type.realbits = 32;
+		iio_chan->scan_type.storagebits = 32;
+		iio_chan->scan_type.endianness = IIO_CPU;
 		iio_chan++;
 		chan_props++;
 		index++;
 	}
 
+	*iio_chan = (struct iio_chan_spec)IIO_CHAN_SOFT_TIMESTAMP(index);
+
 	return 0;
 }
 
@@ -923,7 +990,17 @@ static int adc5_probe(struct platform_device *pdev)
 	indio_dev->modes = INDIO_DIRECT_MODE;
 	indio_dev->info = adc->data->info;
 	indio_dev->channels = adc->iio_chans;
-	indio_dev->num_channels = adc->nchannels;
+	indio_dev->num_channels = adc->nchannels + 1;
+
+	if (adc->data->info == &adc7_info)
+		adc->do_conv = adc7_do_conversion;
+	else
+		adc->do_conv = adc5_do_conversion;
+
+	ret = devm_iio_triggered_buffer_setup(dev, indio_dev, NULL,
+					      adc5_trigger_handler, NULL);
+	if (ret)
+		return ret;
 
 	return devm_iio_device_register(dev, indio_dev);
 }
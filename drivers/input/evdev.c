@@ -37,6 +37,27 @@ struct evdev {
 	bool exist;
 };
 
+/*
+ * Shared header of the event ring a client gets by mmap()ing its evdev
+ * file. The events follow at offset PAGE_SIZE as an array of mask + 1
+ * struct input_event. head and tail are free running indices: the kernel
+ * publishes head (with release semantics) after each complete packet, the
+ * consumer advances tail once it is done with the events before it.
+ * While a ring is mapped events are only queued there and read() fails
+ * with -EBUSY; poll() keeps working. Once the last mapping goes away the
+ * ring is dropped and read() takes over again.
+ *
+ * Published events can't be taken back, so unlike the read() queue the
+ * ring is not flushed by EVIOCG*: the state returned already accounts for
+ * every event up to the head read before the ioctl.
+ */
+struct evdev_ring {
+	__u32 head;
+	__u32 tail;
+	__u32 mask;
+	__u32 dropped;	/* events lost because the ring was full */
+};
+
 struct evdev_client {
 	unsigned int head;
 	unsigned int tail;
@@ -48,6 +69,11 @@ struct evdev_client {
 	struct list_head node;
 	enum input_clock_type clk_type;
 	bool revoked;
+	struct evdev_ring *ring; /* mmap()ed event ring, protected by buffer_lock */
+	unsigned int ring_maps; /* mappings of ring, protected by buffer_lock */
+	unsigned int ring_head; /* next slot to fill */
+	unsigned int ring_packet; /* ring_head as of the last published packet */
+	bool ring_dropped; /* discarding until a SYN_DROPPED fits */
 	unsigned long *evmasks[EV_CNT];
 	unsigned int bufsize;
 	struct input_event buffer[] __counted_by(bufsize);
@@ -140,12 +166,48 @@ static void __evdev_flush_queue(struct evdev_client *client, unsigned int type)
 	client->head = head;
 }
 
+/* caller must hold client->buffer_lock */
+static void __evdev_ring_queue_syn_dropped(struct evdev_client *client)
+{
+	ktime_t *ev_time = input_get_timestamp(client->evdev->handle.dev);
+	struct timespec64 ts = ktime_to_timespec64(ev_time[client->clk_type]);
+	struct evdev_ring *ring = client->ring;
+	struct input_event *events = (void *)ring + PAGE_SIZE;
+	unsigned int mask = client->bufsize - 1;
+
+	/* The partial packet goes along with whatever was lost */
+	ring->dropped += client->ring_head - client->ring_packet;
+	client->ring_head = client->ring_packet;
+
+	if (client->ring_head - READ_ONCE(ring->tail) > mask) {
+		/* __pass_event_ring() sends it once there is room */
+		client->ring_dropped = true;
+		return;
+	}
+
+	events[client->ring_head++ & mask] = (struct input_event) {
+		.input_event_sec = ts.tv_sec,
+		.input_event_usec = ts.tv_nsec / NSEC_PER_USEC,
+		.type = EV_SYN,
+		.code = SYN_DROPPED,
+		.value = 0,
+	};
+	client->ring_dropped = false;
+	client->ring_packet = client->ring_head;
+	smp_store_release(&ring->head, client->ring_head);
+}
+
 static void __evdev_queue_syn_dropped(struct evdev_client *client)
 {
 	ktime_t *ev_time = input_get_timestamp(client->evdev->handle.dev);
 	struct timespec64 ts = ktime_to_timespec64(ev_time[client->clk_type]);
 	struct input_event ev;
 
+	if (client->ring) {
+		__evdev_ring_queue_syn_dropped(client);
+		return;
+	}
+
 	ev.input_event_sec = ts.tv_sec;
 	ev.input_event_usec = ts.tv_nsec / NSEC_PER_USEC;
 	ev.type = EV_SYN;
@@ -200,7 +262,11 @@ static int evdev_set_clk_type(struct evdev_client *client, unsigned int clkid)
 		 */
 		spin_lock_irqsave(&client->buffer_lock, flags);
 
-		if (client->head != client->tail) {
+		if (client->ring) {
+			/* Published events can't be flushed, only flagged */
+			if (client->ring_head != READ_ONCE(client->ring->tail))
+				__evdev_ring_queue_syn_dropped(client);
+		} else if (client->head != client->tail) {
 			client->packet_head = client->head = client->tail;
 			__evdev_queue_syn_dropped(client);
 		}
@@ -241,6 +307,56 @@ static void __pass_event(struct evdev_client *client,
 	}
 }
 
+static void __pass_event_ring(struct evdev_client *client,
+			      const struct input_event *event)
+{
+	struct evdev_ring *ring = client->ring;
+	struct input_event *events = (void *)ring + PAGE_SIZE;
+	unsigned int mask = client->bufsize - 1;
+	bool is_report = event->type == EV_SYN && event->code == SYN_REPORT;
+	/* The consumer owns tail, never trust it beyond "how full" */
+	unsigned int used = client->ring_head - READ_ONCE(ring->tail);
+
+	if (unlikely(client->ring_dropped)) {
+		if (!is_report || used > mask) {
+			ring->dropped++;
+			return;
+		}
+
+		events[client->ring_head++ & mask] = (struct input_event) {
+			.input_event_sec = event->input_event_sec,
+			.input_event_usec = event->input_event_usec,
+			.type = EV_SYN,
+			.code = SYN_DROPPED,
+			.value = 0,
+		};
+		client->ring_dropped = false;
+	} else if (unlikely(used > mask)) {
+		/* Throw away the partial packet, the consumer never saw it */
+		ring->dropped += client->ring_head - client->ring_packet + 1;
+		client->ring_head = client->ring_packet;
+		client->ring_dropped = true;
+		return;
+	} else {
+		events[client->ring_head++ & mask] = *event;
+		if (!is_report)
+			return;
+	}
+
+	client->ring_packet = client->ring_head;
+	smp_store_release(&ring->head, client->ring_head);
+	kill_fasync(&client->fasync, SIGIO, POLL_IN);
+}
+
+static bool evdev_packet_empty(struct evdev_client *client)
+{
+	if (client->ring)
+		return !client->ring_dropped &&
+		       client->ring_head == client->ring_packet;
+
+	return client->packet_head == client->head;
+}
+
 static void evdev_pass_values(struct evdev_client *client,
 			const struct input_value *vals, unsigned int count,
 			ktime_t *ev_time)
@@ -266,7 +382,7 @@ static void evdev_pass_values(struct evdev_client *client,
 
 		if (v->type == EV_SYN && v->code == SYN_REPORT) {
 			/* drop empty SYN_REPORT */
-			if (client->packet_head == client->head)
+			if (evdev_packet_empty(client))
 				continue;
 
 			wakeup = true;
@@ -275,7 +391,10 @@ static void evdev_pass_values(struct evdev_client *client,
 		event.type = v->type;
 		event.code = v->code;
 		event.value = v->value;
-		__pass_event(client, &event);
+		if (client->ring)
+			__pass_event_ring(client, &event);
+		else
+			__pass_event(client, &event);
 	}
 
 	spin_unlock(&client->buffer_lock);
@@ -442,6 +561,7 @@ static int evdev_release(struct inode *inode, struct file *file)
 	for (i = 0; i < EV_CNT; ++i)
 		bitmap_free(client->evmasks[i]);
 
+	vfree(client->ring);
 	kvfree(client);
 
 	evdev_close_device(evdev);
@@ -562,6 +682,10 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		if (!evdev->exist || client->revoked)
 			return -ENODEV;
 
+		/* Events go to the mmap()ed ring instead */
+		if (READ_ONCE(client->ring))
+			return -EBUSY;
+
 		if (client->packet_head == client->tail &&
 		    (file->f_flags & O_NONBLOCK))
 			return -EAGAIN;
@@ -602,6 +726,7 @@ static __poll_t evdev_poll(struct file *file, poll_table *wait)
 {
 	struct evdev_client *client = file->private_data;
 	struct evdev *evdev = client->evdev;
+	struct evdev_ring *ring;
 	__poll_t mask;
 
 	poll_wait(file, &client->wait, wait);
@@ -611,12 +736,117 @@ static __poll_t evdev_poll(struct file *file, poll_table *wait)
 	else
 		mask = EPOLLHUP | EPOLLERR;
 
-	if (client->packet_head != client->tail)
+	/* The ring goes away with its last mapping */
+	spin_lock_irq(&client->buffer_lock);
+	ring = client->ring;
+	if (ring ? READ_ONCE(ring->head) != READ_ONCE(ring->tail) :
+		   client->packet_head != client->tail)
 		mask |= EPOLLIN | EPOLLRDNORM;
+	spin_unlock_irq(&client->buffer_lock);
 
 	return mask;
 }
 
+static void evdev_ring_vm_open(struct vm_area_struct *vma)
+{
+	struct evdev_client *client = vma->vm_private_data;
+
+	spin_lock_irq(&client->buffer_lock);
+	client->ring_maps++;
+	spin_unlock_irq(&client->buffer_lock);
+}
+
+/* Drop a mapping of the ring, and the ring along with the last one */
+static void evdev_ring_put(struct evdev_client *client)
+{
+	struct evdev_ring *ring = NULL;
+
+	spin_lock_irq(&client->buffer_lock);
+	if (!--client->ring_maps) {
+		ring = client->ring;
+		client->ring = NULL;
+		/* Let read() know about whatever was left in the ring */
+		if (client->ring_head != READ_ONCE(ring->tail) ||
+		    client->ring_dropped)
+			__evdev_queue_syn_dropped(client);
+	}
+	spin_unlock_irq(&client->buffer_lock);
+
+	vfree(ring);
+}
+
+static void evdev_ring_vm_close(struct vm_area_struct *vma)
+{
+	evdev_ring_put(vma->vm_private_data);
+}
+
+/* The ring is mapped as a whole or not at all */
+static int evdev_ring_vm_may_split(struct vm_area_struct *vma,
+				   unsigned long addr)
+{
+	return -EINVAL;
+}
+
+static const struct vm_operations_struct evdev_ring_vm_ops = {
+	.open		= evdev_ring_vm_open,
+	.close		= evdev_ring_vm_close,
+	.may_split	= evdev_ring_vm_may_split,
+};
+
+static int evdev_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct evdev_client *client = file->private_data;
+	struct evdev *evdev = client->evdev;
+	size_t size = PAGE_SIZE +
+		PAGE_ALIGN(client->bufsize * sizeof(struct input_event));
+	struct evdev_ring *ring, *new;
+	int retval;
+
+	/* The ring holds native struct input_event only */
+	if (in_compat_syscall() && !COMPAT_USE_64BIT_TIME)
+		return -EINVAL;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != size)
+		return -EINVAL;
+
+	/*
+	 * This runs under mmap_lock, which the ioctls fault on while holding
+	 * evdev->mutex, so only buffer_lock is taken here.
+	 */
+	if (!evdev->exist || client->revoked)
+		return -ENODEV;
+
+	new = vmalloc_user(size);
+	if (!new)
+		return -ENOMEM;
+	new->mask = client->bufsize - 1;
+
+	spin_lock_irq(&client->buffer_lock);
+	ring = client->ring;
+	if (!ring) {
+		/* Whatever was queued for read() is not reachable any more */
+		client->packet_head = client->head = client->tail;
+		client->ring_head = client->ring_packet = 0;
+		client->ring_dropped = false;
+		client->ring = ring = new;
+		new = NULL;
+	}
+	client->ring_maps++;
+	spin_unlock_irq(&client->buffer_lock);
+
+	vfree(new);
+
+	retval = remap_vmalloc_range(vma, ring, 0);
+	if (retval) {
+		evdev_ring_put(client);
+		return retval;
+	}
+
+	vma->vm_private_data = client;
+	vma->vm_ops = &evdev_ring_vm_ops;
+	return 0;
+}
+
 #ifdef CONFIG_COMPAT
 
 #define BITS_PER_LONG_COMPAT (sizeof(compat_long_t) * 8)
@@ -1285,6 +1515,7 @@ static const struct file_operations evdev_fops = {
 	.read		= evdev_read,
 	.write		= evdev_write,
 	.poll		= evdev_poll,
+	.mmap		= evdev_mmap,
 	.open		= evdev_open,
 	.release	= evdev_release,
 	.unlocked_ioctl	= evdev_ioctl,
@@ -87,6 +87,7 @@ struct nt36xxx_ts {
 	struct gpio_desc *reset_gpio;
 	struct gpio_desc *irq_gpio;
 	int irq;
+	ktime_t irq_ts; /* hard irq time of the report being read */
 	struct device *dev;
 
 	struct mutex lock;
@@ -430,12 +431,23 @@ static void nt36xxx_report(struct nt36xxx_ts *ts)
 
 	input_mt_sync_frame(input);
 
+	input_set_timestamp(input, ts->irq_ts);
 	input_sync(input);
 
 xfer_error:
 	return;
 }
 
+static irqreturn_t nt36xxx_irq_hardirq(int irq, void *dev_id)
+{
+	struct nt36xxx_ts *ts = dev_id;
+
+	/* Stamp events with the interrupt time, not the end of the spi read */
+	ts->irq_ts = ktime_get();
+
+	return IRQ_WAKE_THREAD;
+}
+
 static irqreturn_t nt36xxx_irq_handler(int irq, void *dev_id)
 {
 	struct nt36xxx_ts *ts = dev_id;
@@ -1099,7 +1111,8 @@ int nt36xxx_probe(struct device *dev, int irq, const struct input_id *id,
 	}
 
 	/* Request threaded IRQ for touch screen interrupts */
-	ret = devm_request_threaded_irq(dev, ts->irq, NULL, nt36xxx_irq_handler,
+	ret = devm_request_threaded_irq(dev, ts->irq, nt36xxx_irq_hardirq,
+			 nt36xxx_irq_handler,
 			 IRQ_TYPE_EDGE_RISING | IRQF_ONESHOT, dev_name(dev), ts);
 	if (ret) {
 			dev_err(dev, "request irq failed: %d\n", ret);
@@ -25,6 +25,17 @@
 
 #define DEBUG 0
 
+/* Reads up to this size (a full touch report) go out as a single message */
+#define NT36XXX_SPI_RX_LEN	128
+
+struct nt36xxx_spi {
+	struct spi_device *spi;
+
+	/* DMA safe buffers for the single message read path */
+	u8 tx[4] ____cacheline_aligned;
+	u8 rx[NT36XXX_SPI_RX_LEN] ____cacheline_aligned;
+};
+
 /*
  * there are two kinds of spi read/write:
  * 	(a)spi_read()/spi_write()/spi_write_then_read(),
@@ -39,10 +50,12 @@
  *	0xZ2 is bit[7..0] | 0x80, addr for write ops
  * there is no restriction on the read write order.
 */
-static int nt36xxx_spi_write(void *dev, const void *data,
+static int nt36xxx_spi_write(void *context, const void *data,
                                    size_t len)
 {
-	struct spi_device *spi = to_spi_device((struct device *)dev);
+	struct nt36xxx_spi *nts = context;
+	struct spi_device *spi = nts->spi;
+	struct device *dev = &spi->dev;
 	int32_t ret;
 
 	u8 addr[4] = { 0xff, *(u32 *)data >> 15, *(u32 *)data >> 7,  (*(u32 *)data & 0x7f) | 0x80};
@@ -67,14 +80,58 @@ static int nt36xxx_spi_write(void *dev, const void *data,
 	return ret;
 }
 
-static int nt36xxx_spi_read(void *dev, const void *reg_buf,
+/*
+ * Short reads, which is every touch report, are done as one spi message: the
+ * page select in its own chip select cycle followed by the address and the
+ * data. That is a single GENI/GPI transaction instead of three.
+ */
+static int nt36xxx_spi_read_msg(struct nt36xxx_spi *nts, u32 reg,
+				void *val_buf, size_t val_size)
+{
+	struct spi_transfer xfers[3] = { };
+	struct spi_message msg;
+	int ret;
+
+	nts->tx[0] = 0xff;
+	nts->tx[1] = reg >> 15;
+	nts->tx[2] = reg >> 7;
+	nts->tx[3] = reg & 0x7f;
+
+	xfers[0].tx_buf = nts->tx;
+	xfers[0].len = 3;
+	xfers[0].cs_change = 1;
+	xfers[1].tx_buf = &nts->tx[3];
+	xfers[1].len = 1;
+	xfers[2].rx_buf = nts->rx;
+	xfers[2].len = val_size;
+
+	spi_message_init_with_transfers(&msg, xfers, ARRAY_SIZE(xfers));
+
+	ret = spi_sync(nts->spi, &msg);
+	if (ret) {
+		dev_err(&nts->spi->dev, "transfer err %s ret=%d", __func__, ret);
+		return ret;
+	}
+
+	memcpy(val_buf, nts->rx, val_size);
+
+	return 0;
+}
+
+static int nt36xxx_spi_read(void *context, const void *reg_buf,
                                   size_t reg_size, void *val_buf,
                                   size_t val_size)
 {
-	struct spi_device *spi = to_spi_device(dev);
+	struct nt36xxx_spi *nts = context;
+	struct spi_device *spi = nts->spi;
+	struct device *dev = &spi->dev;
 	int ret;
 	u8 addr[4] = { 0xff, *(u32 *)reg_buf >> 15, *(u32 *)reg_buf >> 7,  *(u32 *)reg_buf & 0x7f };
 
+	if (val_size <= NT36XXX_SPI_RX_LEN)
+		return nt36xxx_spi_read_msg(nts, *(u32 *)reg_buf, val_buf,
+					    val_size);
+
 	ret = spi_write(spi, addr, 3);
 	if (ret) {
 		dev_err(dev, "transfer0 err %s %d ret=%d", __func__, __LINE__, ret);
@@ -122,6 +179,7 @@ static const struct input_id nt36xxx_spi_input_id = {
 static int nt36xxx_spi_probe(struct spi_device *spi)
 {
 	struct regmap_config *regmap_config;
+	struct nt36xxx_spi *nts;
 	struct regmap *regmap;
 	size_t max_size;
 	int ret = 0;
@@ -137,6 +195,11 @@ static int nt36xxx_spi_probe(struct spi_device *spi)
 		return -ENOMEM;
 	}
 
+	nts = devm_kzalloc(&spi->dev, sizeof(*nts), GFP_KERNEL);
+	if (!nts)
+		return -ENOMEM;
+	nts->spi = spi;
+
 	/* Set SPI mode and bits per word, and perform SPI setup */
 	spi->mode = SPI_MODE_0;
 	spi->bits_per_word = 8;
@@ -158,7 +221,7 @@ static int nt36xxx_spi_probe(struct spi_device *spi)
 	regmap_config->max_raw_write = max_size - SPI_WRITE_PREFIX_LEN;
 
 	/* Initialize the regmap using the provided configuration */
-	regmap = devm_regmap_init(&spi->dev, NULL, spi, regmap_config);
+	regmap = devm_regmap_init(&spi->dev, NULL, nts, regmap_config);
 	if (IS_ERR(regmap))
 		return PTR_ERR(regmap);
 
@@ -4,6 +4,8 @@
 #include <linux/device.h>
 #include <linux/export.h>
 
+#include "internal.h"
+
 /**
  * of_icc_bulk_get() - get interconnect paths
  * @dev: the device requesting the path
@@ -57,22 +59,14 @@ EXPORT_SYMBOL_GPL(icc_bulk_put);
  * @num_paths: the number of icc_bulk_data
  * @paths: the icc_bulk_data table containing the paths and bandwidth
  *
+ * All paths are updated as one batch, without votes from other consumers in
+ * between. If a path fails, the paths before it keep their new bandwidth.
+ *
  * Returns 0 on success or negative errno otherwise.
  */
 int icc_bulk_set_bw(int num_paths, const struct icc_bulk_data *paths)
 {
-	int ret = 0;
-	int i;
-
-	for (i = 0; i < num_paths; i++) {
-		ret = icc_set_bw(paths[i].path, paths[i].avg_bw, paths[i].peak_bw);
-		if (ret) {
-			pr_err("icc_set_bw() failed on path %s (%d)\n", paths[i].name, ret);
-			return ret;
-		}
-	}
-
-	return ret;
+	return icc_set_bw_batch(num_paths, paths);
 }
 EXPORT_SYMBOL_GPL(icc_bulk_set_bw);
 
@@ -651,6 +651,7 @@ void icc_set_tag(struct icc_path *path, u32 tag)
 
 	for (i = 0; i < path->num_nodes; i++)
 		path->reqs[i].tag = tag;
+	path->committed = false;
 
 	mutex_unlock(&icc_lock);
 }
@@ -674,39 +675,32 @@ const char *icc_get_name(struct icc_path *path)
 }
 EXPORT_SYMBOL_GPL(icc_get_name);
 
-/**
- * icc_set_bw() - set bandwidth constraints on an interconnect path
- * @path: interconnect path
- * @avg_bw: average bandwidth in kilobytes per second
- * @peak_bw: peak bandwidth in kilobytes per second
- *
- * This function is used by an interconnect consumer to express its own needs
- * in terms of bandwidth for a previously requested path between two endpoints.
- * The requests are aggregated and each node is updated accordingly. The entire
- * path is locked by a mutex to ensure that the set() is completed.
- * The @path can be NULL when the "interconnects" DT properties is missing,
- * which will mean that no constraints will be set.
- *
- * Returns 0 on success, or an appropriate error code otherwise.
- */
-int icc_set_bw(struct icc_path *path, u32 avg_bw, u32 peak_bw)
+static int __icc_set_bw(struct icc_path *path, u32 avg_bw, u32 peak_bw)
 {
 	struct icc_node *node;
 	u32 old_avg, old_peak;
 	size_t i;
 	int ret;
 
+	lockdep_assert_held(&icc_bw_lock);
+
 	if (!path)
 		return 0;
 
 	if (WARN_ON(IS_ERR(path) || !path->num_nodes))
 		return -EINVAL;
 
-	mutex_lock(&icc_bw_lock);
-
 	old_avg = path->reqs[0].avg_bw;
 	old_peak = path->reqs[0].peak_bw;
 
+	/*
+	 * Consumers often repeat the same vote. If it is already aggregated
+	 * and applied, walking the path and calling every provider again
+	 * cannot change anything, so skip it.
+	 */
+	if (path->committed && old_avg == avg_bw && old_peak == peak_bw)
+		return 0;
+
 	for (i = 0; i < path->num_nodes; i++) {
 		node = path->reqs[i].node;
 
@@ -733,15 +727,70 @@ int icc_set_bw(struct icc_path *path, u32 avg_bw, u32 peak_bw)
 		}
 		apply_constraints(path);
 	}
-
-	mutex_unlock(&icc_bw_lock);
+	path->committed = !ret;
 
 	trace_icc_set_bw_end(path, ret);
 
 	return ret;
 }
+
+/**
+ * icc_set_bw() - set bandwidth constraints on an interconnect path
+ * @path: interconnect path
+ * @avg_bw: average bandwidth in kilobytes per second
+ * @peak_bw: peak bandwidth in kilobytes per second
+ *
+ * This function is used by an interconnect consumer to express its own needs
+ * in terms of bandwidth for a previously requested path between two endpoints.
+ * The requests are aggregated and each node is updated accordingly. The entire
+ * path is locked by a mutex to ensure that the set() is completed.
+ * The @path can be NULL when the "interconnects" DT properties is missing,
+ * which will mean that no constraints will be set.
+ *
+ * Returns 0 on success, or an appropriate error code otherwise.
+ */
+int icc_set_bw(struct icc_path *path, u32 avg_bw, u32 peak_bw)
+{
+	int ret;
+
+	if (!path)
+		return 0;
+
+	mutex_lock(&icc_bw_lock);
+	ret = __icc_set_bw(path, avg_bw, peak_bw);
+	mutex_unlock(&icc_bw_lock);
+
+	return ret;
+}
 EXPORT_SYMBOL_GPL(icc_set_bw);
 
+/*
+ * Update a set of paths under a single hold of icc_bw_lock, so that other
+ * consumers cannot interleave their votes with the set and the lock is
+ * only contended once per bulk request.
+ */
+int icc_set_bw_batch(int num_paths, const struct icc_bulk_data *paths)
+{
+	int ret = 0;
+	int i;
+
+	mutex_lock(&icc_bw_lock);
+
+	for (i = 0; i < num_paths; i++) {
+		ret = __icc_set_bw(paths[i].path, paths[i].avg_bw,
+				   paths[i].peak_bw);
+		if (ret) {
+			pr_err("icc_set_bw() failed on path %s (%d)\n",
+			       paths[i].name, ret);
+			break;
+		}
+	}
+
+	mutex_unlock(&icc_bw_lock);
+
+	return ret;
+}
+
 static int __icc_enable(struct icc_path *path, bool enable)
 {
 	int i;
@@ -756,6 +805,7 @@ static int __icc_enable(struct icc_path *path, bool enable)
 
 	for (i = 0; i < path->num_nodes; i++)
 		path->reqs[i].enabled = enable;
+	path->committed = false;
 
 	mutex_unlock(&icc_lock);
 
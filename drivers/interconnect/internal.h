@@ -33,15 +33,18 @@ struct icc_req {
  * struct icc_path - interconnect path structure
  * @name: a string name of the path (useful for ftrace)
  * @num_nodes: number of hops (nodes)
+ * @committed: the requests in @reqs have been aggregated and applied
  * @reqs: array of the requests applicable to this path of nodes
  */
 struct icc_path {
 	const char *name;
 	size_t num_nodes;
+	bool committed;
 	struct icc_req reqs[] __counted_by(num_nodes);
 };
 
 struct icc_path *icc_get(struct device *dev, const char *src, const char *dst);
+int icc_set_bw_batch(int num_paths, const struct icc_bulk_data *paths);
 int icc_debugfs_client_init(struct dentry *icc_dir);
 
 #endif
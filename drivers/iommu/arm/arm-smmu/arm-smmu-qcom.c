@@ -6,10 +6,12 @@
 #include <linux/acpi.h>
 #include <linux/adreno-smmu-priv.h>
 #include <linux/delay.h>
+#include <linux/moduleparam.h>
 #include <linux/of_device.h>
 #include <linux/firmware/qcom/qcom_scm.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/slab.h>
 
 #include "arm-smmu.h"
 #include "arm-smmu-qcom.h"
@@ -218,6 +220,13 @@ static int qcom_adreno_smmu_init_context(struct arm_smmu_domain *smmu_domain,
 	if (!qcom_adreno_smmu_is_gpu_device(dev))
 		return 0;
 
+	/*
+	 * GPU buffers are unmapped in large bursts, batch their leaf TLB
+	 * invalidations per gather.
+	 */
+	if (smmu_domain->stage == ARM_SMMU_DOMAIN_S1)
+		smmu_domain->cfg.gather_leaf_inv = true;
+
 	/*
 	 * All targets that use the qcom,adreno-smmu compatible string *should*
 	 * be AARCH64 stage 1 but double check because the arm-smmu code assumes
@@ -373,12 +382,45 @@ static void qcom_smmu_write_s2cr(struct arm_smmu_device *smmu, int idx)
 	arm_smmu_gr0_write(smmu, ARM_SMMU_GR0_S2CR(idx), reg);
 }
 
+static char *identity_compatibles;
+module_param(identity_compatibles, charp, 0444);
+MODULE_PARM_DESC(identity_compatibles,
+	"Semicolon-separated list of client compatibles that default to an identity domain");
+
+static bool qcom_smmu_client_forced_identity(struct device *dev)
+{
+	char *list, *cur, *compat;
+	bool found = false;
+
+	if (!identity_compatibles || !dev->of_node)
+		return false;
+
+	list = kstrdup(identity_compatibles, GFP_KERNEL);
+	if (!list)
+		return false;
+
+	cur = list;
+	while ((compat = strsep(&cur, ";"))) {
+		if (*compat && of_device_is_compatible(dev->of_node, compat)) {
+			found = true;
+			break;
+		}
+	}
+
+	kfree(list);
+
+	return found;
+}
+
 static int qcom_smmu_def_domain_type(struct device *dev)
 {
 	const struct of_device_id *match =
 		of_match_device(qcom_smmu_client_of_match, dev);
 
-	return match ? IOMMU_DOMAIN_IDENTITY : 0;
+	if (match || qcom_smmu_client_forced_identity(dev))
+		return IOMMU_DOMAIN_IDENTITY;
+
+	return 0;
 }
 
 static int qcom_sdm845_smmu500_reset(struct arm_smmu_device *smmu)
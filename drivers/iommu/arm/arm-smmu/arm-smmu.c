@@ -341,6 +341,18 @@ static void arm_smmu_tlb_add_page_s1(struct iommu_iotlb_gather *gather,
 				     unsigned long iova, size_t granule,
 				     void *cookie)
 {
+	struct arm_smmu_domain *smmu_domain = cookie;
+
+	/*
+	 * Only record the page, the whole gathered range is invalidated at
+	 * once from arm_smmu_iotlb_sync().
+	 */
+	if (smmu_domain->cfg.gather_leaf_inv && gather) {
+		iommu_iotlb_gather_add_page(&smmu_domain->domain, gather,
+					    iova, granule);
+		return;
+	}
+
 	arm_smmu_tlb_inv_range_s1(iova, granule, granule, cookie,
 				  ARM_SMMU_CB_S1_TLBIVAL);
 }
@@ -1310,8 +1322,19 @@ static void arm_smmu_iotlb_sync(struct iommu_domain *domain,
 		return;
 
 	arm_smmu_rpm_get(smmu);
-	if (smmu->version == ARM_SMMU_V2 ||
-	    smmu_domain->stage == ARM_SMMU_DOMAIN_S1)
+	if (smmu_domain->cfg.gather_leaf_inv && gather->pgsize) {
+		size_t size = gather->end - gather->start + 1;
+
+		if (size > TLB_GATHER_ASID_THRESHOLD) {
+			arm_smmu_tlb_inv_context_s1(smmu_domain);
+		} else {
+			arm_smmu_tlb_inv_range_s1(gather->start, size,
+						  gather->pgsize, smmu_domain,
+						  ARM_SMMU_CB_S1_TLBIVAL);
+			arm_smmu_tlb_sync_context(smmu_domain);
+		}
+	} else if (smmu->version == ARM_SMMU_V2 ||
+		   smmu_domain->stage == ARM_SMMU_DOMAIN_S1)
 		arm_smmu_tlb_sync_context(smmu_domain);
 	else
 		arm_smmu_tlb_sync_global(smmu);
@@ -21,6 +21,7 @@
 #include <linux/irqreturn.h>
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
+#include <linux/sizes.h>
 #include <linux/types.h>
 
 /* Configuration registers */
@@ -255,6 +256,12 @@ enum arm_smmu_cbar_type {
 #define TLB_LOOP_TIMEOUT		1000000	/* 1s! */
 #define TLB_SPIN_COUNT			10
 
+/*
+ * Gathered stage-1 leaf invalidations larger than this are done with a
+ * single TLBIASID instead of one TLBIVAL per granule.
+ */
+#define TLB_GATHER_ASID_THRESHOLD	SZ_2M
+
 /* Shared driver definitions */
 enum arm_smmu_arch_version {
 	ARM_SMMU_V1,
@@ -357,6 +364,7 @@ struct arm_smmu_cfg {
 	enum arm_smmu_cbar_type		cbar;
 	enum arm_smmu_context_fmt	fmt;
 	bool				flush_walk_prefer_tlbiasid;
+	bool				gather_leaf_inv;
 };
 #define ARM_SMMU_INVALID_IRPTNDX	0xff
 
@@ -73,16 +73,20 @@ static irqreturn_t qcom_ipcc_irq_fn(int irq, void *data)
 {
 	struct qcom_ipcc *ipcc = data;
 	u32 hwirq;
-	int virq;
 
+	/*
+	 * Every read of RECV_ID pops the next pending signal, so drain them
+	 * all in this pass rather than taking the summary irq again for each.
+	 */
 	for (;;) {
 		hwirq = readl(ipcc->base + IPCC_REG_RECV_ID);
 		if (hwirq == IPCC_NO_PENDING_IRQ)
 			break;
 
-		virq = irq_find_mapping(ipcc->irq_domain, hwirq);
 		writel(hwirq, ipcc->base + IPCC_REG_RECV_SIGNAL_CLEAR);
-		generic_handle_irq(virq);
+		if (generic_handle_domain_irq(ipcc->irq_domain, hwirq))
+			dev_err_ratelimited(ipcc->dev,
+					    "no mapping for signal %#x\n", hwirq);
 	}
 
 	return IRQ_HANDLED;
@@ -14,6 +14,7 @@
 
 #include "camss-csid.h"
 #include "camss-csid-gen2.h"
+#include "camss-trace.h"
 #include "camss.h"
 
 /* The CSID 2 IP-block is different from the others,
@@ -179,22 +180,31 @@
 static void __csid_configure_rx(struct csid_device *csid,
 				struct csid_phy_config *phy, int vc)
 {
+	struct csid_hw_cache *cache = &csid->cache;
 	u8 lane_cnt = csid->phy.lane_cnt;
-	int val;
+	u32 cfg0, cfg1;
 
 	if (!lane_cnt)
 		lane_cnt = 4;
 
-	val = (lane_cnt - 1) << CSI2_RX_CFG0_NUM_ACTIVE_LANES;
-	val |= phy->lane_assign << CSI2_RX_CFG0_DL0_INPUT_SEL;
-	val |= phy->csiphy_id << CSI2_RX_CFG0_PHY_NUM_SEL;
-	writel_relaxed(val, csid->base + CSID_CSI2_RX_CFG0);
+	cfg0 = (lane_cnt - 1) << CSI2_RX_CFG0_NUM_ACTIVE_LANES;
+	cfg0 |= phy->lane_assign << CSI2_RX_CFG0_DL0_INPUT_SEL;
+	cfg0 |= phy->csiphy_id << CSI2_RX_CFG0_PHY_NUM_SEL;
 
-	val = 1 << CSI2_RX_CFG1_PACKET_ECC_CORRECTION_EN;
+	cfg1 = 1 << CSI2_RX_CFG1_PACKET_ECC_CORRECTION_EN;
 	if (vc > 3)
-		val |= 1 << CSI2_RX_CFG1_VC_MODE;
-	val |= 1 << CSI2_RX_CFG1_MISR_EN;
-	writel_relaxed(val, csid->base + CSID_CSI2_RX_CFG1);
+		cfg1 |= 1 << CSI2_RX_CFG1_VC_MODE;
+	cfg1 |= 1 << CSI2_RX_CFG1_MISR_EN;
+
+	if (cache->rx_valid && cache->rx_cfg0 == cfg0 && cache->rx_cfg1 == cfg1)
+		return;
+
+	writel_relaxed(cfg0, csid->base + CSID_CSI2_RX_CFG0);
+	writel_relaxed(cfg1, csid->base + CSID_CSI2_RX_CFG1);
+
+	cache->rx_cfg0 = cfg0;
+	cache->rx_cfg1 = cfg1;
+	cache->rx_valid = true;
 }
 
 static void __csid_ctrl_rdi(struct csid_device *csid, int enable, u8 rdi)
@@ -280,16 +290,27 @@ static void __csid_configure_rdi_stream(struct csid_device *csid, u8 enable, u8
 	 * CID   : VC 3:0 << 2 | DT_ID 1:0
 	 */
 	u8 dt_id = vc & 0x03;
+	u32 cfg0;
 
-	val = 1 << RDI_CFG0_BYTE_CNTR_EN;
-	val |= 1 << RDI_CFG0_FORMAT_MEASURE_EN;
-	val |= 1 << RDI_CFG0_TIMESTAMP_EN;
+	cfg0 = 1 << RDI_CFG0_BYTE_CNTR_EN;
+	cfg0 |= 1 << RDI_CFG0_FORMAT_MEASURE_EN;
+	cfg0 |= 1 << RDI_CFG0_TIMESTAMP_EN;
 	/* note: for non-RDI path, this should be format->decode_format */
-	val |= DECODE_FORMAT_PAYLOAD_ONLY << RDI_CFG0_DECODE_FORMAT;
-	val |= format->data_type << RDI_CFG0_DATA_TYPE;
-	val |= vc << RDI_CFG0_VIRTUAL_CHANNEL;
-	val |= dt_id << RDI_CFG0_DT_ID;
-	writel_relaxed(val, csid->base + CSID_RDI_CFG0(vc));
+	cfg0 |= DECODE_FORMAT_PAYLOAD_ONLY << RDI_CFG0_DECODE_FORMAT;
+	cfg0 |= format->data_type << RDI_CFG0_DATA_TYPE;
+	cfg0 |= vc << RDI_CFG0_VIRTUAL_CHANNEL;
+	cfg0 |= dt_id << RDI_CFG0_DT_ID;
+
+	/* The rest of the RDI setup doesn't depend on the stream */
+	if (test_bit(vc, &csid->cache.rdi_valid) &&
+	    csid->cache.rdi_cfg0[vc] == cfg0) {
+		writel_relaxed(cfg0 | enable << RDI_CFG0_ENABLE,
+			       csid->base + CSID_RDI_CFG0(vc));
+		trace_camss_csid_rdi_configure(csid->id, vc, enable, true);
+		return;
+	}
+
+	writel_relaxed(cfg0, csid->base + CSID_RDI_CFG0(vc));
 
 	/* CSID_TIMESTAMP_STB_POST_IRQ */
 	val = 2 << RDI_CFG1_TIMESTAMP_STB_SEL;
@@ -325,6 +346,10 @@ static void __csid_configure_rdi_stream(struct csid_device *csid, u8 enable, u8
 	val = readl_relaxed(csid->base + CSID_RDI_CFG0(vc));
 	val |=  enable << RDI_CFG0_ENABLE;
 	writel_relaxed(val, csid->base + CSID_RDI_CFG0(vc));
+
+	csid->cache.rdi_cfg0[vc] = cfg0;
+	set_bit(vc, &csid->cache.rdi_valid);
+	trace_camss_csid_rdi_configure(csid->id, vc, enable, false);
 }
 
 static void csid_configure_stream(struct csid_device *csid, u8 enable)
@@ -423,6 +448,7 @@ static int csid_reset(struct csid_device *csid)
 	u32 val;
 
 	reinit_completion(&csid->reset_complete);
+	memset(&csid->cache, 0, sizeof(csid->cache));
 
 	writel_relaxed(1, csid->base + CSID_TOP_IRQ_CLEAR);
 	writel_relaxed(1, csid->base + CSID_IRQ_CMD);
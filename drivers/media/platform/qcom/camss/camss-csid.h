@@ -161,6 +161,18 @@ struct csid_subdev_resources {
 	const struct csid_formats *formats;
 };
 
+/*
+ * Register values last programmed by configure_stream, forgotten on reset.
+ * A stream restarted with the same configuration only needs to be enabled.
+ */
+struct csid_hw_cache {
+	u32 rdi_cfg0[MSM_CSID_MAX_SRC_STREAMS];
+	unsigned long rdi_valid;
+	u32 rx_cfg0;
+	u32 rx_cfg1;
+	bool rx_valid;
+};
+
 struct csid_device {
 	struct camss *camss;
 	u8 id;
@@ -176,6 +188,7 @@ struct csid_device {
 	struct completion reset_complete;
 	struct csid_testgen_config testgen;
 	struct csid_phy_config phy;
+	struct csid_hw_cache cache;
 	struct v4l2_mbus_framefmt fmt[MSM_CSID_PADS_NUM];
 	struct v4l2_ctrl_handler ctrls;
 	struct v4l2_ctrl *testgen_mode;
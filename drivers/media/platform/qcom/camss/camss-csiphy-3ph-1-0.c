@@ -10,6 +10,7 @@
 
 #include "camss.h"
 #include "camss-csiphy.h"
+#include "camss-trace.h"
 
 #include <linux/delay.h>
 #include <linux/interrupt.h>
@@ -377,6 +378,8 @@ static void csiphy_reset(struct csiphy_device *csiphy)
 	writel_relaxed(0x1, csiphy->base + CSIPHY_3PH_CMN_CSI_COMMON_CTRLn(0));
 	usleep_range(5000, 8000);
 	writel_relaxed(0x0, csiphy->base + CSIPHY_3PH_CMN_CSI_COMMON_CTRLn(0));
+
+	csiphy->lanes_cache.valid = false;
 }
 
 static irqreturn_t csiphy_isr(int irq, void *dev)
@@ -572,6 +575,8 @@ static void csiphy_lanes_enable(struct csiphy_device *csiphy,
 				s64 link_freq, u8 lane_mask)
 {
 	struct csiphy_lanes_cfg *c = &cfg->csi2->lane_cfg;
+	struct csiphy_lanes_cache *cache = &csiphy->lanes_cache;
+	bool cached;
 	u8 settle_cnt;
 	u8 val;
 	int i;
@@ -593,10 +598,20 @@ static void csiphy_lanes_enable(struct csiphy_device *csiphy,
 	val = 0x00;
 	writel_relaxed(val, csiphy->base + CSIPHY_3PH_CMN_CSI_COMMON_CTRLn(0));
 
-	if (csiphy_is_gen2(csiphy->camss->res->version))
-		csiphy_gen2_config_lanes(csiphy, settle_cnt);
-	else
-		csiphy_gen1_config_lanes(csiphy, cfg, settle_cnt);
+	cached = cache->valid && cache->csi2 == cfg->csi2 &&
+		 cache->settle_cnt == settle_cnt && cache->lane_mask == lane_mask;
+	if (!cached) {
+		if (csiphy_is_gen2(csiphy->camss->res->version))
+			csiphy_gen2_config_lanes(csiphy, settle_cnt);
+		else
+			csiphy_gen1_config_lanes(csiphy, cfg, settle_cnt);
+
+		cache->csi2 = cfg->csi2;
+		cache->settle_cnt = settle_cnt;
+		cache->lane_mask = lane_mask;
+		cache->valid = true;
+	}
+	trace_camss_csiphy_lanes_enable(csiphy->id, settle_cnt, lane_mask, cached);
 
 	/* IRQ_MASK registers - disable all interrupts */
 	for (i = 11; i < 22; i++)
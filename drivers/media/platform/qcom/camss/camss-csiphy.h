@@ -78,6 +78,18 @@ struct csiphy_subdev_resources {
 	const struct csiphy_formats *formats;
 };
 
+/*
+ * Lane configuration last programmed into the PHY. Disabling the lanes only
+ * powers them down, the lane registers keep their contents until the next
+ * reset and don't need to be written again for the same sensor and rate.
+ */
+struct csiphy_lanes_cache {
+	const struct csiphy_csi2_cfg *csi2;
+	u8 settle_cnt;
+	u8 lane_mask;
+	bool valid;
+};
+
 struct csiphy_device {
 	struct camss *camss;
 	u8 id;
@@ -92,6 +104,7 @@ struct csiphy_device {
 	int nclocks;
 	u32 timer_clk_rate;
 	struct csiphy_config cfg;
+	struct csiphy_lanes_cache lanes_cache;
 	struct v4l2_mbus_framefmt fmt[MSM_CSIPHY_PADS_NUM];
 	const struct csiphy_subdev_resources *res;
 };
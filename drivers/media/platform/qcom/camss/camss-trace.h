@@ -0,0 +1,123 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM camss
+
+#if !defined(__CAMSS_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __CAMSS_TRACE_H__
+
+#include <linux/tracepoint.h>
+
+#include "camss-vfe.h"
+
+DECLARE_EVENT_CLASS(camss_vfe_frame_class,
+	TP_PROTO(struct vfe_device *vfe, struct vfe_line *line,
+		 unsigned int sequence),
+
+	TP_ARGS(vfe, line, sequence),
+
+	TP_STRUCT__entry(
+		__field(u8, vfe)
+		__field(int, line)
+		__field(unsigned int, sequence)
+		__field(unsigned int, dropped)
+	),
+
+	TP_fast_assign(
+		__entry->vfe = vfe->id;
+		__entry->line = line->id;
+		__entry->sequence = sequence;
+		__entry->dropped = line->output.dropped;
+	),
+
+	TP_printk("vfe = %u, line = %d, sequence = %u, dropped = %u",
+		  __entry->vfe, __entry->line, __entry->sequence,
+		  __entry->dropped)
+);
+
+DEFINE_EVENT(camss_vfe_frame_class, camss_vfe_buf_done,
+	TP_PROTO(struct vfe_device *vfe, struct vfe_line *line,
+		 unsigned int sequence),
+	TP_ARGS(vfe, line, sequence)
+);
+
+DEFINE_EVENT(camss_vfe_frame_class, camss_vfe_frame_drop,
+	TP_PROTO(struct vfe_device *vfe, struct vfe_line *line,
+		 unsigned int sequence),
+	TP_ARGS(vfe, line, sequence)
+);
+
+TRACE_EVENT(camss_csiphy_lanes_enable,
+	TP_PROTO(u8 id, u8 settle_cnt, u8 lane_mask, bool cached),
+
+	TP_ARGS(id, settle_cnt, lane_mask, cached),
+
+	TP_STRUCT__entry(
+		__field(u8, id)
+		__field(u8, settle_cnt)
+		__field(u8, lane_mask)
+		__field(bool, cached)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->settle_cnt = settle_cnt;
+		__entry->lane_mask = lane_mask;
+		__entry->cached = cached;
+	),
+
+	TP_printk("csiphy = %u, settle_cnt = %u, lane_mask = 0x%02x, cached = %d",
+		  __entry->id, __entry->settle_cnt, __entry->lane_mask,
+		  __entry->cached)
+);
+
+TRACE_EVENT(camss_csid_rdi_configure,
+	TP_PROTO(u8 id, u8 vc, u8 enable, bool cached),
+
+	TP_ARGS(id, vc, enable, cached),
+
+	TP_STRUCT__entry(
+		__field(u8, id)
+		__field(u8, vc)
+		__field(u8, enable)
+		__field(bool, cached)
+	),
+
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->vc = vc;
+		__entry->enable = enable;
+		__entry->cached = cached;
+	),
+
+	TP_printk("csid = %u, vc = %u, enable = %u, cached = %d",
+		  __entry->id, __entry->vc, __entry->enable, __entry->cached)
+);
+
+/* Time spent in s_stream(1) of every subdev of a pipeline at stream on */
+TRACE_EVENT(camss_stream_on_stage,
+	TP_PROTO(const char *name, u64 duration_ns),
+
+	TP_ARGS(name, duration_ns),
+
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("%s: %llu ns", __get_str(name), __entry->duration_ns)
+);
+
+#endif /* __CAMSS_TRACE_H__ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/media/platform/qcom/camss
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE camss-trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
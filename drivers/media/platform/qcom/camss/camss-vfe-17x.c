@@ -13,6 +13,7 @@
 
 #include "camss.h"
 #include "camss-vfe.h"
+#include "camss-trace.h"
 
 #define VFE_HW_VERSION				(0x000)
 
@@ -371,10 +372,6 @@ static irqreturn_t vfe_isr(int irq, void *dev)
 		if (status0 & STATUS_0_RDI_REG_UPDATE(i))
 			vfe->isr_ops.reg_update(vfe, i);
 
-	for (i = VFE_LINE_RDI0; i < vfe->res->line_num; i++)
-		if (status0 & STATUS_1_RDI_SOF(i))
-			vfe->isr_ops.sof(vfe, i);
-
 	for (i = 0; i < MSM_VFE_COMPOSITE_IRQ_NUM; i++)
 		if (vfe_bus_status[0] & STATUS0_COMP_BUF_DONE(i))
 			vfe->isr_ops.comp_done(vfe, i);
@@ -384,6 +381,11 @@ static irqreturn_t vfe_isr(int irq, void *dev)
 			if (vfe_bus_status[1] & STATUS1_WM_CLIENT_BUF_DONE(wm))
 				vfe->isr_ops.wm_done(vfe, wm);
 
+	/* Start of the next frame comes after the done of the previous one */
+	for (i = VFE_LINE_RDI0; i < vfe->res->line_num; i++)
+		if (status1 & STATUS_1_RDI_SOF(i))
+			vfe->isr_ops.sof(vfe, i);
+
 	return IRQ_HANDLED;
 }
 
@@ -474,6 +476,8 @@ static int vfe_enable_output(struct vfe_line *line)
 	output->state = VFE_OUTPUT_ON;
 
 	output->sequence = 0;
+	output->dropped = 0;
+	output->sof_ts = 0;
 	output->wait_reg_update = 0;
 	reinit_completion(&output->reg_update);
 
@@ -546,7 +550,23 @@ static int vfe_enable(struct vfe_line *line)
  */
 static void vfe_isr_sof(struct vfe_device *vfe, enum vfe_line_id line_id)
 {
-	/* nop */
+	struct vfe_output *output;
+	unsigned long flags;
+
+	spin_lock_irqsave(&vfe->output_lock, flags);
+
+	output = &vfe->line[line_id].output;
+	output->sof_ts = ktime_get_ns();
+
+	if (output->state == VFE_OUTPUT_ON)
+		msm_video_frame_sync(&vfe->line[line_id].video_out,
+				     output->sequence);
+
+	/* No address programmed in the write master, this frame is lost */
+	if (output->state == VFE_OUTPUT_ON && !output->gen2.active_num)
+		vfe_frame_drop(&vfe->line[line_id]);
+
+	spin_unlock_irqrestore(&vfe->output_lock, flags);
 }
 
 /*
@@ -602,8 +622,9 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 		goto out_unlock;
 	}
 
-	ready_buf->vb.vb2_buf.timestamp = ts;
+	ready_buf->vb.vb2_buf.timestamp = output->sof_ts ?: ts;
 	ready_buf->vb.sequence = output->sequence++;
+	trace_camss_vfe_buf_done(vfe, line, ready_buf->vb.sequence);
 
 	index = 0;
 	output->buf[0] = output->buf[1];
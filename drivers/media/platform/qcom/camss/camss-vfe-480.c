@@ -14,6 +14,7 @@
 
 #include "camss.h"
 #include "camss-vfe.h"
+#include "camss-trace.h"
 
 #define VFE_HW_VERSION			(0x00)
 
@@ -304,6 +305,7 @@ static int vfe_enable_output(struct vfe_line *line)
 	output->state = VFE_OUTPUT_ON;
 
 	output->sequence = 0;
+	output->dropped = 0;
 	output->wait_reg_update = 0;
 	reinit_completion(&output->reg_update);
 
@@ -426,6 +428,7 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 
 	ready_buf->vb.vb2_buf.timestamp = ts;
 	ready_buf->vb.sequence = output->sequence++;
+	trace_camss_vfe_buf_done(vfe, line, ready_buf->vb.sequence);
 
 	index = 0;
 	output->buf[0] = output->buf[1];
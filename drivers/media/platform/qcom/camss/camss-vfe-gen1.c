@@ -10,6 +10,7 @@
 #include "camss.h"
 #include "camss-vfe.h"
 #include "camss-vfe-gen1.h"
+#include "camss-trace.h"
 
 /* Max number of frame drop updates per frame */
 #define VFE_FRAME_DROP_UPDATES 2
@@ -170,6 +171,7 @@ static int vfe_enable_output(struct vfe_line *line)
 	struct vfe_device *vfe = to_vfe(line);
 	struct vfe_output *output = &line->output;
 	const struct vfe_hw_ops *ops = vfe->res->hw_ops;
+	struct v4l2_pix_format_mplane pix;
 	struct media_entity *sensor;
 	unsigned long flags;
 	unsigned int frame_skip = 0;
@@ -228,6 +230,8 @@ static int vfe_enable_output(struct vfe_line *line)
 	}
 
 	output->sequence = 0;
+	output->dropped = 0;
+	output->sof_ts = 0;
 	output->gen1.wait_sof = 0;
 	output->wait_reg_update = 0;
 	reinit_completion(&output->sof);
@@ -247,6 +251,13 @@ static int vfe_enable_output(struct vfe_line *line)
 		vfe->ops_gen1->wm_enable(vfe, output->wm_idx[0], 1);
 		vfe->ops_gen1->bus_reload_wm(vfe, output->wm_idx[0]);
 	} else {
+		/*
+		 * The buffer may be taller than the frame, see
+		 * video_check_format(), write only the lines of the frame.
+		 */
+		pix = line->video_out.active_fmt.fmt.pix_mp;
+		pix.height = line->fmt[MSM_VFE_PAD_SRC].height;
+
 		ub_size /= output->wm_num;
 		for (i = 0; i < output->wm_num; i++) {
 			vfe->ops_gen1->set_cgc_override(vfe, output->wm_idx[i], 1);
@@ -254,7 +265,7 @@ static int vfe_enable_output(struct vfe_line *line)
 			vfe->ops_gen1->wm_set_ub_cfg(vfe, output->wm_idx[i],
 						     (ub_size + 1) * output->wm_idx[i], ub_size);
 			vfe->ops_gen1->wm_line_based(vfe, output->wm_idx[i],
-						     &line->video_out.active_fmt.fmt.pix_mp, i, 1);
+						     &pix, i, 1);
 			vfe->ops_gen1->wm_enable(vfe, output->wm_idx[i], 1);
 			vfe->ops_gen1->bus_reload_wm(vfe, output->wm_idx[i]);
 		}
@@ -526,10 +537,19 @@ static void vfe_isr_sof(struct vfe_device *vfe, enum vfe_line_id line_id)
 
 	spin_lock_irqsave(&vfe->output_lock, flags);
 	output = &vfe->line[line_id].output;
+	output->sof_ts = ktime_get_ns();
 	if (output->gen1.wait_sof) {
 		output->gen1.wait_sof = 0;
 		complete(&output->sof);
 	}
+
+	if (output->state > VFE_OUTPUT_RESERVED)
+		msm_video_frame_sync(&vfe->line[line_id].video_out,
+				     output->sequence);
+
+	/* Frame drop pattern is 0 while idle, this frame is not written out */
+	if (output->state == VFE_OUTPUT_IDLE)
+		vfe_frame_drop(&vfe->line[line_id]);
 	spin_unlock_irqrestore(&vfe->output_lock, flags);
 }
 
@@ -641,8 +661,9 @@ static void vfe_isr_wm_done(struct vfe_device *vfe, u8 wm)
 		goto out_unlock;
 	}
 
-	ready_buf->vb.vb2_buf.timestamp = ts;
+	ready_buf->vb.vb2_buf.timestamp = output->sof_ts ?: ts;
 	ready_buf->vb.sequence = output->sequence++;
+	trace_camss_vfe_buf_done(vfe, &vfe->line[vfe->wm_output_map[wm]], ready_buf->vb.sequence);
 
 	/* Get next buffer */
 	output->buf[!active_index] = vfe_buf_get_pending(output);
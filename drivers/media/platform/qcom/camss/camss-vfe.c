@@ -25,6 +25,9 @@
 #include "camss-vfe.h"
 #include "camss.h"
 
+#define CREATE_TRACE_POINTS
+#include "camss-trace.h"
+
 #define MSM_VFE_NAME "msm_vfe"
 
 /* VFE reset timeout */
@@ -489,6 +492,19 @@ void vfe_buf_add_pending(struct vfe_output *output,
 	list_add_tail(&buffer->queue, &output->pending_bufs);
 }
 
+/*
+ * The frame just started will be dropped by the hardware. Skip its sequence
+ * number so that userspace sees the gap in v4l2_buffer.sequence.
+ */
+void vfe_frame_drop(struct vfe_line *line)
+{
+	struct vfe_output *output = &line->output;
+
+	output->dropped++;
+
+	trace_camss_vfe_frame_drop(to_vfe(line), line, output->sequence++);
+}
+
 /*
  * vfe_buf_flush_pending - Flush all pending buffers.
  * @output: VFE output
@@ -555,6 +571,10 @@ int vfe_disable(struct vfe_line *line)
 	if (ret)
 		goto error;
 
+	if (line->output.dropped)
+		dev_dbg(vfe->camss->dev, "VFE%u line %d dropped %u frames\n",
+			vfe->id, line->id, line->output.dropped);
+
 	vfe_put_output(line);
 
 	mutex_lock(&vfe->stream_lock);
@@ -1772,6 +1792,7 @@ int msm_vfe_register_entities(struct vfe_device *vfe,
 		video_out->ops = &vfe->video_ops;
 		video_out->bpl_alignment = vfe_bpl_align(vfe);
 		video_out->line_based = 0;
+		video_out->sof_timestamp = !!vfe->isr_ops.sof;
 		if (i == VFE_LINE_PIX) {
 			video_out->bpl_alignment = 16;
 			video_out->line_based = 1;
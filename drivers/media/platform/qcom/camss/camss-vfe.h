@@ -77,6 +77,8 @@ struct vfe_output {
 	};
 	enum vfe_output_state state;
 	unsigned int sequence;
+	unsigned int dropped;
+	u64 sof_ts;
 
 	int wait_reg_update;
 	struct completion sof;
@@ -186,6 +188,14 @@ struct camss_buffer *vfe_buf_get_pending(struct vfe_output *output);
 
 int vfe_flush_buffers(struct camss_video *vid, enum vb2_buffer_state state);
 
+/*
+ * vfe_frame_drop - Account a frame the hardware had no buffer for
+ * @line: VFE line
+ *
+ * Must be called with output_lock held.
+ */
+void vfe_frame_drop(struct vfe_line *line);
+
 /*
  * vfe_isr_comp_done - Process composite image done interrupt
  * @vfe: VFE Device
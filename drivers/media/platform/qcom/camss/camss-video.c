@@ -11,10 +11,12 @@
 #include <media/media-entity.h>
 #include <media/v4l2-dev.h>
 #include <media/v4l2-device.h>
+#include <media/v4l2-event.h>
 #include <media/v4l2-ioctl.h>
 #include <media/v4l2-mc.h>
 #include <media/videobuf2-dma-sg.h>
 
+#include "camss-trace.h"
 #include "camss-video.h"
 #include "camss.h"
 
@@ -203,6 +205,30 @@ static void video_buf_queue(struct vb2_buffer *vb)
 	video->ops->queue_buffer(video, buffer);
 }
 
+/*
+ * Semi-planar formats on line based outputs may use a buffer taller than
+ * the frame. The extra luma lines are left unwritten and the chroma plane
+ * starts below them, which matches the layout encoders such as Venus
+ * expect (luma height aligned to 32 lines), so frames can be shared with
+ * them without a copy.
+ */
+static bool video_height_padding(struct camss_video *video,
+				 struct v4l2_pix_format_mplane *pix)
+{
+	if (!video->line_based)
+		return false;
+
+	switch (pix->pixelformat) {
+	case V4L2_PIX_FMT_NV12:
+	case V4L2_PIX_FMT_NV21:
+	case V4L2_PIX_FMT_NV16:
+	case V4L2_PIX_FMT_NV61:
+		return true;
+	default:
+		return false;
+	}
+}
+
 static int video_check_format(struct camss_video *video)
 {
 	struct v4l2_pix_format_mplane *pix = &video->active_fmt.fmt.pix_mp;
@@ -216,12 +242,15 @@ static int video_check_format(struct camss_video *video)
 		return ret;
 
 	if (pix->pixelformat != sd_pix->pixelformat ||
-	    pix->height != sd_pix->height ||
 	    pix->width != sd_pix->width ||
 	    pix->num_planes != sd_pix->num_planes ||
 	    pix->field != format.fmt.pix_mp.field)
 		return -EPIPE;
 
+	if (pix->height != sd_pix->height &&
+	    !(video_height_padding(video, pix) && pix->height > sd_pix->height))
+		return -EPIPE;
+
 	return 0;
 }
 
@@ -232,6 +261,7 @@ static int video_start_streaming(struct vb2_queue *q, unsigned int count)
 	struct media_entity *entity;
 	struct media_pad *pad;
 	struct v4l2_subdev *subdev;
+	ktime_t start;
 	int ret;
 
 	ret = video_device_pipeline_alloc_start(vdev);
@@ -257,9 +287,12 @@ static int video_start_streaming(struct vb2_queue *q, unsigned int count)
 		entity = pad->entity;
 		subdev = media_entity_to_v4l2_subdev(entity);
 
+		start = ktime_get();
 		ret = v4l2_subdev_call(subdev, video, s_stream, 1);
 		if (ret < 0 && ret != -ENOIOCTLCMD)
 			goto error;
+		trace_camss_stream_on_stage(entity->name,
+					    ktime_to_ns(ktime_sub(ktime_get(), start)));
 	}
 
 	return 0;
@@ -562,6 +595,17 @@ static int video_s_input(struct file *file, void *fh, unsigned int input)
 	return input == 0 ? 0 : -EINVAL;
 }
 
+static int video_subscribe_event(struct v4l2_fh *fh,
+				 const struct v4l2_event_subscription *sub)
+{
+	switch (sub->type) {
+	case V4L2_EVENT_FRAME_SYNC:
+		return v4l2_event_subscribe(fh, sub, 2, NULL);
+	default:
+		return -EINVAL;
+	}
+}
+
 static const struct v4l2_ioctl_ops msm_vid_ioctl_ops = {
 	.vidioc_querycap		= video_querycap,
 	.vidioc_enum_fmt_vid_cap	= video_enum_fmt,
@@ -581,8 +625,27 @@ static const struct v4l2_ioctl_ops msm_vid_ioctl_ops = {
 	.vidioc_enum_input		= video_enum_input,
 	.vidioc_g_input			= video_g_input,
 	.vidioc_s_input			= video_s_input,
+	.vidioc_subscribe_event		= video_subscribe_event,
+	.vidioc_unsubscribe_event	= v4l2_event_unsubscribe,
 };
 
+/*
+ * msm_video_frame_sync - Signal start of frame to userspace
+ * @video: Video device structure
+ * @sequence: Sequence number the buffer of this frame will carry
+ *
+ * May be called from interrupt context.
+ */
+void msm_video_frame_sync(struct camss_video *video, unsigned int sequence)
+{
+	struct v4l2_event event = {
+		.type = V4L2_EVENT_FRAME_SYNC,
+		.u.frame_sync.frame_sequence = sequence,
+	};
+
+	v4l2_event_queue(&video->vdev, &event);
+}
+
 /* -----------------------------------------------------------------------------
  * V4L2 file operations
  */
@@ -727,6 +790,8 @@ int msm_video_register(struct camss_video *video, struct v4l2_device *v4l2_dev,
 	q->type = V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE;
 	q->io_modes = VB2_DMABUF | VB2_MMAP | VB2_READ;
 	q->timestamp_flags = V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC;
+	if (video->sof_timestamp)
+		q->timestamp_flags |= V4L2_BUF_FLAG_TSTAMP_SRC_SOE;
 	q->buf_struct_size = sizeof(struct camss_buffer);
 	q->dev = video->camss->dev;
 	q->lock = &video->q_lock;
@@ -46,6 +46,7 @@ struct camss_video {
 	struct mutex q_lock;
 	unsigned int bpl_alignment;
 	unsigned int line_based;
+	unsigned int sof_timestamp;
 	const struct camss_format_info *formats;
 	unsigned int nformats;
 };
@@ -55,4 +56,6 @@ int msm_video_register(struct camss_video *video, struct v4l2_device *v4l2_dev,
 
 void msm_video_unregister(struct camss_video *video);
 
+void msm_video_frame_sync(struct camss_video *video, unsigned int sequence);
+
 #endif /* QC_MSM_CAMSS_VIDEO_H */
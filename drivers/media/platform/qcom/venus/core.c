@@ -15,6 +15,7 @@
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
 #include <linux/slab.h>
+#include <linux/soc/qcom/llcc-qcom.h>
 #include <linux/types.h>
 #include <linux/pm_domain.h>
 #include <linux/pm_runtime.h>
@@ -24,9 +25,21 @@
 
 #include "core.h"
 #include "firmware.h"
+#include "helpers.h"
 #include "pm_helpers.h"
 #include "hfi_venus_io.h"
 
+/*
+ * Runtime suspend only power collapses the core, the firmware stays loaded
+ * and a new session resumes it with a short HFI resume. Holding on to the
+ * firmware costs nothing but its memory, so by default it is kept until
+ * the driver goes away.
+ */
+static unsigned int fw_idle_timeout_ms;
+module_param(fw_idle_timeout_ms, uint, 0644);
+MODULE_PARM_DESC(fw_idle_timeout_ms,
+		 "Shut the firmware down after this long without sessions (0 = never)");
+
 static void venus_coredump(struct venus_core *core)
 {
 	struct device *dev;
@@ -77,6 +90,94 @@ static void venus_event_notify(struct venus_core *core, u32 event)
 	schedule_delayed_work(&core->work, msecs_to_jiffies(10));
 }
 
+void venus_core_idle(struct venus_core *core)
+{
+	unsigned int timeout = READ_ONCE(fw_idle_timeout_ms);
+
+	if (timeout)
+		mod_delayed_work(system_wq, &core->fw_idle_work,
+				 msecs_to_jiffies(max(timeout, 1000U)));
+}
+
+static void venus_fw_idle_work(struct work_struct *work)
+{
+	struct venus_core *core =
+			container_of(work, struct venus_core, fw_idle_work.work);
+
+	if (pm_runtime_resume_and_get(core->dev) < 0)
+		return;
+
+	mutex_lock(&core->lock);
+
+	if (core->fw_off || core->state != CORE_INIT ||
+	    atomic_read(&core->insts_count) || test_bit(0, &core->sys_error))
+		goto unlock;
+
+	core->ops->core_deinit(core);
+	core->state = CORE_UNINIT;
+	venus_shutdown(core);
+	core->fw_off = true;
+	core->pm_stats.idle_shutdowns++;
+
+unlock:
+	mutex_unlock(&core->lock);
+	pm_runtime_put_sync(core->dev);
+}
+
+/*
+ * Boots the firmware again if it was shut down by venus_fw_idle_work(),
+ * called for every new session. core->lock is held until SYS_INIT is done,
+ * so that concurrent sessions wait for the firmware to be fully up.
+ */
+int venus_core_wake(struct venus_core *core)
+{
+	ktime_t start = ktime_get();
+	int ret;
+
+	mutex_lock(&core->lock);
+
+	if (!core->fw_off) {
+		mutex_unlock(&core->lock);
+		return 0;
+	}
+
+	ret = pm_runtime_resume_and_get(core->dev);
+	if (ret < 0) {
+		mutex_unlock(&core->lock);
+		return ret;
+	}
+
+	hfi_reinit(core);
+
+	ret = venus_boot(core);
+	if (!ret) {
+		ret = hfi_core_resume(core, true);
+		if (!ret) {
+			ret = hfi_core_init_locked(core);
+			if (ret)
+				core->ops->core_deinit(core);
+		}
+		if (ret)
+			venus_shutdown(core);
+		else
+			core->fw_off = false;
+	}
+
+	mutex_unlock(&core->lock);
+
+	pm_runtime_put_sync(core->dev);
+
+	if (ret) {
+		dev_err(core->dev, "failed to boot firmware: %d\n", ret);
+		return ret;
+	}
+
+	core->pm_stats.cold_boots++;
+	core->pm_stats.cold_boot_last_us = ktime_us_delta(ktime_get(), start);
+
+	return 0;
+}
+
 static const struct hfi_core_ops venus_core_ops = {
 	.event_notify = venus_event_notify,
 };
@@ -317,6 +418,8 @@ static int venus_probe(struct platform_device *pdev)
 	if (!core->res)
 		return -ENODEV;
 
+	venus_firmware_prefetch(core);
+
 	mutex_init(&core->pm_lock);
 
 	core->pm_ops = venus_pm_get(core->res->hfi_version);
@@ -336,19 +439,25 @@ static int venus_probe(struct platform_device *pdev)
 	dma_set_max_seg_size(dev, UINT_MAX);
 
 	INIT_LIST_HEAD(&core->instances);
+	xa_init(&core->sessions);
 	mutex_init(&core->lock);
 	INIT_DELAYED_WORK(&core->work, venus_sys_error_handler);
+	INIT_DELAYED_WORK(&core->fw_idle_work, venus_fw_idle_work);
 	init_waitqueue_head(&core->sys_err_done);
 
+	ret = venus_helper_bufpool_init(core);
+	if (ret)
+		goto err_core_put;
+
 	ret = devm_request_threaded_irq(dev, core->irq, hfi_isr, venus_isr_thread,
 					IRQF_TRIGGER_HIGH | IRQF_ONESHOT,
 					"venus", core);
 	if (ret)
-		goto err_core_put;
+		goto err_bufpool_fini;
 
 	ret = hfi_create(core, &venus_core_ops);
 	if (ret)
-		goto err_core_put;
+		goto err_bufpool_fini;
 
 	venus_assign_register_offsets(core);
 
@@ -358,6 +467,8 @@ static int venus_probe(struct platform_device *pdev)
 
 	platform_set_drvdata(pdev, core);
 
+	/* The decoder and encoder nodes are children, they wait for the core */
+	device_enable_async_suspend(dev);
 	pm_runtime_enable(dev);
 
 	ret = pm_runtime_get_sync(dev);
@@ -417,6 +528,8 @@ static int venus_probe(struct platform_device *pdev)
 	hfi_destroy(core);
 err_core_deinit:
 	hfi_core_deinit(core, false);
+err_bufpool_fini:
+	venus_helper_bufpool_fini(core);
 err_core_put:
 	if (core->pm_ops->core_put)
 		core->pm_ops->core_put(core);
@@ -430,13 +543,16 @@ static void venus_remove(struct platform_device *pdev)
 	struct device *dev = core->dev;
 	int ret;
 
+	cancel_delayed_work_sync(&core->fw_idle_work);
+
 	ret = pm_runtime_get_sync(dev);
 	WARN_ON(ret < 0);
 
 	ret = hfi_core_deinit(core, true);
 	WARN_ON(ret);
 
-	venus_shutdown(core);
+	if (!core->fw_off)
+		venus_shutdown(core);
 	of_platform_depopulate(dev);
 
 	venus_firmware_deinit(core);
@@ -451,6 +567,9 @@ static void venus_remove(struct platform_device *pdev)
 
 	hfi_destroy(core);
 
+	venus_helper_bufpool_fini(core);
+
+	xa_destroy(&core->sessions);
 	mutex_destroy(&core->pm_lock);
 	mutex_destroy(&core->lock);
 	venus_dbgfs_deinit(core);
@@ -460,8 +579,11 @@ static void venus_core_shutdown(struct platform_device *pdev)
 {
 	struct venus_core *core = platform_get_drvdata(pdev);
 
+	cancel_delayed_work_sync(&core->fw_idle_work);
+
 	pm_runtime_get_sync(core->dev);
-	venus_shutdown(core);
+	if (!core->fw_off)
+		venus_shutdown(core);
 	venus_firmware_deinit(core);
 	pm_runtime_put_sync(core->dev);
 }
@@ -505,6 +627,9 @@ static __maybe_unused int venus_runtime_resume(struct device *dev)
 {
 	struct venus_core *core = dev_get_drvdata(dev);
 	const struct venus_pm_ops *pm_ops = core->pm_ops;
+	struct venus_pm_stats *stats = &core->pm_stats;
+	ktime_t start = ktime_get();
+	u64 us;
 	int ret;
 
 	ret = icc_set_bw(core->video_path, kbps_to_icc(20000), 0);
@@ -521,7 +646,17 @@ static __maybe_unused int venus_runtime_resume(struct device *dev)
 			return ret;
 	}
 
-	return hfi_core_resume(core, false);
+	ret = hfi_core_resume(core, false);
+	if (ret)
+		return ret;
+
+	us = ktime_us_delta(ktime_get(), start);
+	stats->resumes++;
+	stats->resume_last_us = us;
+	stats->resume_sum_us += us;
+	stats->resume_max_us = max(stats->resume_max_us, us);
+
+	return 0;
 }
 
 static const struct dev_pm_ops venus_pm_ops = {
@@ -813,6 +948,7 @@ static const struct venus_resources sc7180_res = {
 	.cp_nonpixel_start = 0x1000000,
 	.cp_nonpixel_size = 0x24800000,
 	.fwname = "qcom/venus-5.4/venus.mbn",
+	.llcc_uid = LLCC_VIDSC0,
 };
 
 static const struct freq_tbl sm8250_freq_table[] = {
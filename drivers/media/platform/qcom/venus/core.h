@@ -9,6 +9,7 @@
 
 #include <linux/bitops.h>
 #include <linux/list.h>
+#include <linux/xarray.h>
 #include <media/videobuf2-v4l2.h>
 #include <media/v4l2-ctrls.h>
 #include <media/v4l2-device.h>
@@ -89,6 +90,7 @@ struct venus_resources {
 	u32 cp_nonpixel_start;
 	u32 cp_nonpixel_size;
 	const char *fwname;
+	u32 llcc_uid;
 };
 
 enum venus_fmt {
@@ -115,6 +117,41 @@ struct venus_format {
 	u32 flags;
 };
 
+/**
+ * struct venus_bufpool - pool of released internal buffers
+ * @lock:	protects the list and size
+ * @list:	the buffers, most recently released first
+ * @size:	total size of the buffers in the pool, in bytes
+ * @shrinker:	gives the pool back under memory pressure
+ */
+struct venus_bufpool {
+	struct mutex lock;
+	struct list_head list;
+	size_t size;
+	struct shrinker *shrinker;
+};
+
+/**
+ * struct venus_pm_stats - runtime PM statistics of the core
+ *
+ * @resumes:	number of runtime resumes out of power collapse
+ * @resume_last_us:	duration of the last resume
+ * @resume_max_us:	longest resume
+ * @resume_sum_us:	total time spent resuming
+ * @cold_boots:	number of firmware reloads after an idle shutdown
+ * @cold_boot_last_us:	duration of the last firmware reload and HFI init
+ * @idle_shutdowns:	number of times the firmware was shut down when idle
+ */
+struct venus_pm_stats {
+	u64 resumes;
+	u64 resume_last_us;
+	u64 resume_max_us;
+	u64 resume_sum_us;
+	u64 cold_boots;
+	u64 cold_boot_last_us;
+	u64 idle_shutdowns;
+};
+
 /**
  * struct venus_core - holds core parameters valid for all instances
  *
@@ -148,6 +185,7 @@ struct venus_format {
  * @fw:		structure of firmware parameters
  * @lock:	a lock for this strucure
  * @instances:	a list_head of all instances
+ * @sessions:	instances indexed by HFI session id, for message dispatch
  * @insts_count:	num of instances
  * @state:	the state of the venus core
  * @done:	a completion for sync HFI operations
@@ -170,6 +208,12 @@ struct venus_format {
  * @root:	debugfs root directory
  * @venus_ver:	the venus firmware version
  * @dump_core:	a flag indicating that a core dump is required
+ * @llcc:	the video LLCC slice, NULL if the platform has none
+ * @llcc_users:	number of instances streaming with @llcc active
+ * @bufpool:	internal and DPB buffers released by instances, for reuse
+ * @fw_idle_work:	shuts the firmware down after a long idle period
+ * @fw_off:	the firmware was shut down and is booted by the next session
+ * @pm_stats:	runtime PM statistics
  */
 struct venus_core {
 	void __iomem *base;
@@ -208,6 +252,7 @@ struct venus_core {
 	} fw;
 	struct mutex lock;
 	struct list_head instances;
+	struct xarray sessions;
 	atomic_t insts_count;
 	unsigned int state;
 	struct completion done;
@@ -234,8 +279,20 @@ struct venus_core {
 		u32 rev;
 	} venus_ver;
 	unsigned long dump_core;
+	struct llcc_slice_desc *llcc;
+	unsigned int llcc_users;
+	struct venus_bufpool bufpool;
+	struct delayed_work fw_idle_work;
+	bool fw_off;
+	struct venus_pm_stats pm_stats;
 };
 
+/*
+ * Driver private control: run the session with a single frame in flight,
+ * i.e. no reordering, single stage work mode and realtime priority.
+ */
+#define V4L2_CID_VENUS_LOW_LATENCY_MODE	(V4L2_CID_USER_BASE | 0x1001)
+
 struct vdec_controls {
 	u32 post_loop_deb_mode;
 	u32 profile;
@@ -243,6 +300,7 @@ struct vdec_controls {
 	u32 display_delay;
 	u32 display_delay_enable;
 	u64 conceal_color;
+	u32 low_latency;
 };
 
 struct venc_controls {
@@ -255,6 +313,7 @@ struct venc_controls {
 	u32 rc_enable;
 	u32 const_quality;
 	u32 frame_skip_mode;
+	u32 low_latency;
 
 	u32 h264_i_period;
 	u32 h264_entropy_mode;
@@ -326,6 +385,8 @@ struct venus_buffer {
 	struct list_head reg_list;
 	u32 flags;
 	struct list_head ref_list;
+	ktime_t queued;
+	ktime_t processed;
 };
 
 struct clock_data {
@@ -365,6 +426,48 @@ struct venus_ts_metadata {
 	struct v4l2_timecode tc;
 };
 
+/*
+ * Latency histograms, in log2 buckets of microseconds: bucket 0 holds
+ * samples below 1us, bucket n samples in [2^(n - 1), 2^n) us and the last
+ * bucket everything above.
+ */
+#define VENUS_HIST_BUCKETS	24
+
+enum venus_hist_id {
+	VENUS_HIST_QUEUE,	/* qbuf to buffer handed to the firmware */
+	VENUS_HIST_INPUT,	/* ETB to EBD */
+	VENUS_HIST_OUTPUT,	/* FTB to FBD */
+	VENUS_HIST_FRAME,	/* ETB to FBD of the same frame */
+	VENUS_HIST_HFI,		/* wait for a synchronous HFI response */
+	VENUS_HIST_MAX,
+};
+
+struct venus_hist {
+	u64 count;
+	u64 sum_us;
+	u64 max_us;
+	u32 bucket[VENUS_HIST_BUCKETS];
+};
+
+/**
+ * struct venus_inst_stats - per instance latency statistics
+ * @lock:	protects the histograms and the frame ring
+ * @hist:	histograms, indexed by &enum venus_hist_id
+ * @frames:	ETB time of the last input frames, by timestamp
+ * @next_frame:	frame ring slot to use for the next ETB
+ * @dir:	debugfs directory of the instance
+ */
+struct venus_inst_stats {
+	spinlock_t lock;
+	struct venus_hist hist[VENUS_HIST_MAX];
+	struct {
+		u64 ts_us;
+		ktime_t etb;
+	} frames[VIDEO_MAX_FRAME];
+	unsigned int next_frame;
+	struct dentry *dir;
+};
+
 enum venus_inst_modes {
 	VENUS_LOW_POWER = BIT(0),
 };
@@ -404,6 +507,9 @@ enum venus_inst_modes {
  * @buf_count:		used to count number of buffers (reqbuf(0))
  * @tss:		timestamp metadata
  * @payloads:		cache plane payload to use it for clock/BW scaling
+ * @bitstream_bytes:	bitstream bytes seen in the current rate window
+ * @bitstream_ts:	start of the current bitstream rate window
+ * @bitstream_rate:	measured bitstream rate in bits per second
  * @fps:		holds current FPS
  * @timeperframe:	holds current time per frame structure
  * @fmt_out:	a reference to output format structure
@@ -432,12 +538,14 @@ enum venus_inst_modes {
  * @session_type:	the type of the session (decoder or encoder)
  * @hprop:	a union used as a holder by get property
  * @core_acquired:	the Core has been acquired
+ * @llcc_active:	the instance holds a reference on the video LLCC slice
  * @bit_depth:		current bitstream bit-depth
  * @pic_struct:		bitstream progressive vs interlaced
  * @next_buf_last: a flag to mark next queued capture buffer as last
  * @drain_active:	Drain sequence is in progress
  * @flags:	bitmask flags describing current instance mode
  * @dpb_ids:	DPB buffer ID's
+ * @stats:	latency statistics
  */
 struct venus_inst {
 	struct list_head list;
@@ -475,6 +583,9 @@ struct venus_inst {
 	int buf_count;
 	struct venus_ts_metadata tss[VIDEO_MAX_FRAME];
 	unsigned long payloads[VIDEO_MAX_FRAME];
+	u64 bitstream_bytes;
+	ktime_t bitstream_ts;
+	u32 bitstream_rate;
 	u64 fps;
 	struct v4l2_fract timeperframe;
 	const struct venus_format *fmt_out;
@@ -503,12 +614,14 @@ struct venus_inst {
 	u32 session_type;
 	union hfi_get_property hprop;
 	unsigned int core_acquired: 1;
+	unsigned int llcc_active: 1;
 	unsigned int bit_depth;
 	unsigned int pic_struct;
 	bool next_buf_last;
 	bool drain_active;
 	enum venus_inst_modes flags;
 	struct ida dpb_ids;
+	struct venus_inst_stats stats;
 };
 
 #define IS_V1(core)	((core)->res->hfi_version == HFI_VERSION_1XX)
@@ -564,4 +677,7 @@ is_fw_rev_or_older(struct venus_core *core, u32 vmajor, u32 vminor, u32 vrev)
 		(core)->venus_ver.minor == vminor &&
 		(core)->venus_ver.rev <= vrev);
 }
+
+int venus_core_wake(struct venus_core *core);
+void venus_core_idle(struct venus_core *core);
 #endif
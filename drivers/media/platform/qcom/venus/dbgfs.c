@@ -3,8 +3,11 @@
  * Copyright (C) 2020 Linaro Ltd.
  */
 
+#include <linux/clk.h>
 #include <linux/debugfs.h>
 #include <linux/fault-inject.h>
+#include <linux/hash.h>
+#include <linux/seq_file.h>
 
 #include "core.h"
 
@@ -12,10 +15,135 @@
 DECLARE_FAULT_ATTR(venus_ssr_attr);
 #endif
 
+/*
+ * Per instance load, as used for core selection and clock scaling, and the
+ * share of its core's clock that this amounts to.
+ */
+static int load_show(struct seq_file *s, void *unused)
+{
+	struct venus_core *core = s->private;
+	unsigned long rate = clk_get_rate(core->vcodec0_clks[0]);
+	struct venus_inst *inst;
+
+	mutex_lock(&core->lock);
+	list_for_each_entry(inst, &core->instances, list) {
+		seq_printf(s, "%p: %s core=%u %ux%u@%llu freq=%lu low_power=%d",
+			   inst,
+			   inst->session_type == VIDC_SESSION_TYPE_ENC ? "enc" : "dec",
+			   inst->clk_data.core_id, inst->width, inst->height,
+			   inst->fps, inst->clk_data.freq,
+			   !!(inst->flags & VENUS_LOW_POWER));
+		if (rate)
+			seq_printf(s, " util=%lu%%",
+				   mult_frac(inst->clk_data.freq, 100, rate));
+		seq_puts(s, "\n");
+	}
+	mutex_unlock(&core->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(load);
+
+static const char * const hist_names[VENUS_HIST_MAX] = {
+	[VENUS_HIST_QUEUE] = "queue",
+	[VENUS_HIST_INPUT] = "input",
+	[VENUS_HIST_OUTPUT] = "output",
+	[VENUS_HIST_FRAME] = "frame",
+	[VENUS_HIST_HFI] = "hfi",
+};
+
+/*
+ * Latency histograms of an instance: time spent in the driver before a
+ * buffer is handed to the firmware, time the firmware holds input and
+ * output buffers, ETB to FBD of a frame and synchronous HFI round trips.
+ */
+static int latency_show(struct seq_file *s, void *unused)
+{
+	struct venus_inst *inst = s->private;
+	struct venus_inst_stats *stats = &inst->stats;
+	struct venus_hist hist;
+	unsigned int i, b;
+
+	for (i = 0; i < VENUS_HIST_MAX; i++) {
+		spin_lock(&stats->lock);
+		hist = stats->hist[i];
+		spin_unlock(&stats->lock);
+
+		seq_printf(s, "%s: count=%llu avg=%llu us max=%llu us\n",
+			   hist_names[i], hist.count,
+			   hist.count ? div64_u64(hist.sum_us, hist.count) : 0,
+			   hist.max_us);
+
+		for (b = 0; b < VENUS_HIST_BUCKETS; b++) {
+			if (!hist.bucket[b])
+				continue;
+
+			if (b == VENUS_HIST_BUCKETS - 1)
+				seq_printf(s, "  >=%10lu us: %u\n",
+					   BIT(b - 1), hist.bucket[b]);
+			else
+				seq_printf(s, "  < %10lu us: %u\n",
+					   BIT(b), hist.bucket[b]);
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(latency);
+
+/*
+ * Runtime PM of the core: resumes from power collapse with the firmware
+ * retained, and firmware reloads after an idle shutdown.
+ */
+static int pm_show(struct seq_file *s, void *unused)
+{
+	struct venus_core *core = s->private;
+	struct venus_pm_stats stats;
+
+	mutex_lock(&core->lock);
+	stats = core->pm_stats;
+	seq_printf(s, "firmware: %s\n", core->fw_off ? "off" : "loaded");
+	mutex_unlock(&core->lock);
+
+	seq_printf(s, "resumes: %llu\n", stats.resumes);
+	seq_printf(s, "resume_last_us: %llu\n", stats.resume_last_us);
+	seq_printf(s, "resume_avg_us: %llu\n", stats.resumes ?
+		   div64_u64(stats.resume_sum_us, stats.resumes) : 0);
+	seq_printf(s, "resume_max_us: %llu\n", stats.resume_max_us);
+	seq_printf(s, "idle_shutdowns: %llu\n", stats.idle_shutdowns);
+	seq_printf(s, "cold_boots: %llu\n", stats.cold_boots);
+	seq_printf(s, "cold_boot_last_us: %llu\n", stats.cold_boot_last_us);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(pm);
+
+void venus_dbgfs_inst_init(struct venus_inst *inst)
+{
+	struct venus_core *core = inst->core;
+	char name[16];
+
+	snprintf(name, sizeof(name), "%s-%08x",
+		 inst->session_type == VIDC_SESSION_TYPE_ENC ? "enc" : "dec",
+		 hash32_ptr(inst));
+
+	inst->stats.dir = debugfs_create_dir(name, core->root);
+	debugfs_create_file("latency", 0444, inst->stats.dir, inst,
+			    &latency_fops);
+}
+
+void venus_dbgfs_inst_deinit(struct venus_inst *inst)
+{
+	debugfs_remove_recursive(inst->stats.dir);
+	inst->stats.dir = NULL;
+}
+
 void venus_dbgfs_init(struct venus_core *core)
 {
 	core->root = debugfs_create_dir("venus", NULL);
 	debugfs_create_x32("fw_level", 0644, core->root, &venus_fw_debug);
+	debugfs_create_file("load", 0444, core->root, core, &load_fops);
+	debugfs_create_file("pm", 0444, core->root, core, &pm_fops);
 
 #ifdef CONFIG_FAULT_INJECTION
 	fault_create_debugfs_attr("fail_ssr", core->root, &venus_ssr_attr);
@@ -7,6 +7,7 @@
 #include <linux/fault-inject.h>
 
 struct venus_core;
+struct venus_inst;
 
 #ifdef CONFIG_FAULT_INJECTION
 extern struct fault_attr venus_ssr_attr;
@@ -21,5 +22,7 @@ static inline bool venus_fault_inject_ssr(void) { return false; }
 
 void venus_dbgfs_init(struct venus_core *core);
 void venus_dbgfs_deinit(struct venus_core *core);
+void venus_dbgfs_inst_init(struct venus_inst *inst);
+void venus_dbgfs_inst_deinit(struct venus_inst *inst);
 
 #endif
@@ -207,11 +207,35 @@ static int venus_shutdown_no_tz(struct venus_core *core)
 	return 0;
 }
 
+static const char *venus_fw_name(struct venus_core *core)
+{
+	const char *fwpath = NULL;
+
+	if (of_property_read_string_index(core->dev->of_node, "firmware-name",
+					  0, &fwpath))
+		fwpath = core->res->fwname;
+
+	return fwpath;
+}
+
+/*
+ * The image is reloaded every time the firmware is booted again after an
+ * idle power off or an error. Keep it cached for as long as the device is
+ * bound, starting the first read early in probe.
+ */
+void venus_firmware_prefetch(struct venus_core *core)
+{
+	const char *fwpath = venus_fw_name(core);
+
+	if (fwpath)
+		firmware_request_prefetch(core->dev, fwpath);
+}
+
 int venus_boot(struct venus_core *core)
 {
 	struct device *dev = core->dev;
 	const struct venus_resources *res = core->res;
-	const char *fwpath = NULL;
+	const char *fwpath;
 	phys_addr_t mem_phys;
 	size_t mem_size;
 	int ret;
@@ -220,10 +244,7 @@ int venus_boot(struct venus_core *core)
 	    (core->use_tz && !qcom_scm_is_available()))
 		return -EPROBE_DEFER;
 
-	ret = of_property_read_string_index(dev->of_node, "firmware-name", 0,
-					    &fwpath);
-	if (ret)
-		fwpath = core->res->fwname;
+	fwpath = venus_fw_name(core);
 
 	ret = venus_load_fw(core, fwpath, &mem_phys, &mem_size);
 	if (ret) {
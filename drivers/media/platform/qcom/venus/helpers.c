@@ -4,8 +4,12 @@
  * Copyright (C) 2017 Linaro Ltd.
  */
 #include <linux/idr.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
+#include <linux/math64.h>
 #include <linux/mutex.h>
+#include <linux/shrinker.h>
+#include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/kernel.h>
 #include <media/videobuf2-dma-contig.h>
@@ -19,6 +23,9 @@
 #include "hfi_platform.h"
 #include "hfi_parser.h"
 
+#define CREATE_TRACE_POINTS
+#include "trace.h"
+
 #define NUM_MBS_720P	(((ALIGN(1280, 16)) >> 4) * ((ALIGN(736, 16)) >> 4))
 #define NUM_MBS_4K	(((ALIGN(4096, 16)) >> 4) * ((ALIGN(2304, 16)) >> 4))
 
@@ -38,6 +45,154 @@ struct intbuf {
 	u32 dpb_out_tag;
 };
 
+/*
+ * Internal, scratch and DPB buffers are recycled through a per core pool
+ * rather than freed, so that restarting a session doesn't pay for a fresh
+ * allocation and IOMMU mapping of each of them.  The pool is trimmed by a
+ * shrinker under memory pressure.  A recycled buffer is cleared before it is
+ * handed to the next session, which is why these keep a kernel mapping, and a
+ * buffer the firmware may still hold on to is never recycled.
+ */
+#define BUFPOOL_MAX_SIZE	SZ_64M
+#define INTBUF_ATTRS		DMA_ATTR_WRITE_COMBINE
+
+static struct intbuf *intbuf_alloc(struct venus_core *core, u32 type,
+				   size_t size)
+{
+	struct venus_bufpool *pool = &core->bufpool;
+	struct intbuf *buf;
+
+	mutex_lock(&pool->lock);
+	list_for_each_entry(buf, &pool->list, list) {
+		if (buf->type != type || buf->size != size)
+			continue;
+
+		list_del_init(&buf->list);
+		pool->size -= buf->size;
+		mutex_unlock(&pool->lock);
+
+		memset(buf->va, 0, buf->size);
+
+		return buf;
+	}
+	mutex_unlock(&pool->lock);
+
+	buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	INIT_LIST_HEAD(&buf->list);
+	buf->type = type;
+	buf->size = size;
+	buf->attrs = INTBUF_ATTRS;
+	buf->va = dma_alloc_attrs(core->dev, buf->size, &buf->da, GFP_KERNEL,
+				  buf->attrs);
+	if (!buf->va) {
+		kfree(buf);
+		return NULL;
+	}
+
+	return buf;
+}
+
+static void intbuf_destroy(struct venus_core *core, struct intbuf *buf)
+{
+	dma_free_attrs(core->dev, buf->size, buf->va, buf->da, buf->attrs);
+	kfree(buf);
+}
+
+/* The buffer must no longer be on a list, nor in use by the firmware */
+static void intbuf_free(struct venus_core *core, struct intbuf *buf)
+{
+	struct venus_bufpool *pool = &core->bufpool;
+
+	mutex_lock(&pool->lock);
+	if (pool->size + buf->size <= BUFPOOL_MAX_SIZE) {
+		list_add(&buf->list, &pool->list);
+		pool->size += buf->size;
+		buf = NULL;
+	}
+	mutex_unlock(&pool->lock);
+
+	if (buf)
+		intbuf_destroy(core, buf);
+}
+
+static unsigned long
+bufpool_count(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct venus_core *core = shrinker->private_data;
+
+	return READ_ONCE(core->bufpool.size) >> PAGE_SHIFT;
+}
+
+static unsigned long
+bufpool_scan(struct shrinker *shrinker, struct shrink_control *sc)
+{
+	struct venus_core *core = shrinker->private_data;
+	struct venus_bufpool *pool = &core->bufpool;
+	unsigned long freed = 0;
+	struct intbuf *buf;
+	LIST_HEAD(victims);
+
+	if (!mutex_trylock(&pool->lock))
+		return SHRINK_STOP;
+
+	/* The least recently released buffers are at the tail */
+	while (freed < sc->nr_to_scan && !list_empty(&pool->list)) {
+		buf = list_last_entry(&pool->list, struct intbuf, list);
+		list_move(&buf->list, &victims);
+		pool->size -= buf->size;
+		freed += buf->size >> PAGE_SHIFT;
+	}
+	mutex_unlock(&pool->lock);
+
+	while (!list_empty(&victims)) {
+		buf = list_first_entry(&victims, struct intbuf, list);
+		list_del(&buf->list);
+		intbuf_destroy(core, buf);
+	}
+
+	return freed ?: SHRINK_STOP;
+}
+
+int venus_helper_bufpool_init(struct venus_core *core)
+{
+	struct venus_bufpool *pool = &core->bufpool;
+
+	mutex_init(&pool->lock);
+	INIT_LIST_HEAD(&pool->list);
+	pool->size = 0;
+
+	pool->shrinker = shrinker_alloc(0, "venus-bufpool-%s", dev_name(core->dev));
+	if (!pool->shrinker)
+		return -ENOMEM;
+
+	pool->shrinker->count_objects = bufpool_count;
+	pool->shrinker->scan_objects = bufpool_scan;
+	pool->shrinker->private_data = core;
+
+	shrinker_register(pool->shrinker);
+
+	return 0;
+}
+
+void venus_helper_bufpool_fini(struct venus_core *core)
+{
+	struct venus_bufpool *pool = &core->bufpool;
+	struct intbuf *buf, *n;
+
+	shrinker_free(pool->shrinker);
+
+	list_for_each_entry_safe(buf, n, &pool->list, list) {
+		list_del(&buf->list);
+		intbuf_destroy(core, buf);
+	}
+	pool->size = 0;
+
+	mutex_destroy(&pool->lock);
+}
+
 bool venus_helper_check_codec(struct venus_inst *inst, u32 v4l2_pixfmt)
 {
 	struct venus_core *core = inst->core;
@@ -95,9 +250,7 @@ static void free_dpb_buf(struct venus_inst *inst, struct intbuf *buf)
 	ida_free(&inst->dpb_ids, buf->dpb_out_tag);
 
 	list_del_init(&buf->list);
-	dma_free_attrs(inst->core->dev, buf->size, buf->va, buf->da,
-		       buf->attrs);
-	kfree(buf);
+	intbuf_free(inst->core, buf);
 }
 
 int venus_helper_queue_dpb_bufs(struct venus_inst *inst)
@@ -162,7 +315,6 @@ EXPORT_SYMBOL_GPL(venus_helper_free_dpb_bufs);
 int venus_helper_alloc_dpb_bufs(struct venus_inst *inst)
 {
 	struct venus_core *core = inst->core;
-	struct device *dev = core->dev;
 	enum hfi_version ver = core->res->hfi_version;
 	struct hfi_buffer_requirements bufreq;
 	u32 buftype = inst->dpb_buftype;
@@ -192,26 +344,16 @@ int venus_helper_alloc_dpb_bufs(struct venus_inst *inst)
 	count = hfi_bufreq_get_count_min(&bufreq, ver);
 
 	for (i = 0; i < count; i++) {
-		buf = kzalloc(sizeof(*buf), GFP_KERNEL);
+		buf = intbuf_alloc(core, buftype, dpb_size);
 		if (!buf) {
 			ret = -ENOMEM;
 			goto fail;
 		}
-
-		buf->type = buftype;
-		buf->size = dpb_size;
-		buf->attrs = DMA_ATTR_WRITE_COMBINE |
-			     DMA_ATTR_NO_KERNEL_MAPPING;
-		buf->va = dma_alloc_attrs(dev, buf->size, &buf->da, GFP_KERNEL,
-					  buf->attrs);
-		if (!buf->va) {
-			ret = -ENOMEM;
-			goto fail;
-		}
 		buf->owned_by = DRIVER;
 
 		id = ida_alloc_min(&inst->dpb_ids, VB2_MAX_FRAME, GFP_KERNEL);
 		if (id < 0) {
+			intbuf_free(core, buf);
 			ret = id;
 			goto fail;
 		}
@@ -224,7 +366,6 @@ int venus_helper_alloc_dpb_bufs(struct venus_inst *inst)
 	return 0;
 
 fail:
-	kfree(buf);
 	venus_helper_free_dpb_bufs(inst);
 	return ret;
 }
@@ -248,22 +389,9 @@ static int intbufs_set_buffer(struct venus_inst *inst, u32 type)
 		return 0;
 
 	for (i = 0; i < bufreq.count_actual; i++) {
-		buf = kzalloc(sizeof(*buf), GFP_KERNEL);
-		if (!buf) {
-			ret = -ENOMEM;
-			goto fail;
-		}
-
-		buf->type = bufreq.type;
-		buf->size = bufreq.size;
-		buf->attrs = DMA_ATTR_WRITE_COMBINE |
-			     DMA_ATTR_NO_KERNEL_MAPPING;
-		buf->va = dma_alloc_attrs(dev, buf->size, &buf->da, GFP_KERNEL,
-					  buf->attrs);
-		if (!buf->va) {
-			ret = -ENOMEM;
-			goto fail;
-		}
+		buf = intbuf_alloc(core, bufreq.type, bufreq.size);
+		if (!buf)
+			return -ENOMEM;
 
 		memset(&bd, 0, sizeof(bd));
 		bd.buffer_size = buf->size;
@@ -274,19 +402,14 @@ static int intbufs_set_buffer(struct venus_inst *inst, u32 type)
 		ret = hfi_session_set_buffers(inst, &bd);
 		if (ret) {
 			dev_err(dev, "set session buffers failed\n");
-			goto dma_free;
+			intbuf_free(core, buf);
+			return ret;
 		}
 
 		list_add_tail(&buf->list, &inst->internalbufs);
 	}
 
 	return 0;
-
-dma_free:
-	dma_free_attrs(dev, buf->size, buf->va, buf->da, buf->attrs);
-fail:
-	kfree(buf);
-	return ret;
 }
 
 static int intbufs_unset_buffers(struct venus_inst *inst)
@@ -305,9 +428,10 @@ static int intbufs_unset_buffers(struct venus_inst *inst)
 		ret = hfi_session_unset_buffers(inst, &bd);
 
 		list_del_init(&buf->list);
-		dma_free_attrs(inst->core->dev, buf->size, buf->va, buf->da,
-			       buf->attrs);
-		kfree(buf);
+		if (ret)
+			intbuf_destroy(inst->core, buf);
+		else
+			intbuf_free(inst->core, buf);
 	}
 
 	return ret;
@@ -395,11 +519,11 @@ int venus_helper_intbufs_realloc(struct venus_inst *inst)
 
 		ret = hfi_session_unset_buffers(inst, &bd);
 
-		dma_free_attrs(inst->core->dev, buf->size, buf->va, buf->da,
-			       buf->attrs);
-
 		list_del_init(&buf->list);
-		kfree(buf);
+		if (ret)
+			intbuf_destroy(inst->core, buf);
+		else
+			intbuf_free(inst->core, buf);
 	}
 
 	ret = intbufs_set_buffer(inst, HFI_BUFFER_INTERNAL_SCRATCH(ver));
@@ -495,6 +619,117 @@ void venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
 }
 EXPORT_SYMBOL_GPL(venus_helper_get_ts_metadata);
 
+void venus_helper_hist_add(struct venus_inst *inst, unsigned int id,
+			   u64 us)
+{
+	struct venus_hist *hist = &inst->stats.hist[id];
+	unsigned int bucket = 0;
+
+	if (us)
+		bucket = min_t(unsigned int, ilog2(us) + 1,
+			       VENUS_HIST_BUCKETS - 1);
+
+	spin_lock(&inst->stats.lock);
+	hist->count++;
+	hist->sum_us += us;
+	hist->max_us = max(hist->max_us, us);
+	hist->bucket[bucket]++;
+	spin_unlock(&inst->stats.lock);
+}
+
+static void frame_etb(struct venus_inst *inst, u64 ts_us, ktime_t etb)
+{
+	struct venus_inst_stats *stats = &inst->stats;
+	unsigned int slot;
+
+	spin_lock(&stats->lock);
+	slot = stats->next_frame++ % ARRAY_SIZE(stats->frames);
+	stats->frames[slot].ts_us = ts_us;
+	stats->frames[slot].etb = etb;
+	spin_unlock(&stats->lock);
+}
+
+static void frame_fbd(struct venus_inst *inst, u64 ts_us, ktime_t fbd)
+{
+	struct venus_inst_stats *stats = &inst->stats;
+	ktime_t etb = 0;
+	unsigned int i;
+
+	spin_lock(&stats->lock);
+	for (i = 0; i < ARRAY_SIZE(stats->frames); i++) {
+		if (!stats->frames[i].etb || stats->frames[i].ts_us != ts_us)
+			continue;
+
+		etb = stats->frames[i].etb;
+		stats->frames[i].etb = 0;
+		break;
+	}
+	spin_unlock(&stats->lock);
+
+	if (etb)
+		venus_helper_hist_add(inst, VENUS_HIST_FRAME,
+				      ktime_us_delta(fbd, etb));
+}
+
+/*
+ * Account a buffer returned by the firmware, once its payload and
+ * timestamp have been filled in.
+ */
+void venus_helper_account_buf_done(struct venus_inst *inst,
+				   struct vb2_v4l2_buffer *vbuf)
+{
+	struct venus_buffer *buf = to_venus_buffer(vbuf);
+	struct vb2_buffer *vb = &vbuf->vb2_buf;
+	ktime_t now = ktime_get();
+	u64 delay, ts_us;
+
+	if (!buf->processed)
+		return;
+
+	delay = ktime_us_delta(now, buf->processed);
+	buf->processed = 0;
+
+	venus_helper_hist_add(inst, V4L2_TYPE_IS_OUTPUT(vb->type) ?
+			      VENUS_HIST_INPUT : VENUS_HIST_OUTPUT, delay);
+	trace_venus_buf_done(inst, vbuf, delay);
+
+	if (V4L2_TYPE_IS_CAPTURE(vb->type) && vb2_get_plane_payload(vb, 0)) {
+		ts_us = vb->timestamp;
+		do_div(ts_us, NSEC_PER_USEC);
+		frame_fbd(inst, ts_us, now);
+	}
+}
+EXPORT_SYMBOL_GPL(venus_helper_account_buf_done);
+
+#define BITSTREAM_RATE_WINDOW_MS	1000
+
+/*
+ * Measure the bitstream rate of a session over windows of about a second,
+ * the bus votes follow it instead of assuming a worst case stream.
+ */
+void venus_helper_account_bitstream(struct venus_inst *inst, u32 bytes)
+{
+	ktime_t now = ktime_get();
+	s64 elapsed;
+	u64 rate;
+
+	if (!inst->bitstream_ts)
+		inst->bitstream_ts = now;
+
+	inst->bitstream_bytes += bytes;
+
+	elapsed = ktime_ms_delta(now, inst->bitstream_ts);
+	if (elapsed < BITSTREAM_RATE_WINDOW_MS)
+		return;
+
+	rate = div64_u64(inst->bitstream_bytes * 8 * MSEC_PER_SEC, elapsed);
+	WRITE_ONCE(inst->bitstream_rate, min_t(u64, rate, U32_MAX));
+
+	inst->bitstream_bytes = 0;
+	inst->bitstream_ts = now;
+}
+EXPORT_SYMBOL_GPL(venus_helper_account_bitstream);
+
 static int
 session_process_buf(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
 {
@@ -502,6 +737,7 @@ session_process_buf(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
 	struct vb2_buffer *vb = &vbuf->vb2_buf;
 	unsigned int type = vb->type;
 	struct hfi_frame_data fdata;
+	u64 delay;
 
 	memset(&fdata, 0, sizeof(fdata));
 	fdata.alloc_len = buf->size;
@@ -519,8 +755,10 @@ session_process_buf(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
 		if (vbuf->flags & V4L2_BUF_FLAG_LAST || !fdata.filled_len)
 			fdata.flags |= HFI_BUFFERFLAG_EOS;
 
-		if (inst->session_type == VIDC_SESSION_TYPE_DEC)
+		if (inst->session_type == VIDC_SESSION_TYPE_DEC) {
 			put_ts_metadata(inst, vbuf);
+			venus_helper_account_bitstream(inst, fdata.filled_len);
+		}
 
 		venus_pm_load_scale(inst);
 	} else if (type == V4L2_BUF_TYPE_VIDEO_CAPTURE_MPLANE) {
@@ -532,6 +770,14 @@ session_process_buf(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf)
 		fdata.offset = 0;
 	}
 
+	buf->processed = ktime_get();
+	delay = ktime_us_delta(buf->processed, buf->queued);
+	venus_helper_hist_add(inst, VENUS_HIST_QUEUE, delay);
+	trace_venus_buf_process(inst, vbuf, delay);
+
+	if (fdata.buffer_type == HFI_BUFFER_INPUT && fdata.filled_len)
+		frame_etb(inst, fdata.timestamp, buf->processed);
+
 	return hfi_session_process_buf(inst, &fdata);
 }
 
@@ -658,6 +904,10 @@ static int platform_get_bufreq(struct venus_inst *inst, u32 buftype,
 		if (enc_ctr->bitrate_mode == V4L2_MPEG_VIDEO_BITRATE_MODE_CQ)
 			params.enc.rc_type = HFI_RATE_CONTROL_CQ;
 		params.enc.num_b_frames = enc_ctr->num_b_frames;
+		if (enc_ctr->low_latency) {
+			params.enc.work_mode = VIDC_WORK_MODE_1;
+			params.enc.num_b_frames = 0;
+		}
 		params.enc.is_tenbit = inst->bit_depth == VIDC_BITDEPTH_10;
 	}
 
@@ -1149,11 +1399,27 @@ int venus_helper_set_output_resolution(struct venus_inst *inst,
 }
 EXPORT_SYMBOL_GPL(venus_helper_set_output_resolution);
 
+static bool venus_helper_low_latency(struct venus_inst *inst)
+{
+	if (inst->session_type == VIDC_SESSION_TYPE_DEC)
+		return inst->controls.dec.low_latency;
+
+	return inst->controls.enc.low_latency;
+}
+
 static u32 venus_helper_get_work_mode(struct venus_inst *inst)
 {
 	u32 mode;
 	u32 num_mbs;
 
+	/*
+	 * Work mode 2 pipelines entropy coding and pixel processing across
+	 * frames, which costs a frame of latency. Low latency sessions want
+	 * each frame to complete before the next one is started.
+	 */
+	if (venus_helper_low_latency(inst))
+		return VIDC_WORK_MODE_1;
+
 	mode = VIDC_WORK_MODE_2;
 	if (inst->session_type == VIDC_SESSION_TYPE_DEC) {
 		num_mbs = (ALIGN(inst->height, 16) * ALIGN(inst->width, 16)) / 256;
@@ -1500,6 +1766,9 @@ void venus_helper_vb2_buf_queue(struct vb2_buffer *vb)
 	struct v4l2_m2m_ctx *m2m_ctx = inst->m2m_ctx;
 	int ret;
 
+	to_venus_buffer(vbuf)->queued = ktime_get();
+	trace_venus_buf_queue(inst, vbuf, 0);
+
 	v4l2_m2m_buf_queue(m2m_ctx, vbuf);
 
 	/* Skip processing queued capture buffers after LAST flag */
@@ -1564,6 +1833,10 @@ void venus_helper_vb2_stop_streaming(struct vb2_queue *q)
 
 		venus_helper_free_dpb_bufs(inst);
 
+		inst->bitstream_bytes = 0;
+		inst->bitstream_ts = 0;
+		WRITE_ONCE(inst->bitstream_rate, 0);
+
 		venus_pm_load_scale(inst);
 		INIT_LIST_HEAD(&inst->registeredbufs);
 	}
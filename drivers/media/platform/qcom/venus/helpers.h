@@ -56,6 +56,8 @@ int venus_helper_session_init(struct venus_inst *inst);
 int venus_helper_get_out_fmts(struct venus_inst *inst, u32 fmt, u32 *out_fmt,
 			      u32 *out2_fmt, bool ubwc);
 bool venus_helper_check_format(struct venus_inst *inst, u32 v4l2_pixfmt);
+int venus_helper_bufpool_init(struct venus_core *core);
+void venus_helper_bufpool_fini(struct venus_core *core);
 int venus_helper_alloc_dpb_bufs(struct venus_inst *inst);
 int venus_helper_free_dpb_bufs(struct venus_inst *inst);
 int venus_helper_intbufs_alloc(struct venus_inst *inst);
@@ -65,6 +67,11 @@ int venus_helper_queue_dpb_bufs(struct venus_inst *inst);
 int venus_helper_unregister_bufs(struct venus_inst *inst);
 int venus_helper_process_initial_cap_bufs(struct venus_inst *inst);
 int venus_helper_process_initial_out_bufs(struct venus_inst *inst);
+void venus_helper_account_bitstream(struct venus_inst *inst, u32 bytes);
+void venus_helper_hist_add(struct venus_inst *inst, unsigned int id,
+			   u64 us);
+void venus_helper_account_buf_done(struct venus_inst *inst,
+				   struct vb2_v4l2_buffer *vbuf);
 void venus_helper_get_ts_metadata(struct venus_inst *inst, u64 timestamp_us,
 				  struct vb2_v4l2_buffer *vbuf);
 int venus_helper_get_profile_level(struct venus_inst *inst, u32 *profile, u32 *level);
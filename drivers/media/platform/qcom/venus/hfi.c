@@ -4,6 +4,7 @@
  * Copyright (C) 2017 Linaro Ltd.
  */
 #include <linux/slab.h>
+#include <linux/hash.h>
 #include <linux/mutex.h>
 #include <linux/list.h>
 #include <linux/completion.h>
@@ -14,6 +15,8 @@
 #include "hfi.h"
 #include "hfi_cmds.h"
 #include "hfi_venus.h"
+#include "helpers.h"
+#include "trace.h"
 
 #define TIMEOUT		msecs_to_jiffies(1000)
 
@@ -47,37 +50,41 @@ static u32 to_codec_type(u32 pixfmt)
 	}
 }
 
-int hfi_core_init(struct venus_core *core)
+/* Like hfi_core_init(), for callers that already hold core->lock */
+int hfi_core_init_locked(struct venus_core *core)
 {
-	int ret = 0;
+	int ret;
 
-	mutex_lock(&core->lock);
+	lockdep_assert_held(&core->lock);
 
 	if (core->state >= CORE_INIT)
-		goto unlock;
+		return 0;
 
 	reinit_completion(&core->done);
 
 	ret = core->ops->core_init(core);
 	if (ret)
-		goto unlock;
+		return ret;
 
 	ret = wait_for_completion_timeout(&core->done, TIMEOUT);
-	if (!ret) {
-		ret = -ETIMEDOUT;
-		goto unlock;
-	}
-
-	ret = 0;
+	if (!ret)
+		return -ETIMEDOUT;
 
-	if (core->error != HFI_ERR_NONE) {
-		ret = -EIO;
-		goto unlock;
-	}
+	if (core->error != HFI_ERR_NONE)
+		return -EIO;
 
 	core->state = CORE_INIT;
-unlock:
+	return 0;
+}
+
+int hfi_core_init(struct venus_core *core)
+{
+	int ret;
+
+	mutex_lock(&core->lock);
+	ret = hfi_core_init_locked(core);
 	mutex_unlock(&core->lock);
+
 	return ret;
 }
 
@@ -163,16 +170,23 @@ int hfi_core_ping(struct venus_core *core)
 
 static int wait_session_msg(struct venus_inst *inst)
 {
+	ktime_t start = ktime_get();
+	u64 delay;
 	int ret;
 
 	ret = wait_for_completion_timeout(&inst->done, TIMEOUT);
 	if (!ret)
-		return -ETIMEDOUT;
+		ret = -ETIMEDOUT;
+	else if (inst->error != HFI_ERR_NONE)
+		ret = -EIO;
+	else
+		ret = 0;
 
-	if (inst->error != HFI_ERR_NONE)
-		return -EIO;
+	delay = ktime_us_delta(ktime_get(), start);
+	venus_helper_hist_add(inst, VENUS_HIST_HFI, delay);
+	trace_venus_hfi_wait(inst, ret, delay);
 
-	return 0;
+	return ret;
 }
 
 int hfi_session_create(struct venus_inst *inst, const struct hfi_inst_ops *ops)
@@ -187,6 +201,7 @@ int hfi_session_create(struct venus_inst *inst, const struct hfi_inst_ops *ops)
 	inst->state = INST_UNINIT;
 	init_completion(&inst->done);
 	inst->ops = ops;
+	spin_lock_init(&inst->stats.lock);
 
 	mutex_lock(&core->lock);
 
@@ -199,15 +214,33 @@ int hfi_session_create(struct venus_inst *inst, const struct hfi_inst_ops *ops)
 				core->max_sessions_supported);
 	if (!max) {
 		ret = -EAGAIN;
-	} else {
-		list_add_tail(&inst->list, &core->instances);
-		ret = 0;
+		goto unlock;
 	}
 
+	ret = xa_insert(&core->sessions, hash32_ptr(inst), inst, GFP_KERNEL);
+	if (ret) {
+		atomic_dec(&core->insts_count);
+		goto unlock;
+	}
+
+	list_add_tail(&inst->list, &core->instances);
+
 unlock:
 	mutex_unlock(&core->lock);
 
-	return ret;
+	if (ret)
+		return ret;
+
+	/* The firmware may have been shut down while there were no sessions */
+	ret = venus_core_wake(core);
+	if (ret) {
+		hfi_session_destroy(inst);
+		return ret;
+	}
+
+	venus_dbgfs_inst_init(inst);
+
+	return 0;
 }
 EXPORT_SYMBOL_GPL(hfi_session_create);
 
@@ -253,10 +286,15 @@ void hfi_session_destroy(struct venus_inst *inst)
 {
 	struct venus_core *core = inst->core;
 
+	venus_dbgfs_inst_deinit(inst);
+
 	mutex_lock(&core->lock);
 	list_del_init(&inst->list);
-	if (atomic_dec_and_test(&core->insts_count))
+	xa_cmpxchg(&core->sessions, hash32_ptr(inst), inst, NULL, 0);
+	if (atomic_dec_and_test(&core->insts_count)) {
 		wake_up_var(&core->insts_count);
+		venus_core_idle(core);
+	}
 	mutex_unlock(&core->lock);
 }
 EXPORT_SYMBOL_GPL(hfi_session_destroy);
@@ -17,6 +17,7 @@
 #define VIDC_RESOURCE_NONE			0
 #define VIDC_RESOURCE_OCMEM			1
 #define VIDC_RESOURCE_VMEM			2
+#define VIDC_RESOURCE_SYSCACHE			3
 
 struct hfi_buffer_desc {
 	u32 buffer_type;
@@ -148,6 +149,7 @@ void hfi_destroy(struct venus_core *core);
 void hfi_reinit(struct venus_core *core);
 
 int hfi_core_init(struct venus_core *core);
+int hfi_core_init_locked(struct venus_core *core);
 int hfi_core_deinit(struct venus_core *core, bool blocking);
 int hfi_core_suspend(struct venus_core *core);
 int hfi_core_resume(struct venus_core *core, bool force);
@@ -86,6 +86,18 @@ int pkt_sys_set_resource(struct hfi_sys_set_resource_pkt *pkt, u32 id, u32 size,
 		pkt->hdr.size += sizeof(*res);
 		break;
 	}
+	case VIDC_RESOURCE_SYSCACHE: {
+		struct hfi_resource_syscache_info *res =
+			(struct hfi_resource_syscache_info *)&pkt->resource_data[0];
+
+		/* @addr carries the LLCC slice id, @size its size in KB */
+		res->num_entries = 1;
+		res->entries[0].size = size;
+		res->entries[0].sc_id = addr;
+		pkt->resource_type = HFI_RESOURCE_SYSCACHE;
+		pkt->hdr.size += struct_size(res, entries, 1);
+		break;
+	}
 	case VIDC_RESOURCE_NONE:
 	default:
 		return -ENOTSUPP;
@@ -1070,12 +1070,23 @@ struct hfi_operations {
 };
 
 #define HFI_RESOURCE_OCMEM	0x1
+#define HFI_RESOURCE_SYSCACHE	0x2
 
 struct hfi_resource_ocmem {
 	u32 size;
 	u32 mem;
 };
 
+struct hfi_resource_subcache {
+	u32 size;
+	u32 sc_id;
+};
+
+struct hfi_resource_syscache_info {
+	u32 num_entries;
+	struct hfi_resource_subcache entries[];
+};
+
 struct hfi_resource_ocmem_requirement {
 	u32 session_domain;
 	u32 width;
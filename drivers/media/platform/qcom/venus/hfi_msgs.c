@@ -3,7 +3,6 @@
  * Copyright (c) 2012-2016, The Linux Foundation. All rights reserved.
  * Copyright (C) 2017 Linaro Ltd.
  */
-#include <linux/hash.h>
 #include <linux/list.h>
 #include <linux/slab.h>
 #include <linux/soc/qcom/smem.h>
@@ -749,17 +748,7 @@ void hfi_process_watchdog_timeout(struct venus_core *core)
 
 static struct venus_inst *to_instance(struct venus_core *core, u32 session_id)
 {
-	struct venus_inst *inst;
-
-	mutex_lock(&core->lock);
-	list_for_each_entry(inst, &core->instances, list)
-		if (hash32_ptr(inst) == session_id) {
-			mutex_unlock(&core->lock);
-			return inst;
-		}
-	mutex_unlock(&core->lock);
-
-	return NULL;
+	return xa_load(&core->sessions, session_id);
 }
 
 u32 hfi_process_msg_packet(struct venus_core *core, struct hfi_pkt_hdr *hdr)
@@ -11,6 +11,7 @@
 #include <linux/iopoll.h>
 #include <linux/kernel.h>
 #include <linux/slab.h>
+#include <linux/soc/qcom/llcc-qcom.h>
 
 #include "core.h"
 #include "hfi_cmds.h"
@@ -135,6 +136,11 @@ static bool venus_fw_low_power_mode = true;
 static int venus_hw_rsp_timeout = 1000;
 static bool venus_fw_coverage;
 
+/* messages drained in one pass after which the message queue is polled */
+#define VENUS_MSGQ_BUSY_BATCH	4
+/* how long to poll for more messages before re-arming the interrupt */
+#define VENUS_MSGQ_POLL_US	100
+
 static void venus_set_state(struct venus_hfi_device *hdev,
 			    enum venus_state state)
 {
@@ -707,6 +713,64 @@ static int venus_iface_msgq_read(struct venus_hfi_device *hdev, void *pkt)
 	return ret;
 }
 
+static bool venus_iface_msgq_pending(struct venus_hfi_device *hdev)
+{
+	struct hfi_queue_header *qhdr;
+	bool pending = false;
+
+	mutex_lock(&hdev->lock);
+	qhdr = hdev->queues[IFACEQ_MSG_IDX].qhdr;
+	if (qhdr && venus_is_valid_state(hdev)) {
+		pending = qhdr->read_idx != qhdr->write_idx;
+		/* ensure rd/wr indices are read from memory */
+		rmb();
+	}
+	mutex_unlock(&hdev->lock);
+
+	return pending;
+}
+
+static void venus_iface_msgq_set_rx_req(struct venus_hfi_device *hdev,
+					u32 rx_req)
+{
+	struct hfi_queue_header *qhdr;
+
+	mutex_lock(&hdev->lock);
+	qhdr = hdev->queues[IFACEQ_MSG_IDX].qhdr;
+	if (qhdr) {
+		qhdr->rx_req = rx_req;
+		/* update rx_req field in memory */
+		wmb();
+	}
+	mutex_unlock(&hdev->lock);
+}
+
+/*
+ * Wait a little for more messages with the receive request cleared, so a
+ * busy message queue is drained by polling instead of one interrupt per
+ * message. Returns true if there are messages to drain.
+ */
+static bool venus_iface_msgq_poll(struct venus_hfi_device *hdev)
+{
+	bool pending;
+	int ret;
+
+	venus_iface_msgq_set_rx_req(hdev, 0);
+
+	ret = read_poll_timeout(venus_iface_msgq_pending, pending, pending,
+				10, VENUS_MSGQ_POLL_US, false, hdev);
+	if (!ret)
+		return true;
+
+	/*
+	 * Re-arm the interrupt and check once more, a message written before
+	 * rx_req became visible to Venus would not raise one.
+	 */
+	venus_iface_msgq_set_rx_req(hdev, 1);
+
+	return venus_iface_msgq_pending(hdev);
+}
+
 static int venus_iface_dbgq_read_nolock(struct venus_hfi_device *hdev,
 					void *pkt)
 {
@@ -1068,6 +1132,7 @@ static irqreturn_t venus_isr_thread(struct venus_core *core)
 {
 	struct venus_hfi_device *hdev = to_hfi_priv(core);
 	const struct venus_resources *res;
+	unsigned int batch;
 	void *pkt;
 	u32 msg_ret;
 
@@ -1077,8 +1142,10 @@ static irqreturn_t venus_isr_thread(struct venus_core *core)
 	res = hdev->core->res;
 	pkt = hdev->pkt_buf;
 
-
+drain:
+	batch = 0;
 	while (!venus_iface_msgq_read(hdev, pkt)) {
+		batch++;
 		msg_ret = hfi_process_msg_packet(core, pkt);
 		switch (msg_ret) {
 		case HFI_MSG_EVENT_NOTIFY:
@@ -1089,6 +1156,11 @@ static irqreturn_t venus_isr_thread(struct venus_core *core)
 						    res->vmem_size,
 						    res->vmem_addr,
 						    hdev);
+			if (core->llcc)
+				venus_hfi_core_set_resource(core, VIDC_RESOURCE_SYSCACHE,
+							    llcc_get_slice_size(core->llcc),
+							    llcc_get_slice_id(core->llcc),
+							    hdev);
 			break;
 		case HFI_MSG_SYS_RELEASE_RESOURCE:
 			complete(&hdev->release_resource);
@@ -1101,6 +1173,9 @@ static irqreturn_t venus_isr_thread(struct venus_core *core)
 		}
 	}
 
+	if (batch >= VENUS_MSGQ_BUSY_BATCH && venus_iface_msgq_poll(hdev))
+		goto drain;
+
 	venus_flush_debug_queue(hdev);
 
 	return IRQ_HANDLED;
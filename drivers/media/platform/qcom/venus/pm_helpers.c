@@ -12,6 +12,7 @@
 #include <linux/pm_opp.h>
 #include <linux/pm_runtime.h>
 #include <linux/reset.h>
+#include <linux/soc/qcom/llcc-qcom.h>
 #include <linux/types.h>
 #include <media/v4l2-mem2mem.h>
 
@@ -212,14 +213,96 @@ static void mbs_to_bw(struct venus_inst *inst, u32 mbs, u32 *avg, u32 *peak)
 	}
 }
 
+/* Bytes per frame of a raw format, assuming 2:1 UBWC compression */
+static u64 raw_frame_bytes(u32 width, u32 height, bool tenbit, bool ubwc)
+{
+	u64 bytes = (u64)ALIGN(width, 16) * ALIGN(height, 16) * 3 / 2;
+
+	if (tenbit)
+		bytes = ubwc ? bytes * 4 / 3 : bytes * 2;
+	if (ubwc)
+		bytes /= 2;
+
+	return bytes;
+}
+
+/*
+ * Estimate the average DDR traffic of an instance in kBps from its
+ * bitstream rate and from the frames read and written per frame: the
+ * references with 2x overfetch for motion compensation, the reconstructed
+ * frame, a quarter frame of co-located data and the raw frame read by the
+ * encoder or written by the decoder secondary output. Returns 0 when the
+ * bitstream rate is not known yet.
+ */
+static u32 inst_bw_estimate(struct venus_inst *inst)
+{
+	u32 rate = READ_ONCE(inst->bitstream_rate);
+	u64 dpb_bytes, raw_bytes = 0, bw;
+	bool tenbit, ubwc;
+	u32 refs;
+
+	if (inst->session_type == VIDC_SESSION_TYPE_ENC) {
+		struct venc_controls *ctr = &inst->controls.enc;
+		u32 pixfmt = inst->fmt_out->pixfmt;
+
+		if (!rate)
+			rate = ctr->bitrate;
+
+		refs = ctr->ltr_count ? 2 : 1;
+		if (ctr->num_b_frames && !ctr->low_latency)
+			refs++;
+
+		tenbit = inst->bit_depth == VIDC_BITDEPTH_10;
+		ubwc = pixfmt == V4L2_PIX_FMT_QC08C ||
+		       pixfmt == V4L2_PIX_FMT_QC10C;
+		dpb_bytes = raw_frame_bytes(inst->out_width, inst->out_height,
+					    tenbit, ubwc);
+		raw_bytes = dpb_bytes;
+	} else {
+		u32 fmt = inst->dpb_fmt ? inst->dpb_fmt : inst->opb_fmt;
+
+		refs = 2;
+		tenbit = fmt & HFI_COLOR_FORMAT_10_BIT_BASE;
+		ubwc = fmt & HFI_COLOR_FORMAT_UBWC_BASE;
+		dpb_bytes = raw_frame_bytes(inst->width, inst->height,
+					    tenbit, ubwc);
+		if (inst->dpb_fmt)
+			raw_bytes = raw_frame_bytes(inst->out_width,
+				inst->out_height,
+				inst->opb_fmt & HFI_COLOR_FORMAT_10_BIT_BASE,
+				inst->opb_fmt & HFI_COLOR_FORMAT_UBWC_BASE);
+	}
+
+	if (!rate)
+		return 0;
+
+	bw = dpb_bytes * (refs * 8 + 4 + 1) / 4 + raw_bytes;
+	bw = bw * inst->fps + rate / 8;
+
+	return min_t(u64, div_u64(bw, 1000), U32_MAX);
+}
+
 static int load_scale_bw(struct venus_core *core)
 {
 	struct venus_inst *inst = NULL;
 	u32 mbs_per_sec, avg, peak, total_avg = 0, total_peak = 0;
+	u32 estimate;
 
 	list_for_each_entry(inst, &core->instances, list) {
 		mbs_per_sec = load_per_instance(inst);
 		mbs_to_bw(inst, mbs_per_sec, &avg, &peak);
+
+		/*
+		 * The tables hold worst case figures for the resolution and
+		 * frame rate, vote less when the stream is known to need less.
+		 */
+		estimate = mbs_per_sec ? inst_bw_estimate(inst) : 0;
+		if (estimate && estimate < avg) {
+			dev_dbg(core->dev, VDBGL "inst %p: avg_bw %u -> %u\n",
+				inst, avg, estimate);
+			avg = estimate;
+		}
+
 		total_avg += avg;
 		total_peak += peak;
 	}
@@ -746,16 +829,246 @@ static int release_core(struct venus_inst *inst)
 	return 0;
 }
 
+/*
+ * Load of a streaming instance on its core, in cycles per second.  Once the
+ * instance has queued buffers this is what load_scale_v4() computed from the
+ * real frame sizes, before that it is estimated from the resolution and rate.
+ */
+static unsigned long inst_core_load(struct venus_inst *inst)
+{
+	unsigned long vpp_freq;
+
+	if (inst->clk_data.freq)
+		return inst->clk_data.freq;
+
+	vpp_freq = inst->flags & VENUS_LOW_POWER ?
+		inst->clk_data.low_power_freq : inst->clk_data.vpp_freq;
+
+	return load_per_instance(inst) * vpp_freq;
+}
+
+/*
+ * Load of every instance holding a core, including those yet to start.
+ * Instances running on both cores count for half of their load on each.
+ */
+static void cores_load(struct venus_core *core, unsigned long load[2])
+{
+	struct venus_inst *inst;
+	unsigned long l;
+	u32 coreid;
+
+	load[0] = 0;
+	load[1] = 0;
+
+	list_for_each_entry(inst, &core->instances, list) {
+		if (!inst->core_acquired)
+			continue;
+
+		coreid = inst->clk_data.core_id;
+		l = inst_core_load(inst);
+
+		if ((coreid & VIDC_CORE_ID_3) == VIDC_CORE_ID_3) {
+			load[0] += l / 2;
+			load[1] += l / 2;
+		} else if (coreid & VIDC_CORE_ID_1) {
+			load[0] += l;
+		} else if (coreid & VIDC_CORE_ID_2) {
+			load[1] += l;
+		}
+	}
+}
+
+static int move_inst_core(struct venus_inst *inst, u32 to)
+{
+	const u32 ptype = HFI_PROPERTY_CONFIG_VIDEOCORES_USAGE;
+	struct venus_core *core = inst->core;
+	struct hfi_videocores_usage_type cu = { .video_core_enable_mask = to };
+	u32 from = inst->clk_data.core_id;
+	unsigned int *to_count, *from_count;
+	int ret;
+
+	if (to == VIDC_CORE_ID_1) {
+		to_count = &core->core0_usage_count;
+		from_count = &core->core1_usage_count;
+	} else {
+		to_count = &core->core1_usage_count;
+		from_count = &core->core0_usage_count;
+	}
+
+	/* Power up the new core before moving, the old one only after: */
+	if (!*to_count) {
+		ret = poweron_coreid(core, to);
+		if (ret)
+			return ret;
+	}
+
+	ret = hfi_session_set_property(inst, ptype, &cu);
+	if (ret) {
+		if (!*to_count)
+			poweroff_coreid(core, to);
+		return ret;
+	}
+
+	(*to_count)++;
+	inst->clk_data.core_id = to;
+
+	dev_dbg(core->dev, VDBGL "moved session %p to core %u\n", inst, to);
+
+	if (!--(*from_count))
+		return poweroff_coreid(core, from);
+
+	return 0;
+}
+
+/* An instance the firmware hasn't started a session for yet can be moved */
+static bool inst_can_move(struct venus_inst *inst)
+{
+	return inst->core_acquired && inst->state != INST_START &&
+	       core_num_max(inst) >= VIDC_CORE_ID_2;
+}
+
+/*
+ * Move single core instances that are not streaming yet off the busier core
+ * for as long as that lowers the load of the busiest core, and then take
+ * encoders out of power save mode wherever the load now allows it.  Called
+ * with core->lock held, when an instance starts or stops.
+ *
+ * The caller holds its own instance lock, and other instances may be waiting
+ * for core->lock with theirs held, so instances are only trylocked and those
+ * that are busy are left alone.
+ */
+static void rebalance_cores(struct venus_core *core)
+{
+	unsigned long max_freq = core->res->freq_tbl[0].freq;
+	unsigned long load[2], l, new_max, best_max, extra;
+	struct venus_inst *inst, *best;
+	unsigned int from, c;
+	int ret;
+
+	if (legacy_binding || core->res->vcodec_num < 2)
+		return;
+
+	/* Every move strictly lowers the maximum, so this terminates */
+	for (;;) {
+		cores_load(core, load);
+
+		from = load[1] > load[0];
+		best_max = load[from];
+		best = NULL;
+
+		list_for_each_entry(inst, &core->instances, list) {
+			if (!inst_can_move(inst))
+				continue;
+
+			if (inst->clk_data.core_id !=
+			    (from ? VIDC_CORE_ID_2 : VIDC_CORE_ID_1))
+				continue;
+
+			l = inst_core_load(inst);
+			new_max = max(load[from] - l, load[!from] + l);
+			if (new_max < best_max) {
+				best_max = new_max;
+				best = inst;
+			}
+		}
+
+		if (!best || !mutex_trylock(&best->lock))
+			break;
+
+		/* It may have started streaming before we got the lock */
+		ret = -EBUSY;
+		if (inst_can_move(best))
+			ret = move_inst_core(best, from ? VIDC_CORE_ID_1 :
+							  VIDC_CORE_ID_2);
+		mutex_unlock(&best->lock);
+		if (ret)
+			break;
+	}
+
+	list_for_each_entry(inst, &core->instances, list) {
+		if (inst->state != INST_START || !(inst->flags & VENUS_LOW_POWER))
+			continue;
+
+		if (!mutex_trylock(&inst->lock))
+			continue;
+
+		if (inst->state != INST_START || !(inst->flags & VENUS_LOW_POWER))
+			goto next;
+
+		if (inst->clk_data.core_id == VIDC_CORE_ID_1)
+			c = 0;
+		else if (inst->clk_data.core_id == VIDC_CORE_ID_2)
+			c = 1;
+		else
+			goto next;
+
+		extra = load_per_instance(inst) *
+			(inst->clk_data.vpp_freq - inst->clk_data.low_power_freq);
+		if (load[c] + extra > max_freq)
+			goto next;
+
+		if (!power_save_mode_enable(inst, false))
+			load[c] += extra;
+next:
+		mutex_unlock(&inst->lock);
+	}
+}
+
+/*
+ * Keep the video LLCC slice active while at least one instance is streaming.
+ * Failing to activate it is not fatal, the session just runs from DDR.
+ */
+static void llcc_power(struct venus_inst *inst, int on)
+{
+	struct venus_core *core = inst->core;
+	int ret;
+
+	if (!core->llcc)
+		return;
+
+	mutex_lock(&core->lock);
+
+	if (on == POWER_ON && !inst->llcc_active) {
+		if (!core->llcc_users) {
+			ret = llcc_slice_activate(core->llcc);
+			if (ret) {
+				dev_warn(core->dev, "failed to activate LLCC slice (%d)\n",
+					 ret);
+				goto unlock;
+			}
+		}
+		core->llcc_users++;
+		inst->llcc_active = true;
+	} else if (on == POWER_OFF && inst->llcc_active) {
+		inst->llcc_active = false;
+		if (!--core->llcc_users)
+			llcc_slice_deactivate(core->llcc);
+	}
+
+unlock:
+	mutex_unlock(&core->lock);
+}
+
 static int coreid_power_v4(struct venus_inst *inst, int on)
 {
 	struct venus_core *core = inst->core;
 	int ret;
 
-	if (legacy_binding)
+	if (legacy_binding) {
+		llcc_power(inst, on);
 		return 0;
+	}
 
 	if (on == POWER_ON) {
 		ret = decide_core(inst);
+		if (ret == -EINVAL) {
+			/* See if it fits once the running instances are spread out */
+			mutex_lock(&core->lock);
+			rebalance_cores(core);
+			mutex_unlock(&core->lock);
+
+			ret = decide_core(inst);
+		}
 		if (ret)
 			return ret;
 
@@ -765,9 +1078,14 @@ static int coreid_power_v4(struct venus_inst *inst, int on)
 	} else {
 		mutex_lock(&core->lock);
 		ret = release_core(inst);
+		if (!ret)
+			rebalance_cores(core);
 		mutex_unlock(&core->lock);
 	}
 
+	if (!ret || on == POWER_OFF)
+		llcc_power(inst, on);
+
 	return ret;
 }
 
@@ -990,6 +1308,17 @@ static int core_get_v4(struct venus_core *core)
 	if (ret)
 		return ret;
 
+	if (res->llcc_uid) {
+		core->llcc = llcc_slice_getd_optional(res->llcc_uid);
+		if (IS_ERR(core->llcc)) {
+			ret = PTR_ERR(core->llcc);
+			core->llcc = NULL;
+			return ret;
+		}
+		if (!core->llcc)
+			dev_dbg(dev, "no video LLCC slice\n");
+	}
+
 	if (legacy_binding)
 		return 0;
 
@@ -1016,6 +1345,9 @@ static int core_get_v4(struct venus_core *core)
 
 static void core_put_v4(struct venus_core *core)
 {
+	llcc_slice_putd(core->llcc);
+	core->llcc = NULL;
+
 	if (legacy_binding)
 		return;
 
@@ -1124,8 +1456,9 @@ static int load_scale_v4(struct venus_inst *inst)
 		} else if (inst->clk_data.core_id == VIDC_CORE_ID_2) {
 			freq_core2 += inst->clk_data.freq;
 		} else if (inst->clk_data.core_id == VIDC_CORE_ID_3) {
-			freq_core1 += inst->clk_data.freq;
-			freq_core2 += inst->clk_data.freq;
+			/* Split between the cores, as in min_loaded_core() */
+			freq_core1 += inst->clk_data.freq / 2;
+			freq_core2 += inst->clk_data.freq / 2;
 		}
 	}
 
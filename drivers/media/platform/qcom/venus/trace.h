@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM venus
+
+#if !defined(__VENUS_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __VENUS_TRACE_H__
+
+#include <linux/hash.h>
+#include <linux/tracepoint.h>
+#include <media/videobuf2-v4l2.h>
+
+#include "core.h"
+
+DECLARE_EVENT_CLASS(venus_buf,
+	TP_PROTO(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf,
+		 u64 delay_us),
+	TP_ARGS(inst, vbuf, delay_us),
+	TP_STRUCT__entry(
+		__field(u32, session)
+		__field(u32, type)
+		__field(u32, index)
+		__field(u32, bytesused)
+		__field(u64, delay_us)
+	),
+	TP_fast_assign(
+		__entry->session = hash32_ptr(inst);
+		__entry->type = vbuf->vb2_buf.type;
+		__entry->index = vbuf->vb2_buf.index;
+		__entry->bytesused = vb2_get_plane_payload(&vbuf->vb2_buf, 0);
+		__entry->delay_us = delay_us;
+	),
+	TP_printk("session=%08x %s index=%u bytesused=%u delay=%llu us",
+		  __entry->session,
+		  V4L2_TYPE_IS_OUTPUT(__entry->type) ? "output" : "capture",
+		  __entry->index, __entry->bytesused, __entry->delay_us)
+);
+
+/* buffer queued by userspace */
+DEFINE_EVENT(venus_buf, venus_buf_queue,
+	TP_PROTO(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf,
+		 u64 delay_us),
+	TP_ARGS(inst, vbuf, delay_us)
+);
+
+/* buffer handed to the firmware, delay is the time it waited in the driver */
+DEFINE_EVENT(venus_buf, venus_buf_process,
+	TP_PROTO(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf,
+		 u64 delay_us),
+	TP_ARGS(inst, vbuf, delay_us)
+);
+
+/* buffer returned by the firmware, delay is the time the firmware held it */
+DEFINE_EVENT(venus_buf, venus_buf_done,
+	TP_PROTO(struct venus_inst *inst, struct vb2_v4l2_buffer *vbuf,
+		 u64 delay_us),
+	TP_ARGS(inst, vbuf, delay_us)
+);
+
+TRACE_EVENT(venus_hfi_wait,
+	TP_PROTO(struct venus_inst *inst, int ret, u64 delay_us),
+	TP_ARGS(inst, ret, delay_us),
+	TP_STRUCT__entry(
+		__field(u32, session)
+		__field(int, ret)
+		__field(u64, delay_us)
+	),
+	TP_fast_assign(
+		__entry->session = hash32_ptr(inst);
+		__entry->ret = ret;
+		__entry->delay_us = delay_us;
+	),
+	TP_printk("session=%08x ret=%d delay=%llu us",
+		  __entry->session, __entry->ret, __entry->delay_us)
+);
+
+#endif /* __VENUS_TRACE_H__ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH ../../drivers/media/platform/qcom/venus
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -694,7 +694,8 @@ static int vdec_set_properties(struct venus_inst *inst)
 			return ret;
 	}
 
-	if (ctr->display_delay_enable && ctr->display_delay == 0) {
+	if ((ctr->display_delay_enable && ctr->display_delay == 0) ||
+	    ctr->low_latency) {
 		ptype = HFI_PROPERTY_PARAM_VDEC_OUTPUT_ORDER;
 		decode_order = HFI_OUTPUT_ORDER_DECODE;
 		ret = hfi_session_set_property(inst, ptype, &decode_order);
@@ -702,6 +703,13 @@ static int vdec_set_properties(struct venus_inst *inst)
 			return ret;
 	}
 
+	if (ctr->low_latency) {
+		ptype = HFI_PROPERTY_CONFIG_REALTIME;
+		ret = hfi_session_set_property(inst, ptype, &en);
+		if (ret)
+			return ret;
+	}
+
 	/* Enabling sufficient sequence change support for VP9 */
 	if (is_fw_rev_or_newer(inst->core, 5, 4, 51)) {
 		ptype = HFI_PROPERTY_PARAM_VDEC_ENABLE_SUFFICIENT_SEQCHANGE_EVENT;
@@ -1456,6 +1464,7 @@ static void vdec_buf_done(struct venus_inst *inst, unsigned int buf_type,
 		vb->timestamp = 0;
 	}
 
+	venus_helper_account_buf_done(inst, vbuf);
 	v4l2_m2m_buf_done(vbuf, state);
 }
 
@@ -39,6 +39,9 @@ static int vdec_op_s_ctrl(struct v4l2_ctrl *ctrl)
 	case V4L2_CID_MPEG_VIDEO_DEC_CONCEAL_COLOR:
 		ctr->conceal_color = *ctrl->p_new.p_s64;
 		break;
+	case V4L2_CID_VENUS_LOW_LATENCY_MODE:
+		ctr->low_latency = ctrl->val;
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -93,12 +96,23 @@ static const struct v4l2_ctrl_ops vdec_ctrl_ops = {
 	.g_volatile_ctrl = vdec_op_g_volatile_ctrl,
 };
 
+static const struct v4l2_ctrl_config vdec_low_latency_ctrl = {
+	.ops = &vdec_ctrl_ops,
+	.id = V4L2_CID_VENUS_LOW_LATENCY_MODE,
+	.name = "Low Latency Mode",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
 int vdec_ctrl_init(struct venus_inst *inst)
 {
 	struct v4l2_ctrl *ctrl;
 	int ret;
 
-	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 12);
+	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 13);
 	if (ret)
 		return ret;
 
@@ -179,6 +193,8 @@ int vdec_ctrl_init(struct venus_inst *inst)
 			  V4L2_CID_MPEG_VIDEO_DEC_CONCEAL_COLOR, 0,
 			  0xffffffffffffLL, 1, 0x8000800010LL);
 
+	v4l2_ctrl_new_custom(&inst->ctrl_handler, &vdec_low_latency_ctrl, NULL);
+
 	ret = inst->ctrl_handler.error;
 	if (ret) {
 		v4l2_ctrl_handler_free(&inst->ctrl_handler);
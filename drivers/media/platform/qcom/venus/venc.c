@@ -680,6 +680,14 @@ static int venc_set_properties(struct venus_inst *inst)
 	if (ret)
 		return ret;
 
+	if (ctr->low_latency) {
+		ptype = HFI_PROPERTY_CONFIG_REALTIME;
+		en.enable = 1;
+		ret = hfi_session_set_property(inst, ptype, &en);
+		if (ret)
+			return ret;
+	}
+
 	ptype = HFI_PROPERTY_CONFIG_FRAME_RATE;
 	frate.buffer_type = HFI_BUFFER_OUTPUT;
 	frate.framerate = inst->fps * (1 << 16);
@@ -780,7 +788,7 @@ static int venc_set_properties(struct venus_inst *inst)
 			return ret;
 	}
 
-	if (ctr->num_b_frames) {
+	if (ctr->num_b_frames && !ctr->low_latency) {
 		u32 max_num_b_frames = NUM_B_FRAMES_MAX;
 
 		ptype = HFI_PROPERTY_PARAM_VENC_MAX_NUM_B_FRAMES;
@@ -793,6 +801,12 @@ static int venc_set_properties(struct venus_inst *inst)
 	intra_period.pframes = ctr->num_p_frames;
 	intra_period.bframes = ctr->num_b_frames;
 
+	/* B frames need reordering, code the whole GOP as P frames instead */
+	if (ctr->low_latency) {
+		intra_period.pframes += intra_period.bframes;
+		intra_period.bframes = 0;
+	}
+
 	ret = hfi_session_set_property(inst, ptype, &intra_period);
 	if (ret)
 		return ret;
@@ -1347,6 +1361,7 @@ static void venc_buf_done(struct venus_inst *inst, unsigned int buf_type,
 		vb = &vbuf->vb2_buf;
 		vb2_set_plane_payload(vb, 0, bytesused + data_offset);
 		vb->planes[0].data_offset = data_offset;
+		venus_helper_account_bitstream(inst, bytesused);
 		vb->timestamp = timestamp_us * NSEC_PER_USEC;
 		vbuf->sequence = inst->sequence_cap++;
 		if ((vbuf->flags & V4L2_BUF_FLAG_LAST) &&
@@ -1357,6 +1372,7 @@ static void venc_buf_done(struct venus_inst *inst, unsigned int buf_type,
 		vbuf->sequence = inst->sequence_out++;
 	}
 
+	venus_helper_account_buf_done(inst, vbuf);
 	v4l2_m2m_buf_done(vbuf, VB2_BUF_STATE_DONE);
 }
 
@@ -323,6 +323,9 @@ static int venc_op_s_ctrl(struct v4l2_ctrl *ctrl)
 	case V4L2_CID_MPEG_VIDEO_INTRA_REFRESH_PERIOD:
 		ctr->intra_refresh_period = ctrl->val;
 		break;
+	case V4L2_CID_VENUS_LOW_LATENCY_MODE:
+		ctr->low_latency = ctrl->val;
+		break;
 	case V4L2_CID_MPEG_VIDEO_H264_8X8_TRANSFORM:
 		if (ctr->profile.h264 != V4L2_MPEG_VIDEO_H264_PROFILE_HIGH &&
 		    ctr->profile.h264 != V4L2_MPEG_VIDEO_H264_PROFILE_CONSTRAINED_HIGH)
@@ -372,6 +375,17 @@ static const struct v4l2_ctrl_ops venc_ctrl_ops = {
 	.g_volatile_ctrl = venc_op_g_volatile_ctrl,
 };
 
+static const struct v4l2_ctrl_config venc_low_latency_ctrl = {
+	.ops = &venc_ctrl_ops,
+	.id = V4L2_CID_VENUS_LOW_LATENCY_MODE,
+	.name = "Low Latency Mode",
+	.type = V4L2_CTRL_TYPE_BOOLEAN,
+	.min = 0,
+	.max = 1,
+	.step = 1,
+	.def = 0,
+};
+
 int venc_ctrl_init(struct venus_inst *inst)
 {
 	int ret;
@@ -381,7 +395,7 @@ int venc_ctrl_init(struct venus_inst *inst)
 	};
 	struct v4l2_ctrl_hdr10_cll_info p_hdr10_cll = { 1000, 400 };
 
-	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 59);
+	ret = v4l2_ctrl_handler_init(&inst->ctrl_handler, 60);
 	if (ret)
 		return ret;
 
@@ -622,6 +636,8 @@ int venc_ctrl_init(struct venus_inst *inst)
 			  V4L2_CID_MPEG_VIDEO_INTRA_REFRESH_PERIOD, 0,
 			  ((4096 * 2304) >> 8), 1, 0);
 
+	v4l2_ctrl_new_custom(&inst->ctrl_handler, &venc_low_latency_ctrl, NULL);
+
 	ret = inst->ctrl_handler.error;
 	if (ret)
 		goto err;
@@ -8,12 +8,15 @@
 #include <linux/dma-mapping.h>
 #include <linux/dma-resv.h>
 #include <linux/idr.h>
+#include <linux/io_uring/cmd.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/module.h>
 #include <linux/of_address.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/rbtree.h>
 #include <linux/sort.h>
 #include <linux/of_platform.h>
 #include <linux/rpmsg.h>
@@ -33,8 +36,11 @@
 #define FASTRPC_ALIGN		128
 #define FASTRPC_MAX_FDLIST	16
 #define FASTRPC_MAX_CRCLIST	64
+#define FASTRPC_META_CACHE_MAX	4
 #define FASTRPC_PHYS(p)	((p) & 0xffffffff)
 #define FASTRPC_CTX_MAX (256)
+/* Unreaped async invokes per fd, so one fd can't use up all the ctx ids */
+#define FASTRPC_ASYNC_MAX (FASTRPC_CTX_MAX / 4)
 #define FASTRPC_INIT_HANDLE	1
 #define FASTRPC_DSP_UTILITIES_HANDLE	2
 #define FASTRPC_CTXID_MASK (0xFF0)
@@ -214,6 +220,7 @@ struct fastrpc_dma_buf_attachment {
 
 struct fastrpc_map {
 	struct list_head node;
+	struct rb_node rb_node; /* in fl->map_tree, keyed by fd */
 	struct fastrpc_user *fl;
 	int fd;
 	struct dma_buf *buf;
@@ -238,6 +245,8 @@ struct fastrpc_invoke_ctx {
 	u32 *crc;
 	u64 ctxid;
 	u64 msg_sz;
+	bool async;	/* completion is reaped via FASTRPC_IOCTL_ASYNC_RESPONSE */
+	u64 job_id;
 	struct kref refcount;
 	struct list_head node; /* list of ctxs */
 	struct completion work;
@@ -247,6 +256,8 @@ struct fastrpc_invoke_ctx {
 	union fastrpc_remote_arg *rpra;
 	struct fastrpc_map **maps;
 	struct fastrpc_buf *buf;
+	/* session whose metadata cache @buf is returned to, if any */
+	struct fastrpc_session_ctx *buf_sess;
 	struct fastrpc_invoke_args *args;
 	struct fastrpc_buf_overlap *olaps;
 	struct fastrpc_channel_ctx *cctx;
@@ -257,6 +268,9 @@ struct fastrpc_session_ctx {
 	int sid;
 	bool used;
 	bool valid;
+	/* page sized metadata buffers kept for reuse, under cctx->lock */
+	struct fastrpc_buf *meta_cache[FASTRPC_META_CACHE_MAX];
+	int meta_cached;
 };
 
 struct fastrpc_channel_ctx {
@@ -277,6 +291,8 @@ struct fastrpc_channel_ctx {
 	struct fastrpc_device *fdevice;
 	struct fastrpc_buf *remote_heap;
 	struct list_head invoke_interrupted_mmaps;
+	/* woken when an async invoke on this channel completes */
+	wait_queue_head_t async_wq;
 	bool secure;
 	bool unsigned_support;
 	u64 dma_mask;
@@ -291,6 +307,7 @@ struct fastrpc_device {
 struct fastrpc_user {
 	struct list_head user;
 	struct list_head maps;
+	struct rb_root map_tree;
 	struct list_head pending;
 	struct list_head mmaps;
 
@@ -301,6 +318,8 @@ struct fastrpc_user {
 	int tgid;
 	int pd;
 	bool is_secure_dev;
+	/* async invokes on @pending, protected by @lock */
+	unsigned int nr_async;
 	/* Lock for lists */
 	spinlock_t lock;
 	/* lock for allocations */
@@ -339,6 +358,8 @@ static void fastrpc_free_map(struct kref *ref)
 	if (map->fl) {
 		spin_lock(&map->fl->lock);
 		list_del(&map->node);
+		if (!RB_EMPTY_NODE(&map->rb_node))
+			rb_erase(&map->rb_node, &map->fl->map_tree);
 		spin_unlock(&map->fl->lock);
 		map->fl = NULL;
 	}
@@ -360,32 +381,75 @@ static int fastrpc_map_get(struct fastrpc_map *map)
 	return kref_get_unless_zero(&map->refcount) ? 0 : -ENOENT;
 }
 
+/*
+ * Every buffer argument of every invoke is looked up by fd, so index the
+ * maps in an rbtree rather than walking fl->maps. Equal fds are inserted to
+ * the right, and lookups return the leftmost match, i.e. the oldest map, as
+ * the list walk did. Both must be called with fl->lock held.
+ */
+static struct fastrpc_map *fastrpc_map_tree_find(struct fastrpc_user *fl,
+						 int fd)
+{
+	struct rb_node *n = fl->map_tree.rb_node;
+	struct fastrpc_map *map, *found = NULL;
+
+	while (n) {
+		map = rb_entry(n, struct fastrpc_map, rb_node);
+		if (fd < map->fd) {
+			n = n->rb_left;
+		} else if (fd > map->fd) {
+			n = n->rb_right;
+		} else {
+			found = map;
+			n = n->rb_left;
+		}
+	}
+
+	return found;
+}
+
+static void fastrpc_map_tree_insert(struct fastrpc_user *fl,
+				    struct fastrpc_map *map)
+{
+	struct rb_node **link = &fl->map_tree.rb_node, *parent = NULL;
+	struct fastrpc_map *entry;
+
+	while (*link) {
+		parent = *link;
+		entry = rb_entry(parent, struct fastrpc_map, rb_node);
+		if (map->fd < entry->fd)
+			link = &parent->rb_left;
+		else
+			link = &parent->rb_right;
+	}
+
+	rb_link_node(&map->rb_node, parent, link);
+	rb_insert_color(&map->rb_node, &fl->map_tree);
+}
 
 static int fastrpc_map_lookup(struct fastrpc_user *fl, int fd,
 			    struct fastrpc_map **ppmap, bool take_ref)
 {
 	struct fastrpc_session_ctx *sess = fl->sctx;
-	struct fastrpc_map *map = NULL;
+	struct fastrpc_map *map;
 	int ret = -ENOENT;
 
 	spin_lock(&fl->lock);
-	list_for_each_entry(map, &fl->maps, node) {
-		if (map->fd != fd)
-			continue;
-
+	map = fastrpc_map_tree_find(fl, fd);
+	if (map) {
 		if (take_ref) {
 			ret = fastrpc_map_get(map);
 			if (ret) {
 				dev_dbg(sess->dev, "%s: Failed to get map fd=%d ret=%d\n",
 					__func__, fd, ret);
-				break;
+				goto unlock;
 			}
 		}
 
 		*ppmap = map;
 		ret = 0;
-		break;
 	}
+unlock:
 	spin_unlock(&fl->lock);
 
 	return ret;
@@ -476,6 +540,41 @@ static void fastrpc_channel_ctx_put(struct fastrpc_channel_ctx *cctx)
 	kref_put(&cctx->refcount, fastrpc_channel_ctx_free);
 }
 
+/*
+ * Small invokes are dominated by the dma_alloc_coherent()/dma_free_coherent()
+ * of their metadata buffer, so keep a few page sized ones per session.
+ */
+static struct fastrpc_buf *fastrpc_meta_cache_get(struct fastrpc_channel_ctx *cctx,
+						  struct fastrpc_session_ctx *sess)
+{
+	struct fastrpc_buf *buf = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&cctx->lock, flags);
+	if (sess->meta_cached)
+		buf = sess->meta_cache[--sess->meta_cached];
+	spin_unlock_irqrestore(&cctx->lock, flags);
+
+	return buf;
+}
+
+static void fastrpc_meta_cache_put(struct fastrpc_channel_ctx *cctx,
+				   struct fastrpc_session_ctx *sess,
+				   struct fastrpc_buf *buf)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&cctx->lock, flags);
+	if (sess->valid && sess->meta_cached < FASTRPC_META_CACHE_MAX) {
+		sess->meta_cache[sess->meta_cached++] = buf;
+		buf = NULL;
+	}
+	spin_unlock_irqrestore(&cctx->lock, flags);
+
+	if (buf)
+		fastrpc_buf_free(buf);
+}
+
 static void fastrpc_context_free(struct kref *ref)
 {
 	struct fastrpc_invoke_ctx *ctx;
@@ -489,7 +588,9 @@ static void fastrpc_context_free(struct kref *ref)
 	for (i = 0; i < ctx->nbufs; i++)
 		fastrpc_map_put(ctx->maps[i]);
 
-	if (ctx->buf)
+	if (ctx->buf && ctx->buf_sess)
+		fastrpc_meta_cache_put(cctx, ctx->buf_sess, ctx->buf);
+	else if (ctx->buf)
 		fastrpc_buf_free(ctx->buf);
 
 	spin_lock_irqsave(&cctx->lock, flags);
@@ -498,6 +599,9 @@ static void fastrpc_context_free(struct kref *ref)
 
 	kfree(ctx->maps);
 	kfree(ctx->olaps);
+	/* async invokes own their args, synchronous ones borrow the caller's */
+	if (ctx->async)
+		kfree(ctx->args);
 	kfree(ctx);
 
 	fastrpc_channel_ctx_put(cctx);
@@ -536,6 +640,7 @@ static int olaps_cmp(const void *a, const void *b)
 
 static void fastrpc_get_buff_overlaps(struct fastrpc_invoke_ctx *ctx)
 {
+	bool sorted = true;
 	u64 max_end = 0;
 	int i;
 
@@ -543,8 +648,20 @@ static void fastrpc_get_buff_overlaps(struct fastrpc_invoke_ctx *ctx)
 		ctx->olaps[i].start = ctx->args[i].ptr;
 		ctx->olaps[i].end = ctx->olaps[i].start + ctx->args[i].length;
 		ctx->olaps[i].raix = i;
+
+		/* Ascending and disjoint, the common case, needs no sort */
+		if (ctx->olaps[i].start < max_end)
+			sorted = false;
+		max_end = max(max_end, ctx->olaps[i].end);
+		ctx->olaps[i].mstart = ctx->olaps[i].start;
+		ctx->olaps[i].mend = ctx->olaps[i].end;
+		ctx->olaps[i].offset = 0;
 	}
 
+	if (sorted)
+		return;
+
+	max_end = 0;
 	sort(ctx->olaps, ctx->nbufs, sizeof(*ctx->olaps), olaps_cmp, NULL);
 
 	for (i = 0; i < ctx->nbufs; ++i) {
@@ -767,6 +884,7 @@ static int fastrpc_map_create(struct fastrpc_user *fl, int fd,
 		return -ENOMEM;
 
 	INIT_LIST_HEAD(&map->node);
+	RB_CLEAR_NODE(&map->rb_node);
 	kref_init(&map->refcount);
 
 	map->fl = fl;
@@ -823,6 +941,7 @@ static int fastrpc_map_create(struct fastrpc_user *fl, int fd,
 	}
 	spin_lock(&fl->lock);
 	list_add_tail(&map->node, &fl->maps);
+	fastrpc_map_tree_insert(fl, map);
 	spin_unlock(&fl->lock);
 	*ppmap = map;
 
@@ -953,10 +1072,19 @@ static int fastrpc_get_args(u32 kernel, struct fastrpc_invoke_ctx *ctx)
 
 	ctx->msg_sz = pkt_size;
 
-	if (ctx->fl->sctx->sid)
+	if (ctx->fl->sctx->sid && pkt_size <= PAGE_SIZE) {
+		ctx->buf = fastrpc_meta_cache_get(ctx->cctx, ctx->fl->sctx);
+		if (ctx->buf)
+			ctx->buf->fl = ctx->fl;
+		else
+			err = fastrpc_buf_alloc(ctx->fl, dev, PAGE_SIZE, &ctx->buf);
+		if (!err)
+			ctx->buf_sess = ctx->fl->sctx;
+	} else if (ctx->fl->sctx->sid) {
 		err = fastrpc_buf_alloc(ctx->fl, dev, pkt_size, &ctx->buf);
-	else
+	} else {
 		err = fastrpc_remote_heap_alloc(ctx->fl, dev, pkt_size, &ctx->buf);
+	}
 	if (err)
 		return err;
 
@@ -1215,6 +1343,165 @@ static int fastrpc_internal_invoke(struct fastrpc_user *fl,  u32 kernel,
 	return err;
 }
 
+/*
+ * Send an invoke without waiting for the DSP. The context stays on
+ * fl->pending and takes ownership of @args; output buffers are copied back
+ * when the response is reaped by fastrpc_async_response().
+ */
+static int fastrpc_internal_invoke_async(struct fastrpc_user *fl, u32 handle,
+					 u32 sc, struct fastrpc_invoke_args *args,
+					 u64 job_id)
+{
+	struct fastrpc_invoke_ctx *ctx;
+	int err;
+
+	if (!fl->sctx) {
+		err = -EINVAL;
+		goto free_args;
+	}
+
+	if (!fl->cctx->rpdev) {
+		err = -EPIPE;
+		goto free_args;
+	}
+
+	if (handle == FASTRPC_INIT_HANDLE) {
+		dev_warn_ratelimited(fl->sctx->dev, "user app trying to send a kernel RPC message (%d)\n",  handle);
+		err = -EPERM;
+		goto free_args;
+	}
+
+	spin_lock(&fl->lock);
+	if (fl->nr_async >= FASTRPC_ASYNC_MAX) {
+		spin_unlock(&fl->lock);
+		err = -EBUSY;
+		goto free_args;
+	}
+	fl->nr_async++;
+	spin_unlock(&fl->lock);
+
+	ctx = fastrpc_context_alloc(fl, false, sc, args);
+	if (IS_ERR(ctx)) {
+		err = PTR_ERR(ctx);
+		spin_lock(&fl->lock);
+		fl->nr_async--;
+		spin_unlock(&fl->lock);
+		goto free_args;
+	}
+
+	ctx->async = true;
+	ctx->job_id = job_id;
+
+	err = fastrpc_get_args(false, ctx);
+	if (err)
+		goto bail;
+
+	/* make sure that all CPU memory writes are seen by DSP */
+	dma_wmb();
+	/* Send invoke buffer to remote dsp */
+	err = fastrpc_invoke_send(fl->sctx, ctx, false, handle);
+	if (err)
+		goto bail;
+
+	return 0;
+
+bail:
+	spin_lock(&fl->lock);
+	list_del(&ctx->node);
+	fl->nr_async--;
+	spin_unlock(&fl->lock);
+	fastrpc_context_put(ctx);
+	dev_dbg(fl->sctx->dev, "Error: Async invoke failed %d\n", err);
+
+	return err;
+
+free_args:
+	kfree(args);
+	return err;
+}
+
+/* Must be called with fl->lock held */
+static struct fastrpc_invoke_ctx *fastrpc_async_find_done(struct fastrpc_user *fl,
+							 bool *outstanding)
+{
+	struct fastrpc_invoke_ctx *ctx;
+
+	*outstanding = false;
+	list_for_each_entry(ctx, &fl->pending, node) {
+		if (!ctx->async)
+			continue;
+
+		*outstanding = true;
+		if (completion_done(&ctx->work))
+			return ctx;
+	}
+
+	return NULL;
+}
+
+static bool fastrpc_async_ready(struct fastrpc_user *fl)
+{
+	struct fastrpc_invoke_ctx *ctx;
+	bool outstanding;
+
+	spin_lock(&fl->lock);
+	ctx = fastrpc_async_find_done(fl, &outstanding);
+	spin_unlock(&fl->lock);
+
+	return ctx || !outstanding;
+}
+
+static int fastrpc_async_response(struct fastrpc_user *fl, char __user *argp,
+				  bool nonblock)
+{
+	struct fastrpc_async_response rsp = { 0 };
+	struct fastrpc_invoke_ctx *ctx;
+	bool outstanding;
+	int err;
+
+	/* Output buffers are copied into the address space of the caller */
+	if (fl->tgid != current->tgid)
+		return -EPERM;
+
+	for (;;) {
+		spin_lock(&fl->lock);
+		ctx = fastrpc_async_find_done(fl, &outstanding);
+		if (ctx) {
+			list_del(&ctx->node);
+			fl->nr_async--;
+		}
+		spin_unlock(&fl->lock);
+
+		if (ctx)
+			break;
+
+		if (!outstanding)
+			return -ENOENT;
+
+		if (nonblock)
+			return -EAGAIN;
+
+		err = wait_event_interruptible(fl->cctx->async_wq,
+					       fastrpc_async_ready(fl));
+		if (err)
+			return err;
+	}
+
+	/* make sure that all memory writes by DSP are seen by CPU */
+	dma_rmb();
+	/* populate all the output buffers with results */
+	err = fastrpc_put_args(ctx, false);
+
+	rsp.job_id = ctx->job_id;
+	rsp.result = err ? err : ctx->retval;
+	fastrpc_context_put(ctx);
+
+	if (copy_to_user(argp, &rsp, sizeof(rsp)))
+		return -EFAULT;
+
+	return 0;
+}
+
 static bool is_session_rejected(struct fastrpc_user *fl, bool unsigned_pd_request)
 {
 	/* Check if the device node is non-secure and channel is secure*/
@@ -1576,6 +1863,7 @@ static int fastrpc_device_open(struct inode *inode, struct file *filp)
 	mutex_init(&fl->mutex);
 	INIT_LIST_HEAD(&fl->pending);
 	INIT_LIST_HEAD(&fl->maps);
+	fl->map_tree = RB_ROOT;
 	INIT_LIST_HEAD(&fl->mmaps);
 	INIT_LIST_HEAD(&fl->user);
 	fl->tgid = current->tgid;
@@ -1689,6 +1977,33 @@ static int fastrpc_invoke(struct fastrpc_user *fl, char __user *argp)
 	return err;
 }
 
+static int fastrpc_invoke_async(struct fastrpc_user *fl, char __user *argp)
+{
+	struct fastrpc_invoke_args *args = NULL;
+	struct fastrpc_invoke_async inv;
+	u32 nscalars;
+
+	if (copy_from_user(&inv, argp, sizeof(inv)))
+		return -EFAULT;
+
+	/* nscalars is truncated here to max supported value */
+	nscalars = REMOTE_SCALARS_LENGTH(inv.sc);
+	if (nscalars) {
+		args = kcalloc(nscalars, sizeof(*args), GFP_KERNEL);
+		if (!args)
+			return -ENOMEM;
+
+		if (copy_from_user(args, (void __user *)(uintptr_t)inv.args,
+				   nscalars * sizeof(*args))) {
+			kfree(args);
+			return -EFAULT;
+		}
+	}
+
+	return fastrpc_internal_invoke_async(fl, inv.handle, inv.sc, args,
+					     inv.job_id);
+}
+
 static int fastrpc_get_info_from_dsp(struct fastrpc_user *fl, uint32_t *dsp_attr_buf,
 				     uint32_t dsp_attr_buf_len)
 {
@@ -2125,6 +2440,13 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int cmd,
 	case FASTRPC_IOCTL_GET_DSP_INFO:
 		err = fastrpc_get_dsp_info(fl, argp);
 		break;
+	case FASTRPC_IOCTL_INVOKE_ASYNC:
+		err = fastrpc_invoke_async(fl, argp);
+		break;
+	case FASTRPC_IOCTL_ASYNC_RESPONSE:
+		err = fastrpc_async_response(fl, argp,
+					     file->f_flags & O_NONBLOCK);
+		break;
 	default:
 		err = -ENOTTY;
 		break;
@@ -2133,11 +2455,43 @@ static long fastrpc_device_ioctl(struct file *file, unsigned int cmd,
 	return err;
 }
 
+/*
+ * io_uring passthrough: cmd_op carries the ioctl number and sqe->addr its
+ * argument. Every request may sleep waiting for the DSP, so the inline
+ * non-blocking attempt is always punted to io-wq.
+ */
+static int fastrpc_device_uring_cmd(struct io_uring_cmd *ioucmd,
+				    unsigned int issue_flags)
+{
+	if (issue_flags & IO_URING_F_NONBLOCK)
+		return -EAGAIN;
+
+	return fastrpc_device_ioctl(ioucmd->file, ioucmd->cmd_op,
+				    (unsigned long)READ_ONCE(ioucmd->sqe->addr));
+}
+
+static __poll_t fastrpc_device_poll(struct file *file, poll_table *wait)
+{
+	struct fastrpc_user *fl = (struct fastrpc_user *)file->private_data;
+	struct fastrpc_invoke_ctx *ctx;
+	bool outstanding;
+
+	poll_wait(file, &fl->cctx->async_wq, wait);
+
+	spin_lock(&fl->lock);
+	ctx = fastrpc_async_find_done(fl, &outstanding);
+	spin_unlock(&fl->lock);
+
+	return ctx ? EPOLLIN | EPOLLRDNORM : 0;
+}
+
 static const struct file_operations fastrpc_fops = {
 	.open = fastrpc_device_open,
 	.release = fastrpc_device_release,
 	.unlocked_ioctl = fastrpc_device_ioctl,
 	.compat_ioctl = fastrpc_device_ioctl,
+	.uring_cmd = fastrpc_device_uring_cmd,
+	.poll = fastrpc_device_poll,
 };
 
 static int fastrpc_cb_probe(struct platform_device *pdev)
@@ -2194,17 +2548,23 @@ static void fastrpc_cb_remove(struct platform_device *pdev)
 {
 	struct fastrpc_channel_ctx *cctx = dev_get_drvdata(pdev->dev.parent);
 	struct fastrpc_session_ctx *sess = dev_get_drvdata(&pdev->dev);
+	struct fastrpc_buf *bufs[FASTRPC_MAX_SESSIONS * FASTRPC_META_CACHE_MAX];
 	unsigned long flags;
-	int i;
+	int i, nbufs = 0;
 
 	spin_lock_irqsave(&cctx->lock, flags);
 	for (i = 0; i < FASTRPC_MAX_SESSIONS; i++) {
 		if (cctx->session[i].sid == sess->sid) {
 			cctx->session[i].valid = false;
 			cctx->sesscount--;
+			while (cctx->session[i].meta_cached)
+				bufs[nbufs++] = cctx->session[i].meta_cache[--cctx->session[i].meta_cached];
 		}
 	}
 	spin_unlock_irqrestore(&cctx->lock, flags);
+
+	for (i = 0; i < nbufs; i++)
+		fastrpc_buf_free(bufs[i]);
 }
 
 static const struct of_device_id fastrpc_match_table[] = {
@@ -2356,6 +2716,7 @@ static int fastrpc_rpmsg_probe(struct rpmsg_device *rpdev)
 	dma_set_mask_and_coherent(rdev, DMA_BIT_MASK(32));
 	INIT_LIST_HEAD(&data->users);
 	INIT_LIST_HEAD(&data->invoke_interrupted_mmaps);
+	init_waitqueue_head(&data->async_wq);
 	spin_lock_init(&data->lock);
 	idr_init(&data->ctx_idr);
 	data->domain_id = domain_id;
@@ -2404,6 +2765,9 @@ static void fastrpc_rpmsg_remove(struct rpmsg_device *rpdev)
 		fastrpc_notify_users(user);
 	spin_unlock_irqrestore(&cctx->lock, flags);
 
+	/* Let ASYNC_RESPONSE and poll() see the aborted invokes */
+	wake_up_interruptible(&cctx->async_wq);
+
 	if (cctx->fdevice)
 		misc_deregister(&cctx->fdevice->miscdev);
 
@@ -2446,6 +2810,8 @@ static int fastrpc_rpmsg_callback(struct rpmsg_device *rpdev, void *data,
 
 	ctx->retval = rsp->retval;
 	complete(&ctx->work);
+	if (ctx->async)
+		wake_up_interruptible(&cctx->async_wq);
 
 	/*
 	 * The DMA buffer associated with the context cannot be freed in
@@ -23,6 +23,7 @@
 #include "sdhci-cqhci.h"
 #include "sdhci-pltfm.h"
 #include "cqhci.h"
+#include "mmc_hsq.h"
 
 #define CORE_MCI_VERSION		0x50
 #define CORE_VERSION_MAJOR_SHIFT	28
@@ -256,6 +257,17 @@ struct sdhci_msm_variant_info {
 	const struct sdhci_msm_offset *offset;
 };
 
+/*
+ * Last good tuning phase per bus timing. An entry is only reused for the
+ * same card at the same clock and is dropped on a CRC error.
+ */
+struct sdhci_msm_tuning_cache {
+	unsigned int clock;
+	bool hs400_tuning;
+	bool valid;
+	u8 phase;
+};
+
 struct sdhci_msm_host {
 	struct platform_device *pdev;
 	void __iomem *core_mem;	/* MSM SDCC mapped address */
@@ -290,6 +302,8 @@ struct sdhci_msm_host {
 	u32 dll_config;
 	u32 ddr_config;
 	bool vqmmc_enabled;
+	bool use_hsq;
+	struct sdhci_msm_tuning_cache tuning_cache[MMC_TIMING_MMC_HS400 + 1];
 };
 
 static const struct sdhci_msm_offset *sdhci_priv_msm_offset(struct sdhci_host *host)
@@ -1183,6 +1197,59 @@ static void sdhci_msm_set_cdr(struct sdhci_host *host, bool enable)
 	}
 }
 
+static void sdhci_msm_tuning_cache_invalidate(struct sdhci_msm_host *msm_host)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(msm_host->tuning_cache); i++)
+		WRITE_ONCE(msm_host->tuning_cache[i].valid, false);
+}
+
+static struct sdhci_msm_tuning_cache *
+sdhci_msm_tuning_cache_entry(struct sdhci_msm_host *msm_host,
+			     struct mmc_ios *ios)
+{
+	if (ios->timing >= ARRAY_SIZE(msm_host->tuning_cache))
+		return NULL;
+	return &msm_host->tuning_cache[ios->timing];
+}
+
+/*
+ * Re-apply the phase found by the last full sweep for this card and timing
+ * and check it with a single tuning block, so that re-initialising a card
+ * after runtime PM does not cost a full 16 phase sweep each time.
+ */
+static bool sdhci_msm_use_cached_phase(struct sdhci_host *host, u32 opcode,
+				       struct mmc_ios *ios, bool hs400_tuning)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
+	struct mmc_host *mmc = host->mmc;
+	struct sdhci_msm_tuning_cache *tc;
+
+	/* A card that is still being identified may not be the one we tuned */
+	if (!mmc->card)
+		return false;
+
+	tc = sdhci_msm_tuning_cache_entry(msm_host, ios);
+	if (!tc || !READ_ONCE(tc->valid) || tc->clock != ios->clock ||
+	    tc->hs400_tuning != hs400_tuning)
+		return false;
+
+	if (msm_init_cm_dll(host) || msm_config_cm_dll_phase(host, tc->phase))
+		return false;
+
+	if (mmc_send_tuning(mmc, opcode, NULL)) {
+		WRITE_ONCE(tc->valid, false);
+		return false;
+	}
+
+	msm_host->saved_tuning_phase = tc->phase;
+	dev_dbg(mmc_dev(mmc), "%s: Reusing tuning phase %d\n",
+		mmc_hostname(mmc), tc->phase);
+	return true;
+}
+
 static int sdhci_msm_execute_tuning(struct mmc_host *mmc, u32 opcode)
 {
 	struct sdhci_host *host = mmc_priv(mmc);
@@ -1192,6 +1259,8 @@ static int sdhci_msm_execute_tuning(struct mmc_host *mmc, u32 opcode)
 	struct mmc_ios ios = host->mmc->ios;
 	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
 	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
+	struct sdhci_msm_tuning_cache *tc;
+	bool hs400_tuning;
 
 	if (!sdhci_msm_is_tuning_needed(host)) {
 		msm_host->use_cdr = false;
@@ -1213,12 +1282,18 @@ static int sdhci_msm_execute_tuning(struct mmc_host *mmc, u32 opcode)
 	 * - select MCLK/2 in VENDOR_SPEC
 	 * - program MCLK to 400MHz (or nearest supported) in GCC
 	 */
-	if (host->flags & SDHCI_HS400_TUNING) {
+	hs400_tuning = host->flags & SDHCI_HS400_TUNING;
+	if (hs400_tuning) {
 		sdhci_msm_hc_select_mode(host);
 		msm_set_clock_rate_for_bus_mode(host, ios.clock);
 		host->flags &= ~SDHCI_HS400_TUNING;
 	}
 
+	if (sdhci_msm_use_cached_phase(host, opcode, &ios, hs400_tuning)) {
+		msm_host->tuning_done = true;
+		return 0;
+	}
+
 retry:
 	/* First of all reset the tuning block */
 	rc = msm_init_cm_dll(host);
@@ -1275,6 +1350,14 @@ static int sdhci_msm_execute_tuning(struct mmc_host *mmc, u32 opcode)
 		msm_host->saved_tuning_phase = phase;
 		dev_dbg(mmc_dev(mmc), "%s: Setting the tuning phase to %d\n",
 			 mmc_hostname(mmc), phase);
+
+		tc = sdhci_msm_tuning_cache_entry(msm_host, &ios);
+		if (tc) {
+			tc->clock = ios.clock;
+			tc->hs400_tuning = hs400_tuning;
+			tc->phase = phase;
+			WRITE_ONCE(tc->valid, true);
+		}
 	} else {
 		if (--tuning_seq_cnt)
 			goto retry;
@@ -1289,6 +1372,26 @@ static int sdhci_msm_execute_tuning(struct mmc_host *mmc, u32 opcode)
 	return rc;
 }
 
+static void sdhci_msm_request_done(struct sdhci_host *host,
+				   struct mmc_request *mrq)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
+
+	/* Forget cached tuning phases on the same errors the core re-tunes on */
+	if ((mrq->cmd && mrq->cmd->error == -EILSEQ) ||
+	    (mrq->sbc && mrq->sbc->error == -EILSEQ) ||
+	    (mrq->data && mrq->data->error == -EILSEQ) ||
+	    (mrq->stop && mrq->stop->error == -EILSEQ))
+		sdhci_msm_tuning_cache_invalidate(msm_host);
+
+	/* Validate if the request was from software queue firstly. */
+	if (msm_host->use_hsq && mmc_hsq_finalize_request(host->mmc, mrq))
+		return;
+
+	mmc_request_done(host->mmc, mrq);
+}
+
 /*
  * sdhci_msm_hs400 - Calibrate the DLL for HS400 bus speed mode operation.
  * This needs to be done for both tuning and enhanced_strobe mode.
@@ -1922,6 +2025,12 @@ static u32 sdhci_msm_cqe_irq(struct sdhci_host *host, u32 intmask)
 	if (!sdhci_cqe_irq(host, intmask, &cmd_error, &data_error))
 		return intmask;
 
+	if (cmd_error == -EILSEQ || data_error == -EILSEQ) {
+		struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+
+		sdhci_msm_tuning_cache_invalidate(sdhci_pltfm_priv(pltfm_host));
+	}
+
 	cqhci_irq(host->mmc, intmask, cmd_error, data_error);
 	return 0;
 }
@@ -2063,6 +2172,51 @@ static int sdhci_msm_cqe_add_host(struct sdhci_host *host,
 	return ret;
 }
 
+/*
+ * Without CQE, let the host software queue prepare the next request while
+ * the current one is on the bus. For non-removable cards the next request
+ * is issued straight from the completion interrupt.
+ */
+static int sdhci_msm_hsq_add_host(struct sdhci_host *host,
+				  struct platform_device *pdev)
+{
+	struct sdhci_pltfm_host *pltfm_host = sdhci_priv(host);
+	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
+	struct mmc_hsq *hsq;
+	int ret;
+
+	if (!mmc_card_is_removable(host->mmc))
+		host->mmc_host_ops.request_atomic = sdhci_request_atomic;
+	else
+		host->always_defer_done = true;
+
+	ret = sdhci_setup_host(host);
+	if (ret)
+		return ret;
+
+	hsq = devm_kzalloc(&pdev->dev, sizeof(*hsq), GFP_KERNEL);
+	if (!hsq) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+
+	ret = mmc_hsq_init(hsq, host->mmc);
+	if (ret)
+		goto cleanup;
+	msm_host->use_hsq = true;
+
+	ret = __sdhci_add_host(host);
+	if (ret)
+		goto cleanup;
+
+	return 0;
+
+cleanup:
+	msm_host->use_hsq = false;
+	sdhci_cleanup_host(host);
+	return ret;
+}
+
 /*
  * Platform specific register write functions. This is so that, if any
  * register write needs to be followed up by platform specific actions,
@@ -2331,6 +2485,7 @@ static const struct sdhci_ops sdhci_msm_ops = {
 	.dump_vendor_regs = sdhci_msm_dump_vendor_regs,
 	.set_power = sdhci_set_power_noreg,
 	.set_timeout = sdhci_msm_set_timeout,
+	.request_done = sdhci_msm_request_done,
 };
 
 static const struct sdhci_pltfm_data sdhci_msm_pdata = {
@@ -2644,7 +2799,7 @@ static int sdhci_msm_probe(struct platform_device *pdev)
 	if (of_property_read_bool(node, "supports-cqe"))
 		ret = sdhci_msm_cqe_add_host(host, pdev);
 	else
-		ret = sdhci_add_host(host);
+		ret = sdhci_msm_hsq_add_host(host, pdev);
 	if (ret)
 		goto pm_runtime_disable;
 
@@ -2696,6 +2851,9 @@ static __maybe_unused int sdhci_msm_runtime_suspend(struct device *dev)
 	struct sdhci_msm_host *msm_host = sdhci_pltfm_priv(pltfm_host);
 	unsigned long flags;
 
+	if (msm_host->use_hsq)
+		mmc_hsq_suspend(host->mmc);
+
 	spin_lock_irqsave(&host->lock, flags);
 	host->runtime_suspended = true;
 	spin_unlock_irqrestore(&host->lock, flags);
@@ -2740,6 +2898,9 @@ static __maybe_unused int sdhci_msm_runtime_resume(struct device *dev)
 	host->runtime_suspended = false;
 	spin_unlock_irqrestore(&host->lock, flags);
 
+	if (msm_host->use_hsq)
+		ret = mmc_hsq_resume(host->mmc);
+
 	return ret;
 }
 
@@ -1685,7 +1685,11 @@ static int gsi_channel_poll(struct napi_struct *napi, int budget)
 		gsi_trans_complete(trans);
 	}
 
-	if (count < budget && napi_complete(napi))
+	/* Passing the work done lets the core honor napi_defer_hard_irqs
+	 * and gro_flush_timeout, and leaves the interrupt disabled while a
+	 * busy poller owns the NAPI instance.
+	 */
+	if (count < budget && napi_complete_done(napi, count))
 		gsi_irq_ieob_enable_one(channel->gsi, channel->evt_ring_id);
 
 	return count;
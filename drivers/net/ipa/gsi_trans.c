@@ -317,6 +317,14 @@ gsi_trans_tre_reserve(struct gsi_trans_info *trans_info, u32 tre_count)
 static void
 gsi_trans_tre_release(struct gsi_trans_info *trans_info, u32 tre_count)
 {
+	/* The TRE count is the only thing shared between the transaction
+	 * producer and the NAPI consumer.  Everything the consumer did to
+	 * the transaction being released (and to its scatterlist and
+	 * command pool elements) must be visible before its TREs can be
+	 * reserved again.  The cmpxchg in gsi_trans_tre_reserve() is
+	 * fully ordered, so that pairs with the barrier here.
+	 */
+	smp_mb__before_atomic();
 	atomic_add(tre_count, &trans_info->tre_avail);
 }
 
@@ -434,26 +442,25 @@ void gsi_trans_cmd_add(struct gsi_trans *trans, void *buf, u32 size,
 	trans->cmd_opcode[which] = opcode;
 }
 
-/* Add a page transfer to a transaction.  It will fill the only TRE. */
-int gsi_trans_page_add(struct gsi_trans *trans, struct page *page, u32 size,
-		       u32 offset)
+/* Add a page the caller has already mapped for DMA.  It will fill the
+ * only TRE, and the mapping is left alone when the transaction completes.
+ */
+void gsi_trans_page_dma_add(struct gsi_trans *trans, struct page *page,
+			    dma_addr_t addr, u32 size, u32 offset)
 {
 	struct scatterlist *sg = &trans->sgl[0];
-	int ret;
 
 	if (WARN_ON(trans->rsvd_count != 1))
-		return -EINVAL;
+		return;
 	if (WARN_ON(trans->used_count))
-		return -EINVAL;
+		return;
 
 	sg_set_page(sg, page, size, offset);
-	ret = dma_map_sg(trans->gsi->dev, sg, 1, trans->direction);
-	if (!ret)
-		return -ENOMEM;
-
-	trans->used_count++;	/* Transaction now owns the (DMA mapped) page */
+	sg_dma_address(sg) = addr + offset;
+	sg_dma_len(sg) = size;
 
-	return 0;
+	trans->premapped = true;
+	trans->used_count++;	/* Transaction now owns the page */
 }
 
 /* Add an SKB transfer to a transaction.  No other TREs will be used. */
@@ -629,7 +636,7 @@ void gsi_trans_commit_wait(struct gsi_trans *trans)
 void gsi_trans_complete(struct gsi_trans *trans)
 {
 	/* If the entire SGL was mapped when added, unmap it now */
-	if (trans->direction != DMA_NONE)
+	if (trans->direction != DMA_NONE && !trans->premapped)
 		dma_unmap_sg(trans->gsi->dev, trans->sgl, trans->used_count,
 			     trans->direction);
 
@@ -667,6 +674,18 @@ void gsi_channel_trans_cancel_pending(struct gsi_channel *channel)
 	napi_schedule(&channel->napi);
 }
 
+/* Complete the transactions of a channel whose NAPI is disabled */
+void gsi_channel_trans_flush(struct gsi *gsi, u32 channel_id)
+{
+	struct gsi_channel *channel = &gsi->channel[channel_id];
+	struct gsi_trans *trans;
+
+	while ((trans = gsi_channel_trans_complete(channel))) {
+		gsi_trans_move_polled(trans);
+		gsi_trans_complete(trans);
+	}
+}
+
 /* Issue a command to read a single byte from a channel */
 int gsi_trans_read_byte(struct gsi *gsi, u32 channel_id, dma_addr_t addr)
 {
@@ -52,6 +52,7 @@ struct gsi_trans {
 	u8 channel_id;
 
 	bool cancelled;			/* true if transaction was cancelled */
+	bool premapped;			/* true if buffer DMA-mapped by caller */
 
 	u8 rsvd_count;			/* # TREs requested */
 	u8 used_count;			/* # entries used in sgl[] */
@@ -173,14 +174,18 @@ void gsi_trans_cmd_add(struct gsi_trans *trans, void *buf, u32 size,
 		       dma_addr_t addr, enum ipa_cmd_opcode opcode);
 
 /**
- * gsi_trans_page_add() - Add a page transfer to a transaction
+ * gsi_trans_page_dma_add() - Add a DMA-mapped page transfer to a transaction
  * @trans:	Transaction
  * @page:	Page pointer
+ * @addr:	DMA address of the start of the page
  * @size:	Number of bytes (starting at offset) to transfer
  * @offset:	Offset within page for start of transfer
+ *
+ * The caller owns the DMA mapping of the page; it is neither mapped
+ * here nor unmapped when the transaction completes.
  */
-int gsi_trans_page_add(struct gsi_trans *trans, struct page *page, u32 size,
-		       u32 offset);
+void gsi_trans_page_dma_add(struct gsi_trans *trans, struct page *page,
+			    dma_addr_t addr, u32 size, u32 offset);
 
 /**
  * gsi_trans_skb_add() - Add a socket transfer to a transaction
@@ -226,4 +231,15 @@ int gsi_trans_read_byte(struct gsi *gsi, u32 channel_id, dma_addr_t addr);
  */
 void gsi_trans_read_byte_done(struct gsi *gsi, u32 channel_id);
 
+/**
+ * gsi_channel_trans_flush() - Complete a stopped channel's transactions
+ * @gsi:	GSI pointer
+ * @channel_id:	Channel whose completed transactions are released
+ *
+ * Transactions cancelled by a channel reset are normally completed by
+ * NAPI polling.  When the channel is being torn down NAPI is disabled,
+ * so this completes them (and releases their buffers) directly.
+ */
+void gsi_channel_trans_flush(struct gsi *gsi, u32 channel_id);
+
 #endif /* _GSI_TRANS_H_ */
@@ -6,10 +6,13 @@
 
 #include <linux/bitfield.h>
 #include <linux/bits.h>
+#include <linux/bpf_trace.h>
 #include <linux/device.h>
 #include <linux/dma-direction.h>
 #include <linux/if_rmnet.h>
 #include <linux/types.h>
+#include <net/busy_poll.h>
+#include <net/page_pool/helpers.h>
 
 #include "gsi.h"
 #include "gsi_trans.h"
@@ -1300,28 +1303,26 @@ static void ipa_endpoint_status(struct ipa_endpoint *endpoint)
 static int ipa_endpoint_replenish_one(struct ipa_endpoint *endpoint,
 				      struct gsi_trans *trans)
 {
+	u32 buffer_size = endpoint->config.rx.buffer_size;
 	struct page *page;
-	u32 buffer_size;
 	u32 offset;
-	u32 len;
-	int ret;
+	u32 size;
 
-	buffer_size = endpoint->config.rx.buffer_size;
-	page = dev_alloc_pages(get_order(buffer_size));
+	/* The page pool hands out whole pages for buffers larger than
+	 * half its page size, and fragments of a shared page otherwise.
+	 * Either way the buffer is already mapped for DMA.
+	 */
+	size = buffer_size;
+	page = page_pool_dev_alloc(endpoint->page_pool, &offset, &size);
 	if (!page)
 		return -ENOMEM;
 
 	/* Offset the buffer to make space for skb headroom */
-	offset = NET_SKB_PAD;
-	len = buffer_size - offset;
-
-	ret = gsi_trans_page_add(trans, page, len, offset);
-	if (ret)
-		put_page(page);
-	else
-		trans->data = page;	/* transaction owns page now */
+	gsi_trans_page_dma_add(trans, page, page_pool_get_dma_addr(page),
+			       buffer_size - NET_SKB_PAD, offset + NET_SKB_PAD);
+	trans->data = page;	/* transaction owns page now */
 
-	return ret;
+	return 0;
 }
 
 /**
@@ -1401,27 +1402,166 @@ static void ipa_endpoint_replenish_work(struct work_struct *work)
 	ipa_endpoint_replenish(endpoint);
 }
 
-static void ipa_endpoint_skb_copy(struct ipa_endpoint *endpoint,
-				  void *data, u32 len, u32 extra)
+/* Record the NAPI instance that received an skb, so sockets it reaches
+ * can busy-poll the endpoint's GSI channel.
+ */
+static void ipa_endpoint_skb_mark_napi_id(struct ipa_endpoint *endpoint,
+					  struct sk_buff *skb)
 {
-	struct sk_buff *skb;
+	struct gsi *gsi = &endpoint->ipa->gsi;
 
-	if (!endpoint->netdev)
-		return;
+	skb_mark_napi_id(skb, &gsi->channel[endpoint->channel_id].napi);
+}
+
+static struct sk_buff *ipa_endpoint_skb_alloc(void *data, u32 len, u32 extra)
+{
+	struct sk_buff *skb;
 
 	skb = __dev_alloc_skb(len, GFP_ATOMIC);
 	if (skb) {
-		/* Copy the data into the socket buffer and receive it */
+		/* Copy the data into the socket buffer */
 		skb_put(skb, len);
 		memcpy(skb->data, data, len);
 		skb->truesize += extra;
 	}
 
-	ipa_modem_skb_rx(endpoint->netdev, skb);
+	return skb;
+}
+
+/* Copy a received packet into a socket buffer, and add it to a list
+ * of buffers to be passed to the network stack together.
+ */
+static void ipa_endpoint_skb_copy(struct ipa_endpoint *endpoint,
+				  void *data, u32 len, u32 extra,
+				  struct list_head *rx_list)
+{
+	struct sk_buff *skb;
+
+	if (!endpoint->netdev)
+		return;
+
+	skb = ipa_endpoint_skb_alloc(data, len, extra);
+	if (skb)
+		ipa_endpoint_skb_mark_napi_id(endpoint, skb);
+
+	ipa_modem_skb_rx_list_add(endpoint->netdev, skb, rx_list);
+}
+
+/* Run an RX endpoint's XDP program on one received frame.  The program
+ * sees the frame in place in the receive buffer, which stays with the
+ * transaction (and goes back to the page pool) whatever the verdict.
+ * Frames that are passed, transmitted or redirected are copied into a
+ * socket buffer, just as the RMNet driver does when de-aggregating.
+ */
+static void ipa_endpoint_xdp_rx(struct ipa_endpoint *endpoint,
+				struct bpf_prog *prog, void *data, u32 len,
+				u32 extra, struct list_head *rx_list)
+{
+	struct net_device *netdev = endpoint->netdev;
+	struct xdp_buff xdp;
+	struct sk_buff *skb;
+	u32 act;
+
+	/* Bytes on either side of the frame may belong to other frames in
+	 * the same buffer, so no headroom or tailroom is offered.
+	 */
+	xdp_init_buff(&xdp, len + SKB_DATA_ALIGN(sizeof(struct skb_shared_info)),
+		      &endpoint->xdp_rxq);
+	xdp_prepare_buff(&xdp, data, 0, len, false);
+
+	act = bpf_prog_run_xdp(prog, &xdp);
+	switch (act) {
+	case XDP_PASS:
+		ipa_endpoint_skb_copy(endpoint, xdp.data,
+				      xdp.data_end - xdp.data, extra, rx_list);
+		return;
+
+	case XDP_TX:
+	case XDP_REDIRECT:
+		skb = ipa_endpoint_skb_alloc(xdp.data, xdp.data_end - xdp.data,
+					     extra);
+		if (!skb)
+			break;
+
+		skb->dev = netdev;
+		skb->protocol = htons(ETH_P_MAP);
+		skb_reset_mac_header(skb);
+
+		if (act == XDP_TX) {
+			/* Go through the queue so we serialize with
+			 * ipa_start_xmit() and its power handling.
+			 */
+			(void)dev_queue_xmit(skb);
+			return;
+		}
+
+		if (!xdp_do_generic_redirect(netdev, skb, &xdp, prog))
+			return;
+
+		kfree_skb(skb);
+		break;
+
+	default:
+		bpf_warn_invalid_xdp_action(netdev, prog, act);
+		fallthrough;
+	case XDP_ABORTED:
+		trace_xdp_exception(netdev, prog, act);
+		break;
+
+	case XDP_DROP:
+		return;
+	}
+
+	/* Record the drop */
+	ipa_modem_skb_rx(netdev, NULL);
+}
+
+/* A QMAP receive buffer holds one or more frames (more than one if
+ * aggregation is enabled), each starting with a QMAP header.  Split it
+ * the same way the RMNet driver would, and run XDP on each frame.
+ */
+static void ipa_endpoint_xdp_qmap_rx(struct ipa_endpoint *endpoint,
+				     struct bpf_prog *prog, void *data,
+				     u32 total_len, struct list_head *rx_list)
+{
+	u32 unused = endpoint->config.rx.buffer_size - total_len;
+	struct ipa *ipa = endpoint->ipa;
+	u32 resid = total_len;
+
+	while (resid >= sizeof(struct rmnet_map_header)) {
+		const struct rmnet_map_header *header = data;
+		u32 extra;
+		u32 len;
+
+		len = be16_to_cpu(header->pkt_len);
+		if (!len)
+			break;
+		len += sizeof(*header);
+
+		if (endpoint->config.checksum) {
+			if (ipa->version < IPA_VERSION_4_5)
+				len += sizeof(struct rmnet_map_dl_csum_trailer);
+			else if (!(header->flags & MAP_CMD_FLAG))
+				len += sizeof(struct rmnet_map_v5_csum_header);
+		}
+
+		if (len > resid) {
+			dev_err_ratelimited(ipa->dev,
+					    "QMAP frame (%u bytes) exceeds buffer (%u bytes left)\n",
+					    len, resid);
+			break;
+		}
+
+		extra = DIV_ROUND_CLOSEST(unused * len, total_len);
+		ipa_endpoint_xdp_rx(endpoint, prog, data, len, extra, rx_list);
+
+		data += len;
+		resid -= len;
+	}
 }
 
 static bool ipa_endpoint_skb_build(struct ipa_endpoint *endpoint,
-				   struct page *page, u32 len)
+				   struct page *page, void *buf, u32 len)
 {
 	u32 buffer_size = endpoint->config.rx.buffer_size;
 	struct sk_buff *skb;
@@ -1432,11 +1572,14 @@ static bool ipa_endpoint_skb_build(struct ipa_endpoint *endpoint,
 
 	WARN_ON(len > SKB_WITH_OVERHEAD(buffer_size - NET_SKB_PAD));
 
-	skb = build_skb(page_address(page), buffer_size);
+	skb = build_skb(buf, buffer_size);
 	if (skb) {
 		/* Reserve the headroom and account for the data */
 		skb_reserve(skb, NET_SKB_PAD);
 		skb_put(skb, len);
+		/* Return the page to the pool when the stack is done */
+		skb_mark_for_recycle(skb);
+		ipa_endpoint_skb_mark_napi_id(endpoint, skb);
 	}
 
 	/* Receive the buffer (or record drop if unable to build it) */
@@ -1532,15 +1675,20 @@ ipa_endpoint_status_drop(struct ipa_endpoint *endpoint, const void *data)
 }
 
 static void ipa_endpoint_status_parse(struct ipa_endpoint *endpoint,
-				      struct page *page, u32 total_len)
+				      void *buf, u32 total_len,
+				      struct list_head *rx_list)
 {
 	u32 buffer_size = endpoint->config.rx.buffer_size;
-	void *data = page_address(page) + NET_SKB_PAD;
+	void *data = buf + NET_SKB_PAD;
 	u32 unused = buffer_size - total_len;
 	struct ipa *ipa = endpoint->ipa;
 	struct device *dev = ipa->dev;
+	struct bpf_prog *prog = NULL;
 	u32 resid = total_len;
 
+	if (endpoint->netdev)
+		prog = READ_ONCE(endpoint->xdp_prog);
+
 	while (resid) {
 		u32 length;
 		u32 align;
@@ -1585,7 +1733,12 @@ static void ipa_endpoint_status_parse(struct ipa_endpoint *endpoint,
 			 * buffer.
 			 */
 			extra = DIV_ROUND_CLOSEST(unused * len, total_len);
-			ipa_endpoint_skb_copy(endpoint, data2, length, extra);
+			if (prog)
+				ipa_endpoint_xdp_rx(endpoint, prog, data2,
+						    length, extra, rx_list);
+			else
+				ipa_endpoint_skb_copy(endpoint, data2, length,
+						      extra, rx_list);
 		}
 
 		/* Consume status and the full packet it describes */
@@ -1597,7 +1750,11 @@ static void ipa_endpoint_status_parse(struct ipa_endpoint *endpoint,
 void ipa_endpoint_trans_complete(struct ipa_endpoint *endpoint,
 				 struct gsi_trans *trans)
 {
+	LIST_HEAD(rx_list);
+	struct bpf_prog *prog;
 	struct page *page;
+	u32 offset;
+	void *buf;
 
 	if (endpoint->toward_ipa)
 		return;
@@ -1605,12 +1762,31 @@ void ipa_endpoint_trans_complete(struct ipa_endpoint *endpoint,
 	if (trans->cancelled)
 		goto done;
 
-	/* Parse or build a socket buffer using the actual received length */
+	/* The page pool only syncs buffers for the device; sync the part
+	 * the hardware wrote before looking at it.
+	 */
 	page = trans->data;
+	offset = trans->sgl[0].offset;
+	page_pool_dma_sync_for_cpu(endpoint->page_pool, page, offset,
+				   trans->len);
+	buf = page_address(page) + offset - NET_SKB_PAD;
+
+	/* Parse or build a socket buffer using the actual received length */
+	prog = endpoint->netdev ? READ_ONCE(endpoint->xdp_prog) : NULL;
 	if (endpoint->config.status_enable)
-		ipa_endpoint_status_parse(endpoint, page, trans->len);
-	else if (ipa_endpoint_skb_build(endpoint, page, trans->len))
+		ipa_endpoint_status_parse(endpoint, buf, trans->len, &rx_list);
+	else if (prog && endpoint->config.qmap)
+		ipa_endpoint_xdp_qmap_rx(endpoint, prog, buf + NET_SKB_PAD,
+					 trans->len, &rx_list);
+	else if (prog)
+		ipa_endpoint_xdp_rx(endpoint, prog, buf + NET_SKB_PAD,
+				    trans->len, 0, &rx_list);
+	else if (ipa_endpoint_skb_build(endpoint, page, buf, trans->len))
 		trans->data = NULL;	/* Pages have been consumed */
+
+	/* Packets split out of one buffer go up the stack as a batch */
+	if (!list_empty(&rx_list))
+		ipa_modem_skb_rx_list(&rx_list);
 done:
 	ipa_endpoint_replenish(endpoint);
 }
@@ -1632,10 +1808,25 @@ void ipa_endpoint_trans_release(struct ipa_endpoint *endpoint,
 		struct page *page = trans->data;
 
 		if (page)
-			put_page(page);
+			page_pool_put_full_page(endpoint->page_pool, page,
+						false);
 	}
 }
 
+int ipa_endpoint_xdp_rxq_register(struct ipa_endpoint *endpoint)
+{
+	struct gsi *gsi = &endpoint->ipa->gsi;
+	struct gsi_channel *channel = &gsi->channel[endpoint->channel_id];
+
+	return xdp_rxq_info_reg(&endpoint->xdp_rxq, endpoint->netdev, 0,
+				channel->napi.napi_id);
+}
+
+void ipa_endpoint_xdp_rxq_unregister(struct ipa_endpoint *endpoint)
+{
+	xdp_rxq_info_unreg(&endpoint->xdp_rxq);
+}
+
 void ipa_endpoint_default_route_set(struct ipa *ipa, u32 endpoint_id)
 {
 	const struct reg *reg;
@@ -1925,17 +2116,56 @@ void ipa_endpoint_resume(struct ipa *ipa)
 		ipa_modem_resume(ipa->modem_netdev);
 }
 
-static void ipa_endpoint_setup_one(struct ipa_endpoint *endpoint)
+/* Receive buffers come from a page pool, which keeps their pages mapped
+ * for DMA as they are recycled.  Once the pool is warm, steady-state
+ * receive touches neither the page allocator nor the IOMMU.
+ *
+ * The pool is not tied to the channel's NAPI context, because it is
+ * also refilled from the replenish work and when replenishing is
+ * (re)enabled.
+ */
+static int ipa_endpoint_page_pool_create(struct ipa_endpoint *endpoint)
+{
+	struct gsi *gsi = &endpoint->ipa->gsi;
+	struct gsi_channel *channel = &gsi->channel[endpoint->channel_id];
+	u32 order = get_order(endpoint->config.rx.buffer_size);
+	struct page_pool_params params = { };
+	struct page_pool *page_pool;
+
+	params.flags = PP_FLAG_DMA_MAP | PP_FLAG_DMA_SYNC_DEV;
+	params.order = order;
+	params.pool_size = channel->tre_count;
+	params.nid = dev_to_node(gsi->dev);
+	params.dev = gsi->dev;
+	params.dma_dir = DMA_FROM_DEVICE;
+	params.offset = 0;
+	params.max_len = PAGE_SIZE << order;
+
+	page_pool = page_pool_create(&params);
+	if (IS_ERR(page_pool))
+		return PTR_ERR(page_pool);
+
+	endpoint->page_pool = page_pool;
+
+	return 0;
+}
+
+static int ipa_endpoint_setup_one(struct ipa_endpoint *endpoint)
 {
 	struct gsi *gsi = &endpoint->ipa->gsi;
 	u32 channel_id = endpoint->channel_id;
+	int ret;
 
 	/* Only AP endpoints get set up */
 	if (endpoint->ee_id != GSI_EE_AP)
-		return;
+		return 0;
 
 	endpoint->skb_frag_max = gsi->channel[channel_id].trans_tre_max - 1;
 	if (!endpoint->toward_ipa) {
+		ret = ipa_endpoint_page_pool_create(endpoint);
+		if (ret)
+			return ret;
+
 		/* RX transactions require a single TRE, so the maximum
 		 * backlog is the same as the maximum outstanding TREs.
 		 */
@@ -1948,6 +2178,8 @@ static void ipa_endpoint_setup_one(struct ipa_endpoint *endpoint)
 	ipa_endpoint_program(endpoint);
 
 	__set_bit(endpoint->endpoint_id, endpoint->ipa->set_up);
+
+	return 0;
 }
 
 static void ipa_endpoint_teardown_one(struct ipa_endpoint *endpoint)
@@ -1958,14 +2190,16 @@ static void ipa_endpoint_teardown_one(struct ipa_endpoint *endpoint)
 		cancel_delayed_work_sync(&endpoint->replenish_work);
 
 	ipa_endpoint_reset(endpoint);
-}
 
-void ipa_endpoint_setup(struct ipa *ipa)
-{
-	u32 endpoint_id;
+	/* Pages still held by the network stack are released later */
+	if (!endpoint->toward_ipa) {
+		/* Return the pages of the transactions the reset cancelled */
+		gsi_channel_trans_flush(&endpoint->ipa->gsi,
+					endpoint->channel_id);
 
-	for_each_set_bit(endpoint_id, ipa->defined, ipa->endpoint_count)
-		ipa_endpoint_setup_one(&ipa->endpoint[endpoint_id]);
+		page_pool_destroy(endpoint->page_pool);
+		endpoint->page_pool = NULL;
+	}
 }
 
 void ipa_endpoint_teardown(struct ipa *ipa)
@@ -1976,6 +2210,25 @@ void ipa_endpoint_teardown(struct ipa *ipa)
 		ipa_endpoint_teardown_one(&ipa->endpoint[endpoint_id]);
 }
 
+int ipa_endpoint_setup(struct ipa *ipa)
+{
+	u32 endpoint_id;
+	int ret;
+
+	for_each_set_bit(endpoint_id, ipa->defined, ipa->endpoint_count) {
+		ret = ipa_endpoint_setup_one(&ipa->endpoint[endpoint_id]);
+		if (ret)
+			goto err_teardown;
+	}
+
+	return 0;
+
+err_teardown:
+	ipa_endpoint_teardown(ipa);
+
+	return ret;
+}
+
 void ipa_endpoint_deconfig(struct ipa *ipa)
 {
 	ipa->available_count = 0;
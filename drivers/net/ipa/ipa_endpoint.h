@@ -8,11 +8,14 @@
 
 #include <linux/types.h>
 #include <linux/workqueue.h>
+#include <net/xdp.h>
 
 #include "ipa_reg.h"
 #include "ipa_version.h"
 
+struct bpf_prog;
 struct net_device;
+struct page_pool;
 struct sk_buff;
 
 struct gsi_trans;
@@ -148,6 +151,9 @@ enum ipa_replenish_flag {
  * @replenish_flags:	Replenishing state flags
  * @replenish_count:	Total number of replenish transactions committed
  * @replenish_work:	Work item used for repeated replenish failures
+ * @page_pool:		Pool supplying DMA-mapped receive buffers (RX only)
+ * @xdp_prog:		XDP program run on received frames, if any (RX only)
+ * @xdp_rxq:		XDP receive queue information (RX only)
  */
 struct ipa_endpoint {
 	struct ipa *ipa;
@@ -167,6 +173,9 @@ struct ipa_endpoint {
 	DECLARE_BITMAP(replenish_flags, IPA_REPLENISH_COUNT);
 	u64 replenish_count;
 	struct delayed_work replenish_work;		/* global wq */
+	struct page_pool *page_pool;
+	struct bpf_prog *xdp_prog;
+	struct xdp_rxq_info xdp_rxq;
 };
 
 void ipa_endpoint_modem_hol_block_clear_all(struct ipa *ipa);
@@ -177,6 +186,9 @@ int ipa_endpoint_modem_exception_reset_all(struct ipa *ipa);
 
 int ipa_endpoint_skb_tx(struct ipa_endpoint *endpoint, struct sk_buff *skb);
 
+int ipa_endpoint_xdp_rxq_register(struct ipa_endpoint *endpoint);
+void ipa_endpoint_xdp_rxq_unregister(struct ipa_endpoint *endpoint);
+
 int ipa_endpoint_enable_one(struct ipa_endpoint *endpoint);
 void ipa_endpoint_disable_one(struct ipa_endpoint *endpoint);
 
@@ -186,7 +198,7 @@ void ipa_endpoint_resume_one(struct ipa_endpoint *endpoint);
 void ipa_endpoint_suspend(struct ipa *ipa);
 void ipa_endpoint_resume(struct ipa *ipa);
 
-void ipa_endpoint_setup(struct ipa *ipa);
+int ipa_endpoint_setup(struct ipa *ipa);
 void ipa_endpoint_teardown(struct ipa *ipa);
 
 int ipa_endpoint_config(struct ipa *ipa);
@@ -119,7 +119,9 @@ int ipa_setup(struct ipa *ipa)
 	if (ret)
 		return ret;
 
-	ipa_endpoint_setup(ipa);
+	ret = ipa_endpoint_setup(ipa);
+	if (ret)
+		goto err_gsi_teardown;
 
 	/* We need to use the AP command TX endpoint to perform other
 	 * initialization, so we enable first.
@@ -165,6 +167,7 @@ int ipa_setup(struct ipa *ipa)
 	ipa_endpoint_disable_one(command_endpoint);
 err_endpoint_teardown:
 	ipa_endpoint_teardown(ipa);
+err_gsi_teardown:
 	gsi_teardown(&ipa->gsi);
 
 	return ret;
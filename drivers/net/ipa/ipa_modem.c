@@ -4,6 +4,7 @@
  * Copyright (C) 2018-2024 Linaro Ltd.
  */
 
+#include <linux/bpf.h>
 #include <linux/errno.h>
 #include <linux/etherdevice.h>
 #include <linux/if_arp.h>
@@ -196,19 +197,63 @@ ipa_start_xmit(struct sk_buff *skb, struct net_device *netdev)
 	return NETDEV_TX_OK;
 }
 
-void ipa_modem_skb_rx(struct net_device *netdev, struct sk_buff *skb)
+/* Account for a received skb (or a drop, if it is NULL) */
+static bool ipa_modem_skb_rx_account(struct net_device *netdev,
+				     struct sk_buff *skb)
 {
 	struct net_device_stats *stats = &netdev->stats;
 
-	if (skb) {
-		skb->dev = netdev;
-		skb->protocol = htons(ETH_P_MAP);
-		stats->rx_packets++;
-		stats->rx_bytes += skb->len;
+	if (!skb) {
+		stats->rx_dropped++;
+		return false;
+	}
+
+	skb->dev = netdev;
+	skb->protocol = htons(ETH_P_MAP);
+	stats->rx_packets++;
+	stats->rx_bytes += skb->len;
 
+	return true;
+}
+
+void ipa_modem_skb_rx(struct net_device *netdev, struct sk_buff *skb)
+{
+	if (ipa_modem_skb_rx_account(netdev, skb))
 		(void)netif_receive_skb(skb);
-	} else {
-		stats->rx_dropped++;
+}
+
+void ipa_modem_skb_rx_list_add(struct net_device *netdev,
+			       struct sk_buff *skb, struct list_head *list)
+{
+	if (ipa_modem_skb_rx_account(netdev, skb))
+		list_add_tail(&skb->list, list);
+}
+
+void ipa_modem_skb_rx_list(struct list_head *list)
+{
+	netif_receive_skb_list(list);
+}
+
+static int ipa_xdp_setup(struct net_device *netdev, struct bpf_prog *prog)
+{
+	struct ipa_priv *priv = netdev_priv(netdev);
+	struct bpf_prog *old_prog;
+
+	/* The RX path picks up the new program on its next buffer */
+	old_prog = xchg(&priv->rx->xdp_prog, prog);
+	if (old_prog)
+		bpf_prog_put(old_prog);
+
+	return 0;
+}
+
+static int ipa_bpf(struct net_device *netdev, struct netdev_bpf *bpf)
+{
+	switch (bpf->command) {
+	case XDP_SETUP_PROG:
+		return ipa_xdp_setup(netdev, bpf->prog);
+	default:
+		return -EINVAL;
 	}
 }
 
@@ -216,6 +261,7 @@ static const struct net_device_ops ipa_modem_ops = {
 	.ndo_open	= ipa_open,
 	.ndo_stop	= ipa_stop,
 	.ndo_start_xmit	= ipa_start_xmit,
+	.ndo_bpf	= ipa_bpf,
 };
 
 /** ipa_modem_netdev_setup() - netdev setup function for the modem */
@@ -241,6 +287,7 @@ static void ipa_modem_netdev_setup(struct net_device *netdev)
 	netdev->needed_tailroom = IPA_NETDEV_TAILROOM;
 	netdev->watchdog_timeo = IPA_NETDEV_TIMEOUT * HZ;
 	netdev->hw_features = NETIF_F_SG;
+	netdev->xdp_features = NETDEV_XDP_ACT_BASIC | NETDEV_XDP_ACT_REDIRECT;
 }
 
 /** ipa_modem_suspend() - suspend callback
@@ -332,7 +379,13 @@ int ipa_modem_start(struct ipa *ipa)
 
 	ipa->modem_netdev = netdev;
 
-	ret = register_netdev(netdev);
+	ret = ipa_endpoint_xdp_rxq_register(priv->rx);
+	if (!ret) {
+		ret = register_netdev(netdev);
+		if (ret)
+			ipa_endpoint_xdp_rxq_unregister(priv->rx);
+	}
+
 	if (ret) {
 		ipa->modem_netdev = NULL;
 		priv->rx->netdev = NULL;
@@ -377,6 +430,7 @@ int ipa_modem_stop(struct ipa *ipa)
 		if (netdev->flags & IFF_UP)
 			(void)ipa_stop(netdev);
 		unregister_netdev(netdev);
+		ipa_endpoint_xdp_rxq_unregister(priv->rx);
 
 		ipa->modem_netdev = NULL;
 		priv->rx->netdev = NULL;
@@ -6,6 +6,7 @@
 #ifndef _IPA_MODEM_H_
 #define _IPA_MODEM_H_
 
+struct list_head;
 struct net_device;
 struct sk_buff;
 
@@ -15,6 +16,9 @@ int ipa_modem_start(struct ipa *ipa);
 int ipa_modem_stop(struct ipa *ipa);
 
 void ipa_modem_skb_rx(struct net_device *netdev, struct sk_buff *skb);
+void ipa_modem_skb_rx_list_add(struct net_device *netdev,
+			       struct sk_buff *skb, struct list_head *list);
+void ipa_modem_skb_rx_list(struct list_head *list);
 
 void ipa_modem_suspend(struct net_device *netdev);
 void ipa_modem_resume(struct net_device *netdev);
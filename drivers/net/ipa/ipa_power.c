@@ -276,6 +276,8 @@ ipa_power_init(struct device *dev, const struct ipa_power_data *data)
 	pm_runtime_set_autosuspend_delay(dev, IPA_AUTOSUSPEND_DELAY);
 	pm_runtime_use_autosuspend(dev);
 	pm_runtime_enable(dev);
+	/* System suspend only touches IPA itself, it can run in parallel */
+	device_enable_async_suspend(dev);
 
 	return power;
 
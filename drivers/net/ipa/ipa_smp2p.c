@@ -80,11 +80,12 @@ struct ipa_smp2p {
  * the modem power query IPA interrupt) or whenever the AP is shutting down
  * (via a panic notifier).  It sets the two SMP2P state bits--one saying
  * whether the IPA power is on, and the other indicating the first bit
- * is valid.
+ * is valid.  Both bits are updated in one batch, so the modem is only
+ * interrupted once.
  */
 static void ipa_smp2p_notify(struct ipa_smp2p *smp2p)
 {
-	u32 value;
+	struct qcom_smem_state_update update[2];
 	u32 mask;
 
 	if (smp2p->notified)
@@ -94,13 +95,17 @@ static void ipa_smp2p_notify(struct ipa_smp2p *smp2p)
 
 	/* Signal whether the IPA power is enabled */
 	mask = BIT(smp2p->enabled_bit);
-	value = smp2p->power_on ? mask : 0;
-	qcom_smem_state_update_bits(smp2p->enabled_state, mask, value);
+	update[0].state = smp2p->enabled_state;
+	update[0].mask = mask;
+	update[0].value = smp2p->power_on ? mask : 0;
 
-	/* Now indicate that the enabled flag is valid */
+	/* Then indicate that the enabled flag is valid */
 	mask = BIT(smp2p->valid_bit);
-	value = mask;
-	qcom_smem_state_update_bits(smp2p->valid_state, mask, value);
+	update[1].state = smp2p->valid_state;
+	update[1].mask = mask;
+	update[1].value = mask;
+
+	(void)qcom_smem_state_update_bits_batch(update, ARRAY_SIZE(update));
 
 	smp2p->notified = true;
 }
@@ -331,7 +336,7 @@ void ipa_smp2p_irq_disable_setup(struct ipa *ipa)
 void ipa_smp2p_notify_reset(struct ipa *ipa)
 {
 	struct ipa_smp2p *smp2p = ipa->smp2p;
-	u32 mask;
+	struct qcom_smem_state_update update[2];
 
 	if (!smp2p->notified)
 		return;
@@ -339,12 +344,16 @@ void ipa_smp2p_notify_reset(struct ipa *ipa)
 	ipa_smp2p_power_release(ipa);
 
 	/* Reset the power enabled valid flag */
-	mask = BIT(smp2p->valid_bit);
-	qcom_smem_state_update_bits(smp2p->valid_state, mask, 0);
+	update[0].state = smp2p->valid_state;
+	update[0].mask = BIT(smp2p->valid_bit);
+	update[0].value = 0;
 
 	/* Mark the power disabled for good measure... */
-	mask = BIT(smp2p->enabled_bit);
-	qcom_smem_state_update_bits(smp2p->enabled_state, mask, 0);
+	update[1].state = smp2p->enabled_state;
+	update[1].mask = BIT(smp2p->enabled_bit);
+	update[1].value = 0;
+
+	(void)qcom_smem_state_update_bits_batch(update, ARRAY_SIZE(update));
 
 	smp2p->notified = false;
 }
@@ -44,6 +44,17 @@
 
 #define WDS_BIND_MUX_DATA_PORT_MUX_ID 112
 
+/* Datagrams are 32-bit aligned within an aggregated NTB */
+#define MBIM_TX_DGRAM_ALIGN 4
+
+static unsigned int mru;
+module_param(mru, uint, 0444);
+MODULE_PARM_DESC(mru, "RX buffer size in bytes (0 = controller default)");
+
+static unsigned int tx_agg_max = 16;
+module_param(tx_agg_max, uint, 0644);
+MODULE_PARM_DESC(tx_agg_max, "Max datagrams aggregated in one TX NTB (<= 1 disables)");
+
 struct mhi_mbim_link {
 	struct mhi_mbim_context *mbim;
 	struct net_device *ndev;
@@ -73,6 +84,9 @@ struct mhi_mbim_context {
 	u16 tx_seq;
 	struct delayed_work rx_refill;
 	spinlock_t tx_lock;
+	struct sk_buff_head tx_pending;
+	struct mhi_mbim_link *tx_pending_link;
+	unsigned int tx_pending_len;
 	struct hlist_head link_list[MHI_MBIM_LINK_HASH_SIZE];
 };
 
@@ -82,6 +96,13 @@ struct mbim_tx_hdr {
 	struct usb_cdc_ncm_dpe16 dpe16[2];
 } __packed;
 
+/* Number of datagrams carried by a TX NTB, for accounting on completion */
+struct mhi_mbim_tx_cb {
+	unsigned int dgrams;
+};
+
+#define MHI_MBIM_TX_CB(skb) ((struct mhi_mbim_tx_cb *)(skb)->cb)
+
 static struct mhi_mbim_link *mhi_mbim_get_link_rcu(struct mhi_mbim_context *mbim,
 						   unsigned int session)
 {
@@ -148,44 +169,150 @@ static struct sk_buff *mbim_tx_fixup(struct sk_buff *skb, unsigned int session,
 	return skb;
 }
 
-static netdev_tx_t mhi_mbim_ndo_xmit(struct sk_buff *skb, struct net_device *ndev)
+static unsigned int mbim_tx_agg_hdr_len(unsigned int dgrams)
 {
-	struct mhi_mbim_link *link = wwan_netdev_drvpriv(ndev);
-	struct mhi_mbim_context *mbim = link->mbim;
-	unsigned long flags;
+	/* NTH16, NDP16 and one DPE16 per datagram plus null termination */
+	return ALIGN(sizeof(struct usb_cdc_ncm_nth16) +
+		     sizeof(struct usb_cdc_ncm_ndp16) +
+		     sizeof(struct usb_cdc_ncm_dpe16) * (dgrams + 1),
+		     MBIM_TX_DGRAM_ALIGN);
+}
+
+/* Build a single NTB carrying all the datagrams of @list, which belong to
+ * the same session and add up to @len bytes once aligned. The datagrams are
+ * copied, and consumed on success.
+ */
+static struct sk_buff *mbim_tx_agg(struct sk_buff_head *list, unsigned int len,
+				   unsigned int session, u16 tx_seq)
+{
+	unsigned int dgrams = skb_queue_len(list);
+	unsigned int offset = mbim_tx_agg_hdr_len(dgrams);
+	struct usb_cdc_ncm_nth16 *nth16;
+	struct usb_cdc_ncm_ndp16 *ndp16;
+	struct sk_buff *ntb, *skb;
+	unsigned int i = 0;
+
+	ntb = alloc_skb(offset + len, GFP_ATOMIC);
+	if (!ntb)
+		return NULL;
+
+	nth16 = skb_put_zero(ntb, offset);
+	ndp16 = (void *)(nth16 + 1);
+
+	while ((skb = __skb_dequeue(list))) {
+		unsigned int pad = ALIGN(offset, MBIM_TX_DGRAM_ALIGN) - offset;
+
+		skb_put_zero(ntb, pad);
+		offset += pad;
+
+		ndp16->dpe16[i].wDatagramIndex = cpu_to_le16(offset);
+		ndp16->dpe16[i].wDatagramLength = cpu_to_le16(skb->len);
+		skb_copy_bits(skb, 0, skb_put(ntb, skb->len), skb->len);
+		offset += skb->len;
+		i++;
+
+		ntb->dev = skb->dev;
+		dev_consume_skb_any(skb);
+	}
+
+	/* Fill NTB header */
+	nth16->dwSignature = cpu_to_le32(USB_CDC_NCM_NTH16_SIGN);
+	nth16->wHeaderLength = cpu_to_le16(sizeof(struct usb_cdc_ncm_nth16));
+	nth16->wSequence = cpu_to_le16(tx_seq);
+	nth16->wBlockLength = cpu_to_le16(ntb->len);
+	nth16->wNdpIndex = cpu_to_le16(sizeof(struct usb_cdc_ncm_nth16));
+
+	/* Fill the unique NDP, the DPE16 array is already null terminated */
+	ndp16->dwSignature = cpu_to_le32(USB_CDC_MBIM_NDP16_IPS_SIGN | (session << 24));
+	ndp16->wLength = cpu_to_le16(sizeof(struct usb_cdc_ncm_ndp16)
+					+ sizeof(struct usb_cdc_ncm_dpe16) * (dgrams + 1));
+	ndp16->wNextNdpIndex = 0;
+
+	return ntb;
+}
+
+/* Send the pending datagrams as one NTB, must be called with tx_lock held */
+static void mhi_mbim_tx_flush(struct mhi_mbim_context *mbim)
+{
+	struct mhi_mbim_link *link = mbim->tx_pending_link;
+	unsigned int dgrams = skb_queue_len(&mbim->tx_pending);
+	struct sk_buff *skb;
 	int err = -ENOMEM;
 
-	/* Serialize MHI channel queuing and MBIM seq */
-	spin_lock_irqsave(&mbim->tx_lock, flags);
+	if (!dgrams)
+		return;
+
+	if (dgrams == 1) {
+		/* Nothing to aggregate, prepend the header in place */
+		skb = mbim_tx_fixup(__skb_dequeue(&mbim->tx_pending),
+				    link->session, mbim->tx_seq);
+	} else {
+		skb = mbim_tx_agg(&mbim->tx_pending, mbim->tx_pending_len,
+				  link->session, mbim->tx_seq);
+	}
+
+	mbim->tx_pending_link = NULL;
+	mbim->tx_pending_len = 0;
 
-	skb = mbim_tx_fixup(skb, link->session, mbim->tx_seq);
 	if (unlikely(!skb))
-		goto exit_unlock;
+		goto exit_drop;
+
+	MHI_MBIM_TX_CB(skb)->dgrams = dgrams;
 
 	err = mhi_queue_skb(mbim->mdev, DMA_TO_DEVICE, skb, skb->len, MHI_EOT);
 
 	if (mhi_queue_is_full(mbim->mdev, DMA_TO_DEVICE))
-		netif_stop_queue(ndev);
+		netif_stop_queue(link->ndev);
 
-	if (!err)
+	if (likely(!err)) {
 		mbim->tx_seq++;
-
-exit_unlock:
-	spin_unlock_irqrestore(&mbim->tx_lock, flags);
-
-	if (unlikely(err)) {
-		net_err_ratelimited("%s: Failed to queue TX buf (%d)\n",
-				    ndev->name, err);
-		dev_kfree_skb_any(skb);
-		goto exit_drop;
+		return;
 	}
 
-	return NETDEV_TX_OK;
+	dev_kfree_skb_any(skb);
 
 exit_drop:
+	net_err_ratelimited("%s: Failed to queue TX buf (%d)\n",
+			    link->ndev->name, err);
+
+	/* Datagrams not yet consumed by a failed aggregation */
+	__skb_queue_purge(&mbim->tx_pending);
+
 	u64_stats_update_begin(&link->tx_syncp);
-	u64_stats_inc(&link->tx_dropped);
+	u64_stats_add(&link->tx_dropped, dgrams);
 	u64_stats_update_end(&link->tx_syncp);
+}
+
+static netdev_tx_t mhi_mbim_ndo_xmit(struct sk_buff *skb, struct net_device *ndev)
+{
+	struct mhi_mbim_link *link = wwan_netdev_drvpriv(ndev);
+	struct mhi_mbim_context *mbim = link->mbim;
+	unsigned int agg_max = READ_ONCE(tx_agg_max);
+	unsigned int dgrams, len;
+	unsigned long flags;
+
+	/* Serialize MHI channel queuing and MBIM seq */
+	spin_lock_irqsave(&mbim->tx_lock, flags);
+
+	/* An NDP only carries datagrams of a single session, and the whole
+	 * NTB must fit in one MHI transfer.
+	 */
+	dgrams = skb_queue_len(&mbim->tx_pending) + 1;
+	len = mbim_tx_agg_hdr_len(dgrams) + mbim->tx_pending_len +
+	      ALIGN(skb->len, MBIM_TX_DGRAM_ALIGN);
+	if (mbim->tx_pending_link != link || len > MHI_MAX_BUF_SZ)
+		mhi_mbim_tx_flush(mbim);
+
+	__skb_queue_tail(&mbim->tx_pending, skb);
+	mbim->tx_pending_link = link;
+	mbim->tx_pending_len += ALIGN(skb->len, MBIM_TX_DGRAM_ALIGN);
+
+	/* Keep aggregating while the stack has more packets for us */
+	if (!netdev_xmit_more() || netif_queue_stopped(ndev) ||
+	    skb_queue_len(&mbim->tx_pending) >= agg_max)
+		mhi_mbim_tx_flush(mbim);
+
+	spin_unlock_irqrestore(&mbim->tx_lock, flags);
 
 	return NETDEV_TX_OK;
 }
@@ -489,6 +616,7 @@ static void mhi_mbim_ul_callback(struct mhi_device *mhi_dev,
 	struct sk_buff *skb = mhi_res->buf_addr;
 	struct net_device *ndev = skb->dev;
 	struct mhi_mbim_link *link = wwan_netdev_drvpriv(ndev);
+	unsigned int dgrams = MHI_MBIM_TX_CB(skb)->dgrams;
 
 	/* Hardware has consumed the buffer, so free the skb (which is not
 	 * freed by the MHI stack) and perform accounting.
@@ -503,9 +631,9 @@ static void mhi_mbim_ul_callback(struct mhi_device *mhi_dev,
 			return;
 		}
 
-		u64_stats_inc(&link->tx_errors);
+		u64_stats_add(&link->tx_errors, dgrams);
 	} else {
-		u64_stats_inc(&link->tx_packets);
+		u64_stats_add(&link->tx_packets, dgrams);
 		u64_stats_add(&link->tx_bytes, mhi_res->bytes_xferd);
 	}
 	u64_stats_update_end(&link->tx_syncp);
@@ -614,9 +742,13 @@ static int mhi_mbim_probe(struct mhi_device *mhi_dev, const struct mhi_device_id
 		return -ENOMEM;
 
 	spin_lock_init(&mbim->tx_lock);
+	__skb_queue_head_init(&mbim->tx_pending);
 	dev_set_drvdata(&mhi_dev->dev, mbim);
 	mbim->mdev = mhi_dev;
-	mbim->mru = mhi_dev->mhi_cntrl->mru ? mhi_dev->mhi_cntrl->mru : MHI_DEFAULT_MRU;
+	if (mru)
+		mbim->mru = min_t(unsigned int, mru, MHI_MAX_BUF_SZ);
+	else
+		mbim->mru = cntrl->mru ? cntrl->mru : MHI_DEFAULT_MRU;
 
 	INIT_DELAYED_WORK(&mbim->rx_refill, mhi_net_rx_refill_work);
 
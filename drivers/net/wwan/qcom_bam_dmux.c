@@ -16,6 +16,7 @@
 #include <linux/netdevice.h>
 #include <linux/platform_device.h>
 #include <linux/pm_runtime.h>
+#include <linux/scatterlist.h>
 #include <linux/soc/qcom/smem_state.h>
 #include <linux/spinlock.h>
 #include <linux/wait.h>
@@ -26,6 +27,8 @@
 #define BAM_DMUX_HDR_SIZE		sizeof(struct bam_dmux_hdr)
 #define BAM_DMUX_MAX_DATA_SIZE		(BAM_DMUX_BUFFER_SIZE - BAM_DMUX_HDR_SIZE)
 #define BAM_DMUX_NUM_SKB		32
+/* Linear part, page fragments and the trailing pad */
+#define BAM_DMUX_TX_SG_MAX		(MAX_SKB_FRAGS + 2)
 
 #define BAM_DMUX_HDR_MAGIC		0x33fc
 
@@ -63,6 +66,12 @@ struct bam_dmux_skb_dma {
 	struct bam_dmux *dmux;
 	struct sk_buff *skb;
 	dma_addr_t addr;
+
+	/* TX only */
+	struct scatterlist *sgl;
+	unsigned int nents;
+	unsigned int pad;
+	unsigned long batch;
 };
 
 struct bam_dmux {
@@ -78,8 +87,11 @@ struct bam_dmux {
 	struct dma_chan *rx, *tx;
 	struct bam_dmux_skb_dma rx_skbs[BAM_DMUX_NUM_SKB];
 	struct bam_dmux_skb_dma tx_skbs[BAM_DMUX_NUM_SKB];
-	spinlock_t tx_lock; /* Protect tx_skbs, tx_next_skb */
+	spinlock_t tx_lock; /* Protect tx_skbs, tx_next_skb, tx_batch, tx_tail */
 	unsigned int tx_next_skb;
+	unsigned long tx_batch;
+	struct dma_async_tx_descriptor *tx_tail;
+	u8 *tx_pad;
 	atomic_long_t tx_deferred_skb;
 	struct work_struct tx_wakeup_work;
 
@@ -129,6 +141,42 @@ static void bam_dmux_skb_dma_unmap(struct bam_dmux_skb_dma *skb_dma,
 	skb_dma->addr = 0;
 }
 
+/* TX skbs may be non-linear, so they are mapped as a scatterlist. The pad
+ * to a word boundary is added as a separate entry in that case.
+ */
+static bool bam_dmux_skb_dma_map_tx(struct bam_dmux_skb_dma *skb_dma)
+{
+	struct bam_dmux *dmux = skb_dma->dmux;
+	struct sk_buff *skb = skb_dma->skb;
+	int nents;
+
+	sg_init_table(skb_dma->sgl, BAM_DMUX_TX_SG_MAX);
+	nents = skb_to_sgvec(skb, skb_dma->sgl, 0, skb->len);
+	if (nents < 0)
+		return false;
+
+	if (skb_dma->pad) {
+		sg_unmark_end(&skb_dma->sgl[nents - 1]);
+		sg_set_buf(&skb_dma->sgl[nents++], dmux->tx_pad, skb_dma->pad);
+		sg_mark_end(&skb_dma->sgl[nents - 1]);
+	}
+
+	if (!dma_map_sg(dmux->dev, skb_dma->sgl, nents, DMA_TO_DEVICE)) {
+		dev_err(dmux->dev, "Failed to DMA map buffer\n");
+		return false;
+	}
+
+	skb_dma->nents = nents;
+	return true;
+}
+
+static void bam_dmux_skb_dma_unmap_tx(struct bam_dmux_skb_dma *skb_dma)
+{
+	dma_unmap_sg(skb_dma->dmux->dev, skb_dma->sgl, skb_dma->nents,
+		     DMA_TO_DEVICE);
+	skb_dma->nents = 0;
+}
+
 static void bam_dmux_tx_wake_queues(struct bam_dmux *dmux)
 {
 	int i;
@@ -165,11 +213,12 @@ static void bam_dmux_tx_done(struct bam_dmux_skb_dma *skb_dma)
 	pm_runtime_mark_last_busy(dmux->dev);
 	pm_runtime_put_autosuspend(dmux->dev);
 
-	if (skb_dma->addr)
-		bam_dmux_skb_dma_unmap(skb_dma, DMA_TO_DEVICE);
+	if (skb_dma->nents)
+		bam_dmux_skb_dma_unmap_tx(skb_dma);
 
 	spin_lock_irqsave(&dmux->tx_lock, flags);
 	skb_dma->skb = NULL;
+	skb_dma->pad = 0;
 	if (skb_dma == &dmux->tx_skbs[dmux->tx_next_skb % BAM_DMUX_NUM_SKB])
 		bam_dmux_tx_wake_queues(dmux);
 	spin_unlock_irqrestore(&dmux->tx_lock, flags);
@@ -178,31 +227,97 @@ static void bam_dmux_tx_done(struct bam_dmux_skb_dma *skb_dma)
 static void bam_dmux_tx_callback(void *data)
 {
 	struct bam_dmux_skb_dma *skb_dma = data;
-	struct sk_buff *skb = skb_dma->skb;
+	struct bam_dmux *dmux = skb_dma->dmux;
+	unsigned long batch = skb_dma->batch;
+	int i;
 
-	bam_dmux_tx_done(skb_dma);
-	dev_consume_skb_any(skb);
+	/* Descriptors complete in order, so this also finishes every skb
+	 * that was submitted without a callback before this one.
+	 */
+	for_each_set_bit(i, &batch, BAM_DMUX_NUM_SKB) {
+		struct bam_dmux_skb_dma *done = &dmux->tx_skbs[i];
+		struct sk_buff *skb = done->skb;
+
+		bam_dmux_tx_done(done);
+		dev_consume_skb_any(skb);
+	}
+}
+
+/*
+ * Submit the descriptor held back as the tail of the open batch, with the
+ * callback that completes the whole batch. Called with tx_lock held.
+ */
+static void bam_dmux_tx_close_batch(struct bam_dmux *dmux)
+{
+	struct dma_async_tx_descriptor *desc = dmux->tx_tail;
+	struct bam_dmux_skb_dma *skb_dma;
+
+	if (!desc)
+		return;
+
+	skb_dma = desc->callback_param;
+	skb_dma->batch = dmux->tx_batch;
+	dmux->tx_batch = 0;
+	dmux->tx_tail = NULL;
+
+	desc->callback = bam_dmux_tx_callback;
+	desc->cookie = dmaengine_submit(desc);
 }
 
-static bool bam_dmux_skb_dma_submit_tx(struct bam_dmux_skb_dma *skb_dma)
+/*
+ * With @more set, the descriptor is queued without a completion callback,
+ * and is completed by the callback of the next descriptor that has one.
+ * Each skb still gets its own EOT, which is how the remote side delimits
+ * transfers.
+ *
+ * The last descriptor of an open batch is held back unsubmitted in tx_tail,
+ * so that if the skb that should have closed the batch is dropped, the tail
+ * can still be submitted with the callback, see bam_dmux_tx_flush().
+ */
+static bool bam_dmux_skb_dma_submit_tx(struct bam_dmux_skb_dma *skb_dma,
+				       bool more)
 {
 	struct bam_dmux *dmux = skb_dma->dmux;
 	struct dma_async_tx_descriptor *desc;
+	unsigned int slot = skb_dma - dmux->tx_skbs;
+	unsigned long flags;
 
-	desc = dmaengine_prep_slave_single(dmux->tx, skb_dma->addr,
-					   skb_dma->skb->len, DMA_MEM_TO_DEV,
-					   DMA_PREP_INTERRUPT);
+	/* Submission order must match the order the batch is tracked in */
+	spin_lock_irqsave(&dmux->tx_lock, flags);
+
+	desc = dmaengine_prep_slave_sg(dmux->tx, skb_dma->sgl, skb_dma->nents,
+				       DMA_MEM_TO_DEV, DMA_PREP_INTERRUPT);
 	if (!desc) {
+		spin_unlock_irqrestore(&dmux->tx_lock, flags);
 		dev_err(dmux->dev, "Failed to prepare TX DMA buffer\n");
 		return false;
 	}
-
-	desc->callback = bam_dmux_tx_callback;
 	desc->callback_param = skb_dma;
-	desc->cookie = dmaengine_submit(desc);
+
+	if (dmux->tx_tail)
+		dmux->tx_tail->cookie = dmaengine_submit(dmux->tx_tail);
+
+	dmux->tx_batch |= BIT(slot);
+	dmux->tx_tail = desc;
+	if (!more)
+		bam_dmux_tx_close_batch(dmux);
+
+	spin_unlock_irqrestore(&dmux->tx_lock, flags);
 	return true;
 }
 
+/* Close the open batch, if any, and start everything submitted so far */
+static void bam_dmux_tx_flush(struct bam_dmux *dmux)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&dmux->tx_lock, flags);
+	bam_dmux_tx_close_batch(dmux);
+	spin_unlock_irqrestore(&dmux->tx_lock, flags);
+
+	dma_async_issue_pending(dmux->tx);
+}
+
 static struct bam_dmux_skb_dma *
 bam_dmux_tx_queue(struct bam_dmux *dmux, struct sk_buff *skb)
 {
@@ -254,12 +369,12 @@ static int bam_dmux_send_cmd(struct bam_dmux_netdev *bndev, u8 cmd)
 	if (ret < 0)
 		goto tx_fail;
 
-	if (!bam_dmux_skb_dma_map(skb_dma, DMA_TO_DEVICE)) {
+	if (!bam_dmux_skb_dma_map_tx(skb_dma)) {
 		ret = -ENOMEM;
 		goto tx_fail;
 	}
 
-	if (!bam_dmux_skb_dma_submit_tx(skb_dma)) {
+	if (!bam_dmux_skb_dma_submit_tx(skb_dma, false)) {
 		ret = -EIO;
 		goto tx_fail;
 	}
@@ -304,11 +419,13 @@ static unsigned int needed_room(unsigned int avail, unsigned int needed)
 }
 
 static int bam_dmux_tx_prepare_skb(struct bam_dmux_netdev *bndev,
-				   struct sk_buff *skb)
+				   struct bam_dmux_skb_dma *skb_dma)
 {
+	struct sk_buff *skb = skb_dma->skb;
 	unsigned int head = needed_room(skb_headroom(skb), BAM_DMUX_HDR_SIZE);
 	unsigned int pad = sizeof(u32) - skb->len % sizeof(u32);
-	unsigned int tail = needed_room(skb_tailroom(skb), pad);
+	bool linear = !skb_is_nonlinear(skb);
+	unsigned int tail = linear ? needed_room(skb_tailroom(skb), pad) : 0;
 	struct bam_dmux_hdr *hdr;
 	int ret;
 
@@ -325,8 +442,12 @@ static int bam_dmux_tx_prepare_skb(struct bam_dmux_netdev *bndev,
 	hdr->pad = pad;
 	hdr->ch = bndev->ch;
 	hdr->len = skb->len - sizeof(*hdr);
-	if (pad)
+
+	/* Pad non-linear skbs from a separate buffer, see bam_dmux_skb_dma_map_tx() */
+	if (linear)
 		skb_put_zero(skb, pad);
+	else
+		skb_dma->pad = pad;
 
 	return 0;
 }
@@ -338,20 +459,26 @@ static netdev_tx_t bam_dmux_netdev_start_xmit(struct sk_buff *skb,
 	struct bam_dmux *dmux = bndev->dmux;
 	struct bam_dmux_skb_dma *skb_dma;
 	int active, ret;
+	bool more;
 
 	skb_dma = bam_dmux_tx_queue(dmux, skb);
 	if (!skb_dma)
 		return NETDEV_TX_BUSY;
 
+	/* If the queue was just stopped no more skbs will follow for now,
+	 * so this one must complete the batch.
+	 */
+	more = netdev_xmit_more() && !netif_queue_stopped(netdev);
+
 	active = pm_runtime_get(dmux->dev);
 	if (active < 0 && active != -EINPROGRESS)
 		goto drop;
 
-	ret = bam_dmux_tx_prepare_skb(bndev, skb);
+	ret = bam_dmux_tx_prepare_skb(bndev, skb_dma);
 	if (ret)
 		goto drop;
 
-	if (!bam_dmux_skb_dma_map(skb_dma, DMA_TO_DEVICE))
+	if (!bam_dmux_skb_dma_map_tx(skb_dma))
 		goto drop;
 
 	if (active <= 0) {
@@ -362,15 +489,19 @@ static netdev_tx_t bam_dmux_netdev_start_xmit(struct sk_buff *skb,
 		return NETDEV_TX_OK;
 	}
 
-	if (!bam_dmux_skb_dma_submit_tx(skb_dma))
+	if (!bam_dmux_skb_dma_submit_tx(skb_dma, more))
 		goto drop;
 
-	dma_async_issue_pending(dmux->tx);
+	if (!more)
+		dma_async_issue_pending(dmux->tx);
 	return NETDEV_TX_OK;
 
 drop:
 	bam_dmux_tx_done(skb_dma);
 	dev_kfree_skb_any(skb);
+	/* The skbs batched before this one need a callback to complete */
+	if (!more)
+		bam_dmux_tx_flush(dmux);
 	return NETDEV_TX_OK;
 }
 
@@ -392,7 +523,7 @@ static void bam_dmux_tx_wakeup_work(struct work_struct *work)
 
 	dev_dbg(dmux->dev, "pending skbs after wakeup: %#lx\n", pending);
 	for_each_set_bit(i, &pending, BAM_DMUX_NUM_SKB) {
-		bam_dmux_skb_dma_submit_tx(&dmux->tx_skbs[i]);
+		bam_dmux_skb_dma_submit_tx(&dmux->tx_skbs[i], false);
 	}
 	dma_async_issue_pending(dmux->tx);
 
@@ -423,6 +554,8 @@ static void bam_dmux_netdev_setup(struct net_device *dev)
 	dev->max_mtu = BAM_DMUX_MAX_DATA_SIZE;
 	dev->needed_headroom = sizeof(struct bam_dmux_hdr);
 	dev->needed_tailroom = sizeof(u32); /* word-aligned */
+	dev->features = NETIF_F_SG;
+	dev->hw_features = NETIF_F_SG;
 	dev->tx_queue_len = DEFAULT_TX_QUEUE_LEN;
 
 	/* This perm addr will be used as interface identifier by IPv6 */
@@ -649,6 +782,8 @@ static void bam_dmux_free_skbs(struct bam_dmux_skb_dma skbs[],
 
 		if (skb_dma->addr)
 			bam_dmux_skb_dma_unmap(skb_dma, dir);
+		if (skb_dma->nents)
+			bam_dmux_skb_dma_unmap_tx(skb_dma);
 		if (skb_dma->skb) {
 			dev_kfree_skb(skb_dma->skb);
 			skb_dma->skb = NULL;
@@ -662,6 +797,9 @@ static void bam_dmux_power_off(struct bam_dmux *dmux)
 		dmaengine_terminate_sync(dmux->tx);
 		dma_release_channel(dmux->tx);
 		dmux->tx = NULL;
+		/* The held back tail was freed along with the channel */
+		dmux->tx_tail = NULL;
+		dmux->tx_batch = 0;
 	}
 
 	if (dmux->rx) {
@@ -807,9 +945,19 @@ static int bam_dmux_probe(struct platform_device *pdev)
 	INIT_WORK(&dmux->tx_wakeup_work, bam_dmux_tx_wakeup_work);
 	INIT_WORK(&dmux->register_netdev_work, bam_dmux_register_netdev_work);
 
+	/* Zeroes used to pad non-linear TX skbs to a word boundary */
+	dmux->tx_pad = devm_kzalloc(dev, sizeof(u32), GFP_KERNEL);
+	if (!dmux->tx_pad)
+		return -ENOMEM;
+
 	for (i = 0; i < BAM_DMUX_NUM_SKB; i++) {
 		dmux->rx_skbs[i].dmux = dmux;
 		dmux->tx_skbs[i].dmux = dmux;
+		dmux->tx_skbs[i].sgl = devm_kcalloc(dev, BAM_DMUX_TX_SG_MAX,
+						    sizeof(struct scatterlist),
+						    GFP_KERNEL);
+		if (!dmux->tx_skbs[i].sgl)
+			return -ENOMEM;
 	}
 
 	/* Runtime PM manages our own power vote.
@@ -493,6 +493,139 @@ static bool _compare_floor(struct dev_pm_opp **opp, struct dev_pm_opp *temp_opp,
 	return false;
 }
 
+/*
+ * Lookup array helpers. The OPP list is kept sorted, so when the key being
+ * searched for increases along the list, the array lets the finders below
+ * binary search it instead of walking the whole list.
+ */
+static void _opp_lookup_invalidate(struct opp_table *opp_table)
+{
+	lockdep_assert_held(&opp_table->lock);
+
+	kfree(opp_table->lookup);
+	opp_table->lookup = NULL;
+}
+
+static void _opp_lookup_build(struct opp_table *opp_table)
+{
+	struct dev_pm_opp *opp, *prev = NULL;
+	unsigned int count = 0, sorted;
+
+	lockdep_assert_held(&opp_table->lock);
+
+	list_for_each_entry(opp, &opp_table->opp_list, node)
+		count++;
+
+	opp_table->lookup = kmalloc_array(count, sizeof(*opp_table->lookup),
+					  GFP_KERNEL);
+	if (!opp_table->lookup)
+		return;
+
+	sorted = OPP_LOOKUP_LEVEL;
+	if (opp_table->clk_count)
+		sorted |= OPP_LOOKUP_FREQ;
+	if (opp_table->path_count)
+		sorted |= OPP_LOOKUP_BW;
+
+	count = 0;
+	list_for_each_entry(opp, &opp_table->opp_list, node) {
+		if (prev) {
+			if ((sorted & OPP_LOOKUP_FREQ) &&
+			    opp->rates[0] < prev->rates[0])
+				sorted &= ~OPP_LOOKUP_FREQ;
+			if (opp->level < prev->level)
+				sorted &= ~OPP_LOOKUP_LEVEL;
+			if ((sorted & OPP_LOOKUP_BW) &&
+			    opp->bandwidth[0].peak < prev->bandwidth[0].peak)
+				sorted &= ~OPP_LOOKUP_BW;
+		}
+
+		opp_table->lookup[count++] = opp;
+		prev = opp;
+	}
+
+	opp_table->lookup_count = count;
+	opp_table->lookup_sorted = sorted;
+}
+
+static bool _opp_lookup_usable(struct opp_table *opp_table, int index,
+		unsigned long (*read)(struct dev_pm_opp *opp, int index))
+{
+	unsigned int key;
+
+	if (index)
+		return false;
+
+	if (read == _read_freq)
+		key = OPP_LOOKUP_FREQ;
+	else if (read == _read_level)
+		key = OPP_LOOKUP_LEVEL;
+	else if (read == _read_bw)
+		key = OPP_LOOKUP_BW;
+	else
+		return false;
+
+	if (!opp_table->lookup)
+		_opp_lookup_build(opp_table);
+
+	return opp_table->lookup && (opp_table->lookup_sorted & key);
+}
+
+/* Returns the index of the first OPP whose key is >= @key (or > if @after) */
+static unsigned int _opp_lookup_bound(struct opp_table *opp_table,
+		unsigned long key, int index, bool after,
+		unsigned long (*read)(struct dev_pm_opp *opp, int index))
+{
+	unsigned int lo = 0, hi = opp_table->lookup_count, mid;
+	unsigned long opp_key;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		opp_key = read(opp_table->lookup[mid], index);
+
+		if (opp_key < key || (after && opp_key == key))
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	return lo;
+}
+
+static struct dev_pm_opp *_opp_lookup_find(struct opp_table *opp_table,
+		unsigned long key, int index, bool available,
+		unsigned long (*read)(struct dev_pm_opp *opp, int index),
+		bool (*compare)(struct dev_pm_opp **opp, struct dev_pm_opp *temp_opp,
+				unsigned long opp_key, unsigned long key))
+{
+	struct dev_pm_opp *temp_opp;
+	unsigned int i;
+
+	if (compare == _compare_floor) {
+		i = _opp_lookup_bound(opp_table, key, index, true, read);
+		while (i--) {
+			temp_opp = opp_table->lookup[i];
+			if (temp_opp->available == available)
+				return temp_opp;
+		}
+
+		return ERR_PTR(-ERANGE);
+	}
+
+	i = _opp_lookup_bound(opp_table, key, index, false, read);
+	for (; i < opp_table->lookup_count; i++) {
+		temp_opp = opp_table->lookup[i];
+
+		if (compare == _compare_exact && read(temp_opp, index) != key)
+			break;
+
+		if (temp_opp->available == available)
+			return temp_opp;
+	}
+
+	return ERR_PTR(-ERANGE);
+}
+
 /* Generic key finding helpers */
 static struct dev_pm_opp *_opp_table_find_key(struct opp_table *opp_table,
 		unsigned long *key, int index, bool available,
@@ -509,6 +642,12 @@ static struct dev_pm_opp *_opp_table_find_key(struct opp_table *opp_table,
 
 	mutex_lock(&opp_table->lock);
 
+	if (_opp_lookup_usable(opp_table, index, read)) {
+		opp = _opp_lookup_find(opp_table, *key, index, available, read,
+				       compare);
+		goto found;
+	}
+
 	list_for_each_entry(temp_opp, &opp_table->opp_list, node) {
 		if (temp_opp->available == available) {
 			if (compare(&opp, temp_opp, read(temp_opp, index), *key))
@@ -516,6 +655,7 @@ static struct dev_pm_opp *_opp_table_find_key(struct opp_table *opp_table,
 		}
 	}
 
+found:
 	/* Increment the reference count of OPP */
 	if (!IS_ERR(opp)) {
 		*key = read(opp, index);
@@ -1637,6 +1777,7 @@ static void _opp_table_kref_release(struct kref *kref)
 	}
 
 	WARN_ON(!list_empty(&opp_table->opp_list));
+	kfree(opp_table->lookup);
 
 	list_for_each_entry_safe(opp_dev, temp, &opp_table->dev_list, node)
 		_remove_opp_dev(opp_dev, opp_table);
@@ -1663,6 +1804,7 @@ static void _opp_kref_release(struct kref *kref)
 	struct opp_table *opp_table = opp->opp_table;
 
 	list_del(&opp->node);
+	_opp_lookup_invalidate(opp_table);
 	mutex_unlock(&opp_table->lock);
 
 	/*
@@ -2004,6 +2146,7 @@ int _opp_add(struct device *dev, struct dev_pm_opp *new_opp,
 	}
 
 	list_add(&new_opp->node, head);
+	_opp_lookup_invalidate(opp_table);
 	mutex_unlock(&opp_table->lock);
 
 	new_opp->opp_table = opp_table;
@@ -150,6 +150,10 @@ struct opp_device {
 #endif
 };
 
+#define OPP_LOOKUP_FREQ		BIT(0)
+#define OPP_LOOKUP_LEVEL	BIT(1)
+#define OPP_LOOKUP_BW		BIT(2)
+
 enum opp_table_access {
 	OPP_TABLE_ACCESS_UNKNOWN = 0,
 	OPP_TABLE_ACCESS_EXCLUSIVE = 1,
@@ -193,6 +197,10 @@ enum opp_table_access {
  * @path_count: Number of interconnect paths
  * @enabled: Set to true if the device's resources are enabled/configured.
  * @is_genpd: Marks if the OPP table belongs to a genpd.
+ * @lookup: Snapshot of @opp_list as an array, used for binary search lookups.
+ *		Rebuilt on demand under @lock after OPPs are added or removed.
+ * @lookup_count: Number of entries in @lookup.
+ * @lookup_sorted: Mask of OPP_LOOKUP_* keys by which @lookup is sorted.
  * @dentry:	debugfs dentry pointer of the real device directory (not links).
  * @dentry_name: Name of the real dentry.
  *
@@ -242,6 +250,10 @@ struct opp_table {
 	bool enabled;
 	bool is_genpd;
 
+	struct dev_pm_opp **lookup;
+	unsigned int lookup_count;
+	unsigned int lookup_sorted;
+
 #ifdef CONFIG_DEBUG_FS
 	struct dentry *dentry;
 	char dentry_name[NAME_MAX];
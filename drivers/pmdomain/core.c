@@ -263,6 +263,37 @@ static inline void genpd_debug_remove(struct generic_pm_domain *genpd) {}
 static inline void genpd_update_accounting(struct generic_pm_domain *genpd) {}
 #endif
 
+/*
+ * For CPU PM domains, remember how long each off period lasted when it was
+ * cut short by something other than the timer the governor based its decision
+ * on, so cpu_power_down_ok() can also account for IRQ driven wakeups.
+ */
+static void genpd_track_off(struct generic_pm_domain *genpd)
+{
+	if (genpd_is_cpu_domain(genpd) && genpd->gd)
+		genpd->gd->off_start = ktime_get();
+}
+
+static void genpd_track_on(struct generic_pm_domain *genpd)
+{
+	struct genpd_governor_data *gd = genpd->gd;
+	ktime_t now;
+	s64 residency_ns;
+
+	if (!genpd_is_cpu_domain(genpd) || !gd || !gd->off_start)
+		return;
+
+	now = ktime_get();
+	residency_ns = ktime_to_ns(ktime_sub(now, gd->off_start));
+	gd->off_start = 0;
+
+	if (!ktime_before(now, gd->next_hrtimer))
+		residency_ns = S64_MAX;
+
+	gd->early_wakeup_ns[gd->early_wakeup_idx] = residency_ns;
+	gd->early_wakeup_idx = (gd->early_wakeup_idx + 1) % GENPD_GOV_OFF_HISTORY;
+}
+
 static int _genpd_reeval_performance_state(struct generic_pm_domain *genpd,
 					   unsigned int state)
 {
@@ -848,6 +879,7 @@ static int genpd_power_off(struct generic_pm_domain *genpd, bool one_dev_on,
 	genpd->status = GENPD_STATE_OFF;
 	genpd_update_accounting(genpd);
 	genpd->states[genpd->state_idx].usage++;
+	genpd_track_off(genpd);
 
 	list_for_each_entry(link, &genpd->child_links, child_node) {
 		genpd_sd_counter_dec(link->parent);
@@ -901,6 +933,7 @@ static int genpd_power_on(struct generic_pm_domain *genpd, unsigned int depth)
 
 	genpd->status = GENPD_STATE_ON;
 	genpd_update_accounting(genpd);
+	genpd_track_on(genpd);
 
 	return 0;
 
@@ -2096,7 +2129,7 @@ static int genpd_set_default_power_state(struct generic_pm_domain *genpd)
 static int genpd_alloc_data(struct generic_pm_domain *genpd)
 {
 	struct genpd_governor_data *gd = NULL;
-	int ret;
+	int ret, i;
 
 	if (genpd_is_cpu_domain(genpd) &&
 	    !zalloc_cpumask_var(&genpd->cpus, GFP_KERNEL))
@@ -2113,6 +2146,8 @@ static int genpd_alloc_data(struct generic_pm_domain *genpd)
 		gd->max_off_time_changed = true;
 		gd->next_wakeup = KTIME_MAX;
 		gd->next_hrtimer = KTIME_MAX;
+		for (i = 0; i < GENPD_GOV_OFF_HISTORY; i++)
+			gd->early_wakeup_ns[i] = S64_MAX;
 	}
 
 	/* Use only one "off" state if there were no states declared */
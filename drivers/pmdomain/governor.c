@@ -343,6 +343,37 @@ static bool default_power_down_ok(struct dev_pm_domain *pd)
 }
 
 #ifdef CONFIG_CPU_IDLE
+/*
+ * Check the recent off periods of the domain which ended before the timer
+ * wakeup they were predicted from, typically because of an IRQ. If most of
+ * them did not last long enough to pay back the cost of entering and leaving
+ * @state, chances are the next one will not either.
+ */
+static bool cpu_state_early_wakeup(struct genpd_governor_data *gd,
+				   struct genpd_power_state *state)
+{
+	s64 cost_ns = state->residency_ns + state->power_off_latency_ns +
+		      state->power_on_latency_ns;
+	unsigned int i, early = 0;
+
+	for (i = 0; i < GENPD_GOV_OFF_HISTORY; i++)
+		if (gd->early_wakeup_ns[i] < cost_ns)
+			early++;
+
+	return early > GENPD_GOV_OFF_HISTORY / 2;
+}
+
+/*
+ * Vetoing a state based on the history means no new samples are collected for
+ * it, so age out the oldest one each time to make sure the domain eventually
+ * gets to try again when the IRQ pattern has changed.
+ */
+static void cpu_age_early_wakeups(struct genpd_governor_data *gd)
+{
+	gd->early_wakeup_ns[gd->early_wakeup_idx] = S64_MAX;
+	gd->early_wakeup_idx = (gd->early_wakeup_idx + 1) % GENPD_GOV_OFF_HISTORY;
+}
+
 static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 {
 	struct generic_pm_domain *genpd = pd_to_genpd(pd);
@@ -350,6 +381,7 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	ktime_t domain_wakeup, next_hrtimer;
 	ktime_t now = ktime_get();
 	s64 idle_duration_ns;
+	bool vetoed = false;
 	int cpu, i;
 
 	/* Validate dev PM QoS constraints. */
@@ -385,17 +417,27 @@ static bool cpu_power_down_ok(struct dev_pm_domain *pd)
 	/*
 	 * Find the deepest idle state that has its residency value satisfied
 	 * and by also taking into account the power off latency for the state.
+	 * Skip states that recent IRQ wakeups suggest would be left too early.
 	 * Start at the state picked by the dev PM QoS constraint validation.
 	 */
 	i = genpd->state_idx;
 	do {
-		if (idle_duration_ns >= (genpd->states[i].residency_ns +
-		    genpd->states[i].power_off_latency_ns)) {
-			genpd->state_idx = i;
-			return true;
+		if (idle_duration_ns < (genpd->states[i].residency_ns +
+		    genpd->states[i].power_off_latency_ns))
+			continue;
+
+		if (cpu_state_early_wakeup(genpd->gd, &genpd->states[i])) {
+			vetoed = true;
+			continue;
 		}
+
+		genpd->state_idx = i;
+		return true;
 	} while (--i >= 0);
 
+	if (vetoed)
+		cpu_age_early_wakeups(genpd->gd);
+
 	return false;
 }
 
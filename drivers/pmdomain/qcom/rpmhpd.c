@@ -20,6 +20,9 @@
 
 #define RPMH_ARC_MAX_LEVELS	16
 
+/* Nothing sent to RPMh yet, so even a vote for corner 0 has to go out */
+#define RPMHPD_CORNER_UNSENT	UINT_MAX
+
 /**
  * struct rpmhpd - top level RPMh power domain resource data structure
  * @dev:		rpmh power domain controller device
@@ -29,7 +32,9 @@
  *			supported
  * @active_only:	True if it represents an Active only peer
  * @corner:		current corner
- * @active_corner:	current active corner
+ * @active_corner:	current active corner, or RPMHPD_CORNER_UNSENT
+ * @wake_corner:	last WAKE_ONLY corner sent to RPMh, or RPMHPD_CORNER_UNSENT
+ * @sleep_corner:	last SLEEP corner sent to RPMh, or RPMHPD_CORNER_UNSENT
  * @enable_corner:	lowest non-zero corner
  * @level:		An array of level (vlvl) to corner (hlvl) mappings
  *			derived from cmd-db
@@ -50,6 +55,8 @@ struct rpmhpd {
 	const bool	active_only;
 	unsigned int	corner;
 	unsigned int	active_corner;
+	unsigned int	wake_corner;
+	unsigned int	sleep_corner;
 	unsigned int	enable_corner;
 	u32		level[RPMH_ARC_MAX_LEVELS];
 	size_t		level_count;
@@ -687,6 +694,8 @@ static void to_active_sleep(struct rpmhpd *pd, unsigned int corner,
  * on system sleep).
  * We send ACTIVE_ONLY votes for resources without any peers. For others,
  * which have an active only peer, all 3 votes are sent.
+ * A domain and its peer share the same RPMh resource, so each vote is only
+ * sent when it differs from the one last sent for either of them.
  */
 static int rpmhpd_aggregate_corner(struct rpmhpd *pd, unsigned int corner)
 {
@@ -713,28 +722,44 @@ static int rpmhpd_aggregate_corner(struct rpmhpd *pd, unsigned int corner)
 
 	active_corner = max(this_active_corner, peer_active_corner);
 
-	ret = rpmhpd_send_corner(pd, RPMH_ACTIVE_ONLY_STATE, active_corner,
-				 active_corner > pd->active_corner);
-	if (ret)
-		return ret;
+	if (active_corner != pd->active_corner) {
+		ret = rpmhpd_send_corner(pd, RPMH_ACTIVE_ONLY_STATE,
+					 active_corner,
+					 pd->active_corner == RPMHPD_CORNER_UNSENT ||
+					 active_corner > pd->active_corner);
+		if (ret)
+			return ret;
+	}
 
 	pd->active_corner = active_corner;
 
 	if (peer) {
 		peer->active_corner = active_corner;
 
-		ret = rpmhpd_send_corner(pd, RPMH_WAKE_ONLY_STATE,
-					 active_corner, false);
-		if (ret)
-			return ret;
+		if (active_corner != pd->wake_corner) {
+			ret = rpmhpd_send_corner(pd, RPMH_WAKE_ONLY_STATE,
+						 active_corner, false);
+			if (ret)
+				return ret;
+
+			pd->wake_corner = active_corner;
+			peer->wake_corner = active_corner;
+		}
 
 		sleep_corner = max(this_sleep_corner, peer_sleep_corner);
 
-		return rpmhpd_send_corner(pd, RPMH_SLEEP_STATE, sleep_corner,
-					  false);
+		if (sleep_corner != pd->sleep_corner) {
+			ret = rpmhpd_send_corner(pd, RPMH_SLEEP_STATE,
+						 sleep_corner, false);
+			if (ret)
+				return ret;
+
+			pd->sleep_corner = sleep_corner;
+			peer->sleep_corner = sleep_corner;
+		}
 	}
 
-	return ret;
+	return 0;
 }
 
 static int rpmhpd_power_on(struct generic_pm_domain *domain)
@@ -879,6 +904,9 @@ static int rpmhpd_probe(struct platform_device *pdev)
 			continue;
 
 		rpmhpds[i]->dev = dev;
+		rpmhpds[i]->active_corner = RPMHPD_CORNER_UNSENT;
+		rpmhpds[i]->wake_corner = RPMHPD_CORNER_UNSENT;
+		rpmhpds[i]->sleep_corner = RPMHPD_CORNER_UNSENT;
 		rpmhpds[i]->addr = cmd_db_read_addr(rpmhpds[i]->res_name);
 		if (!rpmhpds[i]->addr) {
 			dev_err(dev, "Could not find RPMh address for resource %s\n",
@@ -154,40 +154,50 @@ struct rpmh_vreg_init_data {
 /**
  * rpmh_regulator_send_request() - send the request to RPMh
  * @vreg:		Pointer to the RPMh regulator
- * @cmd:		Pointer to the RPMh command to send
+ * @cmd:		Pointer to the RPMh commands to send
+ * @n:			Number of commands in @cmd, all of which are sent
+ *			in a single request
  * @wait_for_ack:	Boolean indicating if execution must wait until the
  *			request has been acknowledged as complete
  *
  * Return: 0 on success, errno on failure
  */
 static int rpmh_regulator_send_request(struct rpmh_vreg *vreg,
-			struct tcs_cmd *cmd, bool wait_for_ack)
+			struct tcs_cmd *cmd, u32 n, bool wait_for_ack)
 {
 	int ret;
 
 	if (wait_for_ack || vreg->always_wait_for_ack)
-		ret = rpmh_write(vreg->dev, RPMH_ACTIVE_ONLY_STATE, cmd, 1);
+		ret = rpmh_write(vreg->dev, RPMH_ACTIVE_ONLY_STATE, cmd, n);
 	else
 		ret = rpmh_write_async(vreg->dev, RPMH_ACTIVE_ONLY_STATE, cmd,
-					1);
+					n);
 
 	return ret;
 }
 
+static void rpmh_regulator_vrm_voltage_cmd(struct regulator_dev *rdev,
+				unsigned int selector, struct tcs_cmd *cmd)
+{
+	struct rpmh_vreg *vreg = rdev_get_drvdata(rdev);
+
+	cmd->addr = vreg->addr + RPMH_REGULATOR_REG_VRM_VOLTAGE;
+
+	/* VRM voltage control register is set with voltage in millivolts. */
+	cmd->data = DIV_ROUND_UP(regulator_list_voltage_linear_range(rdev,
+							selector), 1000);
+}
+
 static int _rpmh_regulator_vrm_set_voltage_sel(struct regulator_dev *rdev,
 				unsigned int selector, bool wait_for_ack)
 {
 	struct rpmh_vreg *vreg = rdev_get_drvdata(rdev);
-	struct tcs_cmd cmd = {
-		.addr = vreg->addr + RPMH_REGULATOR_REG_VRM_VOLTAGE,
-	};
+	struct tcs_cmd cmd = { };
 	int ret;
 
-	/* VRM voltage control register is set with voltage in millivolts. */
-	cmd.data = DIV_ROUND_UP(regulator_list_voltage_linear_range(rdev,
-							selector), 1000);
+	rpmh_regulator_vrm_voltage_cmd(rdev, selector, &cmd);
 
-	ret = rpmh_regulator_send_request(vreg, &cmd, wait_for_ack);
+	ret = rpmh_regulator_send_request(vreg, &cmd, 1, wait_for_ack);
 	if (!ret)
 		vreg->voltage_selector = selector;
 
@@ -208,6 +218,9 @@ static int rpmh_regulator_vrm_set_voltage_sel(struct regulator_dev *rdev,
 		return 0;
 	}
 
+	if (selector == vreg->voltage_selector)
+		return 0;
+
 	return _rpmh_regulator_vrm_set_voltage_sel(rdev, selector,
 					selector > vreg->voltage_selector);
 }
@@ -230,21 +243,27 @@ static int rpmh_regulator_set_enable_state(struct regulator_dev *rdev,
 					bool enable)
 {
 	struct rpmh_vreg *vreg = rdev_get_drvdata(rdev);
-	struct tcs_cmd cmd = {
-		.addr = vreg->addr + RPMH_REGULATOR_REG_ENABLE,
-		.data = enable,
-	};
+	struct tcs_cmd cmd[2] = { };
+	bool wait_for_ack = enable;
+	u32 n = 0;
 	int ret;
 
+	/*
+	 * The first enable or disable also sends the voltage that was cached
+	 * before the regulator state was known. Both registers belong to
+	 * the same VRM resource, so carry them in one request.
+	 */
 	if (vreg->enabled == -EINVAL &&
 	    vreg->voltage_selector != -ENOTRECOVERABLE) {
-		ret = _rpmh_regulator_vrm_set_voltage_sel(rdev,
-						vreg->voltage_selector, true);
-		if (ret < 0)
-			return ret;
+		rpmh_regulator_vrm_voltage_cmd(rdev, vreg->voltage_selector,
+					       &cmd[n++]);
+		wait_for_ack = true;
 	}
 
-	ret = rpmh_regulator_send_request(vreg, &cmd, enable);
+	cmd[n].addr = vreg->addr + RPMH_REGULATOR_REG_ENABLE;
+	cmd[n++].data = enable;
+
+	ret = rpmh_regulator_send_request(vreg, cmd, n, wait_for_ack);
 	if (!ret)
 		vreg->enabled = enable;
 
@@ -281,7 +300,7 @@ static int rpmh_regulator_vrm_set_mode_bypass(struct rpmh_vreg *vreg,
 	else
 		cmd.data = pmic_mode;
 
-	return rpmh_regulator_send_request(vreg, &cmd, true);
+	return rpmh_regulator_send_request(vreg, &cmd, 1, true);
 }
 
 static int rpmh_regulator_vrm_set_mode(struct regulator_dev *rdev,
@@ -84,6 +84,8 @@ struct glink_core_rx_intent {
  * @rx_lock:	protects the @rx_queue
  * @rx_queue:	queue of received control messages to be processed in @rx_work
  * @tx_lock:	synchronizes operations on the tx fifo
+ * @tx_batch:	nesting count of open tx batches, kicks are deferred while set
+ * @tx_kick_pending: data was written to the tx fifo without kicking the remote
  * @idr_lock:	synchronizes @lcids and @rcids modifications
  * @lcids:	idr of all channels with a known local channel id
  * @rcids:	idr of all channels with a known remote channel id
@@ -104,6 +106,8 @@ struct qcom_glink {
 	struct list_head rx_queue;
 
 	spinlock_t tx_lock;
+	unsigned int tx_batch;
+	bool tx_kick_pending;
 
 	spinlock_t idr_lock;
 	struct idr lcids;
@@ -139,6 +143,8 @@ enum {
  * @riids:	idr of all remote intents
  * @intent_work: worker responsible for transmitting rx_done packets
  * @done_intents: list of intents that needs to be announced rx_done
+ * @intent_pool: consumed single-use intents kept for reallocation
+ * @intent_pool_len: number of entries in @intent_pool
  * @buf:	receive buffer, for gathering fragments
  * @buf_offset:	write offset in @buf
  * @buf_size:	size of current @buf
@@ -168,6 +174,8 @@ struct glink_channel {
 	struct idr riids;
 	struct work_struct intent_work;
 	struct list_head done_intents;
+	struct list_head intent_pool;
+	unsigned int intent_pool_len;
 
 	struct glink_core_rx_intent *buf;
 	int buf_offset;
@@ -204,6 +212,8 @@ static const struct rpmsg_endpoint_ops glink_endpoint_ops;
 
 #define GLINK_FEATURE_INTENTLESS	BIT(1)
 
+#define GLINK_INTENT_POOL_MAX		4
+
 #define NATIVE_DTR_SIG			NATIVE_DSR_SIG
 #define NATIVE_DSR_SIG			BIT(31)
 #define NATIVE_RTS_SIG			NATIVE_CTS_SIG
@@ -237,6 +247,7 @@ static struct glink_channel *qcom_glink_alloc_channel(struct qcom_glink *glink,
 	init_waitqueue_head(&channel->intent_req_wq);
 
 	INIT_LIST_HEAD(&channel->done_intents);
+	INIT_LIST_HEAD(&channel->intent_pool);
 	INIT_WORK(&channel->intent_work, qcom_glink_rx_done_work);
 
 	idr_init(&channel->liids);
@@ -276,6 +287,11 @@ static void qcom_glink_channel_release(struct kref *ref)
 	idr_for_each_entry(&channel->riids, tmp, iid)
 		kfree(tmp);
 	idr_destroy(&channel->riids);
+
+	list_for_each_entry_safe(intent, tmp, &channel->intent_pool, node) {
+		kfree(intent->data);
+		kfree(intent);
+	}
 	spin_unlock_irqrestore(&channel->intent_lock, flags);
 
 	kfree(channel->name);
@@ -315,6 +331,32 @@ static void qcom_glink_tx_kick(struct qcom_glink *glink)
 	glink->tx_pipe->kick(glink->tx_pipe);
 }
 
+/*
+ * Writes made between qcom_glink_tx_batch_begin() and _end() only kick the
+ * remote once the fifo is half full, when a writer has to wait for space or
+ * when the outermost batch ends, so bursts of commands cost one interrupt.
+ */
+static void qcom_glink_tx_batch_begin(struct qcom_glink *glink)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&glink->tx_lock, flags);
+	glink->tx_batch++;
+	spin_unlock_irqrestore(&glink->tx_lock, flags);
+}
+
+static void qcom_glink_tx_batch_end(struct qcom_glink *glink)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&glink->tx_lock, flags);
+	if (!--glink->tx_batch && glink->tx_kick_pending) {
+		glink->tx_kick_pending = false;
+		qcom_glink_tx_kick(glink);
+	}
+	spin_unlock_irqrestore(&glink->tx_lock, flags);
+}
+
 static void qcom_glink_send_read_notify(struct qcom_glink *glink)
 {
 	struct glink_msg msg;
@@ -325,6 +367,7 @@ static void qcom_glink_send_read_notify(struct qcom_glink *glink)
 
 	qcom_glink_tx_write(glink, &msg, sizeof(msg), NULL, 0);
 
+	glink->tx_kick_pending = false;
 	qcom_glink_tx_kick(glink);
 }
 
@@ -361,6 +404,9 @@ static int qcom_glink_tx(struct qcom_glink *glink,
 		if (!glink->sent_read_notify) {
 			glink->sent_read_notify = true;
 			qcom_glink_send_read_notify(glink);
+		} else if (glink->tx_kick_pending) {
+			glink->tx_kick_pending = false;
+			qcom_glink_tx_kick(glink);
 		}
 
 		/* Wait without holding the tx_lock */
@@ -376,7 +422,14 @@ static int qcom_glink_tx(struct qcom_glink *glink,
 	}
 
 	qcom_glink_tx_write(glink, hdr, hlen, data, dlen);
-	qcom_glink_tx_kick(glink);
+
+	if (glink->tx_batch &&
+	    qcom_glink_tx_avail(glink) > glink->tx_pipe->length / 2) {
+		glink->tx_kick_pending = true;
+	} else {
+		glink->tx_kick_pending = false;
+		qcom_glink_tx_kick(glink);
+	}
 
 out:
 	spin_unlock_irqrestore(&glink->tx_lock, flags);
@@ -520,6 +573,54 @@ static void qcom_glink_send_close_ack(struct qcom_glink *glink,
 	qcom_glink_tx(glink, &req, sizeof(req), NULL, 0, true);
 }
 
+/*
+ * Single-use intents are requested over and over with the same handful of
+ * sizes by most remotes, so rather than freeing them once consumed keep a
+ * few around and hand them out again for a request of the same size.
+ */
+static struct glink_core_rx_intent *
+qcom_glink_intent_pool_get(struct glink_channel *channel, size_t size)
+{
+	struct glink_core_rx_intent *intent;
+	unsigned long flags;
+
+	spin_lock_irqsave(&channel->intent_lock, flags);
+	list_for_each_entry(intent, &channel->intent_pool, node) {
+		if (intent->size != size)
+			continue;
+
+		list_del(&intent->node);
+		channel->intent_pool_len--;
+		spin_unlock_irqrestore(&channel->intent_lock, flags);
+
+		intent->offset = 0;
+		intent->in_use = false;
+		return intent;
+	}
+	spin_unlock_irqrestore(&channel->intent_lock, flags);
+
+	return NULL;
+}
+
+static void qcom_glink_intent_pool_put(struct glink_channel *channel,
+				       struct glink_core_rx_intent *intent)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&channel->intent_lock, flags);
+	if (channel->intent_pool_len < GLINK_INTENT_POOL_MAX) {
+		list_add(&intent->node, &channel->intent_pool);
+		channel->intent_pool_len++;
+		intent = NULL;
+	}
+	spin_unlock_irqrestore(&channel->intent_lock, flags);
+
+	if (intent) {
+		kfree(intent->data);
+		kfree(intent);
+	}
+}
+
 static void qcom_glink_rx_done_work(struct work_struct *work)
 {
 	struct glink_channel *channel = container_of(work, struct glink_channel,
@@ -537,6 +638,7 @@ static void qcom_glink_rx_done_work(struct work_struct *work)
 	bool reuse;
 	unsigned long flags;
 
+	qcom_glink_tx_batch_begin(glink);
 	spin_lock_irqsave(&channel->intent_lock, flags);
 	list_for_each_entry_safe(intent, tmp, &channel->done_intents, node) {
 		list_del(&intent->node);
@@ -549,13 +651,12 @@ static void qcom_glink_rx_done_work(struct work_struct *work)
 		cmd.liid = iid;
 
 		qcom_glink_tx(glink, &cmd, sizeof(cmd), NULL, 0, true);
-		if (!reuse) {
-			kfree(intent->data);
-			kfree(intent);
-		}
+		if (!reuse)
+			qcom_glink_intent_pool_put(channel, intent);
 		spin_lock_irqsave(&channel->intent_lock, flags);
 	}
 	spin_unlock_irqrestore(&channel->intent_lock, flags);
+	qcom_glink_tx_batch_end(glink);
 }
 
 static void qcom_glink_rx_done(struct qcom_glink *glink,
@@ -564,8 +665,7 @@ static void qcom_glink_rx_done(struct qcom_glink *glink,
 {
 	/* We don't send RX_DONE to intentless systems */
 	if (glink->intentless) {
-		kfree(intent->data);
-		kfree(intent);
+		qcom_glink_intent_pool_put(channel, intent);
 		return;
 	}
 
@@ -708,13 +808,16 @@ qcom_glink_alloc_intent(struct qcom_glink *glink,
 	int ret;
 	unsigned long flags;
 
-	intent = kzalloc(sizeof(*intent), GFP_KERNEL);
-	if (!intent)
-		return NULL;
+	intent = reuseable ? NULL : qcom_glink_intent_pool_get(channel, size);
+	if (!intent) {
+		intent = kzalloc(sizeof(*intent), GFP_KERNEL);
+		if (!intent)
+			return NULL;
 
-	intent->data = kzalloc(size, GFP_KERNEL);
-	if (!intent->data)
-		goto free_intent;
+		intent->data = kzalloc(size, GFP_KERNEL);
+		if (!intent->data)
+			goto free_intent;
+	}
 
 	spin_lock_irqsave(&channel->intent_lock, flags);
 	ret = idr_alloc_cyclic(&channel->liids, intent, 1, -1, GFP_ATOMIC);
@@ -882,15 +985,19 @@ static int qcom_glink_rx_data(struct qcom_glink *glink, size_t avail)
 	if (glink->intentless) {
 		/* Might have an ongoing, fragmented, message to append */
 		if (!channel->buf) {
-			intent = kzalloc(sizeof(*intent), GFP_ATOMIC);
-			if (!intent)
-				return -ENOMEM;
-
-			intent->data = kmalloc(chunk_size + left_size,
-					       GFP_ATOMIC);
-			if (!intent->data) {
-				kfree(intent);
-				return -ENOMEM;
+			intent = qcom_glink_intent_pool_get(channel,
+							    chunk_size + left_size);
+			if (!intent) {
+				intent = kzalloc(sizeof(*intent), GFP_ATOMIC);
+				if (!intent)
+					return -ENOMEM;
+
+				intent->data = kmalloc(chunk_size + left_size,
+						       GFP_ATOMIC);
+				if (!intent->data) {
+					kfree(intent);
+					return -ENOMEM;
+				}
 			}
 
 			intent->id = 0xbabababa;
@@ -1297,6 +1404,7 @@ static int qcom_glink_announce_create(struct rpmsg_device *rpdev)
 	}
 
 	/* Channel is now open, advertise base set of intents */
+	qcom_glink_tx_batch_begin(glink);
 	while (num_groups--) {
 		size = be32_to_cpup(val++);
 		num_intents = be32_to_cpup(val++);
@@ -1309,6 +1417,7 @@ static int qcom_glink_announce_create(struct rpmsg_device *rpdev)
 			qcom_glink_advertise_intent(glink, channel, intent);
 		}
 	}
+	qcom_glink_tx_batch_end(glink);
 	return 0;
 }
 
@@ -14,6 +14,7 @@
 #include <linux/delay.h>
 #include <linux/pm_runtime.h>
 #include <linux/mutex.h>
+#include <linux/wait.h>
 #include <linux/notifier.h>
 #include <linux/remoteproc/qcom_rproc.h>
 #include <linux/of.h>
@@ -162,6 +163,7 @@ struct qcom_slim_ngd_ctrl {
 	struct workqueue_struct *mwq;
 	struct completion qmi_up;
 	spinlock_t tx_buf_lock;
+	wait_queue_head_t tx_wq;
 	struct mutex tx_lock;
 	struct mutex ssr_lock;
 	struct notifier_block nb;
@@ -561,6 +563,31 @@ static void qcom_slim_ngd_tx_msg_dma_cb(void *args)
 
 	ctrl->tx_head = (ctrl->tx_head + 1) % QCOM_SLIM_NGD_DESC_NUM;
 	spin_unlock_irqrestore(&ctrl->tx_buf_lock, flags);
+
+	wake_up(&ctrl->tx_wq);
+}
+
+static bool qcom_slim_ngd_tx_idle(struct qcom_slim_ngd_ctrl *ctrl)
+{
+	unsigned long flags;
+	bool idle;
+
+	spin_lock_irqsave(&ctrl->tx_buf_lock, flags);
+	idle = ctrl->tx_head == ctrl->tx_tail;
+	spin_unlock_irqrestore(&ctrl->tx_buf_lock, flags);
+
+	return idle;
+}
+
+/* Wait for posted messages still queued on the BAM to go out */
+static int qcom_slim_ngd_tx_drain(struct qcom_slim_ngd_ctrl *ctrl)
+{
+	if (!wait_event_timeout(ctrl->tx_wq, qcom_slim_ngd_tx_idle(ctrl), HZ)) {
+		dev_err(ctrl->dev, "TX drain timed out\n");
+		return -ETIMEDOUT;
+	}
+
+	return 0;
 }
 
 static int qcom_slim_ngd_tx_msg_post(struct qcom_slim_ngd_ctrl *ctrl,
@@ -795,6 +822,7 @@ static int qcom_slim_ngd_xfer_msg(struct slim_controller *sctrl,
 	u8 *puc;
 	u8 la = txn->la;
 	bool usr_msg = false;
+	bool posted;
 
 	if (txn->mt == SLIM_MSG_MT_CORE &&
 		(txn->mc >= SLIM_MSG_MC_BEGIN_RECONFIGURATION &&
@@ -810,7 +838,25 @@ static int qcom_slim_ngd_xfer_msg(struct slim_controller *sctrl,
 		return -EINVAL;
 	}
 
-	pbuf = qcom_slim_ngd_tx_msg_get(ctrl, txn->rl, &tx_sent);
+	/*
+	 * Value element writes carry no TID and expect no reply, so they are
+	 * posted: queued on the BAM without waiting for their own TX
+	 * completion. Back to back writes then chain up in the BAM FIFO and
+	 * the next message that does wait also covers everything ahead of it.
+	 */
+	posted = txn->mt == SLIM_MSG_MT_CORE &&
+		 (txn->mc == SLIM_MSG_MC_CHANGE_VALUE ||
+		  txn->mc == SLIM_MSG_MC_CLEAR_INFORMATION);
+
+	if (posted) {
+		/* a burst of posted writes may fill the ring, let it drain */
+		wait_event_timeout(ctrl->tx_wq,
+				   (pbuf = qcom_slim_ngd_tx_msg_get(ctrl, txn->rl,
+								    NULL)),
+				   HZ);
+	} else {
+		pbuf = qcom_slim_ngd_tx_msg_get(ctrl, txn->rl, &tx_sent);
+	}
 	if (!pbuf) {
 		dev_err(ctrl->dev, "Message buffer unavailable\n");
 		return -ENOMEM;
@@ -890,6 +936,11 @@ static int qcom_slim_ngd_xfer_msg(struct slim_controller *sctrl,
 		return ret;
 	}
 
+	if (posted) {
+		mutex_unlock(&ctrl->tx_lock);
+		return 0;
+	}
+
 	timeout = wait_for_completion_timeout(&tx_sent, HZ);
 	if (!timeout) {
 		dev_err(sctrl->dev, "TX timed out:MC:0x%x,mt:0x%x", txn->mc,
@@ -1649,6 +1700,7 @@ static int qcom_slim_ngd_ctrl_probe(struct platform_device *pdev)
 	mutex_init(&ctrl->tx_lock);
 	mutex_init(&ctrl->ssr_lock);
 	spin_lock_init(&ctrl->tx_buf_lock);
+	init_waitqueue_head(&ctrl->tx_wq);
 	init_completion(&ctrl->reconf);
 	init_completion(&ctrl->qmi.qmi_comp);
 	init_completion(&ctrl->qmi_up);
@@ -1715,6 +1767,7 @@ static int __maybe_unused qcom_slim_ngd_runtime_suspend(struct device *dev)
 	struct qcom_slim_ngd_ctrl *ctrl = dev_get_drvdata(dev);
 	int ret = 0;
 
+	qcom_slim_ngd_tx_drain(ctrl);
 	qcom_slim_ngd_exit_dma(ctrl);
 	if (!ctrl->qmi.handle)
 		return 0;
@@ -6,18 +6,25 @@
  *         previous work of Thara Gopinath and msm-4.9 downstream sources.
  */
 
+#include <linux/debugfs.h>
+#include <linux/devfreq-event.h>
 #include <linux/err.h>
 #include <linux/interconnect.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/pm_opp.h>
 #include <linux/regmap.h>
+#include <linux/seq_file.h>
 #include <linux/sizes.h>
 
+#define CREATE_TRACE_POINTS
+#include "trace-bwmon.h"
+
 /*
  * The BWMON samples data throughput within 'sample_ms' time. With three
  * configurable thresholds (Low, Medium and High) gives four windows (called
@@ -29,6 +36,11 @@
  * Zone 3: THRES_HIGH < byte count
  *
  * Zones 0 and 2 are not used by this driver.
+ *
+ * Every measured window that raised an interrupt is kept in a small history
+ * ring, written only from the hard IRQ handler and read locklessly, so the
+ * measurements can be consumed through devfreq-event, debugfs and trace
+ * events without touching the hardware.
  */
 
 /* Internal sampling clock frequency */
@@ -130,6 +142,9 @@
 #define BWMON_HAS_GLOBAL_IRQ			BIT(0)
 #define BWMON_NEEDS_FORCE_CLEAR			BIT(1)
 
+/* Number of measured windows kept, must be a power of two */
+#define BWMON_HISTORY_LEN			64
+
 enum bwmon_fields {
 	/* Global region fields, keep them at the top */
 	F_GLOBAL_IRQ_CLEAR,
@@ -176,6 +191,17 @@ struct icc_bwmon_data {
 	const struct reg_field *global_regmap_fields;
 };
 
+/*
+ * One measured window. @seq is the history index + 1 once the entry is
+ * complete and 0 while it is being rewritten.
+ */
+struct bwmon_sample {
+	unsigned long seq;
+	u64 time_ns;
+	unsigned int zone;
+	unsigned int kbps;
+};
+
 struct icc_bwmon {
 	struct device *dev;
 	const struct icc_bwmon_data *data;
@@ -188,6 +214,13 @@ struct icc_bwmon {
 	unsigned int min_bw_kbps;
 	unsigned int target_kbps;
 	unsigned int current_kbps;
+
+	struct bwmon_sample history[BWMON_HISTORY_LEN];
+	unsigned long history_head;
+
+	struct devfreq_event_desc edesc;
+	struct devfreq_event_dev *edev;
+	struct dentry *debugfs;
 };
 
 /* BWMON v4 */
@@ -599,6 +632,53 @@ static void bwmon_start(struct icc_bwmon *bwmon)
 	bwmon_enable(bwmon, BWMON_IRQ_ENABLE_MASK);
 }
 
+/* Only ever called from bwmon_intr(), so there is a single writer */
+static void bwmon_history_add(struct icc_bwmon *bwmon, unsigned int zone,
+			      unsigned int kbps)
+{
+	unsigned long head = bwmon->history_head;
+	struct bwmon_sample *s = &bwmon->history[head & (BWMON_HISTORY_LEN - 1)];
+
+	WRITE_ONCE(s->seq, 0);
+	smp_wmb();
+	WRITE_ONCE(s->time_ns, ktime_get_ns());
+	WRITE_ONCE(s->zone, zone);
+	WRITE_ONCE(s->kbps, kbps);
+	smp_store_release(&s->seq, head + 1);
+	smp_store_release(&bwmon->history_head, head + 1);
+}
+
+/*
+ * Copy up to @n of the most recent windows, oldest first, into @out. Entries
+ * overwritten while being copied are dropped rather than returned torn.
+ */
+static unsigned int bwmon_history_read(struct icc_bwmon *bwmon,
+				       struct bwmon_sample *out, unsigned int n)
+{
+	unsigned long head = smp_load_acquire(&bwmon->history_head);
+	unsigned long idx, seq;
+	unsigned int count = 0;
+	struct bwmon_sample *s;
+
+	n = min3((unsigned long)n, (unsigned long)BWMON_HISTORY_LEN, head);
+
+	for (idx = head - n; idx != head; idx++) {
+		s = &bwmon->history[idx & (BWMON_HISTORY_LEN - 1)];
+
+		seq = smp_load_acquire(&s->seq);
+		out[count].time_ns = READ_ONCE(s->time_ns);
+		out[count].zone = READ_ONCE(s->zone);
+		out[count].kbps = READ_ONCE(s->kbps);
+		smp_rmb();
+		if (seq != idx + 1 || READ_ONCE(s->seq) != seq)
+			continue;
+
+		out[count++].seq = seq;
+	}
+
+	return count;
+}
+
 static irqreturn_t bwmon_intr(int irq, void *dev_id)
 {
 	struct icc_bwmon *bwmon = dev_id;
@@ -637,6 +717,9 @@ static irqreturn_t bwmon_intr(int irq, void *dev_id)
 	max *= bwmon->data->count_unit_kb;
 	bwmon->target_kbps = mult_frac(max, MSEC_PER_SEC, bwmon->data->sample_ms);
 
+	bwmon_history_add(bwmon, zone, bwmon->target_kbps);
+	trace_bwmon_sample(dev_name(bwmon->dev), zone, bwmon->target_kbps);
+
 	return IRQ_WAKE_THREAD;
 }
 
@@ -679,6 +762,9 @@ static irqreturn_t bwmon_intr_thread(int irq, void *dev_id)
 	bwmon_clear_irq(bwmon);
 	bwmon_enable(bwmon, irq_enable);
 
+	trace_bwmon_update(dev_name(bwmon->dev), bwmon->target_kbps, up_kbps,
+			   down_kbps);
+
 	if (bwmon->target_kbps == bwmon->current_kbps)
 		goto out;
 
@@ -743,6 +829,69 @@ static int bwmon_init_regmap(struct platform_device *pdev,
 	return ret;
 }
 
+static int bwmon_get_event(struct devfreq_event_dev *edev,
+			   struct devfreq_event_data *edata)
+{
+	struct icc_bwmon *bwmon = devfreq_event_get_drvdata(edev);
+	struct bwmon_sample last;
+
+	if (!bwmon_history_read(bwmon, &last, 1))
+		return -ENODATA;
+
+	edata->load_count = last.kbps;
+	edata->total_count = bwmon->max_bw_kbps;
+
+	return 0;
+}
+
+static const struct devfreq_event_ops bwmon_event_ops = {
+	.get_event = bwmon_get_event,
+};
+
+static int bwmon_history_show(struct seq_file *s, void *unused)
+{
+	struct icc_bwmon *bwmon = s->private;
+	struct bwmon_sample *samples;
+	unsigned int i, n;
+
+	samples = kcalloc(BWMON_HISTORY_LEN, sizeof(*samples), GFP_KERNEL);
+	if (!samples)
+		return -ENOMEM;
+
+	n = bwmon_history_read(bwmon, samples, BWMON_HISTORY_LEN);
+	for (i = 0; i < n; i++)
+		seq_printf(s, "%lu %llu %u %u\n", samples[i].seq - 1,
+			   samples[i].time_ns, samples[i].zone, samples[i].kbps);
+
+	kfree(samples);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(bwmon_history);
+
+static void bwmon_init_consumers(struct icc_bwmon *bwmon)
+{
+	struct device *dev = bwmon->dev;
+
+	bwmon->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_file("history", 0400, bwmon->debugfs, bwmon,
+			    &bwmon_history_fops);
+
+	if (!IS_ENABLED(CONFIG_PM_DEVFREQ_EVENT))
+		return;
+
+	bwmon->edesc.name = dev_name(dev);
+	bwmon->edesc.driver_data = bwmon;
+	bwmon->edesc.ops = &bwmon_event_ops;
+
+	bwmon->edev = devm_devfreq_event_add_edev(dev, &bwmon->edesc);
+	if (IS_ERR(bwmon->edev)) {
+		dev_warn(dev, "failed to add devfreq-event device: %ld\n",
+			 PTR_ERR(bwmon->edev));
+		bwmon->edev = NULL;
+	}
+}
+
 static int bwmon_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -795,6 +944,7 @@ static int bwmon_probe(struct platform_device *pdev)
 		return dev_err_probe(dev, ret, "failed to request IRQ\n");
 
 	platform_set_drvdata(pdev, bwmon);
+	bwmon_init_consumers(bwmon);
 	bwmon_start(bwmon);
 
 	return 0;
@@ -804,6 +954,7 @@ static void bwmon_remove(struct platform_device *pdev)
 {
 	struct icc_bwmon *bwmon = platform_get_drvdata(pdev);
 
+	debugfs_remove_recursive(bwmon->debugfs);
 	bwmon_disable(bwmon);
 	free_irq(bwmon->irq, bwmon);
 }
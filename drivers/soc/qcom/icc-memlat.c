@@ -0,0 +1,538 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Memory latency governor for the CPU to L3/LLCC/DDR interconnect paths.
+ *
+ * BWMON only raises the interconnect votes when the measured throughput gets
+ * high, which misses workloads that move little data but keep the cores
+ * stalled on memory.  This governor samples the per-CPU PMU counters of a
+ * cluster and, when a CPU looks memory latency bound, picks floors for the
+ * memory paths from the frequency that CPU runs at:
+ *
+ *   IPM   = instructions / cache refills      (instructions per miss)
+ *   stall = backend stall cycles / cycles
+ *
+ * A CPU is latency bound when IPM <= ipm_ceil and stall >= stall_floor.  The
+ * highest effective frequency of such CPUs selects a row of the
+ * "qcom,core-dev-table", which lists one peak bandwidth per interconnect
+ * path.  All paths are voted with a single bulk request.
+ *
+ * The BWMON votes on the same paths are left alone; the interconnect
+ * framework aggregates both, so the resulting vote is the larger of the
+ * throughput and the latency driven ones.
+ *
+ * Votes go up immediately.  They go down only after hyst_samples samples in
+ * a row asked for less, and not sooner than rate_limit_ms after the previous
+ * vote.
+ */
+
+#include <linux/cpu.h>
+#include <linux/cpuhotplug.h>
+#include <linux/cpumask.h>
+#include <linux/device.h>
+#include <linux/interconnect.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/perf_event.h>
+#include <linux/percpu.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+/* ARMv8 PMUv3 common events */
+#define MEMLAT_ARMV8_L2D_CACHE_REFILL		0x17
+#define MEMLAT_ARMV8_STALL_BACKEND		0x24
+
+#define MEMLAT_DEFAULT_SAMPLE_MS		10
+#define MEMLAT_DEFAULT_IPM_CEIL			400
+#define MEMLAT_DEFAULT_STALL_FLOOR		30
+#define MEMLAT_DEFAULT_HYST_SAMPLES		4
+#define MEMLAT_DEFAULT_RATE_LIMIT_MS		40
+
+enum memlat_events {
+	MEMLAT_INST,
+	MEMLAT_MISS,
+	MEMLAT_STALL,
+	MEMLAT_CYCLES,
+	MEMLAT_NUM_EVENTS
+};
+
+static const struct {
+	u32 type;
+	u64 config;
+} memlat_event_attrs[MEMLAT_NUM_EVENTS] = {
+	[MEMLAT_INST]	= { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+	[MEMLAT_MISS]	= { PERF_TYPE_RAW, MEMLAT_ARMV8_L2D_CACHE_REFILL },
+	[MEMLAT_STALL]	= { PERF_TYPE_RAW, MEMLAT_ARMV8_STALL_BACKEND },
+	[MEMLAT_CYCLES]	= { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+};
+
+struct memlat_cpu {
+	struct perf_event *events[MEMLAT_NUM_EVENTS];
+	u64 prev[MEMLAT_NUM_EVENTS];
+};
+
+struct icc_memlat {
+	struct device *dev;
+	struct cpumask cpus;
+	struct memlat_cpu __percpu *cpu;
+
+	struct icc_bulk_data *paths;
+	int num_paths;
+
+	/* Rows of (cpu_khz, kbps[num_paths]), sorted by cpu_khz */
+	u32 *table;
+	int num_levels;
+
+	/* Protects the per-CPU events and the state below */
+	struct mutex lock;
+	struct delayed_work work;
+	ktime_t last_sample;
+	ktime_t last_vote;
+	int cur_level;
+	unsigned int down_samples;
+
+	unsigned int sample_ms;
+	unsigned int ipm_ceil;
+	unsigned int stall_floor;
+	unsigned int hyst_samples;
+	unsigned int rate_limit_ms;
+
+	struct hlist_node node;
+};
+
+static enum cpuhp_state memlat_cpuhp_state;
+
+static inline u32 *memlat_row(struct icc_memlat *memlat, int level)
+{
+	return &memlat->table[level * (memlat->num_paths + 1)];
+}
+
+static void memlat_release_events(struct icc_memlat *memlat, unsigned int cpu)
+{
+	struct memlat_cpu *mc = per_cpu_ptr(memlat->cpu, cpu);
+	int i;
+
+	for (i = 0; i < MEMLAT_NUM_EVENTS; i++) {
+		if (mc->events[i])
+			perf_event_release_kernel(mc->events[i]);
+		mc->events[i] = NULL;
+	}
+}
+
+static int memlat_create_events(struct icc_memlat *memlat, unsigned int cpu)
+{
+	struct memlat_cpu *mc = per_cpu_ptr(memlat->cpu, cpu);
+	struct perf_event_attr attr = {
+		.size = sizeof(attr),
+		.pinned = 1,
+	};
+	struct perf_event *event;
+	int i;
+
+	for (i = 0; i < MEMLAT_NUM_EVENTS; i++) {
+		attr.type = memlat_event_attrs[i].type;
+		attr.config = memlat_event_attrs[i].config;
+
+		event = perf_event_create_kernel_counter(&attr, cpu, NULL,
+							 NULL, NULL);
+		if (IS_ERR(event)) {
+			memlat_release_events(memlat, cpu);
+			return PTR_ERR(event);
+		}
+
+		mc->events[i] = event;
+		mc->prev[i] = 0;
+	}
+
+	return 0;
+}
+
+/* Effective frequency in kHz of the CPU if it is latency bound, else 0 */
+static unsigned long memlat_sample_cpu(struct icc_memlat *memlat,
+				       unsigned int cpu, s64 elapsed_us)
+{
+	struct memlat_cpu *mc = per_cpu_ptr(memlat->cpu, cpu);
+	u64 delta[MEMLAT_NUM_EVENTS];
+	u64 enabled, running, val;
+	u64 ipm, stall_pct;
+	int i;
+
+	if (!mc->events[0])
+		return 0;
+
+	for (i = 0; i < MEMLAT_NUM_EVENTS; i++) {
+		val = perf_event_read_value(mc->events[i], &enabled, &running);
+		delta[i] = val - mc->prev[i];
+		mc->prev[i] = val;
+	}
+
+	if (!delta[MEMLAT_CYCLES])
+		return 0;
+
+	ipm = div64_u64(delta[MEMLAT_INST], max_t(u64, delta[MEMLAT_MISS], 1));
+	stall_pct = div64_u64(delta[MEMLAT_STALL] * 100, delta[MEMLAT_CYCLES]);
+
+	if (ipm > memlat->ipm_ceil || stall_pct < memlat->stall_floor)
+		return 0;
+
+	return div64_u64(delta[MEMLAT_CYCLES] * USEC_PER_MSEC, elapsed_us);
+}
+
+static int memlat_find_level(struct icc_memlat *memlat, unsigned long khz)
+{
+	int level;
+
+	if (!khz)
+		return -1;
+
+	for (level = memlat->num_levels - 1; level >= 0; level--)
+		if (memlat_row(memlat, level)[0] <= khz)
+			return level;
+
+	return -1;
+}
+
+static int memlat_vote(struct icc_memlat *memlat, int level)
+{
+	u32 *row = level < 0 ? NULL : memlat_row(memlat, level);
+	int i;
+
+	for (i = 0; i < memlat->num_paths; i++) {
+		memlat->paths[i].avg_bw = 0;
+		memlat->paths[i].peak_bw = row ? row[i + 1] : 0;
+	}
+
+	return icc_bulk_set_bw(memlat->num_paths, memlat->paths);
+}
+
+static void memlat_update(struct icc_memlat *memlat)
+{
+	unsigned long khz, max_khz = 0;
+	ktime_t now = ktime_get();
+	s64 elapsed_us;
+	unsigned int cpu;
+	int level;
+
+	elapsed_us = ktime_us_delta(now, memlat->last_sample);
+	memlat->last_sample = now;
+	if (elapsed_us <= 0)
+		return;
+
+	for_each_cpu_and(cpu, &memlat->cpus, cpu_online_mask) {
+		khz = memlat_sample_cpu(memlat, cpu, elapsed_us);
+		max_khz = max(max_khz, khz);
+	}
+
+	level = memlat_find_level(memlat, max_khz);
+	if (level >= memlat->cur_level) {
+		memlat->down_samples = 0;
+		if (level == memlat->cur_level)
+			return;
+	} else {
+		if (++memlat->down_samples < memlat->hyst_samples)
+			return;
+		if (ktime_ms_delta(now, memlat->last_vote) < memlat->rate_limit_ms)
+			return;
+		memlat->down_samples = 0;
+	}
+
+	if (memlat_vote(memlat, level)) {
+		dev_err_ratelimited(memlat->dev, "failed to vote level %d\n",
+				    level);
+		return;
+	}
+
+	memlat->cur_level = level;
+	memlat->last_vote = now;
+}
+
+static void memlat_work(struct work_struct *work)
+{
+	struct icc_memlat *memlat = container_of(to_delayed_work(work),
+						 struct icc_memlat, work);
+
+	mutex_lock(&memlat->lock);
+	memlat_update(memlat);
+	mutex_unlock(&memlat->lock);
+
+	queue_delayed_work(system_freezable_power_efficient_wq, &memlat->work,
+			   msecs_to_jiffies(READ_ONCE(memlat->sample_ms)));
+}
+
+static int memlat_cpu_online(unsigned int cpu, struct hlist_node *node)
+{
+	struct icc_memlat *memlat = hlist_entry_safe(node, struct icc_memlat, node);
+	int ret;
+
+	if (!cpumask_test_cpu(cpu, &memlat->cpus))
+		return 0;
+
+	mutex_lock(&memlat->lock);
+	ret = memlat_create_events(memlat, cpu);
+	mutex_unlock(&memlat->lock);
+
+	/* Without counters the CPU simply never counts as latency bound */
+	if (ret)
+		dev_warn(memlat->dev, "failed to create counters on CPU%u: %d\n",
+			 cpu, ret);
+
+	return 0;
+}
+
+static int memlat_cpu_offline(unsigned int cpu, struct hlist_node *node)
+{
+	struct icc_memlat *memlat = hlist_entry_safe(node, struct icc_memlat, node);
+
+	if (!cpumask_test_cpu(cpu, &memlat->cpus))
+		return 0;
+
+	mutex_lock(&memlat->lock);
+	memlat_release_events(memlat, cpu);
+	mutex_unlock(&memlat->lock);
+
+	return 0;
+}
+
+#define MEMLAT_ATTR(name, min)						\
+static ssize_t name##_show(struct device *dev,				\
+			   struct device_attribute *attr, char *buf)	\
+{									\
+	struct icc_memlat *memlat = dev_get_drvdata(dev);		\
+									\
+	return sysfs_emit(buf, "%u\n", READ_ONCE(memlat->name));	\
+}									\
+									\
+static ssize_t name##_store(struct device *dev,				\
+			    struct device_attribute *attr,		\
+			    const char *buf, size_t count)		\
+{									\
+	struct icc_memlat *memlat = dev_get_drvdata(dev);		\
+	unsigned int val;						\
+	int ret;							\
+									\
+	ret = kstrtouint(buf, 0, &val);					\
+	if (ret)							\
+		return ret;						\
+	if (val < (min))						\
+		return -EINVAL;						\
+									\
+	WRITE_ONCE(memlat->name, val);					\
+	return count;							\
+}									\
+static DEVICE_ATTR_RW(name)
+
+MEMLAT_ATTR(sample_ms, 1);
+MEMLAT_ATTR(ipm_ceil, 0);
+MEMLAT_ATTR(stall_floor, 0);
+MEMLAT_ATTR(hyst_samples, 1);
+MEMLAT_ATTR(rate_limit_ms, 0);
+
+static ssize_t cur_level_show(struct device *dev,
+			      struct device_attribute *attr, char *buf)
+{
+	struct icc_memlat *memlat = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", READ_ONCE(memlat->cur_level));
+}
+static DEVICE_ATTR_RO(cur_level);
+
+static struct attribute *memlat_attrs[] = {
+	&dev_attr_sample_ms.attr,
+	&dev_attr_ipm_ceil.attr,
+	&dev_attr_stall_floor.attr,
+	&dev_attr_hyst_samples.attr,
+	&dev_attr_rate_limit_ms.attr,
+	&dev_attr_cur_level.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(memlat);
+
+static int memlat_parse_cpus(struct icc_memlat *memlat)
+{
+	struct device *dev = memlat->dev;
+	struct device_node *cpu_np;
+	int i, cpu;
+
+	for (i = 0; ; i++) {
+		cpu_np = of_parse_phandle(dev->of_node, "qcom,cpulist", i);
+		if (!cpu_np)
+			break;
+
+		cpu = of_cpu_node_to_id(cpu_np);
+		of_node_put(cpu_np);
+		if (cpu < 0)
+			return dev_err_probe(dev, cpu, "invalid CPU in qcom,cpulist\n");
+
+		cpumask_set_cpu(cpu, &memlat->cpus);
+	}
+
+	if (cpumask_empty(&memlat->cpus))
+		return dev_err_probe(dev, -EINVAL, "missing qcom,cpulist\n");
+
+	return 0;
+}
+
+static int memlat_parse_table(struct icc_memlat *memlat)
+{
+	struct device *dev = memlat->dev;
+	int stride = memlat->num_paths + 1;
+	int len, i, ret;
+
+	len = of_property_count_u32_elems(dev->of_node, "qcom,core-dev-table");
+	if (len <= 0 || len % stride)
+		return dev_err_probe(dev, -EINVAL, "invalid qcom,core-dev-table\n");
+
+	memlat->table = devm_kcalloc(dev, len, sizeof(*memlat->table), GFP_KERNEL);
+	if (!memlat->table)
+		return -ENOMEM;
+
+	ret = of_property_read_u32_array(dev->of_node, "qcom,core-dev-table",
+					 memlat->table, len);
+	if (ret)
+		return ret;
+
+	memlat->num_levels = len / stride;
+	for (i = 1; i < memlat->num_levels; i++) {
+		if (memlat_row(memlat, i)[0] <= memlat_row(memlat, i - 1)[0])
+			return dev_err_probe(dev, -EINVAL,
+					     "qcom,core-dev-table not sorted\n");
+	}
+
+	return 0;
+}
+
+static int memlat_init_paths(struct icc_memlat *memlat)
+{
+	struct device *dev = memlat->dev;
+	int i, ret;
+
+	memlat->num_paths = of_property_count_strings(dev->of_node,
+						      "interconnect-names");
+	if (memlat->num_paths <= 0)
+		return dev_err_probe(dev, -EINVAL, "missing interconnects\n");
+
+	memlat->paths = devm_kcalloc(dev, memlat->num_paths,
+				     sizeof(*memlat->paths), GFP_KERNEL);
+	if (!memlat->paths)
+		return -ENOMEM;
+
+	for (i = 0; i < memlat->num_paths; i++) {
+		ret = of_property_read_string_index(dev->of_node,
+						    "interconnect-names", i,
+						    &memlat->paths[i].name);
+		if (ret)
+			return ret;
+	}
+
+	ret = devm_of_icc_bulk_get(dev, memlat->num_paths, memlat->paths);
+	if (ret)
+		return dev_err_probe(dev, ret, "failed to get interconnects\n");
+
+	return 0;
+}
+
+static int memlat_probe(struct platform_device *pdev)
+{
+	struct device *dev = &pdev->dev;
+	struct icc_memlat *memlat;
+	int ret;
+
+	memlat = devm_kzalloc(dev, sizeof(*memlat), GFP_KERNEL);
+	if (!memlat)
+		return -ENOMEM;
+
+	memlat->dev = dev;
+	memlat->cur_level = -1;
+	memlat->sample_ms = MEMLAT_DEFAULT_SAMPLE_MS;
+	memlat->ipm_ceil = MEMLAT_DEFAULT_IPM_CEIL;
+	memlat->stall_floor = MEMLAT_DEFAULT_STALL_FLOOR;
+	memlat->hyst_samples = MEMLAT_DEFAULT_HYST_SAMPLES;
+	memlat->rate_limit_ms = MEMLAT_DEFAULT_RATE_LIMIT_MS;
+	mutex_init(&memlat->lock);
+	INIT_DEFERRABLE_WORK(&memlat->work, memlat_work);
+
+	ret = memlat_parse_cpus(memlat);
+	if (ret)
+		return ret;
+
+	ret = memlat_init_paths(memlat);
+	if (ret)
+		return ret;
+
+	ret = memlat_parse_table(memlat);
+	if (ret)
+		return ret;
+
+	memlat->cpu = devm_alloc_percpu(dev, struct memlat_cpu);
+	if (!memlat->cpu)
+		return -ENOMEM;
+
+	platform_set_drvdata(pdev, memlat);
+
+	ret = cpuhp_state_add_instance(memlat_cpuhp_state, &memlat->node);
+	if (ret)
+		return dev_err_probe(dev, ret, "failed to add hotplug instance\n");
+
+	memlat->last_sample = ktime_get();
+	memlat->last_vote = memlat->last_sample;
+	queue_delayed_work(system_freezable_power_efficient_wq, &memlat->work,
+			   msecs_to_jiffies(memlat->sample_ms));
+
+	return 0;
+}
+
+static void memlat_remove(struct platform_device *pdev)
+{
+	struct icc_memlat *memlat = platform_get_drvdata(pdev);
+
+	cancel_delayed_work_sync(&memlat->work);
+	cpuhp_state_remove_instance(memlat_cpuhp_state, &memlat->node);
+	memlat_vote(memlat, -1);
+}
+
+static const struct of_device_id memlat_of_match[] = {
+	{ .compatible = "qcom,cpu-memlat" },
+	{}
+};
+MODULE_DEVICE_TABLE(of, memlat_of_match);
+
+static struct platform_driver memlat_driver = {
+	.probe = memlat_probe,
+	.remove_new = memlat_remove,
+	.driver = {
+		.name = "qcom-memlat",
+		.of_match_table = memlat_of_match,
+		.dev_groups = memlat_groups,
+	},
+};
+
+static int __init memlat_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN, "soc/qcom/memlat:online",
+				      memlat_cpu_online, memlat_cpu_offline);
+	if (ret < 0)
+		return ret;
+	memlat_cpuhp_state = ret;
+
+	ret = platform_driver_register(&memlat_driver);
+	if (ret)
+		cpuhp_remove_multi_state(memlat_cpuhp_state);
+
+	return ret;
+}
+module_init(memlat_init);
+
+static void __exit memlat_exit(void)
+{
+	platform_driver_unregister(&memlat_driver);
+	cpuhp_remove_multi_state(memlat_cpuhp_state);
+}
+module_exit(memlat_exit);
+
+MODULE_DESCRIPTION("QCOM CPU memory latency governor");
+MODULE_LICENSE("GPL");
@@ -8,9 +8,11 @@
  */
 
 #include <linux/bitfield.h>
+#include <linux/bitmap.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
 #include <linux/iopoll.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/of_platform.h>
 #include <linux/platform_device.h>
@@ -21,6 +23,9 @@
 
 #define AES_256_XTS_KEY_SIZE			64
 
+/* UFS CCAP.CFGC is 8 bits wide and counts from zero */
+#define QCOM_ICE_MAX_SLOTS			256
+
 /* QCOM ICE registers */
 #define QCOM_ICE_REG_VERSION			0x0008
 #define QCOM_ICE_REG_FUSE_SETTING		0x0010
@@ -46,6 +51,10 @@ struct qcom_ice {
 	struct device_link *link;
 
 	struct clk *core_clk;
+
+	/* keyslots known to hold no key, nothing to invalidate there */
+	struct mutex slot_lock;
+	DECLARE_BITMAP(slot_empty, QCOM_ICE_MAX_SLOTS);
 };
 
 static bool qcom_ice_check_supported(struct qcom_ice *ice)
@@ -189,9 +198,15 @@ int qcom_ice_program_key(struct qcom_ice *ice,
 	for (i = 0; i < ARRAY_SIZE(key.words); i++)
 		__cpu_to_be32s(&key.words[i]);
 
+	mutex_lock(&ice->slot_lock);
+	/* a failed program may still have left part of the key behind */
+	if (slot < QCOM_ICE_MAX_SLOTS)
+		clear_bit(slot, ice->slot_empty);
+
 	err = qcom_scm_ice_set_key(slot, key.bytes, AES_256_XTS_KEY_SIZE,
 				   QCOM_SCM_ICE_CIPHER_AES_256_XTS,
 				   data_unit_size);
+	mutex_unlock(&ice->slot_lock);
 
 	memzero_explicit(&key, sizeof(key));
 
@@ -201,7 +216,23 @@ EXPORT_SYMBOL_GPL(qcom_ice_program_key);
 
 int qcom_ice_evict_key(struct qcom_ice *ice, int slot)
 {
-	return qcom_scm_ice_invalidate_key(slot);
+	int err = 0;
+
+	/*
+	 * Slots only ever go from empty to programmed through
+	 * qcom_ice_program_key(), a controller reset can only clear them.
+	 * So a slot invalidated since its last program needs no further
+	 * trip into TZ.
+	 */
+	mutex_lock(&ice->slot_lock);
+	if (slot >= QCOM_ICE_MAX_SLOTS || !test_bit(slot, ice->slot_empty)) {
+		err = qcom_scm_ice_invalidate_key(slot);
+		if (!err && slot < QCOM_ICE_MAX_SLOTS)
+			set_bit(slot, ice->slot_empty);
+	}
+	mutex_unlock(&ice->slot_lock);
+
+	return err;
 }
 EXPORT_SYMBOL_GPL(qcom_ice_evict_key);
 
@@ -224,6 +255,7 @@ static struct qcom_ice *qcom_ice_create(struct device *dev,
 
 	engine->dev = dev;
 	engine->base = base;
+	mutex_init(&engine->slot_lock);
 
 	/*
 	 * Legacy DT binding uses different clk names for each consumer,
@@ -0,0 +1,518 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Performance monitor for the Qualcomm Last Level Cache Controller (LLCC).
+ *
+ * The LLCC perfmon block has a set of 32-bit counters in every bank. Each
+ * counter is attached to an event of one of the LLCC ports; events of the
+ * tag RAM port (TRP) can be narrowed down to a single slice with the TRP
+ * filter. Counters are programmed through the broadcast region and read and
+ * summed over all banks.
+ *
+ * There is no overflow interrupt we can rely on, so the counters are folded
+ * into the perf counts by a timer that runs well within the wrap period.
+ */
+
+#include <linux/bitfield.h>
+#include <linux/bitmap.h>
+#include <linux/cpuhotplug.h>
+#include <linux/cpumask.h>
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/perf_event.h>
+#include <linux/platform_device.h>
+#include <linux/regmap.h>
+#include <linux/slab.h>
+#include <linux/soc/qcom/llcc-qcom.h>
+
+/* Common perfmon registers (LLCC v1) */
+#define LLCC_PERFMON_MODE			0x3100c
+#define LLCC_PERFMON_DUMP			0x31010
+#define LLCC_PERFMON_COUNTER_n_CONFIG(n)	(0x31020 + 0x4 * (n))
+#define LLCC_COUNTER_n_VALUE(n)			(0x31060 + 0x4 * (n))
+
+#define PERFMON_MODE_MONITOR_EN			BIT(15)
+#define PERFMON_DUMP_MONITOR			BIT(0)
+#define PERFMON_CFG_PORT_SEL			GENMASK(3, 0)
+#define PERFMON_CFG_EVENT_SEL			GENMASK(20, 16)
+#define PERFMON_CFG_COUNT_CLEAR			BIT(28)
+
+/* TRP port registers (LLCC v1) */
+#define LLCC_TRP_PROF_FILTER_0_CFG1		0x24004
+#define LLCC_TRP_PROF_EVENT_n_CFG(n)		(0x24020 + 0x4 * (n))
+
+#define TRP_FILTER_SCID_MATCH			GENMASK(4, 0)
+#define TRP_FILTER_SCID_MASK			GENMASK(12, 8)
+#define TRP_EVENT_SEL				GENMASK(5, 0)
+#define TRP_EVENT_FILTER_EN			BIT(16)
+
+#define LLCC_PMU_PORT_TRP			5
+#define LLCC_PMU_NUM_COUNTERS			16
+
+/* Fold the 32-bit counters well before they can wrap at the bus clock */
+#define LLCC_PMU_POLL_NS			(1 * NSEC_PER_SEC)
+
+/* TRP events */
+#define LLCC_PMU_EV_LOOKUP			0x00
+#define LLCC_PMU_EV_READ_HIT			0x06
+#define LLCC_PMU_EV_READ_MISS			0x07
+#define LLCC_PMU_EV_WRITE_HIT			0x08
+#define LLCC_PMU_EV_WRITE_MISS			0x09
+#define LLCC_PMU_EV_WRITEBACK			0x0d
+
+/*
+ * attr.config:  event   [5:0]
+ * attr.config1: scid    [4:0]
+ *               filter  [8]     count only accesses of slice @scid
+ */
+#define LLCC_PMU_EVENT(ev)		FIELD_GET(GENMASK_ULL(5, 0), (ev)->attr.config)
+#define LLCC_PMU_SCID(ev)		FIELD_GET(GENMASK_ULL(4, 0), (ev)->attr.config1)
+#define LLCC_PMU_FILTER(ev)		FIELD_GET(BIT_ULL(8), (ev)->attr.config1)
+
+/**
+ * struct llcc_pmu - the LLCC perfmon
+ *
+ * @pmu:          perf PMU.
+ * @dev:          Our device.
+ * @llcc:         The LLCC whose banks we sample.
+ * @events:       Event attached to each counter.
+ * @prev:         Last value read from each counter in each bank, indexed by
+ *                counter * num_banks + bank.
+ * @used_mask:    Counters in use.
+ * @filter_scid:  Slice the TRP filter is programmed for.
+ * @filter_users: Number of events using the TRP filter.
+ * @timer:        Folds counters into events before they wrap.
+ * @cpu:          CPU all events are counted on.
+ * @node:         CPU hotplug instance.
+ */
+struct llcc_pmu {
+	struct pmu pmu;
+	struct device *dev;
+	struct llcc_drv_data *llcc;
+	struct perf_event *events[LLCC_PMU_NUM_COUNTERS];
+	u32 *prev;
+	DECLARE_BITMAP(used_mask, LLCC_PMU_NUM_COUNTERS);
+	u32 filter_scid;
+	unsigned int filter_users;
+	struct hrtimer timer;
+	unsigned int cpu;
+	struct hlist_node node;
+};
+
+#define to_llcc_pmu(p) container_of(p, struct llcc_pmu, pmu)
+
+static enum cpuhp_state llcc_pmu_cpuhp_state;
+
+static void llcc_pmu_dump(struct llcc_pmu *llcc_pmu)
+{
+	/* Latch the live counts of all banks into the value registers */
+	regmap_write(llcc_pmu->llcc->bcast_regmap, LLCC_PERFMON_DUMP,
+		     PERFMON_DUMP_MONITOR);
+}
+
+static void llcc_pmu_event_update(struct perf_event *event)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+	struct llcc_drv_data *llcc = llcc_pmu->llcc;
+	int idx = event->hw.idx;
+	u32 *prev = &llcc_pmu->prev[idx * llcc->num_banks];
+	u64 delta = 0;
+	u32 val;
+	int i;
+
+	for (i = 0; i < llcc->num_banks; i++) {
+		if (regmap_read(llcc->regmaps[i], LLCC_COUNTER_n_VALUE(idx), &val))
+			continue;
+
+		delta += (u32)(val - prev[i]);
+		prev[i] = val;
+	}
+
+	local64_add(delta, &event->count);
+}
+
+static void llcc_pmu_reset_prev(struct llcc_pmu *llcc_pmu, int idx)
+{
+	struct llcc_drv_data *llcc = llcc_pmu->llcc;
+
+	memset(&llcc_pmu->prev[idx * llcc->num_banks], 0,
+	       llcc->num_banks * sizeof(*llcc_pmu->prev));
+}
+
+static enum hrtimer_restart llcc_pmu_poll(struct hrtimer *timer)
+{
+	struct llcc_pmu *llcc_pmu = container_of(timer, struct llcc_pmu, timer);
+	int idx;
+
+	llcc_pmu_dump(llcc_pmu);
+	for_each_set_bit(idx, llcc_pmu->used_mask, LLCC_PMU_NUM_COUNTERS) {
+		if (!(llcc_pmu->events[idx]->hw.state & PERF_HES_STOPPED))
+			llcc_pmu_event_update(llcc_pmu->events[idx]);
+	}
+
+	hrtimer_forward_now(timer, ns_to_ktime(LLCC_PMU_POLL_NS));
+
+	return HRTIMER_RESTART;
+}
+
+static bool llcc_pmu_filter_compatible(struct perf_event *a,
+				       struct perf_event *b)
+{
+	return !LLCC_PMU_FILTER(a) || !LLCC_PMU_FILTER(b) ||
+	       LLCC_PMU_SCID(a) == LLCC_PMU_SCID(b);
+}
+
+static bool llcc_pmu_validate_group(struct perf_event *event)
+{
+	struct perf_event *sibling, *leader = event->group_leader;
+	int counters = 1;
+
+	if (leader == event)
+		return true;
+
+	if (leader->pmu != event->pmu && !is_software_event(leader))
+		return false;
+
+	if (leader->pmu == event->pmu) {
+		if (!llcc_pmu_filter_compatible(leader, event))
+			return false;
+		counters++;
+	}
+
+	for_each_sibling_event(sibling, leader) {
+		if (sibling->pmu != event->pmu)
+			continue;
+		/* There is only one slice filter */
+		if (!llcc_pmu_filter_compatible(sibling, event))
+			return false;
+		counters++;
+	}
+
+	return counters <= LLCC_PMU_NUM_COUNTERS;
+}
+
+static int llcc_pmu_event_init(struct perf_event *event)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+
+	if (event->attr.type != event->pmu->type)
+		return -ENOENT;
+
+	/* The counters are shared by the whole SoC */
+	if (is_sampling_event(event) || event->attach_state & PERF_ATTACH_TASK)
+		return -EOPNOTSUPP;
+
+	if (event->cpu < 0)
+		return -EINVAL;
+
+	if (LLCC_PMU_FILTER(event) &&
+	    LLCC_PMU_SCID(event) > llcc_pmu->llcc->max_slices)
+		return -EINVAL;
+
+	if (!llcc_pmu_validate_group(event))
+		return -EINVAL;
+
+	event->hw.idx = -1;
+	event->cpu = llcc_pmu->cpu;
+
+	return 0;
+}
+
+static void llcc_pmu_start(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+	struct regmap *bcast = llcc_pmu->llcc->bcast_regmap;
+	int idx = event->hw.idx;
+	u32 cfg;
+
+	event->hw.state = 0;
+
+	cfg = FIELD_PREP(TRP_EVENT_SEL, LLCC_PMU_EVENT(event));
+	if (LLCC_PMU_FILTER(event))
+		cfg |= TRP_EVENT_FILTER_EN;
+	regmap_write(bcast, LLCC_TRP_PROF_EVENT_n_CFG(idx), cfg);
+
+	cfg = FIELD_PREP(PERFMON_CFG_PORT_SEL, LLCC_PMU_PORT_TRP) |
+	      FIELD_PREP(PERFMON_CFG_EVENT_SEL, idx);
+	regmap_write(bcast, LLCC_PERFMON_COUNTER_n_CONFIG(idx),
+		     cfg | PERFMON_CFG_COUNT_CLEAR);
+	regmap_write(bcast, LLCC_PERFMON_COUNTER_n_CONFIG(idx), cfg);
+
+	llcc_pmu_reset_prev(llcc_pmu, idx);
+}
+
+static void llcc_pmu_stop(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+	int idx = event->hw.idx;
+
+	if (event->hw.state & PERF_HES_STOPPED)
+		return;
+
+	llcc_pmu_dump(llcc_pmu);
+	llcc_pmu_event_update(event);
+
+	regmap_write(llcc_pmu->llcc->bcast_regmap,
+		     LLCC_TRP_PROF_EVENT_n_CFG(idx), 0);
+	event->hw.state |= PERF_HES_STOPPED | PERF_HES_UPTODATE;
+}
+
+static int llcc_pmu_add(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+	struct regmap *bcast = llcc_pmu->llcc->bcast_regmap;
+	u32 scid = LLCC_PMU_SCID(event);
+	int idx;
+
+	if (LLCC_PMU_FILTER(event)) {
+		if (llcc_pmu->filter_users && llcc_pmu->filter_scid != scid)
+			return -EAGAIN;
+
+		if (!llcc_pmu->filter_users++) {
+			llcc_pmu->filter_scid = scid;
+			regmap_write(bcast, LLCC_TRP_PROF_FILTER_0_CFG1,
+				     FIELD_PREP(TRP_FILTER_SCID_MATCH, scid) |
+				     FIELD_PREP(TRP_FILTER_SCID_MASK,
+						FIELD_MAX(TRP_FILTER_SCID_MASK)));
+		}
+	}
+
+	idx = find_first_zero_bit(llcc_pmu->used_mask, LLCC_PMU_NUM_COUNTERS);
+	if (idx == LLCC_PMU_NUM_COUNTERS) {
+		if (LLCC_PMU_FILTER(event))
+			llcc_pmu->filter_users--;
+		return -EAGAIN;
+	}
+
+	if (bitmap_empty(llcc_pmu->used_mask, LLCC_PMU_NUM_COUNTERS)) {
+		regmap_write(bcast, LLCC_PERFMON_MODE, PERFMON_MODE_MONITOR_EN);
+		hrtimer_start(&llcc_pmu->timer, ns_to_ktime(LLCC_PMU_POLL_NS),
+			      HRTIMER_MODE_REL_PINNED);
+	}
+
+	set_bit(idx, llcc_pmu->used_mask);
+	llcc_pmu->events[idx] = event;
+	event->hw.idx = idx;
+	event->hw.state = PERF_HES_STOPPED | PERF_HES_UPTODATE;
+
+	if (flags & PERF_EF_START)
+		llcc_pmu_start(event, flags);
+
+	perf_event_update_userpage(event);
+
+	return 0;
+}
+
+static void llcc_pmu_del(struct perf_event *event, int flags)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+	struct regmap *bcast = llcc_pmu->llcc->bcast_regmap;
+	int idx = event->hw.idx;
+
+	llcc_pmu_stop(event, PERF_EF_UPDATE);
+	regmap_write(bcast, LLCC_PERFMON_COUNTER_n_CONFIG(idx), 0);
+
+	if (LLCC_PMU_FILTER(event) && !--llcc_pmu->filter_users)
+		regmap_write(bcast, LLCC_TRP_PROF_FILTER_0_CFG1, 0);
+
+	llcc_pmu->events[idx] = NULL;
+	clear_bit(idx, llcc_pmu->used_mask);
+
+	if (bitmap_empty(llcc_pmu->used_mask, LLCC_PMU_NUM_COUNTERS)) {
+		hrtimer_cancel(&llcc_pmu->timer);
+		regmap_write(bcast, LLCC_PERFMON_MODE, 0);
+	}
+
+	perf_event_update_userpage(event);
+}
+
+static void llcc_pmu_read(struct perf_event *event)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(event->pmu);
+
+	llcc_pmu_dump(llcc_pmu);
+	llcc_pmu_event_update(event);
+}
+
+static ssize_t llcc_pmu_event_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct perf_pmu_events_attr *pmu_attr =
+		container_of(attr, struct perf_pmu_events_attr, attr);
+
+	return sysfs_emit(buf, "event=0x%02llx\n", pmu_attr->id);
+}
+
+#define LLCC_PMU_EVENT_ATTR(_name, _id) \
+	PMU_EVENT_ATTR_ID(_name, llcc_pmu_event_show, _id)
+
+static struct attribute *llcc_pmu_event_attrs[] = {
+	LLCC_PMU_EVENT_ATTR(lookup, LLCC_PMU_EV_LOOKUP),
+	LLCC_PMU_EVENT_ATTR(read_hit, LLCC_PMU_EV_READ_HIT),
+	LLCC_PMU_EVENT_ATTR(read_miss, LLCC_PMU_EV_READ_MISS),
+	LLCC_PMU_EVENT_ATTR(write_hit, LLCC_PMU_EV_WRITE_HIT),
+	LLCC_PMU_EVENT_ATTR(write_miss, LLCC_PMU_EV_WRITE_MISS),
+	LLCC_PMU_EVENT_ATTR(writeback, LLCC_PMU_EV_WRITEBACK),
+	NULL
+};
+
+static const struct attribute_group llcc_pmu_events_group = {
+	.name = "events",
+	.attrs = llcc_pmu_event_attrs,
+};
+
+PMU_FORMAT_ATTR(event, "config:0-5");
+PMU_FORMAT_ATTR(scid, "config1:0-4");
+PMU_FORMAT_ATTR(filter, "config1:8");
+
+static struct attribute *llcc_pmu_format_attrs[] = {
+	&format_attr_event.attr,
+	&format_attr_scid.attr,
+	&format_attr_filter.attr,
+	NULL
+};
+
+static const struct attribute_group llcc_pmu_format_group = {
+	.name = "format",
+	.attrs = llcc_pmu_format_attrs,
+};
+
+static ssize_t cpumask_show(struct device *dev,
+			    struct device_attribute *attr, char *buf)
+{
+	struct llcc_pmu *llcc_pmu = to_llcc_pmu(dev_get_drvdata(dev));
+
+	return cpumap_print_to_pagebuf(true, buf, cpumask_of(llcc_pmu->cpu));
+}
+static DEVICE_ATTR_RO(cpumask);
+
+static struct attribute *llcc_pmu_cpumask_attrs[] = {
+	&dev_attr_cpumask.attr,
+	NULL
+};
+
+static const struct attribute_group llcc_pmu_cpumask_group = {
+	.attrs = llcc_pmu_cpumask_attrs,
+};
+
+static const struct attribute_group *llcc_pmu_attr_groups[] = {
+	&llcc_pmu_events_group,
+	&llcc_pmu_format_group,
+	&llcc_pmu_cpumask_group,
+	NULL
+};
+
+static int llcc_pmu_offline_cpu(unsigned int cpu, struct hlist_node *node)
+{
+	struct llcc_pmu *llcc_pmu = hlist_entry_safe(node, struct llcc_pmu, node);
+	unsigned int target;
+
+	if (cpu != llcc_pmu->cpu)
+		return 0;
+
+	target = cpumask_any_but(cpu_online_mask, cpu);
+	if (target >= nr_cpu_ids)
+		return 0;
+
+	perf_pmu_migrate_context(&llcc_pmu->pmu, cpu, target);
+	llcc_pmu->cpu = target;
+
+	return 0;
+}
+
+static int llcc_pmu_probe(struct platform_device *pdev)
+{
+	struct llcc_drv_data *llcc = dev_get_platdata(&pdev->dev);
+	struct device *dev = &pdev->dev;
+	struct llcc_pmu *llcc_pmu;
+	int ret;
+
+	llcc_pmu = devm_kzalloc(dev, sizeof(*llcc_pmu), GFP_KERNEL);
+	if (!llcc_pmu)
+		return -ENOMEM;
+
+	llcc_pmu->prev = devm_kcalloc(dev, LLCC_PMU_NUM_COUNTERS * llcc->num_banks,
+				      sizeof(*llcc_pmu->prev), GFP_KERNEL);
+	if (!llcc_pmu->prev)
+		return -ENOMEM;
+
+	llcc_pmu->dev = dev;
+	llcc_pmu->llcc = llcc;
+	llcc_pmu->cpu = raw_smp_processor_id();
+	hrtimer_init(&llcc_pmu->timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL_PINNED);
+	llcc_pmu->timer.function = llcc_pmu_poll;
+
+	llcc_pmu->pmu = (struct pmu) {
+		.module		= THIS_MODULE,
+		.parent		= dev,
+		.task_ctx_nr	= perf_invalid_context,
+		.event_init	= llcc_pmu_event_init,
+		.add		= llcc_pmu_add,
+		.del		= llcc_pmu_del,
+		.start		= llcc_pmu_start,
+		.stop		= llcc_pmu_stop,
+		.read		= llcc_pmu_read,
+		.attr_groups	= llcc_pmu_attr_groups,
+		.capabilities	= PERF_PMU_CAP_NO_EXCLUDE,
+	};
+
+	platform_set_drvdata(pdev, llcc_pmu);
+
+	ret = cpuhp_state_add_instance(llcc_pmu_cpuhp_state, &llcc_pmu->node);
+	if (ret)
+		return dev_err_probe(dev, ret, "failed to add hotplug instance\n");
+
+	ret = perf_pmu_register(&llcc_pmu->pmu, "qcom_llcc", -1);
+	if (ret) {
+		cpuhp_state_remove_instance_nocalls(llcc_pmu_cpuhp_state,
+						    &llcc_pmu->node);
+		return dev_err_probe(dev, ret, "failed to register PMU\n");
+	}
+
+	return 0;
+}
+
+static void llcc_pmu_remove(struct platform_device *pdev)
+{
+	struct llcc_pmu *llcc_pmu = platform_get_drvdata(pdev);
+
+	perf_pmu_unregister(&llcc_pmu->pmu);
+	cpuhp_state_remove_instance_nocalls(llcc_pmu_cpuhp_state,
+					    &llcc_pmu->node);
+}
+
+static struct platform_driver llcc_pmu_driver = {
+	.driver = {
+		.name = "qcom_llcc_pmu",
+	},
+	.probe = llcc_pmu_probe,
+	.remove_new = llcc_pmu_remove,
+};
+
+static int __init llcc_pmu_init(void)
+{
+	int ret;
+
+	ret = cpuhp_setup_state_multi(CPUHP_AP_ONLINE_DYN, "perf/qcom/llcc:online",
+				      NULL, llcc_pmu_offline_cpu);
+	if (ret < 0)
+		return ret;
+	llcc_pmu_cpuhp_state = ret;
+
+	ret = platform_driver_register(&llcc_pmu_driver);
+	if (ret)
+		cpuhp_remove_multi_state(llcc_pmu_cpuhp_state);
+
+	return ret;
+}
+module_init(llcc_pmu_init);
+
+static void __exit llcc_pmu_exit(void)
+{
+	platform_driver_unregister(&llcc_pmu_driver);
+	cpuhp_remove_multi_state(llcc_pmu_cpuhp_state);
+}
+module_exit(llcc_pmu_exit);
+
+MODULE_DESCRIPTION("Qualcomm LLCC PMU driver");
+MODULE_LICENSE("GPL");
@@ -11,6 +11,7 @@
 #include <linux/device.h>
 #include <linux/io.h>
 #include <linux/kernel.h>
+#include <linux/kobject.h>
 #include <linux/module.h>
 #include <linux/mutex.h>
 #include <linux/nvmem-consumer.h>
@@ -19,6 +20,7 @@
 #include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/soc/qcom/llcc-qcom.h>
+#include <linux/sysfs.h>
 
 #define ACTIVATE                      BIT(0)
 #define DEACTIVATE                    BIT(1)
@@ -132,11 +134,24 @@ struct llcc_slice_config {
 	bool vict_prio;
 };
 
+/**
+ * struct qcom_llcc_config - Data associated with a LLCC configuration
+ * @sct_data: The system cache table of the SoC
+ * @reg_offset: Offsets of the common registers
+ * @edac_reg_offset: Offsets of the EDAC registers
+ * @size: Number of entries in @sct_data
+ * @cache_size: Total size of the LLCC in KB; bounds the max_cap a slice can
+ *              be given at runtime. If zero the largest max_cap found in
+ *              @sct_data is used instead.
+ * @need_llcc_cfg: Program the capacity allocation and retention bits
+ * @no_edac: Don't register the EDAC device
+ */
 struct qcom_llcc_config {
 	const struct llcc_slice_config *sct_data;
 	const u32 *reg_offset;
 	const struct llcc_edac_reg_offset *edac_reg_offset;
 	int size;
+	u32 cache_size;
 	bool need_llcc_cfg;
 	bool no_edac;
 };
@@ -266,6 +281,7 @@ static const struct llcc_slice_config sm6350_data[] =  {
 
 static const struct llcc_slice_config sm7150_data[] =  {
 	{ LLCC_CPUSS,    1,  512, 1, 0, 0xF, 0x0, 0, 0, 0, 1, 1 },
+	{ LLCC_VIDSC0,   2,  256, 2, 1, 0xF, 0x0, 0, 0, 0, 1, 0 },
 	{ LLCC_MDM,      8,  128, 2, 0, 0xF, 0x0, 0, 0, 0, 1, 0 },
 	{ LLCC_GPUHTW,   11, 256, 1, 1, 0xF, 0x0, 0, 0, 0, 1, 0 },
 	{ LLCC_GPU,      12, 256, 1, 1, 0xF, 0x0, 0, 0, 0, 1, 0 },
@@ -647,6 +663,7 @@ static const struct qcom_llcc_config sm7150_cfg[] = {
 	{
 		.sct_data       = sm7150_data,
 		.size           = ARRAY_SIZE(sm7150_data),
+		.cache_size	= SZ_1K,
 		.need_llcc_cfg	= true,
 		.reg_offset	= llcc_v1_reg_offset,
 		.edac_reg_offset = &llcc_v1_edac_reg_offset,
@@ -906,6 +923,48 @@ static int llcc_update_act_ctrl(u32 sid,
 	return ret;
 }
 
+static int __llcc_slice_activate(u32 sid)
+{
+	u32 act_ctrl_val;
+	int ret;
+
+	lockdep_assert_held(&drv_data->lock);
+
+	if (test_bit(sid, drv_data->bitmap))
+		return 0;
+
+	act_ctrl_val = ACT_CTRL_OPCODE_ACTIVATE << ACT_CTRL_OPCODE_SHIFT;
+
+	ret = llcc_update_act_ctrl(sid, act_ctrl_val, DEACTIVATE);
+	if (ret)
+		return ret;
+
+	__set_bit(sid, drv_data->bitmap);
+
+	return 0;
+}
+
+static int __llcc_slice_deactivate(u32 sid)
+{
+	u32 act_ctrl_val;
+	int ret;
+
+	lockdep_assert_held(&drv_data->lock);
+
+	if (!test_bit(sid, drv_data->bitmap))
+		return 0;
+
+	act_ctrl_val = ACT_CTRL_OPCODE_DEACTIVATE << ACT_CTRL_OPCODE_SHIFT;
+
+	ret = llcc_update_act_ctrl(sid, act_ctrl_val, ACTIVATE);
+	if (ret)
+		return ret;
+
+	__clear_bit(sid, drv_data->bitmap);
+
+	return 0;
+}
+
 /**
  * llcc_slice_activate - Activate the llcc slice
  * @desc: Pointer to llcc slice descriptor
@@ -916,7 +975,6 @@ static int llcc_update_act_ctrl(u32 sid,
 int llcc_slice_activate(struct llcc_slice_desc *desc)
 {
 	int ret;
-	u32 act_ctrl_val;
 
 	if (IS_ERR(drv_data))
 		return PTR_ERR(drv_data);
@@ -925,21 +983,7 @@ int llcc_slice_activate(struct llcc_slice_desc *desc)
 		return -EINVAL;
 
 	mutex_lock(&drv_data->lock);
-	if (test_bit(desc->slice_id, drv_data->bitmap)) {
-		mutex_unlock(&drv_data->lock);
-		return 0;
-	}
-
-	act_ctrl_val = ACT_CTRL_OPCODE_ACTIVATE << ACT_CTRL_OPCODE_SHIFT;
-
-	ret = llcc_update_act_ctrl(desc->slice_id, act_ctrl_val,
-				  DEACTIVATE);
-	if (ret) {
-		mutex_unlock(&drv_data->lock);
-		return ret;
-	}
-
-	__set_bit(desc->slice_id, drv_data->bitmap);
+	ret = __llcc_slice_activate(desc->slice_id);
 	mutex_unlock(&drv_data->lock);
 
 	return ret;
@@ -955,7 +999,6 @@ EXPORT_SYMBOL_GPL(llcc_slice_activate);
  */
 int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 {
-	u32 act_ctrl_val;
 	int ret;
 
 	if (IS_ERR(drv_data))
@@ -965,20 +1008,7 @@ int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 		return -EINVAL;
 
 	mutex_lock(&drv_data->lock);
-	if (!test_bit(desc->slice_id, drv_data->bitmap)) {
-		mutex_unlock(&drv_data->lock);
-		return 0;
-	}
-	act_ctrl_val = ACT_CTRL_OPCODE_DEACTIVATE << ACT_CTRL_OPCODE_SHIFT;
-
-	ret = llcc_update_act_ctrl(desc->slice_id, act_ctrl_val,
-				  ACTIVATE);
-	if (ret) {
-		mutex_unlock(&drv_data->lock);
-		return ret;
-	}
-
-	__clear_bit(desc->slice_id, drv_data->bitmap);
+	ret = __llcc_slice_deactivate(desc->slice_id);
 	mutex_unlock(&drv_data->lock);
 
 	return ret;
@@ -998,21 +1028,81 @@ int llcc_get_slice_id(struct llcc_slice_desc *desc)
 }
 EXPORT_SYMBOL_GPL(llcc_get_slice_id);
 
+static struct llcc_slice_config *llcc_find_slice(u32 sid)
+{
+	u32 i;
+
+	for (i = 0; i < drv_data->cfg_size; i++)
+		if (drv_data->cfg[i].slice_id == sid)
+			return &drv_data->cfg[i];
+
+	return NULL;
+}
+
 /**
- * llcc_get_slice_size - return the slice id
+ * llcc_get_slice_size - return the slice size
  * @desc: Pointer to llcc slice descriptor
+ *
+ * Returns the current max capacity of the slice in KB, which may differ from
+ * the size at the time @desc was obtained if the slice was reconfigured.
  */
 size_t llcc_get_slice_size(struct llcc_slice_desc *desc)
 {
+	const struct llcc_slice_config *config;
+	size_t size;
+
 	if (IS_ERR_OR_NULL(desc))
 		return 0;
 
-	return desc->slice_size;
+	if (IS_ERR(drv_data))
+		return desc->slice_size;
+
+	mutex_lock(&drv_data->lock);
+	config = llcc_find_slice(desc->slice_id);
+	size = config ? config->max_cap : desc->slice_size;
+	mutex_unlock(&drv_data->lock);
+
+	return size;
 }
 EXPORT_SYMBOL_GPL(llcc_get_slice_size);
 
-static int _qcom_llcc_cfg_program(const struct llcc_slice_config *config,
-				  const struct qcom_llcc_config *cfg)
+/**
+ * llcc_get_slice_ways - return the slice ways masks
+ * @desc: Pointer to llcc slice descriptor
+ * @bonus_ways: Returns the current bonus ways mask
+ * @res_ways: Returns the current reserved ways mask
+ *
+ * Lets a client that only wants to change the size of its slice with
+ * llcc_slice_reconfigure() keep the ways it was configured with.
+ *
+ * A value of zero will be returned on success and a negative errno will
+ * be returned in error cases
+ */
+int llcc_get_slice_ways(struct llcc_slice_desc *desc, u32 *bonus_ways,
+			u32 *res_ways)
+{
+	const struct llcc_slice_config *config;
+
+	if (IS_ERR(drv_data))
+		return PTR_ERR(drv_data);
+
+	if (IS_ERR_OR_NULL(desc))
+		return -EINVAL;
+
+	guard(mutex)(&drv_data->lock);
+
+	config = llcc_find_slice(desc->slice_id);
+	if (!config)
+		return -ENODEV;
+
+	*bonus_ways = config->bonus_ways;
+	*res_ways = config->res_ways;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(llcc_get_slice_ways);
+
+static int llcc_slice_program_size(const struct llcc_slice_config *config)
 {
 	int ret;
 	u32 attr2_cfg;
@@ -1022,7 +1112,6 @@ static int _qcom_llcc_cfg_program(const struct llcc_slice_config *config,
 	u32 attr1_val;
 	u32 attr0_val;
 	u32 max_cap_cacheline;
-	struct llcc_slice_desc desc;
 
 	attr1_val = config->cache_mode;
 	attr1_val |= config->probe_target_ways << ATTR1_PROBE_TARGET_WAYS_SHIFT;
@@ -1063,12 +1152,109 @@ static int _qcom_llcc_cfg_program(const struct llcc_slice_config *config,
 	if (ret)
 		return ret;
 
-	if (drv_data->version >= LLCC_VERSION_4_1_0_0) {
+	if (drv_data->version >= LLCC_VERSION_4_1_0_0)
 		ret = regmap_write(drv_data->bcast_regmap, attr2_cfg, attr2_val);
+
+	return ret;
+}
+
+static int llcc_slice_update(u32 sid, u32 max_cap, u32 bonus_ways,
+			     u32 res_ways)
+{
+	struct llcc_slice_config *config, old;
+	bool active;
+	u32 i;
+	int ret;
+
+	if (!max_cap || max_cap > drv_data->cache_size)
+		return -EINVAL;
+
+	if (!(bonus_ways | res_ways) ||
+	    (bonus_ways | res_ways) & ~drv_data->ways_mask)
+		return -EINVAL;
+
+	guard(mutex)(&drv_data->lock);
+
+	config = llcc_find_slice(sid);
+	if (!config)
+		return -ENODEV;
+
+	for (i = 0; i < drv_data->cfg_size; i++) {
+		if (&drv_data->cfg[i] != config &&
+		    drv_data->cfg[i].res_ways & res_ways)
+			return -EBUSY;
+	}
+
+	if (config->max_cap == max_cap && config->bonus_ways == bonus_ways &&
+	    config->res_ways == res_ways)
+		return 0;
+
+	active = test_bit(sid, drv_data->bitmap);
+	if (active) {
+		ret = __llcc_slice_deactivate(sid);
 		if (ret)
 			return ret;
 	}
 
+	old = *config;
+	config->max_cap = max_cap;
+	config->bonus_ways = bonus_ways;
+	config->res_ways = res_ways;
+
+	ret = llcc_slice_program_size(config);
+	if (ret) {
+		*config = old;
+		llcc_slice_program_size(config);
+	}
+
+	if (active) {
+		int err = __llcc_slice_activate(sid);
+
+		if (!ret)
+			ret = err;
+	}
+
+	return ret;
+}
+
+/**
+ * llcc_slice_reconfigure - Change the size and ways of a llcc slice
+ * @desc: Pointer to llcc slice descriptor
+ * @max_cap: New maximum capacity of the slice in KB
+ * @bonus_ways: New bonus ways mask
+ * @res_ways: New reserved ways mask
+ *
+ * The new configuration has to fit in the cache, only use ways that the
+ * system cache table hands out and not reserve ways that are reserved by
+ * another slice. An active slice is deactivated while it is reprogrammed and
+ * activated again afterwards.
+ *
+ * A value of zero will be returned on success and a negative errno will
+ * be returned in error cases
+ */
+int llcc_slice_reconfigure(struct llcc_slice_desc *desc, u32 max_cap,
+			   u32 bonus_ways, u32 res_ways)
+{
+	if (IS_ERR(drv_data))
+		return PTR_ERR(drv_data);
+
+	if (IS_ERR_OR_NULL(desc))
+		return -EINVAL;
+
+	return llcc_slice_update(desc->slice_id, max_cap, bonus_ways, res_ways);
+}
+EXPORT_SYMBOL_GPL(llcc_slice_reconfigure);
+
+static int _qcom_llcc_cfg_program(const struct llcc_slice_config *config,
+				  const struct qcom_llcc_config *cfg)
+{
+	struct llcc_slice_desc desc;
+	int ret;
+
+	ret = llcc_slice_program_size(config);
+	if (ret)
+		return ret;
+
 	if (cfg->need_llcc_cfg) {
 		u32 disable_cap_alloc, retain_pc;
 
@@ -1212,8 +1398,194 @@ static int qcom_llcc_get_cfg_index(struct platform_device *pdev, u8 *cfg_index,
 	return ret;
 }
 
+/**
+ * struct llcc_slice_kobj - sysfs representation of a llcc slice
+ * @kobj: The slice<id> directory below the llcc device
+ * @slice_id: The slice shown in this directory
+ */
+struct llcc_slice_kobj {
+	struct kobject kobj;
+	u32 slice_id;
+};
+
+static struct llcc_slice_kobj **llcc_slice_kobjs;
+
+#define to_llcc_slice_kobj(k) container_of(k, struct llcc_slice_kobj, kobj)
+
+enum llcc_slice_attr {
+	LLCC_SLICE_MAX_CAP,
+	LLCC_SLICE_BONUS_WAYS,
+	LLCC_SLICE_RES_WAYS,
+};
+
+static ssize_t llcc_slice_attr_show(struct kobject *kobj, char *buf,
+				    enum llcc_slice_attr attr)
+{
+	u32 sid = to_llcc_slice_kobj(kobj)->slice_id;
+	const struct llcc_slice_config *config;
+
+	guard(mutex)(&drv_data->lock);
+
+	config = llcc_find_slice(sid);
+	if (!config)
+		return -ENODEV;
+
+	switch (attr) {
+	case LLCC_SLICE_MAX_CAP:
+		return sysfs_emit(buf, "%u\n", config->max_cap);
+	case LLCC_SLICE_BONUS_WAYS:
+		return sysfs_emit(buf, "%#x\n", config->bonus_ways);
+	case LLCC_SLICE_RES_WAYS:
+		return sysfs_emit(buf, "%#x\n", config->res_ways);
+	}
+
+	return -EINVAL;
+}
+
+static ssize_t llcc_slice_attr_store(struct kobject *kobj, const char *buf,
+				     size_t count, enum llcc_slice_attr attr)
+{
+	u32 sid = to_llcc_slice_kobj(kobj)->slice_id;
+	const struct llcc_slice_config *config;
+	u32 max_cap, bonus_ways, res_ways;
+	u32 val;
+	int ret;
+
+	ret = kstrtou32(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	mutex_lock(&drv_data->lock);
+	config = llcc_find_slice(sid);
+	if (!config) {
+		mutex_unlock(&drv_data->lock);
+		return -ENODEV;
+	}
+	max_cap = config->max_cap;
+	bonus_ways = config->bonus_ways;
+	res_ways = config->res_ways;
+	mutex_unlock(&drv_data->lock);
+
+	switch (attr) {
+	case LLCC_SLICE_MAX_CAP:
+		max_cap = val;
+		break;
+	case LLCC_SLICE_BONUS_WAYS:
+		bonus_ways = val;
+		break;
+	case LLCC_SLICE_RES_WAYS:
+		res_ways = val;
+		break;
+	}
+
+	ret = llcc_slice_update(sid, max_cap, bonus_ways, res_ways);
+
+	return ret ? ret : count;
+}
+
+#define LLCC_SLICE_ATTR_RW(_name, _attr)					\
+static ssize_t _name##_show(struct kobject *kobj,			\
+			    struct kobj_attribute *attr, char *buf)	\
+{									\
+	return llcc_slice_attr_show(kobj, buf, _attr);			\
+}									\
+static ssize_t _name##_store(struct kobject *kobj,			\
+			     struct kobj_attribute *attr,		\
+			     const char *buf, size_t count)		\
+{									\
+	return llcc_slice_attr_store(kobj, buf, count, _attr);		\
+}									\
+static struct kobj_attribute llcc_slice_##_name##_attr = __ATTR_RW(_name)
+
+LLCC_SLICE_ATTR_RW(max_cap, LLCC_SLICE_MAX_CAP);
+LLCC_SLICE_ATTR_RW(bonus_ways, LLCC_SLICE_BONUS_WAYS);
+LLCC_SLICE_ATTR_RW(res_ways, LLCC_SLICE_RES_WAYS);
+
+static ssize_t active_show(struct kobject *kobj, struct kobj_attribute *attr,
+			   char *buf)
+{
+	u32 sid = to_llcc_slice_kobj(kobj)->slice_id;
+
+	guard(mutex)(&drv_data->lock);
+
+	return sysfs_emit(buf, "%d\n", test_bit(sid, drv_data->bitmap));
+}
+static struct kobj_attribute llcc_slice_active_attr = __ATTR_RO(active);
+
+static struct attribute *llcc_slice_attrs[] = {
+	&llcc_slice_max_cap_attr.attr,
+	&llcc_slice_bonus_ways_attr.attr,
+	&llcc_slice_res_ways_attr.attr,
+	&llcc_slice_active_attr.attr,
+	NULL
+};
+ATTRIBUTE_GROUPS(llcc_slice);
+
+static void llcc_slice_kobj_release(struct kobject *kobj)
+{
+	kfree(to_llcc_slice_kobj(kobj));
+}
+
+static const struct kobj_type llcc_slice_ktype = {
+	.release = llcc_slice_kobj_release,
+	.sysfs_ops = &kobj_sysfs_ops,
+	.default_groups = llcc_slice_groups,
+};
+
+static void qcom_llcc_sysfs_remove(void)
+{
+	u32 i;
+
+	if (!llcc_slice_kobjs)
+		return;
+
+	for (i = 0; i < drv_data->cfg_size; i++)
+		if (llcc_slice_kobjs[i])
+			kobject_put(&llcc_slice_kobjs[i]->kobj);
+
+	kfree(llcc_slice_kobjs);
+	llcc_slice_kobjs = NULL;
+}
+
+static int qcom_llcc_sysfs_init(struct device *dev)
+{
+	struct llcc_slice_kobj *sk;
+	u32 i;
+	int ret;
+
+	llcc_slice_kobjs = kcalloc(drv_data->cfg_size, sizeof(*llcc_slice_kobjs),
+				   GFP_KERNEL);
+	if (!llcc_slice_kobjs)
+		return -ENOMEM;
+
+	for (i = 0; i < drv_data->cfg_size; i++) {
+		sk = kzalloc(sizeof(*sk), GFP_KERNEL);
+		if (!sk) {
+			ret = -ENOMEM;
+			goto err;
+		}
+
+		sk->slice_id = drv_data->cfg[i].slice_id;
+		ret = kobject_init_and_add(&sk->kobj, &llcc_slice_ktype,
+					   &dev->kobj, "slice%u", sk->slice_id);
+		if (ret) {
+			kobject_put(&sk->kobj);
+			goto err;
+		}
+
+		llcc_slice_kobjs[i] = sk;
+	}
+
+	return 0;
+err:
+	qcom_llcc_sysfs_remove();
+	return ret;
+}
+
 static void qcom_llcc_remove(struct platform_device *pdev)
 {
+	qcom_llcc_sysfs_remove();
+
 	/* Set the global pointer to a error code to avoid referencing it */
 	drv_data = ERR_PTR(-ENODEV);
 }
@@ -1243,6 +1615,7 @@ static int qcom_llcc_probe(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 	int ret, i;
 	struct platform_device *llcc_edac;
+	struct platform_device *llcc_pmu;
 	const struct qcom_sct_config *cfgs;
 	const struct qcom_llcc_config *cfg;
 	const struct llcc_slice_config *llcc_cfg;
@@ -1333,9 +1706,15 @@ static int qcom_llcc_probe(struct platform_device *pdev)
 	llcc_cfg = cfg->sct_data;
 	sz = cfg->size;
 
-	for (i = 0; i < sz; i++)
+	for (i = 0; i < sz; i++) {
 		if (llcc_cfg[i].slice_id > drv_data->max_slices)
 			drv_data->max_slices = llcc_cfg[i].slice_id;
+		drv_data->ways_mask |= llcc_cfg[i].bonus_ways | llcc_cfg[i].res_ways;
+		drv_data->cache_size = max(drv_data->cache_size, llcc_cfg[i].max_cap);
+	}
+
+	if (cfg->cache_size)
+		drv_data->cache_size = cfg->cache_size;
 
 	drv_data->bitmap = devm_bitmap_zalloc(dev, drv_data->max_slices,
 					      GFP_KERNEL);
@@ -1344,7 +1723,14 @@ static int qcom_llcc_probe(struct platform_device *pdev)
 		goto err;
 	}
 
-	drv_data->cfg = llcc_cfg;
+	/* Keep a private copy so slices can be resized at runtime */
+	drv_data->cfg = devm_kmemdup(dev, llcc_cfg, sz * sizeof(*llcc_cfg),
+				     GFP_KERNEL);
+	if (!drv_data->cfg) {
+		ret = -ENOMEM;
+		goto err;
+	}
+
 	drv_data->cfg_size = sz;
 	drv_data->edac_reg_offset = cfg->edac_reg_offset;
 	mutex_init(&drv_data->lock);
@@ -1354,6 +1740,10 @@ static int qcom_llcc_probe(struct platform_device *pdev)
 	if (ret)
 		goto err;
 
+	ret = qcom_llcc_sysfs_init(dev);
+	if (ret)
+		goto err;
+
 	drv_data->ecc_irq = platform_get_irq_optional(pdev, 0);
 
 	/*
@@ -1370,6 +1760,16 @@ static int qcom_llcc_probe(struct platform_device *pdev)
 			dev_err(dev, "Failed to register llcc edac driver\n");
 	}
 
+	/* The perfmon register layout is only described for LLCC v1 */
+	if (IS_ENABLED(CONFIG_QCOM_LLCC_PMU) &&
+	    drv_data->version < LLCC_VERSION_2_0_0_0) {
+		llcc_pmu = platform_device_register_data(&pdev->dev,
+						"qcom_llcc_pmu", -1, drv_data,
+						sizeof(*drv_data));
+		if (IS_ERR(llcc_pmu))
+			dev_err(dev, "Failed to register llcc pmu driver\n");
+	}
+
 	return 0;
 err:
 	drv_data = ERR_PTR(-ENODEV);
@@ -1397,6 +1797,37 @@ static const struct of_device_id qcom_llcc_of_match[] = {
 };
 MODULE_DEVICE_TABLE(of, qcom_llcc_of_match);
 
+/**
+ * llcc_slice_getd_optional - get llcc slice descriptor, if there is one
+ * @uid: usecase_id for the client
+ *
+ * Like llcc_slice_getd(), but for clients that work without the slice.
+ * -EPROBE_DEFER is only returned while an LLCC that can still probe is
+ * described in the device tree.
+ *
+ * Return: the slice descriptor, NULL if the platform has no LLCC or no slice
+ * for @uid, or an error pointer.
+ */
+struct llcc_slice_desc *llcc_slice_getd_optional(u32 uid)
+{
+	struct llcc_slice_desc *desc = llcc_slice_getd(uid);
+	struct device_node *np;
+	bool provider;
+
+	if (!IS_ERR(desc) || PTR_ERR(desc) == -ENOMEM)
+		return desc;
+
+	if (PTR_ERR(desc) != -EPROBE_DEFER)
+		return NULL;
+
+	np = of_find_matching_node(NULL, qcom_llcc_of_match);
+	provider = np && of_device_is_available(np);
+	of_node_put(np);
+
+	return provider ? desc : NULL;
+}
+EXPORT_SYMBOL_GPL(llcc_slice_getd_optional);
+
 static struct platform_driver qcom_llcc_driver = {
 	.driver = {
 		.name = "qcom-llcc",
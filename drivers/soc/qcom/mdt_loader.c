@@ -7,17 +7,42 @@
  * Copyright (c) 2012-2013, The Linux Foundation. All rights reserved.
  */
 
+#include <linux/async.h>
 #include <linux/cleanup.h>
 #include <linux/device.h>
 #include <linux/elf.h>
 #include <linux/firmware.h>
 #include <linux/kernel.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
 #include <linux/firmware/qcom/qcom_scm.h>
 #include <linux/sizes.h>
 #include <linux/slab.h>
 #include <linux/soc/qcom/mdt_loader.h>
 
+static bool overlap_pas_init;
+module_param(overlap_pas_init, bool, 0644);
+MODULE_PARM_DESC(overlap_pas_init,
+		 "Load split segments while the PAS metadata is being authenticated");
+
+/**
+ * struct mdt_segment_load - split segment being loaded asynchronously
+ * @ptr:	destination of the segment in the memory region
+ * @phdrs:	program headers of the image
+ * @segment:	index of the segment
+ * @fw_name:	name of the firmware, for construction of the segment file name
+ * @dev:	device handle to associate resources with
+ * @ret:	result of the load
+ */
+struct mdt_segment_load {
+	void *ptr;
+	const struct elf32_phdr *phdrs;
+	unsigned int segment;
+	const char *fw_name;
+	struct device *dev;
+	ssize_t ret;
+};
+
 static bool mdt_phdr_valid(const struct elf32_phdr *phdr)
 {
 	if (phdr->p_type != PT_LOAD)
@@ -67,6 +92,19 @@ static ssize_t mdt_load_split_segment(void *ptr, const struct elf32_phdr *phdrs,
 	return ret;
 }
 
+static void mdt_load_split_segment_async(void *data, async_cookie_t cookie)
+{
+	struct mdt_segment_load *load = data;
+	const struct elf32_phdr *phdr = &load->phdrs[load->segment];
+
+	load->ret = mdt_load_split_segment(load->ptr, load->phdrs, load->segment,
+					   load->fw_name, load->dev);
+
+	if (!load->ret && phdr->p_memsz > phdr->p_filesz)
+		memset(load->ptr + phdr->p_filesz, 0,
+		       phdr->p_memsz - phdr->p_filesz);
+}
+
 /**
  * qcom_mdt_get_size() - acquire size of the memory region needed to load mdt
  * @fw:		firmware object for the mdt file
@@ -295,6 +333,7 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 			   phys_addr_t mem_phys, size_t mem_size,
 			   phys_addr_t *reloc_base, bool pas_init)
 {
+	ASYNC_DOMAIN_EXCLUSIVE(segment_domain);
 	const struct elf32_phdr *phdrs;
 	const struct elf32_phdr *phdr;
 	const struct elf32_hdr *ehdr;
@@ -302,6 +341,7 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 	phys_addr_t min_addr = PHYS_ADDR_MAX;
 	ssize_t offset;
 	bool relocate = false;
+	bool overlap;
 	bool is_split;
 	void *ptr;
 	int ret = 0;
@@ -310,10 +350,28 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 	if (!fw || !mem_region || !mem_phys || !mem_size)
 		return -EINVAL;
 
+	overlap = pas_init && READ_ONCE(overlap_pas_init);
+	if (pas_init && !overlap) {
+		ret = qcom_mdt_pas_init(dev, fw, fw_name, pas_id, mem_phys, NULL);
+		if (ret)
+			return ret;
+	}
+
 	is_split = qcom_mdt_bins_are_split(fw, fw_name);
 	ehdr = (struct elf32_hdr *)fw->data;
 	phdrs = (struct elf32_phdr *)(ehdr + 1);
 
+	/*
+	 * Split segments are requested from the firmware loader concurrently,
+	 * each straight into its place in the memory region.
+	 */
+	struct mdt_segment_load *loads __free(kfree) = NULL;
+	if (is_split) {
+		loads = kcalloc(ehdr->e_phnum, sizeof(*loads), GFP_KERNEL);
+		if (!loads)
+			return -ENOMEM;
+	}
+
 	for (i = 0; i < ehdr->e_phnum; i++) {
 		phdr = &phdrs[i];
 
@@ -376,15 +434,29 @@ static int __qcom_mdt_load(struct device *dev, const struct firmware *fw,
 			memcpy(ptr, fw->data + phdr->p_offset, phdr->p_filesz);
 		} else if (phdr->p_filesz) {
 			/* Firmware not large enough, load split-out segments */
-			ret = mdt_load_split_segment(ptr, phdrs, i, fw_name, dev);
-			if (ret)
-				break;
+			loads[i].ptr = ptr;
+			loads[i].phdrs = phdrs;
+			loads[i].segment = i;
+			loads[i].fw_name = fw_name;
+			loads[i].dev = dev;
+			async_schedule_domain(mdt_load_split_segment_async,
+					      &loads[i], &segment_domain);
+			continue;
 		}
 
 		if (phdr->p_memsz > phdr->p_filesz)
 			memset(ptr + phdr->p_filesz, 0, phdr->p_memsz - phdr->p_filesz);
 	}
 
+	/* Let TZ authenticate the metadata while the segments stream in */
+	if (overlap && !ret)
+		ret = qcom_mdt_pas_init(dev, fw, fw_name, pas_id, mem_phys, NULL);
+
+	async_synchronize_full_domain(&segment_domain);
+
+	for (i = 0; loads && !ret && i < ehdr->e_phnum; i++)
+		ret = loads[i].ret;
+
 	if (reloc_base)
 		*reloc_base = mem_reloc;
 
@@ -409,12 +481,6 @@ int qcom_mdt_load(struct device *dev, const struct firmware *fw,
 		  phys_addr_t mem_phys, size_t mem_size,
 		  phys_addr_t *reloc_base)
 {
-	int ret;
-
-	ret = qcom_mdt_pas_init(dev, fw, firmware, pas_id, mem_phys, NULL);
-	if (ret)
-		return ret;
-
 	return __qcom_mdt_load(dev, fw, firmware, pas_id, mem_region, mem_phys,
 			       mem_size, reloc_base, true);
 }
@@ -354,95 +354,229 @@ static const struct qmi_msg_handler qmi_indication_handler[] = {
 	{}
 };
 
-static int pdr_get_domain_list(struct servreg_get_domain_list_req *req,
-			       struct servreg_get_domain_list_resp *resp,
-			       struct pdr_handle *pdr)
+/* Locator results outlive the handles, so restarted clients skip the lookup */
+#define PDR_LOCATOR_CACHE_SIZE	32
+
+struct pdr_locator_cache_entry {
+	char service_name[SERVREG_NAME_LENGTH + 1];
+	char service_path[SERVREG_NAME_LENGTH + 1];
+
+	unsigned int instance;
+	u8 service_data_valid;
+	u32 service_data;
+
+	struct list_head node;
+};
+
+static LIST_HEAD(pdr_locator_cache);
+static unsigned int pdr_locator_cache_count;
+/* control access to the locator result cache */
+static DEFINE_MUTEX(pdr_locator_cache_lock);
+
+static struct pdr_locator_cache_entry *
+pdr_locator_cache_find(const struct pdr_service *pds)
+{
+	struct pdr_locator_cache_entry *entry;
+
+	lockdep_assert_held(&pdr_locator_cache_lock);
+
+	list_for_each_entry(entry, &pdr_locator_cache, node) {
+		if (!strcmp(entry->service_name, pds->service_name) &&
+		    !strcmp(entry->service_path, pds->service_path))
+			return entry;
+	}
+
+	return NULL;
+}
+
+static bool pdr_locator_cache_lookup(struct pdr_service *pds)
 {
+	struct pdr_locator_cache_entry *entry;
+
+	guard(mutex)(&pdr_locator_cache_lock);
+
+	entry = pdr_locator_cache_find(pds);
+	if (!entry)
+		return false;
+
+	pds->instance = entry->instance;
+	pds->service_data_valid = entry->service_data_valid;
+	pds->service_data = entry->service_data;
+
+	/* Keep recently used entries at the head */
+	list_move(&entry->node, &pdr_locator_cache);
+
+	return true;
+}
+
+static void pdr_locator_cache_store(const struct pdr_service *pds)
+{
+	struct pdr_locator_cache_entry *entry;
+
+	guard(mutex)(&pdr_locator_cache_lock);
+
+	entry = pdr_locator_cache_find(pds);
+	if (!entry) {
+		if (pdr_locator_cache_count == PDR_LOCATOR_CACHE_SIZE) {
+			entry = list_last_entry(&pdr_locator_cache,
+						struct pdr_locator_cache_entry,
+						node);
+		} else {
+			entry = kzalloc(sizeof(*entry), GFP_KERNEL);
+			if (!entry)
+				return;
+
+			list_add(&entry->node, &pdr_locator_cache);
+			pdr_locator_cache_count++;
+		}
+
+		strscpy(entry->service_name, pds->service_name,
+			sizeof(entry->service_name));
+		strscpy(entry->service_path, pds->service_path,
+			sizeof(entry->service_path));
+	}
+
+	entry->instance = pds->instance;
+	entry->service_data_valid = pds->service_data_valid;
+	entry->service_data = pds->service_data;
+	list_move(&entry->node, &pdr_locator_cache);
+}
+
+/* State of one lookup, with the lookups of a handle issued side by side */
+struct pdr_locate_ctx {
+	struct pdr_service *pds;
+
+	struct servreg_get_domain_list_req req;
+	struct servreg_get_domain_list_resp resp;
 	struct qmi_txn txn;
+
+	int domains_read;
+	bool txn_pending;
+	int ret;
+};
+
+static int pdr_get_domain_list_send(struct pdr_handle *pdr,
+				    struct pdr_locate_ctx *ctx)
+{
 	int ret;
 
-	ret = qmi_txn_init(&pdr->locator_hdl, &txn,
-			   servreg_get_domain_list_resp_ei, resp);
+	ret = qmi_txn_init(&pdr->locator_hdl, &ctx->txn,
+			   servreg_get_domain_list_resp_ei, &ctx->resp);
 	if (ret < 0)
 		return ret;
 
+	ctx->req.domain_offset = ctx->domains_read;
+
 	mutex_lock(&pdr->lock);
 	ret = qmi_send_request(&pdr->locator_hdl,
 			       &pdr->locator_addr,
-			       &txn, SERVREG_GET_DOMAIN_LIST_REQ,
+			       &ctx->txn, SERVREG_GET_DOMAIN_LIST_REQ,
 			       SERVREG_GET_DOMAIN_LIST_REQ_MAX_LEN,
 			       servreg_get_domain_list_req_ei,
-			       req);
+			       &ctx->req);
 	mutex_unlock(&pdr->lock);
 	if (ret < 0) {
-		qmi_txn_cancel(&txn);
+		qmi_txn_cancel(&ctx->txn);
 		return ret;
 	}
 
-	ret = qmi_txn_wait(&txn, 5 * HZ);
+	ctx->txn_pending = true;
+
+	return 0;
+}
+
+/*
+ * Wait for the response to the outstanding request of @ctx and look for the
+ * service in it. Returns -EINPROGRESS if more of the domain list needs to be
+ * read.
+ */
+static int pdr_get_domain_list_recv(struct pdr_locate_ctx *ctx)
+{
+	struct servreg_get_domain_list_resp *resp = &ctx->resp;
+	struct pdr_service *pds = ctx->pds;
+	struct servreg_location_entry *entry;
+	int ret, i;
+
+	ctx->txn_pending = false;
+
+	ret = qmi_txn_wait(&ctx->txn, 5 * HZ);
 	if (ret < 0) {
 		pr_err("PDR: %s get domain list txn wait failed: %d\n",
-		       req->service_name, ret);
+		       ctx->req.service_name, ret);
 		return ret;
 	}
 
 	if (resp->resp.result != QMI_RESULT_SUCCESS_V01) {
 		pr_err("PDR: %s get domain list failed: 0x%x\n",
-		       req->service_name, resp->resp.error);
+		       ctx->req.service_name, resp->resp.error);
 		return -EREMOTEIO;
 	}
 
-	return 0;
-}
-
-static int pdr_locate_service(struct pdr_handle *pdr, struct pdr_service *pds)
-{
-	struct servreg_get_domain_list_req req;
-	struct servreg_location_entry *entry;
-	int domains_read = 0;
-	int ret, i;
+	for (i = 0; i < resp->domain_list_len; i++) {
+		entry = &resp->domain_list[i];
 
-	struct servreg_get_domain_list_resp *resp __free(kfree) = kzalloc(sizeof(*resp),
-									  GFP_KERNEL);
-	if (!resp)
-		return -ENOMEM;
+		if (strnlen(entry->name, sizeof(entry->name)) == sizeof(entry->name))
+			continue;
 
-	/* Prepare req message */
-	strscpy(req.service_name, pds->service_name, sizeof(req.service_name));
-	req.domain_offset_valid = true;
-	req.domain_offset = 0;
+		if (!strcmp(entry->name, pds->service_path)) {
+			pds->service_data_valid = entry->service_data_valid;
+			pds->service_data = entry->service_data;
+			pds->instance = entry->instance;
+			return 0;
+		}
+	}
 
-	do {
-		req.domain_offset = domains_read;
-		ret = pdr_get_domain_list(&req, resp, pdr);
-		if (ret < 0)
-			return ret;
+	/* Always read total_domains from the response msg */
+	if (resp->domain_list_len > resp->total_domains)
+		resp->domain_list_len = resp->total_domains;
 
-		for (i = 0; i < resp->domain_list_len; i++) {
-			entry = &resp->domain_list[i];
+	ctx->domains_read += resp->domain_list_len;
 
-			if (strnlen(entry->name, sizeof(entry->name)) == sizeof(entry->name))
-				continue;
+	/* The service is not yet found */
+	if (!resp->domain_list_len || ctx->domains_read >= resp->total_domains)
+		return -ENXIO;
 
-			if (!strcmp(entry->name, pds->service_path)) {
-				pds->service_data_valid = entry->service_data_valid;
-				pds->service_data = entry->service_data;
-				pds->instance = entry->instance;
-				return 0;
-			}
-		}
+	return -EINPROGRESS;
+}
 
-		/* Update ret to indicate that the service is not yet found */
-		ret = -ENXIO;
+/*
+ * Resolve the pending lookups in @ctxs. One request is kept outstanding for
+ * each lookup, so the locator round trips overlap instead of adding up.
+ */
+static void pdr_locate_services(struct pdr_handle *pdr,
+				struct pdr_locate_ctx *ctxs, int count)
+{
+	struct pdr_locate_ctx *ctx;
+	bool pending;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		ctx = &ctxs[i];
+		strscpy(ctx->req.service_name, ctx->pds->service_name,
+			sizeof(ctx->req.service_name));
+		ctx->req.domain_offset_valid = true;
+		ctx->ret = -EINPROGRESS;
+	}
 
-		/* Always read total_domains from the response msg */
-		if (resp->domain_list_len > resp->total_domains)
-			resp->domain_list_len = resp->total_domains;
+	do {
+		for (i = 0; i < count; i++) {
+			ctx = &ctxs[i];
+			if (ctx->ret == -EINPROGRESS)
+				ctx->ret = pdr_get_domain_list_send(pdr, ctx) ?:
+					   -EINPROGRESS;
+		}
 
-		domains_read += resp->domain_list_len;
-	} while (domains_read < resp->total_domains);
+		pending = false;
+		for (i = 0; i < count; i++) {
+			ctx = &ctxs[i];
+			if (!ctx->txn_pending)
+				continue;
 
-	return ret;
+			ctx->ret = pdr_get_domain_list_recv(ctx);
+			if (ctx->ret == -EINPROGRESS)
+				pending = true;
+		}
+	} while (pending);
 }
 
 static void pdr_notify_lookup_failure(struct pdr_handle *pdr,
@@ -463,42 +597,79 @@ static void pdr_notify_lookup_failure(struct pdr_handle *pdr,
 	kfree(pds);
 }
 
+static void pdr_locator_lookup_done(struct pdr_handle *pdr,
+				    struct pdr_service *pds, int ret)
+{
+	if (ret < 0) {
+		pdr_notify_lookup_failure(pdr, pds, ret);
+		return;
+	}
+
+	ret = qmi_add_lookup(&pdr->notifier_hdl, pds->service, 1,
+			     pds->instance);
+	if (ret < 0) {
+		pdr_notify_lookup_failure(pdr, pds, ret);
+		return;
+	}
+
+	pds->need_locator_lookup = false;
+}
+
 static void pdr_locator_work(struct work_struct *work)
 {
 	struct pdr_handle *pdr = container_of(work, struct pdr_handle,
 					      locator_work);
+	struct pdr_locate_ctx *ctxs;
 	struct pdr_service *pds, *tmp;
-	int ret = 0;
+	int count = 0;
+	int i;
+
+	mutex_lock(&pdr->list_lock);
+
+	/* Lookups resolved before, e.g. prior to a restart, need no locator */
+	list_for_each_entry_safe(pds, tmp, &pdr->lookups, node) {
+		if (!pds->need_locator_lookup)
+			continue;
+
+		if (pdr_locator_cache_lookup(pds))
+			pdr_locator_lookup_done(pdr, pds, 0);
+		else
+			count++;
+	}
+
+	if (!count)
+		goto unlock;
 
 	/* Bail out early if the SERVREG LOCATOR QMI service is not up */
 	mutex_lock(&pdr->lock);
 	if (!pdr->locator_init_complete) {
 		mutex_unlock(&pdr->lock);
 		pr_debug("PDR: SERVICE LOCATOR service not available\n");
-		return;
+		goto unlock;
 	}
 	mutex_unlock(&pdr->lock);
 
-	mutex_lock(&pdr->list_lock);
-	list_for_each_entry_safe(pds, tmp, &pdr->lookups, node) {
-		if (!pds->need_locator_lookup)
-			continue;
+	ctxs = kvcalloc(count, sizeof(*ctxs), GFP_KERNEL);
+	if (!ctxs)
+		goto unlock;
 
-		ret = pdr_locate_service(pdr, pds);
-		if (ret < 0) {
-			pdr_notify_lookup_failure(pdr, pds, ret);
-			continue;
-		}
+	i = 0;
+	list_for_each_entry(pds, &pdr->lookups, node) {
+		if (pds->need_locator_lookup && i < count)
+			ctxs[i++].pds = pds;
+	}
 
-		ret = qmi_add_lookup(&pdr->notifier_hdl, pds->service, 1,
-				     pds->instance);
-		if (ret < 0) {
-			pdr_notify_lookup_failure(pdr, pds, ret);
-			continue;
-		}
+	pdr_locate_services(pdr, ctxs, count);
 
-		pds->need_locator_lookup = false;
+	for (i = 0; i < count; i++) {
+		if (!ctxs[i].ret)
+			pdr_locator_cache_store(ctxs[i].pds);
+		pdr_locator_lookup_done(pdr, ctxs[i].pds, ctxs[i].ret);
 	}
+
+	kvfree(ctxs);
+
+unlock:
 	mutex_unlock(&pdr->list_lock);
 }
 
@@ -743,5 +914,16 @@ void pdr_handle_release(struct pdr_handle *pdr)
 }
 EXPORT_SYMBOL_GPL(pdr_handle_release);
 
+static void __exit pdr_interface_exit(void)
+{
+	struct pdr_locator_cache_entry *entry, *tmp;
+
+	list_for_each_entry_safe(entry, tmp, &pdr_locator_cache, node) {
+		list_del(&entry->node);
+		kfree(entry);
+	}
+}
+module_exit(pdr_interface_exit);
+
 MODULE_LICENSE("GPL v2");
 MODULE_DESCRIPTION("Qualcomm Protection Domain Restart helpers");
@@ -828,18 +828,36 @@ int geni_icc_get(struct geni_se *se, const char *icc_ddr)
 }
 EXPORT_SYMBOL_GPL(geni_icc_get);
 
+/**
+ * geni_icc_set_bw() - Commit the SE's requested interconnect bandwidth
+ * @se:	Pointer to the concerned serial engine.
+ *
+ * Paths whose requested bandwidth matches the last successful vote are
+ * skipped, so callers may invoke this on every transfer setup without
+ * generating an interconnect (and RPMh) update each time.
+ *
+ * Return: 0 on success, standard Linux error codes on failure.
+ */
 int geni_icc_set_bw(struct geni_se *se)
 {
+	struct geni_icc_path *icc;
 	int i, ret;
 
 	for (i = 0; i < ARRAY_SIZE(se->icc_paths); i++) {
-		ret = icc_set_bw(se->icc_paths[i].path,
-			se->icc_paths[i].avg_bw, se->icc_paths[i].avg_bw);
+		icc = &se->icc_paths[i];
+		if (icc->voted && icc->voted_bw == icc->avg_bw)
+			continue;
+
+		ret = icc_set_bw(icc->path, icc->avg_bw, icc->avg_bw);
 		if (ret) {
+			icc->voted = false;
 			dev_err_ratelimited(se->dev, "ICC BW voting failed on path '%s': %d\n",
 					icc_path_names[i], ret);
 			return ret;
 		}
+
+		icc->voted_bw = icc->avg_bw;
+		icc->voted = true;
 	}
 
 	return 0;
@@ -850,8 +868,11 @@ void geni_icc_set_tag(struct geni_se *se, u32 tag)
 {
 	int i;
 
-	for (i = 0; i < ARRAY_SIZE(se->icc_paths); i++)
+	/* A new tag only takes effect with the next vote, so force one */
+	for (i = 0; i < ARRAY_SIZE(se->icc_paths); i++) {
 		icc_set_tag(se->icc_paths[i].path, tag);
+		se->icc_paths[i].voted = false;
+	}
 }
 EXPORT_SYMBOL_GPL(geni_icc_set_tag);
 
@@ -938,6 +959,8 @@ static int geni_se_probe(struct platform_device *pdev)
 	}
 
 	dev_set_drvdata(dev, wrapper);
+	/* The SEs are children of the wrapper, nothing else depends on it */
+	device_enable_async_suspend(dev);
 	dev_dbg(dev, "GENI SE Driver probed\n");
 	return devm_of_platform_populate(dev);
 }
@@ -13,6 +13,7 @@
 #include <linux/thermal.h>
 #include <linux/slab.h>
 #include <linux/soc/qcom/qcom_aoss.h>
+#include <linux/workqueue.h>
 
 #define CREATE_TRACE_POINTS
 #include "trace-aoss.h"
@@ -57,6 +58,23 @@ struct qmp_cooling_device {
 	struct qmp *qmp;
 	char *name;
 	bool state;
+	bool state_valid;
+};
+
+/**
+ * struct qmp_async_msg - message queued by qmp_send_async()
+ * @node: entry in the tx_queue of the qmp context
+ * @res: AOP resource the message updates, for coalescing
+ * @buf: the message
+ * @done: completion callback
+ * @data: argument for @done
+ */
+struct qmp_async_msg {
+	struct list_head node;
+	const char *res;
+	char buf[QMP_MSG_LEN];
+	qmp_done_t done;
+	void *data;
 };
 
 /**
@@ -69,6 +87,10 @@ struct qmp_cooling_device {
  * @size: maximum size of the messages to be transmitted
  * @event: wait_queue for synchronization with the IRQ
  * @tx_lock: provides synchronization between multiple callers of qmp_send()
+ * @tx_queue: messages waiting to be sent by @tx_work
+ * @tx_queue_lock: protects @tx_queue and @tx_shutdown
+ * @tx_work: sends the messages in @tx_queue
+ * @tx_shutdown: no more messages are accepted into @tx_queue
  * @qdss_clk: QDSS clock hw struct
  * @cooling_devs: thermal cooling devices
  * @debugfs_root: directory for the developer/tester interface
@@ -88,6 +110,11 @@ struct qmp {
 
 	struct mutex tx_lock;
 
+	struct list_head tx_queue;
+	spinlock_t tx_queue_lock;
+	struct work_struct tx_work;
+	bool tx_shutdown;
+
 	struct clk_hw qdss_clk;
 	struct qmp_cooling_device *cooling_devs;
 	struct dentry *debugfs_root;
@@ -212,6 +239,43 @@ static bool qmp_message_empty(struct qmp *qmp)
 	return readl(qmp->msgram + qmp->offset) == 0;
 }
 
+static int qmp_send_buf(struct qmp *qmp, const char *buf)
+{
+	long time_left;
+	int ret;
+
+	mutex_lock(&qmp->tx_lock);
+
+	trace_aoss_send(buf);
+
+	/* The message RAM only implements 32-bit accesses */
+	__iowrite32_copy(qmp->msgram + qmp->offset + sizeof(u32),
+			 buf, QMP_MSG_LEN / sizeof(u32));
+	writel(QMP_MSG_LEN, qmp->msgram + qmp->offset);
+
+	/* Read back length to confirm data written in message RAM */
+	readl(qmp->msgram + qmp->offset);
+	qmp_kick(qmp);
+
+	time_left = wait_event_interruptible_timeout(qmp->event,
+						     qmp_message_empty(qmp), HZ);
+	if (!time_left) {
+		dev_err(qmp->dev, "ucore did not ack channel\n");
+		ret = -ETIMEDOUT;
+
+		/* Clear message from buffer */
+		writel(0, qmp->msgram + qmp->offset);
+	} else {
+		ret = 0;
+	}
+
+	trace_aoss_send_done(buf, ret);
+
+	mutex_unlock(&qmp->tx_lock);
+
+	return ret;
+}
+
 /**
  * qmp_send() - send a message to the AOSS
  * @qmp: qmp context
@@ -227,10 +291,8 @@ static bool qmp_message_empty(struct qmp *qmp)
 int __printf(2, 3) qmp_send(struct qmp *qmp, const char *fmt, ...)
 {
 	char buf[QMP_MSG_LEN];
-	long time_left;
 	va_list args;
 	int len;
-	int ret;
 
 	if (WARN_ON(IS_ERR_OR_NULL(qmp) || !fmt))
 		return -EINVAL;
@@ -243,38 +305,139 @@ int __printf(2, 3) qmp_send(struct qmp *qmp, const char *fmt, ...)
 	if (WARN_ON(len >= sizeof(buf)))
 		return -EINVAL;
 
-	mutex_lock(&qmp->tx_lock);
+	return qmp_send_buf(qmp, buf);
+}
+EXPORT_SYMBOL_GPL(qmp_send);
 
-	trace_aoss_send(buf);
+static void qmp_tx_work(struct work_struct *work)
+{
+	struct qmp *qmp = container_of(work, struct qmp, tx_work);
+	struct qmp_async_msg *msg;
+	int ret;
 
-	/* The message RAM only implements 32-bit accesses */
-	__iowrite32_copy(qmp->msgram + qmp->offset + sizeof(u32),
-			 buf, sizeof(buf) / sizeof(u32));
-	writel(sizeof(buf), qmp->msgram + qmp->offset);
+	for (;;) {
+		spin_lock(&qmp->tx_queue_lock);
+		msg = list_first_entry_or_null(&qmp->tx_queue,
+					       struct qmp_async_msg, node);
+		if (msg)
+			list_del(&msg->node);
+		spin_unlock(&qmp->tx_queue_lock);
 
-	/* Read back length to confirm data written in message RAM */
-	readl(qmp->msgram + qmp->offset);
-	qmp_kick(qmp);
+		if (!msg)
+			break;
 
-	time_left = wait_event_interruptible_timeout(qmp->event,
-						     qmp_message_empty(qmp), HZ);
-	if (!time_left) {
-		dev_err(qmp->dev, "ucore did not ack channel\n");
-		ret = -ETIMEDOUT;
+		ret = qmp_send_buf(qmp, msg->buf);
+		if (msg->done)
+			msg->done(msg->data, ret);
+		kfree(msg);
+	}
+}
 
-		/* Clear message from buffer */
-		writel(0, qmp->msgram + qmp->offset);
-	} else {
-		ret = 0;
+/**
+ * qmp_send_async() - queue a message to the AOSS
+ * @qmp: qmp context
+ * @res: name of the AOP resource the message updates, or NULL
+ * @done: function called once the AOSS acknowledged the message, or NULL
+ * @data: argument passed to @done
+ * @fmt: format string for message to be sent
+ * @...: arguments for the format string
+ *
+ * Queue a message for transmission to the AOSS without waiting for it to be
+ * acknowledged. Messages are sent in the order they are queued. A message
+ * for @res replaces an earlier one for the same resource that has not been
+ * sent yet, in which case the replaced message completes with -ECANCELED.
+ * @res must stay valid until @done has been called.
+ *
+ * @done is called from process context, with 0 or a negative errno.
+ *
+ * Return: 0 if the message was queued, negative errno on failure
+ */
+int __printf(5, 6) qmp_send_async(struct qmp *qmp, const char *res,
+				  qmp_done_t done, void *data,
+				  const char *fmt, ...)
+{
+	struct qmp_async_msg *msg, *old;
+	qmp_done_t old_done = NULL;
+	void *old_data = NULL;
+	va_list args;
+	int len;
+
+	if (WARN_ON(IS_ERR_OR_NULL(qmp) || !fmt))
+		return -EINVAL;
+
+	msg = kzalloc(sizeof(*msg), GFP_KERNEL);
+	if (!msg)
+		return -ENOMEM;
+
+	va_start(args, fmt);
+	len = vsnprintf(msg->buf, sizeof(msg->buf), fmt, args);
+	va_end(args);
+
+	if (WARN_ON(len >= sizeof(msg->buf))) {
+		kfree(msg);
+		return -EINVAL;
 	}
 
-	trace_aoss_send_done(buf, ret);
+	msg->res = res;
+	msg->done = done;
+	msg->data = data;
 
-	mutex_unlock(&qmp->tx_lock);
+	spin_lock(&qmp->tx_queue_lock);
+	if (qmp->tx_shutdown) {
+		spin_unlock(&qmp->tx_queue_lock);
+		kfree(msg);
+		return -ESHUTDOWN;
+	}
 
-	return ret;
+	list_for_each_entry(old, &qmp->tx_queue, node) {
+		if (!res || !old->res || strcmp(old->res, res))
+			continue;
+
+		/* Only the latest update of a resource is worth sending */
+		old_done = old->done;
+		old_data = old->data;
+		memcpy(old->buf, msg->buf, sizeof(old->buf));
+		old->done = done;
+		old->data = data;
+		kfree(msg);
+		msg = NULL;
+		break;
+	}
+
+	if (msg)
+		list_add_tail(&msg->node, &qmp->tx_queue);
+	spin_unlock(&qmp->tx_queue_lock);
+
+	if (old_done)
+		old_done(old_data, -ECANCELED);
+
+	queue_work(system_unbound_wq, &qmp->tx_work);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(qmp_send_async);
+
+static void qmp_tx_queue_shutdown(struct qmp *qmp)
+{
+	struct qmp_async_msg *msg, *tmp;
+	LIST_HEAD(pending);
+
+	spin_lock(&qmp->tx_queue_lock);
+	qmp->tx_shutdown = true;
+	spin_unlock(&qmp->tx_queue_lock);
+
+	cancel_work_sync(&qmp->tx_work);
+
+	spin_lock(&qmp->tx_queue_lock);
+	list_splice_init(&qmp->tx_queue, &pending);
+	spin_unlock(&qmp->tx_queue_lock);
+
+	list_for_each_entry_safe(msg, tmp, &pending, node) {
+		if (msg->done)
+			msg->done(msg->data, -ESHUTDOWN);
+		kfree(msg);
+	}
 }
-EXPORT_SYMBOL_GPL(qmp_send);
 
 static int qmp_qdss_clk_prepare(struct clk_hw *hw)
 {
@@ -344,6 +507,20 @@ static int qmp_cdev_get_cur_state(struct thermal_cooling_device *cdev,
 	return 0;
 }
 
+static void qmp_cdev_state_done(void *data, int ret)
+{
+	struct qmp_cooling_device *qmp_cdev = data;
+
+	if (!ret || ret == -ECANCELED)
+		return;
+
+	dev_err(qmp_cdev->qmp->dev, "failed to update %s cooling state: %d\n",
+		qmp_cdev->name, ret);
+
+	/* Make the next update resend the state */
+	WRITE_ONCE(qmp_cdev->state_valid, false);
+}
+
 static int qmp_cdev_set_cur_state(struct thermal_cooling_device *cdev,
 				  unsigned long state)
 {
@@ -354,13 +531,22 @@ static int qmp_cdev_set_cur_state(struct thermal_cooling_device *cdev,
 	/* Normalize state */
 	cdev_state = !!state;
 
-	if (qmp_cdev->state == state)
+	if (READ_ONCE(qmp_cdev->state_valid) && qmp_cdev->state == cdev_state)
 		return 0;
 
-	ret = qmp_send(qmp_cdev->qmp, "{class: volt_flr, event:zero_temp, res:%s, value:%s}",
-		       qmp_cdev->name, cdev_state ? "on" : "off");
-	if (!ret)
-		qmp_cdev->state = cdev_state;
+	/*
+	 * Don't hold up the thermal governor on the AOP round trip, the
+	 * request is queued and superseded by any later one for the rail.
+	 */
+	qmp_cdev->state = cdev_state;
+	WRITE_ONCE(qmp_cdev->state_valid, true);
+
+	ret = qmp_send_async(qmp_cdev->qmp, qmp_cdev->name,
+			     qmp_cdev_state_done, qmp_cdev,
+			     "{class: volt_flr, event:zero_temp, res:%s, value:%s}",
+			     qmp_cdev->name, cdev_state ? "on" : "off");
+	if (ret)
+		WRITE_ONCE(qmp_cdev->state_valid, false);
 
 	return ret;
 }
@@ -379,6 +565,7 @@ static int qmp_cooling_device_add(struct qmp *qmp,
 
 	qmp_cdev->qmp = qmp;
 	qmp_cdev->state = !qmp_cdev_max_state;
+	qmp_cdev->state_valid = true;
 	qmp_cdev->name = cdev_name;
 	qmp_cdev->cdev = devm_thermal_of_cooling_device_register
 				(qmp->dev, node,
@@ -587,6 +774,9 @@ static int qmp_probe(struct platform_device *pdev)
 	qmp->dev = &pdev->dev;
 	init_waitqueue_head(&qmp->event);
 	mutex_init(&qmp->tx_lock);
+	INIT_LIST_HEAD(&qmp->tx_queue);
+	spin_lock_init(&qmp->tx_queue_lock);
+	INIT_WORK(&qmp->tx_work, qmp_tx_work);
 
 	qmp->msgram = devm_platform_ioremap_resource(pdev, 0);
 	if (IS_ERR(qmp->msgram))
@@ -643,6 +833,8 @@ static void qmp_remove(struct platform_device *pdev)
 	qmp_qdss_clk_remove(qmp);
 	qmp_cooling_devices_remove(qmp);
 
+	qmp_tx_queue_shutdown(qmp);
+
 	qmp_close(qmp);
 	mbox_free_channel(qmp->mbox_chan);
 }
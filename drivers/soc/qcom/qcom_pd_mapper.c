@@ -21,6 +21,12 @@
 
 #define TMS_SERVREG_SERVICE "tms/servreg"
 
+/*
+ * Every remoteproc queries the locator while it boots, and they mostly boot
+ * together. Answer them concurrently, one lane per sender.
+ */
+#define QCOM_PDM_NR_LANES 4
+
 struct qcom_pdm_domain_data {
 	const char *domain;
 	u32 instance_id;
@@ -198,6 +204,8 @@ static void qcom_pdm_get_domain_list(struct qmi_handle *qmi,
 		}
 	}
 
+	mutex_unlock(&qcom_pdm_mutex);
+
 	pr_debug("PDM: service '%s' offset %d returning %d domains (of %d)\n", req->service_name,
 		 req->domain_offset_valid ? req->domain_offset : -1, rsp->domain_list_len, rsp->total_domains);
 
@@ -207,8 +215,6 @@ static void qcom_pdm_get_domain_list(struct qmi_handle *qmi,
 	if (ret)
 		pr_err("Error sending servreg response: %d\n", ret);
 
-	mutex_unlock(&qcom_pdm_mutex);
-
 	kfree(rsp);
 }
 
@@ -590,8 +596,10 @@ static struct qcom_pdm_data *qcom_pdm_start(void)
 
 	INIT_LIST_HEAD(&data->services);
 
-	ret = qmi_handle_init(&data->handle, SERVREG_GET_DOMAIN_LIST_REQ_MAX_LEN,
-			      NULL, qcom_pdm_msg_handlers);
+	ret = qmi_handle_init_concurrent(&data->handle,
+					 SERVREG_GET_DOMAIN_LIST_REQ_MAX_LEN,
+					 NULL, qcom_pdm_msg_handlers,
+					 QCOM_PDM_NR_LANES);
 	if (ret) {
 		kfree(data);
 		return ERR_PTR(ret);
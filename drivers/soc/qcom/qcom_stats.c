@@ -7,12 +7,19 @@
 #include <linux/device.h>
 #include <linux/io.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
 #include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
 
 #include <linux/soc/qcom/smem.h>
 #include <clocksource/arm_arch_timer.h>
+#include <soc/qcom/rpmh.h>
+
+#define CREATE_TRACE_POINTS
+#include "trace-stats.h"
 
 #define RPM_DYNAMIC_ADDR	0x14
 #define RPM_DYNAMIC_ADDR_MASK	0xFFFF
@@ -24,6 +31,11 @@
 #define ACCUMULATED_OFFSET	0x18
 #define CLIENT_VOTES_OFFSET	0x20
 
+#define SAMPLE_RING_LEN		512
+#define SAMPLE_NO_CULPRIT	0xffff
+/* Exits this much (~1ms of arch timer) ahead of the wakeup are early */
+#define SAMPLE_WAKEUP_SLACK	19200
+
 struct subsystem_data {
 	const char *name;
 	u32 smem_item;
@@ -57,6 +69,7 @@ struct stats_config {
 struct stats_data {
 	bool appended_stats_avail;
 	void __iomem *base;
+	char name[sizeof(u32) + 1];
 };
 
 struct sleep_stats {
@@ -72,6 +85,50 @@ struct appended_stats {
 	u32 reserved[3];
 };
 
+/*
+ * One record of the "samples" debugfs file, written whenever a sampled
+ * low power mode changed since the previous sample. All times are in arch
+ * timer counts.
+ *
+ * @sampled_at: When the change was seen.
+ * @wakeup: Last wakeup the APSS programmed in its RSC before the exit, ~0 for
+ *	    "no timer" and 0 if unknown.
+ * @culprit: For SoC modes exited well ahead of @wakeup, the id of the
+ *	     subsystem whose own exit was closest to it, else SAMPLE_NO_CULPRIT.
+ * @id: Index of the mode in the "sample_ids" file.
+ */
+struct qcom_stats_sample {
+	u64 sampled_at;
+	u64 wakeup;
+	u64 last_entered_at;
+	u64 last_exited_at;
+	u64 accumulated;
+	u32 count;
+	u16 id;
+	u16 culprit;
+};
+
+/*
+ * Ids 0 to num_soc - 1 are the SoC modes in MSG RAM, followed by the SMEM
+ * subsystems if the platform has them.
+ */
+struct qcom_stats {
+	struct dentry *root;
+	struct stats_data *d;
+	unsigned int num_soc;
+	unsigned int num_ids;
+
+	/* Protects everything below */
+	struct mutex lock;
+	struct delayed_work work;
+	unsigned int sample_ms;
+	struct sleep_stats *last;
+	struct sleep_stats *cur;
+	bool *valid;
+	struct qcom_stats_sample *ring;
+	unsigned long ring_head;
+};
+
 static void qcom_print_stats(struct seq_file *s, const struct sleep_stats *stat)
 {
 	u64 accumulated = stat->accumulated;
@@ -162,6 +219,7 @@ static void qcom_create_soc_sleep_stat_files(struct dentry *root, void __iomem *
 			type = type >> 8;
 		}
 		strim(stat_type);
+		strscpy(d[i].name, stat_type);
 		debugfs_create_file(stat_type, 0400, root, &d[i],
 				    &qcom_soc_sleep_stats_fops);
 
@@ -184,13 +242,269 @@ static void qcom_create_subsystem_stat_files(struct dentry *root,
 				    &qcom_subsystem_sleep_stats_fops);
 }
 
+static const char *qcom_stats_id_name(struct qcom_stats *stats, unsigned int id)
+{
+	if (id < stats->num_soc)
+		return stats->d[id].name;
+
+	return subsystems[id - stats->num_soc].name;
+}
+
+static bool qcom_stats_read(struct qcom_stats *stats, unsigned int id,
+			    struct sleep_stats *stat)
+{
+	const struct subsystem_data *subsystem;
+	struct sleep_stats *smem_stat;
+
+	if (id < stats->num_soc) {
+		memcpy_fromio(stat, stats->d[id].base, sizeof(*stat));
+		return true;
+	}
+
+	subsystem = &subsystems[id - stats->num_soc];
+	smem_stat = qcom_smem_get(subsystem->pid, subsystem->smem_item, NULL);
+	if (IS_ERR(smem_stat))
+		return false;
+
+	memcpy(stat, smem_stat, sizeof(*stat));
+	return true;
+}
+
+/*
+ * A SoC mode that was left well before the wakeup the APSS asked for was
+ * broken by somebody else; blame the subsystem that woke up closest to it.
+ */
+static u16 qcom_stats_find_culprit(struct qcom_stats *stats, unsigned int id,
+				   u64 written_at, u64 wakeup)
+{
+	u64 exited = stats->cur[id].last_exited_at;
+	u64 best = U64_MAX, diff;
+	u16 culprit = SAMPLE_NO_CULPRIT;
+	unsigned int i;
+
+	if (id >= stats->num_soc || !wakeup || written_at > exited ||
+	    exited + SAMPLE_WAKEUP_SLACK >= wakeup)
+		return SAMPLE_NO_CULPRIT;
+
+	for (i = stats->num_soc; i < stats->num_ids; i++) {
+		if (!stats->valid[i] ||
+		    stats->cur[i].last_exited_at == stats->last[i].last_exited_at)
+			continue;
+
+		diff = abs_diff(stats->cur[i].last_exited_at, exited);
+		if (diff < best) {
+			best = diff;
+			culprit = i;
+		}
+	}
+
+	return culprit;
+}
+
+static void qcom_stats_record(struct qcom_stats *stats, unsigned int id,
+			      u64 now, u64 written_at, u64 wakeup)
+{
+	const struct sleep_stats *cur = &stats->cur[id];
+	struct qcom_stats_sample *sample;
+	u16 culprit;
+
+	culprit = qcom_stats_find_culprit(stats, id, written_at, wakeup);
+
+	sample = &stats->ring[stats->ring_head++ % SAMPLE_RING_LEN];
+	sample->sampled_at = now;
+	sample->wakeup = written_at <= cur->last_exited_at ? wakeup : 0;
+	sample->last_entered_at = cur->last_entered_at;
+	sample->last_exited_at = cur->last_exited_at;
+	sample->accumulated = cur->accumulated;
+	sample->count = cur->count;
+	sample->id = id;
+	sample->culprit = culprit;
+
+	trace_qcom_stats_transition(qcom_stats_id_name(stats, id), cur->count,
+				    cur->last_entered_at, cur->last_exited_at,
+				    cur->accumulated - stats->last[id].accumulated,
+				    sample->wakeup,
+				    culprit == SAMPLE_NO_CULPRIT ? "" :
+				    qcom_stats_id_name(stats, culprit));
+}
+
+static void qcom_stats_sample(struct qcom_stats *stats)
+{
+	u64 now = arch_timer_read_counter();
+	u64 written_at, wakeup;
+	unsigned int i;
+
+	rpmh_get_last_wakeup(&written_at, &wakeup);
+
+	for (i = 0; i < stats->num_ids; i++) {
+		stats->valid[i] = qcom_stats_read(stats, i, &stats->cur[i]);
+		if (!stats->valid[i])
+			stats->cur[i] = stats->last[i];
+	}
+
+	for (i = 0; i < stats->num_ids; i++) {
+		if (!stats->valid[i])
+			continue;
+
+		if (stats->cur[i].count != stats->last[i].count ||
+		    stats->cur[i].last_exited_at != stats->last[i].last_exited_at)
+			qcom_stats_record(stats, i, now, written_at, wakeup);
+	}
+
+	swap(stats->cur, stats->last);
+}
+
+static void qcom_stats_work(struct work_struct *work)
+{
+	struct qcom_stats *stats = container_of(to_delayed_work(work),
+						struct qcom_stats, work);
+
+	mutex_lock(&stats->lock);
+	qcom_stats_sample(stats);
+	if (stats->sample_ms)
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				   &stats->work, msecs_to_jiffies(stats->sample_ms));
+	mutex_unlock(&stats->lock);
+}
+
+static int qcom_stats_sample_ms_get(void *data, u64 *val)
+{
+	struct qcom_stats *stats = data;
+
+	*val = READ_ONCE(stats->sample_ms);
+
+	return 0;
+}
+
+static int qcom_stats_sample_ms_set(void *data, u64 val)
+{
+	struct qcom_stats *stats = data;
+
+	if (val > UINT_MAX)
+		return -EINVAL;
+
+	cancel_delayed_work_sync(&stats->work);
+
+	mutex_lock(&stats->lock);
+	/* Start from a fresh baseline so the first sample has no stale deltas */
+	if (!stats->sample_ms && val) {
+		unsigned int i;
+
+		for (i = 0; i < stats->num_ids; i++)
+			qcom_stats_read(stats, i, &stats->last[i]);
+	}
+	stats->sample_ms = val;
+	if (val)
+		queue_delayed_work(system_freezable_power_efficient_wq,
+				   &stats->work, msecs_to_jiffies(val));
+	mutex_unlock(&stats->lock);
+
+	return 0;
+}
+DEFINE_DEBUGFS_ATTRIBUTE(qcom_stats_sample_ms_fops, qcom_stats_sample_ms_get,
+			 qcom_stats_sample_ms_set, "%llu\n");
+
+struct qcom_stats_snapshot {
+	size_t size;
+	struct qcom_stats_sample samples[];
+};
+
+static int qcom_stats_samples_open(struct inode *inode, struct file *file)
+{
+	struct qcom_stats *stats = inode->i_private;
+	struct qcom_stats_snapshot *snap;
+	unsigned long i, n, start;
+
+	snap = kvzalloc(struct_size(snap, samples, SAMPLE_RING_LEN), GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	/* Copy the ring out oldest first, so a read sees a consistent snapshot */
+	mutex_lock(&stats->lock);
+	n = min_t(unsigned long, stats->ring_head, SAMPLE_RING_LEN);
+	start = stats->ring_head - n;
+	for (i = 0; i < n; i++)
+		snap->samples[i] = stats->ring[(start + i) % SAMPLE_RING_LEN];
+	mutex_unlock(&stats->lock);
+
+	snap->size = n * sizeof(snap->samples[0]);
+	file->private_data = snap;
+
+	return 0;
+}
+
+static ssize_t qcom_stats_samples_read(struct file *file, char __user *buf,
+				       size_t count, loff_t *ppos)
+{
+	struct qcom_stats_snapshot *snap = file->private_data;
+
+	return simple_read_from_buffer(buf, count, ppos, snap->samples,
+				       snap->size);
+}
+
+static int qcom_stats_samples_release(struct inode *inode, struct file *file)
+{
+	kvfree(file->private_data);
+
+	return 0;
+}
+
+static const struct file_operations qcom_stats_samples_fops = {
+	.owner = THIS_MODULE,
+	.open = qcom_stats_samples_open,
+	.read = qcom_stats_samples_read,
+	.release = qcom_stats_samples_release,
+	.llseek = default_llseek,
+};
+
+static int qcom_stats_sample_ids_show(struct seq_file *s, void *unused)
+{
+	struct qcom_stats *stats = s->private;
+	unsigned int i;
+
+	for (i = 0; i < stats->num_ids; i++)
+		seq_printf(s, "%u %s\n", i, qcom_stats_id_name(stats, i));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(qcom_stats_sample_ids);
+
+static int qcom_create_sampling_files(struct device *dev, struct qcom_stats *stats,
+				      const struct stats_config *config)
+{
+	stats->num_soc = config->num_records;
+	stats->num_ids = stats->num_soc;
+	if (config->subsystem_stats_in_smem)
+		stats->num_ids += ARRAY_SIZE(subsystems);
+
+	stats->last = devm_kcalloc(dev, stats->num_ids, sizeof(*stats->last), GFP_KERNEL);
+	stats->cur = devm_kcalloc(dev, stats->num_ids, sizeof(*stats->cur), GFP_KERNEL);
+	stats->valid = devm_kcalloc(dev, stats->num_ids, sizeof(*stats->valid), GFP_KERNEL);
+	stats->ring = devm_kcalloc(dev, SAMPLE_RING_LEN, sizeof(*stats->ring), GFP_KERNEL);
+	if (!stats->last || !stats->cur || !stats->valid || !stats->ring)
+		return -ENOMEM;
+
+	mutex_init(&stats->lock);
+	INIT_DEFERRABLE_WORK(&stats->work, qcom_stats_work);
+
+	debugfs_create_file("sample_ms", 0600, stats->root, stats,
+			    &qcom_stats_sample_ms_fops);
+	debugfs_create_file("samples", 0400, stats->root, stats,
+			    &qcom_stats_samples_fops);
+	debugfs_create_file("sample_ids", 0400, stats->root, stats,
+			    &qcom_stats_sample_ids_fops);
+
+	return 0;
+}
+
 static int qcom_stats_probe(struct platform_device *pdev)
 {
 	void __iomem *reg;
 	struct dentry *root;
 	const struct stats_config *config;
+	struct qcom_stats *stats;
 	struct stats_data *d;
-	int i;
+	int i, ret;
 
 	config = device_get_match_data(&pdev->dev);
 	if (!config)
@@ -200,6 +514,10 @@ static int qcom_stats_probe(struct platform_device *pdev)
 	if (IS_ERR(reg))
 		return -ENOMEM;
 
+	stats = devm_kzalloc(&pdev->dev, sizeof(*stats), GFP_KERNEL);
+	if (!stats)
+		return -ENOMEM;
+
 	d = devm_kcalloc(&pdev->dev, config->num_records,
 			 sizeof(*d), GFP_KERNEL);
 	if (!d)
@@ -213,7 +531,15 @@ static int qcom_stats_probe(struct platform_device *pdev)
 	qcom_create_subsystem_stat_files(root, config);
 	qcom_create_soc_sleep_stat_files(root, reg, d, config);
 
-	platform_set_drvdata(pdev, root);
+	stats->root = root;
+	stats->d = d;
+	ret = qcom_create_sampling_files(&pdev->dev, stats, config);
+	if (ret) {
+		debugfs_remove_recursive(root);
+		return ret;
+	}
+
+	platform_set_drvdata(pdev, stats);
 
 	device_set_pm_not_required(&pdev->dev);
 
@@ -222,9 +548,10 @@ static int qcom_stats_probe(struct platform_device *pdev)
 
 static void qcom_stats_remove(struct platform_device *pdev)
 {
-	struct dentry *root = platform_get_drvdata(pdev);
+	struct qcom_stats *stats = platform_get_drvdata(pdev);
 
-	debugfs_remove_recursive(root);
+	debugfs_remove_recursive(stats->root);
+	cancel_delayed_work_sync(&stats->work);
 }
 
 static const struct stats_config rpm_data = {
@@ -3,13 +3,20 @@
  * Copyright (c) 2012-2015, The Linux Foundation. All rights reserved.
  * Copyright (C) 2017 Linaro Ltd.
  */
+#include <linux/hashtable.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
 #include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <linux/rcupdate.h>
+#include <linux/spinlock.h>
 #include <linux/kernel.h>
 #include <linux/errno.h>
 #include <linux/string.h>
 #include <linux/soc/qcom/qmi.h>
+#include <kunit/visibility.h>
+
+#include "qmi_encdec.h"
 
 #define QMI_ENCDEC_ENCODE_TLV(type, length, p_dst) do { \
 	*p_dst++ = type; \
@@ -701,20 +708,582 @@ static int qmi_decode(const struct qmi_elem_info *ei_array, void *out_c_struct,
 	return decoded_bytes;
 }
 
+/*
+ * Compiled message plans
+ *
+ * The interpreter above walks the element info array for every message and
+ * searches it linearly for every TLV received. The layout of a message is
+ * fixed by its element info array though, so the first time an array is
+ * seen it is flattened into a plan: one entry per top-level TLV with the
+ * offsets and sizes resolved, nested fixed-layout structures reduced to
+ * runs of contiguous bytes and a direct TLV type lookup table.
+ *
+ * Plans only describe the common layouts: optional flags, length prefixed
+ * arrays of basic types or fixed structures, and top-level strings. Arrays
+ * that use anything else get a negative plan and are always interpreted.
+ * The plan is also abandoned, and the message handed to the interpreter,
+ * whenever a message does not fit it exactly, so that malformed messages
+ * are still rejected, and logged, by the interpreter.
+ *
+ * Plans are keyed by the address of the element info array, which lives in
+ * the rodata of the client, so plans belonging to a module are dropped when
+ * that module goes away.
+ */
+#define QMI_PLAN_HASH_BITS	6
+#define QMI_PLAN_MAX_RUNS	8
+#define QMI_PLAN_MAX_DEPTH	4
+
+enum qmi_plan_kind {
+	QMI_PLAN_BASIC,
+	QMI_PLAN_STRUCT,
+	QMI_PLAN_STRING,
+};
+
 /**
- * qmi_encode_message() - Encode C structure as QMI encoded message
- * @type:	Type of QMI message
- * @msg_id:	Message ID of the message
- * @len:	Passed as max length of the message, updated to actual size
- * @txn_id:	Transaction ID
- * @ei:		QMI message descriptor
- * @c_struct:	Reference to structure to encode
+ * struct qmi_plan_run - contiguous bytes of a fixed-layout structure
+ * @offset:	offset of the run within the C structure
+ * @len:	length of the run, in bytes
+ */
+struct qmi_plan_run {
+	u32 offset;
+	u32 len;
+};
+
+/**
+ * struct qmi_plan_tlv - precomputed description of one top-level TLV
+ * @type:	TLV type
+ * @kind:	basic element, fixed-layout structure or string
+ * @has_opt:	TLV is preceded by an optional flag at @opt_offset
+ * @len_sz:	wire size of the length prefix, 0 if the TLV has none
+ * @len_elem_size: size of the length field in the C structure
+ * @opt_offset:	offset of the optional flag
+ * @len_offset:	offset of the length field
+ * @offset:	offset of the first element
+ * @elem_len:	number of elements, or maximum number for variable arrays
+ * @elem_size:	size of one element in the C structure
+ * @wire_size:	size of one element on the wire
+ * @nr_runs:	number of entries in @runs, for structures
+ * @runs:	contiguous runs making up one structure element
+ */
+struct qmi_plan_tlv {
+	u8 type;
+	u8 kind;
+	bool has_opt;
+	u8 len_sz;
+	u32 len_elem_size;
+	u32 opt_offset;
+	u32 len_offset;
+	u32 offset;
+	u32 elem_len;
+	u32 elem_size;
+	u32 wire_size;
+	unsigned int nr_runs;
+	struct qmi_plan_run runs[QMI_PLAN_MAX_RUNS];
+};
+
+/**
+ * struct qmi_plan - compiled form of a message element info array
+ * @node:	entry in qmi_plans
+ * @rcu:	for freeing the plan after its module went away
+ * @ei:		element info array the plan was compiled from
+ * @compiled:	false for arrays the plan does not support
+ * @index:	TLV type to @tlvs index + 1, 0 for unknown types
+ * @nr_tlvs:	number of entries in @tlvs
+ * @tlvs:	the top-level TLVs, in encoding order
+ */
+struct qmi_plan {
+	struct hlist_node node;
+	struct rcu_head rcu;
+	const struct qmi_elem_info *ei;
+	bool compiled;
+	u8 index[U8_MAX + 1];
+	unsigned int nr_tlvs;
+	struct qmi_plan_tlv tlvs[] __counted_by(nr_tlvs);
+};
+
+static DEFINE_HASHTABLE(qmi_plans, QMI_PLAN_HASH_BITS);
+static DEFINE_SPINLOCK(qmi_plans_lock);
+
+static bool qmi_encdec_use_plans = true;
+module_param_named(use_plans, qmi_encdec_use_plans, bool, 0644);
+MODULE_PARM_DESC(use_plans, "Use compiled plans for known message layouts");
+
+static bool qmi_plan_is_basic(enum qmi_elem_type type)
+{
+	switch (type) {
+	case QMI_UNSIGNED_1_BYTE:
+	case QMI_UNSIGNED_2_BYTE:
+	case QMI_UNSIGNED_4_BYTE:
+	case QMI_UNSIGNED_8_BYTE:
+	case QMI_SIGNED_2_BYTE_ENUM:
+	case QMI_SIGNED_4_BYTE_ENUM:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static int qmi_plan_add_run(struct qmi_plan_tlv *tlv, u32 offset, u32 len)
+{
+	struct qmi_plan_run *run;
+
+	if (!len)
+		return 0;
+
+	run = tlv->nr_runs ? &tlv->runs[tlv->nr_runs - 1] : NULL;
+	if (run && run->offset + run->len == offset) {
+		run->len += len;
+	} else {
+		if (tlv->nr_runs == QMI_PLAN_MAX_RUNS)
+			return -E2BIG;
+		run = &tlv->runs[tlv->nr_runs++];
+		run->offset = offset;
+		run->len = len;
+	}
+
+	tlv->wire_size += len;
+
+	return 0;
+}
+
+/*
+ * Reduce a nested structure to runs of bytes, which is only possible when
+ * the structure, and anything nested in it, has a fixed layout.
+ */
+static int qmi_plan_flatten(struct qmi_plan_tlv *tlv,
+			    const struct qmi_elem_info *ei, u32 base,
+			    int depth)
+{
+	u32 count, i;
+	int ret;
+
+	if (!ei || depth > QMI_PLAN_MAX_DEPTH)
+		return -EINVAL;
+
+	for (; ei->data_type != QMI_EOTI; ei++) {
+		if (ei->array_type == NO_ARRAY)
+			count = 1;
+		else if (ei->array_type == STATIC_ARRAY)
+			count = ei->elem_len;
+		else
+			return -EINVAL;
+
+		if (qmi_plan_is_basic(ei->data_type)) {
+			ret = qmi_plan_add_run(tlv, base + ei->offset,
+					       count * ei->elem_size);
+		} else if (ei->data_type == QMI_STRUCT) {
+			for (i = 0, ret = 0; i < count && !ret; i++)
+				ret = qmi_plan_flatten(tlv, ei->ei_array,
+						       base + ei->offset +
+						       i * ei->elem_size,
+						       depth + 1);
+		} else {
+			ret = -EINVAL;
+		}
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/*
+ * Compile one [optional flag] [length] element group, returning the number
+ * of element info entries consumed.
+ */
+static int qmi_plan_compile_tlv(struct qmi_plan_tlv *tlv,
+				const struct qmi_elem_info *ei)
+{
+	const struct qmi_elem_info *temp_ei = ei;
+	int ret;
+
+	memset(tlv, 0, sizeof(*tlv));
+	tlv->type = temp_ei->tlv_type;
+
+	if (temp_ei->data_type == QMI_OPT_FLAG) {
+		if (temp_ei->array_type != NO_ARRAY)
+			return -EINVAL;
+		tlv->has_opt = true;
+		tlv->opt_offset = temp_ei->offset;
+		temp_ei++;
+	}
+
+	if (temp_ei->data_type == QMI_DATA_LEN) {
+		if (temp_ei->array_type != NO_ARRAY ||
+		    temp_ei->elem_size > sizeof(u32))
+			return -EINVAL;
+		tlv->len_sz = temp_ei->elem_size == sizeof(u8) ?
+			      sizeof(u8) : sizeof(u16);
+		tlv->len_elem_size = temp_ei->elem_size;
+		tlv->len_offset = temp_ei->offset;
+		temp_ei++;
+	}
+
+	if (temp_ei->data_type == QMI_EOTI || temp_ei->tlv_type != tlv->type)
+		return -EINVAL;
+
+	/* A variable array needs its length, anything else must not have one */
+	if ((temp_ei->array_type == VAR_LEN_ARRAY) != !!tlv->len_sz)
+		return -EINVAL;
+
+	tlv->offset = temp_ei->offset;
+	tlv->elem_len = temp_ei->array_type == NO_ARRAY ? 1 : temp_ei->elem_len;
+	tlv->elem_size = temp_ei->elem_size;
+
+	if (qmi_plan_is_basic(temp_ei->data_type)) {
+		tlv->kind = QMI_PLAN_BASIC;
+		tlv->wire_size = temp_ei->elem_size;
+	} else if (temp_ei->data_type == QMI_STRUCT) {
+		tlv->kind = QMI_PLAN_STRUCT;
+		ret = qmi_plan_flatten(tlv, temp_ei->ei_array, 0, 1);
+		if (ret)
+			return ret;
+	} else if (temp_ei->data_type == QMI_STRING) {
+		if (tlv->len_sz || temp_ei->elem_size != sizeof(u8))
+			return -EINVAL;
+		tlv->kind = QMI_PLAN_STRING;
+		tlv->elem_len = temp_ei->elem_len;
+		tlv->wire_size = sizeof(u8);
+	} else {
+		return -EINVAL;
+	}
+
+	temp_ei++;
+
+	/* One element per TLV, as that is all the encoder will put in it */
+	if (temp_ei->data_type != QMI_EOTI && temp_ei->tlv_type == tlv->type)
+		return -EINVAL;
+
+	return temp_ei - ei;
+}
+
+static struct qmi_plan *qmi_plan_compile(const struct qmi_elem_info *ei)
+{
+	const struct qmi_elem_info *temp_ei;
+	struct qmi_plan *plan;
+	unsigned int nr_tlvs = 0;
+	unsigned int i;
+	int ret;
+
+	for (temp_ei = ei; temp_ei->data_type != QMI_EOTI; temp_ei++)
+		if (temp_ei == ei || temp_ei->tlv_type != temp_ei[-1].tlv_type)
+			nr_tlvs++;
+
+	plan = kzalloc(struct_size(plan, tlvs, nr_tlvs), GFP_ATOMIC);
+	if (!plan)
+		return NULL;
+
+	plan->ei = ei;
+	plan->nr_tlvs = nr_tlvs;
+
+	for (i = 0, temp_ei = ei; i < nr_tlvs; i++, temp_ei += ret) {
+		ret = qmi_plan_compile_tlv(&plan->tlvs[i], temp_ei);
+		if (ret < 0 || plan->index[plan->tlvs[i].type])
+			goto negative;
+		plan->index[plan->tlvs[i].type] = i + 1;
+	}
+
+	if (temp_ei->data_type != QMI_EOTI)
+		goto negative;
+
+	plan->compiled = true;
+
+	return plan;
+
+negative:
+	/* Keep the allocation around to remember not to try again */
+	memset(plan->index, 0, sizeof(plan->index));
+	return plan;
+}
+
+static struct qmi_plan *qmi_plan_get(const struct qmi_elem_info *ei)
+{
+	struct qmi_plan *plan, *new;
+	unsigned long flags;
+
+	hash_for_each_possible_rcu(qmi_plans, plan, node, (unsigned long)ei)
+		if (plan->ei == ei)
+			return plan->compiled ? plan : NULL;
+
+	new = qmi_plan_compile(ei);
+	if (!new)
+		return NULL;
+
+	spin_lock_irqsave(&qmi_plans_lock, flags);
+	hash_for_each_possible(qmi_plans, plan, node, (unsigned long)ei) {
+		if (plan->ei == ei) {
+			spin_unlock_irqrestore(&qmi_plans_lock, flags);
+			kfree(new);
+			return plan->compiled ? plan : NULL;
+		}
+	}
+	hash_add_rcu(qmi_plans, &new->node, (unsigned long)ei);
+	spin_unlock_irqrestore(&qmi_plans_lock, flags);
+
+	return new->compiled ? new : NULL;
+}
+
+static u32 qmi_plan_count(const struct qmi_plan_tlv *tlv, const void *c_struct,
+			  u32 *data_len)
+{
+	u32 len = 0;
+
+	if (!tlv->len_sz)
+		return tlv->elem_len;
+
+	memcpy(&len, c_struct + tlv->len_offset, tlv->len_elem_size);
+	*data_len = len;
+
+	return len;
+}
+
+static void qmi_plan_pack(const struct qmi_plan_tlv *tlv, u8 *dst,
+			  const u8 *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < tlv->nr_runs; i++) {
+		memcpy(dst, src + tlv->runs[i].offset, tlv->runs[i].len);
+		dst += tlv->runs[i].len;
+	}
+}
+
+static void qmi_plan_unpack(const struct qmi_plan_tlv *tlv, u8 *dst,
+			    const u8 *src)
+{
+	unsigned int i;
+
+	for (i = 0; i < tlv->nr_runs; i++) {
+		memcpy(dst + tlv->runs[i].offset, src, tlv->runs[i].len);
+		src += tlv->runs[i].len;
+	}
+}
+
+/**
+ * qmi_plan_encode() - Encode a message using its compiled plan
+ * @plan:	Compiled plan of the message
+ * @out_buf:	Buffer to hold the encoded QMI message
+ * @in_c_struct: Pointer to the C structure to be encoded
+ * @out_buf_len: Available space in the encode buffer
  *
- * Return: Buffer with encoded message, or negative ERR_PTR() on error
+ * Return: The number of bytes of encoded information, or negative errno if
+ * the message has to be handed to the interpreter.
  */
-void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
-			 unsigned int txn_id, const struct qmi_elem_info *ei,
-			 const void *c_struct)
+static int qmi_plan_encode(const struct qmi_plan *plan, u8 *out_buf,
+			   const void *in_c_struct, u32 out_buf_len)
+{
+	const struct qmi_plan_tlv *tlv;
+	u32 count, payload, i;
+	u32 encoded_bytes = 0;
+	u32 data_len = 0;
+	const u8 *src;
+	u8 *dst;
+	unsigned int t;
+
+	for (t = 0; t < plan->nr_tlvs; t++) {
+		tlv = &plan->tlvs[t];
+		if (tlv->has_opt && !*(const u8 *)(in_c_struct + tlv->opt_offset))
+			continue;
+
+		src = in_c_struct + tlv->offset;
+		if (tlv->kind == QMI_PLAN_STRING) {
+			count = strnlen((const char *)src, tlv->elem_len + 1);
+			if (count > tlv->elem_len)
+				return -EINVAL;
+		} else {
+			count = qmi_plan_count(tlv, in_c_struct, &data_len);
+			if (count > tlv->elem_len)
+				return -EINVAL;
+		}
+
+		payload = tlv->len_sz + count * tlv->wire_size;
+		if (encoded_bytes + TLV_TYPE_SIZE + TLV_LEN_SIZE + payload >
+		    out_buf_len)
+			return -ETOOSMALL;
+
+		dst = out_buf + encoded_bytes;
+		QMI_ENCDEC_ENCODE_TLV(tlv->type, payload, dst);
+		if (tlv->len_sz) {
+			memcpy(dst, &data_len, tlv->len_sz);
+			dst += tlv->len_sz;
+		}
+
+		if (tlv->kind == QMI_PLAN_STRUCT) {
+			for (i = 0; i < count; i++) {
+				qmi_plan_pack(tlv, dst, src);
+				dst += tlv->wire_size;
+				src += tlv->elem_size;
+			}
+		} else {
+			memcpy(dst, src, count * tlv->wire_size);
+		}
+
+		encoded_bytes += TLV_TYPE_SIZE + TLV_LEN_SIZE + payload;
+	}
+
+	return encoded_bytes;
+}
+
+/**
+ * qmi_plan_decode() - Decode a message using its compiled plan
+ * @plan:	Compiled plan of the message
+ * @out_c_struct: Buffer to hold the decoded C struct
+ * @in_buf:	Buffer containing the QMI message to be decoded
+ * @in_buf_len:	Length of the QMI message to be decoded
+ *
+ * Return: The number of bytes of decoded information, or negative errno if
+ * the message has to be handed to the interpreter.
+ */
+static int qmi_plan_decode(const struct qmi_plan *plan, void *out_c_struct,
+			   const u8 *in_buf, u32 in_buf_len)
+{
+	const struct qmi_plan_tlv *tlv;
+	u32 tlv_type, tlv_len;
+	u32 decoded_bytes = 0;
+	u32 data_len, count, i;
+	const u8 *src;
+	u8 *dst;
+
+	while (decoded_bytes < in_buf_len) {
+		if (in_buf_len - decoded_bytes < TLV_TYPE_SIZE + TLV_LEN_SIZE)
+			return -EFAULT;
+
+		src = in_buf + decoded_bytes;
+		QMI_ENCDEC_DECODE_TLV(&tlv_type, &tlv_len, src);
+		decoded_bytes += TLV_TYPE_SIZE + TLV_LEN_SIZE;
+		src = in_buf + decoded_bytes;
+		if (tlv_len > in_buf_len - decoded_bytes)
+			return -EFAULT;
+		decoded_bytes += tlv_len;
+
+		if (!plan->index[tlv_type]) {
+			if (tlv_type < OPTIONAL_TLV_TYPE_START)
+				return -EINVAL;
+			continue;
+		}
+		tlv = &plan->tlvs[plan->index[tlv_type] - 1];
+
+		if (tlv->kind == QMI_PLAN_STRING) {
+			if (tlv_len >= tlv->elem_len)
+				return -ETOOSMALL;
+		} else if (tlv->len_sz) {
+			if (tlv_len < tlv->len_sz)
+				return -EFAULT;
+			data_len = 0;
+			memcpy(&data_len, src, tlv->len_sz);
+			if (data_len > tlv->elem_len ||
+			    tlv_len - tlv->len_sz != data_len * tlv->wire_size)
+				return -EFAULT;
+		} else if (tlv_len != tlv->elem_len * tlv->wire_size) {
+			return -EFAULT;
+		}
+
+		if (tlv->has_opt)
+			*(u8 *)(out_c_struct + tlv->opt_offset) = 1;
+
+		dst = out_c_struct + tlv->offset;
+		switch (tlv->kind) {
+		case QMI_PLAN_STRING:
+			memcpy(dst, src, tlv_len);
+			dst[tlv_len] = '\0';
+			break;
+		case QMI_PLAN_BASIC:
+			if (tlv->len_sz) {
+				memcpy(out_c_struct + tlv->len_offset,
+				       &data_len, sizeof(u32));
+				src += tlv->len_sz;
+				tlv_len -= tlv->len_sz;
+			}
+			memcpy(dst, src, tlv_len);
+			break;
+		case QMI_PLAN_STRUCT:
+			count = tlv->elem_len;
+			if (tlv->len_sz) {
+				memcpy(out_c_struct + tlv->len_offset,
+				       &data_len, sizeof(u32));
+				src += tlv->len_sz;
+				count = data_len;
+			}
+			for (i = 0; i < count; i++) {
+				qmi_plan_unpack(tlv, dst, src);
+				src += tlv->wire_size;
+				dst += tlv->elem_size;
+			}
+			break;
+		}
+	}
+
+	return decoded_bytes;
+}
+
+/*
+ * Run the compiled plan of @ei, if there is one, before falling back to the
+ * interpreter. The caller must hold the RCU read lock.
+ */
+static int qmi_plan_run_encode(const struct qmi_elem_info *ei, void *out_buf,
+			       const void *in_c_struct, u32 out_buf_len)
+{
+	const struct qmi_plan *plan;
+
+	if (!ei)
+		return -EINVAL;
+
+	plan = qmi_plan_get(ei);
+	if (!plan)
+		return -EINVAL;
+
+	return qmi_plan_encode(plan, out_buf, in_c_struct, out_buf_len);
+}
+
+static int qmi_plan_run_decode(const struct qmi_elem_info *ei,
+			       void *out_c_struct, const void *in_buf,
+			       u32 in_buf_len)
+{
+	const struct qmi_plan *plan;
+
+	plan = qmi_plan_get(ei);
+	if (!plan)
+		return -EINVAL;
+
+	return qmi_plan_decode(plan, out_c_struct, in_buf, in_buf_len);
+}
+
+static int qmi_plans_module_notify(struct notifier_block *nb,
+				   unsigned long action, void *data)
+{
+	struct module *mod = data;
+	struct hlist_node *tmp;
+	struct qmi_plan *plan;
+	unsigned long flags;
+	int bkt;
+
+	if (action != MODULE_STATE_GOING)
+		return NOTIFY_DONE;
+
+	spin_lock_irqsave(&qmi_plans_lock, flags);
+	hash_for_each_safe(qmi_plans, bkt, tmp, plan, node) {
+		if (within_module((unsigned long)plan->ei, mod)) {
+			hash_del_rcu(&plan->node);
+			kfree_rcu(plan, rcu);
+		}
+	}
+	spin_unlock_irqrestore(&qmi_plans_lock, flags);
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block qmi_plans_module_nb = {
+	.notifier_call = qmi_plans_module_notify,
+};
+
+/*
+ * qmi_encode_message() with the compiled plans explicitly used or not, so
+ * that the tests can compare both without affecting other users.
+ */
+VISIBLE_IF_KUNIT void *__qmi_encode_message(int type, unsigned int msg_id,
+					    size_t *len, unsigned int txn_id,
+					    const struct qmi_elem_info *ei,
+					    const void *c_struct, bool use_plans)
 {
 	struct qmi_header *hdr;
 	ssize_t msglen = 0;
@@ -737,7 +1306,16 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 
 	/* Encode message, if we have a message */
 	if (c_struct) {
-		msglen = qmi_encode(ei, msg + sizeof(*hdr), c_struct, *len, 1);
+		msglen = -EINVAL;
+		if (use_plans) {
+			rcu_read_lock();
+			msglen = qmi_plan_run_encode(ei, msg + sizeof(*hdr),
+						     c_struct, *len);
+			rcu_read_unlock();
+		}
+		if (msglen < 0)
+			msglen = qmi_encode(ei, msg + sizeof(*hdr), c_struct,
+					    *len, 1);
 		if (msglen < 0) {
 			kfree(msg);
 			return ERR_PTR(msglen);
@@ -754,8 +1332,56 @@ void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
 
 	return msg;
 }
+EXPORT_SYMBOL_IF_KUNIT(__qmi_encode_message);
+
+/**
+ * qmi_encode_message() - Encode C structure as QMI encoded message
+ * @type:	Type of QMI message
+ * @msg_id:	Message ID of the message
+ * @len:	Passed as max length of the message, updated to actual size
+ * @txn_id:	Transaction ID
+ * @ei:		QMI message descriptor
+ * @c_struct:	Reference to structure to encode
+ *
+ * Return: Buffer with encoded message, or negative ERR_PTR() on error
+ */
+void *qmi_encode_message(int type, unsigned int msg_id, size_t *len,
+			 unsigned int txn_id, const struct qmi_elem_info *ei,
+			 const void *c_struct)
+{
+	return __qmi_encode_message(type, msg_id, len, txn_id, ei, c_struct,
+				    READ_ONCE(qmi_encdec_use_plans));
+}
 EXPORT_SYMBOL_GPL(qmi_encode_message);
 
+/* qmi_decode_message() with the compiled plans explicitly used or not */
+VISIBLE_IF_KUNIT int __qmi_decode_message(const void *buf, size_t len,
+					  const struct qmi_elem_info *ei,
+					  void *c_struct, bool use_plans)
+{
+	int ret;
+
+	if (!ei)
+		return -EINVAL;
+
+	if (!c_struct || !buf || !len)
+		return -EINVAL;
+
+	if (use_plans) {
+		rcu_read_lock();
+		ret = qmi_plan_run_decode(ei, c_struct,
+					  buf + sizeof(struct qmi_header),
+					  len - sizeof(struct qmi_header));
+		rcu_read_unlock();
+		if (ret >= 0)
+			return ret;
+	}
+
+	return qmi_decode(ei, c_struct, buf + sizeof(struct qmi_header),
+			  len - sizeof(struct qmi_header), 1);
+}
+EXPORT_SYMBOL_IF_KUNIT(__qmi_decode_message);
+
 /**
  * qmi_decode_message() - Decode QMI encoded message to C structure
  * @buf:	Buffer with encoded message
@@ -769,14 +1395,8 @@ EXPORT_SYMBOL_GPL(qmi_encode_message);
 int qmi_decode_message(const void *buf, size_t len,
 		       const struct qmi_elem_info *ei, void *c_struct)
 {
-	if (!ei)
-		return -EINVAL;
-
-	if (!c_struct || !buf || !len)
-		return -EINVAL;
-
-	return qmi_decode(ei, c_struct, buf + sizeof(struct qmi_header),
-			  len - sizeof(struct qmi_header), 1);
+	return __qmi_decode_message(buf, len, ei, c_struct,
+				    READ_ONCE(qmi_encdec_use_plans));
 }
 EXPORT_SYMBOL_GPL(qmi_decode_message);
 
@@ -812,5 +1432,26 @@ const struct qmi_elem_info qmi_response_type_v01_ei[] = {
 };
 EXPORT_SYMBOL_GPL(qmi_response_type_v01_ei);
 
+static int __init qmi_encdec_init(void)
+{
+	return register_module_notifier(&qmi_plans_module_nb);
+}
+module_init(qmi_encdec_init);
+
+static void __exit qmi_encdec_exit(void)
+{
+	struct hlist_node *tmp;
+	struct qmi_plan *plan;
+	int bkt;
+
+	unregister_module_notifier(&qmi_plans_module_nb);
+
+	hash_for_each_safe(qmi_plans, bkt, tmp, plan, node) {
+		hash_del(&plan->node);
+		kfree(plan);
+	}
+}
+module_exit(qmi_encdec_exit);
+
 MODULE_DESCRIPTION("QMI encoder/decoder helper");
 MODULE_LICENSE("GPL v2");
@@ -0,0 +1,18 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __QMI_ENCDEC_H__
+#define __QMI_ENCDEC_H__
+
+#include <linux/types.h>
+
+struct qmi_elem_info;
+
+#if IS_ENABLED(CONFIG_KUNIT)
+void *__qmi_encode_message(int type, unsigned int msg_id, size_t *len,
+			   unsigned int txn_id, const struct qmi_elem_info *ei,
+			   const void *c_struct, bool use_plans);
+int __qmi_decode_message(const void *buf, size_t len,
+			 const struct qmi_elem_info *ei, void *c_struct,
+			 bool use_plans);
+#endif
+
+#endif
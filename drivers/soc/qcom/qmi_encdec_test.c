@@ -0,0 +1,379 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * KUnit tests for the QMI encoder/decoder, checking that the compiled plans
+ * produce the same results as the element info interpreter and comparing
+ * the cost of the two.
+ */
+#include <kunit/test.h>
+#include <kunit/visibility.h>
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/slab.h>
+#include <linux/soc/qcom/qmi.h>
+
+#include "qmi_encdec.h"
+
+MODULE_IMPORT_NS(EXPORTED_FOR_KUNIT_TESTING);
+
+#define TEST_NAME_LEN		32
+#define TEST_DATA_LEN		64
+#define TEST_ENTRIES_LEN	8
+#define TEST_MSG_MAX_LEN	512
+
+#define BENCH_ITERATIONS	10000
+
+struct test_entry {
+	u32 id;
+	u16 flags;
+	u16 extra;
+	u64 cookie;
+};
+
+static const struct qmi_elem_info test_entry_ei[] = {
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct test_entry, id),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u16),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct test_entry, flags),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_2_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u16),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct test_entry, extra),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_8_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u64),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0,
+		.offset		= offsetof(struct test_entry, cookie),
+	},
+	{}
+};
+
+struct test_msg {
+	struct qmi_response_type_v01 resp;
+	u32 instance;
+	u8 mode_valid;
+	u8 mode;
+	u8 data_valid;
+	u32 data_len;
+	u8 data[TEST_DATA_LEN];
+	u8 entries_valid;
+	u32 entries_len;
+	struct test_entry entries[TEST_ENTRIES_LEN];
+	u8 name_valid;
+	char name[TEST_NAME_LEN + 1];
+};
+
+static const struct qmi_elem_info test_msg_ei[] = {
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= 1,
+		.elem_size	= sizeof(struct qmi_response_type_v01),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x02,
+		.offset		= offsetof(struct test_msg, resp),
+		.ei_array	= qmi_response_type_v01_ei,
+	},
+	{
+		.data_type	= QMI_UNSIGNED_4_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u32),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x03,
+		.offset		= offsetof(struct test_msg, instance),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_msg, mode_valid),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x10,
+		.offset		= offsetof(struct test_msg, mode),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_msg, data_valid),
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_msg, data_len),
+	},
+	{
+		.data_type	= QMI_UNSIGNED_1_BYTE,
+		.elem_len	= TEST_DATA_LEN,
+		.elem_size	= sizeof(u8),
+		.array_type	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x11,
+		.offset		= offsetof(struct test_msg, data),
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_msg, entries_valid),
+	},
+	{
+		.data_type	= QMI_DATA_LEN,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_msg, entries_len),
+	},
+	{
+		.data_type	= QMI_STRUCT,
+		.elem_len	= TEST_ENTRIES_LEN,
+		.elem_size	= sizeof(struct test_entry),
+		.array_type	= VAR_LEN_ARRAY,
+		.tlv_type	= 0x12,
+		.offset		= offsetof(struct test_msg, entries),
+		.ei_array	= test_entry_ei,
+	},
+	{
+		.data_type	= QMI_OPT_FLAG,
+		.elem_len	= 1,
+		.elem_size	= sizeof(u8),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x13,
+		.offset		= offsetof(struct test_msg, name_valid),
+	},
+	{
+		.data_type	= QMI_STRING,
+		.elem_len	= TEST_NAME_LEN + 1,
+		.elem_size	= sizeof(char),
+		.array_type	= NO_ARRAY,
+		.tlv_type	= 0x13,
+		.offset		= offsetof(struct test_msg, name),
+	},
+	{}
+};
+
+static void test_msg_fill(struct test_msg *msg)
+{
+	int i;
+
+	memset(msg, 0, sizeof(*msg));
+	msg->resp.result = QMI_RESULT_SUCCESS_V01;
+	msg->resp.error = QMI_ERR_NONE_V01;
+	msg->instance = 0x12345678;
+	msg->mode_valid = 1;
+	msg->mode = 3;
+	msg->data_valid = 1;
+	msg->data_len = 40;
+	for (i = 0; i < msg->data_len; i++)
+		msg->data[i] = i * 7;
+	msg->entries_valid = 1;
+	msg->entries_len = 5;
+	for (i = 0; i < msg->entries_len; i++) {
+		msg->entries[i].id = i + 1;
+		msg->entries[i].flags = 0x8000 | i;
+		msg->entries[i].extra = ~i;
+		msg->entries[i].cookie = 0x0123456789abcdefULL * (i + 1);
+	}
+	msg->name_valid = 1;
+	strscpy(msg->name, "qmi-encdec-test", sizeof(msg->name));
+}
+
+static void *test_encode(bool use_plans, const struct test_msg *msg,
+			 size_t *len)
+{
+	void *buf;
+
+	*len = TEST_MSG_MAX_LEN;
+	buf = __qmi_encode_message(QMI_RESPONSE, 0x20, len, 1, test_msg_ei,
+				   msg, use_plans);
+
+	return buf;
+}
+
+static int test_decode(bool use_plans, const void *buf, size_t len,
+		       struct test_msg *msg)
+{
+	int ret;
+
+	memset(msg, 0, sizeof(*msg));
+	ret = __qmi_decode_message(buf, len, test_msg_ei, msg, use_plans);
+
+	return ret;
+}
+
+static void qmi_encdec_test_roundtrip(struct kunit *test)
+{
+	struct test_msg *msg, *plan_out, *interp_out;
+	size_t plan_len, interp_len;
+	void *plan_buf, *interp_buf;
+	int i;
+
+	msg = kunit_kzalloc(test, sizeof(*msg), GFP_KERNEL);
+	plan_out = kunit_kzalloc(test, sizeof(*plan_out), GFP_KERNEL);
+	interp_out = kunit_kzalloc(test, sizeof(*interp_out), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, msg);
+	KUNIT_ASSERT_NOT_NULL(test, plan_out);
+	KUNIT_ASSERT_NOT_NULL(test, interp_out);
+
+	test_msg_fill(msg);
+
+	/* Exercise every optional element being left out as well */
+	for (i = 0; i < 5; i++) {
+		if (i == 1)
+			msg->mode_valid = 0;
+		if (i == 2)
+			msg->data_len = 0;
+		if (i == 3)
+			msg->entries_valid = 0;
+		if (i == 4)
+			msg->name_valid = 0;
+
+		plan_buf = test_encode(true, msg, &plan_len);
+		interp_buf = test_encode(false, msg, &interp_len);
+		KUNIT_ASSERT_FALSE(test, IS_ERR(plan_buf));
+		KUNIT_ASSERT_FALSE(test, IS_ERR(interp_buf));
+
+		KUNIT_EXPECT_EQ(test, plan_len, interp_len);
+		KUNIT_EXPECT_MEMEQ(test, plan_buf, interp_buf, interp_len);
+
+		KUNIT_EXPECT_EQ(test, test_decode(true, interp_buf,
+						  interp_len, plan_out),
+				test_decode(false, interp_buf,
+					    interp_len, interp_out));
+		KUNIT_EXPECT_MEMEQ(test, plan_out, interp_out,
+				   sizeof(*plan_out));
+
+		kfree(plan_buf);
+		kfree(interp_buf);
+	}
+}
+
+static void qmi_encdec_test_malformed(struct kunit *test)
+{
+	struct test_msg *msg, *out;
+	size_t len;
+	u8 *buf;
+
+	msg = kunit_kzalloc(test, sizeof(*msg), GFP_KERNEL);
+	out = kunit_kzalloc(test, sizeof(*out), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, msg);
+	KUNIT_ASSERT_NOT_NULL(test, out);
+
+	test_msg_fill(msg);
+
+	/* Too long variable array must be refused on both paths */
+	msg->data_len = TEST_DATA_LEN + 1;
+	buf = test_encode(true, msg, &len);
+	KUNIT_EXPECT_EQ(test, PTR_ERR(buf), -EINVAL);
+	buf = test_encode(false, msg, &len);
+	KUNIT_EXPECT_EQ(test, PTR_ERR(buf), -EINVAL);
+
+	/* As must a message that does not fit the buffer */
+	msg->data_len = TEST_DATA_LEN;
+	len = 16;
+	buf = qmi_encode_message(QMI_RESPONSE, 0x20, &len, 1, test_msg_ei, msg);
+	KUNIT_EXPECT_EQ(test, PTR_ERR(buf), -ETOOSMALL);
+
+	/* Unknown mandatory TLV */
+	buf = test_encode(false, msg, &len);
+	KUNIT_ASSERT_FALSE(test, IS_ERR(buf));
+	buf[sizeof(struct qmi_header)] = 0x01;
+	KUNIT_EXPECT_EQ(test, test_decode(true, buf, len, out), -EINVAL);
+	KUNIT_EXPECT_EQ(test, test_decode(false, buf, len, out), -EINVAL);
+	kfree(buf);
+}
+
+static void qmi_encdec_test_bench(struct kunit *test)
+{
+	u64 start, enc_ns[2], dec_ns[2];
+	struct test_msg *msg, *out;
+	void *buf;
+	size_t len;
+	int mode, i;
+
+	msg = kunit_kzalloc(test, sizeof(*msg), GFP_KERNEL);
+	out = kunit_kzalloc(test, sizeof(*out), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_NULL(test, msg);
+	KUNIT_ASSERT_NOT_NULL(test, out);
+
+	test_msg_fill(msg);
+
+	/* mode 0 runs the interpreter, mode 1 the compiled plan */
+	for (mode = 0; mode < 2; mode++) {
+		buf = test_encode(mode, msg, &len);
+		KUNIT_ASSERT_FALSE(test, IS_ERR(buf));
+		kfree(buf);
+
+		start = ktime_get_ns();
+		for (i = 0; i < BENCH_ITERATIONS; i++) {
+			buf = test_encode(mode, msg, &len);
+			kfree(buf);
+		}
+		enc_ns[mode] = ktime_get_ns() - start;
+
+		buf = test_encode(mode, msg, &len);
+		KUNIT_ASSERT_FALSE(test, IS_ERR(buf));
+
+		start = ktime_get_ns();
+		for (i = 0; i < BENCH_ITERATIONS; i++)
+			test_decode(mode, buf, len, out);
+		dec_ns[mode] = ktime_get_ns() - start;
+
+		kfree(buf);
+	}
+
+	kunit_info(test, "encode: interpreter %llu ns/msg, plan %llu ns/msg\n",
+		   div_u64(enc_ns[0], BENCH_ITERATIONS),
+		   div_u64(enc_ns[1], BENCH_ITERATIONS));
+	kunit_info(test, "decode: interpreter %llu ns/msg, plan %llu ns/msg\n",
+		   div_u64(dec_ns[0], BENCH_ITERATIONS),
+		   div_u64(dec_ns[1], BENCH_ITERATIONS));
+}
+
+static struct kunit_case qmi_encdec_test_cases[] = {
+	KUNIT_CASE(qmi_encdec_test_roundtrip),
+	KUNIT_CASE(qmi_encdec_test_malformed),
+	KUNIT_CASE_SLOW(qmi_encdec_test_bench),
+	{}
+};
+
+static struct kunit_suite qmi_encdec_test_suite = {
+	.name = "qmi_encdec",
+	.test_cases = qmi_encdec_test_cases,
+};
+kunit_test_suite(qmi_encdec_test_suite);
+
+MODULE_DESCRIPTION("KUnit tests for the QMI encoder/decoder");
+MODULE_LICENSE("GPL");
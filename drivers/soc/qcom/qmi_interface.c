@@ -9,12 +9,50 @@
 #include <linux/net.h>
 #include <linux/completion.h>
 #include <linux/idr.h>
+#include <linux/jhash.h>
+#include <linux/slab.h>
 #include <linux/string.h>
 #include <net/sock.h>
 #include <linux/workqueue.h>
 #include <trace/events/sock.h>
 #include <linux/soc/qcom/qmi.h>
 
+#define QMI_LANE_DEPTH	4
+
+/**
+ * struct qmi_lane_msg - message queued on a dispatch lane
+ * @sq:		sockaddr of the sender
+ * @len:	length of the message in @buf
+ * @buf:	preallocated copy of the message, of the handle's recv_buf_size
+ */
+struct qmi_lane_msg {
+	struct sockaddr_qrtr sq;
+	size_t len;
+	void *buf;
+};
+
+/**
+ * struct qmi_lane - in-order handling of messages from a subset of senders
+ * @qmi:	QMI handle the lane belongs to
+ * @work:	work handling the queued messages
+ * @lock:	protects @head and @tail
+ * @head:	index of the next slot in @msgs to fill
+ * @tail:	index of the next slot in @msgs to handle
+ * @decode_buf:	buffer to decode messages into, same size as the handle's
+ * @msgs:	ring of preallocated message slots
+ */
+struct qmi_lane {
+	struct qmi_handle *qmi;
+	struct work_struct work;
+
+	spinlock_t lock;
+	unsigned int head;
+	unsigned int tail;
+
+	void *decode_buf;
+	struct qmi_lane_msg msgs[QMI_LANE_DEPTH];
+};
+
 static struct socket *qmi_sock_create(struct qmi_handle *qmi,
 				      struct sockaddr_qrtr *sq);
 
@@ -384,18 +422,20 @@ EXPORT_SYMBOL_GPL(qmi_txn_cancel);
  * @txn:	transaction object for the message
  * @buf:	buffer containing the message
  * @len:	length of @buf
+ * @dest:	preallocated buffer to decode the message into
  *
- * Find handler and invoke handler for the incoming message.
+ * Find handler and invoke handler for the incoming message. @dest must be at
+ * least as large as the largest decoded_size of the handle's handlers.
  */
 static void qmi_invoke_handler(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
-			       struct qmi_txn *txn, const void *buf, size_t len)
+			       struct qmi_txn *txn, const void *buf, size_t len,
+			       void *dest)
 {
 	const struct qmi_msg_handler *handler;
 	const struct qmi_header *hdr = buf;
-	void *dest;
 	int ret;
 
-	if (!qmi->handlers)
+	if (!qmi->handlers || !dest)
 		return;
 
 	for (handler = qmi->handlers; handler->fn; handler++) {
@@ -407,17 +447,13 @@ static void qmi_invoke_handler(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
 	if (!handler->fn)
 		return;
 
-	dest = kzalloc(handler->decoded_size, GFP_KERNEL);
-	if (!dest)
-		return;
+	memset(dest, 0, handler->decoded_size);
 
 	ret = qmi_decode_message(buf, len, handler->ei, dest);
 	if (ret < 0)
 		pr_err("failed to decode incoming message\n");
 	else
 		handler->fn(qmi, sq, txn, dest);
-
-	kfree(dest);
 }
 
 /**
@@ -471,7 +507,7 @@ static void qmi_handle_net_reset(struct qmi_handle *qmi)
 
 static void qmi_handle_message(struct qmi_handle *qmi,
 			       struct sockaddr_qrtr *sq,
-			       const void *buf, size_t len)
+			       const void *buf, size_t len, void *decode_buf)
 {
 	const struct qmi_header *hdr;
 	struct qmi_txn tmp_txn;
@@ -507,7 +543,7 @@ static void qmi_handle_message(struct qmi_handle *qmi,
 			txn->result = ret;
 			complete(&txn->completion);
 		} else  {
-			qmi_invoke_handler(qmi, sq, txn, buf, len);
+			qmi_invoke_handler(qmi, sq, txn, buf, len, decode_buf);
 		}
 
 		mutex_unlock(&txn->lock);
@@ -516,8 +552,132 @@ static void qmi_handle_message(struct qmi_handle *qmi,
 		memset(&tmp_txn, 0, sizeof(tmp_txn));
 		tmp_txn.id = hdr->txn_id;
 
-		qmi_invoke_handler(qmi, sq, &tmp_txn, buf, len);
+		qmi_invoke_handler(qmi, sq, &tmp_txn, buf, len, decode_buf);
+	}
+}
+
+static void qmi_lane_work(struct work_struct *work)
+{
+	struct qmi_lane *lane = container_of(work, struct qmi_lane, work);
+	struct qmi_lane_msg *msg;
+
+	spin_lock(&lane->lock);
+	while (lane->tail != lane->head) {
+		msg = &lane->msgs[lane->tail % QMI_LANE_DEPTH];
+		spin_unlock(&lane->lock);
+
+		qmi_handle_message(lane->qmi, &msg->sq, msg->buf, msg->len,
+				   lane->decode_buf);
+
+		spin_lock(&lane->lock);
+		lane->tail++;
+	}
+	spin_unlock(&lane->lock);
+}
+
+/*
+ * Messages are spread over the lanes by sender, so that messages from one
+ * sender are still handled in the order they were received, while a slow
+ * handler only holds up the senders sharing its lane.
+ */
+static void qmi_lane_queue(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
+			   const void *buf, size_t len)
+{
+	struct qmi_lane *lane;
+	struct qmi_lane_msg *msg;
+	u32 idx;
+
+	idx = jhash_2words(sq->sq_node, sq->sq_port, 0) % qmi->nr_lanes;
+	lane = &qmi->lanes[idx];
+
+	spin_lock(&lane->lock);
+	while (lane->head - lane->tail == QMI_LANE_DEPTH) {
+		spin_unlock(&lane->lock);
+		/* Wait for the lane rather than reorder its messages */
+		flush_work(&lane->work);
+		spin_lock(&lane->lock);
+	}
+	msg = &lane->msgs[lane->head % QMI_LANE_DEPTH];
+	spin_unlock(&lane->lock);
+
+	/* The slot at head is not visible to the lane until head moves */
+	memcpy(msg->buf, buf, len);
+	msg->sq = *sq;
+	msg->len = len;
+
+	spin_lock(&lane->lock);
+	lane->head++;
+	spin_unlock(&lane->lock);
+
+	queue_work(qmi->wq, &lane->work);
+}
+
+static void qmi_lanes_flush(struct qmi_handle *qmi)
+{
+	unsigned int i;
+
+	for (i = 0; i < qmi->nr_lanes; i++)
+		flush_work(&qmi->lanes[i].work);
+}
+
+static void qmi_lanes_free(struct qmi_handle *qmi)
+{
+	struct qmi_lane *lane;
+	unsigned int i, j;
+
+	if (!qmi->lanes)
+		return;
+
+	for (i = 0; i < qmi->nr_lanes; i++) {
+		lane = &qmi->lanes[i];
+		for (j = 0; j < QMI_LANE_DEPTH; j++)
+			kfree(lane->msgs[j].buf);
+		kfree(lane->decode_buf);
+	}
+
+	kfree(qmi->lanes);
+	qmi->lanes = NULL;
+}
+
+static int qmi_lanes_alloc(struct qmi_handle *qmi, unsigned int nr_lanes)
+{
+	struct qmi_lane *lane;
+	unsigned int i, j;
+
+	qmi->lanes = kcalloc(nr_lanes, sizeof(*qmi->lanes), GFP_KERNEL);
+	if (!qmi->lanes)
+		return -ENOMEM;
+
+	qmi->nr_lanes = nr_lanes;
+
+	for (i = 0; i < nr_lanes; i++) {
+		lane = &qmi->lanes[i];
+		lane->qmi = qmi;
+		INIT_WORK(&lane->work, qmi_lane_work);
+		spin_lock_init(&lane->lock);
+
+		if (qmi->handlers) {
+			lane->decode_buf = kzalloc(qmi->decode_buf_size,
+						   GFP_KERNEL);
+			if (!lane->decode_buf)
+				goto err_free_lanes;
+		}
+
+		for (j = 0; j < QMI_LANE_DEPTH; j++) {
+			lane->msgs[j].buf = kzalloc(qmi->recv_buf_size,
+						    GFP_KERNEL);
+			if (!lane->msgs[j].buf)
+				goto err_free_lanes;
+		}
 	}
+
+	return 0;
+
+err_free_lanes:
+	qmi_lanes_free(qmi);
+	qmi->nr_lanes = 0;
+
+	return -ENOMEM;
 }
 
 static void qmi_data_ready_work(struct work_struct *work)
@@ -544,6 +704,7 @@ static void qmi_data_ready_work(struct work_struct *work)
 			break;
 
 		if (msglen == -ENETRESET) {
+			qmi_lanes_flush(qmi);
 			qmi_handle_net_reset(qmi);
 
 			/* The old qmi->sock is gone, our work is done */
@@ -557,11 +718,16 @@ static void qmi_data_ready_work(struct work_struct *work)
 
 		if (sq.sq_node == qmi->sq.sq_node &&
 		    sq.sq_port == QRTR_PORT_CTRL) {
+			/* Deliver earlier messages before servers go away */
+			qmi_lanes_flush(qmi);
 			qmi_recv_ctrl_pkt(qmi, qmi->recv_buf, msglen);
 		} else if (ops->msg_handler) {
 			ops->msg_handler(qmi, &sq, qmi->recv_buf, msglen);
+		} else if (qmi->nr_lanes) {
+			qmi_lane_queue(qmi, &sq, qmi->recv_buf, msglen);
 		} else {
-			qmi_handle_message(qmi, &sq, qmi->recv_buf, msglen);
+			qmi_handle_message(qmi, &sq, qmi->recv_buf, msglen,
+					   qmi->decode_buf);
 		}
 	}
 }
@@ -607,21 +773,29 @@ static struct socket *qmi_sock_create(struct qmi_handle *qmi,
 }
 
 /**
- * qmi_handle_init() - initialize a QMI client handle
+ * qmi_handle_init_concurrent() - initialize a QMI handle with concurrent
+ *				  message handling
  * @qmi:	QMI handle to initialize
  * @recv_buf_size: maximum size of incoming message
  * @ops:	reference to callbacks for QRTR notifications
  * @handlers:	NULL-terminated list of QMI message handlers
+ * @nr_lanes:	number of lanes to handle messages on, 0 for in-order handling
  *
- * This initializes the QMI client handle to allow sending and receiving QMI
- * messages. As messages are received the appropriate handler will be invoked.
+ * Like qmi_handle_init(), but with @nr_lanes non-zero incoming messages are
+ * spread by sender over @nr_lanes lanes that are handled concurrently.
+ * Messages from one sender are still handled in order and all lanes are
+ * drained before control messages, such as the removal of a server, are
+ * handled. The handlers must cope with being invoked concurrently for
+ * different senders.
  *
  * Return: 0 on success, negative errno on failure.
  */
-int qmi_handle_init(struct qmi_handle *qmi, size_t recv_buf_size,
-		    const struct qmi_ops *ops,
-		    const struct qmi_msg_handler *handlers)
+int qmi_handle_init_concurrent(struct qmi_handle *qmi, size_t recv_buf_size,
+			       const struct qmi_ops *ops,
+			       const struct qmi_msg_handler *handlers,
+			       unsigned int nr_lanes)
 {
+	const struct qmi_msg_handler *handler;
 	int ret;
 
 	mutex_init(&qmi->txn_lock);
@@ -650,10 +824,36 @@ int qmi_handle_init(struct qmi_handle *qmi, size_t recv_buf_size,
 	if (!qmi->recv_buf)
 		return -ENOMEM;
 
-	qmi->wq = alloc_ordered_workqueue("qmi_msg_handler", 0);
+	/* Decode into a buffer that fits any handler, rather than per message */
+	qmi->decode_buf_size = 0;
+	for (handler = handlers; handler && handler->fn; handler++)
+		qmi->decode_buf_size = max(qmi->decode_buf_size,
+					   handler->decoded_size);
+
+	qmi->decode_buf = NULL;
+	if (handlers) {
+		qmi->decode_buf = kzalloc(qmi->decode_buf_size, GFP_KERNEL);
+		if (!qmi->decode_buf) {
+			ret = -ENOMEM;
+			goto err_free_recv_buf;
+		}
+	}
+
+	qmi->lanes = NULL;
+	qmi->nr_lanes = 0;
+	if (nr_lanes) {
+		ret = qmi_lanes_alloc(qmi, nr_lanes);
+		if (ret)
+			goto err_free_decode_buf;
+
+		/* The receive work itself is never run concurrently */
+		qmi->wq = alloc_workqueue("qmi_msg_handler", WQ_UNBOUND, 0);
+	} else {
+		qmi->wq = alloc_ordered_workqueue("qmi_msg_handler", 0);
+	}
 	if (!qmi->wq) {
 		ret = -ENOMEM;
-		goto err_free_recv_buf;
+		goto err_free_lanes;
 	}
 
 	qmi->sock = qmi_sock_create(qmi, &qmi->sq);
@@ -671,11 +871,35 @@ int qmi_handle_init(struct qmi_handle *qmi, size_t recv_buf_size,
 
 err_destroy_wq:
 	destroy_workqueue(qmi->wq);
+err_free_lanes:
+	qmi_lanes_free(qmi);
+err_free_decode_buf:
+	kfree(qmi->decode_buf);
 err_free_recv_buf:
 	kfree(qmi->recv_buf);
 
 	return ret;
 }
+EXPORT_SYMBOL_GPL(qmi_handle_init_concurrent);
+
+/**
+ * qmi_handle_init() - initialize a QMI client handle
+ * @qmi:	QMI handle to initialize
+ * @recv_buf_size: maximum size of incoming message
+ * @ops:	reference to callbacks for QRTR notifications
+ * @handlers:	NULL-terminated list of QMI message handlers
+ *
+ * This initializes the QMI client handle to allow sending and receiving QMI
+ * messages. As messages are received the appropriate handler will be invoked.
+ *
+ * Return: 0 on success, negative errno on failure.
+ */
+int qmi_handle_init(struct qmi_handle *qmi, size_t recv_buf_size,
+		    const struct qmi_ops *ops,
+		    const struct qmi_msg_handler *handlers)
+{
+	return qmi_handle_init_concurrent(qmi, recv_buf_size, ops, handlers, 0);
+}
 EXPORT_SYMBOL_GPL(qmi_handle_init);
 
 /**
@@ -688,9 +912,12 @@ void qmi_handle_release(struct qmi_handle *qmi)
 {
 	struct socket *sock = qmi->sock;
 	struct qmi_service *svc, *tmp;
+	unsigned int i;
 
 	sock->sk->sk_user_data = NULL;
 	cancel_work_sync(&qmi->work);
+	for (i = 0; i < qmi->nr_lanes; i++)
+		cancel_work_sync(&qmi->lanes[i].work);
 
 	qmi_recv_del_server(qmi, -1, -1);
 
@@ -703,6 +930,8 @@ void qmi_handle_release(struct qmi_handle *qmi)
 
 	idr_destroy(&qmi->txns);
 
+	qmi_lanes_free(qmi);
+	kfree(qmi->decode_buf);
 	kfree(qmi->recv_buf);
 
 	/* Free registered lookup requests */
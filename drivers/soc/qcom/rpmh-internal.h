@@ -8,6 +8,8 @@
 #define __RPM_INTERNAL_H__
 
 #include <linux/bitmap.h>
+#include <linux/hashtable.h>
+#include <linux/list.h>
 #include <linux/wait.h>
 #include <soc/qcom/tcs.h>
 
@@ -16,8 +18,11 @@
 #define MAX_TCS_PER_TYPE		3
 #define MAX_TCS_NR			(MAX_TCS_PER_TYPE * TCS_TYPE_NR)
 #define MAX_TCS_SLOTS			(MAX_CMDS_PER_TCS * MAX_TCS_PER_TYPE)
+#define RPMH_CACHE_HASH_BITS		7
+#define RPMH_STATS_HASH_BITS		4
 
 struct rsc_drv;
+struct rpmh_client_stats;
 
 /**
  * struct tcs_group: group of Trigger Command Sets (TCS) to send state requests
@@ -52,6 +57,17 @@ struct tcs_group {
 	DECLARE_BITMAP(slots, MAX_TCS_SLOTS);
 };
 
+/**
+ * struct tcs_slot: location of a command in a sleep or wake TCS
+ *
+ * @tcs_id: The global ID of the TCS holding the command.
+ * @cmd_id: The index of the command within the TCS.
+ */
+struct tcs_slot {
+	int tcs_id;
+	int cmd_id;
+};
+
 /**
  * struct rpmh_request: the message to be sent to rpmh-rsc
  *
@@ -60,6 +76,10 @@ struct tcs_group {
  * @completion: triggered when request is done
  * @dev: the device making the request
  * @needs_free: check to free dynamically allocated request object
+ * @list: entry in the controller's pending list while waiting for a TCS
+ * @stats: accounting of the client making the request
+ * @submit_ns: time the request was passed to rpmh_rsc_send_data()
+ * @issue_ns: time the request was written to a TCS
  */
 struct rpmh_request {
 	struct tcs_request msg;
@@ -67,20 +87,28 @@ struct rpmh_request {
 	struct completion *completion;
 	const struct device *dev;
 	bool needs_free;
+	struct list_head list;
+	struct rpmh_client_stats *stats;
+	u64 submit_ns;
+	u64 issue_ns;
 };
 
 /**
  * struct rpmh_ctrlr: our representation of the controller
  *
- * @cache: the list of cached requests
+ * @cache: the cached requests, hashed by resource address
  * @cache_lock: synchronize access to the cache data
- * @dirty: was the cache updated since flush
+ * @dirty: sleep/wake TCSes must be invalidated and fully rewritten on the
+ *         next flush
+ * @dirty_list: cached requests that changed since the last flush and can be
+ *              updated in place without rewriting the whole sleep/wake set
  * @batch_cache: Cache sleep and wake requests sent as batch
  */
 struct rpmh_ctrlr {
-	struct list_head cache;
+	DECLARE_HASHTABLE(cache, RPMH_CACHE_HASH_BITS);
 	spinlock_t cache_lock;
 	bool dirty;
+	struct list_head dirty_list;
 	struct list_head batch_cache;
 };
 
@@ -112,10 +140,20 @@ struct rsc_ver {
  * @lock:               Synchronize state of the controller.  If RPMH's cache
  *                      lock will also be held, the order is: drv->lock then
  *                      cache_lock.
- * @tcs_wait:           Wait queue used to wait for @tcs_in_use to free up a
- *                      slot
+ * @pending:            ACTIVE_ONLY requests waiting for a TCS to free up, in
+ *                      submission order. Protected by @lock.
+ * @num_pending:        Number of requests on @pending.
+ * @max_pending:        High watermark of @num_pending.
+ * @total_queued:       Number of requests that had to wait on @pending.
+ * @tcs_issued:         Number of ACTIVE_ONLY transfers started on each TCS.
+ * @in_solver_mode:     Controller is in HW solver mode, so the AP never
+ *                      flushes sleep/wake sets and wake TCSes may be borrowed
+ *                      for active transfers.
  * @client:             Handle to the DRV's client.
  * @dev:                RSC device.
+ * @debugfs:            debugfs directory of this controller.
+ * @stats_lock:         Protects @stats.
+ * @stats:              Per-client request accounting, hashed by device.
  */
 struct rsc_drv {
 	const char *name;
@@ -129,20 +167,38 @@ struct rsc_drv {
 	struct tcs_group tcs[TCS_TYPE_NR];
 	DECLARE_BITMAP(tcs_in_use, MAX_TCS_NR);
 	spinlock_t lock;
-	wait_queue_head_t tcs_wait;
+	struct list_head pending;
+	unsigned int num_pending;
+	unsigned int max_pending;
+	u64 total_queued;
+	u64 tcs_issued[MAX_TCS_NR];
+	bool in_solver_mode;
 	struct rpmh_ctrlr client;
 	struct device *dev;
 	struct rsc_ver ver;
 	u32 *regs;
+	struct dentry *debugfs;
+	spinlock_t stats_lock;
+	DECLARE_HASHTABLE(stats, RPMH_STATS_HASH_BITS);
 };
 
 int rpmh_rsc_send_data(struct rsc_drv *drv, const struct tcs_request *msg);
+void rpmh_rsc_cancel(struct rsc_drv *drv, const struct tcs_request *msg);
 int rpmh_rsc_write_ctrl_data(struct rsc_drv *drv,
-			     const struct tcs_request *msg);
+			     const struct tcs_request *msg,
+			     struct tcs_slot *slot);
+void rpmh_rsc_update_ctrl_data(struct rsc_drv *drv,
+			       const struct tcs_request *msg,
+			       const struct tcs_slot *slot);
 void rpmh_rsc_invalidate(struct rsc_drv *drv);
 void rpmh_rsc_write_next_wakeup(struct rsc_drv *drv);
 
 void rpmh_tx_done(const struct tcs_request *msg);
+
+void rpmh_stats_init(struct rsc_drv *drv);
+struct rpmh_client_stats *rpmh_stats_get_client(struct rsc_drv *drv,
+						const struct device *dev);
+void rpmh_stats_record(const struct rpmh_request *rpm_msg);
 int rpmh_flush(struct rpmh_ctrlr *ctrlr);
 
 #endif /* __RPM_INTERNAL_H__ */
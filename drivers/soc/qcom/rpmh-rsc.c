@@ -8,6 +8,7 @@
 
 #include <linux/atomic.h>
 #include <linux/cpu_pm.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/interrupt.h>
 #include <linux/io.h>
@@ -16,6 +17,7 @@
 #include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/notifier.h>
 #include <linux/of.h>
 #include <linux/of_irq.h>
@@ -23,9 +25,10 @@
 #include <linux/platform_device.h>
 #include <linux/pm_domain.h>
 #include <linux/pm_runtime.h>
+#include <linux/seq_file.h>
+#include <linux/seqlock.h>
 #include <linux/slab.h>
 #include <linux/spinlock.h>
-#include <linux/wait.h>
 
 #include <clocksource/arm_arch_timer.h>
 #include <soc/qcom/cmd-db.h>
@@ -192,6 +195,8 @@ static u32 rpmh_rsc_reg_offset_ver_3_0[] = {
 	[RSC_DRV_CMD_RESP_DATA]		= 0x44,
 };
 
+static void rpmh_rsc_issue_pending(struct rsc_drv *drv);
+
 static inline void __iomem *
 tcs_reg_addr(const struct rsc_drv *drv, int reg, int tcs_id)
 {
@@ -443,11 +448,13 @@ static irqreturn_t tcs_tx_done(int irq, void *p)
 	int i;
 	unsigned long irq_status;
 	const struct tcs_request *req;
+	bool borrowed;
 
 	irq_status = readl_relaxed(drv->tcs_base + drv->regs[RSC_DRV_IRQ_STATUS]);
 
 	for_each_set_bit(i, &irq_status, BITS_PER_TYPE(u32)) {
 		req = get_req_from_tcs(drv, i);
+		borrowed = !(drv->tcs[ACTIVE_TCS].mask & BIT(i));
 		if (WARN_ON(!req))
 			goto skip;
 
@@ -458,7 +465,7 @@ static irqreturn_t tcs_tx_done(int irq, void *p)
 		 * votes, clear AMC trigger & enable modes and
 		 * disable interrupt for this TCS
 		 */
-		if (!drv->tcs[ACTIVE_TCS].num_tcs)
+		if (borrowed)
 			__tcs_set_trigger(drv, i, false);
 skip:
 		/* Reclaim the TCS */
@@ -471,14 +478,21 @@ static irqreturn_t tcs_tx_done(int irq, void *p)
 		 * spammed with interrupts coming when the solver
 		 * sends its wake votes.
 		 */
-		if (!drv->tcs[ACTIVE_TCS].num_tcs)
+		if (borrowed)
 			enable_tcs_irq(drv, i, false);
 		spin_unlock(&drv->lock);
-		wake_up(&drv->tcs_wait);
-		if (req)
+		if (req) {
+			rpmh_stats_record(container_of(req, struct rpmh_request,
+						       msg));
 			rpmh_tx_done(req);
+		}
 	}
 
+	/* Hand the TCSes freed up above to requests that were queued */
+	spin_lock(&drv->lock);
+	rpmh_rsc_issue_pending(drv);
+	spin_unlock(&drv->lock);
+
 	return IRQ_HANDLED;
 }
 
@@ -590,9 +604,37 @@ static int find_free_tcs(struct tcs_group *tcs)
 }
 
 /**
- * claim_tcs_for_req() - Claim a tcs in the given tcs_group; only for active.
+ * get_borrowable_tcs() - Get the wake tcs_group if it may carry active votes.
  * @drv: The controller.
  * @tcs: The tcs_group used for ACTIVE_ONLY transfers.
+ *
+ * In solver mode the AP never writes sleep/wake sets, so when all dedicated
+ * active TCSes are busy a wake TCS can be borrowed the same way it is on
+ * controllers that have no active TCS at all.
+ *
+ * Context: Must be called with the drv->lock held.
+ *
+ * Return: The wake tcs_group or NULL if borrowing is not possible.
+ */
+static struct tcs_group *get_borrowable_tcs(struct rsc_drv *drv,
+					    struct tcs_group *tcs)
+{
+	struct tcs_group *wake = &drv->tcs[WAKE_TCS];
+
+	if (!drv->in_solver_mode || tcs->type != ACTIVE_TCS || !wake->num_tcs)
+		return NULL;
+
+	if (!bitmap_empty(wake->slots, MAX_TCS_SLOTS))
+		return NULL;
+
+	return wake;
+}
+
+/**
+ * claim_tcs_for_req() - Claim a tcs in the given tcs_group; only for active.
+ * @drv: The controller.
+ * @tcs: The tcs_group used for ACTIVE_ONLY transfers. Updated to point to the
+ *       wake tcs_group if a wake TCS was borrowed.
  * @msg: The data to be sent.
  *
  * Claims a tcs in the given tcs_group while making sure that no existing cmd
@@ -604,74 +646,159 @@ static int find_free_tcs(struct tcs_group *tcs)
  * Return: The id of the claimed tcs or -EBUSY if a matching msg is in flight
  * or the tcs_group is full.
  */
-static int claim_tcs_for_req(struct rsc_drv *drv, struct tcs_group *tcs,
+static int claim_tcs_for_req(struct rsc_drv *drv, struct tcs_group **tcs,
 			     const struct tcs_request *msg)
 {
+	struct tcs_group *borrow = get_borrowable_tcs(drv, *tcs);
 	int ret;
 
 	/*
 	 * The h/w does not like if we send a request to the same address,
 	 * when one is already in-flight or being processed.
 	 */
-	ret = check_for_req_inflight(drv, tcs, msg);
+	ret = check_for_req_inflight(drv, *tcs, msg);
 	if (ret)
 		return ret;
 
-	return find_free_tcs(tcs);
+	if (borrow) {
+		ret = check_for_req_inflight(drv, borrow, msg);
+		if (ret)
+			return ret;
+	}
+
+	ret = find_free_tcs(*tcs);
+	if (ret >= 0 || !borrow)
+		return ret;
+
+	ret = find_free_tcs(borrow);
+	if (ret >= 0)
+		*tcs = borrow;
+
+	return ret;
+}
+
+/**
+ * start_tcs_for_req() - Mark a claimed TCS busy and program the request.
+ * @drv:    The controller.
+ * @tcs:    The tcs_group @tcs_id belongs to.
+ * @tcs_id: The global ID of the TCS returned by claim_tcs_for_req().
+ * @msg:    The data to be sent.
+ *
+ * Context: Must be called with the drv->lock held since that protects
+ * tcs_in_use.
+ */
+static void start_tcs_for_req(struct rsc_drv *drv, struct tcs_group *tcs,
+			      int tcs_id, const struct tcs_request *msg)
+{
+	struct rpmh_request *rpm_msg = container_of(msg, struct rpmh_request,
+						    msg);
+
+	rpm_msg->issue_ns = ktime_get_ns();
+	tcs->req[tcs_id - tcs->offset] = msg;
+	set_bit(tcs_id, drv->tcs_in_use);
+	drv->tcs_issued[tcs_id]++;
+	if (msg->state == RPMH_ACTIVE_ONLY_STATE && tcs->type != ACTIVE_TCS) {
+		/*
+		 * Clear previously programmed WAKE commands in selected
+		 * repurposed TCS to avoid triggering them. tcs->slots will be
+		 * cleaned from rpmh_flush() by invoking rpmh_rsc_invalidate(),
+		 * so make sure the next flush rewrites the whole wake set.
+		 */
+		write_tcs_reg_sync(drv, drv->regs[RSC_DRV_CMD_ENABLE], tcs_id, 0);
+		enable_tcs_irq(drv, tcs_id, true);
+
+		spin_lock(&drv->client.cache_lock);
+		drv->client.dirty = true;
+		spin_unlock(&drv->client.cache_lock);
+	}
+}
+
+/**
+ * rpmh_rsc_issue_pending() - Start queued requests on free TCSes.
+ * @drv: The controller.
+ *
+ * Requests are started strictly in the order they were queued; we stop at
+ * the first one that can't get a TCS so that two requests for the same
+ * address are never reordered.
+ *
+ * The commands are written while still holding the lock so that
+ * check_for_req_inflight() sees the addresses of a request started here
+ * when looking at the next one in the queue.
+ *
+ * Context: Must be called with the drv->lock held.
+ */
+static void rpmh_rsc_issue_pending(struct rsc_drv *drv)
+{
+	struct rpmh_request *rpm_msg, *tmp;
+	struct tcs_group *tcs;
+	int tcs_id;
+
+	list_for_each_entry_safe(rpm_msg, tmp, &drv->pending, list) {
+		tcs = get_tcs_for_msg(drv, &rpm_msg->msg);
+		tcs_id = claim_tcs_for_req(drv, &tcs, &rpm_msg->msg);
+		if (tcs_id < 0)
+			break;
+
+		list_del_init(&rpm_msg->list);
+		drv->num_pending--;
+
+		start_tcs_for_req(drv, tcs, tcs_id, &rpm_msg->msg);
+		__tcs_buffer_write(drv, tcs_id, 0, &rpm_msg->msg);
+		__tcs_set_trigger(drv, tcs_id, true);
+	}
 }
 
 /**
  * rpmh_rsc_send_data() - Write / trigger active-only message.
  * @drv: The controller.
- * @msg: The data to be sent.
+ * @msg: The data to be sent. Must be embedded in a struct rpmh_request.
  *
  * NOTES:
  * - This is only used for "ACTIVE_ONLY" since the limitations of this
  *   function don't make sense for sleep/wake cases.
  * - To do the transfer, we will grab a whole TCS for ourselves--we don't
- *   try to share. If there are none available we'll wait indefinitely
- *   for a free one.
+ *   try to share. If there are none available (or a conflicting request is
+ *   in flight) the request is queued and started from tcs_tx_done() once a
+ *   TCS frees up, so this never blocks.
  * - This function will not wait for the commands to be finished, only for
- *   data to be programmed into the RPMh. See rpmh_tx_done() which will
- *   be called when the transfer is fully complete.
- * - This function must be called with interrupts enabled. If the hardware
- *   is busy doing someone else's transfer we need that transfer to fully
- *   finish so that we can have the hardware, and to fully finish it needs
- *   the interrupt handler to run. If the interrupts is set to run on the
- *   active CPU this can never happen if interrupts are disabled.
+ *   data to be programmed into the RPMh (or queued). See rpmh_tx_done()
+ *   which will be called when the transfer is fully complete.
  *
  * Return: 0 on success, -EINVAL on error.
  */
 int rpmh_rsc_send_data(struct rsc_drv *drv, const struct tcs_request *msg)
 {
+	struct rpmh_request *rpm_msg = container_of(msg, struct rpmh_request,
+						    msg);
 	struct tcs_group *tcs;
-	int tcs_id;
-
-	might_sleep();
+	unsigned long flags;
+	int tcs_id = -EBUSY;
 
 	tcs = get_tcs_for_msg(drv, msg);
 	if (IS_ERR(tcs))
 		return PTR_ERR(tcs);
 
-	spin_lock_irq(&drv->lock);
+	rpm_msg->stats = rpmh_stats_get_client(drv, rpm_msg->dev);
+	rpm_msg->submit_ns = ktime_get_ns();
+	INIT_LIST_HEAD(&rpm_msg->list);
 
-	/* Wait forever for a free tcs. It better be there eventually! */
-	wait_event_lock_irq(drv->tcs_wait,
-			    (tcs_id = claim_tcs_for_req(drv, tcs, msg)) >= 0,
-			    drv->lock);
+	spin_lock_irqsave(&drv->lock, flags);
 
-	tcs->req[tcs_id - tcs->offset] = msg;
-	set_bit(tcs_id, drv->tcs_in_use);
-	if (msg->state == RPMH_ACTIVE_ONLY_STATE && tcs->type != ACTIVE_TCS) {
-		/*
-		 * Clear previously programmed WAKE commands in selected
-		 * repurposed TCS to avoid triggering them. tcs->slots will be
-		 * cleaned from rpmh_flush() by invoking rpmh_rsc_invalidate()
-		 */
-		write_tcs_reg_sync(drv, drv->regs[RSC_DRV_CMD_ENABLE], tcs_id, 0);
-		enable_tcs_irq(drv, tcs_id, true);
+	/* Don't overtake requests that are already waiting for a TCS */
+	if (list_empty(&drv->pending))
+		tcs_id = claim_tcs_for_req(drv, &tcs, msg);
+
+	if (tcs_id < 0) {
+		list_add_tail(&rpm_msg->list, &drv->pending);
+		drv->total_queued++;
+		drv->num_pending++;
+		drv->max_pending = max(drv->max_pending, drv->num_pending);
+		spin_unlock_irqrestore(&drv->lock, flags);
+		return 0;
 	}
-	spin_unlock_irq(&drv->lock);
+
+	start_tcs_for_req(drv, tcs, tcs_id, msg);
+	spin_unlock_irqrestore(&drv->lock, flags);
 
 	/*
 	 * These two can be done after the lock is released because:
@@ -687,6 +814,31 @@ int rpmh_rsc_send_data(struct rsc_drv *drv, const struct tcs_request *msg)
 	return 0;
 }
 
+/**
+ * rpmh_rsc_cancel() - Drop a request that is still waiting for a TCS.
+ * @drv: The controller.
+ * @msg: The request passed to rpmh_rsc_send_data().
+ *
+ * Synchronous callers keep their requests on the stack (or free them once
+ * they stop waiting), so a request that times out while still queued must
+ * be unlinked before the caller returns or rpmh_rsc_issue_pending() would
+ * pick up a dangling pointer later on. Requests already handed to a TCS
+ * are left alone.
+ */
+void rpmh_rsc_cancel(struct rsc_drv *drv, const struct tcs_request *msg)
+{
+	struct rpmh_request *rpm_msg = container_of(msg, struct rpmh_request,
+						    msg);
+	unsigned long flags;
+
+	spin_lock_irqsave(&drv->lock, flags);
+	if (!list_empty(&rpm_msg->list)) {
+		list_del_init(&rpm_msg->list);
+		drv->num_pending--;
+	}
+	spin_unlock_irqrestore(&drv->lock, flags);
+}
+
 /**
  * find_slots() - Find a place to write the given message.
  * @tcs:    The tcs group to search.
@@ -728,8 +880,10 @@ static int find_slots(struct tcs_group *tcs, const struct tcs_request *msg,
 
 /**
  * rpmh_rsc_write_ctrl_data() - Write request to controller but don't trigger.
- * @drv: The controller.
- * @msg: The data to be written to the controller.
+ * @drv:  The controller.
+ * @msg:  The data to be written to the controller.
+ * @slot: If not NULL, the location the message was written to is returned
+ *        here so it can later be rewritten with rpmh_rsc_update_ctrl_data().
  *
  * This should only be called for sleep/wake state, never active-only
  * state.
@@ -739,7 +893,8 @@ static int find_slots(struct tcs_group *tcs, const struct tcs_request *msg,
  *
  * Return: 0 if no error; else -error.
  */
-int rpmh_rsc_write_ctrl_data(struct rsc_drv *drv, const struct tcs_request *msg)
+int rpmh_rsc_write_ctrl_data(struct rsc_drv *drv, const struct tcs_request *msg,
+			     struct tcs_slot *slot)
 {
 	struct tcs_group *tcs;
 	int tcs_id = 0, cmd_id = 0;
@@ -751,10 +906,33 @@ int rpmh_rsc_write_ctrl_data(struct rsc_drv *drv, const struct tcs_request *msg)
 
 	/* find the TCS id and the command in the TCS to write to */
 	ret = find_slots(tcs, msg, &tcs_id, &cmd_id);
-	if (!ret)
-		__tcs_buffer_write(drv, tcs_id, cmd_id, msg);
+	if (ret)
+		return ret;
 
-	return ret;
+	__tcs_buffer_write(drv, tcs_id, cmd_id, msg);
+	if (slot) {
+		slot->tcs_id = tcs_id;
+		slot->cmd_id = cmd_id;
+	}
+
+	return 0;
+}
+
+/**
+ * rpmh_rsc_update_ctrl_data() - Rewrite a previously written sleep/wake slot.
+ * @drv:  The controller.
+ * @msg:  The data to be written to the controller.
+ * @slot: The location returned by rpmh_rsc_write_ctrl_data() for a message
+ *        with the same number of commands.
+ *
+ * Only valid as long as the sleep/wake TCSes were not invalidated since
+ * @slot was handed out. Same locking rules as rpmh_rsc_write_ctrl_data().
+ */
+void rpmh_rsc_update_ctrl_data(struct rsc_drv *drv,
+			       const struct tcs_request *msg,
+			       const struct tcs_slot *slot)
+{
+	__tcs_buffer_write(drv, slot->tcs_id, slot->cmd_id, msg);
 }
 
 /**
@@ -790,9 +968,36 @@ static bool rpmh_rsc_ctrlr_is_busy(struct rsc_drv *drv)
 	max = tcs->offset + tcs->num_tcs;
 	set = find_next_bit(drv->tcs_in_use, max, tcs->offset);
 
-	return set < max;
+	return set < max || !list_empty(&drv->pending);
 }
 
+/* Last wakeup handed to the RSC, for attributing early wakeups */
+static seqcount_t rpmh_rsc_wakeup_seq = SEQCNT_ZERO(rpmh_rsc_wakeup_seq);
+static u64 rpmh_rsc_wakeup_written_at;
+static u64 rpmh_rsc_wakeup_cycles;
+
+/**
+ * rpmh_get_last_wakeup() - Get the last wakeup written to the CONTROL_TCS.
+ * @written_at: Returns the arch timer count when the wakeup was written.
+ * @wakeup:     Returns the programmed wakeup in arch timer counts, ~0 when
+ *              no timer wakeup was requested (system suspend).
+ *
+ * Both values are 0 if no wakeup has been written yet.
+ *
+ * Context: Any context.
+ */
+void rpmh_get_last_wakeup(u64 *written_at, u64 *wakeup)
+{
+	unsigned int seq;
+
+	do {
+		seq = read_seqcount_begin(&rpmh_rsc_wakeup_seq);
+		*written_at = rpmh_rsc_wakeup_written_at;
+		*wakeup = rpmh_rsc_wakeup_cycles;
+	} while (read_seqcount_retry(&rpmh_rsc_wakeup_seq, seq));
+}
+EXPORT_SYMBOL_GPL(rpmh_get_last_wakeup);
+
 /**
  * rpmh_rsc_write_next_wakeup() - Write next wakeup in CONTROL_TCS.
  * @drv: The controller
@@ -833,6 +1038,12 @@ void rpmh_rsc_write_next_wakeup(struct rsc_drv *drv)
 
 	writel_relaxed(lo, drv->base + RSC_DRV_CTL_TCS_DATA_LO);
 	writel_relaxed(hi, drv->base + RSC_DRV_CTL_TCS_DATA_HI);
+
+	/* Only the last CPU going down gets here, so there is one writer */
+	raw_write_seqcount_begin(&rpmh_rsc_wakeup_seq);
+	rpmh_rsc_wakeup_written_at = arch_timer_read_counter();
+	rpmh_rsc_wakeup_cycles = wakeup_cycles;
+	raw_write_seqcount_end(&rpmh_rsc_wakeup_seq);
 }
 
 /**
@@ -1031,6 +1242,72 @@ static int rpmh_probe_tcs_config(struct platform_device *pdev, struct rsc_drv *d
 	return 0;
 }
 
+static const char * const tcs_type_names[TCS_TYPE_NR] = {
+	[ACTIVE_TCS] = "active",
+	[SLEEP_TCS] = "sleep",
+	[WAKE_TCS] = "wake",
+	[CONTROL_TCS] = "control",
+};
+
+static int rpmh_rsc_tcs_show(struct seq_file *s, void *unused)
+{
+	struct rsc_drv *drv = s->private;
+	struct tcs_group *tcs;
+	int i, m;
+
+	spin_lock_irq(&drv->lock);
+
+	for (i = 0; i < TCS_TYPE_NR; i++) {
+		tcs = &drv->tcs[i];
+		if (i == CONTROL_TCS)
+			continue;
+
+		for (m = tcs->offset; m < tcs->offset + tcs->num_tcs; m++)
+			seq_printf(s, "%-6s tcs %2d: %s issued %llu\n",
+				   tcs_type_names[i], m,
+				   test_bit(m, drv->tcs_in_use) ? "busy" : "idle",
+				   drv->tcs_issued[m]);
+	}
+
+	seq_printf(s, "pending: %u max: %u queued: %llu\n",
+		   drv->num_pending, drv->max_pending, drv->total_queued);
+
+	spin_unlock_irq(&drv->lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rpmh_rsc_tcs);
+
+static DEFINE_MUTEX(rpmh_rsc_debugfs_lock);
+static struct dentry *rpmh_rsc_debugfs_root;
+static unsigned int rpmh_rsc_debugfs_users;
+
+static void rpmh_rsc_debugfs_remove(void *data)
+{
+	struct rsc_drv *drv = data;
+
+	mutex_lock(&rpmh_rsc_debugfs_lock);
+	debugfs_remove_recursive(drv->debugfs);
+	if (!--rpmh_rsc_debugfs_users) {
+		debugfs_remove(rpmh_rsc_debugfs_root);
+		rpmh_rsc_debugfs_root = NULL;
+	}
+	mutex_unlock(&rpmh_rsc_debugfs_lock);
+}
+
+static void rpmh_rsc_debugfs_init(struct rsc_drv *drv)
+{
+	mutex_lock(&rpmh_rsc_debugfs_lock);
+	if (!rpmh_rsc_debugfs_users++)
+		rpmh_rsc_debugfs_root = debugfs_create_dir("rpmh", NULL);
+
+	drv->debugfs = debugfs_create_dir(drv->name, rpmh_rsc_debugfs_root);
+	debugfs_create_file("tcs", 0400, drv->debugfs, drv, &rpmh_rsc_tcs_fops);
+	mutex_unlock(&rpmh_rsc_debugfs_lock);
+
+	devm_add_action_or_reset(drv->dev, rpmh_rsc_debugfs_remove, drv);
+}
+
 static int rpmh_rsc_probe(struct platform_device *pdev)
 {
 	struct device_node *dn = pdev->dev.of_node;
@@ -1085,7 +1362,7 @@ static int rpmh_rsc_probe(struct platform_device *pdev)
 		return ret;
 
 	spin_lock_init(&drv->lock);
-	init_waitqueue_head(&drv->tcs_wait);
+	INIT_LIST_HEAD(&drv->pending);
 	bitmap_zero(drv->tcs_in_use, MAX_TCS_NR);
 
 	irq = platform_get_irq(pdev, drv->id);
@@ -1106,6 +1383,7 @@ static int rpmh_rsc_probe(struct platform_device *pdev)
 	solver_config = readl_relaxed(drv->base + drv->regs[DRV_SOLVER_CONFIG]);
 	solver_config &= DRV_HW_SOLVER_MASK << DRV_HW_SOLVER_SHIFT;
 	solver_config = solver_config >> DRV_HW_SOLVER_SHIFT;
+	drv->in_solver_mode = solver_config;
 	if (!solver_config) {
 		if (pdev->dev.pm_domain) {
 			ret = rpmh_rsc_pd_attach(drv, &pdev->dev);
@@ -1122,12 +1400,16 @@ static int rpmh_rsc_probe(struct platform_device *pdev)
 		       drv->tcs_base + drv->regs[RSC_DRV_IRQ_ENABLE]);
 
 	spin_lock_init(&drv->client.cache_lock);
-	INIT_LIST_HEAD(&drv->client.cache);
+	hash_init(drv->client.cache);
+	INIT_LIST_HEAD(&drv->client.dirty_list);
 	INIT_LIST_HEAD(&drv->client.batch_cache);
 
 	dev_set_drvdata(&pdev->dev, drv);
 	drv->dev = &pdev->dev;
 
+	rpmh_rsc_debugfs_init(drv);
+	rpmh_stats_init(drv);
+
 	ret = devm_of_platform_populate(&pdev->dev);
 	if (ret && pdev->dev.pm_domain) {
 		dev_pm_genpd_remove_notifier(&pdev->dev);
@@ -0,0 +1,230 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Per-client accounting of ACTIVE_ONLY requests sent through an RSC.
+ *
+ * Every request is attributed to the device that made it. Counters are kept
+ * per CPU and only ever updated from tcs_tx_done(), so recording a completed
+ * request is a handful of adds on the local CPU without taking any lock.
+ */
+
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/hashtable.h>
+#include <linux/ktime.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/string.h>
+
+#include "rpmh-internal.h"
+
+/* Histogram buckets are log2 of the time in units of 1024ns (~1us) */
+#define RPMH_STATS_HIST_SHIFT		10
+#define RPMH_STATS_HIST_BUCKETS		16
+
+/**
+ * struct rpmh_stats_cpu: per CPU counters of one client
+ *
+ * @calls:        Number of completed requests.
+ * @bytes:        Payload of the completed requests.
+ * @latency_ns:   Sum of the time from rpmh_rsc_send_data() to tcs_tx_done().
+ * @wait_ns:      Sum of the time spent waiting for a free TCS.
+ * @latency_hist: log2 histogram of the per request latency.
+ * @wait_hist:    log2 histogram of the per request wait time.
+ */
+struct rpmh_stats_cpu {
+	u64 calls;
+	u64 bytes;
+	u64 latency_ns;
+	u64 wait_ns;
+	u64 latency_hist[RPMH_STATS_HIST_BUCKETS];
+	u64 wait_hist[RPMH_STATS_HIST_BUCKETS];
+};
+
+/**
+ * struct rpmh_client_stats: accounting for one client of the RSC
+ *
+ * @dev:  The client device, NULL for requests without an owner. Only used as
+ *        the lookup key and never dereferenced, the device may be gone.
+ * @name: Copy of the client's device name.
+ * @node: Entry in the controller's client hashtable.
+ * @cpu:  Per CPU counters.
+ */
+struct rpmh_client_stats {
+	const struct device *dev;
+	const char *name;
+	struct hlist_node node;
+	struct rpmh_stats_cpu __percpu *cpu;
+};
+
+/*
+ * A client that unbound leaves its entry behind. Compare the name as well, so
+ * that a new device allocated at the same address gets an entry of its own.
+ */
+static bool rpmh_stats_match(const struct rpmh_client_stats *stats,
+			     const struct device *dev)
+{
+	if (stats->dev != dev)
+		return false;
+
+	return !dev || !strcmp(stats->name, dev_name(dev));
+}
+
+static unsigned int rpmh_stats_bucket(u64 ns)
+{
+	return min_t(unsigned int, fls64(ns >> RPMH_STATS_HIST_SHIFT),
+		     RPMH_STATS_HIST_BUCKETS - 1);
+}
+
+/**
+ * rpmh_stats_get_client() - Find or create the stats of a client.
+ * @drv: The controller.
+ * @dev: The device making requests.
+ *
+ * Context: Any context; allocates with GFP_ATOMIC on first use.
+ *
+ * Return: The client stats or NULL if they could not be allocated.
+ */
+struct rpmh_client_stats *rpmh_stats_get_client(struct rsc_drv *drv,
+						const struct device *dev)
+{
+	struct rpmh_client_stats *stats, *p;
+	unsigned long flags;
+
+	spin_lock_irqsave(&drv->stats_lock, flags);
+	hash_for_each_possible(drv->stats, p, node, (unsigned long)dev) {
+		if (rpmh_stats_match(p, dev)) {
+			spin_unlock_irqrestore(&drv->stats_lock, flags);
+			return p;
+		}
+	}
+	spin_unlock_irqrestore(&drv->stats_lock, flags);
+
+	stats = kzalloc(sizeof(*stats), GFP_ATOMIC);
+	if (!stats)
+		return NULL;
+
+	stats->name = kstrdup_const(dev ? dev_name(dev) : "(none)", GFP_ATOMIC);
+	if (!stats->name) {
+		kfree(stats);
+		return NULL;
+	}
+
+	stats->cpu = alloc_percpu_gfp(struct rpmh_stats_cpu, GFP_ATOMIC);
+	if (!stats->cpu) {
+		kfree_const(stats->name);
+		kfree(stats);
+		return NULL;
+	}
+	stats->dev = dev;
+
+	/* Somebody else may have added it while we were allocating */
+	spin_lock_irqsave(&drv->stats_lock, flags);
+	hash_for_each_possible(drv->stats, p, node, (unsigned long)dev) {
+		if (rpmh_stats_match(p, dev)) {
+			spin_unlock_irqrestore(&drv->stats_lock, flags);
+			free_percpu(stats->cpu);
+			kfree_const(stats->name);
+			kfree(stats);
+			return p;
+		}
+	}
+	hash_add(drv->stats, &stats->node, (unsigned long)dev);
+	spin_unlock_irqrestore(&drv->stats_lock, flags);
+
+	return stats;
+}
+
+/**
+ * rpmh_stats_record() - Account a completed request.
+ * @rpm_msg: The request; its submit and issue timestamps must be set.
+ *
+ * Context: Called from tcs_tx_done() in hard IRQ context.
+ */
+void rpmh_stats_record(const struct rpmh_request *rpm_msg)
+{
+	struct rpmh_stats_cpu *s;
+	u64 now = ktime_get_ns();
+	u64 latency, wait;
+
+	if (!rpm_msg->stats)
+		return;
+
+	latency = now - rpm_msg->submit_ns;
+	wait = rpm_msg->issue_ns - rpm_msg->submit_ns;
+
+	s = this_cpu_ptr(rpm_msg->stats->cpu);
+	s->calls++;
+	s->bytes += rpm_msg->msg.num_cmds * sizeof(struct tcs_cmd);
+	s->latency_ns += latency;
+	s->wait_ns += wait;
+	s->latency_hist[rpmh_stats_bucket(latency)]++;
+	s->wait_hist[rpmh_stats_bucket(wait)]++;
+}
+
+static void rpmh_stats_show_hist(struct seq_file *s, const char *name,
+				 const u64 *hist)
+{
+	int i;
+
+	seq_printf(s, "  %-8s", name);
+	for (i = 0; i < RPMH_STATS_HIST_BUCKETS; i++)
+		seq_printf(s, " %llu", hist[i]);
+	seq_putc(s, '\n');
+}
+
+static void rpmh_stats_show_client(struct seq_file *s,
+				   const struct rpmh_client_stats *stats)
+{
+	struct rpmh_stats_cpu sum = { 0 };
+	const struct rpmh_stats_cpu *c;
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		c = per_cpu_ptr(stats->cpu, cpu);
+		sum.calls += c->calls;
+		sum.bytes += c->bytes;
+		sum.latency_ns += c->latency_ns;
+		sum.wait_ns += c->wait_ns;
+		for (i = 0; i < RPMH_STATS_HIST_BUCKETS; i++) {
+			sum.latency_hist[i] += c->latency_hist[i];
+			sum.wait_hist[i] += c->wait_hist[i];
+		}
+	}
+
+	seq_printf(s, "%s: calls %llu bytes %llu latency_ns %llu wait_ns %llu\n",
+		   stats->name,
+		   sum.calls, sum.bytes, sum.latency_ns, sum.wait_ns);
+	rpmh_stats_show_hist(s, "latency", sum.latency_hist);
+	rpmh_stats_show_hist(s, "wait", sum.wait_hist);
+}
+
+static int rpmh_stats_clients_show(struct seq_file *s, void *unused)
+{
+	struct rsc_drv *drv = s->private;
+	struct rpmh_client_stats *stats;
+	int bkt;
+
+	seq_printf(s, "# histogram bucket n counts times below 2^n * %uns\n",
+		   1U << RPMH_STATS_HIST_SHIFT);
+
+	/* Clients are never removed; the counters themselves are read racily */
+	spin_lock_irq(&drv->stats_lock);
+	hash_for_each(drv->stats, bkt, stats, node)
+		rpmh_stats_show_client(s, stats);
+	spin_unlock_irq(&drv->stats_lock);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(rpmh_stats_clients);
+
+void rpmh_stats_init(struct rsc_drv *drv)
+{
+	spin_lock_init(&drv->stats_lock);
+	hash_init(drv->stats);
+
+	debugfs_create_file("clients", 0400, drv->debugfs, drv,
+			    &rpmh_stats_clients_fops);
+}
@@ -5,6 +5,7 @@
 
 #include <linux/atomic.h>
 #include <linux/bug.h>
+#include <linux/hashtable.h>
 #include <linux/interrupt.h>
 #include <linux/jiffies.h>
 #include <linux/kernel.h>
@@ -46,13 +47,21 @@
  * @addr: the address of the resource
  * @sleep_val: the sleep vote
  * @wake_val: the wake vote
- * @list: linked list obj
+ * @node: entry in the controller's cache hashtable
+ * @dirty: entry in the controller's dirty_list
+ * @sleep_slot: where the sleep vote was written on the last flush
+ * @wake_slot: where the wake vote was written on the last flush
+ * @flushed: @sleep_slot and @wake_slot hold valid locations
  */
 struct cache_req {
 	u32 addr;
 	u32 sleep_val;
 	u32 wake_val;
-	struct list_head list;
+	struct hlist_node node;
+	struct list_head dirty;
+	struct tcs_slot sleep_slot;
+	struct tcs_slot wake_slot;
+	bool flushed;
 };
 
 /**
@@ -96,16 +105,21 @@ void rpmh_tx_done(const struct tcs_request *msg)
 
 static struct cache_req *__find_req(struct rpmh_ctrlr *ctrlr, u32 addr)
 {
-	struct cache_req *p, *req = NULL;
+	struct cache_req *p;
 
-	list_for_each_entry(p, &ctrlr->cache, list) {
-		if (p->addr == addr) {
-			req = p;
-			break;
-		}
+	hash_for_each_possible(ctrlr->cache, p, node, addr) {
+		if (p->addr == addr)
+			return p;
 	}
 
-	return req;
+	return NULL;
+}
+
+static int is_req_valid(struct cache_req *req)
+{
+	return (req->sleep_val != UINT_MAX &&
+		req->wake_val != UINT_MAX &&
+		req->sleep_val != req->wake_val);
 }
 
 static struct cache_req *cache_rpm_request(struct rpmh_ctrlr *ctrlr,
@@ -129,7 +143,8 @@ static struct cache_req *cache_rpm_request(struct rpmh_ctrlr *ctrlr,
 
 	req->addr = cmd->addr;
 	req->sleep_val = req->wake_val = UINT_MAX;
-	list_add_tail(&req->list, &ctrlr->cache);
+	INIT_LIST_HEAD(&req->dirty);
+	hash_add(ctrlr->cache, &req->node, req->addr);
 
 existing:
 	old_sleep_val = req->sleep_val;
@@ -145,10 +160,21 @@ static struct cache_req *cache_rpm_request(struct rpmh_ctrlr *ctrlr,
 		break;
 	}
 
-	ctrlr->dirty |= (req->sleep_val != old_sleep_val ||
-			 req->wake_val != old_wake_val) &&
-			 req->sleep_val != UINT_MAX &&
-			 req->wake_val != UINT_MAX;
+	if (req->sleep_val == old_sleep_val && req->wake_val == old_wake_val)
+		goto unlock;
+
+	/*
+	 * A request that is already in the sleep/wake TCSes and stays valid
+	 * can be rewritten in place, as can a newly valid one as long as
+	 * there is room for it. Dropping a request from the TCSes requires
+	 * rewriting the whole set.
+	 */
+	if (is_req_valid(req)) {
+		if (list_empty(&req->dirty))
+			list_add_tail(&req->dirty, &ctrlr->dirty_list);
+	} else if (req->flushed) {
+		ctrlr->dirty = true;
+	}
 
 unlock:
 	spin_unlock_irqrestore(&ctrlr->cache_lock, flags);
@@ -229,6 +255,7 @@ int rpmh_write_async(const struct device *dev, enum rpmh_state state,
 	if (!rpm_msg)
 		return -ENOMEM;
 	rpm_msg->needs_free = true;
+	rpm_msg->dev = dev;
 
 	ret = __fill_rpmh_msg(rpm_msg, state, cmd, n);
 	if (ret) {
@@ -266,8 +293,12 @@ int rpmh_write(const struct device *dev, enum rpmh_state state,
 		return ret;
 
 	ret = wait_for_completion_timeout(&compl, RPMH_TIMEOUT_MS);
-	WARN_ON(!ret);
-	return (ret > 0) ? 0 : -ETIMEDOUT;
+	if (WARN_ON(!ret)) {
+		rpmh_rsc_cancel(ctrlr_to_drv(get_rpmh_ctrlr(dev)), &rpm_msg.msg);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
 }
 EXPORT_SYMBOL_GPL(rpmh_write);
 
@@ -293,7 +324,7 @@ static int flush_batch(struct rpmh_ctrlr *ctrlr)
 		for (i = 0; i < req->count; i++) {
 			rpm_msg = req->rpm_msgs + i;
 			ret = rpmh_rsc_write_ctrl_data(ctrlr_to_drv(ctrlr),
-						       &rpm_msg->msg);
+						       &rpm_msg->msg, NULL);
 			if (ret)
 				break;
 		}
@@ -353,6 +384,7 @@ int rpmh_write_batch(const struct device *dev, enum rpmh_state state,
 
 	for (i = 0; i < count; i++) {
 		__fill_rpmh_msg(rpm_msgs + i, state, cmd, n[i]);
+		rpm_msgs[i].dev = dev;
 		cmd += n[i];
 	}
 
@@ -385,6 +417,11 @@ int rpmh_write_batch(const struct device *dev, enum rpmh_state state,
 			 */
 			WARN_ON(1);
 			ret = -ETIMEDOUT;
+			/* Don't leave the ones still queued behind */
+			do {
+				rpmh_rsc_cancel(ctrlr_to_drv(ctrlr),
+						&rpm_msgs[i].msg);
+			} while (i--);
 			goto exit;
 		}
 	}
@@ -396,15 +433,8 @@ int rpmh_write_batch(const struct device *dev, enum rpmh_state state,
 }
 EXPORT_SYMBOL_GPL(rpmh_write_batch);
 
-static int is_req_valid(struct cache_req *req)
-{
-	return (req->sleep_val != UINT_MAX &&
-		req->wake_val != UINT_MAX &&
-		req->sleep_val != req->wake_val);
-}
-
 static int send_single(struct rpmh_ctrlr *ctrlr, enum rpmh_state state,
-		       u32 addr, u32 data)
+		       u32 addr, u32 data, struct tcs_slot *slot, bool update)
 {
 	DEFINE_RPMH_MSG_ONSTACK(NULL, state, NULL, rpm_msg);
 
@@ -414,7 +444,102 @@ static int send_single(struct rpmh_ctrlr *ctrlr, enum rpmh_state state,
 	rpm_msg.cmd[0].data = data;
 	rpm_msg.msg.num_cmds = 1;
 
-	return rpmh_rsc_write_ctrl_data(ctrlr_to_drv(ctrlr), &rpm_msg.msg);
+	if (update) {
+		rpmh_rsc_update_ctrl_data(ctrlr_to_drv(ctrlr), &rpm_msg.msg,
+					  slot);
+		return 0;
+	}
+
+	return rpmh_rsc_write_ctrl_data(ctrlr_to_drv(ctrlr), &rpm_msg.msg,
+					slot);
+}
+
+static int flush_req(struct rpmh_ctrlr *ctrlr, struct cache_req *req)
+{
+	bool update = req->flushed;
+	int ret;
+
+	req->flushed = false;
+
+	ret = send_single(ctrlr, RPMH_SLEEP_STATE, req->addr, req->sleep_val,
+			  &req->sleep_slot, update);
+	if (ret)
+		return ret;
+
+	ret = send_single(ctrlr, RPMH_WAKE_ONLY_STATE, req->addr, req->wake_val,
+			  &req->wake_slot, update);
+	if (ret)
+		return ret;
+
+	req->flushed = true;
+
+	return 0;
+}
+
+static void flush_clear_dirty(struct rpmh_ctrlr *ctrlr)
+{
+	struct cache_req *p, *tmp;
+
+	list_for_each_entry_safe(p, tmp, &ctrlr->dirty_list, dirty)
+		list_del_init(&p->dirty);
+}
+
+/*
+ * Only rewrite the requests that changed since the last flush. Returns
+ * -ENOMEM if a request could not be placed, in which case the caller
+ * has to fall back to rewriting the whole sleep/wake set.
+ */
+static int flush_dirty(struct rpmh_ctrlr *ctrlr)
+{
+	struct cache_req *p;
+	int ret;
+
+	list_for_each_entry(p, &ctrlr->dirty_list, dirty) {
+		/* Went invalid again before being flushed */
+		if (!is_req_valid(p))
+			continue;
+
+		ret = flush_req(ctrlr, p);
+		if (ret)
+			return ret;
+	}
+
+	flush_clear_dirty(ctrlr);
+
+	return 0;
+}
+
+static int flush_all(struct rpmh_ctrlr *ctrlr)
+{
+	struct cache_req *p;
+	int bkt, ret;
+
+	/* Invalidate the TCSes first to avoid stale data */
+	rpmh_rsc_invalidate(ctrlr_to_drv(ctrlr));
+
+	hash_for_each(ctrlr->cache, bkt, p, node)
+		p->flushed = false;
+
+	/* First flush the cached batch requests */
+	ret = flush_batch(ctrlr);
+	if (ret)
+		return ret;
+
+	hash_for_each(ctrlr->cache, bkt, p, node) {
+		if (!is_req_valid(p)) {
+			pr_debug("%s: skipping RPMH req: a:%#x s:%#x w:%#x",
+				 __func__, p->addr, p->sleep_val, p->wake_val);
+			continue;
+		}
+		ret = flush_req(ctrlr, p);
+		if (ret)
+			return ret;
+	}
+
+	flush_clear_dirty(ctrlr);
+	ctrlr->dirty = false;
+
+	return 0;
 }
 
 /**
@@ -428,7 +553,6 @@ static int send_single(struct rpmh_ctrlr *ctrlr, enum rpmh_state state,
  */
 int rpmh_flush(struct rpmh_ctrlr *ctrlr)
 {
-	struct cache_req *p;
 	int ret = 0;
 
 	lockdep_assert_irqs_disabled();
@@ -441,37 +565,25 @@ int rpmh_flush(struct rpmh_ctrlr *ctrlr)
 	if (!spin_trylock(&ctrlr->cache_lock))
 		return -EBUSY;
 
-	if (!ctrlr->dirty) {
+	if (!ctrlr->dirty && list_empty(&ctrlr->dirty_list)) {
 		pr_debug("Skipping flush, TCS has latest data.\n");
 		goto write_next_wakeup;
 	}
 
-	/* Invalidate the TCSes first to avoid stale data */
-	rpmh_rsc_invalidate(ctrlr_to_drv(ctrlr));
-
-	/* First flush the cached batch requests */
-	ret = flush_batch(ctrlr);
-	if (ret)
-		goto exit;
-
-	list_for_each_entry(p, &ctrlr->cache, list) {
-		if (!is_req_valid(p)) {
-			pr_debug("%s: skipping RPMH req: a:%#x s:%#x w:%#x",
-				 __func__, p->addr, p->sleep_val, p->wake_val);
-			continue;
-		}
-		ret = send_single(ctrlr, RPMH_SLEEP_STATE, p->addr,
-				  p->sleep_val);
-		if (ret)
+	if (!ctrlr->dirty) {
+		ret = flush_dirty(ctrlr);
+		if (ret == -ENOMEM)
+			ctrlr->dirty = true;
+		else if (ret)
 			goto exit;
-		ret = send_single(ctrlr, RPMH_WAKE_ONLY_STATE, p->addr,
-				  p->wake_val);
+	}
+
+	if (ctrlr->dirty) {
+		ret = flush_all(ctrlr);
 		if (ret)
 			goto exit;
 	}
 
-	ctrlr->dirty = false;
-
 write_next_wakeup:
 	rpmh_rsc_write_next_wakeup(ctrlr_to_drv(ctrlr));
 exit:
@@ -15,6 +15,7 @@
 #include <linux/slab.h>
 #include <linux/soc/qcom/smem.h>
 #include <linux/soc/qcom/socinfo.h>
+#include <linux/xarray.h>
 
 /*
  * The Qualcomm shared memory system is a allocate only heap structure that
@@ -59,6 +60,12 @@
  * be held - currently lock number 3 of the sfpb or tcsr is used for this on all
  * platforms.
  *
+ * As items are never freed or moved, the location of an item found once stays
+ * valid. Each partition (and the global heap) therefore keeps a cache of the
+ * items looked up so far, so that repeated lookups don't have to walk the
+ * entry lists in uncached memory. Only items that were found are cached; an
+ * item missing now may be allocated by a remote processor at any time.
+ *
  */
 
 /*
@@ -202,12 +209,24 @@ struct smem_partition_header {
  * @phys_base:	starting physical address of partition
  * @cacheline:	alignment for "cached" entries
  * @size:	size of partition
+ * @items:	lookup cache of the items found in the partition
  */
 struct smem_partition {
 	void __iomem *virt_base;
 	phys_addr_t phys_base;
 	size_t cacheline;
 	size_t size;
+	struct xarray items;
+};
+
+/**
+ * struct smem_cached_item - lookup cache entry
+ * @ptr:	virtual address of the item
+ * @size:	size of the item
+ */
+struct smem_cached_item {
+	void *ptr;
+	size_t size;
 };
 
 static const u8 SMEM_PART_MAGIC[] = { 0x24, 0x50, 0x52, 0x54 };
@@ -268,6 +287,7 @@ struct smem_region {
  * @ptable: virtual base of partition table
  * @global_partition: describes for global partition when in use
  * @partitions: list of partitions of current processor/host
+ * @global_items: lookup cache of the global heap, when it has no partition
  * @item_count: max accepted item number
  * @socinfo:	platform device pointer
  * @num_regions: number of @regions
@@ -283,6 +303,7 @@ struct qcom_smem {
 	struct smem_ptable *ptable;
 	struct smem_partition global_partition;
 	struct smem_partition partitions[SMEM_HOST_COUNT];
+	struct xarray global_items;
 
 	unsigned num_regions;
 	struct smem_region regions[] __counted_by(num_regions);
@@ -669,6 +690,55 @@ static void *qcom_smem_get_private(struct qcom_smem *smem,
 	return ERR_PTR(-EINVAL);
 }
 
+static void *qcom_smem_cache_get(struct xarray *cache, unsigned item,
+				 size_t *size)
+{
+	struct smem_cached_item *entry;
+
+	entry = xa_load(cache, item);
+	if (!entry)
+		return NULL;
+
+	if (size != NULL)
+		*size = entry->size;
+
+	return entry->ptr;
+}
+
+static void qcom_smem_cache_add(struct xarray *cache, unsigned item,
+				void *ptr, size_t size)
+{
+	struct smem_cached_item *entry, *old;
+	unsigned long flags;
+
+	/* Lookups may come from any context; failing to cache is harmless */
+	entry = kmalloc(sizeof(*entry), GFP_ATOMIC);
+	if (!entry)
+		return;
+
+	entry->ptr = ptr;
+	entry->size = size;
+
+	xa_lock_irqsave(cache, flags);
+	old = __xa_cmpxchg(cache, item, NULL, entry, GFP_ATOMIC);
+	xa_unlock_irqrestore(cache, flags);
+
+	/* Lost a race with another lookup, or out of memory */
+	if (old)
+		kfree(entry);
+}
+
+static void qcom_smem_cache_destroy(struct xarray *cache)
+{
+	struct smem_cached_item *entry;
+	unsigned long item;
+
+	xa_for_each(cache, item, entry)
+		kfree(entry);
+
+	xa_destroy(cache);
+}
+
 /**
  * qcom_smem_get() - resolve ptr of size of a smem item
  * @host:	the remote processor, or -1
@@ -680,8 +750,10 @@ static void *qcom_smem_get_private(struct qcom_smem *smem,
  */
 void *qcom_smem_get(unsigned host, unsigned item, size_t *size)
 {
-	struct smem_partition *part;
+	struct smem_partition *part = NULL;
 	void *ptr = ERR_PTR(-EPROBE_DEFER);
+	struct xarray *cache;
+	size_t item_size;
 
 	if (!__smem)
 		return ptr;
@@ -689,15 +761,27 @@ void *qcom_smem_get(unsigned host, unsigned item, size_t *size)
 	if (WARN_ON(item >= __smem->item_count))
 		return ERR_PTR(-EINVAL);
 
-	if (host < SMEM_HOST_COUNT && __smem->partitions[host].virt_base) {
+	if (host < SMEM_HOST_COUNT && __smem->partitions[host].virt_base)
 		part = &__smem->partitions[host];
-		ptr = qcom_smem_get_private(__smem, part, item, size);
-	} else if (__smem->global_partition.virt_base) {
+	else if (__smem->global_partition.virt_base)
 		part = &__smem->global_partition;
-		ptr = qcom_smem_get_private(__smem, part, item, size);
-	} else {
-		ptr = qcom_smem_get_global(__smem, item, size);
-	}
+
+	cache = part ? &part->items : &__smem->global_items;
+	ptr = qcom_smem_cache_get(cache, item, size);
+	if (ptr)
+		return ptr;
+
+	if (part)
+		ptr = qcom_smem_get_private(__smem, part, item, &item_size);
+	else
+		ptr = qcom_smem_get_global(__smem, item, &item_size);
+	if (IS_ERR(ptr))
+		return ptr;
+
+	qcom_smem_cache_add(cache, item, ptr, item_size);
+
+	if (size != NULL)
+		*size = item_size;
 
 	return ptr;
 }
@@ -1137,6 +1221,11 @@ static int qcom_smem_probe(struct platform_device *pdev)
 	smem->dev = &pdev->dev;
 	smem->num_regions = num_regions;
 
+	xa_init_flags(&smem->global_items, XA_FLAGS_LOCK_IRQ);
+	xa_init_flags(&smem->global_partition.items, XA_FLAGS_LOCK_IRQ);
+	for (i = 0; i < SMEM_HOST_COUNT; i++)
+		xa_init_flags(&smem->partitions[i].items, XA_FLAGS_LOCK_IRQ);
+
 	rmem = of_reserved_mem_lookup(pdev->dev.of_node);
 	if (rmem) {
 		smem->regions[0].aux_base = rmem->base;
@@ -1237,10 +1326,18 @@ static int qcom_smem_probe(struct platform_device *pdev)
 
 static void qcom_smem_remove(struct platform_device *pdev)
 {
-	platform_device_unregister(__smem->socinfo);
+	struct qcom_smem *smem = __smem;
+	int i;
 
-	hwspin_lock_free(__smem->hwlock);
+	platform_device_unregister(smem->socinfo);
+
+	hwspin_lock_free(smem->hwlock);
 	__smem = NULL;
+
+	qcom_smem_cache_destroy(&smem->global_items);
+	qcom_smem_cache_destroy(&smem->global_partition.items);
+	for (i = 0; i < SMEM_HOST_COUNT; i++)
+		qcom_smem_cache_destroy(&smem->partitions[i].items);
 }
 
 static const struct of_device_id qcom_smem_of_match[] = {
@@ -56,6 +56,56 @@ int qcom_smem_state_update_bits(struct qcom_smem_state *state,
 }
 EXPORT_SYMBOL_GPL(qcom_smem_state_update_bits);
 
+/**
+ * qcom_smem_state_update_bits_batch() - update several states, signal once
+ * @updates:	array of state, mask and value triplets
+ * @count:	number of entries in @updates
+ *
+ * Applies the updates in order. Providers implementing deferred updates
+ * signal the remote once for the whole batch instead of once per update,
+ * states sharing an edge are kicked only once. Updates applied before a
+ * failing one are still signalled.
+ *
+ * Returns 0 on success, otherwise negative errno.
+ */
+int qcom_smem_state_update_bits_batch(const struct qcom_smem_state_update *updates,
+				      unsigned int count)
+{
+	struct qcom_smem_state *state;
+	unsigned int i, j;
+	int ret = 0;
+
+	for (i = 0; i < count; i++) {
+		state = updates[i].state;
+
+		if (state->orphan)
+			ret = -ENXIO;
+		else if (state->ops.update_bits_nokick && state->ops.kick)
+			ret = state->ops.update_bits_nokick(state->priv,
+							    updates[i].mask,
+							    updates[i].value);
+		else if (state->ops.update_bits)
+			ret = state->ops.update_bits(state->priv,
+						     updates[i].mask,
+						     updates[i].value);
+		else
+			ret = -ENOTSUPP;
+
+		if (ret)
+			break;
+	}
+
+	for (j = 0; j < i; j++) {
+		state = updates[j].state;
+
+		if (state->ops.update_bits_nokick && state->ops.kick)
+			state->ops.kick(state->priv);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(qcom_smem_state_update_bits_batch);
+
 static struct qcom_smem_state *of_node_to_state(struct device_node *np)
 {
 	struct qcom_smem_state *state;
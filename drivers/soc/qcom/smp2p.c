@@ -130,6 +130,7 @@ struct smp2p_entry {
  * @ipc_bit:	bit in regmap@offset to kick to signal remote processor
  * @mbox_client: mailbox client handle
  * @mbox_chan:	apcs ipc mailbox channel handle
+ * @kick_pending: outbound values changed by a batched update, not yet kicked
  * @inbound:	list of inbound entries
  * @outbound:	list of outbound entries
  */
@@ -157,6 +158,8 @@ struct qcom_smp2p {
 	struct mbox_client mbox_client;
 	struct mbox_chan *mbox_chan;
 
+	bool kick_pending;
+
 	struct list_head inbound;
 	struct list_head outbound;
 };
@@ -221,6 +224,7 @@ static void qcom_smp2p_notify_in(struct qcom_smp2p *smp2p)
 {
 	struct smp2p_smem_item *in;
 	struct smp2p_entry *entry;
+	unsigned long pending;
 	int irq_pin;
 	u32 status;
 	char buf[SMP2P_MAX_ENTRY_NAME];
@@ -256,15 +260,14 @@ static void qcom_smp2p_notify_in(struct qcom_smp2p *smp2p)
 		if (!status)
 			continue;
 
-		for_each_set_bit(i, entry->irq_enabled, 32) {
-			if (!(status & BIT(i)))
-				continue;
+		/* Only the enabled bits whose edge the consumer asked for */
+		pending = status & entry->irq_enabled[0] &
+			  ((val & entry->irq_rising[0]) |
+			   (~val & entry->irq_falling[0]));
 
-			if ((val & BIT(i) && test_bit(i, entry->irq_rising)) ||
-			    (!(val & BIT(i)) && test_bit(i, entry->irq_falling))) {
-				irq_pin = irq_find_mapping(entry->domain, i);
-				handle_nested_irq(irq_pin);
-			}
+		for_each_set_bit(i, &pending, 32) {
+			irq_pin = irq_find_mapping(entry->domain, i);
+			handle_nested_irq(irq_pin);
 		}
 	}
 }
@@ -401,9 +404,8 @@ static int qcom_smp2p_inbound_entry(struct qcom_smp2p *smp2p,
 	return 0;
 }
 
-static int smp2p_update_bits(void *data, u32 mask, u32 value)
+static bool __smp2p_update_bits(struct smp2p_entry *entry, u32 mask, u32 value)
 {
-	struct smp2p_entry *entry = data;
 	unsigned long flags;
 	u32 orig;
 	u32 val;
@@ -415,14 +417,42 @@ static int smp2p_update_bits(void *data, u32 mask, u32 value)
 	writel(val, entry->value);
 	spin_unlock_irqrestore(&entry->lock, flags);
 
-	if (val != orig)
+	return val != orig;
+}
+
+static int smp2p_update_bits(void *data, u32 mask, u32 value)
+{
+	struct smp2p_entry *entry = data;
+
+	if (__smp2p_update_bits(entry, mask, value))
 		qcom_smp2p_kick(entry->smp2p);
 
 	return 0;
 }
 
+static int smp2p_update_bits_nokick(void *data, u32 mask, u32 value)
+{
+	struct smp2p_entry *entry = data;
+
+	if (__smp2p_update_bits(entry, mask, value))
+		WRITE_ONCE(entry->smp2p->kick_pending, true);
+
+	return 0;
+}
+
+/* Entries of one edge share the interrupt, kick it once per batch */
+static void smp2p_kick(void *data)
+{
+	struct smp2p_entry *entry = data;
+
+	if (xchg(&entry->smp2p->kick_pending, false))
+		qcom_smp2p_kick(entry->smp2p);
+}
+
 static const struct qcom_smem_state_ops smp2p_state_ops = {
 	.update_bits = smp2p_update_bits,
+	.update_bits_nokick = smp2p_update_bits_nokick,
+	.kick = smp2p_kick,
 };
 
 static int qcom_smp2p_outbound_entry(struct qcom_smp2p *smp2p,
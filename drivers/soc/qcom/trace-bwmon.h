@@ -0,0 +1,57 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_bwmon
+
+#if !defined(_TRACE_QCOM_BWMON_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_QCOM_BWMON_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(bwmon_sample,
+	TP_PROTO(const char *name, unsigned int zone, unsigned int kbps),
+	TP_ARGS(name, zone, kbps),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned int, zone)
+		__field(unsigned int, kbps)
+	),
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->zone = zone;
+		__entry->kbps = kbps;
+	),
+	TP_printk("%s: zone %u %u kBps", __get_str(name), __entry->zone,
+		  __entry->kbps)
+);
+
+TRACE_EVENT(bwmon_update,
+	TP_PROTO(const char *name, unsigned int target_kbps,
+		 unsigned int up_kbps, unsigned int down_kbps),
+	TP_ARGS(name, target_kbps, up_kbps, down_kbps),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(unsigned int, target_kbps)
+		__field(unsigned int, up_kbps)
+		__field(unsigned int, down_kbps)
+	),
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->target_kbps = target_kbps;
+		__entry->up_kbps = up_kbps;
+		__entry->down_kbps = down_kbps;
+	),
+	TP_printk("%s: target %u kBps up %u kBps down %u kBps",
+		  __get_str(name), __entry->target_kbps, __entry->up_kbps,
+		  __entry->down_kbps)
+);
+
+#endif /* _TRACE_QCOM_BWMON_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace-bwmon
+
+#include <trace/define_trace.h>
@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM qcom_stats
+
+#if !defined(_TRACE_QCOM_STATS_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _TRACE_QCOM_STATS_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(qcom_stats_transition,
+	TP_PROTO(const char *name, u32 count, u64 entered_at, u64 exited_at,
+		 u64 residency, u64 wakeup, const char *culprit),
+	TP_ARGS(name, count, entered_at, exited_at, residency, wakeup, culprit),
+	TP_STRUCT__entry(
+		__string(name, name)
+		__field(u32, count)
+		__field(u64, entered_at)
+		__field(u64, exited_at)
+		__field(u64, residency)
+		__field(u64, wakeup)
+		__string(culprit, culprit)
+	),
+	TP_fast_assign(
+		__assign_str(name);
+		__entry->count = count;
+		__entry->entered_at = entered_at;
+		__entry->exited_at = exited_at;
+		__entry->residency = residency;
+		__entry->wakeup = wakeup;
+		__assign_str(culprit);
+	),
+	TP_printk("%s: count=%u entered=%llu exited=%llu residency=%llu wakeup=%llu culprit=%s",
+		  __get_str(name), __entry->count, __entry->entered_at,
+		  __entry->exited_at, __entry->residency, __entry->wakeup,
+		  __get_str(culprit))
+);
+
+#endif /* _TRACE_QCOM_STATS_H */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE trace-stats
+
+#include <trace/define_trace.h>
@@ -528,6 +528,97 @@ static int qcom_swrm_cmd_fifo_rd_cmd(struct qcom_swrm_ctrl *ctrl,
 	return SDW_CMD_IGNORED;
 }
 
+/*
+ * Push a run of unicast writes into the command FIFO, only looking at the
+ * FIFO status again once the space seen on the last check is used up.
+ */
+static int qcom_swrm_cmd_fifo_wr_bulk(struct qcom_swrm_ctrl *ctrl,
+				      u8 dev_addr, u16 reg_addr,
+				      u32 len, const u8 *buf)
+{
+	u32 fifo_outstanding_cmds, space = 0, val;
+	int i;
+
+	for (i = 0; i < len; i++) {
+		if (!space) {
+			if (swrm_wait_for_wr_fifo_avail(ctrl))
+				return SDW_CMD_FAIL_OTHER;
+
+			ctrl->reg_read(ctrl, ctrl->reg_layout[SWRM_REG_CMD_FIFO_STATUS],
+				       &val);
+			fifo_outstanding_cmds = FIELD_GET(SWRM_WR_CMD_FIFO_CNT_MASK, val);
+			space = ctrl->wr_fifo_depth - min(fifo_outstanding_cmds,
+							  ctrl->wr_fifo_depth);
+			if (!space)
+				space = 1;
+		}
+
+		val = swrm_get_packed_reg_val(&ctrl->wcmd_id, buf[i], dev_addr,
+					      reg_addr + i);
+		ctrl->reg_write(ctrl, ctrl->reg_layout[SWRM_REG_CMD_FIFO_WR_CMD], val);
+		space--;
+	}
+
+	return SDW_CMD_OK;
+}
+
+/*
+ * Queue up to a FIFO's worth of single byte reads back to back and drain
+ * the responses in one pass. Any cmd_id mismatch flushes the FIFO and
+ * returns SDW_CMD_IGNORED so the caller can redo the run one byte at a time.
+ */
+static int qcom_swrm_cmd_fifo_rd_bulk(struct qcom_swrm_ctrl *ctrl,
+				      u8 dev_addr, u16 reg_addr,
+				      u32 len, u8 *rval)
+{
+	u8 cmd_ids[FIELD_MAX(SWRM_COMP_PARAMS_RD_FIFO_DEPTH)];
+	int fifo_retry_count = SWR_OVERFLOW_RETRY_COUNT;
+	u32 avail, cmd_data, val;
+	int i;
+
+	if (WARN_ON(len > ARRAY_SIZE(cmd_ids)))
+		return SDW_CMD_FAIL_OTHER;
+
+	/* read commands also occupy the write fifo, start from empty */
+	if (!swrm_wait_for_wr_fifo_done(ctrl))
+		return SDW_CMD_FAIL_OTHER;
+
+	for (i = 0; i < len; i++) {
+		val = swrm_get_packed_reg_val(&ctrl->rcmd_id, 1, dev_addr,
+					      reg_addr + i);
+		cmd_ids[i] = ctrl->rcmd_id;
+		ctrl->reg_write(ctrl, ctrl->reg_layout[SWRM_REG_CMD_FIFO_RD_CMD], val);
+	}
+
+	for (i = 0; i < len;) {
+		ctrl->reg_read(ctrl, ctrl->reg_layout[SWRM_REG_CMD_FIFO_STATUS], &val);
+		avail = FIELD_GET(SWRM_RD_CMD_FIFO_CNT_MASK, val);
+		if (!avail) {
+			if (!fifo_retry_count--) {
+				dev_err_ratelimited(ctrl->dev,
+						    "%s err read underflow\n", __func__);
+				return SDW_CMD_FAIL_OTHER;
+			}
+			usleep_range(100, 105);
+			continue;
+		}
+
+		for (; avail && i < len; avail--, i++) {
+			ctrl->reg_read(ctrl,
+				       ctrl->reg_layout[SWRM_REG_CMD_FIFO_RD_FIFO_ADDR],
+				       &cmd_data);
+			if (FIELD_GET(SWRM_RD_FIFO_CMD_ID_MASK, cmd_data) != cmd_ids[i]) {
+				ctrl->reg_write(ctrl, SWRM_CMD_FIFO_CMD,
+						SWRM_CMD_FIFO_FLUSH);
+				return SDW_CMD_IGNORED;
+			}
+			rval[i] = cmd_data & 0xFF;
+		}
+	}
+
+	return SDW_CMD_OK;
+}
+
 static int qcom_swrm_get_alert_slave_dev_num(struct qcom_swrm_ctrl *ctrl)
 {
 	u32 val, status;
@@ -916,14 +1007,14 @@ static int qcom_swrm_read_prop(struct sdw_bus *bus)
 	return 0;
 }
 
-static enum sdw_command_response qcom_swrm_xfer_msg(struct sdw_bus *bus,
-						    struct sdw_msg *msg)
+static enum sdw_command_response qcom_swrm_xfer_one(struct qcom_swrm_ctrl *ctrl,
+						    struct sdw_msg *msg,
+						    int start)
 {
-	struct qcom_swrm_ctrl *ctrl = to_qcom_sdw(bus);
 	int ret, i, len;
 
 	if (msg->flags == SDW_MSG_FLAG_READ) {
-		for (i = 0; i < msg->len;) {
+		for (i = start; i < msg->len;) {
 			if ((msg->len - i) < QCOM_SWRM_MAX_RD_LEN)
 				len = msg->len - i;
 			else
@@ -938,7 +1029,7 @@ static enum sdw_command_response qcom_swrm_xfer_msg(struct sdw_bus *bus,
 			i = i + len;
 		}
 	} else if (msg->flags == SDW_MSG_FLAG_WRITE) {
-		for (i = 0; i < msg->len; i++) {
+		for (i = start; i < msg->len; i++) {
 			ret = qcom_swrm_cmd_fifo_wr_cmd(ctrl, msg->buf[i],
 							msg->dev_num,
 						       msg->addr + i);
@@ -950,6 +1041,51 @@ static enum sdw_command_response qcom_swrm_xfer_msg(struct sdw_bus *bus,
 	return SDW_CMD_OK;
 }
 
+static enum sdw_command_response qcom_swrm_xfer_msg(struct sdw_bus *bus,
+						    struct sdw_msg *msg)
+{
+	struct qcom_swrm_ctrl *ctrl = to_qcom_sdw(bus);
+	u32 batch;
+	int ret, i, len;
+
+	/*
+	 * v1.3 and older need settling delays between commands and broadcast
+	 * writes wait for their completion interrupt, so only multi-byte
+	 * unicast transfers on newer controllers go through the FIFO in bulk.
+	 */
+	if (msg->len < 2 || msg->dev_num == SDW_BROADCAST_DEV_NUM ||
+	    ctrl->version <= SWRM_VERSION_1_3_0)
+		return qcom_swrm_xfer_one(ctrl, msg, 0);
+
+	if (msg->flags == SDW_MSG_FLAG_WRITE) {
+		ret = qcom_swrm_cmd_fifo_wr_bulk(ctrl, msg->dev_num, msg->addr,
+						 msg->len, msg->buf);
+		return ret ? SDW_CMD_IGNORED : SDW_CMD_OK;
+	}
+
+	if (msg->flags != SDW_MSG_FLAG_READ)
+		return SDW_CMD_OK;
+
+	batch = min3(ctrl->rd_fifo_depth, ctrl->wr_fifo_depth,
+		     (u32)FIELD_MAX(SWRM_COMP_PARAMS_RD_FIFO_DEPTH));
+	if (!batch)
+		return qcom_swrm_xfer_one(ctrl, msg, 0);
+
+	for (i = 0; i < msg->len; i += len) {
+		len = min_t(u32, msg->len - i, batch);
+		ret = qcom_swrm_cmd_fifo_rd_bulk(ctrl, msg->dev_num,
+						 msg->addr + i, len,
+						 &msg->buf[i]);
+		/* lost track of the responses, redo the rest one at a time */
+		if (ret == SDW_CMD_IGNORED)
+			return qcom_swrm_xfer_one(ctrl, msg, i);
+		if (ret)
+			return ret;
+	}
+
+	return SDW_CMD_OK;
+}
+
 static int qcom_swrm_pre_bank_switch(struct sdw_bus *bus)
 {
 	u32 reg = SWRM_MCP_FRAME_CTRL_BANK_ADDR(bus->params.next_bank);
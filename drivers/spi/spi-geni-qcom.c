@@ -75,6 +75,15 @@
 #define GSI_CPHA		BIT(4)
 #define GSI_CPOL		BIT(5)
 
+/* Up to 3 TX TREs per transfer, keep a chain well within the 64 TRE ring */
+#define GSI_MAX_CHAINED_XFERS	16
+/*
+ * The SPI core only knows about the head of a chain and times it out after
+ * twice its own duration plus 200 ms. The rest of the chain has to fit in
+ * (half of) that slack.
+ */
+#define GSI_CHAIN_SLACK_US	(100 * USEC_PER_MSEC)
+
 struct spi_geni_master {
 	struct geni_se se;
 	struct device *dev;
@@ -101,6 +110,8 @@ struct spi_geni_master {
 	struct dma_chan *tx;
 	struct dma_chan *rx;
 	int cur_xfer_mode;
+	unsigned int gsi_chain_pending;
+	struct spi_transfer *gsi_chain_last;
 };
 
 static void spi_slv_setup(struct spi_geni_master *mas)
@@ -435,26 +446,39 @@ static void
 spi_gsi_callback_result(void *cb, const struct dmaengine_result *result)
 {
 	struct spi_controller *spi = cb;
+	struct spi_geni_master *mas = spi_controller_get_devdata(spi);
+
+	/* Already finalized after an error earlier in the chain */
+	if (!mas->gsi_chain_pending)
+		return;
 
-	spi->cur_msg->status = -EIO;
 	if (result->result != DMA_TRANS_NOERROR) {
 		dev_err(&spi->dev, "DMA txn failed: %d\n", result->result);
-		spi_finalize_current_transfer(spi);
-		return;
+		goto err;
 	}
 
-	if (!result->residue) {
-		spi->cur_msg->status = 0;
-		dev_dbg(&spi->dev, "DMA txn completed\n");
-	} else {
+	if (result->residue) {
 		dev_err(&spi->dev, "DMA xfer has pending: %d\n", result->residue);
+		goto err;
 	}
 
+	dev_dbg(&spi->dev, "DMA txn completed\n");
+
+	/* Only the last transfer of a chain completes the wait */
+	if (--mas->gsi_chain_pending)
+		return;
+
+	spi_finalize_current_transfer(spi);
+	return;
+
+err:
+	mas->gsi_chain_pending = 0;
+	spi->cur_msg->status = -EIO;
 	spi_finalize_current_transfer(spi);
 }
 
-static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas,
-			  struct spi_device *spi_slv, struct spi_controller *spi)
+static int prep_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas,
+			 struct spi_device *spi_slv, struct spi_controller *spi)
 {
 	unsigned long flags = DMA_PREP_INTERRUPT | DMA_CTRL_ACK;
 	struct dma_slave_config config = {};
@@ -536,11 +560,108 @@ static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas
 		dmaengine_submit(rx_desc);
 	dmaengine_submit(tx_desc);
 
-	if (peripheral.cmd & SPI_RX)
-		dma_async_issue_pending(mas->rx);
+	return 0;
+}
+
+/* Time on the wire, as estimated by spi_transfer_wait() */
+static u64 gsi_xfer_time_us(struct spi_transfer *xfer)
+{
+	u64 us = 8ULL * USEC_PER_SEC * xfer->len;
+
+	do_div(us, xfer->speed_hz ? : 100000);
+
+	return us;
+}
+
+/*
+ * Check whether the transfer following @xfer can be queued to the GPI rings
+ * together with it. The SPI core only acts between transfers for delays, CS
+ * changes and timestamps, so a chain must not need any of them. @budget_us
+ * is what is left of the time the core waits for the head of the chain.
+ */
+static bool can_chain_gsi_xfer(struct spi_transfer *xfer, struct spi_message *msg,
+			       unsigned int chained, u64 *budget_us)
+{
+	struct spi_transfer *next;
+	u64 us;
+
+	if (chained >= GSI_MAX_CHAINED_XFERS ||
+	    list_is_last(&xfer->transfer_list, &msg->transfers))
+		return false;
+
+	if (xfer->cs_change || xfer->cs_off || xfer->delay.value || xfer->ptp_sts)
+		return false;
+
+	next = list_next_entry(xfer, transfer_list);
+	if (!next->len || next->cs_off || next->ptp_sts || !next->tx_sg_mapped)
+		return false;
 
+	/* GPI only takes a single SG entry per descriptor */
+	if (next->tx_sg.nents != 1 ||
+	    (next->rx_buf && (!next->rx_sg_mapped || next->rx_sg.nents != 1)))
+		return false;
+
+	us = gsi_xfer_time_us(next);
+	if (us > *budget_us)
+		return false;
+	*budget_us -= us;
+
+	return true;
+}
+
+static int setup_gsi_xfer(struct spi_transfer *xfer, struct spi_geni_master *mas,
+			  struct spi_device *spi_slv, struct spi_controller *spi)
+{
+	struct spi_message *msg = spi->cur_msg;
+	u64 budget_us = gsi_xfer_time_us(xfer) + GSI_CHAIN_SLACK_US;
+	unsigned int chained = 0;
+	int ret;
+
+	/* Already queued and completed along with the head of its chain */
+	if (mas->gsi_chain_last) {
+		if (xfer == mas->gsi_chain_last)
+			mas->gsi_chain_last = NULL;
+		return 0;
+	}
+
+	/*
+	 * Queue the whole run of transfers that can go back to back, so the
+	 * controller moves from one to the next without waiting for us, and
+	 * only the last one wakes up the SPI core.
+	 */
+	while (1) {
+		ret = prep_gsi_xfer(xfer, mas, spi_slv, spi);
+		if (ret)
+			goto err_terminate;
+		chained++;
+
+		if (!can_chain_gsi_xfer(xfer, msg, chained, &budget_us))
+			break;
+
+		xfer = list_next_entry(xfer, transfer_list);
+
+		/* The core only syncs each transfer right before transfer_one */
+		dma_sync_sgtable_for_device(spi->cur_tx_dma_dev, &xfer->tx_sg,
+					    DMA_TO_DEVICE);
+		if (xfer->rx_sg_mapped)
+			dma_sync_sgtable_for_device(spi->cur_rx_dma_dev, &xfer->rx_sg,
+						    DMA_FROM_DEVICE);
+	}
+
+	mas->gsi_chain_pending = chained;
+	if (chained > 1)
+		mas->gsi_chain_last = xfer;
+
+	dma_async_issue_pending(mas->rx);
 	dma_async_issue_pending(mas->tx);
 	return 1;
+
+err_terminate:
+	if (chained) {
+		dmaengine_terminate_sync(mas->tx);
+		dmaengine_terminate_sync(mas->rx);
+	}
+	return ret;
 }
 
 static u32 get_xfer_len_in_words(struct spi_transfer *xfer,
@@ -596,7 +717,8 @@ static int spi_geni_prepare_message(struct spi_controller *spi,
 		return ret;
 
 	case GENI_GPI_DMA:
-		/* nothing to do for GPI DMA */
+		mas->gsi_chain_pending = 0;
+		mas->gsi_chain_last = NULL;
 		return 0;
 	}
 
@@ -1114,6 +1236,9 @@ static int spi_geni_probe(struct platform_device *pdev)
 	if (ret)
 		return ret;
 
+	/* Ordered after the wrapper and before the SPI devices by the tree */
+	device_enable_async_suspend(dev);
+
 	if (device_property_read_bool(&pdev->dev, "spi-slave"))
 		spi->target = true;
 
@@ -13,6 +13,8 @@
 #include <linux/pinctrl/consumer.h>
 #include <linux/pm_runtime.h>
 #include <linux/pm_opp.h>
+#include <linux/sizes.h>
+#include <linux/slab.h>
 #include <linux/spi/spi.h>
 #include <linux/spi/spi-mem.h>
 
@@ -164,15 +166,30 @@ enum qspi_clocks {
  */
 #define QSPI_MAX_SG 5
 
+/*
+ * Direct mapping reads chain up to QSPI_MAX_DESC descriptors of at most
+ * QSPI_DESC_MAX_LEN bytes each. The descriptor length is 16 bits wide, and
+ * keeping it a multiple of QSPI_ALIGN_REQ keeps every chunk aligned.
+ */
+#define QSPI_MAX_DESC		16
+#define QSPI_DESC_MAX_LEN	ALIGN_DOWN(U16_MAX, QSPI_ALIGN_REQ)
+#define QSPI_DIRMAP_MAX_LEN	(QSPI_MAX_DESC * QSPI_DESC_MAX_LEN)
+
+/* Bounce buffer for direct mapping reads into unaligned buffers */
+#define QSPI_DIRMAP_BOUNCE_LEN	SZ_4K
+
 struct qcom_qspi {
 	void __iomem *base;
 	struct device *dev;
 	struct clk_bulk_data *clks;
 	struct qspi_xfer xfer;
 	struct dma_pool *dma_cmd_pool;
-	dma_addr_t dma_cmd_desc[QSPI_MAX_SG];
-	void *virt_cmd_desc[QSPI_MAX_SG];
+	dma_addr_t dma_cmd_desc[QSPI_MAX_DESC];
+	void *virt_cmd_desc[QSPI_MAX_DESC];
 	unsigned int n_cmd_desc;
+	/* Set while a direct mapping read waits on mem_done */
+	bool mem_xfer;
+	struct completion mem_done;
 	struct icc_path *icc_path_cpu_to_qspi;
 	unsigned long last_speed;
 	/* Lock to protect data accessed by IRQs */
@@ -481,32 +498,35 @@ static int qcom_qspi_transfer_one(struct spi_controller *host,
 	return 1;
 }
 
-static int qcom_qspi_prepare_message(struct spi_controller *host,
-				     struct spi_message *message)
+static void qcom_qspi_select(struct qcom_qspi *ctrl, struct spi_device *spi)
 {
 	u32 mstr_cfg;
-	struct qcom_qspi *ctrl;
 	int tx_data_oe_delay = 1;
 	int tx_data_delay = 1;
 	unsigned long flags;
 
-	ctrl = spi_controller_get_devdata(host);
 	spin_lock_irqsave(&ctrl->lock, flags);
 
 	mstr_cfg = readl(ctrl->base + MSTR_CONFIG);
 	mstr_cfg &= ~CHIP_SELECT_NUM;
-	if (spi_get_chipselect(message->spi, 0))
+	if (spi_get_chipselect(spi, 0))
 		mstr_cfg |= CHIP_SELECT_NUM;
 
 	mstr_cfg |= FB_CLK_EN | PIN_WPN | PIN_HOLDN | SBL_EN | FULL_CYCLE_MODE;
 	mstr_cfg &= ~(SPI_MODE_MSK | TX_DATA_OE_DELAY_MSK | TX_DATA_DELAY_MSK);
-	mstr_cfg |= message->spi->mode << SPI_MODE_SHFT;
+	mstr_cfg |= spi->mode << SPI_MODE_SHFT;
 	mstr_cfg |= tx_data_oe_delay << TX_DATA_OE_DELAY_SHFT;
 	mstr_cfg |= tx_data_delay << TX_DATA_DELAY_SHFT;
 	mstr_cfg &= ~DMA_ENABLE;
 
 	writel(mstr_cfg, ctrl->base + MSTR_CONFIG);
 	spin_unlock_irqrestore(&ctrl->lock, flags);
+}
+
+static int qcom_qspi_prepare_message(struct spi_controller *host,
+				     struct spi_message *message)
+{
+	qcom_qspi_select(spi_controller_get_devdata(host), message->spi);
 
 	return 0;
 }
@@ -608,6 +628,14 @@ static irqreturn_t pio_write(struct qcom_qspi *ctrl)
 	return IRQ_HANDLED;
 }
 
+static void qcom_qspi_xfer_done(struct qcom_qspi *ctrl)
+{
+	if (ctrl->mem_xfer)
+		complete(&ctrl->mem_done);
+	else
+		spi_finalize_current_transfer(dev_get_drvdata(ctrl->dev));
+}
+
 static irqreturn_t qcom_qspi_irq(int irq, void *dev_id)
 {
 	u32 int_status;
@@ -643,7 +671,7 @@ static irqreturn_t qcom_qspi_irq(int irq, void *dev_id)
 
 	if (!ctrl->xfer.rem_bytes) {
 		writel(0, ctrl->base + MSTR_INT_EN);
-		spi_finalize_current_transfer(dev_get_drvdata(ctrl->dev));
+		qcom_qspi_xfer_done(ctrl);
 	}
 
 	/* DMA mode handling */
@@ -659,7 +687,7 @@ static irqreturn_t qcom_qspi_irq(int irq, void *dev_id)
 		ctrl->n_cmd_desc = 0;
 
 		ret = IRQ_HANDLED;
-		spi_finalize_current_transfer(dev_get_drvdata(ctrl->dev));
+		qcom_qspi_xfer_done(ctrl);
 	}
 
 	spin_unlock(&ctrl->lock);
@@ -686,8 +714,226 @@ static int qcom_qspi_adjust_op_size(struct spi_mem *mem, struct spi_mem_op *op)
 	return 0;
 }
 
+static int qcom_qspi_mem_wait(struct qcom_qspi *ctrl, unsigned int len,
+			      unsigned int buswidth)
+{
+	u64 ms;
+
+	ms = 8ULL * MSEC_PER_SEC * len;
+	do_div(ms, ctrl->last_speed * buswidth);
+	ms += ms + 200; /* some tolerance */
+
+	if (!wait_for_completion_timeout(&ctrl->mem_done,
+					 msecs_to_jiffies(ms))) {
+		dev_err(ctrl->dev, "dirmap transfer timed out\n");
+		qcom_qspi_handle_err(dev_get_drvdata(ctrl->dev), NULL);
+		return -ETIMEDOUT;
+	}
+
+	return 0;
+}
+
+/* Send one of the opcode/address/dummy phases of a dirmap read */
+static int qcom_qspi_mem_pio_tx(struct qcom_qspi *ctrl, const u8 *buf,
+				unsigned int len, unsigned int buswidth)
+{
+	unsigned long flags;
+	u32 mstr_cfg;
+
+	if (!len)
+		return 0;
+
+	reinit_completion(&ctrl->mem_done);
+
+	spin_lock_irqsave(&ctrl->lock, flags);
+	mstr_cfg = readl(ctrl->base + MSTR_CONFIG);
+	if (mstr_cfg & DMA_ENABLE) {
+		mstr_cfg &= ~DMA_ENABLE;
+		writel(mstr_cfg, ctrl->base + MSTR_CONFIG);
+	}
+
+	ctrl->xfer.dir = QSPI_WRITE;
+	ctrl->xfer.buswidth = buswidth;
+	ctrl->xfer.tx_buf = buf;
+	ctrl->xfer.is_last = false;
+	ctrl->xfer.rem_bytes = len;
+	qcom_qspi_pio_xfer(ctrl);
+	spin_unlock_irqrestore(&ctrl->lock, flags);
+
+	return qcom_qspi_mem_wait(ctrl, len, buswidth);
+}
+
+/*
+ * Receive the data phase of a dirmap read as one chain of descriptors, so
+ * the whole read only costs a single DMA_CHAIN_DONE interrupt.
+ */
+static int qcom_qspi_mem_dma_rx(struct qcom_qspi *ctrl, dma_addr_t dma_addr,
+				unsigned int len, unsigned int buswidth)
+{
+	unsigned int offs, chunk;
+	unsigned long flags;
+	u32 mstr_cfg;
+	int ret = 0;
+	int i;
+
+	reinit_completion(&ctrl->mem_done);
+
+	spin_lock_irqsave(&ctrl->lock, flags);
+	if (ctrl->n_cmd_desc) {
+		dev_err(ctrl->dev, "Remnant dma buffers n_cmd_desc-%d\n", ctrl->n_cmd_desc);
+		ret = -EIO;
+		goto exit;
+	}
+
+	mstr_cfg = readl(ctrl->base + MSTR_CONFIG);
+	if (!(mstr_cfg & DMA_ENABLE)) {
+		mstr_cfg |= DMA_ENABLE;
+		writel(mstr_cfg, ctrl->base + MSTR_CONFIG);
+	}
+
+	ctrl->xfer.dir = QSPI_READ;
+	ctrl->xfer.buswidth = buswidth;
+	ctrl->xfer.is_last = true;
+	ctrl->xfer.rem_bytes = len;
+
+	for (offs = 0; offs < len; offs += chunk) {
+		chunk = min_t(unsigned int, len - offs, QSPI_DESC_MAX_LEN);
+		ret = qcom_qspi_alloc_desc(ctrl, dma_addr + offs, chunk);
+		if (ret)
+			break;
+	}
+
+	if (ret) {
+		for (i = 0; i < ctrl->n_cmd_desc; i++)
+			dma_pool_free(ctrl->dma_cmd_pool, ctrl->virt_cmd_desc[i],
+					  ctrl->dma_cmd_desc[i]);
+		ctrl->n_cmd_desc = 0;
+		ctrl->xfer.rem_bytes = 0;
+		goto exit;
+	}
+
+	dma_wmb();
+	qcom_qspi_dma_xfer(ctrl);
+
+exit:
+	spin_unlock_irqrestore(&ctrl->lock, flags);
+
+	if (ret)
+		return ret;
+
+	return qcom_qspi_mem_wait(ctrl, len, buswidth);
+}
+
+static int qcom_qspi_dirmap_create(struct spi_mem_dirmap_desc *desc)
+{
+	struct spi_controller *host = desc->mem->spi->controller;
+	const struct spi_mem_op *op = &desc->info.op_tmpl;
+
+	/*
+	 * Only reads are accelerated, writes are page sized anyway. Without
+	 * an IOMMU the controller doesn't do DMA at all, see probe().
+	 */
+	if (op->data.dir != SPI_MEM_DATA_IN || !host->can_dma)
+		return -EOPNOTSUPP;
+
+	if (op->cmd.nbytes + op->addr.nbytes + op->dummy.nbytes >
+	    QSPI_MAX_BYTES_FIFO)
+		return -EOPNOTSUPP;
+
+	/* kmalloc() of a power of two size is naturally aligned */
+	desc->priv = kmalloc(QSPI_DIRMAP_BOUNCE_LEN, GFP_KERNEL);
+	if (!desc->priv)
+		return -ENOMEM;
+
+	return 0;
+}
+
+static void qcom_qspi_dirmap_destroy(struct spi_mem_dirmap_desc *desc)
+{
+	kfree(desc->priv);
+}
+
+static ssize_t qcom_qspi_dirmap_read(struct spi_mem_dirmap_desc *desc,
+				     u64 offs, size_t len, void *buf)
+{
+	struct spi_device *spi = desc->mem->spi;
+	struct qcom_qspi *ctrl = spi_controller_get_devdata(spi->controller);
+	const struct spi_mem_op *op = &desc->info.op_tmpl;
+	u64 addr = desc->info.offset + offs;
+	u8 cmd[QSPI_MAX_BYTES_FIFO];
+	u8 *addr_buf, *dummy_buf;
+	unsigned int rx_len;
+	dma_addr_t dma_addr;
+	void *rx_buf;
+	int ret;
+	int i;
+
+	/*
+	 * DMA straight into the caller's buffer when the controller can,
+	 * otherwise through the bounce buffer. Either way the read may come
+	 * up short and the caller loops for the rest.
+	 */
+	if (virt_addr_valid(buf) && IS_ALIGNED((uintptr_t)buf, QSPI_ALIGN_REQ) &&
+	    len >= QSPI_BYTES_PER_WORD) {
+		rx_buf = buf;
+		len = min_t(size_t, len, QSPI_DIRMAP_MAX_LEN);
+		len = ALIGN_DOWN(len, QSPI_BYTES_PER_WORD);
+		rx_len = len;
+	} else {
+		rx_buf = desc->priv;
+		len = min_t(size_t, len, QSPI_DIRMAP_BOUNCE_LEN);
+		/* The controller writes whole words, see qcom_qspi_setup_dma_desc() */
+		rx_len = ALIGN(len, QSPI_BYTES_PER_WORD);
+	}
+
+	for (i = 0; i < op->cmd.nbytes; i++)
+		cmd[i] = op->cmd.opcode >> (8 * (op->cmd.nbytes - i - 1));
+	addr_buf = cmd + op->cmd.nbytes;
+	for (i = 0; i < op->addr.nbytes; i++)
+		addr_buf[i] = addr >> (8 * (op->addr.nbytes - i - 1));
+	dummy_buf = addr_buf + op->addr.nbytes;
+	memset(dummy_buf, 0xff, op->dummy.nbytes);
+
+	ret = qcom_qspi_set_speed(ctrl, spi->max_speed_hz);
+	if (ret)
+		return ret;
+
+	dma_addr = dma_map_single(ctrl->dev, rx_buf, rx_len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(ctrl->dev, dma_addr))
+		return -ENOMEM;
+
+	qcom_qspi_select(ctrl, spi);
+	ctrl->mem_xfer = true;
+
+	ret = qcom_qspi_mem_pio_tx(ctrl, cmd, op->cmd.nbytes,
+				   op->cmd.buswidth);
+	if (!ret)
+		ret = qcom_qspi_mem_pio_tx(ctrl, addr_buf, op->addr.nbytes,
+					   op->addr.buswidth);
+	if (!ret)
+		ret = qcom_qspi_mem_pio_tx(ctrl, dummy_buf, op->dummy.nbytes,
+					   op->dummy.buswidth);
+	if (!ret)
+		ret = qcom_qspi_mem_dma_rx(ctrl, dma_addr, rx_len,
+					   op->data.buswidth);
+
+	ctrl->mem_xfer = false;
+	dma_unmap_single(ctrl->dev, dma_addr, rx_len, DMA_FROM_DEVICE);
+
+	if (ret)
+		return ret;
+
+	if (rx_buf != buf)
+		memcpy(buf, rx_buf, len);
+
+	return len;
+}
+
 static const struct spi_controller_mem_ops qcom_qspi_mem_ops = {
 	.adjust_op_size = qcom_qspi_adjust_op_size,
+	.dirmap_create = qcom_qspi_dirmap_create,
+	.dirmap_destroy = qcom_qspi_dirmap_destroy,
+	.dirmap_read = qcom_qspi_dirmap_read,
 };
 
 static int qcom_qspi_probe(struct platform_device *pdev)
@@ -708,6 +954,7 @@ static int qcom_qspi_probe(struct platform_device *pdev)
 	ctrl = spi_controller_get_devdata(host);
 
 	spin_lock_init(&ctrl->lock);
+	init_completion(&ctrl->mem_done);
 	ctrl->dev = dev;
 	ctrl->base = devm_platform_ioremap_resource(pdev, 0);
 	if (IS_ERR(ctrl->base))
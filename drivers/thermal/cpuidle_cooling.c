@@ -27,6 +27,9 @@ struct cpuidle_cooling_device {
 	unsigned long state;
 };
 
+/* CPUs already injected by a registered idle cooling device */
+static struct cpumask cpuidle_cooling_cpus;
+
 /**
  * cpuidle_cooling_runtime - Running time computation
  * @idle_duration_us: CPU idle time to inject in microseconds
@@ -155,10 +158,50 @@ static struct thermal_cooling_device_ops cpuidle_cooling_ops = {
 	.set_cur_state = cpuidle_cooling_set_cur_state,
 };
 
+/**
+ * cpuidle_cooling_get_cpus - Get the CPUs to inject idle cycles into
+ * @np: the thermal-idle device node
+ * @drv: the cpuidle driver of the CPU @np belongs to
+ * @cpu: the CPU @np belongs to
+ * @cpus: the cpumask to be filled
+ *
+ * The CPUs are given by the optional "cpus" phandle list of the node, so
+ * a cluster, like the big cores of a DynamIQ system, can be idled in
+ * lockstep and reach its cluster idle state even when the cpuidle driver
+ * is registered per CPU as PSCI does. Without it, the CPUs of @drv are
+ * injected.
+ *
+ * Return: zero on success, -EINVAL if the list is invalid or does not
+ * contain @cpu
+ */
+static int cpuidle_cooling_get_cpus(struct device_node *np,
+				    struct cpuidle_driver *drv, int cpu,
+				    struct cpumask *cpus)
+{
+	struct device_node *cpu_np;
+	int i, id;
+
+	if (!of_property_present(np, "cpus")) {
+		cpumask_copy(cpus, drv->cpumask);
+		return 0;
+	}
+
+	for (i = 0; (cpu_np = of_parse_phandle(np, "cpus", i)); i++) {
+		id = of_cpu_node_to_id(cpu_np);
+		of_node_put(cpu_np);
+		if (id < 0)
+			return -EINVAL;
+		cpumask_set_cpu(id, cpus);
+	}
+
+	return cpumask_test_cpu(cpu, cpus) ? 0 : -EINVAL;
+}
+
 /**
  * __cpuidle_cooling_register: register the cooling device
- * @drv: a cpuidle driver structure pointer
  * @np: a device node structure pointer used for the thermal binding
+ * @drv: a cpuidle driver structure pointer
+ * @cpu: the CPU @np belongs to
  *
  * This function is in charge of allocating the cpuidle cooling device
  * structure, the idle injection, initialize them and register the
@@ -168,7 +211,7 @@ static struct thermal_cooling_device_ops cpuidle_cooling_ops = {
  * underlying subsystem in case of error
  */
 static int __cpuidle_cooling_register(struct device_node *np,
-				      struct cpuidle_driver *drv)
+				      struct cpuidle_driver *drv, int cpu)
 {
 	struct idle_inject_device *ii_dev;
 	struct cpuidle_cooling_device *idle_cdev;
@@ -176,16 +219,24 @@ static int __cpuidle_cooling_register(struct device_node *np,
 	struct device *dev;
 	unsigned int idle_duration_us = TICK_USEC;
 	unsigned int latency_us = UINT_MAX;
+	cpumask_var_t cpus;
 	char *name;
 	int ret;
 
+	if (!zalloc_cpumask_var(&cpus, GFP_KERNEL))
+		return -ENOMEM;
+
+	ret = cpuidle_cooling_get_cpus(np, drv, cpu, cpus);
+	if (ret)
+		goto out;
+
 	idle_cdev = kzalloc(sizeof(*idle_cdev), GFP_KERNEL);
 	if (!idle_cdev) {
 		ret = -ENOMEM;
 		goto out;
 	}
 
-	ii_dev = idle_inject_register(drv->cpumask);
+	ii_dev = idle_inject_register(cpus);
 	if (!ii_dev) {
 		ret = -EINVAL;
 		goto out_kfree;
@@ -199,7 +250,7 @@ static int __cpuidle_cooling_register(struct device_node *np,
 
 	idle_cdev->ii_dev = ii_dev;
 
-	dev = get_cpu_device(cpumask_first(drv->cpumask));
+	dev = get_cpu_device(cpumask_first(cpus));
 
 	name = kasprintf(GFP_KERNEL, "idle-%s", dev_name(dev));
 	if (!name) {
@@ -214,10 +265,13 @@ static int __cpuidle_cooling_register(struct device_node *np,
 		goto out_kfree_name;
 	}
 
-	pr_debug("%s: Idle injection set with idle duration=%u, latency=%u\n",
-		 name, idle_duration_us, latency_us);
+	pr_debug("%s: Idle injection set with idle duration=%u, latency=%u, cpus=%*pbl\n",
+		 name, idle_duration_us, latency_us, cpumask_pr_args(cpus));
+
+	cpumask_or(&cpuidle_cooling_cpus, &cpuidle_cooling_cpus, cpus);
 
 	kfree(name);
+	free_cpumask_var(cpus);
 
 	return 0;
 
@@ -228,6 +282,7 @@ static int __cpuidle_cooling_register(struct device_node *np,
 out_kfree:
 	kfree(idle_cdev);
 out:
+	free_cpumask_var(cpus);
 	return ret;
 }
 
@@ -246,6 +301,10 @@ void cpuidle_cooling_register(struct cpuidle_driver *drv)
 
 	for_each_cpu(cpu, drv->cpumask) {
 
+		/* Already injected along with the rest of its cluster */
+		if (cpumask_test_cpu(cpu, &cpuidle_cooling_cpus))
+			continue;
+
 		cpu_node = of_cpu_device_node_get(cpu);
 
 		cooling_node = of_get_child_by_name(cpu_node, "thermal-idle");
@@ -257,7 +316,7 @@ void cpuidle_cooling_register(struct cpuidle_driver *drv)
 			continue;
 		}
 
-		ret = __cpuidle_cooling_register(cooling_node, drv);
+		ret = __cpuidle_cooling_register(cooling_node, drv, cpu);
 
 		of_node_put(cooling_node);
 
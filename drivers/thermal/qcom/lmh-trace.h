@@ -0,0 +1,53 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM lmh
+
+#if !defined(__LMH_TRACE_H__) || defined(TRACE_HEADER_MULTI_READ)
+#define __LMH_TRACE_H__
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(lmh_throttle_start,
+	TP_PROTO(int cpu),
+
+	TP_ARGS(cpu),
+
+	TP_STRUCT__entry(
+		__field(int, cpu)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+	),
+
+	TP_printk("cpu = %d", __entry->cpu)
+);
+
+TRACE_EVENT(lmh_throttle_end,
+	TP_PROTO(int cpu, u64 duration_ns),
+
+	TP_ARGS(cpu, duration_ns),
+
+	TP_STRUCT__entry(
+		__field(int, cpu)
+		__field(u64, duration_ns)
+	),
+
+	TP_fast_assign(
+		__entry->cpu = cpu;
+		__entry->duration_ns = duration_ns;
+	),
+
+	TP_printk("cpu = %d, duration = %llu ns",
+		  __entry->cpu, __entry->duration_ns)
+);
+
+#endif /* __LMH_TRACE_H__ */
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE lmh-trace
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
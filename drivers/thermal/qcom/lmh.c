@@ -10,8 +10,13 @@
 #include <linux/platform_device.h>
 #include <linux/of_platform.h>
 #include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/ktime.h>
 #include <linux/firmware/qcom/qcom_scm.h>
 
+#define CREATE_TRACE_POINTS
+#include "lmh-trace.h"
+
 #define LMH_NODE_DCVS			0x44435653
 #define LMH_CLUSTER0_NODE_ID		0x6370302D
 #define LMH_CLUSTER1_NODE_ID		0x6370312D
@@ -34,13 +39,98 @@ struct lmh_hw_data {
 	void __iomem *base;
 	struct irq_domain *domain;
 	int irq;
+	int cpu;
+
+	/* Throttling episode accounting, protected by @lock */
+	spinlock_t lock;
+	bool throttled;
+	ktime_t throttle_start;
+	u64 throttle_count;
+	u64 throttle_time_ns;
+};
+
+/*
+ * The cpufreq driver disables the interrupt when it starts handling a
+ * throttling event and enables it again once the limit has been lifted, so
+ * an episode runs from the interrupt to the next enable.
+ */
+static void lmh_throttle_begin(struct lmh_hw_data *lmh_data)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&lmh_data->lock, flags);
+	if (!lmh_data->throttled) {
+		lmh_data->throttled = true;
+		lmh_data->throttle_start = ktime_get();
+		lmh_data->throttle_count++;
+		trace_lmh_throttle_start(lmh_data->cpu);
+	}
+	spin_unlock_irqrestore(&lmh_data->lock, flags);
+}
+
+static void lmh_throttle_end(struct lmh_hw_data *lmh_data)
+{
+	unsigned long flags;
+	u64 duration;
+
+	spin_lock_irqsave(&lmh_data->lock, flags);
+	if (lmh_data->throttled) {
+		lmh_data->throttled = false;
+		duration = ktime_to_ns(ktime_sub(ktime_get(),
+						 lmh_data->throttle_start));
+		lmh_data->throttle_time_ns += duration;
+		trace_lmh_throttle_end(lmh_data->cpu, duration);
+	}
+	spin_unlock_irqrestore(&lmh_data->lock, flags);
+}
+
+static ssize_t throttle_count_show(struct device *dev,
+				   struct device_attribute *attr, char *buf)
+{
+	struct lmh_hw_data *lmh_data = dev_get_drvdata(dev);
+	unsigned long flags;
+	u64 count;
+
+	spin_lock_irqsave(&lmh_data->lock, flags);
+	count = lmh_data->throttle_count;
+	spin_unlock_irqrestore(&lmh_data->lock, flags);
+
+	return sysfs_emit(buf, "%llu\n", count);
+}
+static DEVICE_ATTR_RO(throttle_count);
+
+static ssize_t throttle_time_ms_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct lmh_hw_data *lmh_data = dev_get_drvdata(dev);
+	unsigned long flags;
+	u64 time_ns;
+
+	spin_lock_irqsave(&lmh_data->lock, flags);
+	time_ns = lmh_data->throttle_time_ns;
+	if (lmh_data->throttled)
+		time_ns += ktime_to_ns(ktime_sub(ktime_get(),
+						 lmh_data->throttle_start));
+	spin_unlock_irqrestore(&lmh_data->lock, flags);
+
+	return sysfs_emit(buf, "%llu\n", div_u64(time_ns, NSEC_PER_MSEC));
+}
+static DEVICE_ATTR_RO(throttle_time_ms);
+
+static struct attribute *lmh_attrs[] = {
+	&dev_attr_throttle_count.attr,
+	&dev_attr_throttle_time_ms.attr,
+	NULL
 };
+ATTRIBUTE_GROUPS(lmh);
 
 static irqreturn_t lmh_handle_irq(int hw_irq, void *data)
 {
 	struct lmh_hw_data *lmh_data = data;
 	int irq = irq_find_mapping(lmh_data->domain, 0);
 
+	lmh_throttle_begin(lmh_data);
+
 	/* Call the cpufreq driver to handle the interrupt */
 	if (irq)
 		generic_handle_irq(irq);
@@ -52,6 +142,8 @@ static void lmh_enable_interrupt(struct irq_data *d)
 {
 	struct lmh_hw_data *lmh_data = irq_data_get_irq_chip_data(d);
 
+	lmh_throttle_end(lmh_data);
+
 	/* Clear the existing interrupt */
 	writel(0xff, lmh_data->base + LMH_REG_DCVS_INTR_CLR);
 	enable_irq(lmh_data->irq);
@@ -106,11 +198,15 @@ static int lmh_probe(struct platform_device *pdev)
 	if (IS_ERR(lmh_data->base))
 		return PTR_ERR(lmh_data->base);
 
+	spin_lock_init(&lmh_data->lock);
+	platform_set_drvdata(pdev, lmh_data);
+
 	cpu_node = of_parse_phandle(np, "cpus", 0);
 	if (!cpu_node)
 		return -EINVAL;
 	cpu_id = of_cpu_node_to_id(cpu_node);
 	of_node_put(cpu_node);
+	lmh_data->cpu = cpu_id;
 
 	ret = of_property_read_u32(np, "qcom,lmh-temp-high-millicelsius", &temp_high);
 	if (ret) {
@@ -235,6 +331,7 @@ static struct platform_driver lmh_driver = {
 	.driver = {
 		.name = "qcom-lmh",
 		.of_match_table = lmh_table,
+		.dev_groups = lmh_groups,
 		.suppress_bind_attrs = true,
 	},
 };
@@ -1153,6 +1153,10 @@ static const struct thermal_zone_device_ops tsens_of_ops = {
 	.set_trips = tsens_set_trips,
 };
 
+/*
+ * Returns the interrupt number on success, 0 if the DT does not describe the
+ * interrupt, or a negative errno.
+ */
 static int tsens_register_irq(struct tsens_priv *priv, char *irqname,
 			      irq_handler_t thread_fn)
 {
@@ -1183,11 +1187,13 @@ static int tsens_register_irq(struct tsens_priv *priv, char *irqname,
 							dev_name(&pdev->dev),
 							priv);
 
-		if (ret)
+		if (ret) {
 			dev_err(&pdev->dev, "%s: failed to get irq\n",
 				__func__);
-		else
+		} else {
 			enable_irq_wake(irq);
+			ret = irq;
+		}
 	}
 
 	put_device(&pdev->dev);
@@ -1226,7 +1232,7 @@ int tsens_resume_common(struct tsens_priv *priv)
 
 static int tsens_register(struct tsens_priv *priv)
 {
-	int i, ret;
+	int i, ret, irq;
 	struct thermal_zone_device *tzd;
 
 	for (i = 0;  i < priv->num_sensors; i++) {
@@ -1257,19 +1263,36 @@ static int tsens_register(struct tsens_priv *priv)
 	}
 
 	if (priv->feat->combo_int) {
-		ret = tsens_register_irq(priv, "combined",
+		irq = tsens_register_irq(priv, "combined",
 					 tsens_combined_irq_thread);
+		if (irq < 0)
+			return irq;
 	} else {
-		ret = tsens_register_irq(priv, "uplow", tsens_irq_thread);
-		if (ret < 0)
-			return ret;
+		irq = tsens_register_irq(priv, "uplow", tsens_irq_thread);
+		if (irq < 0)
+			return irq;
 
-		if (priv->feat->crit_int)
+		if (priv->feat->crit_int) {
 			ret = tsens_register_irq(priv, "critical",
 						 tsens_critical_irq_thread);
+			if (ret < 0)
+				return ret;
+		}
 	}
 
-	return ret;
+	/*
+	 * The up/low interrupt reports every crossing of the window that
+	 * tsens_set_trips() programs, so polling is only needed while
+	 * passive cooling is active. Old DTs without the interrupt keep
+	 * polling.
+	 */
+	if (irq) {
+		for (i = 0; i < priv->num_sensors; i++)
+			if (priv->sensor[i].tzd)
+				thermal_zone_device_stop_idle_polling(priv->sensor[i].tzd);
+	}
+
+	return 0;
 }
 
 static int tsens_probe(struct platform_device *pdev)
@@ -1324,6 +1347,7 @@ static int tsens_probe(struct platform_device *pdev)
 	priv->fields = data->fields;
 
 	platform_set_drvdata(pdev, priv);
+	device_enable_async_suspend(dev);
 
 	if (!priv->ops || !priv->ops->init || !priv->ops->get_temp)
 		return -EINVAL;
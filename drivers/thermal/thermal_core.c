@@ -635,6 +635,27 @@ static int thermal_zone_device_set_mode(struct thermal_zone_device *tz,
 	return 0;
 }
 
+/**
+ * thermal_zone_device_stop_idle_polling - stop polling a zone while idle
+ * @tz: thermal zone device
+ *
+ * Used by drivers whose sensor raises an interrupt when the temperature
+ * leaves the window programmed through the .set_trips() callback. The zone
+ * is then updated when a trip is crossed, and polling at the passive delay
+ * is only done while passive cooling is in progress.
+ */
+void thermal_zone_device_stop_idle_polling(struct thermal_zone_device *tz)
+{
+	mutex_lock(&tz->lock);
+
+	tz->polling_delay_jiffies = 0;
+	if (!tz->passive)
+		thermal_zone_device_set_polling(tz, 0);
+
+	mutex_unlock(&tz->lock);
+}
+EXPORT_SYMBOL_GPL(thermal_zone_device_stop_idle_polling);
+
 int thermal_zone_device_enable(struct thermal_zone_device *tz)
 {
 	return thermal_zone_device_set_mode(tz, THERMAL_DEVICE_ENABLED);
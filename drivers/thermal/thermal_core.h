@@ -73,6 +73,9 @@ struct thermal_governor {
  *			drivers should use thermal_zone_get_temp() to get the
  *			current temperature
  * @last_temperature:	previous temperature read
+ * @cached_temperature: last temperature returned by the driver, see
+ *			thermal_zone_get_temp()
+ * @cached_time:	time at which @cached_temperature was read
  * @emul_temperature:	emulated temperature when using CONFIG_THERMAL_EMULATION
  * @passive:		1 if you've crossed a passive trip point, 0 otherwise.
  * @prev_low_trip:	the low current temperature if you've crossed a passive
@@ -113,6 +116,8 @@ struct thermal_zone_device {
 	unsigned long recheck_delay_jiffies;
 	int temperature;
 	int last_temperature;
+	int cached_temperature;
+	ktime_t cached_time;
 	int emul_temperature;
 	int passive;
 	int prev_low_trip;
@@ -15,6 +15,8 @@
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/export.h>
+#include <linux/ktime.h>
+#include <linux/moduleparam.h>
 #include <linux/slab.h>
 #include <linux/string.h>
 #include <linux/sysfs.h>
@@ -22,6 +24,11 @@
 #include "thermal_core.h"
 #include "thermal_trace.h"
 
+static unsigned int temp_cache_ms;
+module_param(temp_cache_ms, uint, 0644);
+MODULE_PARM_DESC(temp_cache_ms,
+		 "Serve thermal_zone_get_temp() from a reading at most this old, in ms (0 = disabled)");
+
 int get_tz_trend(struct thermal_zone_device *tz, const struct thermal_trip *trip)
 {
 	enum thermal_trend trend;
@@ -132,8 +139,13 @@ int __thermal_zone_get_temp(struct thermal_zone_device *tz, int *temp)
 			*temp = tz->emul_temperature;
 	}
 
-	if (ret)
+	if (ret) {
 		dev_dbg(&tz->device, "Failed to get temperature: %d\n", ret);
+		tz->cached_time = 0;
+	} else {
+		tz->cached_temperature = *temp;
+		tz->cached_time = ktime_get();
+	}
 
 	return ret;
 }
@@ -146,6 +158,11 @@ int __thermal_zone_get_temp(struct thermal_zone_device *tz, int *temp)
  * When a valid thermal zone reference is passed, it will fetch its
  * temperature and fill @temp.
  *
+ * If the temp_cache_ms parameter is set and the zone was read more recently
+ * than that, the previous reading is returned without calling the driver.
+ * This keeps bursts of hwmon, sysfs and netlink reads from each hitting the
+ * sensor. Zone updates always read the sensor and refresh the cached value.
+ *
  * Return: On success returns 0, an error code otherwise
  */
 int thermal_zone_get_temp(struct thermal_zone_device *tz, int *temp)
@@ -162,7 +179,15 @@ int thermal_zone_get_temp(struct thermal_zone_device *tz, int *temp)
 		goto unlock;
 	}
 
-	ret = __thermal_zone_get_temp(tz, temp);
+	if (temp_cache_ms && tz->cached_time &&
+	    ktime_before(ktime_get(), ktime_add_ms(tz->cached_time,
+						   temp_cache_ms))) {
+		*temp = tz->cached_temperature;
+		ret = 0;
+	} else {
+		ret = __thermal_zone_get_temp(tz, temp);
+	}
+
 	if (!ret && *temp <= THERMAL_TEMP_INVALID)
 		ret = -ENODATA;
 
@@ -97,6 +97,7 @@
 #define BYTES_PER_FIFO_WORD		4U
 
 #define DMA_RX_BUF_SIZE		2048
+#define DMA_RX_BUF_NUM		2
 
 struct qcom_geni_device_data {
 	bool console;
@@ -126,7 +127,8 @@ struct qcom_geni_serial_port {
 	bool setup;
 	unsigned int baud;
 	unsigned long clk_rate;
-	void *rx_buf;
+	void *rx_buf[DMA_RX_BUF_NUM];
+	unsigned int rx_buf_idx;
 	u32 loopback;
 	bool brk;
 
@@ -565,17 +567,16 @@ static void handle_rx_console(struct uart_port *uport, u32 bytes, bool drop)
 }
 #endif /* CONFIG_SERIAL_QCOM_GENI_CONSOLE */
 
-static void handle_rx_uart(struct uart_port *uport, u32 bytes, bool drop)
+static void handle_rx_uart(struct uart_port *uport, void *buf, u32 bytes)
 {
-	struct qcom_geni_serial_port *port = to_dev_port(uport);
 	struct tty_port *tport = &uport->state->port;
 	int ret;
 
-	ret = tty_insert_flip_string(tport, port->rx_buf, bytes);
+	ret = tty_insert_flip_string(tport, buf, bytes);
 	if (ret != bytes) {
-		dev_err(uport->dev, "%s:Unable to push data ret %d_bytes %d\n",
-				__func__, ret, bytes);
-		WARN_ON_ONCE(1);
+		dev_err_ratelimited(uport->dev, "%s:Unable to push data ret %d_bytes %d\n",
+				    __func__, ret, bytes);
+		uport->icount.buf_overrun += bytes - ret;
 	}
 	uport->icount.rx += ret;
 	tty_flip_buffer_push(tport);
@@ -810,7 +811,7 @@ static void qcom_geni_serial_start_rx_dma(struct uart_port *uport)
 
 	geni_se_setup_s_cmd(&port->se, UART_START_READ, UART_PARAM_RFR_OPEN);
 
-	ret = geni_se_rx_dma_prep(&port->se, port->rx_buf,
+	ret = geni_se_rx_dma_prep(&port->se, port->rx_buf[port->rx_buf_idx],
 				  DMA_RX_BUF_SIZE,
 				  &port->rx_dma_addr);
 	if (ret) {
@@ -822,6 +823,7 @@ static void qcom_geni_serial_start_rx_dma(struct uart_port *uport)
 static void qcom_geni_serial_handle_rx_dma(struct uart_port *uport, bool drop)
 {
 	struct qcom_geni_serial_port *port = to_dev_port(uport);
+	void *buf = port->rx_buf[port->rx_buf_idx];
 	u32 rx_in;
 	int ret;
 
@@ -840,16 +842,22 @@ static void qcom_geni_serial_handle_rx_dma(struct uart_port *uport, bool drop)
 		return;
 	}
 
-	if (!drop)
-		handle_rx_uart(uport, rx_in, drop);
-
-	ret = geni_se_rx_dma_prep(&port->se, port->rx_buf,
+	/*
+	 * Re-arm with the other buffer before handing this one to the tty
+	 * layer, so that only the RX FIFO has to absorb incoming data while
+	 * the DMA is idle, not the flip buffer copy as well.
+	 */
+	port->rx_buf_idx = (port->rx_buf_idx + 1) % DMA_RX_BUF_NUM;
+	ret = geni_se_rx_dma_prep(&port->se, port->rx_buf[port->rx_buf_idx],
 				  DMA_RX_BUF_SIZE,
 				  &port->rx_dma_addr);
 	if (ret) {
 		dev_err(uport->dev, "unable to start RX SE DMA: %d\n", ret);
 		qcom_geni_serial_stop_rx_dma(uport);
 	}
+
+	if (!drop)
+		handle_rx_uart(uport, buf, rx_in);
 }
 
 static void qcom_geni_serial_start_rx(struct uart_port *uport)
@@ -1059,7 +1067,6 @@ static irqreturn_t qcom_geni_serial_isr(int isr, void *dev)
 static int setup_fifos(struct qcom_geni_serial_port *port)
 {
 	struct uart_port *uport;
-	u32 old_rx_fifo_depth = port->rx_fifo_depth;
 
 	uport = &port->uport;
 	port->tx_fifo_depth = geni_se_get_tx_fifo_depth(&port->se);
@@ -1068,19 +1075,6 @@ static int setup_fifos(struct qcom_geni_serial_port *port)
 	uport->fifosize =
 		(port->tx_fifo_depth * port->tx_fifo_width) / BITS_PER_BYTE;
 
-	if (port->rx_buf && (old_rx_fifo_depth != port->rx_fifo_depth) && port->rx_fifo_depth) {
-		/*
-		 * Use krealloc rather than krealloc_array because rx_buf is
-		 * accessed as 1 byte entries as well as 4 byte entries so it's
-		 * not necessarily an array.
-		 */
-		port->rx_buf = devm_krealloc(uport->dev, port->rx_buf,
-					     port->rx_fifo_depth * sizeof(u32),
-					     GFP_KERNEL);
-		if (!port->rx_buf)
-			return -ENOMEM;
-	}
-
 	return 0;
 }
 
@@ -1593,6 +1587,7 @@ static int qcom_geni_serial_probe(struct platform_device *pdev)
 	struct uart_port *uport;
 	struct resource *res;
 	int irq;
+	int i;
 	struct uart_driver *drv;
 	const struct qcom_geni_device_data *data;
 
@@ -1642,10 +1637,12 @@ static int qcom_geni_serial_probe(struct platform_device *pdev)
 	port->tx_fifo_width = DEF_FIFO_WIDTH_BITS;
 
 	if (!data->console) {
-		port->rx_buf = devm_kzalloc(uport->dev,
-					    DMA_RX_BUF_SIZE, GFP_KERNEL);
-		if (!port->rx_buf)
-			return -ENOMEM;
+		for (i = 0; i < DMA_RX_BUF_NUM; i++) {
+			port->rx_buf[i] = devm_kzalloc(uport->dev,
+						       DMA_RX_BUF_SIZE, GFP_KERNEL);
+			if (!port->rx_buf[i])
+				return -ENOMEM;
+		}
 	}
 
 	ret = geni_icc_get(&port->se, NULL);
@@ -2,6 +2,11 @@
 // Copyright (C) 2020 Intel Corporation
 
 #include <linux/debugfs.h>
+#include <linux/log2.h>
+#include <linux/percpu.h>
+#include <linux/slab.h>
+#include <scsi/scsi_cmnd.h>
+#include <scsi/scsi_proto.h>
 
 #include "ufs-debugfs.h"
 #include <ufs/ufshcd.h>
@@ -202,10 +207,356 @@ static const struct file_operations ufs_saved_err_fops = {
 	.release	= single_release,
 };
 
+enum ufs_debugfs_op {
+	UFS_DEBUGFS_OP_READ,
+	UFS_DEBUGFS_OP_WRITE,
+	UFS_DEBUGFS_OP_UNMAP,
+	UFS_DEBUGFS_OP_FLUSH,
+	UFS_DEBUGFS_OP_OTHER,
+	UFS_DEBUGFS_OP_MAX,
+};
+
+static const char * const ufs_debugfs_op_names[UFS_DEBUGFS_OP_MAX] = {
+	[UFS_DEBUGFS_OP_READ]	= "read",
+	[UFS_DEBUGFS_OP_WRITE]	= "write",
+	[UFS_DEBUGFS_OP_UNMAP]	= "unmap",
+	[UFS_DEBUGFS_OP_FLUSH]	= "flush",
+	[UFS_DEBUGFS_OP_OTHER]	= "other",
+};
+
+/*
+ * Latency bucket 0 counts completions below 1 us, bucket n (n > 0) counts
+ * completions in [2^(n-1), 2^n) us and the last bucket everything above.
+ * Queue depth bucket n counts commands issued with [2^n, 2^(n+1)) commands
+ * in flight, including the command itself.
+ */
+#define UFS_DEBUGFS_LAT_BUCKETS	24
+#define UFS_DEBUGFS_QD_BUCKETS	10
+
+struct ufs_debugfs_lat {
+	u64 hist[UFS_DEBUGFS_OP_MAX][UFS_DEBUGFS_LAT_BUCKETS];
+	u64 sum_us[UFS_DEBUGFS_OP_MAX];
+	u64 qd[UFS_DEBUGFS_QD_BUCKETS];
+};
+
+/**
+ * struct ufs_debugfs_perf - command latency and hibern8 statistics
+ * @lat: per-CPU latency and queue depth histograms, updated locklessly from
+ *	the issue and completion paths
+ * @inflight: number of SCSI commands currently owned by the controller
+ * @h8_lock: serializes the hibern8 counters below
+ * @h8_enter_cnt: number of successful hibern8 entries
+ * @h8_exit_cnt: number of successful hibern8 exits
+ * @h8_enter_err: number of failed hibern8 entries
+ * @h8_exit_err: number of failed hibern8 exits
+ * @h8_enter_us: total time spent in DME_HIBERNATE_ENTER
+ * @h8_exit_us: total time spent in DME_HIBERNATE_EXIT
+ * @h8_resident_us: total time the link spent in hibern8
+ * @h8_entered: time of the last hibern8 entry, zero while not in hibern8
+ */
+struct ufs_debugfs_perf {
+	struct ufs_debugfs_lat __percpu *lat;
+	atomic_t inflight;
+	spinlock_t h8_lock;
+	u64 h8_enter_cnt;
+	u64 h8_exit_cnt;
+	u64 h8_enter_err;
+	u64 h8_exit_err;
+	u64 h8_enter_us;
+	u64 h8_exit_us;
+	u64 h8_resident_us;
+	ktime_t h8_entered;
+};
+
+static enum ufs_debugfs_op ufs_debugfs_cmd_op(const struct scsi_cmnd *cmd)
+{
+	switch (cmd->cmnd[0]) {
+	case READ_6:
+	case READ_10:
+	case READ_16:
+		return UFS_DEBUGFS_OP_READ;
+	case WRITE_6:
+	case WRITE_10:
+	case WRITE_16:
+		return UFS_DEBUGFS_OP_WRITE;
+	case UNMAP:
+		return UFS_DEBUGFS_OP_UNMAP;
+	case SYNCHRONIZE_CACHE:
+	case SYNCHRONIZE_CACHE_16:
+		return UFS_DEBUGFS_OP_FLUSH;
+	default:
+		return UFS_DEBUGFS_OP_OTHER;
+	}
+}
+
+void ufs_debugfs_cmd_issue(struct ufs_hba *hba)
+{
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+	int depth;
+
+	if (!perf)
+		return;
+
+	depth = atomic_inc_return(&perf->inflight);
+	this_cpu_inc(perf->lat->qd[min(ilog2(depth),
+				       UFS_DEBUGFS_QD_BUCKETS - 1)]);
+}
+
+void ufs_debugfs_cmd_compl(struct ufs_hba *hba, struct ufshcd_lrb *lrbp)
+{
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+	enum ufs_debugfs_op op;
+	unsigned int b;
+	s64 us;
+
+	if (!perf)
+		return;
+
+	op = ufs_debugfs_cmd_op(lrbp->cmd);
+	us = ktime_us_delta(lrbp->compl_time_stamp, lrbp->issue_time_stamp);
+	if (us <= 0)
+		b = 0;
+	else
+		b = min_t(unsigned int, ilog2(us) + 1,
+			  UFS_DEBUGFS_LAT_BUCKETS - 1);
+	this_cpu_inc(perf->lat->hist[op][b]);
+	this_cpu_add(perf->lat->sum_us[op], max_t(s64, us, 0));
+}
+
+void ufs_debugfs_cmd_release(struct ufs_hba *hba)
+{
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+
+	/* A counter reset may race with commands in flight. */
+	if (perf)
+		atomic_dec_if_positive(&perf->inflight);
+}
+
+void ufs_debugfs_hibern8_enter(struct ufs_hba *hba, ktime_t start, int ret)
+{
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	if (!perf)
+		return;
+
+	spin_lock_irqsave(&perf->h8_lock, flags);
+	if (ret) {
+		perf->h8_enter_err++;
+	} else {
+		perf->h8_enter_cnt++;
+		perf->h8_entered = now;
+	}
+	perf->h8_enter_us += ktime_us_delta(now, start);
+	spin_unlock_irqrestore(&perf->h8_lock, flags);
+}
+
+void ufs_debugfs_hibern8_exit(struct ufs_hba *hba, ktime_t start, int ret)
+{
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+	ktime_t now = ktime_get();
+	unsigned long flags;
+
+	if (!perf)
+		return;
+
+	spin_lock_irqsave(&perf->h8_lock, flags);
+	if (ret) {
+		perf->h8_exit_err++;
+	} else {
+		perf->h8_exit_cnt++;
+		if (perf->h8_entered)
+			perf->h8_resident_us +=
+				ktime_us_delta(start, perf->h8_entered);
+		perf->h8_entered = 0;
+	}
+	perf->h8_exit_us += ktime_us_delta(now, start);
+	spin_unlock_irqrestore(&perf->h8_lock, flags);
+}
+
+static int ufs_debugfs_latency_show(struct seq_file *s, void *data)
+{
+	struct ufs_hba *hba = hba_from_file(s->file);
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+	struct ufs_debugfs_lat *sum;
+	int cpu, op, b, i;
+	u64 cnt;
+
+	if (!perf)
+		return -ENODEV;
+
+	sum = kzalloc(sizeof(*sum), GFP_KERNEL);
+	if (!sum)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		struct ufs_debugfs_lat *lat = per_cpu_ptr(perf->lat, cpu);
+
+		for (op = 0; op < UFS_DEBUGFS_OP_MAX; op++) {
+			for (b = 0; b < UFS_DEBUGFS_LAT_BUCKETS; b++)
+				sum->hist[op][b] += READ_ONCE(lat->hist[op][b]);
+			sum->sum_us[op] += READ_ONCE(lat->sum_us[op]);
+		}
+		for (b = 0; b < UFS_DEBUGFS_QD_BUCKETS; b++)
+			sum->qd[b] += READ_ONCE(lat->qd[b]);
+	}
+
+	for (op = 0; op < UFS_DEBUGFS_OP_MAX; op++) {
+		for (cnt = 0, b = 0; b < UFS_DEBUGFS_LAT_BUCKETS; b++)
+			cnt += sum->hist[op][b];
+		seq_printf(s, "%s: count %llu avg_us %llu\n",
+			   ufs_debugfs_op_names[op], cnt,
+			   cnt ? div64_u64(sum->sum_us[op], cnt) : 0);
+		for (b = 0; b < UFS_DEBUGFS_LAT_BUCKETS; b++) {
+			if (!sum->hist[op][b])
+				continue;
+			if (b == UFS_DEBUGFS_LAT_BUCKETS - 1)
+				seq_printf(s, "  >=%lu us: %llu\n", 1UL << (b - 1),
+					   sum->hist[op][b]);
+			else
+				seq_printf(s, "  <%lu us: %llu\n", 1UL << b,
+					   sum->hist[op][b]);
+		}
+	}
+
+	seq_printf(s, "queue depth: current %d\n",
+		   atomic_read(&perf->inflight));
+	for (i = 0; i < UFS_DEBUGFS_QD_BUCKETS; i++) {
+		if (!sum->qd[i])
+			continue;
+		if (i == UFS_DEBUGFS_QD_BUCKETS - 1)
+			seq_printf(s, "  >=%lu: %llu\n", 1UL << i, sum->qd[i]);
+		else
+			seq_printf(s, "  %lu-%lu: %llu\n", 1UL << i,
+				   (1UL << (i + 1)) - 1, sum->qd[i]);
+	}
+
+	kfree(sum);
+	return 0;
+}
+
+static int ufs_debugfs_hibern8_show(struct seq_file *s, void *data)
+{
+	struct ufs_hba *hba = hba_from_file(s->file);
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+	u64 resident_us;
+
+	if (!perf)
+		return -ENODEV;
+
+	spin_lock_irq(&perf->h8_lock);
+	resident_us = perf->h8_resident_us;
+	if (perf->h8_entered)
+		resident_us += ktime_us_delta(ktime_get(), perf->h8_entered);
+	seq_printf(s, "enter: count %llu errors %llu total_us %llu\n",
+		   perf->h8_enter_cnt, perf->h8_enter_err, perf->h8_enter_us);
+	seq_printf(s, "exit: count %llu errors %llu total_us %llu\n",
+		   perf->h8_exit_cnt, perf->h8_exit_err, perf->h8_exit_us);
+	seq_printf(s, "resident_us: %llu\n", resident_us);
+	spin_unlock_irq(&perf->h8_lock);
+
+	return 0;
+}
+
+static void ufs_debugfs_perf_reset(struct ufs_debugfs_perf *perf,
+				   const char *name)
+{
+	int cpu;
+
+	if (strcmp(name, "latency") == 0) {
+		/* Resetting is racy against concurrent updates, which is fine. */
+		for_each_possible_cpu(cpu)
+			memset(per_cpu_ptr(perf->lat, cpu), 0,
+			       sizeof(struct ufs_debugfs_lat));
+	} else {
+		spin_lock_irq(&perf->h8_lock);
+		perf->h8_enter_cnt = 0;
+		perf->h8_exit_cnt = 0;
+		perf->h8_enter_err = 0;
+		perf->h8_exit_err = 0;
+		perf->h8_enter_us = 0;
+		perf->h8_exit_us = 0;
+		perf->h8_resident_us = 0;
+		if (perf->h8_entered)
+			perf->h8_entered = ktime_get();
+		spin_unlock_irq(&perf->h8_lock);
+	}
+}
+
+static int ufs_debugfs_perf_show(struct seq_file *s, void *data)
+{
+	struct ufs_debugfs_attr *attr = s->private;
+
+	if (strcmp(attr->name, "latency") == 0)
+		return ufs_debugfs_latency_show(s, data);
+	return ufs_debugfs_hibern8_show(s, data);
+}
+
+/* Writing anything to "latency" or "hibern8" clears the statistics. */
+static ssize_t ufs_debugfs_perf_write(struct file *file,
+				      const char __user *buf, size_t count,
+				      loff_t *ppos)
+{
+	struct ufs_debugfs_attr *attr = file->f_inode->i_private;
+	struct ufs_hba *hba = hba_from_file(file);
+
+	if (!hba->debugfs_perf)
+		return -ENODEV;
+
+	ufs_debugfs_perf_reset(hba->debugfs_perf, attr->name);
+	return count;
+}
+
+static int ufs_debugfs_perf_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, ufs_debugfs_perf_show, inode->i_private);
+}
+
+static const struct file_operations ufs_debugfs_perf_fops = {
+	.owner		= THIS_MODULE,
+	.open		= ufs_debugfs_perf_open,
+	.read		= seq_read,
+	.write		= ufs_debugfs_perf_write,
+	.llseek		= seq_lseek,
+	.release	= single_release,
+};
+
+static void ufs_debugfs_perf_init(struct ufs_hba *hba)
+{
+	struct ufs_debugfs_perf *perf;
+
+	perf = kzalloc(sizeof(*perf), GFP_KERNEL);
+	if (!perf)
+		return;
+
+	perf->lat = alloc_percpu(struct ufs_debugfs_lat);
+	if (!perf->lat) {
+		kfree(perf);
+		return;
+	}
+	spin_lock_init(&perf->h8_lock);
+	hba->debugfs_perf = perf;
+}
+
+static void ufs_debugfs_perf_exit(struct ufs_hba *hba)
+{
+	struct ufs_debugfs_perf *perf = hba->debugfs_perf;
+
+	if (!perf)
+		return;
+
+	hba->debugfs_perf = NULL;
+	free_percpu(perf->lat);
+	kfree(perf);
+}
+
 static const struct ufs_debugfs_attr ufs_attrs[] = {
 	{ "stats", 0400, &ufs_debugfs_stats_fops },
 	{ "saved_err", 0600, &ufs_saved_err_fops },
 	{ "saved_uic_err", 0600, &ufs_saved_err_fops },
+	{ "latency", 0600, &ufs_debugfs_perf_fops },
+	{ "hibern8", 0600, &ufs_debugfs_perf_fops },
 	{ }
 };
 
@@ -217,6 +568,7 @@ void ufs_debugfs_hba_init(struct ufs_hba *hba)
 	/* Set default exception event rate limit period to 20ms */
 	hba->debugfs_ee_rate_limit_ms = 20;
 	INIT_DELAYED_WORK(&hba->debugfs_ee_work, ufs_debugfs_restart_ee);
+	ufs_debugfs_perf_init(hba);
 
 	root = debugfs_create_dir(dev_name(hba->dev), ufs_debugfs_root);
 	if (IS_ERR_OR_NULL(root))
@@ -236,4 +588,5 @@ void ufs_debugfs_hba_exit(struct ufs_hba *hba)
 {
 	debugfs_remove_recursive(hba->debugfs_root);
 	cancel_delayed_work_sync(&hba->debugfs_ee_work);
+	ufs_debugfs_perf_exit(hba);
 }
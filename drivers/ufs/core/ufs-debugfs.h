@@ -5,7 +5,10 @@
 #ifndef __UFS_DEBUGFS_H__
 #define __UFS_DEBUGFS_H__
 
+#include <linux/ktime.h>
+
 struct ufs_hba;
+struct ufshcd_lrb;
 
 #ifdef CONFIG_DEBUG_FS
 void __init ufs_debugfs_init(void);
@@ -13,12 +16,25 @@ void ufs_debugfs_exit(void);
 void ufs_debugfs_hba_init(struct ufs_hba *hba);
 void ufs_debugfs_hba_exit(struct ufs_hba *hba);
 void ufs_debugfs_exception_event(struct ufs_hba *hba, u16 status);
+void ufs_debugfs_cmd_issue(struct ufs_hba *hba);
+void ufs_debugfs_cmd_compl(struct ufs_hba *hba, struct ufshcd_lrb *lrbp);
+void ufs_debugfs_cmd_release(struct ufs_hba *hba);
+void ufs_debugfs_hibern8_enter(struct ufs_hba *hba, ktime_t start, int ret);
+void ufs_debugfs_hibern8_exit(struct ufs_hba *hba, ktime_t start, int ret);
 #else
 static inline void ufs_debugfs_init(void) {}
 static inline void ufs_debugfs_exit(void) {}
 static inline void ufs_debugfs_hba_init(struct ufs_hba *hba) {}
 static inline void ufs_debugfs_hba_exit(struct ufs_hba *hba) {}
 static inline void ufs_debugfs_exception_event(struct ufs_hba *hba, u16 status) {}
+static inline void ufs_debugfs_cmd_issue(struct ufs_hba *hba) {}
+static inline void ufs_debugfs_cmd_compl(struct ufs_hba *hba,
+					 struct ufshcd_lrb *lrbp) {}
+static inline void ufs_debugfs_cmd_release(struct ufs_hba *hba) {}
+static inline void ufs_debugfs_hibern8_enter(struct ufs_hba *hba,
+					     ktime_t start, int ret) {}
+static inline void ufs_debugfs_hibern8_exit(struct ufs_hba *hba,
+					    ktime_t start, int ret) {}
 #endif
 
 #endif
@@ -174,30 +174,6 @@ static ssize_t spm_target_link_state_show(struct device *dev,
 				ufs_pm_lvl_states[hba->spm_lvl].link_state));
 }
 
-/* Convert Auto-Hibernate Idle Timer register value to microseconds */
-static int ufshcd_ahit_to_us(u32 ahit)
-{
-	int timer = FIELD_GET(UFSHCI_AHIBERN8_TIMER_MASK, ahit);
-	int scale = FIELD_GET(UFSHCI_AHIBERN8_SCALE_MASK, ahit);
-
-	for (; scale > 0; --scale)
-		timer *= UFSHCI_AHIBERN8_SCALE_FACTOR;
-
-	return timer;
-}
-
-/* Convert microseconds to Auto-Hibernate Idle Timer register value */
-static u32 ufshcd_us_to_ahit(unsigned int timer)
-{
-	unsigned int scale;
-
-	for (scale = 0; timer > UFSHCI_AHIBERN8_TIMER_MASK; ++scale)
-		timer /= UFSHCI_AHIBERN8_SCALE_FACTOR;
-
-	return FIELD_PREP(UFSHCI_AHIBERN8_TIMER_MASK, timer) |
-	       FIELD_PREP(UFSHCI_AHIBERN8_SCALE_MASK, scale);
-}
-
 static ssize_t auto_hibern8_show(struct device *dev,
 				 struct device_attribute *attr, char *buf)
 {
@@ -251,6 +227,41 @@ static ssize_t auto_hibern8_store(struct device *dev,
 	}
 
 	ufshcd_auto_hibern8_update(hba, ufshcd_us_to_ahit(timer));
+	if (hba->ahit_adapt.enabled)
+		ufshcd_auto_hibern8_adapt_set_max(hba, timer);
+
+out:
+	up(&hba->host_sem);
+	return ret ? ret : count;
+}
+
+static ssize_t auto_hibern8_adaptive_show(struct device *dev,
+					  struct device_attribute *attr,
+					  char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", hba->ahit_adapt.enabled);
+}
+
+static ssize_t auto_hibern8_adaptive_store(struct device *dev,
+					   struct device_attribute *attr,
+					   const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	bool value;
+	int ret;
+
+	if (kstrtobool(buf, &value))
+		return -EINVAL;
+
+	down(&hba->host_sem);
+	if (!ufshcd_is_user_access_allowed(hba)) {
+		ret = -EBUSY;
+		goto out;
+	}
+
+	ret = ufshcd_auto_hibern8_adapt_enable(hba, value);
 
 out:
 	up(&hba->host_sem);
@@ -459,6 +470,7 @@ static DEVICE_ATTR_RW(spm_lvl);
 static DEVICE_ATTR_RO(spm_target_dev_state);
 static DEVICE_ATTR_RO(spm_target_link_state);
 static DEVICE_ATTR_RW(auto_hibern8);
+static DEVICE_ATTR_RW(auto_hibern8_adaptive);
 static DEVICE_ATTR_RW(wb_on);
 static DEVICE_ATTR_RW(enable_wb_buf_flush);
 static DEVICE_ATTR_RW(wb_flush_threshold);
@@ -473,6 +485,7 @@ static struct attribute *ufs_sysfs_ufshcd_attrs[] = {
 	&dev_attr_spm_target_dev_state.attr,
 	&dev_attr_spm_target_link_state.attr,
 	&dev_attr_auto_hibern8.attr,
+	&dev_attr_auto_hibern8_adaptive.attr,
 	&dev_attr_wb_on.attr,
 	&dev_attr_enable_wb_buf_flush.attr,
 	&dev_attr_wb_flush_threshold.attr,
@@ -755,6 +768,100 @@ static const struct attribute_group ufs_sysfs_monitor_group = {
 	.attrs = ufs_sysfs_monitor_attrs,
 };
 
+static ssize_t wb_policy_enable_show(struct device *dev,
+				     struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%d\n", hba->wb_policy.enabled);
+}
+
+static ssize_t wb_policy_enable_store(struct device *dev,
+				      struct device_attribute *attr,
+				      const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	bool value;
+	ssize_t res;
+
+	if (kstrtobool(buf, &value))
+		return -EINVAL;
+
+	down(&hba->host_sem);
+	if (!ufshcd_is_user_access_allowed(hba)) {
+		res = -EBUSY;
+		goto out;
+	}
+
+	ufshcd_rpm_get_sync(hba);
+	res = ufshcd_wb_policy_enable(hba, value);
+	ufshcd_rpm_put_sync(hba);
+
+out:
+	up(&hba->host_sem);
+	return res < 0 ? res : count;
+}
+
+static ssize_t wb_policy_idle_ms_show(struct device *dev,
+				      struct device_attribute *attr, char *buf)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+
+	return sysfs_emit(buf, "%u\n", hba->wb_policy.idle_ms);
+}
+
+static ssize_t wb_policy_idle_ms_store(struct device *dev,
+				       struct device_attribute *attr,
+				       const char *buf, size_t count)
+{
+	struct ufs_hba *hba = dev_get_drvdata(dev);
+	unsigned int value;
+
+	if (kstrtouint(buf, 0, &value) || !value)
+		return -EINVAL;
+
+	WRITE_ONCE(hba->wb_policy.idle_ms, value);
+
+	return count;
+}
+
+#define UFS_WB_POLICY_ATTR(_name, _fmt)					\
+static ssize_t _name##_show(struct device *dev,				\
+			    struct device_attribute *attr, char *buf)	\
+{									\
+	struct ufs_hba *hba = dev_get_drvdata(dev);			\
+									\
+	return sysfs_emit(buf, _fmt "\n", hba->wb_policy._name);	\
+}									\
+static DEVICE_ATTR_RO(_name)
+
+UFS_WB_POLICY_ATTR(avail_buf, "%u");
+UFS_WB_POLICY_ATTR(lifetime, "%u");
+UFS_WB_POLICY_ATTR(in_burst, "%d");
+UFS_WB_POLICY_ATTR(nr_bursts, "%lu");
+UFS_WB_POLICY_ATTR(nr_flush_start, "%lu");
+UFS_WB_POLICY_ATTR(nr_flush_stop, "%lu");
+
+static DEVICE_ATTR_RW(wb_policy_enable);
+static DEVICE_ATTR_RW(wb_policy_idle_ms);
+
+static struct attribute *ufs_sysfs_wb_policy_attrs[] = {
+	&dev_attr_wb_policy_enable.attr,
+	&dev_attr_wb_policy_idle_ms.attr,
+	&dev_attr_avail_buf.attr,
+	&dev_attr_lifetime.attr,
+	&dev_attr_in_burst.attr,
+	&dev_attr_nr_bursts.attr,
+	&dev_attr_nr_flush_start.attr,
+	&dev_attr_nr_flush_stop.attr,
+	NULL
+};
+
+static const struct attribute_group ufs_sysfs_wb_policy_group = {
+	.name = "wb_policy",
+	.attrs = ufs_sysfs_wb_policy_attrs,
+};
+
 static ssize_t lane_show(struct device *dev, struct device_attribute *attr,
 			 char *buf)
 {
@@ -1503,6 +1610,7 @@ static const struct attribute_group *ufs_sysfs_groups[] = {
 	&ufs_sysfs_default_group,
 	&ufs_sysfs_capabilities_group,
 	&ufs_sysfs_monitor_group,
+	&ufs_sysfs_wb_policy_group,
 	&ufs_sysfs_power_info_group,
 	&ufs_sysfs_device_descriptor_group,
 	&ufs_sysfs_interconnect_descriptor_group,
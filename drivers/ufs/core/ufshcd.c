@@ -102,6 +102,22 @@
 /* Default RTC update every 10 seconds */
 #define UFS_RTC_UPDATE_INTERVAL_MS (10 * MSEC_PER_SEC)
 
+/* Default write-free window before the WB policy starts a buffer flush */
+#define UFS_WB_POLICY_IDLE_MS 500
+
+/* Time between WB buffer samples while the policy keeps a flush running */
+#define UFS_WB_POLICY_FLUSH_POLL_MS MSEC_PER_SEC
+
+/* Auto-hibern8 timer tuning: re-evaluation period and timer floor */
+#define UFS_AHIT_ADAPT_PERIOD_MS 1000
+#define UFS_AHIT_ADAPT_MIN_US 1000
+
+/* Fewest gaps in a period worth re-tuning the timer for */
+#define UFS_AHIT_ADAPT_MIN_SAMPLES 16
+
+/* Share of request gaps that should not pay for a hibern8 exit */
+#define UFS_AHIT_ADAPT_PERCENTILE 80
+
 /* bMaxNumOfRTT is equal to two after device manufacturing */
 #define DEFAULT_MAX_NUM_RTT 2
 
@@ -1607,9 +1623,13 @@ static int ufshcd_devfreq_get_dev_status(struct device *dev,
 				scaling->busy_start_t);
 	stat->total_time = ktime_us_delta(curr_t, scaling->window_start_t);
 	stat->busy_time = scaling->tot_busy_t;
+	if (stat->total_time)
+		scaling->window_kbps = div64_u64(scaling->tot_bytes * USEC_PER_SEC,
+						 (u64)stat->total_time * SZ_1K);
 start_window:
 	scaling->window_start_t = curr_t;
 	scaling->tot_busy_t = 0;
+	scaling->tot_bytes = 0;
 
 	if (scaling->active_reqs) {
 		scaling->busy_start_t = curr_t;
@@ -2186,6 +2206,7 @@ static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 	if (!hba->clk_scaling.window_start_t) {
 		hba->clk_scaling.window_start_t = curr_t;
 		hba->clk_scaling.tot_busy_t = 0;
+		hba->clk_scaling.tot_bytes = 0;
 		hba->clk_scaling.is_busy_started = false;
 	}
 
@@ -2196,7 +2217,8 @@ static void ufshcd_clk_scaling_start_busy(struct ufs_hba *hba)
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
 }
 
-static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
+static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba,
+					   unsigned int bytes)
 {
 	struct ufs_clk_scaling *scaling = &hba->clk_scaling;
 	unsigned long flags;
@@ -2206,6 +2228,7 @@ static void ufshcd_clk_scaling_update_busy(struct ufs_hba *hba)
 
 	spin_lock_irqsave(hba->host->host_lock, flags);
 	hba->clk_scaling.active_reqs--;
+	scaling->tot_bytes += bytes;
 	if (!scaling->active_reqs && scaling->is_busy_started) {
 		scaling->tot_busy_t += ktime_to_us(ktime_sub(ktime_get(),
 					scaling->busy_start_t));
@@ -2279,6 +2302,48 @@ static void ufshcd_update_monitor(struct ufs_hba *hba, const struct ufshcd_lrb *
 	spin_unlock_irqrestore(hba->host->host_lock, flags);
 }
 
+static inline void ufshcd_ahit_adapt_note_cmd(struct ufs_hba *hba,
+					      ktime_t now)
+{
+	struct ufs_ahit_adapt *a = &hba->ahit_adapt;
+	s64 gap;
+
+	if (!READ_ONCE(a->enabled))
+		return;
+
+	gap = ktime_us_delta(now, READ_ONCE(a->last_issue));
+	WRITE_ONCE(a->last_issue, now);
+	if (gap > 0)
+		atomic_inc(&a->hist[min_t(u32, ilog2(gap),
+					  UFS_AHIT_ADAPT_BUCKETS - 1)]);
+
+	/* suspend and resume stop and re-arm the work themselves */
+	if (!READ_ONCE(a->armed) && !hba->pm_op_in_progress) {
+		WRITE_ONCE(a->armed, true);
+		schedule_delayed_work(&a->work,
+				      msecs_to_jiffies(UFS_AHIT_ADAPT_PERIOD_MS));
+	}
+}
+
+/*
+ * Let the WB policy know a write burst is under way, so that a flush it
+ * started in the last idle window gets out of the way of the new writes.
+ */
+static inline void ufshcd_wb_policy_note_cmd(struct ufs_hba *hba,
+					     struct scsi_cmnd *cmd)
+{
+	struct ufs_wb_policy *p = &hba->wb_policy;
+
+	if (!READ_ONCE(p->enabled) || cmd->sc_data_direction != DMA_TO_DEVICE)
+		return;
+
+	WRITE_ONCE(p->last_write, jiffies);
+	if (!READ_ONCE(p->in_burst)) {
+		WRITE_ONCE(p->in_burst, true);
+		mod_delayed_work(system_wq, &p->work, 0);
+	}
+}
+
 /**
  * ufshcd_send_command - Send SCSI or device management commands
  * @hba: per adapter instance
@@ -2297,8 +2362,12 @@ void ufshcd_send_command(struct ufs_hba *hba, unsigned int task_tag,
 	lrbp->compl_time_stamp = ktime_set(0, 0);
 	lrbp->compl_time_stamp_local_clock = 0;
 	ufshcd_add_command_trace(hba, task_tag, UFS_CMD_SEND);
-	if (lrbp->cmd)
+	if (lrbp->cmd) {
 		ufshcd_clk_scaling_start_busy(hba);
+		ufshcd_wb_policy_note_cmd(hba, lrbp->cmd);
+		ufshcd_ahit_adapt_note_cmd(hba, lrbp->issue_time_stamp);
+		ufs_debugfs_cmd_issue(hba);
+	}
 	if (unlikely(ufshcd_should_inform_monitor(hba, lrbp)))
 		ufshcd_start_monitor(hba, lrbp);
 
@@ -4416,6 +4485,7 @@ int ufshcd_uic_hibern8_enter(struct ufs_hba *hba)
 	else
 		ufshcd_vops_hibern8_notify(hba, UIC_CMD_DME_HIBER_ENTER,
 								POST_CHANGE);
+	ufs_debugfs_hibern8_enter(hba, start, ret);
 
 	return ret;
 }
@@ -4444,6 +4514,7 @@ int ufshcd_uic_hibern8_exit(struct ufs_hba *hba)
 		hba->ufs_stats.last_hibern8_exit_tstamp = local_clock();
 		hba->ufs_stats.hibern8_exit_cnt++;
 	}
+	ufs_debugfs_hibern8_exit(hba, start, ret);
 
 	return ret;
 }
@@ -4475,6 +4546,136 @@ void ufshcd_auto_hibern8_update(struct ufs_hba *hba, u32 ahit)
 }
 EXPORT_SYMBOL_GPL(ufshcd_auto_hibern8_update);
 
+/*
+ * Pick the idle timer just above the gap that UFS_AHIT_ADAPT_PERCENTILE of
+ * the requests of the last period arrived within. Requests inside a burst
+ * then find the link still up, while the gaps between bursts are long
+ * enough to be spent in hibern8.
+ */
+static void ufshcd_ahit_adapt_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(to_delayed_work(work),
+					   struct ufs_hba, ahit_adapt.work);
+	struct ufs_ahit_adapt *a = &hba->ahit_adapt;
+	u32 hist[UFS_AHIT_ADAPT_BUCKETS];
+	u32 total = 0, sum = 0, timer_us, ahit;
+	int i;
+
+	for (i = 0; i < UFS_AHIT_ADAPT_BUCKETS; i++) {
+		hist[i] = atomic_xchg(&a->hist[i], 0);
+		total += hist[i];
+	}
+
+	/* idle or disabled, the next request re-arms the work */
+	if (!a->enabled || !total) {
+		WRITE_ONCE(a->armed, false);
+		return;
+	}
+
+	/*
+	 * Runtime suspend cancels this work synchronously, so don't wait for
+	 * a resume here as ufshcd_auto_hibern8_update() would.
+	 */
+	if (ufshcd_rpm_get_if_active(hba) <= 0) {
+		WRITE_ONCE(a->armed, false);
+		return;
+	}
+
+	if (total >= UFS_AHIT_ADAPT_MIN_SAMPLES) {
+		for (i = 0; i < UFS_AHIT_ADAPT_BUCKETS - 1; i++) {
+			sum += hist[i];
+			if (sum * 100ULL >= total * UFS_AHIT_ADAPT_PERCENTILE)
+				break;
+		}
+
+		timer_us = clamp_t(u32, 2U << i, READ_ONCE(a->min_us),
+				   READ_ONCE(a->max_us));
+		ahit = ufshcd_us_to_ahit(timer_us);
+		if (ahit != READ_ONCE(hba->ahit)) {
+			WRITE_ONCE(hba->ahit, ahit);
+			ufshcd_hold(hba);
+			ufshcd_configure_auto_hibern8(hba);
+			ufshcd_release(hba);
+		}
+	}
+
+	ufshcd_rpm_put(hba);
+
+	schedule_delayed_work(&a->work,
+			      msecs_to_jiffies(UFS_AHIT_ADAPT_PERIOD_MS));
+}
+
+/**
+ * ufshcd_auto_hibern8_adapt_enable - tune the auto-hibern8 timer to the load
+ * @hba: per adapter instance
+ * @enable: true to start tuning, false to stop it
+ *
+ * While enabled, the Auto-Hibernate Idle Timer is re-derived every
+ * UFS_AHIT_ADAPT_PERIOD_MS from the observed request inter-arrival times.
+ * It stays between UFS_AHIT_ADAPT_MIN_US and the timer configured at the
+ * time tuning is enabled or written since, which is also restored when it is
+ * disabled.
+ *
+ * Return: 0 on success, -EOPNOTSUPP without auto-hibern8 support, -EINVAL if
+ * auto-hibern8 is disabled.
+ */
+int ufshcd_auto_hibern8_adapt_enable(struct ufs_hba *hba, bool enable)
+{
+	struct ufs_ahit_adapt *a = &hba->ahit_adapt;
+
+	if (!ufshcd_is_auto_hibern8_supported(hba))
+		return -EOPNOTSUPP;
+
+	if (a->enabled == enable)
+		return 0;
+
+	if (!enable) {
+		WRITE_ONCE(a->enabled, false);
+		cancel_delayed_work_sync(&a->work);
+		a->armed = false;
+		ufshcd_auto_hibern8_update(hba, ufshcd_us_to_ahit(a->max_us));
+		return 0;
+	}
+
+	if (!ufshcd_is_auto_hibern8_enabled(hba))
+		return -EINVAL;
+
+	ufshcd_auto_hibern8_adapt_set_max(hba, ufshcd_ahit_to_us(hba->ahit));
+	a->last_issue = ktime_get();
+	WRITE_ONCE(a->enabled, true);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ufshcd_auto_hibern8_adapt_enable);
+
+/**
+ * ufshcd_auto_hibern8_adapt_set_max - set the upper bound for the tuned timer
+ * @hba: per adapter instance
+ * @max_us: new upper bound, also the timer restored when tuning is disabled
+ *
+ * Called when the idle timer is configured explicitly, so that tuning stays
+ * below the new value and does not revert it once disabled.
+ */
+void ufshcd_auto_hibern8_adapt_set_max(struct ufs_hba *hba, u32 max_us)
+{
+	struct ufs_ahit_adapt *a = &hba->ahit_adapt;
+
+	WRITE_ONCE(a->max_us, max_us);
+	WRITE_ONCE(a->min_us, min_t(u32, UFS_AHIT_ADAPT_MIN_US, max_us));
+}
+
+static void ufshcd_ahit_adapt_rearm(struct ufs_hba *hba)
+{
+	struct ufs_ahit_adapt *a = &hba->ahit_adapt;
+
+	if (!READ_ONCE(a->enabled))
+		return;
+
+	WRITE_ONCE(a->armed, true);
+	schedule_delayed_work(&a->work,
+			      msecs_to_jiffies(UFS_AHIT_ADAPT_PERIOD_MS));
+}
+
  /**
  * ufshcd_init_pwr_info - setting the POR (power on reset)
  * values in hba power info
@@ -5502,7 +5703,8 @@ void ufshcd_release_scsi_cmd(struct ufs_hba *hba,
 	scsi_dma_unmap(cmd);
 	ufshcd_crypto_clear_prdt(hba, lrbp);
 	ufshcd_release(hba);
-	ufshcd_clk_scaling_update_busy(hba);
+	ufshcd_clk_scaling_update_busy(hba, scsi_bufflen(cmd));
+	ufs_debugfs_cmd_release(hba);
 }
 
 /**
@@ -5525,6 +5727,7 @@ void ufshcd_compl_one_cqe(struct ufs_hba *hba, int task_tag,
 		if (unlikely(ufshcd_should_inform_monitor(hba, lrbp)))
 			ufshcd_update_monitor(hba, lrbp);
 		ufshcd_add_command_trace(hba, task_tag, UFS_CMD_COMP);
+		ufs_debugfs_cmd_compl(hba, lrbp);
 		cmd->result = ufshcd_transfer_rsp_status(hba, lrbp, cqe);
 		ufshcd_release_scsi_cmd(hba, lrbp);
 		/* Do not touch lrbp after scsi done */
@@ -6171,6 +6374,132 @@ static bool ufshcd_wb_need_flush(struct ufs_hba *hba)
 	return ufshcd_wb_presrv_usrspc_keep_vcc_on(hba, avail_buf);
 }
 
+static int ufshcd_wb_policy_sample(struct ufs_hba *hba)
+{
+	struct ufs_wb_policy *p = &hba->wb_policy;
+	u8 index = ufshcd_wb_get_query_index(hba);
+	int ret;
+
+	ret = ufshcd_query_attr_retry(hba, UPIU_QUERY_OPCODE_READ_ATTR,
+				      QUERY_ATTR_IDN_WB_BUFF_LIFE_TIME_EST,
+				      index, 0, &p->lifetime);
+	if (ret)
+		return ret;
+
+	return ufshcd_query_attr_retry(hba, UPIU_QUERY_OPCODE_READ_ATTR,
+				       QUERY_ATTR_IDN_AVAIL_WB_BUFF_SIZE,
+				       index, 0, &p->avail_buf);
+}
+
+/*
+ * Keep fWriteBoosterBufferFlushEn off while a write burst is going, so the
+ * flush does not compete with foreground writes, and turn it on once the
+ * burst has been over for idle_ms and the buffer holds data to flush. The
+ * work runs while the device is runtime active only. It is cancelled before
+ * the device is suspended and re-armed on resume.
+ */
+static void ufshcd_wb_policy_work(struct work_struct *work)
+{
+	struct ufs_hba *hba = container_of(to_delayed_work(work),
+					   struct ufs_hba, wb_policy.work);
+	struct ufs_wb_policy *p = &hba->wb_policy;
+	unsigned long idle = msecs_to_jiffies(p->idle_ms);
+	unsigned long last_write, next = 0;
+
+	if (!p->enabled || !ufshcd_is_wb_allowed(hba))
+		return;
+
+	if (ufshcd_rpm_get_if_active(hba) <= 0)
+		return;
+
+	mutex_lock(&hba->wb_mutex);
+	if (hba->ufshcd_state != UFSHCD_STATE_OPERATIONAL)
+		goto out;
+
+	last_write = READ_ONCE(p->last_write);
+	if (time_before(jiffies, last_write + idle)) {
+		if (hba->dev_info.wb_buf_flush_enabled &&
+		    !ufshcd_wb_toggle_buf_flush(hba, false))
+			p->nr_flush_stop++;
+		next = last_write + idle - jiffies;
+		goto out;
+	}
+
+	if (p->in_burst) {
+		WRITE_ONCE(p->in_burst, false);
+		p->nr_bursts++;
+	}
+
+	if (ufshcd_wb_policy_sample(hba))
+		goto out;
+
+	if (p->lifetime == UFS_WB_EXCEED_LIFETIME) {
+		ufshcd_wb_force_disable(hba);
+		goto out;
+	}
+
+	if (p->avail_buf < UFS_WB_BUF_REMAIN_PERCENT(100)) {
+		if (!hba->dev_info.wb_buf_flush_enabled &&
+		    !ufshcd_wb_toggle_buf_flush(hba, true))
+			p->nr_flush_start++;
+		next = msecs_to_jiffies(UFS_WB_POLICY_FLUSH_POLL_MS);
+	} else if (hba->dev_info.wb_buf_flush_enabled &&
+		   !ufshcd_wb_toggle_buf_flush(hba, false)) {
+		p->nr_flush_stop++;
+	}
+
+out:
+	mutex_unlock(&hba->wb_mutex);
+	ufshcd_rpm_put(hba);
+
+	if (next && p->enabled)
+		schedule_delayed_work(&p->work, next);
+}
+
+/**
+ * ufshcd_wb_policy_enable - hand WB buffer flushing over to the idle policy
+ * @hba: per adapter instance
+ * @enable: true to let the policy drive fWriteBoosterBufferFlushEn, false to
+ *	return to the static configuration
+ *
+ * Return: 0 on success, -EOPNOTSUPP if WB buffer flushing cannot be
+ * controlled on this host.
+ */
+int ufshcd_wb_policy_enable(struct ufs_hba *hba, bool enable)
+{
+	struct ufs_wb_policy *p = &hba->wb_policy;
+
+	if (!ufshcd_is_wb_allowed(hba) || !ufshcd_is_wb_buf_flush_allowed(hba))
+		return -EOPNOTSUPP;
+
+	if (p->enabled == enable)
+		return 0;
+
+	WRITE_ONCE(p->enabled, enable);
+	if (enable) {
+		p->in_burst = false;
+		mod_delayed_work(system_wq, &p->work, 0);
+		return 0;
+	}
+
+	cancel_delayed_work_sync(&p->work);
+
+	mutex_lock(&hba->wb_mutex);
+	ufshcd_wb_toggle_buf_flush(hba, true);
+	mutex_unlock(&hba->wb_mutex);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(ufshcd_wb_policy_enable);
+
+static void ufshcd_wb_policy_rearm(struct ufs_hba *hba)
+{
+	struct ufs_wb_policy *p = &hba->wb_policy;
+
+	if (READ_ONCE(p->enabled))
+		schedule_delayed_work(&p->work, msecs_to_jiffies(p->idle_ms));
+}
+
 static void ufshcd_rpm_dev_flush_recheck_work(struct work_struct *work)
 {
 	struct ufs_hba *hba = container_of(to_delayed_work(work),
@@ -9647,6 +9976,13 @@ static int __ufshcd_wl_suspend(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	enum uic_link_state req_link_state;
 
 	hba->pm_op_in_progress = true;
+	/*
+	 * Neither the WB policy nor the auto-hibern8 tuning may talk to the
+	 * device while it powers down.
+	 */
+	cancel_delayed_work_sync(&hba->wb_policy.work);
+	cancel_delayed_work_sync(&hba->ahit_adapt.work);
+
 	if (pm_op != UFS_SHUTDOWN_PM) {
 		pm_lvl = pm_op == UFS_RUNTIME_PM ?
 			 hba->rpm_lvl : hba->spm_lvl;
@@ -9815,6 +10151,8 @@ static int __ufshcd_wl_suspend(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 		ufshcd_update_evt_hist(hba, UFS_EVT_WL_SUSP_ERR, (u32)ret);
 		hba->clk_gating.is_suspended = false;
 		ufshcd_release(hba);
+		ufshcd_wb_policy_rearm(hba);
+		ufshcd_ahit_adapt_rearm(hba);
 	}
 	hba->pm_op_in_progress = false;
 	return ret;
@@ -9895,6 +10233,8 @@ static int __ufshcd_wl_resume(struct ufs_hba *hba, enum ufs_pm_op pm_op)
 	}
 
 	ufshcd_configure_auto_hibern8(hba);
+	ufshcd_wb_policy_rearm(hba);
+	ufshcd_ahit_adapt_rearm(hba);
 
 	goto out;
 
@@ -10246,6 +10586,9 @@ void ufshcd_remove(struct ufs_hba *hba)
 	blk_mq_free_tag_set(&hba->tmf_tag_set);
 	if (hba->scsi_host_added)
 		scsi_remove_host(hba->host);
+	cancel_delayed_work_sync(&hba->wb_policy.work);
+	WRITE_ONCE(hba->ahit_adapt.enabled, false);
+	cancel_delayed_work_sync(&hba->ahit_adapt.work);
 	/* disable interrupts */
 	ufshcd_disable_intr(hba, hba->intr_mask);
 	ufshcd_hba_stop(hba);
@@ -10579,6 +10922,9 @@ int ufshcd_init(struct ufs_hba *hba, void __iomem *mmio_base, unsigned int irq)
 
 	INIT_DELAYED_WORK(&hba->rpm_dev_flush_recheck_work, ufshcd_rpm_dev_flush_recheck_work);
 	INIT_DELAYED_WORK(&hba->ufs_rtc_update_work, ufshcd_rtc_work);
+	INIT_DELAYED_WORK(&hba->wb_policy.work, ufshcd_wb_policy_work);
+	INIT_DELAYED_WORK(&hba->ahit_adapt.work, ufshcd_ahit_adapt_work);
+	hba->wb_policy.idle_ms = UFS_WB_POLICY_IDLE_MS;
 
 	/* Set the default auto-hiberate idle timer value to 150 ms */
 	if (ufshcd_is_auto_hibern8_supported(hba) && !hba->ahit) {
@@ -15,6 +15,7 @@
 #include <linux/platform_device.h>
 #include <linux/reset-controller.h>
 #include <linux/time.h>
+#include <linux/workqueue.h>
 
 #include <soc/qcom/ice.h>
 
@@ -50,6 +51,14 @@ enum {
 #define QCOM_UFS_MAX_GEAR 5
 #define QCOM_UFS_MAX_LANE 2
 
+/*
+ * Throughput thresholds for the light DDR vote, in percent of what that
+ * vote provides. Between the two the current vote is kept.
+ */
+#define UFS_QCOM_BW_POLL_MS		60
+#define UFS_QCOM_BW_UP_THRESHOLD	70
+#define UFS_QCOM_BW_DOWN_THRESHOLD	30
+
 enum {
 	MODE_MIN,
 	MODE_PWM,
@@ -686,7 +695,8 @@ static int ufs_qcom_icc_set_bw(struct ufs_qcom_host *host, u32 mem_bw, u32 cfg_b
 	return 0;
 }
 
-static struct __ufs_qcom_bw_table ufs_qcom_get_bw_table(struct ufs_qcom_host *host)
+static struct __ufs_qcom_bw_table ufs_qcom_get_bw_table(struct ufs_qcom_host *host,
+							bool light)
 {
 	struct ufs_pa_layer_attr *p = &host->dev_req_params;
 	int gear = max_t(u32, p->gear_rx, p->gear_tx);
@@ -703,6 +713,10 @@ static struct __ufs_qcom_bw_table ufs_qcom_get_bw_table(struct ufs_qcom_host *ho
 		lane = QCOM_UFS_MAX_LANE;
 
 	if (ufshcd_is_hs_mode(p)) {
+		/* a lightly loaded link needs no more than the slowest HS gear */
+		if (light)
+			gear = UFS_HS_G1;
+
 		if (p->hs_rate == PA_HS_MODE_B)
 			return ufs_qcom_bw_table[MODE_HS_RB][gear][lane];
 		else
@@ -712,15 +726,94 @@ static struct __ufs_qcom_bw_table ufs_qcom_get_bw_table(struct ufs_qcom_host *ho
 	}
 }
 
-static int ufs_qcom_icc_update_bw(struct ufs_qcom_host *host)
+static int __ufs_qcom_icc_update_bw(struct ufs_qcom_host *host)
 {
 	struct __ufs_qcom_bw_table bw_table;
 
-	bw_table = ufs_qcom_get_bw_table(host);
+	bw_table = ufs_qcom_get_bw_table(host, host->bw_light);
 
 	return ufs_qcom_icc_set_bw(host, bw_table.mem_bw, bw_table.cfg_bw);
 }
 
+static int ufs_qcom_icc_update_bw(struct ufs_qcom_host *host)
+{
+	int ret;
+
+	mutex_lock(&host->bw_lock);
+	ret = __ufs_qcom_icc_update_bw(host);
+	mutex_unlock(&host->bw_lock);
+
+	return ret;
+}
+
+/*
+ * The gear/lane table gives the DDR vote a saturated link needs. Drop to
+ * the vote of the slowest HS gear while the throughput measured over the
+ * clock scaling polling window stays well below what that vote carries,
+ * and go back up once it gets close to it.
+ */
+static void ufs_qcom_bw_work(struct work_struct *work)
+{
+	struct ufs_qcom_host *host = container_of(to_delayed_work(work),
+						  struct ufs_qcom_host, bw_work);
+	struct ufs_hba *hba = host->hba;
+	u64 light_bw;
+	u32 kbps;
+	bool light;
+
+	mutex_lock(&host->bw_lock);
+	if (!host->bw_active)
+		goto out;
+
+	if (!hba->clk_scaling.is_enabled ||
+	    !ufshcd_is_hs_mode(&host->dev_req_params)) {
+		light = false;
+	} else {
+		light_bw = ufs_qcom_get_bw_table(host, true).mem_bw;
+		kbps = READ_ONCE(hba->clk_scaling.window_kbps);
+
+		if (host->bw_light)
+			light = kbps * 100ULL < light_bw * UFS_QCOM_BW_UP_THRESHOLD;
+		else
+			light = kbps * 100ULL < light_bw * UFS_QCOM_BW_DOWN_THRESHOLD;
+	}
+
+	if (light != host->bw_light) {
+		host->bw_light = light;
+		__ufs_qcom_icc_update_bw(host);
+	}
+
+	schedule_delayed_work(&host->bw_work,
+			      msecs_to_jiffies(UFS_QCOM_BW_POLL_MS));
+out:
+	mutex_unlock(&host->bw_lock);
+}
+
+static void ufs_qcom_bw_start(struct ufs_qcom_host *host)
+{
+	mutex_lock(&host->bw_lock);
+	/* start from the full vote, the light one is only earned by sampling */
+	host->bw_light = false;
+	__ufs_qcom_icc_update_bw(host);
+
+	if (ufshcd_is_clkscaling_supported(host->hba)) {
+		host->bw_active = true;
+		mod_delayed_work(system_wq, &host->bw_work,
+				 msecs_to_jiffies(UFS_QCOM_BW_POLL_MS));
+	}
+	mutex_unlock(&host->bw_lock);
+}
+
+static void ufs_qcom_bw_stop(struct ufs_qcom_host *host)
+{
+	mutex_lock(&host->bw_lock);
+	host->bw_active = false;
+	cancel_delayed_work(&host->bw_work);
+	ufs_qcom_icc_set_bw(host, ufs_qcom_bw_table[MODE_MIN][0][0].mem_bw,
+			    ufs_qcom_bw_table[MODE_MIN][0][0].cfg_bw);
+	mutex_unlock(&host->bw_lock);
+}
+
 static int ufs_qcom_pwr_change_notify(struct ufs_hba *hba,
 				enum ufs_notify_change_status status,
 				struct ufs_pa_layer_attr *dev_max_params,
@@ -949,7 +1042,7 @@ static int ufs_qcom_setup_clocks(struct ufs_hba *hba, bool on,
 	switch (status) {
 	case PRE_CHANGE:
 		if (on) {
-			ufs_qcom_icc_update_bw(host);
+			ufs_qcom_bw_start(host);
 		} else {
 			if (!ufs_qcom_is_link_active(hba)) {
 				/* disable device ref_clk */
@@ -963,8 +1056,7 @@ static int ufs_qcom_setup_clocks(struct ufs_hba *hba, bool on,
 			if (ufshcd_is_hs_mode(&hba->pwr_info))
 				ufs_qcom_dev_ref_clk_ctrl(host, true);
 		} else {
-			ufs_qcom_icc_set_bw(host, ufs_qcom_bw_table[MODE_MIN][0][0].mem_bw,
-					    ufs_qcom_bw_table[MODE_MIN][0][0].cfg_bw);
+			ufs_qcom_bw_stop(host);
 		}
 		break;
 	}
@@ -1056,6 +1148,9 @@ static int ufs_qcom_init(struct ufs_hba *hba)
 	host->hba = hba;
 	ufshcd_set_variant(hba, host);
 
+	mutex_init(&host->bw_lock);
+	INIT_DELAYED_WORK(&host->bw_work, ufs_qcom_bw_work);
+
 	/* Setup the optional reset control of HCI */
 	host->core_reset = devm_reset_control_get_optional(hba->dev, "rst");
 	if (IS_ERR(host->core_reset)) {
@@ -1138,6 +1233,7 @@ static void ufs_qcom_exit(struct ufs_hba *hba)
 {
 	struct ufs_qcom_host *host = ufshcd_get_variant(hba);
 
+	cancel_delayed_work_sync(&host->bw_work);
 	ufs_qcom_disable_lane_clks(host);
 	phy_power_off(host->generic_phy);
 	phy_exit(host->generic_phy);
@@ -1351,6 +1447,12 @@ static int ufs_qcom_clk_scale_notify(struct ufs_hba *hba,
 			return err;
 		}
 
+		/* gear and clocks going up, take the bus vote up with them */
+		if (scale_up) {
+			mutex_lock(&host->bw_lock);
+			host->bw_light = false;
+			mutex_unlock(&host->bw_lock);
+		}
 		ufs_qcom_icc_update_bw(host);
 		ufshcd_uic_hibern8_exit(hba);
 	}
@@ -192,6 +192,11 @@ struct ufs_qcom_host {
 
 	struct icc_path *icc_ddr;
 	struct icc_path *icc_cpu;
+	/* load adaptive DDR vote, see ufs_qcom_bw_work() */
+	struct mutex bw_lock;
+	struct delayed_work bw_work;
+	bool bw_active;
+	bool bw_light;
 
 #ifdef CONFIG_SCSI_UFS_CRYPTO
 	struct qcom_ice *ice;
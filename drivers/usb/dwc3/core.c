@@ -21,6 +21,7 @@
 #include <linux/io.h>
 #include <linux/list.h>
 #include <linux/delay.h>
+#include <linux/notifier.h>
 #include <linux/dma-mapping.h>
 #include <linux/of.h>
 #include <linux/of_graph.h>
@@ -131,6 +132,34 @@ void dwc3_enable_susphy(struct dwc3 *dwc, bool enable)
 	}
 }
 
+static ATOMIC_NOTIFIER_HEAD(dwc3_link_notifier);
+
+/**
+ * dwc3_register_link_notifier - get told about device mode link changes
+ * @nb: notifier called with the struct dwc3 whose link changed
+ *
+ * The notifier is called from the event handler with dwc->lock held, after
+ * connect, disconnect, reset, suspend and link state events. It is meant
+ * for glue drivers that scale their resources with the link; they must
+ * filter on the dwc3 instance and defer anything that sleeps.
+ */
+int dwc3_register_link_notifier(struct notifier_block *nb)
+{
+	return atomic_notifier_chain_register(&dwc3_link_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(dwc3_register_link_notifier);
+
+void dwc3_unregister_link_notifier(struct notifier_block *nb)
+{
+	atomic_notifier_chain_unregister(&dwc3_link_notifier, nb);
+}
+EXPORT_SYMBOL_GPL(dwc3_unregister_link_notifier);
+
+void dwc3_link_notify(struct dwc3 *dwc)
+{
+	atomic_notifier_call_chain(&dwc3_link_notifier, 0, dwc);
+}
+
 void dwc3_set_prtcap(struct dwc3 *dwc, u32 mode)
 {
 	u32 reg;
@@ -1652,6 +1681,7 @@ static void dwc3_get_properties(struct dwc3 *dwc)
 	u8			rx_thr_num_pkt_prd = 0;
 	u8			rx_max_burst_prd = 0;
 	u8			tx_thr_num_pkt_prd = 0;
+	u16			imod_interval = 0;
 	u8			tx_max_burst_prd = 0;
 	u8			tx_fifo_resize_max_num;
 	const char		*usb_psy_name;
@@ -1797,6 +1827,9 @@ static void dwc3_get_properties(struct dwc3 *dwc)
 	dwc->dis_split_quirk = device_property_read_bool(dev,
 				"snps,dis-split-quirk");
 
+	device_property_read_u16(dev, "snps,imod-interval",
+				 &imod_interval);
+
 	dwc->lpm_nyet_threshold = lpm_nyet_threshold;
 	dwc->tx_de_emphasis = tx_de_emphasis;
 
@@ -1814,7 +1847,7 @@ static void dwc3_get_properties(struct dwc3 *dwc)
 	dwc->tx_thr_num_pkt_prd = tx_thr_num_pkt_prd;
 	dwc->tx_max_burst_prd = tx_max_burst_prd;
 
-	dwc->imod_interval = 0;
+	dwc->imod_interval = imod_interval;
 
 	dwc->tx_fifo_resize_max_num = tx_fifo_resize_max_num;
 }
@@ -712,6 +712,9 @@ struct dwc3_event_buffer {
 
 #define DWC3_TRB_NUM		256
 
+/* Max bulk IN requests completed by a single interrupt */
+#define DWC3_IOC_COALESCE_MAX	8
+
 /**
  * struct dwc3_ep - device side endpoint representation
  * @endpoint: usb endpoint
@@ -951,6 +954,8 @@ struct dwc3_hwparams {
  *	or unaligned OUT)
  * @direction: IN or OUT direction flag
  * @mapped: true when request has been dma-mapped
+ * @no_interrupt: true when the request's TRBs are prepared without IOC, either
+ *	on the function driver's request or from interrupt coalescing
  */
 struct dwc3_request {
 	struct usb_request	request;
@@ -981,6 +986,7 @@ struct dwc3_request {
 	unsigned int		needs_extra_trb:1;
 	unsigned int		direction:1;
 	unsigned int		mapped:1;
+	unsigned int		no_interrupt:1;
 };
 
 /*
@@ -1604,6 +1610,10 @@ void dwc3_event_buffers_cleanup(struct dwc3 *dwc);
 int dwc3_core_soft_reset(struct dwc3 *dwc);
 void dwc3_enable_susphy(struct dwc3 *dwc, bool enable);
 
+int dwc3_register_link_notifier(struct notifier_block *nb);
+void dwc3_unregister_link_notifier(struct notifier_block *nb);
+void dwc3_link_notify(struct dwc3 *dwc);
+
 #if IS_ENABLED(CONFIG_USB_DWC3_HOST) || IS_ENABLED(CONFIG_USB_DWC3_DUAL_ROLE)
 int dwc3_host_init(struct dwc3 *dwc);
 void dwc3_host_exit(struct dwc3 *dwc);
@@ -48,9 +48,26 @@
 #define USB_MEMORY_PEAK_HS_BW MBps_to_icc(700)
 #define USB_MEMORY_AVG_SS_BW  MBps_to_icc(1000)
 #define USB_MEMORY_PEAK_SS_BW MBps_to_icc(2500)
+#define USB_MEMORY_AVG_IDLE_BW MBps_to_icc(1)
+#define USB_MEMORY_PEAK_IDLE_BW MBps_to_icc(40)
 #define APPS_USB_AVG_BW 0
 #define APPS_USB_PEAK_BW MBps_to_icc(40)
 
+enum dwc3_qcom_bw_level {
+	DWC3_QCOM_BW_IDLE,
+	DWC3_QCOM_BW_HS,
+	DWC3_QCOM_BW_SS,
+};
+
+static const struct {
+	u32 avg;
+	u32 peak;
+} dwc3_qcom_ddr_bw[] = {
+	[DWC3_QCOM_BW_IDLE] = { USB_MEMORY_AVG_IDLE_BW, USB_MEMORY_PEAK_IDLE_BW },
+	[DWC3_QCOM_BW_HS] = { USB_MEMORY_AVG_HS_BW, USB_MEMORY_PEAK_HS_BW },
+	[DWC3_QCOM_BW_SS] = { USB_MEMORY_AVG_SS_BW, USB_MEMORY_PEAK_SS_BW },
+};
+
 /* Qualcomm SoCs with multiport support has up to 4 ports */
 #define DWC3_QCOM_MAX_PORTS	4
 
@@ -83,12 +100,17 @@ struct dwc3_qcom {
 	struct extcon_dev	*host_edev;
 	struct notifier_block	vbus_nb;
 	struct notifier_block	host_nb;
+	struct notifier_block	link_nb;
 
 	enum usb_dr_mode	mode;
 	bool			is_suspended;
 	bool			pm_suspended;
 	struct icc_path		*icc_path_ddr;
 	struct icc_path		*icc_path_apps;
+
+	struct work_struct	bw_work;
+	enum dwc3_qcom_bw_level	bw_max;
+	enum dwc3_qcom_bw_level	bw_level;
 };
 
 static inline void dwc3_qcom_setbits(void __iomem *base, u32 offset, u32 val)
@@ -138,6 +160,7 @@ static int dwc3_qcom_vbus_notifier(struct notifier_block *nb,
 	/* enable vbus override for device mode */
 	dwc3_qcom_vbus_override_enable(qcom, event);
 	qcom->mode = event ? USB_DR_MODE_PERIPHERAL : USB_DR_MODE_HOST;
+	schedule_work(&qcom->bw_work);
 
 	return NOTIFY_DONE;
 }
@@ -150,6 +173,7 @@ static int dwc3_qcom_host_notifier(struct notifier_block *nb,
 	/* disable vbus override in host mode */
 	dwc3_qcom_vbus_override_enable(qcom, !event);
 	qcom->mode = event ? USB_DR_MODE_HOST : USB_DR_MODE_PERIPHERAL;
+	schedule_work(&qcom->bw_work);
 
 	return NOTIFY_DONE;
 }
@@ -260,13 +284,14 @@ static int dwc3_qcom_interconnect_init(struct dwc3_qcom *qcom)
 	}
 
 	max_speed = usb_get_maximum_speed(&qcom->dwc3->dev);
-	if (max_speed >= USB_SPEED_SUPER || max_speed == USB_SPEED_UNKNOWN) {
-		ret = icc_set_bw(qcom->icc_path_ddr,
-				USB_MEMORY_AVG_SS_BW, USB_MEMORY_PEAK_SS_BW);
-	} else {
-		ret = icc_set_bw(qcom->icc_path_ddr,
-				USB_MEMORY_AVG_HS_BW, USB_MEMORY_PEAK_HS_BW);
-	}
+	if (max_speed >= USB_SPEED_SUPER || max_speed == USB_SPEED_UNKNOWN)
+		qcom->bw_max = DWC3_QCOM_BW_SS;
+	else
+		qcom->bw_max = DWC3_QCOM_BW_HS;
+
+	qcom->bw_level = qcom->bw_max;
+	ret = icc_set_bw(qcom->icc_path_ddr, dwc3_qcom_ddr_bw[qcom->bw_level].avg,
+			 dwc3_qcom_ddr_bw[qcom->bw_level].peak);
 	if (ret) {
 		dev_err(dev, "failed to set bandwidth for usb-ddr path: %d\n", ret);
 		goto put_path_apps;
@@ -316,6 +341,61 @@ static bool dwc3_qcom_is_host(struct dwc3_qcom *qcom)
 	return dwc->xhci;
 }
 
+static enum dwc3_qcom_bw_level dwc3_qcom_bw_level(struct dwc3_qcom *qcom)
+{
+	struct dwc3 *dwc = platform_get_drvdata(qcom->dwc3);
+
+	/*
+	 * In host mode the devices behind the root hub can come and go under
+	 * us, so keep the vote derived from the maximum speed.
+	 */
+	if (!dwc || dwc3_qcom_is_host(qcom))
+		return qcom->bw_max;
+
+	/*
+	 * These are updated by the gadget event handler, which queues this
+	 * work again after each change, so a stale read is corrected by the
+	 * next run.
+	 */
+	if (!dwc->connected || dwc->link_state == DWC3_LINK_STATE_U3)
+		return DWC3_QCOM_BW_IDLE;
+
+	if (dwc->speed == DWC3_DSTS_SUPERSPEED ||
+	    dwc->speed == DWC3_DSTS_SUPERSPEED_PLUS)
+		return DWC3_QCOM_BW_SS;
+
+	return DWC3_QCOM_BW_HS;
+}
+
+static void dwc3_qcom_bw_work(struct work_struct *work)
+{
+	struct dwc3_qcom *qcom = container_of(work, struct dwc3_qcom, bw_work);
+	enum dwc3_qcom_bw_level level = dwc3_qcom_bw_level(qcom);
+	int ret;
+
+	if (level != qcom->bw_level) {
+		ret = icc_set_bw(qcom->icc_path_ddr, dwc3_qcom_ddr_bw[level].avg,
+				 dwc3_qcom_ddr_bw[level].peak);
+		if (ret)
+			dev_warn(qcom->dev, "failed to set bandwidth for usb-ddr path: %d\n",
+				 ret);
+		else
+			qcom->bw_level = level;
+	}
+}
+
+static int dwc3_qcom_link_notifier(struct notifier_block *nb,
+				   unsigned long event, void *ptr)
+{
+	struct dwc3_qcom *qcom = container_of(nb, struct dwc3_qcom, link_nb);
+	struct dwc3 *dwc = ptr;
+
+	if (dwc->dev->parent == qcom->dev)
+		schedule_work(&qcom->bw_work);
+
+	return NOTIFY_DONE;
+}
+
 static enum usb_device_speed dwc3_qcom_read_usb2_speed(struct dwc3_qcom *qcom, int port_index)
 {
 	struct dwc3 *dwc = platform_get_drvdata(qcom->dwc3);
@@ -807,6 +887,12 @@ static int dwc3_qcom_probe(struct platform_device *pdev)
 	if (ret)
 		goto depopulate;
 
+	/* Move the usb-ddr vote with the link, starting from where it is now */
+	INIT_WORK(&qcom->bw_work, dwc3_qcom_bw_work);
+	qcom->link_nb.notifier_call = dwc3_qcom_link_notifier;
+	dwc3_register_link_notifier(&qcom->link_nb);
+	schedule_work(&qcom->bw_work);
+
 	qcom->mode = usb_get_dr_mode(&qcom->dwc3->dev);
 
 	/* enable vbus override for device mode */
@@ -825,11 +911,12 @@ static int dwc3_qcom_probe(struct platform_device *pdev)
 	qcom->is_suspended = false;
 	pm_runtime_set_active(dev);
 	pm_runtime_enable(dev);
-	pm_runtime_forbid(dev);
 
 	return 0;
 
 interconnect_exit:
+	dwc3_unregister_link_notifier(&qcom->link_nb);
+	cancel_work_sync(&qcom->bw_work);
 	dwc3_qcom_interconnect_exit(qcom);
 depopulate:
 	of_platform_depopulate(&pdev->dev);
@@ -851,6 +938,9 @@ static void dwc3_qcom_remove(struct platform_device *pdev)
 	struct device *dev = &pdev->dev;
 	int i;
 
+	dwc3_unregister_link_notifier(&qcom->link_nb);
+	cancel_work_sync(&qcom->bw_work);
+
 	of_platform_depopulate(&pdev->dev);
 	platform_device_put(qcom->dwc3);
 
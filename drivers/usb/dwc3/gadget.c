@@ -1211,7 +1211,7 @@ static void dwc3_prepare_one_trb(struct dwc3_ep *dep,
 	dma_addr_t		dma;
 	unsigned int		stream_id = req->request.stream_id;
 	unsigned int		short_not_ok = req->request.short_not_ok;
-	unsigned int		no_interrupt = req->request.no_interrupt;
+	unsigned int		no_interrupt = req->no_interrupt;
 	unsigned int		is_last = req->request.is_last;
 	struct dwc3		*dwc = dep->dwc;
 	struct usb_gadget	*gadget = dwc->gadget;
@@ -1462,7 +1462,7 @@ static int dwc3_prepare_trbs_sg(struct dwc3_ep *dep,
 
 				/* Check if previous requests already set IOC */
 				list_for_each_entry(r, &dep->started_list, list) {
-					if (r != req && !r->request.no_interrupt)
+					if (r != req && !r->no_interrupt)
 						break;
 
 					if (r == req)
@@ -1504,6 +1504,39 @@ static int dwc3_prepare_trbs_sg(struct dwc3_ep *dep,
 	return req->num_trbs - num_trbs;
 }
 
+/*
+ * dwc3_can_coalesce_irq - check whether @req may be prepared without IOC
+ * @dep: endpoint for which requests are being prepared
+ * @req: request about to be prepared
+ * @next: request following @req in the pending list
+ * @coalesced: number of requests already prepared without IOC in this run
+ *
+ * Only bulk IN endpoints qualify: data is already there, so whatever is
+ * queued after @req is guaranteed to complete and reclaim it. OUT requests
+ * may wait indefinitely for the host, so each of them keeps its interrupt.
+ * There must also be room for @next to be prepared, since it is the one
+ * that will carry the interrupt.
+ */
+static bool dwc3_can_coalesce_irq(struct dwc3_ep *dep, struct dwc3_request *req,
+		struct dwc3_request *next, unsigned int coalesced)
+{
+	unsigned int trbs;
+
+	if (!usb_endpoint_xfer_bulk(dep->endpoint.desc) || !dep->direction ||
+	    dep->stream_capable)
+		return false;
+
+	if (&next->list == &dep->pending_list ||
+	    coalesced >= DWC3_IOC_COALESCE_MAX - 1)
+		return false;
+
+	/* Worst case of each request, including a possible extra TRB */
+	trbs = max_t(unsigned int, req->request.num_mapped_sgs, 1) + 1;
+	trbs += max_t(unsigned int, next->request.num_sgs, 1) + 1;
+
+	return dwc3_calc_trbs_left(dep) >= trbs;
+}
+
 static int dwc3_prepare_trbs_linear(struct dwc3_ep *dep,
 		struct dwc3_request *req)
 {
@@ -1523,6 +1556,9 @@ static int dwc3_prepare_trbs_linear(struct dwc3_ep *dep,
 static int dwc3_prepare_trbs(struct dwc3_ep *dep)
 {
 	struct dwc3_request	*req, *n;
+	struct dwc3_request	*last = NULL;
+	unsigned int		coalesced = 0;
+	bool			need_ioc = false;
 	int			ret = 0;
 
 	BUILD_BUG_ON_NOT_POWER_OF_2(DWC3_TRB_NUM);
@@ -1563,23 +1599,41 @@ static int dwc3_prepare_trbs(struct dwc3_ep *dep)
 		ret = usb_gadget_map_request_by_dev(dwc->sysdev, &req->request,
 						    dep->direction);
 		if (ret)
-			return ret;
+			break;
 
 		req->sg			= req->request.sg;
 		req->start_sg		= req->sg;
 		req->num_queued_sgs	= 0;
 		req->num_pending_sgs	= req->request.num_mapped_sgs;
 
-		if (req->num_pending_sgs > 0) {
+		/*
+		 * Raise one completion interrupt for a chain of requests
+		 * queued together; the ones before it get reclaimed when the
+		 * last one completes.
+		 */
+		req->no_interrupt	= req->request.no_interrupt;
+		if (!req->no_interrupt &&
+		    dwc3_can_coalesce_irq(dep, req, n, coalesced)) {
+			req->no_interrupt = 1;
+			need_ioc = true;
+			coalesced++;
+		} else if (!req->no_interrupt) {
+			coalesced = 0;
+		}
+
+		if (req->num_pending_sgs > 0)
 			ret = dwc3_prepare_trbs_sg(dep, req);
-			if (req->num_pending_sgs)
-				return ret;
-		} else {
+		else
 			ret = dwc3_prepare_trbs_linear(dep, req);
+
+		if (ret > 0) {
+			last = req;
+			if (!req->no_interrupt)
+				need_ioc = false;
 		}
 
-		if (!ret || !dwc3_calc_trbs_left(dep))
-			return ret;
+		if (req->num_pending_sgs || !ret || !dwc3_calc_trbs_left(dep))
+			break;
 
 		/*
 		 * Don't prepare beyond a transfer. In DWC_usb32, its transfer
@@ -1588,7 +1642,19 @@ static int dwc3_prepare_trbs(struct dwc3_ep *dep)
 		 */
 		if (dep->stream_capable && req->request.is_last &&
 		    !DWC3_MST_CAPABLE(&dwc->hwparams))
-			return ret;
+			break;
+	}
+
+	/*
+	 * Requests prepared without IOC count on a later one to interrupt. If
+	 * preparing stopped before that one, the last TRB prepared has to. The
+	 * controller only picks them up with the following transfer command.
+	 */
+	if (need_ioc && last) {
+		struct dwc3_trb *trb = dwc3_ep_prev_trb(dep, dep->trb_enqueue);
+
+		trb->ctrl |= DWC3_TRB_CTRL_IOC;
+		last->no_interrupt = 0;
 	}
 
 	return ret;
@@ -3481,7 +3547,7 @@ static int dwc3_gadget_ep_cleanup_completed_request(struct dwc3_ep *dep,
 	 * needs to check and return the status of the completed TRBs associated
 	 * with the request. Use the status of the last TRB of the request.
 	 */
-	if (req->request.no_interrupt) {
+	if (req->no_interrupt) {
 		struct dwc3_trb *trb;
 
 		trb = dwc3_ep_prev_trb(dep, dep->trb_dequeue);
@@ -4346,26 +4412,33 @@ static void dwc3_gadget_interrupt(struct dwc3 *dwc,
 	switch (event->type) {
 	case DWC3_DEVICE_EVENT_DISCONNECT:
 		dwc3_gadget_disconnect_interrupt(dwc);
+		dwc3_link_notify(dwc);
 		break;
 	case DWC3_DEVICE_EVENT_RESET:
 		dwc3_gadget_reset_interrupt(dwc);
+		dwc3_link_notify(dwc);
 		break;
 	case DWC3_DEVICE_EVENT_CONNECT_DONE:
 		dwc3_gadget_conndone_interrupt(dwc);
+		dwc3_link_notify(dwc);
 		break;
 	case DWC3_DEVICE_EVENT_WAKEUP:
 		dwc3_gadget_wakeup_interrupt(dwc, event->event_info);
+		dwc3_link_notify(dwc);
 		break;
 	case DWC3_DEVICE_EVENT_HIBER_REQ:
 		dev_WARN_ONCE(dwc->dev, true, "unexpected hibernation event\n");
 		break;
 	case DWC3_DEVICE_EVENT_LINK_STATUS_CHANGE:
 		dwc3_gadget_linksts_change_interrupt(dwc, event->event_info);
+		dwc3_link_notify(dwc);
 		break;
 	case DWC3_DEVICE_EVENT_SUSPEND:
 		/* It changed to be suspend event for version 2.30a and above */
-		if (!DWC3_VER_IS_PRIOR(DWC3, 230A))
+		if (!DWC3_VER_IS_PRIOR(DWC3, 230A)) {
 			dwc3_gadget_suspend_interrupt(dwc, event->event_info);
+			dwc3_link_notify(dwc);
+		}
 		break;
 	case DWC3_DEVICE_EVENT_SOF:
 	case DWC3_DEVICE_EVENT_ERRATIC_ERROR:
@@ -229,10 +229,15 @@ static int erofs_fill_inode(struct inode *inode)
 	switch (inode->i_mode & S_IFMT) {
 	case S_IFREG:
 		inode->i_op = &erofs_generic_iops;
-		if (erofs_inode_is_data_compressed(vi->datalayout))
+		if (erofs_inode_is_data_compressed(vi->datalayout)) {
 			inode->i_fop = &generic_ro_fops;
-		else
+#ifdef CONFIG_EROFS_FS_PAGE_CACHE_SHARE
+			if (test_opt(&EROFS_I_SB(inode)->opt, INODE_SHARE))
+				inode->i_fop = &erofs_ishare_fops;
+#endif
+		} else {
 			inode->i_fop = &erofs_file_fops;
+		}
 		break;
 	case S_IFDIR:
 		inode->i_op = &erofs_dir_iops;
@@ -70,6 +70,8 @@ struct erofs_mount_opts {
 	unsigned int sync_decompress;
 	/* threshold for decompression synchronously */
 	unsigned int max_sync_decompress_pages;
+	/* steer async batches of this many pages to big CPUs (0 - off) */
+	unsigned int big_decompress_pages;
 	unsigned int mount_opt;
 };
 
@@ -129,6 +131,12 @@ struct erofs_sb_info {
 	struct inode *managed_cache;
 
 	struct erofs_sb_lz4_info lz4;
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+	/* async decompression batches queued per CPU class */
+	atomic_long_t decompress_big;
+	atomic_long_t decompress_little;
+	atomic_long_t decompress_steered;
+#endif
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	struct inode *packed_inode;
 	struct erofs_dev_context *devs;
@@ -185,6 +193,7 @@ struct erofs_sb_info {
 #define EROFS_MOUNT_POSIX_ACL		0x00000020
 #define EROFS_MOUNT_DAX_ALWAYS		0x00000040
 #define EROFS_MOUNT_DAX_NEVER		0x00000080
+#define EROFS_MOUNT_INODE_SHARE		0x00000100
 
 #define clear_opt(opt, option)	((opt)->mount_opt &= ~EROFS_MOUNT_##option)
 #define set_opt(opt, option)	((opt)->mount_opt |= EROFS_MOUNT_##option)
@@ -288,6 +297,11 @@ struct erofs_inode {
 		};
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	};
+#ifdef CONFIG_EROFS_FS_PAGE_CACHE_SHARE
+	/* on the backing list of the shared inode while opened */
+	struct list_head ishare_list;
+	unsigned int ishare_opens;
+#endif
 	/* the corresponding vfs inode */
 	struct inode vfs_inode;
 };
@@ -372,6 +386,8 @@ struct erofs_map_dev {
 };
 
 extern const struct super_operations erofs_sops;
+struct inode *erofs_alloc_inode(struct super_block *sb);
+void erofs_free_inode(struct inode *inode);
 
 extern const struct address_space_operations erofs_raw_access_aops;
 extern const struct address_space_operations z_erofs_aops;
@@ -507,6 +523,22 @@ static inline struct bio *erofs_fscache_bio_alloc(struct erofs_map_dev *mdev) {
 static inline void erofs_fscache_submit_bio(struct bio *bio) {}
 #endif
 
+#ifdef CONFIG_EROFS_FS_PAGE_CACHE_SHARE
+extern const struct file_operations erofs_ishare_fops;
+
+int __init erofs_ishare_init(void);
+void erofs_ishare_exit(void);
+struct inode *erofs_ishare_real_inode(struct file *file, struct inode *host);
+#else
+static inline int erofs_ishare_init(void) { return 0; }
+static inline void erofs_ishare_exit(void) {}
+static inline struct inode *erofs_ishare_real_inode(struct file *file,
+						    struct inode *host)
+{
+	return host;
+}
+#endif
+
 #define EFSCORRUPTED    EUCLEAN         /* Filesystem is corrupted */
 
 #endif	/* __EROFS_INTERNAL_H */
@@ -0,0 +1,238 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Page cache sharing of identical files across EROFS images.
+ *
+ * Regular files carrying a "trusted.erofs.fingerprint" xattr are backed by
+ * a shared inode on an internal pseudo mount, keyed by the mount's
+ * domain_id and the fingerprint.  Every open of such a file redirects
+ * ->f_mapping to the shared inode, so the decompressed folios are only
+ * kept once however many images (or files in one image) contain the same
+ * data.  Reads are served by whichever real inode currently has the file
+ * open, so mounts sharing a domain must trust each other's fingerprints.
+ */
+#include <linux/pseudo_fs.h>
+#include <linux/jhash.h>
+#include <linux/mount.h>
+#include "xattr.h"
+
+#define EROFS_ISHARE_FP_XATTR	"erofs.fingerprint"
+#define EROFS_ISHARE_FP_MAX	64
+
+struct erofs_ishare {
+	spinlock_t lock;
+	/* real inodes with the file currently open, via ->ishare_list */
+	struct list_head backing;
+	unsigned int keylen;
+	/* domain_id, NUL, fingerprint */
+	char key[];
+};
+
+static struct vfsmount *erofs_ishare_mnt;
+
+static void erofs_ishare_evict_inode(struct inode *inode)
+{
+	truncate_inode_pages_final(&inode->i_data);
+	clear_inode(inode);
+	kfree(inode->i_private);
+}
+
+static const struct super_operations erofs_ishare_sops = {
+	.alloc_inode	= erofs_alloc_inode,
+	.free_inode	= erofs_free_inode,
+	.evict_inode	= erofs_ishare_evict_inode,
+	.statfs		= simple_statfs,
+};
+
+static int erofs_ishare_init_fs_context(struct fs_context *fc)
+{
+	struct pseudo_fs_context *ctx = init_pseudo(fc, EROFS_SUPER_MAGIC);
+
+	if (!ctx)
+		return -ENOMEM;
+	ctx->ops = &erofs_ishare_sops;
+	return 0;
+}
+
+static struct file_system_type erofs_ishare_fs_type = {
+	.owner		= THIS_MODULE,
+	.name		= "pseudo_erofs_ishare",
+	.init_fs_context = erofs_ishare_init_fs_context,
+	.kill_sb	= kill_anon_super,
+};
+
+static int erofs_ishare_test(struct inode *inode, void *data)
+{
+	struct erofs_ishare *is = inode->i_private, *key = data;
+
+	return is->keylen == key->keylen &&
+		!memcmp(is->key, key->key, key->keylen);
+}
+
+static int erofs_ishare_set(struct inode *inode, void *data)
+{
+	/* called under inode_hash_lock, @data was allocated by the caller */
+	inode->i_private = data;
+	return 0;
+}
+
+static struct erofs_ishare *erofs_ishare_alloc_key(struct inode *inode)
+{
+	const char *domain_id = EROFS_I_SB(inode)->domain_id;
+	unsigned int dlen = strlen(domain_id) + 1;
+	struct erofs_ishare *is;
+	int fplen;
+
+	is = kmalloc(struct_size(is, key, dlen + EROFS_ISHARE_FP_MAX),
+		     GFP_KERNEL);
+	if (!is)
+		return NULL;
+
+	fplen = erofs_getxattr(inode, EROFS_XATTR_INDEX_TRUSTED,
+			       EROFS_ISHARE_FP_XATTR, is->key + dlen,
+			       EROFS_ISHARE_FP_MAX);
+	if (fplen <= 0) {
+		kfree(is);
+		return NULL;
+	}
+
+	memcpy(is->key, domain_id, dlen);
+	is->keylen = dlen + fplen;
+	spin_lock_init(&is->lock);
+	INIT_LIST_HEAD(&is->backing);
+	return is;
+}
+
+/*
+ * Look up (or create) the shared inode of @inode.  Returns NULL if the
+ * file has no usable fingerprint, in which case it is read through its own
+ * page cache as usual.
+ */
+static struct inode *erofs_ishare_iget(struct inode *inode)
+{
+	struct erofs_ishare *key;
+	struct inode *sharedinode;
+
+	key = erofs_ishare_alloc_key(inode);
+	if (!key)
+		return NULL;
+
+	sharedinode = iget5_locked(erofs_ishare_mnt->mnt_sb,
+				   jhash(key->key, key->keylen, 0),
+				   erofs_ishare_test, erofs_ishare_set, key);
+	if (!sharedinode) {
+		kfree(key);
+		return NULL;
+	}
+
+	if (sharedinode->i_state & I_NEW) {
+		sharedinode->i_mode = S_IFREG | 0444;
+		sharedinode->i_blkbits = inode->i_blkbits;
+		i_size_write(sharedinode, i_size_read(inode));
+		/* keep the folios cached once the last user closes the file */
+		set_nlink(sharedinode, 1);
+		EROFS_I(sharedinode)->nid = EROFS_I(inode)->nid;
+		sharedinode->i_mapping->a_ops = &z_erofs_aops;
+		mapping_set_large_folios(sharedinode->i_mapping);
+		unlock_new_inode(sharedinode);
+	} else {
+		kfree(key);
+	}
+
+	/* the same fingerprint must never describe files of different sizes */
+	if (i_size_read(sharedinode) != i_size_read(inode)) {
+		erofs_err(inode->i_sb, "fingerprint of nid %llu shared by a file of different size",
+			  EROFS_I(inode)->nid);
+		iput(sharedinode);
+		return NULL;
+	}
+	return sharedinode;
+}
+
+static int erofs_ishare_file_open(struct inode *inode, struct file *file)
+{
+	struct erofs_inode *vi = EROFS_I(inode);
+	struct inode *sharedinode;
+	struct erofs_ishare *is;
+
+	sharedinode = erofs_ishare_iget(inode);
+	if (!sharedinode)
+		return 0;
+
+	is = sharedinode->i_private;
+	spin_lock(&is->lock);
+	if (!vi->ishare_opens++)
+		list_add_tail(&vi->ishare_list, &is->backing);
+	spin_unlock(&is->lock);
+
+	file->private_data = sharedinode;
+	file->f_mapping = sharedinode->i_mapping;
+	file_ra_state_init(&file->f_ra, file->f_mapping);
+	return 0;
+}
+
+static int erofs_ishare_file_release(struct inode *inode, struct file *file)
+{
+	struct erofs_inode *vi = EROFS_I(inode);
+	struct inode *sharedinode = file->private_data;
+	struct erofs_ishare *is;
+
+	if (!sharedinode)
+		return 0;
+
+	is = sharedinode->i_private;
+	spin_lock(&is->lock);
+	if (!--vi->ishare_opens)
+		list_del(&vi->ishare_list);
+	spin_unlock(&is->lock);
+	iput(sharedinode);
+	return 0;
+}
+
+/*
+ * Return the erofs inode to read the folios of @host from, with a
+ * reference held if it is not @host itself.  Page faults and reads come
+ * with the file they were issued on; anything else (e.g. readahead from
+ * madvise without a file) falls back to any real inode with the file open.
+ */
+struct inode *erofs_ishare_real_inode(struct file *file, struct inode *host)
+{
+	struct erofs_ishare *is;
+	struct erofs_inode *vi;
+	struct inode *inode = NULL;
+
+	if (host->i_sb != erofs_ishare_mnt->mnt_sb)
+		return host;
+
+	if (file && file->f_mapping == host->i_mapping)
+		return igrab(file_inode(file));
+
+	is = host->i_private;
+	spin_lock(&is->lock);
+	list_for_each_entry(vi, &is->backing, ishare_list) {
+		inode = igrab(&vi->vfs_inode);
+		if (inode)
+			break;
+	}
+	spin_unlock(&is->lock);
+	return inode;
+}
+
+const struct file_operations erofs_ishare_fops = {
+	.open		= erofs_ishare_file_open,
+	.release	= erofs_ishare_file_release,
+	.llseek		= generic_file_llseek,
+	.read_iter	= generic_file_read_iter,
+	.mmap		= generic_file_readonly_mmap,
+	.splice_read	= filemap_splice_read,
+};
+
+int __init erofs_ishare_init(void)
+{
+	erofs_ishare_mnt = kern_mount(&erofs_ishare_fs_type);
+	return PTR_ERR_OR_ZERO(erofs_ishare_mnt);
+}
+
+void erofs_ishare_exit(void)
+{
+	kern_unmount(erofs_ishare_mnt);
+}
@@ -85,7 +85,7 @@ static void erofs_inode_init_once(void *ptr)
 	inode_init_once(&vi->vfs_inode);
 }
 
-static struct inode *erofs_alloc_inode(struct super_block *sb)
+struct inode *erofs_alloc_inode(struct super_block *sb)
 {
 	struct erofs_inode *vi =
 		alloc_inode_sb(sb, erofs_inode_cachep, GFP_KERNEL);
@@ -98,7 +98,7 @@ static struct inode *erofs_alloc_inode(struct super_block *sb)
 	return &vi->vfs_inode;
 }
 
-static void erofs_free_inode(struct inode *inode)
+void erofs_free_inode(struct inode *inode)
 {
 	struct erofs_inode *vi = EROFS_I(inode);
 
@@ -378,6 +378,7 @@ enum {
 	Opt_device,
 	Opt_fsid,
 	Opt_domain_id,
+	Opt_inode_share,
 	Opt_err
 };
 
@@ -404,6 +405,7 @@ static const struct fs_parameter_spec erofs_fs_parameters[] = {
 	fsparam_string("device",	Opt_device),
 	fsparam_string("fsid",		Opt_fsid),
 	fsparam_string("domain_id",	Opt_domain_id),
+	fsparam_flag("inode_share",	Opt_inode_share),
 	{}
 };
 
@@ -505,6 +507,12 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 		if (!sbi->fsid)
 			return -ENOMEM;
 		break;
+#else
+	case Opt_fsid:
+		errorfc(fc, "%s option not supported", erofs_fs_parameters[opt].name);
+		break;
+#endif
+#if defined(CONFIG_EROFS_FS_ONDEMAND) || defined(CONFIG_EROFS_FS_PAGE_CACHE_SHARE)
 	case Opt_domain_id:
 		kfree(sbi->domain_id);
 		sbi->domain_id = kstrdup(param->string, GFP_KERNEL);
@@ -512,11 +520,17 @@ static int erofs_fc_parse_param(struct fs_context *fc,
 			return -ENOMEM;
 		break;
 #else
-	case Opt_fsid:
 	case Opt_domain_id:
 		errorfc(fc, "%s option not supported", erofs_fs_parameters[opt].name);
 		break;
 #endif
+	case Opt_inode_share:
+#ifdef CONFIG_EROFS_FS_PAGE_CACHE_SHARE
+		set_opt(&sbi->opt, INODE_SHARE);
+#else
+		errorfc(fc, "%s option not supported", erofs_fs_parameters[opt].name);
+#endif
+		break;
 	default:
 		return -ENOPARAM;
 	}
@@ -636,6 +650,11 @@ static int erofs_fc_fill_super(struct super_block *sb, struct fs_context *fc)
 		}
 	}
 
+	if (test_opt(&sbi->opt, INODE_SHARE) && !sbi->domain_id) {
+		errorfc(fc, "inode_share requires domain_id");
+		return -EINVAL;
+	}
+
 	sb->s_time_gran = 1;
 	sb->s_xattr = erofs_xattr_handlers;
 	sb->s_export_op = &erofs_export_ops;
@@ -716,6 +735,15 @@ static int erofs_fc_reconfigure(struct fs_context *fc)
 	else
 		fc->sb_flags &= ~SB_POSIXACL;
 
+	if (test_opt(&new_sbi->opt, INODE_SHARE) !=
+	    test_opt(&sbi->opt, INODE_SHARE)) {
+		erofs_info(sb, "ignoring reconfiguration for inode_share.");
+		if (test_opt(&sbi->opt, INODE_SHARE))
+			set_opt(&new_sbi->opt, INODE_SHARE);
+		else
+			clear_opt(&new_sbi->opt, INODE_SHARE);
+	}
+
 	sbi->opt = new_sbi->opt;
 
 	fc->sb_flags |= SB_RDONLY;
@@ -859,6 +887,10 @@ static int __init erofs_module_init(void)
 	if (err)
 		goto sysfs_err;
 
+	err = erofs_ishare_init();
+	if (err)
+		goto ishare_err;
+
 	err = register_filesystem(&erofs_fs_type);
 	if (err)
 		goto fs_err;
@@ -866,6 +898,8 @@ static int __init erofs_module_init(void)
 	return 0;
 
 fs_err:
+	erofs_ishare_exit();
+ishare_err:
 	erofs_exit_sysfs();
 sysfs_err:
 	z_erofs_exit_subsystem();
@@ -880,6 +914,8 @@ static void __exit erofs_module_exit(void)
 {
 	unregister_filesystem(&erofs_fs_type);
 
+	erofs_ishare_exit();
+
 	/* Ensure all RCU free inodes / pclusters are safe to be destroyed. */
 	rcu_barrier();
 
@@ -930,9 +966,11 @@ static int erofs_show_options(struct seq_file *seq, struct dentry *root)
 #ifdef CONFIG_EROFS_FS_ONDEMAND
 	if (sbi->fsid)
 		seq_printf(seq, ",fsid=%s", sbi->fsid);
+#endif
 	if (sbi->domain_id)
 		seq_printf(seq, ",domain_id=%s", sbi->domain_id);
-#endif
+	if (test_opt(opt, INODE_SHARE))
+		seq_puts(seq, ",inode_share");
 	return 0;
 }
 
@@ -12,6 +12,7 @@ enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_pointer_atomic_long,
 };
 
 enum {
@@ -57,11 +58,23 @@ static struct erofs_attr erofs_attr_##_name = {			\
 
 #ifdef CONFIG_EROFS_FS_ZIP
 EROFS_ATTR_RW_UI(sync_decompress, erofs_mount_opts);
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+EROFS_ATTR_RW_UI(big_decompress_pages, erofs_mount_opts);
+EROFS_RO_ATTR(decompress_big, pointer_atomic_long, erofs_sb_info);
+EROFS_RO_ATTR(decompress_little, pointer_atomic_long, erofs_sb_info);
+EROFS_RO_ATTR(decompress_steered, pointer_atomic_long, erofs_sb_info);
+#endif
 #endif
 
 static struct attribute *erofs_attrs[] = {
 #ifdef CONFIG_EROFS_FS_ZIP
 	ATTR_LIST(sync_decompress),
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+	ATTR_LIST(big_decompress_pages),
+	ATTR_LIST(decompress_big),
+	ATTR_LIST(decompress_little),
+	ATTR_LIST(decompress_steered),
+#endif
 #endif
 	NULL,
 };
@@ -123,6 +136,11 @@ static ssize_t erofs_attr_show(struct kobject *kobj,
 		if (!ptr)
 			return 0;
 		return sysfs_emit(buf, "%d\n", *(bool *)ptr);
+	case attr_pointer_atomic_long:
+		if (!ptr)
+			return 0;
+		return sysfs_emit(buf, "%ld\n",
+				  atomic_long_read((atomic_long_t *)ptr));
 	}
 	return 0;
 }
@@ -7,6 +7,7 @@
 #include "compress.h"
 #include <linux/psi.h>
 #include <linux/cpuhotplug.h>
+#include <linux/sched/topology.h>
 #include <trace/events/erofs.h>
 
 #define Z_EROFS_PCLUSTER_MAX_PAGES	(Z_EROFS_PCLUSTER_MAX_SIZE / PAGE_SIZE)
@@ -103,6 +104,7 @@ struct z_erofs_decompressqueue {
 		struct work_struct work;
 		struct kthread_work kthread_work;
 	} u;
+	unsigned int nr_pages;	/* compressed pages to be decompressed */
 	bool eio, sync;
 };
 
@@ -521,6 +523,8 @@ enum z_erofs_pclustermode {
 
 struct z_erofs_decompress_frontend {
 	struct inode *const inode;
+	/* page cache being filled, not ->i_mapping of a shared file */
+	struct address_space *const mapping;
 	struct erofs_map_blocks map;
 	struct z_erofs_bvec_iter biter;
 
@@ -536,8 +540,8 @@ struct z_erofs_decompress_frontend {
 	unsigned int icur;
 };
 
-#define DECOMPRESS_FRONTEND_INIT(__i) { \
-	.inode = __i, .owned_head = Z_EROFS_PCLUSTER_TAIL, \
+#define DECOMPRESS_FRONTEND_INIT(__i, __m) { \
+	.inode = __i, .mapping = __m, .owned_head = Z_EROFS_PCLUSTER_TAIL, \
 	.mode = Z_EROFS_PCLUSTER_FOLLOWED }
 
 static bool z_erofs_should_alloc_cache(struct z_erofs_decompress_frontend *fe)
@@ -1375,6 +1379,49 @@ static void z_erofs_decompressqueue_kthread_work(struct kthread_work *work)
 {
 	z_erofs_decompressqueue_work((struct work_struct *)work);
 }
+
+static bool z_erofs_cpu_is_big(int cpu)
+{
+	return arch_scale_cpu_capacity(cpu) >= SCHED_CAPACITY_SCALE;
+}
+
+/*
+ * Decompression on a little core of an asymmetric system can be several
+ * times slower than on a big one.  Hand large batches, or any batch when
+ * the local worker is already backed up, over to a big core's worker.
+ * Must be called under rcu_read_lock().
+ */
+static int z_erofs_decompress_cpu(struct erofs_sb_info *sbi,
+				  struct z_erofs_decompressqueue *io)
+{
+	static atomic_t rotor;
+	unsigned int thresh = READ_ONCE(sbi->opt.big_decompress_pages);
+	int cpu = raw_smp_processor_id(), big;
+	struct kthread_worker *worker;
+
+	if (z_erofs_cpu_is_big(cpu)) {
+		atomic_long_inc(&sbi->decompress_big);
+		return cpu;
+	}
+
+	worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+	if (thresh && (io->nr_pages >= thresh ||
+		       (worker && !list_empty(&worker->work_list)))) {
+		unsigned int start = (unsigned int)atomic_inc_return(&rotor) %
+					nr_cpu_ids;
+
+		for_each_cpu_wrap(big, cpu_online_mask, start) {
+			if (!z_erofs_cpu_is_big(big) ||
+			    !rcu_access_pointer(z_erofs_pcpu_workers[big]))
+				continue;
+			atomic_long_inc(&sbi->decompress_steered);
+			atomic_long_inc(&sbi->decompress_big);
+			return big;
+		}
+	}
+	atomic_long_inc(&sbi->decompress_little);
+	return cpu;
+}
 #endif
 
 static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
@@ -1395,10 +1442,11 @@ static void z_erofs_decompress_kickoff(struct z_erofs_decompressqueue *io,
 	if (!in_task() || irqs_disabled() || rcu_read_lock_any_held()) {
 #ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
 		struct kthread_worker *worker;
+		int cpu;
 
 		rcu_read_lock();
-		worker = rcu_dereference(
-				z_erofs_pcpu_workers[raw_smp_processor_id()]);
+		cpu = z_erofs_decompress_cpu(sbi, io);
+		worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
 		if (!worker) {
 			INIT_WORK(&io->u.work, z_erofs_decompressqueue_work);
 			queue_work(z_erofs_workqueue, &io->u.work);
@@ -1545,6 +1593,7 @@ static struct z_erofs_decompressqueue *jobqueue_init(struct super_block *sb,
 	}
 	q->sb = sb;
 	q->head = Z_EROFS_PCLUSTER_TAIL;
+	q->nr_pages = 0;
 	return q;
 }
 
@@ -1696,10 +1745,13 @@ static void z_erofs_submit_queue(struct z_erofs_decompress_frontend *f,
 			bypass = false;
 		} while ((cur += bvec.bv_len) < end);
 
-		if (!bypass)
+		if (!bypass) {
 			qtail[JQ_SUBMIT] = &pcl->next;
-		else
+			q[JQ_SUBMIT]->nr_pages +=
+				DIV_ROUND_UP(pcl->pclustersize, PAGE_SIZE);
+		} else {
 			move_to_bypass_jobqueue(pcl, qtail, owned_head);
+		}
 	} while (owned_head != Z_EROFS_PCLUSTER_TAIL);
 
 	if (bio) {
@@ -1785,7 +1837,7 @@ static void z_erofs_pcluster_readmore(struct z_erofs_decompress_frontend *f,
 		pgoff_t index = cur >> PAGE_SHIFT;
 		struct folio *folio;
 
-		folio = erofs_grab_folio_nowait(inode->i_mapping, index);
+		folio = erofs_grab_folio_nowait(f->mapping, index);
 		if (!IS_ERR_OR_NULL(folio)) {
 			if (folio_test_uptodate(folio))
 				folio_unlock(folio);
@@ -1802,12 +1854,20 @@ static void z_erofs_pcluster_readmore(struct z_erofs_decompress_frontend *f,
 
 static int z_erofs_read_folio(struct file *file, struct folio *folio)
 {
-	struct inode *const inode = folio->mapping->host;
-	struct erofs_sb_info *const sbi = EROFS_I_SB(inode);
-	struct z_erofs_decompress_frontend f = DECOMPRESS_FRONTEND_INIT(inode);
+	struct inode *const host = folio->mapping->host;
+	struct inode *const inode = erofs_ishare_real_inode(file, host);
+	struct z_erofs_decompress_frontend f =
+		DECOMPRESS_FRONTEND_INIT(inode, folio->mapping);
+	struct erofs_sb_info *sbi;
 	int err;
 
 	trace_erofs_read_folio(folio, false);
+	if (!inode) {
+		folio_unlock(folio);
+		return -EIO;
+	}
+
+	sbi = EROFS_I_SB(inode);
 	f.headoffset = (erofs_off_t)folio->index << PAGE_SHIFT;
 
 	z_erofs_pcluster_readmore(&f, NULL, true);
@@ -1824,18 +1884,27 @@ static int z_erofs_read_folio(struct file *file, struct folio *folio)
 
 	erofs_put_metabuf(&f.map.buf);
 	erofs_release_pages(&f.pagepool);
+	if (inode != host)
+		iput(inode);
 	return err;
 }
 
 static void z_erofs_readahead(struct readahead_control *rac)
 {
-	struct inode *const inode = rac->mapping->host;
-	struct erofs_sb_info *const sbi = EROFS_I_SB(inode);
-	struct z_erofs_decompress_frontend f = DECOMPRESS_FRONTEND_INIT(inode);
+	struct inode *const host = rac->mapping->host;
+	struct inode *const inode = erofs_ishare_real_inode(rac->file, host);
+	struct z_erofs_decompress_frontend f =
+		DECOMPRESS_FRONTEND_INIT(inode, rac->mapping);
 	struct folio *head = NULL, *folio;
+	struct erofs_sb_info *sbi;
 	unsigned int nr_folios;
 	int err;
 
+	/* the folios left in @rac are dropped by the caller */
+	if (!inode)
+		return;
+
+	sbi = EROFS_I_SB(inode);
 	f.headoffset = readahead_pos(rac);
 
 	z_erofs_pcluster_readmore(&f, rac, true);
@@ -1863,6 +1932,8 @@ static void z_erofs_readahead(struct readahead_control *rac)
 	z_erofs_runqueue(&f, z_erofs_is_sync_decompress(sbi, nr_folios), true);
 	erofs_put_metabuf(&f.map.buf);
 	erofs_release_pages(&f.pagepool);
+	if (inode != host)
+		iput(inode);
 }
 
 const struct address_space_operations z_erofs_aops = {
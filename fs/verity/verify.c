@@ -12,6 +12,50 @@
 
 static struct workqueue_struct *fsverity_read_workqueue;
 
+/*
+ * State kept across the data blocks of one verification request.  Adjacent
+ * data blocks almost always hash into the same level 0 hash block, so keep
+ * the last verified one pinned and take the wanted hash straight from it.
+ */
+struct fsverity_verification_ctx {
+	struct inode *inode;
+	struct fsverity_info *vi;
+	unsigned long max_ra_pages;
+	/* Page containing the last verified level 0 hash block, or NULL */
+	struct page *hpage;
+	/* Index of that hash block in the tree overall */
+	unsigned long hblock_idx;
+};
+
+static void fsverity_init_verification_ctx(struct fsverity_verification_ctx *ctx,
+					   struct inode *inode,
+					   unsigned long max_ra_pages)
+{
+	ctx->inode = inode;
+	ctx->vi = inode->i_verity_info;
+	ctx->max_ra_pages = max_ra_pages;
+	ctx->hpage = NULL;
+	ctx->hblock_idx = 0;
+}
+
+/* Takes over the caller's reference to @hpage. */
+static void fsverity_cache_hash_block(struct fsverity_verification_ctx *ctx,
+				      struct page *hpage,
+				      unsigned long hblock_idx)
+{
+	if (ctx->hpage)
+		put_page(ctx->hpage);
+	ctx->hpage = hpage;
+	ctx->hblock_idx = hblock_idx;
+}
+
+static void fsverity_destroy_verification_ctx(struct fsverity_verification_ctx *ctx)
+{
+	if (ctx->hpage)
+		put_page(ctx->hpage);
+	ctx->hpage = NULL;
+}
+
 /*
  * Returns true if the hash block with index @hblock_idx in the tree, located in
  * @hpage, has already been verified.
@@ -89,9 +133,11 @@ static bool is_hash_block_verified(struct fsverity_info *vi, struct page *hpage,
  * Return: %true if the data block is valid, else %false.
  */
 static bool
-verify_data_block(struct inode *inode, struct fsverity_info *vi,
-		  const void *data, u64 data_pos, unsigned long max_ra_pages)
+verify_data_block(struct fsverity_verification_ctx *ctx, const void *data,
+		  u64 data_pos)
 {
+	struct inode *inode = ctx->inode;
+	struct fsverity_info *vi = ctx->vi;
 	const struct merkle_tree_params *params = &vi->tree_params;
 	const unsigned int hsize = params->digest_size;
 	int level;
@@ -169,8 +215,18 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 		hoffset = (hidx << params->log_digestsize) &
 			  (params->block_size - 1);
 
+		if (level == 0 && ctx->hpage && ctx->hblock_idx == hblock_idx) {
+			/* Already verified while handling a previous block */
+			haddr = kmap_local_page(ctx->hpage) +
+				hblock_offset_in_page;
+			memcpy(_want_hash, haddr + hoffset, hsize);
+			want_hash = _want_hash;
+			kunmap_local(haddr);
+			goto descend;
+		}
+
 		hpage = inode->i_sb->s_vop->read_merkle_tree_page(inode,
-				hpage_idx, level == 0 ? min(max_ra_pages,
+				hpage_idx, level == 0 ? min(ctx->max_ra_pages,
 					params->tree_pages - hpage_idx) : 0);
 		if (IS_ERR(hpage)) {
 			fsverity_err(inode,
@@ -183,7 +239,10 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 			memcpy(_want_hash, haddr + hoffset, hsize);
 			want_hash = _want_hash;
 			kunmap_local(haddr);
-			put_page(hpage);
+			if (level == 0)
+				fsverity_cache_hash_block(ctx, hpage, hblock_idx);
+			else
+				put_page(hpage);
 			goto descend;
 		}
 		hblocks[level].page = hpage;
@@ -218,7 +277,10 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 		memcpy(_want_hash, haddr + hoffset, hsize);
 		want_hash = _want_hash;
 		kunmap_local(haddr);
-		put_page(hpage);
+		if (level == 1)
+			fsverity_cache_hash_block(ctx, hpage, hblock_idx);
+		else
+			put_page(hpage);
 	}
 
 	/* Finally, verify the data block. */
@@ -243,12 +305,10 @@ verify_data_block(struct inode *inode, struct fsverity_info *vi,
 }
 
 static bool
-verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
-		   unsigned long max_ra_pages)
+verify_data_blocks(struct fsverity_verification_ctx *ctx,
+		   struct folio *data_folio, size_t len, size_t offset)
 {
-	struct inode *inode = data_folio->mapping->host;
-	struct fsverity_info *vi = inode->i_verity_info;
-	const unsigned int block_size = vi->tree_params.block_size;
+	const unsigned int block_size = ctx->vi->tree_params.block_size;
 	u64 pos = (u64)data_folio->index << PAGE_SHIFT;
 
 	if (WARN_ON_ONCE(len <= 0 || !IS_ALIGNED(len | offset, block_size)))
@@ -261,8 +321,7 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
 		bool valid;
 
 		data = kmap_local_folio(data_folio, offset);
-		valid = verify_data_block(inode, vi, data, pos + offset,
-					  max_ra_pages);
+		valid = verify_data_block(ctx, data, pos + offset);
 		kunmap_local(data);
 		if (!valid)
 			return false;
@@ -286,7 +345,13 @@ verify_data_blocks(struct folio *data_folio, size_t len, size_t offset,
  */
 bool fsverity_verify_blocks(struct folio *folio, size_t len, size_t offset)
 {
-	return verify_data_blocks(folio, len, offset, 0);
+	struct fsverity_verification_ctx ctx;
+	bool valid;
+
+	fsverity_init_verification_ctx(&ctx, folio->mapping->host, 0);
+	valid = verify_data_blocks(&ctx, folio, len, offset);
+	fsverity_destroy_verification_ctx(&ctx);
+	return valid;
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_blocks);
 
@@ -307,6 +372,8 @@ EXPORT_SYMBOL_GPL(fsverity_verify_blocks);
  */
 void fsverity_verify_bio(struct bio *bio)
 {
+	struct inode *inode = bio_first_folio_all(bio)->mapping->host;
+	struct fsverity_verification_ctx ctx;
 	struct folio_iter fi;
 	unsigned long max_ra_pages = 0;
 
@@ -323,13 +390,14 @@ void fsverity_verify_bio(struct bio *bio)
 		max_ra_pages = bio->bi_iter.bi_size >> (PAGE_SHIFT + 2);
 	}
 
+	fsverity_init_verification_ctx(&ctx, inode, max_ra_pages);
 	bio_for_each_folio_all(fi, bio) {
-		if (!verify_data_blocks(fi.folio, fi.length, fi.offset,
-					max_ra_pages)) {
+		if (!verify_data_blocks(&ctx, fi.folio, fi.length, fi.offset)) {
 			bio->bi_status = BLK_STS_IOERR;
 			break;
 		}
 	}
+	fsverity_destroy_verification_ctx(&ctx);
 }
 EXPORT_SYMBOL_GPL(fsverity_verify_bio);
 #endif /* CONFIG_BLOCK */
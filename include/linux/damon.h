@@ -780,6 +780,7 @@ int damon_stop(struct damon_ctx **ctxs, int nr_ctxs);
 
 int damon_set_region_biggest_system_ram_default(struct damon_target *t,
 				unsigned long *start, unsigned long *end);
+int damon_memcg_path_to_id(const char *memcg_path, unsigned short *id);
 
 #endif	/* CONFIG_DAMON */
 
@@ -117,6 +117,8 @@ int request_firmware_into_buf(const struct firmware **firmware_p,
 int request_partial_firmware_into_buf(const struct firmware **firmware_p,
 				      const char *name, struct device *device,
 				      void *buf, size_t size, size_t offset);
+int firmware_request_prefetch(struct device *device, const char *name);
+void firmware_prefetch_drop(struct device *device, const char *name);
 
 void release_firmware(const struct firmware *fw);
 #else
@@ -183,6 +185,17 @@ static inline int request_partial_firmware_into_buf
 	return -EINVAL;
 }
 
+static inline int firmware_request_prefetch(struct device *device,
+					    const char *name)
+{
+	return -EINVAL;
+}
+
+static inline void firmware_prefetch_drop(struct device *device,
+					  const char *name)
+{
+}
+
 #endif
 
 #ifdef CONFIG_FW_UPLOAD
@@ -45,6 +45,9 @@ struct irqstat {
  * @irqs_unhandled:	stats field for spurious unhandled interrupts
  * @threads_handled:	stats field for deferred spurious detection of threaded handlers
  * @threads_handled_last: comparator field for deferred spurious detection of threaded handlers
+ * @cap_last_count:	interrupt count at the last capacity balancing sample
+ * @cap_rate:		interrupts per second over the last sampling interval
+ * @cap_moved:		moved to the biggest CPUs by capacity balancing
  * @lock:		locking for SMP
  * @affinity_hint:	hint to user space for preferred irq affinity
  * @affinity_notify:	context for notification of affinity changes
@@ -80,6 +83,11 @@ struct irq_desc {
 	unsigned int		irqs_unhandled;
 	atomic_t		threads_handled;
 	int			threads_handled_last;
+#ifdef CONFIG_IRQ_CAPACITY_BALANCE
+	unsigned int		cap_last_count;
+	unsigned int		cap_rate;
+	bool			cap_moved;
+#endif
 	raw_spinlock_t		lock;
 	struct cpumask		*percpu_enabled;
 	const struct cpumask	*percpu_affinity;
@@ -7,6 +7,8 @@
  * lock implementations (mutex, rwsem, etc).
  */
 
+struct task_struct;
+
 struct optimistic_spin_queue {
 	/*
 	 * Stores an encoded value of the CPU # of the tail node in the queue.
@@ -27,6 +29,7 @@ static inline void osq_lock_init(struct optimistic_spin_queue *lock)
 
 extern bool osq_lock(struct optimistic_spin_queue *lock);
 extern void osq_unlock(struct optimistic_spin_queue *lock);
+extern bool osq_owner_capacity_ok(struct task_struct *owner);
 
 static inline bool osq_is_locked(struct optimistic_spin_queue *lock)
 {
@@ -124,6 +124,8 @@ struct gpd_dev_ops {
 	int (*stop)(struct device *dev);
 };
 
+#define GENPD_GOV_OFF_HISTORY	8
+
 struct genpd_governor_data {
 	s64 max_off_time_ns;
 	bool max_off_time_changed;
@@ -131,6 +133,9 @@ struct genpd_governor_data {
 	ktime_t next_hrtimer;
 	bool cached_power_down_ok;
 	bool cached_power_down_state_idx;
+	ktime_t off_start;
+	s64 early_wakeup_ns[GENPD_GOV_OFF_HISTORY];
+	unsigned int early_wakeup_idx;
 };
 
 struct genpd_power_state {
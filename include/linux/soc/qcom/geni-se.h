@@ -47,9 +47,18 @@ enum geni_icc_path_index {
 	GENI_TO_DDR
 };
 
+/**
+ * struct geni_icc_path - GENI SE interconnect path
+ * @path:	Handle to the interconnect path
+ * @avg_bw:	Bandwidth to request on the next geni_icc_set_bw()
+ * @voted_bw:	Bandwidth last committed to the interconnect framework
+ * @voted:	@voted_bw is valid and matches the path's current request
+ */
 struct geni_icc_path {
 	struct icc_path *path;
 	unsigned int avg_bw;
+	unsigned int voted_bw;
+	bool voted;
 };
 
 /**
@@ -123,6 +123,8 @@ struct llcc_edac_reg_offset {
  * @cfg_size: size of the config data table
  * @max_slices: max slices as read from device tree
  * @num_banks: Number of llcc banks
+ * @ways_mask: Cache ways that may be assigned to slices
+ * @cache_size: Upper bound of a slice's max capacity in KB
  * @bitmap: Bit map to track the active slice ids
  * @ecc_irq: interrupt for llcc cache error detection and reporting
  * @version: Indicates the LLCC version
@@ -131,12 +133,14 @@ struct llcc_drv_data {
 	struct regmap **regmaps;
 	struct regmap *bcast_regmap;
 	struct regmap *bcast_and_regmap;
-	const struct llcc_slice_config *cfg;
+	struct llcc_slice_config *cfg;
 	const struct llcc_edac_reg_offset *edac_reg_offset;
 	struct mutex lock;
 	u32 cfg_size;
 	u32 max_slices;
 	u32 num_banks;
+	u32 ways_mask;
+	u32 cache_size;
 	unsigned long *bitmap;
 	int ecc_irq;
 	u32 version;
@@ -149,6 +153,12 @@ struct llcc_drv_data {
  */
 struct llcc_slice_desc *llcc_slice_getd(u32 uid);
 
+/**
+ * llcc_slice_getd_optional - get llcc slice descriptor, if there is one
+ * @uid: usecase_id of the client
+ */
+struct llcc_slice_desc *llcc_slice_getd_optional(u32 uid);
+
 /**
  * llcc_slice_putd - llcc slice descritpor
  * @desc: Pointer to llcc slice descriptor
@@ -167,6 +177,15 @@ int llcc_get_slice_id(struct llcc_slice_desc *desc);
  */
 size_t llcc_get_slice_size(struct llcc_slice_desc *desc);
 
+/**
+ * llcc_get_slice_ways - llcc slice ways masks
+ * @desc: Pointer to llcc slice descriptor
+ * @bonus_ways: Returns the bonus ways mask
+ * @res_ways: Returns the reserved ways mask
+ */
+int llcc_get_slice_ways(struct llcc_slice_desc *desc, u32 *bonus_ways,
+			u32 *res_ways);
+
 /**
  * llcc_slice_activate - Activate the llcc slice
  * @desc: Pointer to llcc slice descriptor
@@ -179,12 +198,27 @@ int llcc_slice_activate(struct llcc_slice_desc *desc);
  */
 int llcc_slice_deactivate(struct llcc_slice_desc *desc);
 
+/**
+ * llcc_slice_reconfigure - Change the size and ways of the llcc slice
+ * @desc: Pointer to llcc slice descriptor
+ * @max_cap: Maximum capacity in KB
+ * @bonus_ways: Bonus ways mask
+ * @res_ways: Reserved ways mask
+ */
+int llcc_slice_reconfigure(struct llcc_slice_desc *desc, u32 max_cap,
+			   u32 bonus_ways, u32 res_ways);
+
 #else
 static inline struct llcc_slice_desc *llcc_slice_getd(u32 uid)
 {
 	return NULL;
 }
 
+static inline struct llcc_slice_desc *llcc_slice_getd_optional(u32 uid)
+{
+	return NULL;
+}
+
 static inline void llcc_slice_putd(struct llcc_slice_desc *desc)
 {
 
@@ -199,6 +233,11 @@ static inline size_t llcc_get_slice_size(struct llcc_slice_desc *desc)
 {
 	return 0;
 }
+static inline int llcc_get_slice_ways(struct llcc_slice_desc *desc,
+				      u32 *bonus_ways, u32 *res_ways)
+{
+	return -EINVAL;
+}
 static inline int llcc_slice_activate(struct llcc_slice_desc *desc)
 {
 	return -EINVAL;
@@ -208,6 +247,13 @@ static inline int llcc_slice_deactivate(struct llcc_slice_desc *desc)
 {
 	return -EINVAL;
 }
+
+static inline int llcc_slice_reconfigure(struct llcc_slice_desc *desc,
+					 u32 max_cap, u32 bonus_ways,
+					 u32 res_ways)
+{
+	return -EINVAL;
+}
 #endif
 
 #endif
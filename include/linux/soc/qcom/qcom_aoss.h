@@ -11,9 +11,13 @@
 
 struct qmp;
 
+typedef void (*qmp_done_t)(void *data, int ret);
+
 #if IS_ENABLED(CONFIG_QCOM_AOSS_QMP)
 
 int qmp_send(struct qmp *qmp, const char *fmt, ...);
+int qmp_send_async(struct qmp *qmp, const char *res, qmp_done_t done,
+		   void *data, const char *fmt, ...);
 struct qmp *qmp_get(struct device *dev);
 void qmp_put(struct qmp *qmp);
 
@@ -24,6 +28,13 @@ static inline int qmp_send(struct qmp *qmp, const char *fmt, ...)
 	return -ENODEV;
 }
 
+static inline int qmp_send_async(struct qmp *qmp, const char *res,
+				 qmp_done_t done, void *data,
+				 const char *fmt, ...)
+{
+	return -ENODEV;
+}
+
 static inline struct qmp *qmp_get(struct device *dev)
 {
 	return ERR_PTR(-ENODEV);
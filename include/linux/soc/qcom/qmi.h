@@ -127,6 +127,7 @@ struct qmi_service {
 };
 
 struct qmi_handle;
+struct qmi_lane;
 
 /**
  * struct qmi_ops - callbacks for qmi_handle
@@ -205,6 +206,11 @@ struct qmi_msg_handler {
  * @wq:		workqueue to post @work on
  * @recv_buf:	scratch buffer for handling incoming messages
  * @recv_buf_size:	size of @recv_buf
+ * @decode_buf:	preallocated buffer to decode messages for @handlers into
+ * @decode_buf_size:	size of @decode_buf, the largest decoded_size of
+ *			@handlers
+ * @lanes:	dispatch lanes, used when messages are handled concurrently
+ * @nr_lanes:	number of entries in @lanes, 0 for in-order handling
  * @lookups:		list of registered lookup requests
  * @lookup_results:	list of lookup-results advertised to the client
  * @services:		list of registered services (by this client)
@@ -225,6 +231,12 @@ struct qmi_handle {
 	void *recv_buf;
 	size_t recv_buf_size;
 
+	void *decode_buf;
+	size_t decode_buf_size;
+
+	struct qmi_lane *lanes;
+	unsigned int nr_lanes;
+
 	struct list_head lookups;
 	struct list_head lookup_results;
 	struct list_head services;
@@ -245,6 +257,10 @@ int qmi_add_server(struct qmi_handle *qmi, unsigned int service,
 int qmi_handle_init(struct qmi_handle *qmi, size_t max_msg_len,
 		    const struct qmi_ops *ops,
 		    const struct qmi_msg_handler *handlers);
+int qmi_handle_init_concurrent(struct qmi_handle *qmi, size_t max_msg_len,
+			       const struct qmi_ops *ops,
+			       const struct qmi_msg_handler *handlers,
+			       unsigned int nr_lanes);
 void qmi_handle_release(struct qmi_handle *qmi);
 
 ssize_t qmi_send_request(struct qmi_handle *qmi, struct sockaddr_qrtr *sq,
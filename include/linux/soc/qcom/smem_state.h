@@ -7,8 +7,29 @@
 struct device_node;
 struct qcom_smem_state;
 
+/**
+ * struct qcom_smem_state_ops - operations of a state provider
+ * @update_bits:	update the masked bits and signal the remote
+ * @update_bits_nokick:	optional, update the masked bits without signalling
+ *			the remote, @kick is called once the batch is done
+ * @kick:		optional, signal the remote about deferred updates
+ */
 struct qcom_smem_state_ops {
 	int (*update_bits)(void *, u32, u32);
+	int (*update_bits_nokick)(void *, u32, u32);
+	void (*kick)(void *);
+};
+
+/**
+ * struct qcom_smem_state_update - one entry of a batched state update
+ * @state:	state handle acquired by calling qcom_smem_state_get()
+ * @mask:	bit mask for the change
+ * @value:	new value for the masked bits
+ */
+struct qcom_smem_state_update {
+	struct qcom_smem_state *state;
+	u32 mask;
+	u32 value;
 };
 
 #ifdef CONFIG_QCOM_SMEM_STATE
@@ -18,6 +39,8 @@ struct qcom_smem_state *devm_qcom_smem_state_get(struct device *dev, const char
 void qcom_smem_state_put(struct qcom_smem_state *);
 
 int qcom_smem_state_update_bits(struct qcom_smem_state *state, u32 mask, u32 value);
+int qcom_smem_state_update_bits_batch(const struct qcom_smem_state_update *updates,
+				      unsigned int count);
 
 struct qcom_smem_state *qcom_smem_state_register(struct device_node *of_node, const struct qcom_smem_state_ops *ops, void *data);
 void qcom_smem_state_unregister(struct qcom_smem_state *state);
@@ -47,6 +70,12 @@ static inline int qcom_smem_state_update_bits(struct qcom_smem_state *state,
 	return -EINVAL;
 }
 
+static inline int qcom_smem_state_update_bits_batch(const struct qcom_smem_state_update *updates,
+						    unsigned int count)
+{
+	return -EINVAL;
+}
+
 static inline struct qcom_smem_state *qcom_smem_state_register(struct device_node *of_node,
 	const struct qcom_smem_state_ops *ops, void *data)
 {
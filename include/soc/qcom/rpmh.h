@@ -22,6 +22,8 @@ int rpmh_write_batch(const struct device *dev, enum rpmh_state state,
 
 void rpmh_invalidate(const struct device *dev);
 
+void rpmh_get_last_wakeup(u64 *written_at, u64 *wakeup);
+
 #else
 
 static inline int rpmh_write(const struct device *dev, enum rpmh_state state,
@@ -42,6 +44,12 @@ static inline void rpmh_invalidate(const struct device *dev)
 {
 }
 
+static inline void rpmh_get_last_wakeup(u64 *written_at, u64 *wakeup)
+{
+	*written_at = 0;
+	*wakeup = 0;
+}
+
 #endif /* CONFIG_QCOM_RPMH */
 
 #endif /* __SOC_QCOM_RPMH_H__ */
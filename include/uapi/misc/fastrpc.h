@@ -17,6 +17,8 @@
 #define FASTRPC_IOCTL_MEM_MAP		_IOWR('R', 10, struct fastrpc_mem_map)
 #define FASTRPC_IOCTL_MEM_UNMAP		_IOWR('R', 11, struct fastrpc_mem_unmap)
 #define FASTRPC_IOCTL_GET_DSP_INFO	_IOWR('R', 13, struct fastrpc_ioctl_capability)
+#define FASTRPC_IOCTL_INVOKE_ASYNC	_IOWR('R', 14, struct fastrpc_invoke_async)
+#define FASTRPC_IOCTL_ASYNC_RESPONSE	_IOWR('R', 15, struct fastrpc_async_response)
 
 /**
  * enum fastrpc_map_flags - control flags for mapping memory on DSP user process
@@ -80,6 +82,19 @@ struct fastrpc_invoke {
 	__u64 args;
 };
 
+struct fastrpc_invoke_async {
+	__u32 handle;
+	__u32 sc;
+	__u64 args;
+	__u64 job_id;	/* cookie returned with the response */
+};
+
+struct fastrpc_async_response {
+	__u64 job_id;	/* [out] cookie of the completed invoke */
+	__s32 result;	/* [out] invoke result */
+	__u32 reserved[3];
+};
+
 struct fastrpc_init_create {
 	__u32 filelen;	/* elf file length */
 	__s32 filefd;	/* fd for the file */
@@ -31,6 +31,7 @@
 
 struct scsi_device;
 struct ufs_hba;
+struct ufs_debugfs_perf;
 
 enum dev_cmd_type {
 	DEV_CMD_TYPE_NOP		= 0x0,
@@ -432,6 +433,9 @@ struct ufs_clk_gating {
  * @tot_busy_t: Total busy time in current polling window
  * @window_start_t: Start time (in jiffies) of the current polling window
  * @busy_start_t: Start time of current busy period
+ * @tot_bytes: Total bytes transferred by SCSI commands in current polling
+ *	window
+ * @window_kbps: Throughput over the last complete polling window, in KB/s
  * @enable_attr: sysfs attribute to enable/disable clock scaling
  * @saved_pwr_info: UFS power mode may also be changed during scaling and this
  * one keeps track of previous power mode.
@@ -453,6 +457,8 @@ struct ufs_clk_scaling {
 	unsigned long tot_busy_t;
 	ktime_t window_start_t;
 	ktime_t busy_start_t;
+	u64 tot_bytes;
+	u32 window_kbps;
 	struct device_attribute enable_attr;
 	struct ufs_pa_layer_attr saved_pwr_info;
 	struct workqueue_struct *workq;
@@ -789,6 +795,55 @@ struct ufs_hba_monitor {
 	bool enabled;
 };
 
+/**
+ * struct ufs_wb_policy - idle window WriteBooster buffer flush policy
+ * @work: samples the WB buffer and toggles flushing around write bursts
+ * @last_write: jiffies at which the most recent write command was issued
+ * @idle_ms: write-free time after which a burst is over and flushing may start
+ * @avail_buf: last sampled dAvailableWriteBoosterBufferSize
+ * @lifetime: last sampled bWriteBoosterBufferLifeTimeEst
+ * @nr_bursts: number of write bursts seen
+ * @nr_flush_start: number of flushes started in an idle window
+ * @nr_flush_stop: number of flushes stopped by a new burst or a drained buffer
+ * @in_burst: writes have been issued since the last idle window
+ * @enabled: the policy owns fWriteBoosterBufferFlushEn
+ */
+struct ufs_wb_policy {
+	struct delayed_work work;
+	unsigned long last_write;
+	u32 idle_ms;
+	u32 avail_buf;
+	u32 lifetime;
+	unsigned long nr_bursts;
+	unsigned long nr_flush_start;
+	unsigned long nr_flush_stop;
+	bool in_burst;
+	bool enabled;
+};
+
+#define UFS_AHIT_ADAPT_BUCKETS	21
+
+/**
+ * struct ufs_ahit_adapt - auto-hibern8 idle timer tuning from request gaps
+ * @work: re-derives the idle timer from @hist once per period
+ * @last_issue: issue time of the most recent transfer request
+ * @hist: request inter-arrival times, bucket n counts gaps of [2^n, 2^(n+1)) us
+ * @min_us: lower bound for the idle timer
+ * @max_us: upper bound for the idle timer, the timer configured when tuning
+ *	was enabled or written through sysfs since
+ * @armed: @work is pending, cleared once a period saw no requests
+ * @enabled: tuning is active
+ */
+struct ufs_ahit_adapt {
+	struct delayed_work work;
+	ktime_t last_issue;
+	atomic_t hist[UFS_AHIT_ADAPT_BUCKETS];
+	u32 min_us;
+	u32 max_us;
+	bool armed;
+	bool enabled;
+};
+
 /**
  * struct ufshcd_res_info_t - MCQ related resource regions
  *
@@ -853,6 +908,7 @@ enum ufshcd_mcq_opr {
  * @spm_lvl: desired UFS power management level during system PM.
  * @pm_op_in_progress: whether or not a PM operation is in progress.
  * @ahit: value of Auto-Hibernate Idle Timer register.
+ * @ahit_adapt: state of the adaptive Auto-Hibernate Idle Timer
  * @lrb: local reference block
  * @outstanding_tasks: Bits representing outstanding task requests
  * @outstanding_lock: Protects @outstanding_reqs.
@@ -933,6 +989,7 @@ enum ufshcd_mcq_opr {
  *	management) after the UFS device has finished a WriteBooster buffer
  *	flush or auto BKOP.
  * @monitor: statistics about UFS commands
+ * @wb_policy: state of the idle window WriteBooster flush policy
  * @crypto_capabilities: Content of crypto capabilities register (0x100)
  * @crypto_cap_array: Array of crypto capabilities
  * @crypto_cfg_register: Start of the crypto cfg array
@@ -941,6 +998,8 @@ enum ufshcd_mcq_opr {
  * @debugfs_ee_work: used to restore ee_ctrl_mask after a delay
  * @debugfs_ee_rate_limit_ms: user configurable delay after which to restore
  *	ee_ctrl_mask
+ * @debugfs_perf: per-opcode latency, queue depth and hibern8 statistics
+ *	exposed through debugfs
  * @luns_avail: number of regular and well known LUNs supported by the UFS
  *	device
  * @nr_hw_queues: number of hardware queues configured
@@ -990,6 +1049,7 @@ struct ufs_hba {
 
 	/* Auto-Hibernate Idle Timer register value */
 	u32 ahit;
+	struct ufs_ahit_adapt ahit_adapt;
 
 	struct ufshcd_lrb *lrb;
 
@@ -1094,6 +1154,7 @@ struct ufs_hba {
 	struct delayed_work rpm_dev_flush_recheck_work;
 
 	struct ufs_hba_monitor	monitor;
+	struct ufs_wb_policy	wb_policy;
 
 #ifdef CONFIG_SCSI_UFS_CRYPTO
 	union ufs_crypto_capabilities crypto_capabilities;
@@ -1105,6 +1166,7 @@ struct ufs_hba {
 	struct dentry *debugfs_root;
 	struct delayed_work debugfs_ee_work;
 	u32 debugfs_ee_rate_limit_ms;
+	struct ufs_debugfs_perf *debugfs_perf;
 #endif
 #ifdef CONFIG_SCSI_UFS_FAULT_INJECTION
 	struct fault_attr trigger_eh_attr;
@@ -1430,6 +1492,7 @@ static inline int ufshcd_disable_host_tx_lcc(struct ufs_hba *hba)
 }
 
 void ufshcd_auto_hibern8_update(struct ufs_hba *hba, u32 ahit);
+int ufshcd_auto_hibern8_adapt_enable(struct ufs_hba *hba, bool enable);
 void ufshcd_fixup_dev_quirks(struct ufs_hba *hba,
 			     const struct ufs_dev_quirk *fixups);
 #define SD_ASCII_STD true
@@ -1452,6 +1515,7 @@ int ufshcd_advanced_rpmb_req_handler(struct ufs_hba *hba, struct utp_upiu_req *r
 				     struct scatterlist *sg_list, enum dma_data_direction dir);
 int ufshcd_wb_toggle(struct ufs_hba *hba, bool enable);
 int ufshcd_wb_toggle_buf_flush(struct ufs_hba *hba, bool enable);
+int ufshcd_wb_policy_enable(struct ufs_hba *hba, bool enable);
 int ufshcd_suspend_prepare(struct device *dev);
 int __ufshcd_suspend_prepare(struct device *dev, bool rpm_ok_for_spm);
 void ufshcd_resume_complete(struct device *dev);
@@ -66,6 +66,7 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *file)
 	unsigned int sq_entries, cq_entries;
 	int sq_pid = -1, sq_cpu = -1;
 	u64 sq_total_time = 0, sq_work_time = 0;
+	unsigned int sq_idle = 0;
 	bool has_lock;
 	unsigned int i;
 
@@ -158,6 +159,9 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *file)
 			sq_total_time = (sq_usage.ru_stime.tv_sec * 1000000
 					 + sq_usage.ru_stime.tv_usec);
 			sq_work_time = sq->work_time;
+			sq_idle = jiffies_to_msecs(sysctl_io_uring_sqpoll_adaptive_idle ?
+						   sq->sq_idle_cur :
+						   sq->sq_thread_idle);
 		}
 	}
 
@@ -165,6 +169,7 @@ __cold void io_uring_show_fdinfo(struct seq_file *m, struct file *file)
 	seq_printf(m, "SqThreadCpu:\t%d\n", sq_cpu);
 	seq_printf(m, "SqTotalTime:\t%llu\n", sq_total_time);
 	seq_printf(m, "SqWorkTime:\t%llu\n", sq_work_time);
+	seq_printf(m, "SqIdleTime:\t%u\n", sq_idle);
 	seq_printf(m, "UserFiles:\t%u\n", ctx->nr_user_files);
 	for (i = 0; has_lock && i < ctx->nr_user_files; i++) {
 		struct file *f = io_file_from_index(&ctx->file_table, i);
@@ -16,6 +16,7 @@
 #include <linux/task_work.h>
 #include <linux/audit.h>
 #include <linux/mmu_context.h>
+#include <linux/sched/topology.h>
 #include <uapi/linux/io_uring.h>
 
 #include "io-wq.h"
@@ -126,6 +127,8 @@ struct io_wq {
 
 static enum cpuhp_state io_wq_online;
 
+int __read_mostly sysctl_io_uring_iowq_capacity_aware;
+
 struct io_cb_cancel_data {
 	work_cancel_fn *fn;
 	void *data;
@@ -727,12 +730,48 @@ void io_wq_worker_sleeping(struct task_struct *tsk)
 	io_wq_dec_running(worker);
 }
 
+/*
+ * Unbound work is mostly waiting on sockets, pipes and the like, which gains
+ * nothing from a big core. If capacity aware placement is enabled, keep those
+ * workers on the lowest capacity CPUs of the wq mask, and leave bound workers
+ * doing regular file I/O to the scheduler.
+ */
+static void io_wq_worker_set_affinity(struct io_wq *wq,
+				      struct io_worker *worker,
+				      struct task_struct *tsk)
+{
+	unsigned long cap, min_cap = ULONG_MAX;
+	cpumask_var_t mask;
+	int cpu;
+
+	if (!READ_ONCE(sysctl_io_uring_iowq_capacity_aware) ||
+	    test_bit(IO_WORKER_F_BOUND, &worker->flags) ||
+	    !alloc_cpumask_var(&mask, GFP_KERNEL)) {
+		set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+		return;
+	}
+
+	cpumask_clear(mask);
+	for_each_cpu_and(cpu, wq->cpu_mask, cpu_online_mask) {
+		cap = arch_scale_cpu_capacity(cpu);
+		if (cap < min_cap) {
+			min_cap = cap;
+			cpumask_clear(mask);
+		}
+		if (cap == min_cap)
+			cpumask_set_cpu(cpu, mask);
+	}
+
+	set_cpus_allowed_ptr(tsk, cpumask_empty(mask) ? wq->cpu_mask : mask);
+	free_cpumask_var(mask);
+}
+
 static void io_init_new_worker(struct io_wq *wq, struct io_worker *worker,
 			       struct task_struct *tsk)
 {
 	tsk->worker_private = worker;
 	worker->task = tsk;
-	set_cpus_allowed_ptr(tsk, wq->cpu_mask);
+	io_wq_worker_set_affinity(wq, worker, tsk);
 
 	raw_spin_lock(&wq->lock);
 	hlist_nulls_add_head_rcu(&worker->nulls_node, &wq->free_list);
@@ -6,6 +6,8 @@
 
 struct io_wq;
 
+extern int sysctl_io_uring_iowq_capacity_aware;
+
 enum {
 	IO_WQ_WORK_CANCEL	= 1,
 	IO_WQ_WORK_HASHED	= 2,
@@ -173,6 +173,24 @@ static struct ctl_table kernel_io_uring_disabled_table[] = {
 		.mode		= 0644,
 		.proc_handler	= proc_dointvec,
 	},
+	{
+		.procname	= "io_uring_sqpoll_adaptive_idle",
+		.data		= &sysctl_io_uring_sqpoll_adaptive_idle,
+		.maxlen		= sizeof(sysctl_io_uring_sqpoll_adaptive_idle),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
+	{
+		.procname	= "io_uring_iowq_capacity_aware",
+		.data		= &sysctl_io_uring_iowq_capacity_aware,
+		.maxlen		= sizeof(sysctl_io_uring_iowq_capacity_aware),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= SYSCTL_ONE,
+	},
 };
 #endif
 
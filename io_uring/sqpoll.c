@@ -20,12 +20,15 @@
 
 #define IORING_SQPOLL_CAP_ENTRIES_VALUE 8
 #define IORING_TW_CAP_ENTRIES_VALUE	8
+#define IO_SQ_GAP_SHIFT			3
 
 enum {
 	IO_SQ_THREAD_SHOULD_STOP = 0,
 	IO_SQ_THREAD_SHOULD_PARK,
 };
 
+int __read_mostly sysctl_io_uring_sqpoll_adaptive_idle;
+
 void io_sq_thread_unpark(struct io_sq_data *sqd)
 	__releases(&sqd->lock)
 {
@@ -84,6 +87,45 @@ static __cold void io_sqd_update_thread_idle(struct io_sq_data *sqd)
 	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
 		sq_thread_idle = max(sq_thread_idle, ctx->sq_thread_idle);
 	sqd->sq_thread_idle = sq_thread_idle;
+	sqd->sq_idle_cur = sq_thread_idle;
+	sqd->sq_gap_avg = (sq_thread_idle / 2) << IO_SQ_GAP_SHIFT;
+}
+
+/*
+ * How long to keep spinning after the last submission. With adaptive idle
+ * enabled this tracks twice the average gap between submissions, whether
+ * they found us still spinning or already asleep, capped at the ring's
+ * sq_thread_idle.
+ */
+static unsigned io_sq_thread_idle(struct io_sq_data *sqd)
+{
+	if (!READ_ONCE(sysctl_io_uring_sqpoll_adaptive_idle))
+		return sqd->sq_thread_idle;
+	return sqd->sq_idle_cur;
+}
+
+static void io_sq_idle_note_work(struct io_sq_data *sqd, bool was_idle)
+{
+	unsigned long gap = jiffies - sqd->sq_last_work;
+
+	sqd->sq_last_work = jiffies;
+
+	/* back-to-back work says nothing about the idle window */
+	if (!was_idle || !gap)
+		return;
+
+	/*
+	 * A gap within sq_thread_idle that found us asleep means the window
+	 * was too short, and pulls it back up. A longer one could never have
+	 * been caught by spinning, and counts as none.
+	 */
+	if (gap > sqd->sq_thread_idle)
+		gap = 0;
+
+	/* EWMA with a weight of 1/4, kept in 1/8ths of a jiffy */
+	sqd->sq_gap_avg += (gap << (IO_SQ_GAP_SHIFT - 2)) - (sqd->sq_gap_avg >> 2);
+	sqd->sq_idle_cur = clamp(2 * sqd->sq_gap_avg >> IO_SQ_GAP_SHIFT,
+				 1U, max(sqd->sq_thread_idle, 1U));
 }
 
 void io_sq_thread_finish(struct io_ring_ctx *ctx)
@@ -274,6 +316,7 @@ static int io_sq_thread(void *data)
 	struct rusage start;
 	unsigned long timeout = 0;
 	char buf[TASK_COMM_LEN];
+	bool idle_spin = false;
 	DEFINE_WAIT(wait);
 
 	/* offload context creation failed, just exit */
@@ -304,11 +347,12 @@ static int io_sq_thread(void *data)
 	mutex_lock(&sqd->lock);
 	while (1) {
 		bool cap_entries, sqt_spin = false;
+		bool was_idle = idle_spin;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + io_sq_thread_idle(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
@@ -322,10 +366,12 @@ static int io_sq_thread(void *data)
 		if (io_sq_tw(&retry_list, IORING_TW_CAP_ENTRIES_VALUE))
 			sqt_spin = true;
 
+		idle_spin = !sqt_spin;
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			if (sqt_spin) {
 				io_sq_update_worktime(sqd, &start);
-				timeout = jiffies + sqd->sq_thread_idle;
+				io_sq_idle_note_work(sqd, was_idle);
+				timeout = jiffies + io_sq_thread_idle(sqd);
 			}
 			if (unlikely(need_resched())) {
 				mutex_unlock(&sqd->lock);
@@ -373,7 +419,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + io_sq_thread_idle(sqd);
 	}
 
 	if (retry_list)
@@ -12,6 +12,10 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* adaptive idle state, in jiffies, sq_gap_avg << IO_SQ_GAP_SHIFT */
+	unsigned		sq_idle_cur;
+	unsigned		sq_gap_avg;
+	unsigned long		sq_last_work;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
@@ -21,6 +25,8 @@ struct io_sq_data {
 	struct completion	exited;
 };
 
+extern int sysctl_io_uring_sqpoll_adaptive_idle;
+
 int io_sq_offload_create(struct io_ring_ctx *ctx, struct io_uring_params *p);
 void io_sq_thread_finish(struct io_ring_ctx *ctx);
 void io_sq_thread_stop(struct io_sq_data *sqd);
@@ -0,0 +1,190 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Rate driven interrupt placement for asymmetric CPU capacity systems.
+ *
+ * Periodically samples the rate of every balanceable interrupt. An
+ * interrupt whose rate reaches rate_high is moved to the highest capacity
+ * CPUs, and moved back to the default affinity once its rate drops below
+ * half of that. Interrupts with managed affinity, or whose affinity was set
+ * by somebody else, are left alone. Setting rate_high back to 0 returns the
+ * interrupts that were moved to the default affinity.
+ */
+#include <linux/irq.h>
+#include <linux/interrupt.h>
+#include <linux/math64.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/topology.h>
+#include <linux/workqueue.h>
+
+#include "internals.h"
+
+#ifdef MODULE_PARAM_PREFIX
+#undef MODULE_PARAM_PREFIX
+#endif
+#define MODULE_PARAM_PREFIX "irq_capacity."
+
+static unsigned int interval_ms = 1000;
+module_param(interval_ms, uint, 0644);
+MODULE_PARM_DESC(interval_ms, "Interrupt rate sampling interval in milliseconds");
+
+static unsigned int rate_high;
+/* Set while sampling; the first pass after (re)enabling takes the baseline */
+static bool irq_capacity_active;
+
+static void irq_capacity_work_fn(struct work_struct *work);
+static DECLARE_DELAYED_WORK(irq_capacity_work, irq_capacity_work_fn);
+
+static bool irq_capacity_big_mask(struct cpumask *mask)
+{
+	unsigned long cap, max_cap = 0, min_cap = ULONG_MAX;
+	int cpu;
+
+	cpumask_clear(mask);
+	for_each_online_cpu(cpu) {
+		cap = arch_scale_cpu_capacity(cpu);
+		min_cap = min(min_cap, cap);
+		if (cap > max_cap) {
+			max_cap = cap;
+			cpumask_clear(mask);
+		}
+		if (cap == max_cap)
+			cpumask_set_cpu(cpu, mask);
+	}
+
+	/* Nothing to do on symmetric systems */
+	return max_cap != min_cap;
+}
+
+static void irq_capacity_update(struct irq_desc *desc, unsigned int interval,
+				unsigned int high, const struct cpumask *big,
+				bool baseline)
+{
+	struct irq_data *data = irq_desc_get_irq_data(desc);
+	unsigned int count;
+
+	guard(raw_spinlock_irqsave)(&desc->lock);
+
+	count = kstat_irqs_desc(desc, cpu_possible_mask);
+	if (baseline) {
+		desc->cap_rate = 0;
+		desc->cap_last_count = count;
+		return;
+	}
+	desc->cap_rate = div_u64((u64)(count - desc->cap_last_count) *
+				 MSEC_PER_SEC, interval);
+	desc->cap_last_count = count;
+
+	if (!desc->action || !irqd_can_balance(data) ||
+	    irqd_affinity_is_managed(data))
+		return;
+
+	if (desc->cap_moved) {
+		/* Somebody else changed the affinity, leave it to them */
+		if (!cpumask_equal(irq_data_get_affinity_mask(data), big)) {
+			desc->cap_moved = false;
+			return;
+		}
+		if (desc->cap_rate >= high / 2)
+			return;
+		if (!irq_set_affinity_locked(data, irq_default_affinity, false)) {
+			irqd_clear(data, IRQD_AFFINITY_SET);
+			desc->cap_moved = false;
+		}
+		return;
+	}
+
+	if (desc->cap_rate < high || irqd_affinity_was_set(data))
+		return;
+	if (cpumask_subset(irq_data_get_effective_affinity_mask(data), big))
+		return;
+	if (!irq_set_affinity_locked(data, big, false))
+		desc->cap_moved = true;
+}
+
+static void irq_capacity_restore(struct irq_desc *desc,
+				 const struct cpumask *big)
+{
+	struct irq_data *data = irq_desc_get_irq_data(desc);
+
+	guard(raw_spinlock_irqsave)(&desc->lock);
+
+	if (!desc->cap_moved)
+		return;
+	desc->cap_moved = false;
+
+	/* Somebody else changed the affinity, leave it to them */
+	if (!cpumask_equal(irq_data_get_affinity_mask(data), big))
+		return;
+	if (!irq_set_affinity_locked(data, irq_default_affinity, false))
+		irqd_clear(data, IRQD_AFFINITY_SET);
+}
+
+static void irq_capacity_work_fn(struct work_struct *work)
+{
+	unsigned int interval = max(READ_ONCE(interval_ms), 10U);
+	unsigned int high = READ_ONCE(rate_high);
+	cpumask_var_t big;
+	bool asym;
+	int irq;
+
+	/* Stopped, and the interrupts we moved are back where they were */
+	if (!high && !irq_capacity_active)
+		return;
+
+	if (!zalloc_cpumask_var(&big, GFP_KERNEL))
+		goto out;
+
+	cpus_read_lock();
+	asym = irq_capacity_big_mask(big);
+	if (asym || !high) {
+		irq_lock_sparse();
+		for_each_active_irq(irq) {
+			struct irq_desc *desc = irq_to_desc(irq);
+
+			if (!desc)
+				continue;
+			if (high)
+				irq_capacity_update(desc, interval, high, big,
+						    !irq_capacity_active);
+			else
+				irq_capacity_restore(desc, big);
+		}
+		irq_unlock_sparse();
+	}
+	cpus_read_unlock();
+
+	free_cpumask_var(big);
+	irq_capacity_active = high;
+	if (!high)
+		return;
+out:
+	queue_delayed_work(system_unbound_wq, &irq_capacity_work,
+			   msecs_to_jiffies(interval));
+}
+
+static int rate_high_set(const char *val, const struct kernel_param *kp)
+{
+	int ret = param_set_uint(val, kp);
+
+	/* Also run right away when disabled, to restore the moved interrupts */
+	if (!ret && system_unbound_wq)
+		mod_delayed_work(system_unbound_wq, &irq_capacity_work, 0);
+	return ret;
+}
+
+static const struct kernel_param_ops rate_high_ops = {
+	.set = rate_high_set,
+	.get = param_get_uint,
+};
+
+module_param_cb(rate_high, &rate_high_ops, &rate_high, 0644);
+MODULE_PARM_DESC(rate_high,
+		 "Move interrupts above this rate per second to the biggest CPUs (0 = disabled)");
+
+static int __init irq_capacity_init(void)
+{
+	if (rate_high)
+		queue_delayed_work(system_unbound_wq, &irq_capacity_work, 0);
+	return 0;
+}
+late_initcall(irq_capacity_init);
@@ -345,6 +345,17 @@ static ssize_t actions_show(struct kobject *kobj,
 }
 IRQ_ATTR_RO(actions);
 
+#ifdef CONFIG_IRQ_CAPACITY_BALANCE
+static ssize_t rate_show(struct kobject *kobj,
+			 struct kobj_attribute *attr, char *buf)
+{
+	struct irq_desc *desc = container_of(kobj, struct irq_desc, kobj);
+
+	return sysfs_emit(buf, "%u\n", READ_ONCE(desc->cap_rate));
+}
+IRQ_ATTR_RO(rate);
+#endif
+
 static struct attribute *irq_attrs[] = {
 	&per_cpu_count_attr.attr,
 	&chip_name_attr.attr,
@@ -353,6 +364,9 @@ static struct attribute *irq_attrs[] = {
 	&wakeup_attr.attr,
 	&name_attr.attr,
 	&actions_attr.attr,
+#ifdef CONFIG_IRQ_CAPACITY_BALANCE
+	&rate_attr.attr,
+#endif
 	NULL
 };
 ATTRIBUTE_GROUPS(irq);
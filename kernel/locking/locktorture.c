@@ -28,6 +28,8 @@
 #include <linux/delay.h>
 #include <linux/slab.h>
 #include <linux/torture.h>
+#include <linux/log2.h>
+#include <linux/sched/clock.h>
 #include <linux/reboot.h>
 
 MODULE_DESCRIPTION("torture test facility for locking");
@@ -36,6 +38,7 @@ MODULE_AUTHOR("Paul E. McKenney <paulmck@linux.ibm.com>");
 
 torture_param(int, acq_writer_lim, 0, "Write_acquisition time limit (jiffies).");
 torture_param(int, call_rcu_chains, 0, "Self-propagate call_rcu() chains during test (0=disable).");
+torture_param(int, lat_hist, 0, "Record per-CPU acquisition and hold time histograms (0=disable).");
 torture_param(int, long_hold, 100, "Do occasional long hold of lock (ms), 0=disable");
 torture_param(int, nested_locks, 0, "Number of nested locks (max = 8)");
 torture_param(int, nreaders_stress, -1, "Number of read-locking stress-test threads");
@@ -121,6 +124,35 @@ struct lock_stress_stats {
 	long n_lock_acquired;
 };
 
+/*
+ * Latency histograms, bucket i counts durations of [2^i, 2^(i+1)) ns with
+ * the last bucket catching everything longer.
+ */
+#define LOCK_LAT_BUCKETS 32
+
+struct lock_lat_hist {
+	unsigned long acq[LOCK_LAT_BUCKETS];
+	unsigned long hold[LOCK_LAT_BUCKETS];
+};
+
+static DEFINE_PER_CPU(struct lock_lat_hist, lock_lat_write);
+static DEFINE_PER_CPU(struct lock_lat_hist, lock_lat_read);
+
+static int lock_lat_bucket(u64 ns)
+{
+	return min_t(int, ilog2(ns | 1), LOCK_LAT_BUCKETS - 1);
+}
+
+static void lock_lat_record(struct lock_lat_hist __percpu *hist,
+			    u64 t_start, u64 t_acq, u64 t_rel)
+{
+	struct lock_lat_hist *h = raw_cpu_ptr(hist);
+
+	/* Migration between sample and update only misattributes one count. */
+	data_race(h->acq[lock_lat_bucket(t_acq - t_start)]++);
+	data_race(h->hold[lock_lat_bucket(t_rel - t_acq)]++);
+}
+
 struct call_rcu_chain {
 	struct rcu_head crc_rh;
 	bool crc_stop;
@@ -844,6 +876,7 @@ static int lock_torture_writer(void *arg)
 {
 	unsigned long j;
 	unsigned long j1;
+	u64 t_start = 0, t_acq = 0;
 	u32 lockset_mask;
 	struct lock_stress_stats *lwsp = arg;
 	DEFINE_TORTURE_RANDOM(rand);
@@ -877,7 +910,11 @@ static int lock_torture_writer(void *arg)
 		if (!skip_main_lock) {
 			if (acq_writer_lim > 0)
 				j = jiffies;
+			if (lat_hist)
+				t_start = local_clock();
 			cxt.cur_ops->writelock(tid);
+			if (lat_hist)
+				t_acq = local_clock();
 			if (WARN_ON_ONCE(lock_is_write_held))
 				lwsp->n_lock_fail++;
 			lock_is_write_held = true;
@@ -895,6 +932,9 @@ static int lock_torture_writer(void *arg)
 
 			lock_is_write_held = false;
 			WRITE_ONCE(last_lock_release, jiffies);
+			if (lat_hist)
+				lock_lat_record(&lock_lat_write, t_start, t_acq,
+						local_clock());
 			cxt.cur_ops->writeunlock(tid);
 		}
 		if (cxt.cur_ops->nested_unlock)
@@ -917,6 +957,7 @@ static int lock_torture_reader(void *arg)
 	struct lock_stress_stats *lrsp = arg;
 	int tid = lrsp - cxt.lrsa;
 	DEFINE_TORTURE_RANDOM(rand);
+	u64 t_start = 0, t_acq = 0;
 
 	VERBOSE_TOROUT_STRING("lock_torture_reader task started");
 	set_user_nice(current, MAX_NICE);
@@ -925,7 +966,11 @@ static int lock_torture_reader(void *arg)
 		if ((torture_random(&rand) & 0xfffff) == 0)
 			schedule_timeout_uninterruptible(1);
 
+		if (lat_hist)
+			t_start = local_clock();
 		cxt.cur_ops->readlock(tid);
+		if (lat_hist)
+			t_acq = local_clock();
 		atomic_inc(&lock_is_read_held);
 		if (WARN_ON_ONCE(lock_is_write_held))
 			lrsp->n_lock_fail++; /* rare, but... */
@@ -933,6 +978,9 @@ static int lock_torture_reader(void *arg)
 		lrsp->n_lock_acquired++;
 		cxt.cur_ops->read_delay(&rand);
 		atomic_dec(&lock_is_read_held);
+		if (lat_hist)
+			lock_lat_record(&lock_lat_read, t_start, t_acq,
+					local_clock());
 		cxt.cur_ops->readunlock(tid);
 
 		stutter_wait("lock_torture_reader");
@@ -974,6 +1022,41 @@ static void __torture_print_stats(char *page,
 		atomic_inc(&cxt.n_lock_torture_errors);
 }
 
+/*
+ * Print one line per CPU with a non-empty histogram, in a fixed
+ * "<torture_type>-lat <kind> cpu <n> acq <buckets> hold <buckets>" format
+ * meant for scripts rather than humans.
+ */
+static void lock_torture_print_lat(struct lock_lat_hist __percpu *hist,
+				   const char *kind)
+{
+	struct lock_lat_hist *h;
+	unsigned long n;
+	int cpu, i, len;
+	char *buf;
+
+	buf = kmalloc(2 * LOCK_LAT_BUCKETS * 21 + 128, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for_each_possible_cpu(cpu) {
+		h = per_cpu_ptr(hist, cpu);
+		for (n = 0, i = 0; i < LOCK_LAT_BUCKETS; i++)
+			n += data_race(h->acq[i]);
+		if (!n)
+			continue;
+
+		len = sprintf(buf, "%s-lat %s cpu %d acq", torture_type, kind, cpu);
+		for (i = 0; i < LOCK_LAT_BUCKETS; i++)
+			len += sprintf(buf + len, " %lu", data_race(h->acq[i]));
+		len += sprintf(buf + len, " hold");
+		for (i = 0; i < LOCK_LAT_BUCKETS; i++)
+			len += sprintf(buf + len, " %lu", data_race(h->hold[i]));
+		pr_alert("%s\n", buf);
+	}
+	kfree(buf);
+}
+
 /*
  * Print torture statistics.  Caller must ensure that there is only one
  * call to this function at a given time!!!  This is normally accomplished
@@ -1013,6 +1096,12 @@ static void lock_torture_stats_print(void)
 		pr_alert("%s", buf);
 		kfree(buf);
 	}
+
+	if (lat_hist) {
+		lock_torture_print_lat(&lock_lat_write, "write");
+		if (cxt.cur_ops->readlock)
+			lock_torture_print_lat(&lock_lat_read, "read");
+	}
 }
 
 /*
@@ -1045,10 +1134,10 @@ lock_torture_print_module_parms(struct lock_torture_ops *cur_ops,
 
 	cpumask_setall(&cpumask_all);
 	pr_alert("%s" TORTURE_FLAG
-		 "--- %s%s: acq_writer_lim=%d bind_readers=%*pbl bind_writers=%*pbl call_rcu_chains=%d long_hold=%d nested_locks=%d nreaders_stress=%d nwriters_stress=%d onoff_holdoff=%d onoff_interval=%d rt_boost=%d rt_boost_factor=%d shuffle_interval=%d shutdown_secs=%d stat_interval=%d stutter=%d verbose=%d writer_fifo=%d\n",
+		 "--- %s%s: acq_writer_lim=%d bind_readers=%*pbl bind_writers=%*pbl call_rcu_chains=%d lat_hist=%d long_hold=%d nested_locks=%d nreaders_stress=%d nwriters_stress=%d onoff_holdoff=%d onoff_interval=%d rt_boost=%d rt_boost_factor=%d shuffle_interval=%d shutdown_secs=%d stat_interval=%d stutter=%d verbose=%d writer_fifo=%d\n",
 		 torture_type, tag, cxt.debug_lock ? " [debug]": "",
 		 acq_writer_lim, cpumask_pr_args(rcmp), cpumask_pr_args(wcmp),
-		 call_rcu_chains, long_hold, nested_locks, cxt.nrealreaders_stress,
+		 call_rcu_chains, lat_hist, long_hold, nested_locks, cxt.nrealreaders_stress,
 		 cxt.nrealwriters_stress, onoff_holdoff, onoff_interval, rt_boost,
 		 rt_boost_factor, shuffle_interval, shutdown_secs, stat_interval, stutter,
 		 verbose, writer_fifo);
@@ -1230,6 +1319,11 @@ static int __init lock_torture_init(void)
 #endif
 
 	/* Initialize the statistics so that each run gets its own numbers. */
+	for_each_possible_cpu(i) {
+		memset(per_cpu_ptr(&lock_lat_write, i), 0, sizeof(struct lock_lat_hist));
+		memset(per_cpu_ptr(&lock_lat_read, i), 0, sizeof(struct lock_lat_hist));
+	}
+
 	if (nwriters_stress) {
 		lock_is_write_held = false;
 		cxt.lwsa = kmalloc_array(cxt.nrealwriters_stress,
@@ -406,7 +406,7 @@ static inline int mutex_can_spin_on_owner(struct mutex *lock)
 	 */
 	owner = __mutex_owner(lock);
 	if (owner)
-		retval = owner_on_cpu(owner);
+		retval = owner_on_cpu(owner) && osq_owner_capacity_ok(owner);
 
 	/*
 	 * If lock->owner is not set, the mutex has been released. Return true
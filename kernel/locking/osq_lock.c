@@ -1,6 +1,8 @@
 // SPDX-License-Identifier: GPL-2.0
+#include <linux/moduleparam.h>
 #include <linux/percpu.h>
 #include <linux/sched.h>
+#include <linux/sched/topology.h>
 #include <linux/osq_lock.h>
 
 /*
@@ -20,6 +22,28 @@ struct optimistic_spin_node {
 
 static DEFINE_PER_CPU_SHARED_ALIGNED(struct optimistic_spin_node, osq_node);
 
+static unsigned int spin_capacity_margin;
+module_param(spin_capacity_margin, uint, 0644);
+MODULE_PARM_DESC(spin_capacity_margin,
+		 "Only start spinning if the waiter CPU has at least this percentage of the owner CPU capacity (0 = always)");
+
+/*
+ * On asymmetric systems a waiter on a much smaller CPU than the owner's
+ * ties up that CPU for the length of a critical section it cannot speed up,
+ * and usually still loses the handoff race to waiters on bigger CPUs.
+ * Let the sleeping lock slow paths opt out of spinning in that case.
+ */
+bool osq_owner_capacity_ok(struct task_struct *owner)
+{
+	unsigned int margin = READ_ONCE(spin_capacity_margin);
+
+	if (!margin)
+		return true;
+
+	return arch_scale_cpu_capacity(raw_smp_processor_id()) * 100 >=
+	       arch_scale_cpu_capacity(task_cpu(owner)) * margin;
+}
+
 /*
  * We use the value 0 to represent "no CPU", thus the encoded value
  * will be the CPU number incremented by 1.
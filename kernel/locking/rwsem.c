@@ -722,7 +722,8 @@ static inline bool rwsem_can_spin_on_owner(struct rw_semaphore *sem)
 	 * Don't check the read-owner as the entry may be stale.
 	 */
 	if ((flags & RWSEM_NONSPINNABLE) ||
-	    (owner && !(flags & RWSEM_READER_OWNED) && !owner_on_cpu(owner)))
+	    (owner && !(flags & RWSEM_READER_OWNED) &&
+	     (!owner_on_cpu(owner) || !osq_owner_capacity_ok(owner))))
 		ret = false;
 
 	lockevent_cond_inc(rwsem_opt_fail, !ret);
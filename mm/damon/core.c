@@ -7,9 +7,11 @@
 
 #define pr_fmt(fmt) "damon: " fmt
 
+#include <linux/cgroup.h>
 #include <linux/damon.h>
 #include <linux/delay.h>
 #include <linux/kthread.h>
+#include <linux/memcontrol.h>
 #include <linux/mm.h>
 #include <linux/psi.h>
 #include <linux/slab.h>
@@ -2122,6 +2124,48 @@ int damon_set_region_biggest_system_ram_default(struct damon_target *t,
 	return damon_set_regions(t, &addr_range, 1);
 }
 
+/**
+ * damon_memcg_path_to_id() - Find the id of a memory cgroup by its path.
+ * @memcg_path:	The path of the memory cgroup, relative to the cgroup root.
+ * @id:		The pointer to save the id of the memory cgroup to.
+ *
+ * Return: 0 on success, negative error code otherwise.
+ */
+int damon_memcg_path_to_id(const char *memcg_path, unsigned short *id)
+{
+#ifdef CONFIG_MEMCG
+	struct mem_cgroup *memcg;
+	char *path;
+	int err = -EINVAL;
+
+	if (!memcg_path)
+		return -EINVAL;
+
+	path = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!path)
+		return -ENOMEM;
+
+	for (memcg = mem_cgroup_iter(NULL, NULL, NULL); memcg;
+			memcg = mem_cgroup_iter(NULL, memcg, NULL)) {
+		/* skip removed memcg */
+		if (!mem_cgroup_id(memcg))
+			continue;
+		cgroup_path(memcg->css.cgroup, path, PATH_MAX);
+		if (sysfs_streq(path, memcg_path)) {
+			*id = mem_cgroup_id(memcg);
+			mem_cgroup_iter_break(NULL, memcg);
+			err = 0;
+			break;
+		}
+	}
+
+	kfree(path);
+	return err;
+#else
+	return -EINVAL;
+#endif /* CONFIG_MEMCG */
+}
+
 /*
  * damon_moving_sum() - Calculate an inferred moving sum value.
  * @mvsum:	Inferred sum of the last @len_window values.
@@ -137,6 +137,18 @@ module_param(monitor_region_end, ulong, 0600);
 static bool skip_anon __read_mostly;
 module_param(skip_anon, bool, 0600);
 
+/*
+ * Skip reclamation of a memory cgroup's pages.
+ *
+ * If this parameter is set as the path of a memory cgroup relative to the
+ * cgroup root (e.g., ``/foreground``), DAMON_RECLAIM does not page out pages
+ * charged to that cgroup.  With swap on zram, this keeps latency sensitive
+ * workloads from paying the decompression cost of refaulting memory that was
+ * only cold in the background.  Empty by default.
+ */
+static char *skip_memcg_path __read_mostly;
+module_param(skip_memcg_path, charp, 0600);
+
 /*
  * PID of the DAMON thread
  *
@@ -227,6 +239,18 @@ static int damon_reclaim_apply_parameters(void)
 		damos_add_filter(scheme, filter);
 	}
 
+	if (skip_memcg_path && *skip_memcg_path) {
+		filter = damos_new_filter(DAMOS_FILTER_TYPE_MEMCG, true);
+		if (!filter)
+			goto out;
+		err = damon_memcg_path_to_id(skip_memcg_path, &filter->memcg_id);
+		if (err) {
+			damos_destroy_filter(filter);
+			goto out;
+		}
+		damos_add_filter(scheme, filter);
+	}
+
 	err = damon_set_region_biggest_system_ram_default(param_target,
 					&monitor_region_start,
 					&monitor_region_end);
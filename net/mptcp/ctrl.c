@@ -29,6 +29,10 @@ struct mptcp_pernet {
 	unsigned int add_addr_timeout;
 	unsigned int close_timeout;
 	unsigned int stale_loss_cnt;
+	unsigned int cost_rtt_target_us;
+	unsigned int cost_rate_target_kbps;
+	unsigned int cost_min_bytes;
+	unsigned int cost_radio_tail_ms;
 	u8 mptcp_enabled;
 	u8 checksum_enabled;
 	u8 allow_join_initial_addr_port;
@@ -83,6 +87,26 @@ const char *mptcp_get_scheduler(const struct net *net)
 	return mptcp_get_pernet(net)->scheduler;
 }
 
+unsigned int mptcp_cost_rtt_target_us(const struct net *net)
+{
+	return READ_ONCE(mptcp_get_pernet(net)->cost_rtt_target_us);
+}
+
+unsigned int mptcp_cost_rate_target_kbps(const struct net *net)
+{
+	return READ_ONCE(mptcp_get_pernet(net)->cost_rate_target_kbps);
+}
+
+unsigned int mptcp_cost_min_bytes(const struct net *net)
+{
+	return READ_ONCE(mptcp_get_pernet(net)->cost_min_bytes);
+}
+
+unsigned int mptcp_cost_radio_tail_ms(const struct net *net)
+{
+	return READ_ONCE(mptcp_get_pernet(net)->cost_radio_tail_ms);
+}
+
 static void mptcp_pernet_set_defaults(struct mptcp_pernet *pernet)
 {
 	pernet->mptcp_enabled = 1;
@@ -93,6 +117,10 @@ static void mptcp_pernet_set_defaults(struct mptcp_pernet *pernet)
 	pernet->stale_loss_cnt = 4;
 	pernet->pm_type = MPTCP_PM_TYPE_KERNEL;
 	strscpy(pernet->scheduler, "default", sizeof(pernet->scheduler));
+	pernet->cost_rtt_target_us = 100 * USEC_PER_MSEC;
+	pernet->cost_rate_target_kbps = 2000;
+	pernet->cost_min_bytes = 64 * 1024;
+	pernet->cost_radio_tail_ms = 10 * MSEC_PER_SEC;
 }
 
 #ifdef CONFIG_SYSCTL
@@ -217,6 +245,30 @@ static struct ctl_table mptcp_sysctl_table[] = {
 		.mode = 0644,
 		.proc_handler = proc_dointvec_jiffies,
 	},
+	{
+		.procname = "cost_rtt_target_us",
+		.maxlen = sizeof(unsigned int),
+		.mode = 0644,
+		.proc_handler = proc_douintvec,
+	},
+	{
+		.procname = "cost_rate_target_kbps",
+		.maxlen = sizeof(unsigned int),
+		.mode = 0644,
+		.proc_handler = proc_douintvec,
+	},
+	{
+		.procname = "cost_min_bytes",
+		.maxlen = sizeof(unsigned int),
+		.mode = 0644,
+		.proc_handler = proc_douintvec,
+	},
+	{
+		.procname = "cost_radio_tail_ms",
+		.maxlen = sizeof(unsigned int),
+		.mode = 0644,
+		.proc_handler = proc_douintvec,
+	},
 };
 
 static int mptcp_pernet_new_table(struct net *net, struct mptcp_pernet *pernet)
@@ -240,6 +292,10 @@ static int mptcp_pernet_new_table(struct net *net, struct mptcp_pernet *pernet)
 	table[6].data = &pernet->scheduler;
 	/* table[7] is for available_schedulers which is read-only info */
 	table[8].data = &pernet->close_timeout;
+	table[9].data = &pernet->cost_rtt_target_us;
+	table[10].data = &pernet->cost_rate_target_kbps;
+	table[11].data = &pernet->cost_min_bytes;
+	table[12].data = &pernet->cost_radio_tail_ms;
 
 	hdr = register_net_sysctl_sz(net, MPTCP_SYSCTL_PATH, table,
 				     ARRAY_SIZE(mptcp_sysctl_table));
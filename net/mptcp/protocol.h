@@ -691,6 +691,10 @@ unsigned int mptcp_stale_loss_cnt(const struct net *net);
 unsigned int mptcp_close_timeout(const struct sock *sk);
 int mptcp_get_pm_type(const struct net *net);
 const char *mptcp_get_scheduler(const struct net *net);
+unsigned int mptcp_cost_rtt_target_us(const struct net *net);
+unsigned int mptcp_cost_rate_target_kbps(const struct net *net);
+unsigned int mptcp_cost_min_bytes(const struct net *net);
+unsigned int mptcp_cost_radio_tail_ms(const struct net *net);
 void mptcp_get_available_schedulers(char *buf, size_t maxlen);
 void __mptcp_subflow_fully_established(struct mptcp_sock *msk,
 				       struct mptcp_subflow_context *subflow,
@@ -36,6 +36,114 @@ static struct mptcp_sched_ops mptcp_sched_default = {
 	.owner		= THIS_MODULE,
 };
 
+/* Estimated time to flush the subflow's send queue, as in the default
+ * scheduler; U64_MAX if it has no pacing rate yet.
+ */
+static u64 mptcp_sched_cost_linger(struct sock *ssk)
+{
+	u64 pace = READ_ONCE(ssk->sk_pacing_rate);
+
+	if (!pace)
+		return U64_MAX;
+
+	return div_u64((u64)READ_ONCE(ssk->sk_wmem_queued) << 32, pace);
+}
+
+/* Does the subflow meet the latency and throughput targets on its own? */
+static bool mptcp_sched_cost_good_enough(const struct net *net, struct sock *ssk)
+{
+	unsigned int rtt = mptcp_cost_rtt_target_us(net);
+	unsigned int rate = mptcp_cost_rate_target_kbps(net);
+
+	if (rtt && (tcp_sk(ssk)->srtt_us >> 3) > rtt)
+		return false;
+
+	/* sk_pacing_rate is in bytes per second */
+	if (rate && READ_ONCE(ssk->sk_pacing_rate) < (u64)rate * 125)
+		return false;
+
+	return true;
+}
+
+/* Has the costly subflow sent recently enough for its radio to be up? */
+static bool mptcp_sched_cost_awake(const struct net *net, struct sock *ssk)
+{
+	unsigned int tail = mptcp_cost_radio_tail_ms(net);
+
+	return tail && (u32)(tcp_jiffies32 - READ_ONCE(tcp_sk(ssk)->lsndtime)) <
+		       msecs_to_jiffies(tail);
+}
+
+/* Cost aware scheduler: backup subflows (e.g. LTE) are treated as costly and
+ * only used when no regular one (e.g. Wi-Fi) meets the rtt and rate targets.
+ * Even then, a transfer smaller than cost_min_bytes stays on the regular
+ * subflow unless the costly one has sent within the last cost_radio_tail_ms,
+ * so it does not wake up the modem. A costly subflow is always used if
+ * it is the only one left.
+ */
+static int mptcp_sched_cost_get_subflow(struct mptcp_sock *msk,
+					struct mptcp_sched_data *data)
+{
+	struct sock *ssk, *cheap = NULL, *costly = NULL;
+	u64 linger, cheap_linger = U64_MAX, costly_linger = U64_MAX;
+	const struct net *net = sock_net((struct sock *)msk);
+	struct mptcp_subflow_context *subflow;
+	bool cheap_ok = false, awake = false;
+
+	if (data->reinject)
+		return mptcp_sched_default_get_subflow(msk, data);
+
+	mptcp_for_each_subflow(msk, subflow) {
+		ssk = mptcp_subflow_tcp_sock(subflow);
+		if (!mptcp_subflow_active(subflow))
+			continue;
+
+		if (subflow->backup || subflow->request_bkup) {
+			awake |= mptcp_sched_cost_awake(net, ssk);
+			if (!sk_stream_memory_free(ssk))
+				continue;
+			linger = mptcp_sched_cost_linger(ssk);
+			if (!costly || linger < costly_linger) {
+				costly = ssk;
+				costly_linger = linger;
+			}
+		} else {
+			cheap_ok |= mptcp_sched_cost_good_enough(net, ssk);
+			if (!sk_stream_memory_free(ssk))
+				continue;
+			linger = mptcp_sched_cost_linger(ssk);
+			if (!cheap || linger < cheap_linger) {
+				cheap = ssk;
+				cheap_linger = linger;
+			}
+		}
+	}
+
+	/* While a regular subflow is good enough, wait for it to have space
+	 * rather than spilling over to the costly one.
+	 */
+	ssk = cheap;
+	if (costly && !cheap_ok &&
+	    (awake || !cheap ||
+	     READ_ONCE(msk->write_seq) - msk->snd_nxt >= mptcp_cost_min_bytes(net))) {
+		/* the costly path is worth it, take whichever flushes first */
+		if (!cheap || costly_linger < cheap_linger)
+			ssk = costly;
+	}
+
+	if (!ssk)
+		return -EINVAL;
+
+	mptcp_subflow_set_scheduled(mptcp_subflow_ctx(ssk), true);
+	return 0;
+}
+
+static struct mptcp_sched_ops mptcp_sched_cost = {
+	.get_subflow	= mptcp_sched_cost_get_subflow,
+	.name		= "cost",
+	.owner		= THIS_MODULE,
+};
+
 /* Must be called with rcu read lock held */
 struct mptcp_sched_ops *mptcp_sched_find(const char *name)
 {
@@ -103,6 +211,7 @@ void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
 void mptcp_sched_init(void)
 {
 	mptcp_register_scheduler(&mptcp_sched_default);
+	mptcp_register_scheduler(&mptcp_sched_cost);
 }
 
 int mptcp_init_sched(struct mptcp_sock *msk,
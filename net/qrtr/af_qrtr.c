@@ -101,7 +101,7 @@ static inline struct qrtr_sock *qrtr_sk(struct sock *sk)
 
 static unsigned int qrtr_local_nid = 1;
 
-/* for node ids */
+/* for node ids, lookups are RCU protected, updates take qrtr_nodes_lock */
 static RADIX_TREE(qrtr_nodes, GFP_ATOMIC);
 static DEFINE_SPINLOCK(qrtr_nodes_lock);
 /* broadcast list */
@@ -122,6 +122,7 @@ static DEFINE_XARRAY_ALLOC(qrtr_ports);
  * @qrtr_tx_lock: lock for qrtr_tx_flow inserts
  * @rx_queue: receive queue
  * @item: list item for broadcast list
+ * @rcu: deferred free, for lockless qrtr_node_lookup()
  */
 struct qrtr_node {
 	struct mutex ep_lock;
@@ -134,6 +135,7 @@ struct qrtr_node {
 
 	struct sk_buff_head rx_queue;
 	struct list_head item;
+	struct rcu_head rcu;
 };
 
 /**
@@ -194,7 +196,7 @@ static void __qrtr_node_release(struct kref *kref)
 		radix_tree_iter_delete(&node->qrtr_tx_flow, &iter, slot);
 		kfree(flow);
 	}
-	kfree(node);
+	kfree_rcu(node, rcu);
 }
 
 /* Increment reference to node. */
@@ -393,14 +395,15 @@ static int qrtr_node_enqueue(struct qrtr_node *node, struct sk_buff *skb,
 static struct qrtr_node *qrtr_node_lookup(unsigned int nid)
 {
 	struct qrtr_node *node;
-	unsigned long flags;
 
-	mutex_lock(&qrtr_node_lock);
-	spin_lock_irqsave(&qrtr_nodes_lock, flags);
+	/* A node whose last reference is being dropped may still be found
+	 * here until __qrtr_node_release() removes it; don't revive it.
+	 */
+	rcu_read_lock();
 	node = radix_tree_lookup(&qrtr_nodes, nid);
-	node = qrtr_node_acquire(node);
-	spin_unlock_irqrestore(&qrtr_nodes_lock, flags);
-	mutex_unlock(&qrtr_node_lock);
+	if (node && !kref_get_unless_zero(&node->ref))
+		node = NULL;
+	rcu_read_unlock();
 
 	return node;
 }
@@ -437,9 +440,10 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 	struct qrtr_node *node = ep->node;
 	const struct qrtr_hdr_v1 *v1;
 	const struct qrtr_hdr_v2 *v2;
+	struct qrtr_cb cb_hdr = { };
+	struct qrtr_cb *cb = &cb_hdr;
 	struct qrtr_sock *ipc;
 	struct sk_buff *skb;
-	struct qrtr_cb *cb;
 	size_t size;
 	unsigned int ver;
 	size_t hdrlen;
@@ -447,19 +451,13 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 	if (len == 0 || len & 3)
 		return -EINVAL;
 
-	skb = __netdev_alloc_skb(NULL, len, GFP_ATOMIC | __GFP_NOWARN);
-	if (!skb)
-		return -ENOMEM;
-
-	cb = (struct qrtr_cb *)skb->cb;
-
 	/* Version field in v1 is little endian, so this works for both cases */
 	ver = *(u8*)data;
 
 	switch (ver) {
 	case QRTR_PROTO_VER_1:
 		if (len < sizeof(*v1))
-			goto err;
+			return -EINVAL;
 		v1 = data;
 		hdrlen = sizeof(*v1);
 
@@ -474,7 +472,7 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 		break;
 	case QRTR_PROTO_VER_2:
 		if (len < sizeof(*v2))
-			goto err;
+			return -EINVAL;
 		v2 = data;
 		hdrlen = sizeof(*v2) + v2->optlen;
 
@@ -494,23 +492,31 @@ int qrtr_endpoint_post(struct qrtr_endpoint *ep, const void *data, size_t len)
 		break;
 	default:
 		pr_err("qrtr: Invalid version %d\n", ver);
-		goto err;
+		return -EINVAL;
 	}
 
 	if (cb->dst_port == QRTR_PORT_CTRL_LEGACY)
 		cb->dst_port = QRTR_PORT_CTRL;
 
 	if (!size || len != ALIGN(size, 4) + hdrlen)
-		goto err;
+		return -EINVAL;
 
 	if ((cb->type == QRTR_TYPE_NEW_SERVER ||
 	     cb->type == QRTR_TYPE_RESUME_TX) &&
 	    size < sizeof(struct qrtr_ctrl_pkt))
-		goto err;
+		return -EINVAL;
 
 	if (cb->dst_port != QRTR_PORT_CTRL && cb->type != QRTR_TYPE_DATA &&
 	    cb->type != QRTR_TYPE_RESUME_TX)
-		goto err;
+		return -EINVAL;
+
+	/* The header has been parsed, only the payload needs a buffer */
+	skb = __netdev_alloc_skb(NULL, size, GFP_ATOMIC | __GFP_NOWARN);
+	if (!skb)
+		return -ENOMEM;
+
+	cb = (struct qrtr_cb *)skb->cb;
+	*cb = cb_hdr;
 
 	skb_put_data(skb, data + hdrlen, size);
 
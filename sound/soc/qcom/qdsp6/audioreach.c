@@ -595,6 +595,71 @@ int audioreach_send_cmd_sync(struct device *dev, gpr_device_t *gdev,
 }
 EXPORT_SYMBOL_GPL(audioreach_send_cmd_sync);
 
+/*
+ * Send an APM_CMD_SET_CFG packet built for @graph, or append its module
+ * parameters to the pending batch if one has been started.
+ */
+static int audioreach_graph_set_cfg(struct q6apm_graph *graph, struct gpr_pkt *pkt)
+{
+	struct apm_cmd_header *cmd_header = (void *)pkt + GPR_HDR_SIZE;
+	size_t size = ALIGN(cmd_header->payload_size, 8);
+	void *batch;
+
+	if (!graph->cfg_batching)
+		return q6apm_send_cmd_sync(graph->apm, pkt, 0);
+
+	batch = krealloc(graph->cfg_batch, graph->cfg_batch_size + size, GFP_KERNEL);
+	if (!batch)
+		return -ENOMEM;
+
+	memset(batch + graph->cfg_batch_size, 0, size);
+	memcpy(batch + graph->cfg_batch_size, (void *)cmd_header + APM_CMD_HDR_SIZE,
+	       cmd_header->payload_size);
+
+	graph->cfg_batch = batch;
+	graph->cfg_batch_size += size;
+
+	return 0;
+}
+
+void audioreach_graph_cfg_batch_begin(struct q6apm_graph *graph)
+{
+	graph->cfg_batching = true;
+}
+EXPORT_SYMBOL_GPL(audioreach_graph_cfg_batch_begin);
+
+/* Send all parameters queued since audioreach_graph_cfg_batch_begin() at once */
+int audioreach_graph_cfg_batch_flush(struct q6apm_graph *graph)
+{
+	struct gpr_pkt *pkt;
+	int rc = 0;
+
+	graph->cfg_batching = false;
+
+	if (!graph->cfg_batch_size)
+		return 0;
+
+	pkt = audioreach_alloc_apm_cmd_pkt(graph->cfg_batch_size, APM_CMD_SET_CFG, 0);
+	if (IS_ERR(pkt)) {
+		rc = PTR_ERR(pkt);
+		goto free_batch;
+	}
+
+	memcpy((void *)pkt + GPR_HDR_SIZE + APM_CMD_HDR_SIZE, graph->cfg_batch,
+	       graph->cfg_batch_size);
+
+	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+
+	kfree(pkt);
+free_batch:
+	kfree(graph->cfg_batch);
+	graph->cfg_batch = NULL;
+	graph->cfg_batch_size = 0;
+
+	return rc;
+}
+EXPORT_SYMBOL_GPL(audioreach_graph_cfg_batch_flush);
+
 int audioreach_graph_send_cmd_sync(struct q6apm_graph *graph, struct gpr_pkt *pkt,
 				   uint32_t rsp_opcode)
 {
@@ -663,7 +728,7 @@ static int audioreach_display_port_set_media_format(struct q6apm_graph *graph,
 	intf_cfg->cfg.mst_idx = 0;
 	intf_cfg->cfg.dptx_idx = cfg->dp_idx;
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -741,7 +806,7 @@ static int audioreach_codec_dma_set_media_format(struct q6apm_graph *graph,
 	param_data->param_size = pm_sz - APM_MODULE_PARAM_DATA_SIZE;
 	pm_cfg->power_mode.power_mode = 0;
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -775,7 +840,7 @@ int audioreach_send_u32_param(struct q6apm_graph *graph, struct audioreach_modul
 	param = p;
 	*param = param_val;
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -846,7 +911,7 @@ static int audioreach_mfc_set_media_format(struct q6apm_graph *graph,
 	for (i = 0; i < num_channels; i++)
 		media_format->channel_mapping[i] = cfg->channel_map[i];
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -1008,7 +1073,7 @@ static int audioreach_i2s_set_media_format(struct q6apm_graph *graph,
 	param_data->param_size = fs_sz - APM_MODULE_PARAM_DATA_SIZE;
 	fs_cfg->frame_size_factor = 1;
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -1043,7 +1108,7 @@ static int audioreach_logging_set_media_format(struct q6apm_graph *graph,
 	cfg->log_tap_point_id = module->log_tap_point_id;
 	cfg->mode = module->log_mode;
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -1094,7 +1159,7 @@ static int audioreach_pcm_set_media_format(struct q6apm_graph *graph,
 	media_cfg->bits_per_sample = mcfg->bit_width;
 	memcpy(media_cfg->channel_mapping, mcfg->channel_map, mcfg->num_channels);
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -1219,7 +1284,7 @@ static int audioreach_gain_set(struct q6apm_graph *graph, struct audioreach_modu
 
 	cfg->gain_cfg.gain = module->gain;
 
-	rc = q6apm_send_cmd_sync(graph->apm, pkt, 0);
+	rc = audioreach_graph_set_cfg(graph, pkt);
 
 	kfree(pkt);
 
@@ -782,6 +782,8 @@ int audioreach_tplg_init(struct snd_soc_component *component);
 
 /* Module specific */
 void audioreach_graph_free_buf(struct q6apm_graph *graph);
+void audioreach_graph_cfg_batch_begin(struct q6apm_graph *graph);
+int audioreach_graph_cfg_batch_flush(struct q6apm_graph *graph);
 int audioreach_map_memory_regions(struct q6apm_graph *graph,
 				  unsigned int dir, size_t period_sz,
 				  unsigned int periods,
@@ -2,7 +2,9 @@
 // Copyright (c) 2021, Linaro Limited
 
 #include <linux/init.h>
+#include <linux/debugfs.h>
 #include <linux/err.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/of.h>
 #include <linux/platform_device.h>
@@ -28,11 +30,14 @@
 #define CAPTURE_MIN_PERIOD_SIZE		320
 #define BUFFER_BYTES_MAX (PLAYBACK_MAX_NUM_PERIODS * PLAYBACK_MAX_PERIOD_SIZE)
 #define BUFFER_BYTES_MIN (PLAYBACK_MIN_NUM_PERIODS * PLAYBACK_MIN_PERIOD_SIZE)
-#define COMPR_PLAYBACK_MAX_FRAGMENT_SIZE (128 * 1024)
+#define COMPR_PLAYBACK_MAX_FRAGMENT_SIZE (1024 * 1024)
 #define COMPR_PLAYBACK_MAX_NUM_FRAGMENTS (16 * 4)
 #define COMPR_PLAYBACK_MIN_FRAGMENT_SIZE (8 * 1024)
 #define COMPR_PLAYBACK_MIN_NUM_FRAGMENTS (4)
+/* Fragments above 128KiB are for deep buffer playback, cap the total */
+#define COMPR_PLAYBACK_MAX_BUFFER_SIZE (128 * 1024 * COMPR_PLAYBACK_MAX_NUM_FRAGMENTS)
 #define SID_MASK_DEFAULT	0xF
+#define Q6APM_DAI_HIST_BUCKETS	20
 
 static const struct snd_compr_codec_caps q6apm_compr_caps = {
 	.num_descriptors = 1,
@@ -65,6 +70,7 @@ struct q6apm_dai_rtd {
 	unsigned int pcm_size;
 	unsigned int pcm_count;
 	unsigned int pos;       /* Buffer position */
+	snd_pcm_uframes_t queue_ptr;	/* Frames handed to the DSP */
 	unsigned int periods;
 	unsigned int bytes_sent;
 	unsigned int bytes_received;
@@ -75,10 +81,26 @@ struct q6apm_dai_rtd {
 	struct q6apm_graph *graph;
 	spinlock_t lock;
 	bool notify_on_drain;
+	struct q6apm_dai_data *pdata;
+	/* Time each in-flight period was handed to the DSP */
+	ktime_t queued[PLAYBACK_MAX_NUM_PERIODS];
+	unsigned int queued_head;
+	unsigned int queued_tail;
+};
+
+/* Time a period spends in the DSP, from queue to done, in log2(us) buckets */
+struct q6apm_dai_hist {
+	u64 count;
+	u64 sum_us;
+	u64 max_us;
+	u64 buckets[Q6APM_DAI_HIST_BUCKETS];
 };
 
 struct q6apm_dai_data {
 	long long sid;
+	spinlock_t hist_lock;
+	struct q6apm_dai_hist hist[SNDRV_PCM_STREAM_LAST + 1];
+	struct dentry *debugfs;
 };
 
 static const struct snd_pcm_hardware q6apm_dai_hardware_capture = {
@@ -104,7 +126,7 @@ static const struct snd_pcm_hardware q6apm_dai_hardware_playback = {
 	.info =                 (SNDRV_PCM_INFO_MMAP | SNDRV_PCM_INFO_BLOCK_TRANSFER |
 				 SNDRV_PCM_INFO_MMAP_VALID | SNDRV_PCM_INFO_INTERLEAVED |
 				 SNDRV_PCM_INFO_PAUSE | SNDRV_PCM_INFO_RESUME |
-				 SNDRV_PCM_INFO_BATCH),
+				 SNDRV_PCM_INFO_BATCH | SNDRV_PCM_INFO_NO_REWINDS),
 	.formats =              (SNDRV_PCM_FMTBIT_S16_LE | SNDRV_PCM_FMTBIT_S24_LE),
 	.rates =                SNDRV_PCM_RATE_8000_192000,
 	.rate_min =             8000,
@@ -119,6 +141,35 @@ static const struct snd_pcm_hardware q6apm_dai_hardware_playback = {
 	.fifo_size =            0,
 };
 
+static void q6apm_dai_buf_queued(struct q6apm_dai_rtd *prtd)
+{
+	prtd->queued[prtd->queued_head++ % ARRAY_SIZE(prtd->queued)] = ktime_get();
+}
+
+static void q6apm_dai_buf_done(struct q6apm_dai_rtd *prtd)
+{
+	struct q6apm_dai_data *pdata = prtd->pdata;
+	struct q6apm_dai_hist *hist;
+	unsigned long flags;
+	unsigned int bucket;
+	u64 us;
+
+	if (prtd->queued_tail == prtd->queued_head)
+		return;
+
+	us = ktime_us_delta(ktime_get(),
+			    prtd->queued[prtd->queued_tail++ % ARRAY_SIZE(prtd->queued)]);
+	bucket = min_t(unsigned int, us ? ilog2(us) + 1 : 0, Q6APM_DAI_HIST_BUCKETS - 1);
+	hist = &pdata->hist[prtd->substream->stream];
+
+	spin_lock_irqsave(&pdata->hist_lock, flags);
+	hist->count++;
+	hist->sum_us += us;
+	hist->max_us = max(hist->max_us, us);
+	hist->buckets[bucket]++;
+	spin_unlock_irqrestore(&pdata->hist_lock, flags);
+}
+
 static void event_handler(uint32_t opcode, uint32_t token, void *payload, void *priv)
 {
 	struct q6apm_dai_rtd *prtd = priv;
@@ -132,15 +183,17 @@ static void event_handler(uint32_t opcode, uint32_t token, void *payload, void *
 	case APM_CLIENT_EVENT_DATA_WRITE_DONE:
 		spin_lock_irqsave(&prtd->lock, flags);
 		prtd->pos += prtd->pcm_count;
+		q6apm_dai_buf_done(prtd);
 		spin_unlock_irqrestore(&prtd->lock, flags);
 		snd_pcm_period_elapsed(substream);
-		if (prtd->state == Q6APM_STREAM_RUNNING)
-			q6apm_write_async(prtd->graph, prtd->pcm_count, 0, 0, 0);
 
 		break;
 	case APM_CLIENT_EVENT_DATA_READ_DONE:
 		spin_lock_irqsave(&prtd->lock, flags);
 		prtd->pos += prtd->pcm_count;
+		q6apm_dai_buf_done(prtd);
+		if (prtd->state == Q6APM_STREAM_RUNNING)
+			q6apm_dai_buf_queued(prtd);
 		spin_unlock_irqrestore(&prtd->lock, flags);
 		snd_pcm_period_elapsed(substream);
 		if (prtd->state == Q6APM_STREAM_RUNNING)
@@ -249,6 +302,9 @@ static int q6apm_dai_prepare(struct snd_soc_component *component,
 
 	prtd->pcm_count = snd_pcm_lib_period_bytes(substream);
 	prtd->pos = 0;
+	prtd->queue_ptr = 0;
+	prtd->queued_head = 0;
+	prtd->queued_tail = 0;
 	/* rate and channels are sent to audio driver */
 	ret = q6apm_graph_media_format_shmem(prtd->graph, &cfg);
 	if (ret < 0) {
@@ -281,10 +337,15 @@ static int q6apm_dai_prepare(struct snd_soc_component *component,
 	}
 
 	if (substream->stream == SNDRV_PCM_STREAM_CAPTURE) {
+		unsigned long flags;
 		int i;
 		/* Queue the buffers for Capture ONLY after graph is started */
-		for (i = 0; i < runtime->periods; i++)
+		for (i = 0; i < runtime->periods; i++) {
+			spin_lock_irqsave(&prtd->lock, flags);
+			q6apm_dai_buf_queued(prtd);
+			spin_unlock_irqrestore(&prtd->lock, flags);
 			q6apm_read(prtd->graph);
+		}
 
 	}
 
@@ -305,9 +366,7 @@ static int q6apm_dai_trigger(struct snd_soc_component *component,
 	case SNDRV_PCM_TRIGGER_START:
 	case SNDRV_PCM_TRIGGER_RESUME:
 	case SNDRV_PCM_TRIGGER_PAUSE_RELEASE:
-		 /* start writing buffers for playback only as we already queued capture buffers */
-		if (substream->stream == SNDRV_PCM_STREAM_PLAYBACK)
-			ret = q6apm_write_async(prtd->graph, prtd->pcm_count, 0, 0, 0);
+		/* playback buffers are queued from .ack as soon as they are filled */
 		break;
 	case SNDRV_PCM_TRIGGER_STOP:
 		/* TODO support be handled via SoftPause Module */
@@ -324,6 +383,47 @@ static int q6apm_dai_trigger(struct snd_soc_component *component,
 	return ret;
 }
 
+/*
+ * Hand every period the application has filled to the DSP right away, rather
+ * than one at a time from the write done event. With short periods the DSP
+ * would otherwise starve for the duration of an event round trip.
+ */
+static int q6apm_dai_ack(struct snd_soc_component *component,
+			 struct snd_pcm_substream *substream)
+{
+	struct snd_pcm_runtime *runtime = substream->runtime;
+	struct q6apm_dai_rtd *prtd = runtime->private_data;
+	snd_pcm_sframes_t avail;
+	unsigned long flags;
+	int ret;
+
+	if (substream->stream != SNDRV_PCM_STREAM_PLAYBACK)
+		return 0;
+
+	avail = runtime->control->appl_ptr - prtd->queue_ptr;
+	if (avail < 0)
+		avail += runtime->boundary;
+
+	while (avail >= runtime->period_size) {
+		spin_lock_irqsave(&prtd->lock, flags);
+		q6apm_dai_buf_queued(prtd);
+		spin_unlock_irqrestore(&prtd->lock, flags);
+
+		ret = q6apm_write_async(prtd->graph, prtd->pcm_count, 0, 0, 0);
+		if (ret < 0) {
+			dev_err(component->dev, "Error queuing playback buffer %d\n", ret);
+			return ret;
+		}
+
+		prtd->queue_ptr += runtime->period_size;
+		if (prtd->queue_ptr >= runtime->boundary)
+			prtd->queue_ptr -= runtime->boundary;
+		avail -= runtime->period_size;
+	}
+
+	return 0;
+}
+
 static int q6apm_dai_open(struct snd_soc_component *component,
 			  struct snd_pcm_substream *substream)
 {
@@ -349,6 +449,7 @@ static int q6apm_dai_open(struct snd_soc_component *component,
 
 	spin_lock_init(&prtd->lock);
 	prtd->substream = substream;
+	prtd->pdata = pdata;
 	prtd->graph = q6apm_graph_open(dev, event_handler, prtd, graph_id);
 	if (IS_ERR(prtd->graph)) {
 		dev_err(dev, "%s: Could not allocate memory\n", __func__);
@@ -502,7 +603,7 @@ static int q6apm_dai_compr_open(struct snd_soc_component *component,
 
 	runtime->private_data = prtd;
 	runtime->dma_bytes = BUFFER_BYTES_MAX;
-	size = COMPR_PLAYBACK_MAX_FRAGMENT_SIZE * COMPR_PLAYBACK_MAX_NUM_FRAGMENTS;
+	size = COMPR_PLAYBACK_MAX_BUFFER_SIZE;
 	ret = snd_dma_alloc_pages(SNDRV_DMA_TYPE_DEV, dev, size, &prtd->dma_buffer);
 	if (ret)
 		return ret;
@@ -647,6 +748,13 @@ static int q6apm_dai_compr_set_params(struct snd_soc_component *component,
 	if (!pdata)
 		return -EINVAL;
 
+	if (runtime->fragments * runtime->fragment_size > prtd->dma_buffer.bytes) {
+		dev_err(component->dev, "buffer of %u x %u bytes exceeds %zu\n",
+			runtime->fragments, runtime->fragment_size,
+			prtd->dma_buffer.bytes);
+		return -EINVAL;
+	}
+
 	prtd->periods = runtime->fragments;
 	prtd->pcm_count = runtime->fragment_size;
 	prtd->pcm_size = runtime->fragments * runtime->fragment_size;
@@ -836,10 +944,43 @@ static const struct snd_soc_component_driver q6apm_fe_dai_component = {
 	.hw_params	= q6apm_dai_hw_params,
 	.pointer	= q6apm_dai_pointer,
 	.trigger	= q6apm_dai_trigger,
+	.ack		= q6apm_dai_ack,
 	.compress_ops	= &q6apm_dai_compress_ops,
 	.use_dai_pcm_id = true,
 };
 
+static int q6apm_dai_latency_show(struct seq_file *s, void *unused)
+{
+	struct q6apm_dai_data *pdata = s->private;
+	static const char * const names[] = { "playback", "capture" };
+	struct q6apm_dai_hist hist;
+	unsigned int i, dir;
+
+	for (dir = 0; dir < ARRAY_SIZE(pdata->hist); dir++) {
+		spin_lock_irq(&pdata->hist_lock);
+		hist = pdata->hist[dir];
+		spin_unlock_irq(&pdata->hist_lock);
+
+		seq_printf(s, "%s: count %llu avg %llu us max %llu us\n", names[dir],
+			   hist.count, hist.count ? div64_u64(hist.sum_us, hist.count) : 0,
+			   hist.max_us);
+
+		for (i = 0; i < Q6APM_DAI_HIST_BUCKETS; i++) {
+			if (!hist.buckets[i])
+				continue;
+			seq_printf(s, "  < %8lu us: %llu\n", 1UL << i, hist.buckets[i]);
+		}
+	}
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(q6apm_dai_latency);
+
+static void q6apm_dai_debugfs_remove(void *data)
+{
+	debugfs_remove_recursive(data);
+}
+
 static int q6apm_dai_probe(struct platform_device *pdev)
 {
 	struct device *dev = &pdev->dev;
@@ -858,8 +999,15 @@ static int q6apm_dai_probe(struct platform_device *pdev)
 	else
 		pdata->sid = args.args[0] & SID_MASK_DEFAULT;
 
+	spin_lock_init(&pdata->hist_lock);
 	dev_set_drvdata(dev, pdata);
 
+	pdata->debugfs = debugfs_create_dir(dev_name(dev), NULL);
+	debugfs_create_file("latency", 0444, pdata->debugfs, pdata, &q6apm_dai_latency_fops);
+	rc = devm_add_action_or_reset(dev, q6apm_dai_debugfs_remove, pdata->debugfs);
+	if (rc)
+		return rc;
+
 	return devm_snd_soc_register_component(dev, &q6apm_fe_dai_component, NULL, 0);
 }
 
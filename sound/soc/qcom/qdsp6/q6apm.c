@@ -27,6 +27,12 @@ struct apm_graph_mgmt_cmd {
 
 #define APM_GRAPH_MGMT_PSIZE(p, n) ALIGN(struct_size(p, sub_graph_id_list, n), 8)
 
+/*
+ * Keep a graph open on the DSP for a while after its last user is gone, so
+ * that reopening a stream does not pay for another APM_CMD_GRAPH_OPEN.
+ */
+#define Q6APM_GRAPH_IDLE_CLOSE_MS	5000
+
 static struct q6apm *g_apm;
 
 int q6apm_send_cmd_sync(struct q6apm *apm, struct gpr_pkt *pkt, uint32_t rsp_opcode)
@@ -43,23 +49,31 @@ static struct audioreach_graph *q6apm_get_audioreach_graph(struct q6apm *apm, ui
 	struct audioreach_graph *graph;
 	int id;
 
+	mutex_lock(&apm->cmd_lock);
+
 	mutex_lock(&apm->lock);
 	graph = idr_find(&apm->graph_idr, graph_id);
 	mutex_unlock(&apm->lock);
 
 	if (graph) {
-		kref_get(&graph->refcount);
+		/* Still open on the DSP, possibly idle and waiting to be closed */
+		graph->refcount++;
+		mutex_unlock(&apm->cmd_lock);
 		return graph;
 	}
 
 	info = idr_find(&apm->graph_info_idr, graph_id);
 
-	if (!info)
-		return ERR_PTR(-ENODEV);
+	if (!info) {
+		graph = ERR_PTR(-ENODEV);
+		goto unlock;
+	}
 
 	graph = kzalloc(sizeof(*graph), GFP_KERNEL);
-	if (!graph)
-		return ERR_PTR(-ENOMEM);
+	if (!graph) {
+		graph = ERR_PTR(-ENOMEM);
+		goto unlock;
+	}
 
 	graph->apm = apm;
 	graph->info = info;
@@ -70,7 +84,8 @@ static struct audioreach_graph *q6apm_get_audioreach_graph(struct q6apm *apm, ui
 		void *err = graph->graph;
 
 		kfree(graph);
-		return ERR_CAST(err);
+		graph = ERR_CAST(err);
+		goto unlock;
 	}
 
 	mutex_lock(&apm->lock);
@@ -80,14 +95,18 @@ static struct audioreach_graph *q6apm_get_audioreach_graph(struct q6apm *apm, ui
 		kfree(graph->graph);
 		kfree(graph);
 		mutex_unlock(&apm->lock);
-		return ERR_PTR(id);
+		graph = ERR_PTR(id);
+		goto unlock;
 	}
 	mutex_unlock(&apm->lock);
 
-	kref_init(&graph->refcount);
+	graph->refcount = 1;
 
 	q6apm_send_cmd_sync(apm, graph->graph, 0);
 
+unlock:
+	mutex_unlock(&apm->cmd_lock);
+
 	return graph;
 }
 
@@ -127,22 +146,66 @@ static int audioreach_graph_mgmt_cmd(struct audioreach_graph *graph, uint32_t op
 	return rc;
 }
 
-static void q6apm_put_audioreach_graph(struct kref *ref)
+static void q6apm_put_audioreach_graph(struct audioreach_graph *graph)
 {
+	struct q6apm *apm = graph->apm;
+
+	mutex_lock(&apm->cmd_lock);
+	if (!--graph->refcount) {
+		graph->idle_since = jiffies;
+		schedule_delayed_work(&apm->close_work,
+				      msecs_to_jiffies(Q6APM_GRAPH_IDLE_CLOSE_MS));
+	}
+	mutex_unlock(&apm->cmd_lock);
+}
+
+/*
+ * Close the graphs that have been idle for Q6APM_GRAPH_IDLE_CLOSE_MS, or all
+ * idle graphs when @all is set. Returns the delay until the next graph is
+ * due, 0 if none is left idle. Called with cmd_lock held.
+ */
+static unsigned long q6apm_close_idle_graphs(struct q6apm *apm, bool all)
+{
+	unsigned long timeout = msecs_to_jiffies(Q6APM_GRAPH_IDLE_CLOSE_MS);
 	struct audioreach_graph *graph;
-	struct q6apm *apm;
+	unsigned long next = 0;
+	int id;
 
-	graph = container_of(ref, struct audioreach_graph, refcount);
-	apm = graph->apm;
+	idr_for_each_entry(&apm->graph_idr, graph, id) {
+		unsigned long expires = graph->idle_since + timeout;
 
-	audioreach_graph_mgmt_cmd(graph, APM_CMD_GRAPH_CLOSE);
+		if (graph->refcount)
+			continue;
 
-	mutex_lock(&apm->lock);
-	graph = idr_remove(&apm->graph_idr, graph->id);
-	mutex_unlock(&apm->lock);
+		if (!all && time_before(jiffies, expires)) {
+			if (!next || expires - jiffies < next)
+				next = expires - jiffies;
+			continue;
+		}
 
-	kfree(graph->graph);
-	kfree(graph);
+		audioreach_graph_mgmt_cmd(graph, APM_CMD_GRAPH_CLOSE);
+
+		mutex_lock(&apm->lock);
+		idr_remove(&apm->graph_idr, graph->id);
+		mutex_unlock(&apm->lock);
+
+		kfree(graph->graph);
+		kfree(graph);
+	}
+
+	return next;
+}
+
+static void q6apm_close_work(struct work_struct *work)
+{
+	struct q6apm *apm = container_of(to_delayed_work(work), struct q6apm, close_work);
+	unsigned long next;
+
+	mutex_lock(&apm->cmd_lock);
+	next = q6apm_close_idle_graphs(apm, false);
+	if (next)
+		schedule_delayed_work(&apm->close_work, next);
+	mutex_unlock(&apm->cmd_lock);
 }
 
 
@@ -369,6 +432,10 @@ int q6apm_graph_media_format_pcm(struct q6apm_graph *graph, struct audioreach_mo
 	struct audioreach_sub_graph *sgs;
 	struct audioreach_container *container;
 	struct audioreach_module *module;
+	int ret;
+
+	/* One SET_CFG round trip for the media format of every module */
+	audioreach_graph_cfg_batch_begin(graph);
 
 	list_for_each_entry(sgs, &info->sg_list, node) {
 		list_for_each_entry(container, &sgs->container_list, node) {
@@ -382,6 +449,11 @@ int q6apm_graph_media_format_pcm(struct q6apm_graph *graph, struct audioreach_mo
 		}
 	}
 
+	/* As when sent one by one, a rejected parameter is not fatal */
+	ret = audioreach_graph_cfg_batch_flush(graph);
+	if (ret)
+		dev_err(graph->dev, "Failed to set media format: %d\n", ret);
+
 	return 0;
 
 }
@@ -644,7 +716,7 @@ struct q6apm_graph *q6apm_graph_open(struct device *dev, q6apm_cb cb,
 free_graph:
 	kfree(graph);
 put_ar_graph:
-	kref_put(&ar_graph->refcount, q6apm_put_audioreach_graph);
+	q6apm_put_audioreach_graph(ar_graph);
 	return ERR_PTR(ret);
 }
 EXPORT_SYMBOL_GPL(q6apm_graph_open);
@@ -654,7 +726,7 @@ int q6apm_graph_close(struct q6apm_graph *graph)
 	struct audioreach_graph *ar_graph = graph->ar_graph;
 
 	graph->ar_graph = NULL;
-	kref_put(&ar_graph->refcount, q6apm_put_audioreach_graph);
+	q6apm_put_audioreach_graph(ar_graph);
 	gpr_free_port(graph->port);
 	kfree(graph);
 
@@ -706,6 +778,14 @@ static int q6apm_audio_probe(struct snd_soc_component *component)
 
 static void q6apm_audio_remove(struct snd_soc_component *component)
 {
+	struct q6apm *apm = dev_get_drvdata(component->dev);
+
+	/* idle graphs reference the topology, close them first */
+	cancel_delayed_work_sync(&apm->close_work);
+	mutex_lock(&apm->cmd_lock);
+	q6apm_close_idle_graphs(apm, true);
+	mutex_unlock(&apm->cmd_lock);
+
 	/* remove topology */
 	snd_soc_tplg_component_remove(component);
 }
@@ -730,7 +810,9 @@ static int apm_probe(gpr_device_t *gdev)
 
 	dev_set_drvdata(dev, apm);
 
+	mutex_init(&apm->cmd_lock);
 	mutex_init(&apm->lock);
+	INIT_DELAYED_WORK(&apm->close_work, q6apm_close_work);
 	apm->dev = dev;
 	apm->gdev = gdev;
 	init_waitqueue_head(&apm->wait);
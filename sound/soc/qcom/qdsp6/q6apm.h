@@ -12,6 +12,7 @@
 #include <sound/soc.h>
 #include <linux/of_platform.h>
 #include <linux/jiffies.h>
+#include <linux/workqueue.h>
 #include <linux/soc/qcom/apr.h>
 #include "audioreach.h"
 
@@ -55,9 +56,12 @@ struct q6apm {
 	wait_queue_head_t wait;
 	struct gpr_ibasic_rsp_result_t result;
 
+	/* Serialises DSP graph open/close against graph lookup */
 	struct mutex cmd_lock;
 	struct mutex lock;
 	uint32_t state;
+	/* Closes DSP graphs left unused for Q6APM_GRAPH_IDLE_CLOSE_MS */
+	struct delayed_work close_work;
 
 	struct list_head widget_list;
 	struct idr graph_idr;
@@ -86,7 +90,9 @@ struct audioreach_graph {
 	int start_count;
 	/* Cached Graph data */
 	void *graph;
-	struct kref refcount;
+	/* Users of the graph, protected by q6apm cmd_lock */
+	unsigned int refcount;
+	unsigned long idle_since;
 	struct q6apm *apm;
 };
 
@@ -101,6 +107,10 @@ struct q6apm_graph {
 	gpr_port_t *port;
 	struct audioreach_graph_data rx_data;
 	struct audioreach_graph_data tx_data;
+	/* Module parameters queued for a single APM_CMD_SET_CFG */
+	bool cfg_batching;
+	void *cfg_batch;
+	size_t cfg_batch_size;
 	struct gpr_ibasic_rsp_result_t result;
 	wait_queue_head_t cmd_wait;
 	struct mutex lock;
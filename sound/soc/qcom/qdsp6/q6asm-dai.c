@@ -35,9 +35,11 @@
 
 /* Default values used if user space does not set */
 #define COMPR_PLAYBACK_MIN_FRAGMENT_SIZE (8 * 1024)
-#define COMPR_PLAYBACK_MAX_FRAGMENT_SIZE (128 * 1024)
+#define COMPR_PLAYBACK_MAX_FRAGMENT_SIZE (1024 * 1024)
 #define COMPR_PLAYBACK_MIN_NUM_FRAGMENTS (4)
 #define COMPR_PLAYBACK_MAX_NUM_FRAGMENTS (16 * 4)
+/* Fragments above 128KiB are for deep buffer playback, cap the total */
+#define COMPR_PLAYBACK_MAX_BUFFER_SIZE (128 * 1024 * COMPR_PLAYBACK_MAX_NUM_FRAGMENTS)
 
 #define ALAC_CH_LAYOUT_MONO   ((101 << 16) | 1)
 #define ALAC_CH_LAYOUT_STEREO ((101 << 16) | 2)
@@ -634,8 +636,7 @@ static int q6asm_dai_compr_open(struct snd_soc_component *component,
 		goto free_prtd;
 	}
 
-	size = COMPR_PLAYBACK_MAX_FRAGMENT_SIZE *
-			COMPR_PLAYBACK_MAX_NUM_FRAGMENTS;
+	size = COMPR_PLAYBACK_MAX_BUFFER_SIZE;
 	ret = snd_dma_alloc_pages(SNDRV_DMA_TYPE_DEV, dev, size,
 				  &prtd->dma_buffer);
 	if (ret) {
@@ -891,6 +892,13 @@ static int q6asm_dai_compr_set_params(struct snd_soc_component *component,
 		return -EINVAL;
 	}
 
+	if (runtime->fragments * runtime->fragment_size > prtd->dma_buffer.bytes) {
+		dev_err(dev, "buffer of %u x %u bytes exceeds %zu\n",
+			runtime->fragments, runtime->fragment_size,
+			prtd->dma_buffer.bytes);
+		return -EINVAL;
+	}
+
 	prtd->periods = runtime->fragments;
 	prtd->pcm_count = runtime->fragment_size;
 	prtd->pcm_size = runtime->fragments * runtime->fragment_size;
@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+# SPDX-License-Identifier: GPL-2.0
+#
+# Trace driven power/performance metrics for Qualcomm SoCs (e.g. SM7150)
+#
+# Records a scenario with the rpmh, interconnect, cpuidle, qcom_aoss and
+# drm_msm_gpu tracepoints enabled, turns the trace into per-scenario
+# metrics and compares them against a stored baseline:
+#
+#   qcom_powerstat.py record -s video -o video.trace -- <scenario command>
+#   qcom_powerstat.py analyze video.trace -o video.json
+#   qcom_powerstat.py compare baseline/video.json video.json -t 10
+#
+# compare exits with 1 when a metric regressed by more than the threshold,
+# so it can gate a CI run.
+
+import argparse
+import json
+import os
+import re
+import subprocess
+import sys
+import time
+
+EVENTS = [
+	'rpmh/rpmh_send_msg',
+	'rpmh/rpmh_tx_done',
+	'interconnect/icc_set_bw',
+	'power/cpu_idle',
+	'qcom_aoss/aoss_send',
+	'drm_msm_gpu/msm_gpu_freq_change',
+]
+
+TRACEFS = ['/sys/kernel/tracing', '/sys/kernel/debug/tracing']
+
+# "<task>-<pid> [cpu] <flags> <timestamp>: <event>: <fields>"
+LINE_RE = re.compile(r'^\s*.+?-\d+\s+\[(\d+)\]\s+(?:\S+\s+)?([\d.]+):\s+(\w+):\s+(.*)$')
+KV_RE = re.compile(r'(\w+)=(\S+)')
+
+# cpu_idle reports PWR_EVENT_EXIT as state (u32)-1 when leaving idle
+IDLE_EXIT = 4294967295
+
+IDLE_RE = re.compile(r'^idle\.cpu\d+\.state(\d+)_pct$')
+
+def direction(key):
+	"""1 if a higher value is a regression, -1 if a lower one is, 0 if
+	the metric is informational only"""
+	m = IDLE_RE.match(key)
+	if m:
+		# Less time in the deeper states costs power, WFI doesn't matter
+		return -1 if int(m.group(1)) else 0
+	if key.startswith('gpu.freq') and key.endswith('_pct'):
+		return 0
+	return 1
+
+def tracefs():
+	for path in TRACEFS:
+		if os.path.isdir(os.path.join(path, 'events')):
+			return path
+	sys.exit('tracefs is not mounted')
+
+def tracefs_write(root, name, val):
+	try:
+		with open(os.path.join(root, name), 'w') as f:
+			f.write(val)
+	except OSError as e:
+		return e
+	return None
+
+def record(args):
+	root = tracefs()
+
+	tracefs_write(root, 'tracing_on', '0')
+	tracefs_write(root, 'trace', '')
+	tracefs_write(root, 'buffer_size_kb', str(args.buffer_kb))
+	for ev in EVENTS:
+		err = tracefs_write(root, 'events/%s/enable' % ev, '1')
+		if err:
+			print('warning: %s not available: %s' % (ev, err),
+			      file=sys.stderr)
+
+	tracefs_write(root, 'tracing_on', '1')
+	start = time.monotonic()
+	if args.command:
+		subprocess.call(args.command)
+	else:
+		time.sleep(args.duration)
+	elapsed = time.monotonic() - start
+	tracefs_write(root, 'tracing_on', '0')
+
+	for ev in EVENTS:
+		tracefs_write(root, 'events/%s/enable' % ev, '0')
+
+	with open(os.path.join(root, 'trace')) as src, open(args.output, 'w') as dst:
+		dst.write('# scenario: %s\n' % args.scenario)
+		dst.write('# elapsed: %.6f\n' % elapsed)
+		for line in src:
+			dst.write(line)
+
+	print('recorded %s (%.1fs) to %s' % (args.scenario, elapsed, args.output))
+
+def parse(path):
+	meta = {}
+	events = []
+
+	with open(path) as f:
+		for line in f:
+			if line.startswith('#'):
+				m = re.match(r'# (\w+): (.*)', line)
+				if m:
+					meta[m.group(1)] = m.group(2).strip()
+				continue
+
+			m = LINE_RE.match(line)
+			if m:
+				events.append((int(m.group(1)), float(m.group(2)),
+					       m.group(3), m.group(4)))
+
+	return meta, events
+
+def analyze_trace(path):
+	meta, events = parse(path)
+	metrics = {}
+
+	if not events:
+		return meta.get('scenario', ''), metrics
+
+	t0 = events[0][1]
+	t1 = events[-1][1]
+	duration = float(meta.get('elapsed', 0)) or (t1 - t0) or 1.0
+
+	counts = {}
+	icc_last = {}
+	icc_changes = {}
+	idle_enter = {}
+	idle_time = {}
+	gpu_freq, gpu_since = None, t0
+	gpu_time = {}
+
+	for cpu, ts, name, fields in events:
+		kv = dict(KV_RE.findall(fields))
+		counts[name] = counts.get(name, 0) + 1
+
+		if name == 'icc_set_bw':
+			# Churn is votes that actually change the node's aggregate,
+			# the first one seen only tells where it started from
+			node = kv.get('node', '?')
+			agg = (kv.get('agg_avg'), kv.get('agg_peak'))
+			if node not in icc_last:
+				icc_changes.setdefault(node, 0)
+			elif icc_last[node] != agg:
+				icc_changes[node] += 1
+			icc_last[node] = agg
+		elif name == 'cpu_idle':
+			state = int(kv.get('state', IDLE_EXIT))
+			c = int(kv.get('cpu_id', cpu))
+			if state == IDLE_EXIT:
+				if c in idle_enter:
+					s, since = idle_enter.pop(c)
+					idle_time[(c, s)] = idle_time.get((c, s), 0) + ts - since
+			else:
+				idle_enter[c] = (state, ts)
+		elif name == 'msm_gpu_freq_change':
+			if gpu_freq is not None:
+				gpu_time[gpu_freq] = gpu_time.get(gpu_freq, 0) + ts - gpu_since
+			gpu_freq, gpu_since = int(kv.get('new_freq', 0)), ts
+
+	# Close whatever was still running when the trace ended
+	for c, (s, since) in idle_enter.items():
+		idle_time[(c, s)] = idle_time.get((c, s), 0) + t1 - since
+	if gpu_freq is not None:
+		gpu_time[gpu_freq] = gpu_time.get(gpu_freq, 0) + t1 - gpu_since
+
+	metrics['rpmh.msgs_per_sec'] = counts.get('rpmh_send_msg', 0) / duration
+	metrics['rpmh.acks_per_sec'] = counts.get('rpmh_tx_done', 0) / duration
+	metrics['aoss.msgs_per_sec'] = counts.get('aoss_send', 0) / duration
+	metrics['icc.votes_per_sec'] = counts.get('icc_set_bw', 0) / duration
+	metrics['icc.churn_per_sec'] = sum(icc_changes.values()) / duration
+	for node, n in icc_changes.items():
+		metrics['icc.%s.churn_per_sec' % node] = n / duration
+
+	for (c, s), t in idle_time.items():
+		metrics['idle.cpu%d.state%d_pct' % (c, s)] = 100.0 * t / duration
+
+	total = sum(gpu_time.values())
+	if total:
+		for freq, t in gpu_time.items():
+			metrics['gpu.freq%d_pct' % freq] = 100.0 * t / total
+		# new_freq is in Hz
+		metrics['gpu.avg_mhz'] = \
+			sum(f * t for f, t in gpu_time.items()) / total / 1e6
+		metrics['gpu.freq_changes_per_sec'] = \
+			counts.get('msm_gpu_freq_change', 0) / duration
+
+	return meta.get('scenario', ''), metrics
+
+def analyze(args):
+	scenario, metrics = analyze_trace(args.trace)
+	result = {'scenario': scenario, 'metrics': metrics}
+
+	if args.output:
+		with open(args.output, 'w') as f:
+			json.dump(result, f, indent=1, sort_keys=True)
+	else:
+		for key in sorted(metrics):
+			print('%s=%.3f' % (key, metrics[key]))
+
+def compare(args):
+	with open(args.baseline) as f:
+		base = json.load(f)['metrics']
+	with open(args.current) as f:
+		cur = json.load(f)['metrics']
+
+	regressed = False
+	for key in sorted(set(base) | set(cur)):
+		b, c = base.get(key, 0.0), cur.get(key, 0.0)
+		# Percentages move in absolute points, rates relative to baseline
+		if key.endswith('_pct'):
+			delta = c - b
+		elif b:
+			delta = 100.0 * (c - b) / b
+		else:
+			delta = 100.0 if c else 0.0
+
+		bad = direction(key) * delta > args.threshold
+		regressed |= bad
+
+		if bad or args.verbose:
+			print('%s %s baseline=%.3f current=%.3f delta=%+.1f%s' %
+			      ('REGRESSION' if bad else 'ok', key, b, c, delta,
+			       'pt' if key.endswith('_pct') else '%'))
+
+	return 1 if regressed else 0
+
+def main():
+	p = argparse.ArgumentParser(description='Trace driven power metrics')
+	sub = p.add_subparsers(dest='cmd', required=True)
+
+	r = sub.add_parser('record', help='record a scenario')
+	r.add_argument('-s', '--scenario', required=True)
+	r.add_argument('-o', '--output', required=True)
+	r.add_argument('-d', '--duration', type=float, default=30,
+		       help='seconds to record when no command is given')
+	r.add_argument('-b', '--buffer-kb', type=int, default=65536)
+	r.add_argument('command', nargs=argparse.REMAINDER,
+		       help='scenario command, after "--"')
+
+	a = sub.add_parser('analyze', help='compute metrics from a trace')
+	a.add_argument('trace')
+	a.add_argument('-o', '--output', help='write metrics as json')
+
+	c = sub.add_parser('compare', help='diff metrics against a baseline')
+	c.add_argument('baseline')
+	c.add_argument('current')
+	c.add_argument('-t', '--threshold', type=float, default=10,
+		       help='allowed regression in percent or points')
+	c.add_argument('-v', '--verbose', action='store_true')
+
+	args = p.parse_args()
+	if args.cmd == 'record':
+		if args.command and args.command[0] == '--':
+			args.command = args.command[1:]
+		record(args)
+	elif args.cmd == 'analyze':
+		analyze(args)
+	else:
+		sys.exit(compare(args))
+
+if __name__ == '__main__':
+	main()
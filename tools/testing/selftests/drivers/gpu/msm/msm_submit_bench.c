@@ -0,0 +1,496 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Submit ioctl micro-benchmark for drm/msm.
+ *
+ * Drives NOP submits through DRM_IOCTL_MSM_GEM_SUBMIT, with a configurable
+ * number of BOs, relocs, in-syncobjs and submitqueues, and reports the
+ * ioctl latency as seen by userspace.  With -t it also collects the
+ * drm_msm_gpu:msm_gpu_submit_stage tracepoints and reports the time spent
+ * in each stage of the ioctl.
+ */
+#define _GNU_SOURCE
+#define __EXPORTED_HEADERS__
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <drm/drm.h>
+#include <drm/msm_drm.h>
+#include "../../../kselftest.h"
+
+#define TEST_PREFIX	"drivers/gpu/msm/submit_bench"
+#define CMD_SIZE	4096
+#define BO_SIZE		4096
+#define MAX_INFLIGHT	32
+
+/* Respectively a pkt7 (a5xx+) and pkt3 (a2xx-a4xx) CP_NOP with no payload: */
+#define PKT7_NOP	0x70108000
+#define PKT3_NOP	0xc0001000
+
+static const char * const stage_names[] = {
+	"queue_lock", "deps", "lookup", "obj_lock", "fence_sync",
+	"pin", "reloc", "arm", "push",
+};
+#define NR_STAGES	(sizeof(stage_names) / sizeof(stage_names[0]))
+
+static struct {
+	const char *dev;
+	unsigned int iters;
+	unsigned int nr_bos;
+	unsigned int nr_relocs;
+	unsigned int nr_syncobjs;
+	unsigned int nr_queues;
+	bool trace;
+} opts = {
+	.dev = "/dev/dri/renderD128",
+	.iters = 1000,
+	.nr_bos = 1,
+	.nr_queues = 1,
+};
+
+static const char *tracefs;
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void report(const char *name, uint64_t *samples, unsigned int n)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	if (!n) {
+		ksft_print_msg("%-12s: no samples\n", name);
+		return;
+	}
+
+	qsort(samples, n, sizeof(*samples), cmp_u64);
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+
+	ksft_print_msg("%-12s: n=%u min=%llu avg=%llu p50=%llu p99=%llu max=%llu ns\n",
+		       name, n, (unsigned long long)samples[0],
+		       (unsigned long long)(sum / n),
+		       (unsigned long long)samples[n / 2],
+		       (unsigned long long)samples[(n * 99) / 100],
+		       (unsigned long long)samples[n - 1]);
+}
+
+static bool is_msm(int fd)
+{
+	struct drm_version version = {};
+	char name[16] = {};
+
+	version.name = name;
+	version.name_len = sizeof(name) - 1;
+
+	if (ioctl(fd, DRM_IOCTL_VERSION, &version))
+		return false;
+
+	return !strcmp(name, "msm");
+}
+
+static uint64_t get_param(int fd, uint32_t param)
+{
+	struct drm_msm_param req = {
+		.pipe = MSM_PIPE_3D0,
+		.param = param,
+	};
+
+	if (ioctl(fd, DRM_IOCTL_MSM_GET_PARAM, &req))
+		return 0;
+
+	return req.value;
+}
+
+static uint32_t bo_new(int fd, uint32_t size)
+{
+	struct drm_msm_gem_new req = {
+		.size = size,
+		.flags = MSM_BO_WC,
+	};
+
+	if (ioctl(fd, DRM_IOCTL_MSM_GEM_NEW, &req))
+		ksft_exit_fail_perror("GEM_NEW");
+
+	return req.handle;
+}
+
+static uint32_t *bo_map(int fd, uint32_t handle, uint32_t size)
+{
+	struct drm_msm_gem_info req = {
+		.handle = handle,
+		.info = MSM_INFO_GET_OFFSET,
+	};
+	void *ptr;
+
+	if (ioctl(fd, DRM_IOCTL_MSM_GEM_INFO, &req))
+		ksft_exit_fail_perror("GEM_INFO");
+
+	ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, req.value);
+	if (ptr == MAP_FAILED)
+		ksft_exit_fail_perror("mmap");
+
+	return ptr;
+}
+
+static uint32_t queue_new(int fd)
+{
+	struct drm_msm_submitqueue req = {};
+
+	if (ioctl(fd, DRM_IOCTL_MSM_SUBMITQUEUE_NEW, &req))
+		ksft_exit_fail_perror("SUBMITQUEUE_NEW");
+
+	return req.id;
+}
+
+static uint32_t syncobj_new(int fd)
+{
+	struct drm_syncobj_create req = {
+		.flags = DRM_SYNCOBJ_CREATE_SIGNALED,
+	};
+
+	if (ioctl(fd, DRM_IOCTL_SYNCOBJ_CREATE, &req))
+		ksft_exit_fail_perror("SYNCOBJ_CREATE");
+
+	return req.handle;
+}
+
+static void wait_fence(int fd, uint32_t queueid, uint32_t fence)
+{
+	struct drm_msm_wait_fence req = {
+		.fence = fence,
+		.queueid = queueid,
+	};
+	uint64_t timeout = now_ns() + 5000000000ull;
+	int ret;
+
+	req.timeout.tv_sec = timeout / 1000000000ull;
+	req.timeout.tv_nsec = timeout % 1000000000ull;
+
+	do {
+		ret = ioctl(fd, DRM_IOCTL_MSM_WAIT_FENCE, &req);
+	} while (ret && errno == EINTR);
+
+	if (ret)
+		ksft_exit_fail_perror("WAIT_FENCE");
+}
+
+static int tracefs_write(const char *file, const char *val)
+{
+	char path[256];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), "%s/%s", tracefs, file);
+	fd = open(path, O_WRONLY | O_TRUNC);
+	if (fd < 0)
+		return -errno;
+
+	ret = write(fd, val, strlen(val)) < 0 ? -errno : 0;
+	close(fd);
+
+	return ret;
+}
+
+static int trace_start(void)
+{
+	static const char * const paths[] = {
+		"/sys/kernel/tracing", "/sys/kernel/debug/tracing",
+	};
+	unsigned int i;
+
+	for (i = 0; i < 2; i++) {
+		char path[256];
+
+		snprintf(path, sizeof(path), "%s/events/drm_msm_gpu", paths[i]);
+		if (!access(path, F_OK)) {
+			tracefs = paths[i];
+			break;
+		}
+	}
+
+	if (!tracefs)
+		return -ENOENT;
+
+	tracefs_write("tracing_on", "0");
+	tracefs_write("trace", "");
+	tracefs_write("buffer_size_kb", "16384");
+	if (tracefs_write("events/drm_msm_gpu/msm_gpu_submit/enable", "1") ||
+	    tracefs_write("events/drm_msm_gpu/msm_gpu_submit_stage/enable", "1"))
+		return -EACCES;
+
+	return tracefs_write("tracing_on", "1");
+}
+
+/*
+ * Every submit traces msm_gpu_submit at the start of the ioctl, followed by
+ * one msm_gpu_submit_stage per completed stage.  The difference between
+ * consecutive timestamps of the same submit id is the time spent in the
+ * stage.  Trace timestamps are in usec, so short stages are quantized.
+ */
+static void trace_report(void)
+{
+	uint64_t *samples[NR_STAGES];
+	unsigned int nr[NR_STAGES] = {};
+	uint64_t last_ts = 0;
+	uint32_t last_id = ~0u;
+	char path[256], line[512];
+	unsigned int i;
+	FILE *f;
+
+	tracefs_write("tracing_on", "0");
+	tracefs_write("events/drm_msm_gpu/msm_gpu_submit/enable", "0");
+	tracefs_write("events/drm_msm_gpu/msm_gpu_submit_stage/enable", "0");
+
+	for (i = 0; i < NR_STAGES; i++)
+		samples[i] = calloc(opts.iters, sizeof(uint64_t));
+
+	snprintf(path, sizeof(path), "%s/trace", tracefs);
+	f = fopen(path, "r");
+	if (!f)
+		ksft_exit_fail_perror("open trace");
+
+	while (fgets(line, sizeof(line), f)) {
+		char *ev = strstr(line, ": msm_gpu_submit");
+		char *p, *q;
+		uint64_t ts;
+		uint32_t id;
+
+		if (!ev)
+			continue;
+
+		/* The timestamp is the "sec.usec" token just before the event: */
+		for (q = ev; q > line && q[-1] != ' '; q--)
+			;
+		ts = (uint64_t)(strtod(q, NULL) * 1000000.0) * 1000;
+
+		p = strstr(ev, "id=");
+		if (!p)
+			continue;
+		id = strtoul(p + 3, NULL, 10);
+
+		if (!strncmp(ev, ": msm_gpu_submit:", 17)) {
+			last_id = id;
+			last_ts = ts;
+			continue;
+		}
+
+		if (strncmp(ev, ": msm_gpu_submit_stage:", 23) || id != last_id)
+			continue;
+
+		p = strstr(ev, "stage=");
+		if (!p)
+			continue;
+		p += 6;
+		p[strcspn(p, " \n")] = '\0';
+
+		for (i = 0; i < NR_STAGES; i++) {
+			if (strcmp(p, stage_names[i]))
+				continue;
+			if (nr[i] < opts.iters)
+				samples[i][nr[i]++] = ts - last_ts;
+			break;
+		}
+
+		last_ts = ts;
+	}
+
+	fclose(f);
+
+	for (i = 0; i < NR_STAGES; i++) {
+		report(stage_names[i], samples[i], nr[i]);
+		free(samples[i]);
+	}
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-d dev] [-n iters] [-b bos] [-r relocs] [-s syncobjs] [-q queues] [-t]\n"
+		"  -d  render node (default /dev/dri/renderD128)\n"
+		"  -n  number of submits (default 1000)\n"
+		"  -b  number of BOs in the BO table, besides the cmdstream (default 1)\n"
+		"  -r  relocs per submit, a2xx-a4xx only (default 0)\n"
+		"  -s  in-syncobjs per submit (default 0)\n"
+		"  -q  number of submitqueues to round-robin over (default 1)\n"
+		"  -t  report per-stage latency from the submit tracepoints\n",
+		prog);
+	exit(KSFT_FAIL);
+}
+
+int main(int argc, char **argv)
+{
+	struct drm_msm_gem_submit_reloc *relocs = NULL;
+	struct drm_msm_gem_submit_syncobj *syncobjs = NULL;
+	struct drm_msm_gem_submit_bo *bos;
+	struct drm_msm_gem_submit_cmd cmd = {};
+	struct drm_msm_gem_submit req;
+	uint32_t *queues, *fences, *cmdstream;
+	uint64_t *latency;
+	unsigned int i, gen, nr_bos, cmd_dwords;
+	int fd, opt;
+
+	while ((opt = getopt(argc, argv, "d:n:b:r:s:q:t")) != -1) {
+		switch (opt) {
+		case 'd': opts.dev = optarg; break;
+		case 'n': opts.iters = strtoul(optarg, NULL, 0); break;
+		case 'b': opts.nr_bos = strtoul(optarg, NULL, 0); break;
+		case 'r': opts.nr_relocs = strtoul(optarg, NULL, 0); break;
+		case 's': opts.nr_syncobjs = strtoul(optarg, NULL, 0); break;
+		case 'q': opts.nr_queues = strtoul(optarg, NULL, 0); break;
+		case 't': opts.trace = true; break;
+		default: usage(argv[0]);
+		}
+	}
+
+	if (!opts.iters || !opts.nr_queues)
+		usage(argv[0]);
+
+	ksft_print_header();
+
+	fd = open(opts.dev, O_RDWR | O_CLOEXEC);
+	if (fd < 0 || !is_msm(fd))
+		ksft_exit_skip("%s: no msm render node at %s\n", TEST_PREFIX, opts.dev);
+
+	gen = (get_param(fd, MSM_PARAM_CHIP_ID) >> 24) & 0xff;
+	if (!gen)
+		gen = get_param(fd, MSM_PARAM_GPU_ID) / 100;
+	if (!gen)
+		ksft_exit_skip("%s: no GPU\n", TEST_PREFIX);
+
+	if (opts.nr_relocs && gen >= 5)
+		ksft_exit_skip("%s: relocs are not supported on a%uxx\n",
+			       TEST_PREFIX, gen);
+
+	ksft_set_plan(1);
+
+	/* The cmdstream is bos[0], the rest are just along for the ride: */
+	nr_bos = opts.nr_bos + 1;
+	bos = calloc(nr_bos, sizeof(*bos));
+	for (i = 0; i < nr_bos; i++) {
+		bos[i].handle = bo_new(fd, (i == 0) ? CMD_SIZE : BO_SIZE);
+		bos[i].flags = MSM_SUBMIT_BO_READ;
+	}
+
+	/*
+	 * Each reloc patches the payload dword of a pkt3 NOP, so the cmdstream
+	 * is a pkt3 NOP + payload per reloc, or a single zero-length pkt7 NOP:
+	 */
+	cmdstream = bo_map(fd, bos[0].handle, CMD_SIZE);
+	if (gen >= 5) {
+		cmdstream[0] = PKT7_NOP;
+		cmd_dwords = 1;
+	} else {
+		cmd_dwords = 2 * (opts.nr_relocs ? opts.nr_relocs : 1);
+		if (cmd_dwords * 4 > CMD_SIZE)
+			ksft_exit_fail_msg("too many relocs\n");
+		for (i = 0; i < cmd_dwords; i += 2) {
+			cmdstream[i] = PKT3_NOP;
+			cmdstream[i + 1] = 0;
+		}
+	}
+	munmap(cmdstream, CMD_SIZE);
+
+	if (opts.nr_relocs) {
+		relocs = calloc(opts.nr_relocs, sizeof(*relocs));
+		for (i = 0; i < opts.nr_relocs; i++) {
+			relocs[i].submit_offset = (2 * i + 1) * 4;
+			relocs[i].reloc_idx = (nr_bos > 1) ? 1 + (i % opts.nr_bos) : 0;
+		}
+	}
+
+	cmd.type = MSM_SUBMIT_CMD_BUF;
+	cmd.submit_idx = 0;
+	cmd.submit_offset = 0;
+	cmd.size = cmd_dwords * 4;
+	cmd.nr_relocs = opts.nr_relocs;
+	cmd.relocs = (uintptr_t)relocs;
+
+	if (opts.nr_syncobjs) {
+		syncobjs = calloc(opts.nr_syncobjs, sizeof(*syncobjs));
+		for (i = 0; i < opts.nr_syncobjs; i++)
+			syncobjs[i].handle = syncobj_new(fd);
+	}
+
+	queues = calloc(opts.nr_queues, sizeof(*queues));
+	for (i = 0; i < opts.nr_queues; i++)
+		queues[i] = queue_new(fd);
+
+	fences = calloc(opts.iters, sizeof(*fences));
+	latency = calloc(opts.iters, sizeof(*latency));
+
+	if (opts.trace && trace_start()) {
+		ksft_print_msg("%s: tracefs not available, no stage latency\n",
+			       TEST_PREFIX);
+		opts.trace = false;
+	}
+
+	for (i = 0; i < opts.iters; i++) {
+		uint64_t t;
+
+		/* Keep the number of submits in flight bounded: */
+		if (i >= MAX_INFLIGHT)
+			wait_fence(fd, queues[(i - MAX_INFLIGHT) % opts.nr_queues],
+				   fences[i - MAX_INFLIGHT]);
+
+		memset(&req, 0, sizeof(req));
+		req.flags = MSM_PIPE_3D0;
+		req.queueid = queues[i % opts.nr_queues];
+		req.nr_bos = nr_bos;
+		req.bos = (uintptr_t)bos;
+		req.nr_cmds = 1;
+		req.cmds = (uintptr_t)&cmd;
+
+		if (opts.nr_syncobjs) {
+			req.flags |= MSM_SUBMIT_SYNCOBJ_IN;
+			req.in_syncobjs = (uintptr_t)syncobjs;
+			req.nr_in_syncobjs = opts.nr_syncobjs;
+			req.syncobj_stride = sizeof(*syncobjs);
+		}
+
+		t = now_ns();
+		if (ioctl(fd, DRM_IOCTL_MSM_GEM_SUBMIT, &req)) {
+			ksft_test_result_fail("GEM_SUBMIT failed: %s\n", strerror(errno));
+			ksft_finished();
+		}
+		latency[i] = now_ns() - t;
+
+		fences[i] = req.fence;
+	}
+
+	for (i = 0; i < opts.nr_queues && i < opts.iters; i++) {
+		unsigned int last = opts.iters - 1 - i;
+
+		wait_fence(fd, queues[last % opts.nr_queues], fences[last]);
+	}
+
+	ksft_print_msg("bos=%u relocs=%u syncobjs=%u queues=%u\n", opts.nr_bos,
+		       opts.nr_relocs, opts.nr_syncobjs, opts.nr_queues);
+	report("ioctl", latency, opts.iters);
+
+	if (opts.trace)
+		trace_report();
+
+	ksft_test_result_pass("%u submits\n", opts.iters);
+	ksft_finished();
+}
@@ -0,0 +1,378 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Latency and throughput benchmark for the Qualcomm IPC stack.
+ *
+ * The qrtr test bounces datagrams between two AF_QIPCRTR sockets, through
+ * the local loopback in af_qrtr, or off a remote echo service with -n/-p.
+ * The rpmsg test writes to an rpmsg_char endpoint (glink or smd, depending
+ * on the remote) whose service echoes every message back, given with -r.
+ *
+ * For every message size the round trip latency of -i ping-pongs is
+ * reported, followed by the throughput with -w messages in flight. Every
+ * result is one "key=value" line.
+ */
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <linux/qrtr.h>
+#include "../../../kselftest.h"
+
+#ifndef AF_QIPCRTR
+#define AF_QIPCRTR	42
+#endif
+
+#define MAX_SIZES	16
+#define RECV_TIMEOUT_MS	5000
+
+static struct {
+	unsigned int iters;
+	unsigned int window;
+	unsigned int sizes[MAX_SIZES];
+	unsigned int nr_sizes;
+	const char *rpmsg_dev;
+	int qrtr_node;
+	int qrtr_port;
+} opts = {
+	.iters = 1000,
+	.window = 8,
+	.sizes = { 16, 64, 256, 1024, 4096, 16384 },
+	.nr_sizes = 6,
+	.qrtr_node = -1,
+	.qrtr_port = -1,
+};
+
+/* One side of a transport: send and receive a single message */
+struct endpoint {
+	const char *name;
+	int fd;
+	struct sockaddr_qrtr peer;
+	bool is_qrtr;
+};
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int ep_send(struct endpoint *ep, const void *buf, size_t len)
+{
+	ssize_t ret;
+
+	if (ep->is_qrtr)
+		ret = sendto(ep->fd, buf, len, 0, (struct sockaddr *)&ep->peer,
+			     sizeof(ep->peer));
+	else
+		ret = write(ep->fd, buf, len);
+
+	if (ret < 0)
+		return -errno;
+
+	return ret == (ssize_t)len ? 0 : -EMSGSIZE;
+}
+
+static ssize_t ep_recv(struct endpoint *ep, void *buf, size_t len)
+{
+	struct pollfd pfd = { .fd = ep->fd, .events = POLLIN };
+	ssize_t ret;
+
+	ret = poll(&pfd, 1, RECV_TIMEOUT_MS);
+	if (ret <= 0)
+		return ret ? -errno : -ETIMEDOUT;
+
+	ret = ep->is_qrtr ? recv(ep->fd, buf, len, 0) : read(ep->fd, buf, len);
+
+	return ret < 0 ? -errno : ret;
+}
+
+static void report_latency(const char *name, unsigned int size,
+			   uint64_t *samples, unsigned int n)
+{
+	uint64_t sum = 0;
+	unsigned int i;
+
+	qsort(samples, n, sizeof(*samples), cmp_u64);
+	for (i = 0; i < n; i++)
+		sum += samples[i];
+
+	ksft_print_msg("%s size=%u n=%u min=%llu avg=%llu p50=%llu p90=%llu p99=%llu max=%llu ns\n",
+		       name, size, n, (unsigned long long)samples[0],
+		       (unsigned long long)(sum / n),
+		       (unsigned long long)samples[n / 2],
+		       (unsigned long long)samples[(n * 90) / 100],
+		       (unsigned long long)samples[(n * 99) / 100],
+		       (unsigned long long)samples[n - 1]);
+}
+
+/*
+ * Round trips one at a time for the latency, then keeps opts.window
+ * messages in flight for the throughput.
+ */
+static int run_size(struct endpoint *ep, unsigned int size, uint64_t *samples)
+{
+	unsigned int i, sent = 0, received = 0;
+	char *tx, *rx;
+	uint64_t t;
+	int ret = 0;
+
+	tx = malloc(size);
+	rx = malloc(size);
+	if (!tx || !rx) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(tx, 0x5a, size);
+
+	for (i = 0; i < opts.iters; i++) {
+		t = now_ns();
+		ret = ep_send(ep, tx, size);
+		if (ret)
+			goto out;
+		ret = ep_recv(ep, rx, size);
+		if (ret < 0)
+			goto out;
+		samples[i] = now_ns() - t;
+
+		if ((unsigned int)ret != size) {
+			ret = -EPROTO;
+			goto out;
+		}
+	}
+
+	report_latency(ep->name, size, samples, opts.iters);
+
+	t = now_ns();
+	while (received < opts.iters) {
+		while (sent < opts.iters && sent - received < opts.window) {
+			ret = ep_send(ep, tx, size);
+			if (ret)
+				goto out;
+			sent++;
+		}
+
+		ret = ep_recv(ep, rx, size);
+		if (ret < 0)
+			goto out;
+		received++;
+	}
+	t = now_ns() - t;
+
+	ksft_print_msg("%s size=%u window=%u msgs=%u msgs_per_sec=%llu bytes_per_sec=%llu\n",
+		       ep->name, size, opts.window, opts.iters,
+		       (unsigned long long)(opts.iters * 1000000000ull / t),
+		       (unsigned long long)((uint64_t)opts.iters * size *
+					    1000000000ull / t));
+	ret = 0;
+
+out:
+	free(tx);
+	free(rx);
+	return ret;
+}
+
+static void run_sizes(struct endpoint *ep)
+{
+	uint64_t *samples = calloc(opts.iters, sizeof(*samples));
+	unsigned int i;
+	int ret;
+
+	if (!samples)
+		ksft_exit_fail_perror("calloc");
+
+	for (i = 0; i < opts.nr_sizes; i++) {
+		ret = run_size(ep, opts.sizes[i], samples);
+		if (ret)
+			ksft_test_result_fail("%s size=%u: %s\n", ep->name,
+					      opts.sizes[i], strerror(-ret));
+		else
+			ksft_test_result_pass("%s size=%u\n", ep->name,
+					      opts.sizes[i]);
+	}
+
+	free(samples);
+}
+
+static int qrtr_open(struct sockaddr_qrtr *addr)
+{
+	socklen_t len = sizeof(*addr);
+	int fd;
+
+	fd = socket(AF_QIPCRTR, SOCK_DGRAM, 0);
+	if (fd < 0)
+		return -errno;
+
+	if (getsockname(fd, (struct sockaddr *)addr, &len)) {
+		close(fd);
+		return -errno;
+	}
+
+	/* Port 0 asks af_qrtr for a dynamically assigned port */
+	addr->sq_port = 0;
+	if (bind(fd, (struct sockaddr *)addr, sizeof(*addr)) ||
+	    getsockname(fd, (struct sockaddr *)addr, &len)) {
+		close(fd);
+		return -errno;
+	}
+
+	return fd;
+}
+
+/* Local stand-in for an echo service, on the other side of the loopback */
+static void *qrtr_echo_thread(void *data)
+{
+	static char buf[65536];
+	int fd = *(int *)data;
+	struct sockaddr_qrtr from;
+	socklen_t len;
+	ssize_t n;
+
+	/* Runs until the test cancels it */
+	for (;;) {
+		len = sizeof(from);
+		n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&from, &len);
+		if (n < 0)
+			break;
+		if (sendto(fd, buf, n, 0, (struct sockaddr *)&from, len) < 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static void test_qrtr(void)
+{
+	struct sockaddr_qrtr local, echo_addr;
+	struct endpoint ep = { .name = "qrtr", .is_qrtr = true };
+	pthread_t echo;
+	int echo_fd = -1;
+	unsigned int i;
+
+	ep.fd = qrtr_open(&local);
+	if (ep.fd < 0) {
+		for (i = 0; i < opts.nr_sizes; i++)
+			ksft_test_result_skip("qrtr size=%u: no AF_QIPCRTR\n",
+					      opts.sizes[i]);
+		return;
+	}
+
+	if (opts.qrtr_node >= 0) {
+		ep.name = "qrtr-remote";
+		ep.peer.sq_family = AF_QIPCRTR;
+		ep.peer.sq_node = opts.qrtr_node;
+		ep.peer.sq_port = opts.qrtr_port;
+	} else {
+		echo_fd = qrtr_open(&echo_addr);
+		if (echo_fd < 0)
+			ksft_exit_fail_msg("qrtr echo socket: %s\n",
+					   strerror(-echo_fd));
+		if (pthread_create(&echo, NULL, qrtr_echo_thread, &echo_fd))
+			ksft_exit_fail_perror("pthread_create");
+		ep.name = "qrtr-loopback";
+		ep.peer = echo_addr;
+	}
+
+	run_sizes(&ep);
+
+	if (echo_fd >= 0) {
+		pthread_cancel(echo);
+		pthread_join(echo, NULL);
+		close(echo_fd);
+	}
+	close(ep.fd);
+}
+
+static void test_rpmsg(void)
+{
+	struct endpoint ep = { .name = "rpmsg" };
+	unsigned int i;
+
+	ep.fd = opts.rpmsg_dev ? open(opts.rpmsg_dev, O_RDWR | O_CLOEXEC) : -1;
+	if (ep.fd < 0) {
+		for (i = 0; i < opts.nr_sizes; i++)
+			ksft_test_result_skip("rpmsg size=%u: %s\n", opts.sizes[i],
+					      opts.rpmsg_dev ? strerror(errno) :
+					      "no echo endpoint given (-r)");
+		return;
+	}
+
+	run_sizes(&ep);
+	close(ep.fd);
+}
+
+static void parse_sizes(char *arg)
+{
+	char *tok;
+
+	opts.nr_sizes = 0;
+	for (tok = strtok(arg, ","); tok && opts.nr_sizes < MAX_SIZES;
+	     tok = strtok(NULL, ","))
+		opts.sizes[opts.nr_sizes++] = strtoul(tok, NULL, 0);
+}
+
+static void usage(const char *prog)
+{
+	fprintf(stderr,
+		"usage: %s [-i iters] [-w window] [-s sizes] [-n node -p port] [-r dev]\n"
+		"  -i  round trips per message size (default 1000)\n"
+		"  -w  messages in flight for the throughput run (default 8)\n"
+		"  -s  comma separated message sizes (default 16,64,256,1024,4096,16384)\n"
+		"  -n  qrtr node of a remote echo service, instead of the loopback\n"
+		"  -p  qrtr port of the remote echo service\n"
+		"  -r  rpmsg_char endpoint bound to an echo service, e.g. /dev/rpmsg0\n",
+		prog);
+	exit(KSFT_FAIL);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "i:w:s:n:p:r:")) != -1) {
+		switch (opt) {
+		case 'i': opts.iters = strtoul(optarg, NULL, 0); break;
+		case 'w': opts.window = strtoul(optarg, NULL, 0); break;
+		case 's': parse_sizes(optarg); break;
+		case 'n': opts.qrtr_node = strtol(optarg, NULL, 0); break;
+		case 'p': opts.qrtr_port = strtol(optarg, NULL, 0); break;
+		case 'r': opts.rpmsg_dev = optarg; break;
+		default: usage(argv[0]);
+		}
+	}
+
+	if (!opts.iters || !opts.window || !opts.nr_sizes ||
+	    (opts.qrtr_node >= 0) != (opts.qrtr_port >= 0))
+		usage(argv[0]);
+	for (i = 0; i < opts.nr_sizes; i++)
+		if (!opts.sizes[i])
+			usage(argv[0]);
+
+	ksft_print_header();
+	ksft_set_plan(2 * opts.nr_sizes);
+
+	test_qrtr();
+	test_rpmsg();
+
+	ksft_finished();
+}
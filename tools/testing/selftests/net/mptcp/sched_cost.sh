@@ -0,0 +1,153 @@
+#!/bin/bash
+# SPDX-License-Identifier: GPL-2.0
+
+# Check that the "cost" scheduler keeps the data on the regular subflow while
+# it is good enough, even when that subflow is limited by its send buffer, and
+# only spills over to the backup one when it is not.
+
+. "$(dirname "${0}")/mptcp_lib.sh"
+
+ns1=""
+ns2=""
+timeout_poll=30
+timeout_test=$((timeout_poll * 2 + 1))
+MPTCP_LIB_TEST_FORMAT="%02u %-60s"
+ret=0
+large=""
+sout=""
+size=$((8 * 1024 * 1024))
+
+# This function is used in the cleanup trap
+#shellcheck disable=SC2317
+cleanup()
+{
+	rm -f "$large" "$sout"
+
+	mptcp_lib_ns_exit "${ns1}" "${ns2}"
+}
+
+mptcp_lib_check_mptcp
+mptcp_lib_check_tools ip tc
+
+#  ns1                 ns2
+#     ns1eth1    ns2eth1     regular ("Wi-Fi")
+#            netem
+#     ns1eth2    ns2eth2     backup ("LTE")
+#            netem
+
+setup()
+{
+	large=$(mktemp)
+	sout=$(mktemp)
+
+	dd if=/dev/zero of="$large" bs=4096 count=$((size / 4096)) >/dev/null 2>&1
+
+	trap cleanup EXIT
+
+	mptcp_lib_ns_init ns1 ns2
+
+	ip link add ns1eth1 netns "$ns1" type veth peer name ns2eth1 netns "$ns2"
+	ip link add ns1eth2 netns "$ns1" type veth peer name ns2eth2 netns "$ns2"
+
+	ip -net "$ns1" addr add 10.0.1.1/24 dev ns1eth1
+	ip -net "$ns1" link set ns1eth1 up mtu 1500
+	ip -net "$ns1" addr add 10.0.2.1/24 dev ns1eth2
+	ip -net "$ns1" link set ns1eth2 up mtu 1500
+
+	ip -net "$ns2" addr add 10.0.1.2/24 dev ns2eth1
+	ip -net "$ns2" link set ns2eth1 up mtu 1500
+	ip -net "$ns2" addr add 10.0.2.2/24 dev ns2eth2
+	ip -net "$ns2" link set ns2eth2 up mtu 1500
+
+	local dev
+	for dev in ns1eth1 ns1eth2; do
+		tc -n "$ns1" qdisc add dev $dev root netem rate 10mbit delay 5ms
+	done
+	for dev in ns2eth1 ns2eth2; do
+		tc -n "$ns2" qdisc add dev $dev root netem rate 10mbit delay 5ms
+	done
+
+	mptcp_lib_pm_nl_set_limits "${ns1}" 1 1
+	mptcp_lib_pm_nl_add_endpoint "${ns1}" 10.0.2.1 dev ns1eth2 flags subflow,backup
+	mptcp_lib_pm_nl_set_limits "${ns2}" 1 1
+
+	ip netns exec "$ns1" sysctl -q net.mptcp.scheduler=cost
+	# the radio is never considered awake, only the targets matter
+	ip netns exec "$ns1" sysctl -q net.mptcp.cost_radio_tail_ms=0
+}
+
+backup_tx_bytes()
+{
+	ip netns exec "$ns1" cat /sys/class/net/ns1eth2/statistics/tx_bytes
+}
+
+# $1: rate target (kbps) ; $2: "none" or "some" data expected on the backup
+run_test()
+{
+	local rate=$1
+	local expect=$2
+	shift 2
+	local msg=$*
+	local port=$((10000 + MPTCP_LIB_TEST_COUNTER))
+	local before after sent
+	local lret=0
+
+	ip netns exec "$ns1" sysctl -q net.mptcp.cost_rtt_target_us=1000000
+	ip netns exec "$ns1" sysctl -q net.mptcp.cost_rate_target_kbps="$rate"
+
+	mptcp_lib_print_title "$msg"
+
+	:> "$sout"
+	before=$(backup_tx_bytes)
+
+	timeout ${timeout_test} \
+		ip netns exec "$ns2" \
+			./mptcp_connect -jt ${timeout_poll} -l -p $port \
+				0.0.0.0 < /dev/null > "$sout" &
+	local spid=$!
+
+	mptcp_lib_wait_local_port_listen "${ns2}" "${port}"
+
+	timeout ${timeout_test} \
+		ip netns exec "$ns1" \
+			./mptcp_connect -jt ${timeout_poll} -p $port \
+				10.0.1.2 < "$large" > /dev/null
+	local retc=$?
+	wait $spid
+	local rets=$?
+
+	after=$(backup_tx_bytes)
+	sent=$((after - before))
+
+	if [ $retc -ne 0 ] || [ $rets -ne 0 ]; then
+		mptcp_lib_pr_fail "client exit code $retc, server $rets"
+		lret=1
+	elif ! mptcp_lib_check_transfer "$large" "$sout" "file received"; then
+		lret=1
+	elif [ "$expect" = "none" ] && [ $sent -gt $((size / 100)) ]; then
+		mptcp_lib_pr_fail "$sent bytes sent on the backup subflow"
+		lret=1
+	elif [ "$expect" = "some" ] && [ $sent -lt $((size / 10)) ]; then
+		mptcp_lib_pr_fail "only $sent bytes sent on the backup subflow"
+		lret=1
+	else
+		mptcp_lib_pr_ok
+	fi
+
+	mptcp_lib_result_code "${lret}" "${msg}"
+	if [ $lret -ne 0 ] && ! mptcp_lib_subtest_is_flaky; then
+		ret=$lret
+	fi
+}
+
+setup
+
+# 10mbit on the regular path is above the target, even while its send buffer
+# is full the data has to wait for it
+run_test 1000 none "regular subflow good enough"
+
+# the pacing rate is only an estimate of the path throughput
+MPTCP_LIB_SUBTEST_FLAKY=1 run_test 1000000 some "regular subflow too slow"
+
+mptcp_lib_result_print_all_tap
+exit $ret